@@ -65,6 +65,8 @@ changes to an interface declared in a ".mm" file.
 	- (IBAction)
 	launchNewCallPythonClient:(id)_;
 	- (IBAction)
+	runSpawnBenchmark:(id)_;
+	- (IBAction)
 	setTestTerminalToActiveSessionData:(id)_;
 	- (IBAction)
 	showTestTerminalToolbar:(id)_;
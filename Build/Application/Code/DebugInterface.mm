@@ -42,6 +42,8 @@
 #import <XPCCallPythonClient.objc++.h>
 
 // application includes
+#import "Local.h"
+#import "ScriptHost.h"
 #import "Session.h"
 #import "SessionFactory.h"
 #import "Terminal.h"
@@ -180,7 +182,26 @@ dumpStateOfActiveTerminal:(id)	sender
 			}
 			else
 			{
-				Console_WriteLine("No debugging information has been defined.");
+				Session_Statistics	statistics;
+				
+				
+				if (Session_GetStatistics(activeSession, statistics).ok())
+				{
+					Console_WriteValueCFString("Bytes read",
+												BRIDGE_CAST([NSString stringWithFormat:@"%llu", statistics.bytesRead], CFStringRef));
+					Console_WriteValueCFString("Bytes parsed",
+												BRIDGE_CAST([NSString stringWithFormat:@"%llu (%.3f s)", statistics.bytesParsed,
+																						statistics.parseTime], CFStringRef));
+					Console_WriteValueCFString("Characters echoed",
+												BRIDGE_CAST([NSString stringWithFormat:@"%llu", statistics.echoCharacterCount], CFStringRef));
+					Console_WriteValueCFString("Lines added to scrollback",
+												BRIDGE_CAST([NSString stringWithFormat:@"%llu", statistics.scrollbackLineCount], CFStringRef));
+					Console_WriteValueCFString("Frames rendered",
+												BRIDGE_CAST([NSString stringWithFormat:@"%llu (%.3f s)", statistics.renderFrameCount,
+																						statistics.renderTime], CFStringRef));
+					Console_WriteValueCFString("Invalidations coalesced",
+												BRIDGE_CAST([NSString stringWithFormat:@"%llu", statistics.coalescedFrameCount], CFStringRef));
+				}
 			}
 		}
 		Console_WriteLine("Terminal Window");
@@ -264,11 +285,44 @@ launchNewCallPythonClient:(id)	sender
 		[asInterface xpcServiceSendMessage:@"hello!" withReply:^(NSString* aReplyString){
 			NSLog(@"MacTerm received response from Python client: %@", aReplyString);
 		}];
+		
+		// the service is sandboxed, so instead of finding the socket
+		// by name it is given one end of an existing connection
+		{
+			int		clientSocket = ScriptHost_NewLoopbackConnection();
+			
+			
+			if (clientSocket >= 0)
+			{
+				NSFileHandle*	clientHandle = [[NSFileHandle alloc] initWithFileDescriptor:clientSocket closeOnDealloc:YES];
+				
+				
+				[asInterface xpcServiceAttachScriptHost:clientHandle withReply:^(NSString* aReplyString){
+					NSLog(@"MacTerm received response from Python client: %@", aReplyString);
+				}];
+				[clientHandle release];
+			}
+		}
 	}
 	// TEMPORARY (INCOMPLETE)
 }// launchNewCallPythonClient:
 
 
+/*!
+Prints the average time taken to create processes with
+each spawn method, as the application grows; see the
+routine Local_RunSpawnBenchmark().  This takes a while.
+
+(2017.10)
+*/
+- (IBAction)
+runSpawnBenchmark:(id)	sender
+{
+#pragma unused(sender)
+	Local_RunSpawnBenchmark();
+}// runSpawnBenchmark:
+
+
 /*!
 Changes the data source of the test Cocoa terminal window so
 that it displays the same terminal screen as the active
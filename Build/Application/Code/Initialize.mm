@@ -58,7 +58,9 @@
 #import <Localization.h>
 #import <MacHelpUtilities.h>
 #import <MemoryBlockPtrLocker.template.h>
+#import <MemoryBlockReferenceTable.template.h>
 #import <MemoryBlocks.h>
+#import <UTF8Decoder.h>
 #import <Undoables.h>
 
 // application includes
@@ -71,9 +73,11 @@
 #import "EventLoop.h"
 #import "InfoWindow.h"
 #import "InternetPrefs.h"
+#import "Local.h"
 #import "Preferences.h"
 #import "PrefsWindow.h"
 #import "RecordAE.h"
+#import "ScriptHost.h"
 #import "SessionFactory.h"
 #import "TerminalBackground.h"
 #import "TerminalView.h"
@@ -81,6 +85,28 @@
 
 
 
+#pragma mark Types
+namespace {
+
+/*!
+Measures one phase of application startup.  In debug
+builds, the time spent is written to the console when
+the object goes out of scope; this makes it easy to see
+which module is slowing down the first window.
+*/
+struct My_StartupPhaseTimer
+{
+	My_StartupPhaseTimer	(char const*);
+	~My_StartupPhaseTimer	();
+
+	char const*		phaseName;	//!< label written to the console
+	CFAbsoluteTime	startTime;	//!< when the phase began
+};
+
+} // anonymous namespace
+
+
+
 #pragma mark Internal Method Prototypes
 namespace {
 
@@ -103,6 +129,9 @@ in a particular dependency order.
 void
 Initialize_ApplicationStartup	(CFBundleRef	inApplicationBundle)
 {
+	My_StartupPhaseTimer	startupTimer("startup (total)");
+	
+	
 	// seed random number generator; calls to random() should not be
 	// used for anything particularly important, arc4random() is better
 	::srandom(TickCount());
@@ -128,14 +157,32 @@ Initialize_ApplicationStartup	(CFBundleRef	inApplicationBundle)
 	MemoryBlockPtrLocker_RunTests();
 #endif
 	
+#if RUN_MODULE_TESTS
+	MemoryBlockReferenceTable_RunTests();
+#endif
+	
+#if RUN_MODULE_TESTS
+	UTF8Decoder_RunTests();
+#endif
+	
 	// set the application bundle so everything searches in the right place for resources
 	AppResources_Init(inApplicationBundle);
 	
 	// initialize Cocoa
-	EventLoop_Init();
+	{
+		My_StartupPhaseTimer	phaseTimer("EventLoop_Init()");
+		
+		
+		EventLoop_Init();
+	}
 	
 	// initialize memory manager, start up toolbox managers, etc.
-	initMacOSToolbox();
+	{
+		My_StartupPhaseTimer	phaseTimer("initMacOSToolbox()");
+		
+		
+		initMacOSToolbox();
+	}
 	
 	initApplicationCore();
 	
@@ -156,44 +203,100 @@ Initialize_ApplicationStartup	(CFBundleRef	inApplicationBundle)
 	ListenerModel_RunTests();
 #endif
 	
+#if RUN_MODULE_TESTS
+	Local_RunTests();
+#endif
+	
+#if RUN_MODULE_TESTS
+	URL_RunTests();
+#endif
+	
 	// do everything else
 	{
-		SessionFactory_Init();
+		{
+			My_StartupPhaseTimer	phaseTimer("SessionFactory_Init()");
+			
+			
+			SessionFactory_Init();
+		}
 	#if RUN_MODULE_TESTS
 		//SessionFactory_RunTests();
+		ScriptHost_RunTests();
 	#endif
 		
-		Commands_Init();
+		{
+			My_StartupPhaseTimer	phaseTimer("ScriptHost_Init()");
+			
+			
+			ScriptHost_Init();
+		}
+		
+		{
+			My_StartupPhaseTimer	phaseTimer("Commands_Init()");
+			
+			
+			Commands_Init();
+		}
 	#if RUN_MODULE_TESTS
 		//Commands_RunTests();
 	#endif
 		
-		TerminalBackground_Init();
+		{
+			My_StartupPhaseTimer	phaseTimer("TerminalBackground_Init()");
+			
+			
+			TerminalBackground_Init();
+		}
 	#if RUN_MODULE_TESTS
 		//TerminalBackground_RunTests();
 	#endif
 		
-		TerminalView_Init();
+		{
+			My_StartupPhaseTimer	phaseTimer("TerminalView_Init()");
+			
+			
+			TerminalView_Init();
+		}
 	#if RUN_MODULE_TESTS
-		//TerminalView_RunTests();
+		TerminalView_RunTests();
 	#endif
 		
-		CommandLine_Init();
+		{
+			My_StartupPhaseTimer	phaseTimer("CommandLine_Init()");
+			
+			
+			CommandLine_Init();
+		}
 	#if RUN_MODULE_TESTS
 		//CommandLine_RunTests();
 	#endif
 		
-		Clipboard_Init();
+		{
+			My_StartupPhaseTimer	phaseTimer("Clipboard_Init()");
+			
+			
+			Clipboard_Init();
+		}
 	#if RUN_MODULE_TESTS
 		//Clipboard_RunTests();
 	#endif
 		
-		InfoWindow_Init(); // installs command handler to enable this window to be displayed and hidden
+		{
+			My_StartupPhaseTimer	phaseTimer("InfoWindow_Init()");
+			
+			
+			InfoWindow_Init(); // installs command handler to enable this window to be displayed and hidden
+		}
 	#if RUN_MODULE_TESTS
 		//InfooWindow_RunTests();
 	#endif
 		
-		InternetPrefs_Init();
+		{
+			My_StartupPhaseTimer	phaseTimer("InternetPrefs_Init()");
+			
+			
+			InternetPrefs_Init();
+		}
 	#if RUN_MODULE_TESTS
 		//InternetPrefs_RunTests();
 	#endif
@@ -227,6 +330,9 @@ Initialize_ApplicationStartup	(CFBundleRef	inApplicationBundle)
 			
 			unless (quellAutoNew)
 			{
+				My_StartupPhaseTimer	phaseTimer("first window");
+				
+				
 				Commands_ExecuteByIDUsingEvent(kCommandRestoreWorkspaceDefaultFavorite);
 			}
 		}
@@ -270,6 +376,7 @@ See also Initialize_ApplicationShutDownRemainingComponents().
 void
 Initialize_ApplicationShutDownIsolatedComponents ()
 {
+	ScriptHost_Done();
 	CommandLine_Done();
 	Clipboard_Done();
 	InfoWindow_Done();
@@ -306,6 +413,40 @@ Initialize_ApplicationShutDownRemainingComponents ()
 #pragma mark Internal Methods
 namespace {
 
+/*!
+Starts timing a phase of startup.
+
+(2017.10)
+*/
+My_StartupPhaseTimer::
+My_StartupPhaseTimer	(char const*	inPhaseName)
+:
+phaseName(inPhaseName),
+startTime(CFAbsoluteTimeGetCurrent())
+{
+}// My_StartupPhaseTimer constructor
+
+
+/*!
+Reports the time spent in this phase of startup (debug
+builds only).
+
+(2017.10)
+*/
+My_StartupPhaseTimer::
+~My_StartupPhaseTimer ()
+{
+#ifndef NDEBUG
+	CFAbsoluteTime const	kElapsedTime = (CFAbsoluteTimeGetCurrent() - this->startTime);
+	std::string				label(this->phaseName);
+	
+	
+	label += ", milliseconds";
+	Console_WriteValue(label.c_str(), STATIC_CAST(kElapsedTime * 1000.0, SInt32));
+#endif
+}// My_StartupPhaseTimer destructor
+
+
 /*!
 This method initializes key modules (both
 internally and from MacTerm’s libraries),
@@ -338,6 +479,9 @@ initApplicationCore ()
 		}
 	#endif
 		
+		My_StartupPhaseTimer	phaseTimer("Localization_Init()");
+		
+		
 		Localization_Init(flags);
 	}
 	
@@ -345,6 +489,7 @@ initApplicationCore ()
 	{
 		UIStrings_Result	stringResult = kUIStrings_ResultOK;
 		CFStringRef			helpBookAppleTitle = nullptr;
+		My_StartupPhaseTimer	phaseTimer("MacHelpUtilities_Init()");
 		
 		
 		stringResult = UIStrings_Copy(kUIStrings_HelpSystemName, helpBookAppleTitle);
@@ -355,8 +500,15 @@ initApplicationCore ()
 		}
 	}
 	
-	// set up notification info
-	Preferences_Init();
+	// set up notification info; note that Preferences_Init() only
+	// reads the favorites that are needed to open the first window
+	// (everything else is loaded after startup, or on first use)
+	{
+		My_StartupPhaseTimer	phaseTimer("Preferences_Init()");
+		
+		
+		Preferences_Init();
+	}
 	{
 		UInt16					notificationPreferences = kAlert_NotifyDisplayDiamondMark;
 		Preferences_Result		prefsResult = Preferences_GetData(kPreferences_TagNotification,
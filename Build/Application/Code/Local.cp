@@ -36,6 +36,7 @@
 #include <UniversalDefines.h>
 
 // standard-C includes
+#include <climits>
 #include <cstdio>
 #include <cstdlib>
 
@@ -43,23 +44,28 @@
 #include <map>
 #include <set>
 #include <string>
+#include <vector>
 
 // UNIX includes
 //struct pthread_rwlock_t;
 //struct pthread_rwlockattr_t;
 extern "C"
 {
+#	include <crt_externs.h>
 #	include <errno.h>
 #	include <fcntl.h>
 #	include <grp.h>
+#	include <libproc.h>
 #	include <netdb.h>
 #	include <pthread.h>
 #	include <pwd.h>
 #	include <signal.h>
+#	include <spawn.h>
 #	include <sysexits.h>
 #	include <termios.h>
 #	include <unistd.h>
 #	include <netinet/in.h>
+#	include <sys/event.h>
 #	include <sys/ioctl.h>
 #	include <sys/socket.h>
 #	include <sys/stat.h>
@@ -86,7 +92,6 @@ extern "C"
 #include "DebugInterface.h"
 #include "DialogUtilities.h"
 #include "NetEvents.h"
-#include "QuillsSession.h"
 #include "Session.h"
 #include "Terminal.h"
 #include "UIStrings.h"
@@ -102,6 +107,21 @@ enum MyTTYState
 	kMyTTYStateRaw
 };
 
+/*!
+Ways to create a child process in a pseudo-terminal.
+*/
+enum My_SpawnMethod
+{
+	kMy_SpawnMethodFork,		//!< use forkpty(); always works, but copies the page tables of this process
+	kMy_SpawnMethodPosixSpawn	//!< use posix_spawn() if the system supports it, otherwise fall back to forkpty()
+};
+
+//! a directory is found again when the foreground process changes,
+//! or when it becomes older than this (in case a shell that does
+//! not report directories runs "cd", or a shell that does report
+//! them is replaced by one that does not)
+CFTimeInterval const	kMy_CurrentDirectoryQueryMaximumAge = 30.0; // arbitrary
+
 } // anonymous namespace
 
 #pragma mark Types
@@ -120,6 +140,7 @@ struct My_DataLoopThreadContext
 	EventQueueRef		eventQueue;
 	SessionRef			session;
 	My_TTYMasterID		masterTTY;
+	pid_t				processID;
 };
 typedef My_DataLoopThreadContext*			My_DataLoopThreadContextPtr;
 typedef My_DataLoopThreadContext const*		My_DataLoopThreadContextConstPtr;
@@ -130,16 +151,23 @@ as a Local_ProcessRef.
 */
 struct My_Process
 {
-	My_Process	(CFArrayRef, CFStringRef, Local_TerminalID, char const*, pid_t);
+	My_Process	(SessionRef, CFArrayRef, CFStringRef, Local_TerminalID, char const*, pid_t);
 	~My_Process	();
 	
 	pid_t				_processID;			// the process directly spawned by this session
 	Boolean				_stopped;			// true only if XOFF/suspend has occurred with no XON/resume yet
 	Local_TerminalID	_pseudoTerminal;	// file descriptor of pseudo-terminal master
-	char const*			_slaveDeviceName;	// e.g. "/dev/ttyp0", data sent here goes to the terminal emulator (not the process)
+	std::string			_slaveDeviceName;	// e.g. "/dev/ttyp0", data sent here goes to the terminal emulator (not the process)
 	CFRetainRelease		_commandLine;		// array of strings for parent process’ command line arguments (first is program name)
 	CFRetainRelease		_recentDirectory;	// empty until a query is done to determine the value
 	CFRetainRelease		_originalDirectory;	// empty if no chdir() was used, otherwise the chdir() value at spawn time
+	CFAbsoluteTime		_directoryTime;		// when "_recentDirectory" was last set; 0 if never
+	pid_t				_directoryGroup;	// foreground process group when "_recentDirectory" was last queried
+	Boolean				_directoryReported;	// true if the terminal recently reported the directory, making queries unnecessary
+	pid_t				_directoryUnresolvedID;	// process (usually the foreground group) whose directory could not be found; 0 if none
+	SessionRef			_session;			// the session that is notified of changes to the states below
+	pid_t				_foregroundGroup;	// process group that most recently owned the terminal
+	Boolean				_passwordMode;		// true if the terminal most recently had echo off in line mode
 };
 typedef My_Process*			My_ProcessPtr;
 typedef My_Process const*	My_ProcessConstPtr;
@@ -149,20 +177,72 @@ typedef std::map< pid_t, Local_ProcessRef >		My_ProcessByID;
 typedef MemoryBlockPtrLocker< Local_ProcessRef, My_Process >	My_ProcessPtrLocker;
 typedef LockAcquireRelease< Local_ProcessRef, My_Process >		My_ProcessAutoLocker;
 
+/*!
+Describes the kind of shell that should be spawned ahead of
+time; this is updated whenever an eligible session is created
+(see Local_AdoptPreSpawnedProcess()).  The command line is
+always the user’s default shell (as determined by the routine
+Local_GetDefaultShellCommandLine()); no other command line is
+ever recorded or spawned ahead of time.
+*/
+struct My_PreSpawnRequest
+{
+	CFRetainRelease		commandLine;	// array of strings for the command line arguments (first is program name)
+	CFRetainRelease		terminalName;	// value of TERM in the environment of the process
+	UInt16				columnCount;	// initial width of the pseudo-terminal
+	UInt16				rowCount;		// initial height of the pseudo-terminal
+};
+
+/*!
+A shell that was spawned ahead of time, waiting in its own
+pseudo-terminal to be adopted by a new session.
+*/
+struct My_PreSpawnedProcess
+{
+	My_PreSpawnRequest	request;			// the command line, TERM and size used to spawn the process
+	CFRetainRelease		workingDirectory;	// the directory the process started in
+	std::string			slaveDeviceName;	// e.g. "/dev/ttyp0"
+	My_TTYMasterID		masterTTY;			// file descriptor of pseudo-terminal master
+	pid_t				processID;			// the shell process
+	CFAbsoluteTime		spawnTime;			// used to discard processes that are idle for too long
+};
+
+typedef std::vector< My_PreSpawnedProcess >		My_PreSpawnedProcessList;
+
 } // anonymous namespace
 
 #pragma mark Internal Method Prototypes
 namespace {
 
+void			discardPreSpawnedProcess			(My_PreSpawnedProcess&);
+void			discardUnusablePreSpawnedProcesses	();
+void			findDirectoriesUsingLsof			(std::vector< pid_t > const&, std::map< pid_t, std::string >&);
+void			finishCurrentDirectoryQuery			(std::map< pid_t, pid_t > const&, std::map< pid_t, std::string > const&);
 void			fillInTerminalControlStructure		(struct termios*);
+void			handleChildProcessEvents			();
+Boolean			isDefaultShellCommandLine			(CFArrayRef);
+pid_t			posixSpawnInPseudoTerminal			(char* const*, char const*, struct termios*, struct winsize*,
+													 My_TTYMasterID&, char*);
+Local_Result	preSpawnProcess						();
 void			printTerminalControlStructure		(struct termios const*);
 Local_Result	putTTYInOriginalMode				(Local_TerminalID);
 void			putTTYInOriginalModeAtExit			();
 Local_Result	putTTYInRawMode						(Local_TerminalID);
+void			reapChildProcesses					();
 void			receiveSignal						(int);
+void			receiveTerminalStateChange			(pid_t, pid_t, Boolean);
+void			replenishPreSpawnedProcessesLater	();
+void			reportProcessExit					(pid_t, int);
 Local_Result	sendTerminalResizeMessage			(Local_TerminalID, struct winsize const*);
+Local_Result	spawnProcessInPseudoTerminal		(CFArrayRef, char const*, CFStringRef, UInt16, UInt16,
+													 My_TTYMasterID&, std::string&, pid_t&);
+void			startMonitoringChildProcess			(pid_t);
+Local_Result	startProcessDataLoop				(SessionRef, CFArrayRef, CFStringRef, My_TTYMasterID,
+													 char const*, pid_t);
 void*			threadForLocalProcessDataLoop		(void*);
-void			watchForExitsTimer					(EventLoopTimerRef, void*);
+
+Boolean			unitTest000_Begin					();
+int				unitTestSpawnAndWait				(My_SpawnMethod, CFArrayRef, CFAbsoluteTime&);
 
 } // anonymous namespace
 
@@ -174,31 +254,21 @@ struct termios				gCachedTerminalAttributes;
 MyTTYState					gTTYState = kMyTTYStateReset;
 Boolean						gInDebuggingMode = Local_StandardInputIsATerminal(); //!< true if terminal I/O is possible for debugging
 Boolean						gPrintedRawMode = false; //!< true after the first console dump of the raw-mode terminal configuration
+My_SpawnMethod				gSpawnMethod = kMy_SpawnMethodPosixSpawn; //!< changed only by tests
 
 //! used to help atexit() handlers know which terminal to touch
 Local_TerminalID			gTerminalToRestore = 0;
 My_UnixProcessIDSet&		gChildProcessIDs ()		{ static My_UnixProcessIDSet x; return x; }
+My_UnixProcessIDSet&		gUnreapedProcessIDs ()	{ static My_UnixProcessIDSet x; return x; } //!< every process spawned by this module that has not exited (see reapChildProcesses())
 My_ProcessByID&				gProcessesByID ()		{ static My_ProcessByID x; return x; }
-EventLoopTimerRef&			gExitWatchTimer ()
-							{
-								static EventLoopTimerRef	x = nullptr;
-								static EventLoopTimerUPP	upp = nullptr;
-								
-								
-								if (nullptr == x)
-								{
-									OSStatus	error = noErr;
-									
-									
-									upp = NewEventLoopTimerUPP(watchForExitsTimer);
-									error = InstallEventLoopTimer(GetCurrentEventLoop(),
-																	kEventDurationNoWait + 0.01/* start time; must be nonzero for Mac OS X 10.3 */,
-																	3 * kEventDurationSecond/* time between fires - arbitrary (what is best?) */,
-																	upp, nullptr/* user data */, &x);
-									assert_noerr(error);
-								}
-								return x;
-							}
+My_PreSpawnRequest&			gPreSpawnRequest ()		{ static My_PreSpawnRequest x; return x; }
+My_PreSpawnedProcessList&	gPreSpawnedProcesses ()	{ static My_PreSpawnedProcessList x; return x; }
+UInt16						gPreSpawnedProcessLimit = 0; //!< number of shells to keep ready; 0 turns off pre-spawning
+CFTimeInterval				gPreSpawnedProcessIdleTimeout = 600; //!< seconds that an unused pre-spawned shell is kept
+Boolean						gPreSpawnReplenishPending = false; //!< true if replenishPreSpawnedProcessesLater() has a pending block
+Boolean						gCurrentDirectoryQueryPending = false; //!< true while Local_UpdateCurrentDirectoryCache() is waiting for results
+int							gChildProcessEventQueue = -1; //!< kqueue() that receives all child process events; see startMonitoringChildProcess()
+dispatch_source_t			gChildProcessEventSource = nullptr; //!< invokes handleChildProcessEvents() on the main queue
 sigset_t&					gSignalsBlockedInThreads	(Boolean	inBlock = true)
 							{
 								// call this from the main thread, to prevent any other thread from being
@@ -237,6 +307,99 @@ sigset_t&					gSignalsBlockedInThreads	(Boolean	inBlock = true)
 
 #pragma mark Public Methods
 
+/*!
+Attempts to give the specified session a shell that was
+spawned ahead of time, instead of spawning a new process.
+This avoids both the cost of creating the process and the
+time the shell needs to run its startup scripts, so the
+new terminal is usable almost immediately.
+
+Only the user’s default shell is ever spawned ahead of time
+(see Local_GetDefaultShellCommandLine()); for any other command
+line, this does nothing and returns an error so that the caller
+spawns the process normally.  A pre-spawned shell is only used
+if it was created with the terminal type that is given here,
+and only if no particular working directory is requested
+(shells are spawned in the home directory).  If the terminal
+size differs, the pseudo-terminal is resized.
+
+Whenever this is called for the default shell (and pre-spawning
+is enabled; see Local_SetPreSpawnedProcessLimits()), the terminal
+type and size are remembered for future shells, and the set of
+waiting shells is replenished shortly afterwards.
+
+\retval kLocal_ResultOK
+if the session adopted a process successfully
+
+\retval kLocal_ResultNoPreSpawnedProcess
+if no suitable process is waiting, the command line is not the
+default shell, or pre-spawning is off; use Local_SpawnProcess()
+instead
+
+\retval kLocal_ResultParameterError
+if the argument array or terminal screen is missing
+
+\retval kLocal_ResultThreadError
+if a thread cannot be created to read data
+
+(2017.10)
+*/
+Local_Result
+Local_AdoptPreSpawnedProcess	(SessionRef			inUninitializedSession,
+								 TerminalScreenRef	inContainer,
+								 CFArrayRef			inArgumentArray,
+								 CFStringRef		inWorkingDirectoryOrNull)
+{
+	Local_Result	result = kLocal_ResultNoPreSpawnedProcess;
+	
+	
+	if ((nullptr == inArgumentArray) || (nullptr == inContainer))
+	{
+		result = kLocal_ResultParameterError;
+	}
+	else if ((gPreSpawnedProcessLimit > 0) && isDefaultShellCommandLine(inArgumentArray))
+	{
+		My_PreSpawnRequest&		request = gPreSpawnRequest();
+		
+		
+		// remember what new sessions look like, so that the
+		// right kind of shell is ready for the next session
+		request.commandLine.setWithRetain(inArgumentArray);
+		request.terminalName.setWithRetain(Terminal_EmulatorReturnName(inContainer));
+		request.columnCount = Terminal_ReturnColumnCount(inContainer);
+		request.rowCount = Terminal_ReturnRowCount(inContainer);
+		
+		// this also throws out any shells that no longer match the request
+		discardUnusablePreSpawnedProcesses();
+		
+		if (((nullptr == inWorkingDirectoryOrNull) || (0 == CFStringGetLength(inWorkingDirectoryOrNull))) &&
+			(false == gPreSpawnedProcesses().empty()))
+		{
+			My_PreSpawnedProcess	process = gPreSpawnedProcesses().front();
+			
+			
+			gPreSpawnedProcesses().erase(gPreSpawnedProcesses().begin());
+			
+			// the shell was started with the size of an earlier terminal
+			if ((process.request.columnCount != request.columnCount) ||
+				(process.request.rowCount != request.rowCount))
+			{
+				UNUSED_RETURN(Local_Result)Local_TerminalResize(process.masterTTY, request.columnCount, request.rowCount,
+																0/* pixel width; UNKNOWN */, 0/* pixel height; UNKNOWN */);
+			}
+			
+			result = startProcessDataLoop(inUninitializedSession, process.request.commandLine.returnCFArrayRef(),
+											process.workingDirectory.returnCFStringRef(), process.masterTTY,
+											process.slaveDeviceName.c_str(), process.processID);
+		}
+		
+		replenishPreSpawnedProcessesLater();
+	}
+	
+	return result;
+}// AdoptPreSpawnedProcess
+
+
 /*!
 Constructs a command line based on the current user’s
 preferred shell, or the "SHELL" environment variable if
@@ -374,9 +537,14 @@ Local_KillProcess	(Local_ProcessRef*	inoutRefPtr)
 
 /*!
 Returns true only if the terminal associated with the specified
-process is apparently waiting for password input.  This can be
-used to give the user some kind of special feedback, such as a
-different terminal cursor.
+process is apparently waiting for password input (that is, echo
+is off but input is still line-based).  This can be used to give
+the user some kind of special feedback, such as a different
+terminal cursor.
+
+This does not make any system calls: the value is updated as
+soon as new output from the process shows that the terminal
+mode has changed, and the session is notified at that time.
 
 (4.1)
 */
@@ -384,17 +552,8 @@ Boolean
 Local_ProcessIsInPasswordMode	(Local_ProcessRef	inProcess)
 {
 	My_ProcessAutoLocker	ptr(gProcessPtrLocks(), inProcess);
-	struct termios			terminalInfo;
-	int						callStatus = 0;
-	Boolean					result = false;
-	
+	Boolean					result = ptr->_passwordMode;
 	
-	callStatus = tcgetattr(ptr->_pseudoTerminal, &terminalInfo);
-	if (0 == callStatus)
-	{
-		// TEMPORARY; might need to check additional state here to avoid false positives
-		result = (0 != (terminalInfo.c_lflag & ICANON));
-	}
 	
 	return result;
 }// ProcessIsInPasswordMode
@@ -402,7 +561,8 @@ Local_ProcessIsInPasswordMode	(Local_ProcessRef	inProcess)
 
 /*!
 Returns true only if the specified process is currently
-stopped, as determined by this module’s periodic checks.
+stopped, as reported by the child process monitor (which
+also notifies the session when this changes).
 
 (4.0)
 */
@@ -439,17 +599,18 @@ Local_ProcessReturnCommandLine	(Local_ProcessRef	inProcess)
 
 
 /*!
-Returns the POSIX path of the directory that was current for the
-given process when Local_UpdateCurrentDirectoryCache() was most
-recently invoked.  The string can be decoded into a C string for
-use in low-level system calls.
+Returns the POSIX path of the directory that was most recently
+reported for the given process (see Local_ProcessSetCurrentDirectory())
+or found by Local_UpdateCurrentDirectoryCache().  The string
+can be decoded into a C string for use in low-level system calls.
 
 If the string is empty, it either means that no query was ever
 done, or that the query could not determine the value (for
 example, due to a permission issue or a failure to find some
 utility that is needed to perform the query).
 
-See also Local_ProcessReturnOriginalDirectory().
+See also Local_ProcessReturnCurrentDirectoryTime() and
+Local_ProcessReturnOriginalDirectory().
 
 (4.0)
 */
@@ -465,6 +626,44 @@ Local_ProcessReturnCurrentDirectory		(Local_ProcessRef	inProcess)
 }// ProcessReturnCurrentDirectory
 
 
+/*!
+Returns the time at which the value returned by
+Local_ProcessReturnCurrentDirectory() was last set, or 0 if
+it has never been set.
+
+(2017.10)
+*/
+CFAbsoluteTime
+Local_ProcessReturnCurrentDirectoryTime		(Local_ProcessRef	inProcess)
+{
+	My_ProcessAutoLocker	ptr(gProcessPtrLocks(), inProcess);
+	CFAbsoluteTime			result = 0;
+	
+	
+	result = ptr->_directoryTime;
+	return result;
+}// ProcessReturnCurrentDirectoryTime
+
+
+/*!
+Returns the ID of the process group that most recently owned
+the terminal of the given process (normally, the foreground
+job of a shell).  This does not make any system calls; the
+session is notified whenever the value changes.
+
+(2017.10)
+*/
+pid_t
+Local_ProcessReturnForegroundGroupID	(Local_ProcessRef	inProcess)
+{
+	My_ProcessAutoLocker	ptr(gProcessPtrLocks(), inProcess);
+	pid_t					result = ptr->_foregroundGroup;
+	
+	
+	return result;
+}// ProcessReturnForegroundGroupID
+
+
 /*!
 Returns the file descriptor of the pseudo-terminal device that
 is the master.  Data sent to this device will interact directly
@@ -528,7 +727,7 @@ Local_ProcessReturnSlaveDeviceName		(Local_ProcessRef	inProcess)
 	char const*				result = nullptr;
 	
 	
-	result = ptr->_slaveDeviceName;
+	result = ptr->_slaveDeviceName.c_str();
 	return result;
 }// ProcessReturnSlaveDeviceName
 
@@ -551,6 +750,144 @@ Local_ProcessReturnUnixID	(Local_ProcessRef	inProcess)
 }// ProcessReturnUnixID
 
 
+/*!
+Records the POSIX path of the current directory of the given
+process, as reported by the process itself (for instance, a
+shell can send “ESC]7;file://host/path” to the terminal before
+each prompt).  Once a process has reported its directory, it
+is skipped by Local_UpdateCurrentDirectoryCache() because the
+reports are both faster and more accurate; this lasts until
+the foreground process changes or the report becomes old.
+
+(2017.10)
+*/
+void
+Local_ProcessSetCurrentDirectory	(Local_ProcessRef	inProcess,
+									 CFStringRef		inPOSIXPath)
+{
+	My_ProcessAutoLocker	ptr(gProcessPtrLocks(), inProcess);
+	
+	
+	if ((nullptr != ptr) && (nullptr != inPOSIXPath))
+	{
+		ptr->_recentDirectory.setWithRetain(inPOSIXPath);
+		ptr->_directoryTime = CFAbsoluteTimeGetCurrent();
+		ptr->_directoryReported = true;
+	}
+}// ProcessSetCurrentDirectory
+
+
+/*!
+A microbenchmark for process creation: the average time
+taken to spawn a trivial process by each method, as the
+resident memory of this process grows.  The results are
+printed to the console.
+
+This is not part of Local_RunTests() because it takes a
+long time and temporarily makes the application use more
+than a gigabyte of memory; it is only run on request
+(from the Debugging panel).
+
+(2017.10)
+*/
+void
+Local_RunSpawnBenchmark ()
+{
+	CFStringRef		commandLine[] = { CFSTR("/usr/bin/true") };
+	CFRetainRelease	argumentArray(CFArrayCreate(kCFAllocatorDefault, REINTERPRET_CAST(commandLine, void const**),
+												sizeof(commandLine) / sizeof(CFStringRef), &kCFTypeArrayCallBacks),
+									CFRetainRelease::kAlreadyRetained);
+	UInt16 const	kIterationCount = 10;
+	size_t const	kGrowthSteps[] = { 0, 64, 256, 1024 }; // megabytes of extra resident memory
+	std::vector< std::vector< char > >	extraMemory;
+	size_t			extraMegabytes = 0;
+	
+	
+	for (size_t targetMegabytes : kGrowthSteps)
+	{
+		CFAbsoluteTime		totalTime[2] = { 0, 0 }; // fork, posix_spawn
+		
+		
+		// grow the process; the memory is written so that it is resident
+		if (targetMegabytes > extraMegabytes)
+		{
+			extraMemory.emplace_back((targetMegabytes - extraMegabytes) * 1024 * 1024, '\1');
+			extraMegabytes = targetMegabytes;
+		}
+		
+		for (UInt16 i = 0; i < kIterationCount; ++i)
+		{
+			CFAbsoluteTime		spawnTime = 0;
+			
+			
+			UNUSED_RETURN(Boolean)Console_Assert("fork() process exits normally",
+													0 == unitTestSpawnAndWait(kMy_SpawnMethodFork, argumentArray.returnCFArrayRef(), spawnTime));
+			totalTime[0] += spawnTime;
+			UNUSED_RETURN(Boolean)Console_Assert("posix_spawn() process exits normally",
+													0 == unitTestSpawnAndWait(kMy_SpawnMethodPosixSpawn, argumentArray.returnCFArrayRef(), spawnTime));
+			totalTime[1] += spawnTime;
+		}
+		
+		Console_WriteValue("spawn benchmark: extra resident megabytes", STATIC_CAST(extraMegabytes, SInt32));
+		Console_WriteValuePair("spawn benchmark: average microseconds for fork, posix_spawn",
+								STATIC_CAST(totalTime[0] * 1000000 / kIterationCount, SInt32),
+								STATIC_CAST(totalTime[1] * 1000000 / kIterationCount, SInt32));
+	}
+}// RunSpawnBenchmark
+
+
+/*!
+A unit test for this module.  This should always
+be run before a release, after any substantial
+changes are made, or if you suspect bugs!  It
+should also be EXPANDED as new functionality is
+proposed (ideally, a test is written before the
+functionality is added).
+
+See also Local_RunSpawnBenchmark().
+
+(2017.10)
+*/
+void
+Local_RunTests ()
+{
+	UInt16		totalTests = 0;
+	UInt16		failedTests = 0;
+	
+	
+	++totalTests; if (false == unitTest000_Begin()) ++failedTests;
+	
+	Console_WriteUnitTestReport("Local", failedTests, totalTests);
+}// RunTests
+
+
+/*!
+Configures the shells that are spawned ahead of time for use
+by Local_AdoptPreSpawnedProcess().  No more than the given
+number of shells are kept waiting, and any shell that waits
+longer than the given number of seconds is terminated (the
+set is only replenished when another session is created).
+
+A count of zero turns off pre-spawning, and terminates any
+shells that are currently waiting.
+
+(2017.10)
+*/
+void
+Local_SetPreSpawnedProcessLimits	(UInt16				inMaximumProcessCount,
+									 CFTimeInterval		inIdleTimeout)
+{
+	gPreSpawnedProcessLimit = inMaximumProcessCount;
+	gPreSpawnedProcessIdleTimeout = inIdleTimeout;
+	
+	while (gPreSpawnedProcesses().size() > gPreSpawnedProcessLimit)
+	{
+		discardPreSpawnedProcess(gPreSpawnedProcesses().back());
+		gPreSpawnedProcesses().pop_back();
+	}
+}// SetPreSpawnedProcessLimits
+
+
 /*!
 Forks a new process and arranges for its output and input to be
 channeled through the specified screen.  The Unix command line is
@@ -593,44 +930,12 @@ Local_SpawnProcess	(SessionRef			inUninitializedSession,
 					 CFStringRef		inWorkingDirectoryOrNull)
 {
 	CFStringEncoding const	kPathEncoding = kCFStringEncodingUTF8;
-	CFIndex const			kArgumentCount = CFArrayGetCount(inArgumentArray);
-	char**					argvCopy = new char*[1 + kArgumentCount];
 	char const*				targetDir = nullptr;
 	CFRetainRelease			targetDirCFString(inWorkingDirectoryOrNull, CFRetainRelease::kNotYetRetained);
 	Boolean					deleteTargetDir = false;
 	Local_Result			result = kLocal_ResultOK;
 	
 	
-	if (kArgumentCount > 0)
-	{					
-		// construct an argument array of the form expected by the system call
-		CFStringEncoding const	kArgumentEncoding = kCFStringEncodingUTF8;
-		UInt16					j = 0;
-		
-		
-		for (UInt16 i = 0; i < kArgumentCount; ++i)
-		{
-			CFStringRef		argumentCFString = CFUtilities_StringCast
-												(CFArrayGetValueAtIndex(inArgumentArray, i));
-			
-			
-			// ignore completely empty strings (generally caused by
-			// a bad split on multiple whitespace characters)
-			if (CFStringGetLength(argumentCFString) > 0)
-			{
-				size_t const	kBufferSize = 1 + CFStringGetMaximumSizeForEncoding
-													(CFStringGetLength(argumentCFString), kArgumentEncoding);
-				
-				
-				// this memory is not leaked because execvp() is about to occur
-				argvCopy[j] = new char[kBufferSize];
-				CFStringGetCString(argumentCFString, argvCopy[j], kBufferSize, kArgumentEncoding);
-				++j;
-			}
-		}
-		argvCopy[j] = nullptr;
-	}
-	
 	// determine the directory to be in when the command is run
 	if ((false == targetDirCFString.exists()) || (0 == CFStringGetLength(targetDirCFString.returnCFStringRef())))
 	{
@@ -699,277 +1004,70 @@ Local_SpawnProcess	(SessionRef			inUninitializedSession,
 		}
 	}
 	
-	if ((nullptr == inArgumentArray) || (kArgumentCount < 1) || (nullptr == argvCopy[0]))
+	if ((nullptr == inArgumentArray) || (CFArrayGetCount(inArgumentArray) < 1))
 	{
 		result = kLocal_ResultParameterError;
 	}
 	else if (kLocal_ResultOK == result)
 	{
 		My_TTYMasterID		masterTTY = 0;
-		char				slaveDeviceName[20/* arbitrary */];
+		std::string			slaveDeviceName;
 		pid_t				processID = -1;
-		struct termios		terminalControl;
 		
 		
-		// set the answer-back message
+		result = spawnProcessInPseudoTerminal(inArgumentArray, targetDir, Terminal_EmulatorReturnName(inContainer),
+												Terminal_ReturnColumnCount(inContainer), Terminal_ReturnRowCount(inContainer),
+												masterTTY, slaveDeviceName, processID);
+		if (kLocal_ResultOK == result)
 		{
-			CFStringRef		answerBackCFString = Terminal_EmulatorReturnName(inContainer);
-			
-			
-			if (nullptr != answerBackCFString)
-			{
-				size_t const	kAnswerBackSize = CFStringGetLength(answerBackCFString) + 1/* terminator */;
-				char*			answerBackCString = new char[kAnswerBackSize];
-				
-				
-				if (CFStringGetCString(answerBackCFString, answerBackCString, kAnswerBackSize, kCFStringEncodingASCII))
-				{
-					UNUSED_RETURN(int)setenv("TERM", answerBackCString, true/* overwrite */);
-				}
-				delete [] answerBackCString;
-			}
+			// start a thread for data processing so that MacTerm’s main event loop can still run
+			result = startProcessDataLoop(inUninitializedSession, inArgumentArray, targetDirCFString.returnCFStringRef(),
+											masterTTY, slaveDeviceName.c_str(), processID);
 		}
+	}
+	
+	if (deleteTargetDir)
+	{
+		delete [] targetDir, targetDir = nullptr;
+	}
+	
+	// with the preemptive thread handling data transfer
+	// to and from the process, return immediately
+	return result;
+}// SpawnProcess
+
+
+/*!
+A convenient way for other modules to call system()
+without including any Unix headers.
+
+\retval kLocal_ResultOK
+if the process was created successfully
+
+\retval kLocal_ResultParameterError
+if the command is nullptr
+
+\retval kLocal_ResultForkError
+if the process cannot be spawned
+
+(3.1)
+*/
+Local_Result
+Local_SpawnProcessAndWaitForTermination		(char const*	inCommand)
+{
+	Local_Result	result = kLocal_ResultOK;
+	
+	
+	if (nullptr == inCommand) result = kLocal_ResultParameterError;
+	else
+	{
+		int		commandResult = system(inCommand);
 		
-		// Apple’s Terminal sets the variables TERM_PROGRAM and
-		// TERM_PROGRAM_VERSION for some reason; it is possible
-		// that scripts could start to rely on these, so it seems
-		// harmless enough to set them correctly for MacTerm
-		{
-			CFBundleRef		mainBundle = AppResources_ReturnBundleForInfo();
-			CFStringRef		valueCFString = nullptr;
-			
-			
-			valueCFString = CFUtilities_StringCast
-							(CFBundleGetValueForInfoDictionaryKey(mainBundle, kCFBundleNameKey));
-			if (nullptr != valueCFString)
-			{
-				size_t const	kStringSize = CFStringGetLength(valueCFString) + 1/* terminator */;
-				char*			valueCString = new char[kStringSize];
-				
-				
-				if (CFStringGetCString(valueCFString, valueCString, kStringSize, kCFStringEncodingASCII))
-				{
-					UNUSED_RETURN(int)setenv("TERM_PROGRAM", valueCString, true/* overwrite */);
-				}
-				delete [] valueCString;
-			}
-			valueCFString = CFUtilities_StringCast
-							(CFBundleGetValueForInfoDictionaryKey(mainBundle, kCFBundleVersionKey));
-			if (nullptr != valueCFString)
-			{
-				size_t const	kStringSize = CFStringGetLength(valueCFString) + 1/* terminator */;
-				char*			valueCString = new char[kStringSize];
-				
-				
-				if (CFStringGetCString(valueCFString, valueCString, kStringSize, kCFStringEncodingASCII))
-				{
-					UNUSED_RETURN(int)setenv("TERM_PROGRAM_VERSION", valueCString, true/* overwrite */);
-				}
-				delete [] valueCString;
-			}
-		}
-		
-		// TEMPORARY - the UNIX structures are filled in with defaults that work,
-		//             but eventually MacTerm has to map user preferences, etc.
-		//             to these so that they affect “local” terminals in the same
-		//             way as they affect remote ones
-		std::memset(&terminalControl, 0, sizeof(terminalControl));
-		fillInTerminalControlStructure(&terminalControl); // TEMP
-		
-		// spawn a child process attached to a pseudo-terminal device; the child
-		// will be used to run the shell, and the shell’s I/O will be handled in
-		// a separate preemptive thread by MacTerm’s awesome terminal emulator
-		// and main event loop
-		{
-			struct winsize		terminalSize; // defined in "/usr/include/sys/ttycom.h"
-			
-			
-			terminalSize.ws_col = Terminal_ReturnColumnCount(inContainer);
-			terminalSize.ws_row = Terminal_ReturnRowCount(inContainer);
-			
-			// TEMPORARY; the TerminalView_GetTheoreticalScreenDimensions() API would be useful for this
-			terminalSize.ws_xpixel = 0;	// terminal width, in pixels; UNKNOWN
-			terminalSize.ws_ypixel = 0;	// terminal height, in pixels; UNKNOWN
-			
-			if (gInDebuggingMode && DebugInterface_LogsTeletypewriterState())
-			{
-				// in debugging mode, show the terminal configuration
-				Console_WriteLine("printing initial terminal configuration for process");
-				printTerminalControlStructure(&terminalControl);
-			}
-			
-			processID = forkpty(&masterTTY, slaveDeviceName, &terminalControl, &terminalSize);
-		}
-		
-		if (-1 == processID) result = kLocal_ResultForkError;
-		else
-		{
-			if (0 == processID)
-			{
-				//
-				// this is executed inside the child process; note that any
-				// console print-outs at this point will actually go to the
-				// child terminal (rendered by a MacTerm window!)
-				//
-				
-				// IMPORTANT: There are limitations on what a child process can do.
-				// For example, global data and framework calls are generally unsafe.
-				// See the "fork" man page for more information.
-				
-				// undo the effects on signals, because the user might be running
-				// a program like "bash" that inherits signal behavior from the
-				// parent; if this step were not performed, then "bash" would do
-				// odd things like ignore all control-C (interrupt) sequences
-				gSignalsBlockedInThreads(false);
-				
-				// set the current working directory...abort if this fails
-				// because presumably it is important that a command not
-				// start in the wrong directory
-				if (0 != chdir(targetDir))
-				{
-					Console_WriteValueCString("aborting, failed to chdir(), target directory", targetDir);
-					exit(EX_NOINPUT); // could abort(), but an exit() is easier to report gracefully to the user
-				}
-				
-				// run a Unix terminal-based application program; this is accomplished
-				// using an execvp() call, which DOES NOT RETURN UNLESS there is an
-				// error; technically the return value is -1 on error, but really it’s
-				// a problem if any return value is received, so never exit with a 0
-				// in this situation!
-				UNUSED_RETURN(int)execvp(argvCopy[0], argvCopy); // should not return
-				
-				// almost no chance this line will be run, but if it does, just kill the child process
-				Console_WriteLine("aborting, failed to exec()");
-				exit(EX_UNAVAILABLE); // could abort(), but an exit() is easier to report gracefully to the user
-			}
-			
-			//
-			// this is executed inside the parent process
-			//
-			
-			Console_WriteValue("spawned process ID", processID);
-			
-			// prevent threads from being the receivers of signals
-			gSignalsBlockedInThreads();
-			
-			// try to detect an immediately-failed process
-			gExitWatchTimer();
-			
-			// avoid special processing of data, allow the terminal to see it all (raw mode)
-			if (0)
-			{
-				// arrange for user’s TTY to be fixed at exit time
-				gTerminalToRestore = STDIN_FILENO;
-				if (-1 == atexit(putTTYInOriginalModeAtExit))
-				{
-					int const		kActualError = errno;
-					
-					
-					Console_Warning(Console_WriteValue, "unable to register atexit() routine for TTY mode", kActualError);
-				}
-				
-				// set user’s TTY to raw mode
-				{
-					Local_Result	rawSwitchResult = putTTYInRawMode(gTerminalToRestore);
-					
-					
-					if (kLocal_ResultOK != rawSwitchResult)
-					{
-						Console_Warning(Console_WriteValue, "error entering TTY raw-mode", rawSwitchResult);
-					}
-				}
-			}
-			
-			// start a thread for data processing so that MacTerm’s main event loop can still run
-			{
-				pthread_attr_t	attr;
-				int				error = 0;
-				
-				
-				error = pthread_attr_init(&attr);
-				if (0 != error) result = kLocal_ResultThreadError;
-				else
-				{
-					My_DataLoopThreadContextPtr		threadContextPtr = nullptr;
-					pthread_t						thread;
-					
-					
-					// store process information for session
-					{
-						My_Process*			newProcessPtr = new My_Process(inArgumentArray,
-																			targetDirCFString.returnCFStringRef(),
-																			masterTTY, slaveDeviceName, processID);
-						Local_ProcessRef	newProcess = REINTERPRET_CAST(newProcessPtr, Local_ProcessRef);
-						
-						
-						Session_SetProcess(inUninitializedSession, newProcess);
-					}
-					threadContextPtr = REINTERPRET_CAST(Memory_NewPtrInterruptSafe(sizeof(My_DataLoopThreadContext)),
-														My_DataLoopThreadContextPtr);
-					if (nullptr == threadContextPtr) result = kLocal_ResultThreadError;
-					else
-					{
-						// set up context
-						threadContextPtr->eventQueue = nullptr; // set inside the handler
-						threadContextPtr->session = inUninitializedSession;
-						threadContextPtr->masterTTY = masterTTY;
-						
-						// create thread
-						error = pthread_create(&thread, &attr, threadForLocalProcessDataLoop, threadContextPtr);
-						if (0 != error) result = kLocal_ResultThreadError;
-					}
-					
-					// put the session in the initialized state, to indicate it is complete
-					Session_SetState(inUninitializedSession, kSession_StateInitialized);
-				}
-			}
-		}
-	}
-	
-	// WARNING: this cleanup is not exception-safe, and should change
-	delete [] argvCopy, argvCopy = nullptr;
-	if (deleteTargetDir)
-	{
-		delete [] targetDir, targetDir = nullptr;
-	}
-	
-	// with the preemptive thread handling data transfer
-	// to and from the process, return immediately
-	return result;
-}// SpawnProcess
-
-
-/*!
-A convenient way for other modules to call system()
-without including any Unix headers.
-
-\retval kLocal_ResultOK
-if the process was created successfully
-
-\retval kLocal_ResultParameterError
-if the command is nullptr
-
-\retval kLocal_ResultForkError
-if the process cannot be spawned
-
-(3.1)
-*/
-Local_Result
-Local_SpawnProcessAndWaitForTermination		(char const*	inCommand)
-{
-	Local_Result	result = kLocal_ResultOK;
-	
-	
-	if (nullptr == inCommand) result = kLocal_ResultParameterError;
-	else
-	{
-		int		commandResult = system(inCommand);
-		
-		
-		// the result will be 127 if a shell cannot be invoked;
-		// any nonzero value is an error of some kind, as defined
-		// by the shell that is run
-		if (0 != commandResult)
+		
+		// the result will be 127 if a shell cannot be invoked;
+		// any nonzero value is an error of some kind, as defined
+		// by the shell that is run
+		if (0 != commandResult)
 		{
 			result = kLocal_ResultForkError;
 		}
@@ -1253,65 +1351,112 @@ Local_TerminalWriteBytes	(int			inFileDescriptor,
 
 
 /*!
-For each known child process, updates a cache of current working
-directories.  The cached values can be returned by invoking the
-Local_ProcessReturnCurrentDirectory() function.
-
-NOTE:	This routine is not fast because it calls out to Python
-		code that in turn runs the "lsof" program.  This approach
-		is a bit weird but it does work on all Mac OS X versions.
-		Also, because Python is the ultimate caller, Python code
-		can be used to easily post-process the output.  The cost
-		of the call is offset by doing it rarely and by pulling
-		results for every process at the same time.
+For each known child process that has not reported its own
+directory (see Local_ProcessSetCurrentDirectory()), updates a
+cache of current working directories.  The cached values can
+be returned by invoking Local_ProcessReturnCurrentDirectory().
+
+This is incremental: a process is only queried again if the
+foreground process group of its terminal has changed since
+the last query, or if its cached value is old.  A process
+whose directory could not be found is never queried again
+(the result would not change, and it is expensive to find
+out through "lsof"); its terminal is only queried after a
+different process is in the foreground.  The query itself
+runs on a background queue (using proc_pidinfo()) and the
+cache is updated later on the main queue, so this returns
+immediately.  If a call is made while a previous query is
+still running, it has no effect.
+
+This is invoked automatically whenever the foreground process
+of a terminal changes, and by Session_ReturnCachedWorkingDirectory()
+so that old values are eventually refreshed.
+
+NOTE:	Processes that cannot be examined directly are given to
+		the "lsof" program, on the same background queue.
+		That part is slow, but it only applies to failures.
 
 (4.0)
 */
 void
 Local_UpdateCurrentDirectoryCache ()
 {
-	typedef std::map< long, std::string >	StringByLong;
-	// make a copy of the internal map; the global map intentionally has NO VALUES
-	// and is used as a convenient way to store keys, but the copy will have the
-	// values filled in with whatever directories were found
-	std::vector< long >				processIDs;
-	StringByLong					pathsByProcess;
-	
-	
-	// find the Unix process IDs for every known child process
-	for (auto idProcessRefPair : gProcessesByID())
-	{
-		processIDs.push_back(idProcessRefPair.first);
-	}
-	
-	// in a SINGLE query, find ALL requested process’ directories
-	try
-	{
-		pathsByProcess = Quills::Session::pids_cwds(processIDs);
-	}
-	catch (std::exception const&	inException)
-	{
-		Console_Warning(Console_WriteValueCString, "exception during lookup of process working directory", inException.what());
-	}
-	
-	// now update all cached strings with the results
-	for (auto longStrPair : pathsByProcess)
+	unless (gCurrentDirectoryQueryPending)
 	{
-		auto	toProcessByID = gProcessesByID().find(STATIC_CAST(longStrPair.first, pid_t));
+		// keys are the processes to examine (usually in the foreground)
+		// and values are the session processes that receive the results
+		std::map< pid_t, pid_t >	sessionProcessByQueriedProcess;
+		CFAbsoluteTime const		kNow = CFAbsoluteTimeGetCurrent();
 		
 		
-		if (gProcessesByID().end() != toProcessByID)
+		for (auto idProcessRefPair : gProcessesByID())
 		{
-			Local_ProcessRef		ref = toProcessByID->second;
-			My_ProcessAutoLocker	ptr(gProcessPtrLocks(), ref);
+			My_ProcessAutoLocker	ptr(gProcessPtrLocks(), idProcessRefPair.second);
 			
 			
 			if (nullptr != ptr)
 			{
-				ptr->_recentDirectory.setWithNoRetain(CFStringCreateWithCString(kCFAllocatorDefault, longStrPair.second.c_str(),
-																				kCFStringEncodingUTF8));
+				pid_t const		kForegroundGroup = tcgetpgrp(ptr->_pseudoTerminal);
+				pid_t const		kQueriedProcessID = (kForegroundGroup > 0) ? kForegroundGroup : ptr->_processID;
+				
+				
+				// a reported directory is only trusted for a while, because
+				// the shell that reported it might have been replaced (see
+				// also receiveTerminalStateChange(), which resets the flag
+				// when the foreground process changes)
+				if ((kNow - ptr->_directoryTime) > kMy_CurrentDirectoryQueryMaximumAge)
+				{
+					ptr->_directoryReported = false;
+				}
+				
+				if ((false == ptr->_directoryReported) && (kQueriedProcessID != ptr->_directoryUnresolvedID) &&
+					((kForegroundGroup != ptr->_directoryGroup) ||
+						((kNow - ptr->_directoryTime) > kMy_CurrentDirectoryQueryMaximumAge)))
+				{
+					ptr->_directoryGroup = kForegroundGroup;
+					sessionProcessByQueriedProcess[kQueriedProcessID] = ptr->_processID;
+				}
 			}
 		}
+		
+		if (false == sessionProcessByQueriedProcess.empty())
+		{
+			gCurrentDirectoryQueryPending = true;
+			dispatch_async(dispatch_get_global_queue(DISPATCH_QUEUE_PRIORITY_LOW, 0/* flags */),
+			^{
+				std::map< pid_t, std::string >	pathsByQueriedProcess;
+				std::vector< pid_t >			unresolvedProcessIDs;
+				
+				
+				for (auto queriedSessionPair : sessionProcessByQueriedProcess)
+				{
+					struct proc_vnodepathinfo	vnodeInfo;
+					int							byteCount = proc_pidinfo(queriedSessionPair.first, PROC_PIDVNODEPATHINFO, 0/* argument */,
+																			&vnodeInfo, sizeof(vnodeInfo));
+					
+					
+					if (sizeof(vnodeInfo) == byteCount)
+					{
+						pathsByQueriedProcess[queriedSessionPair.first] = vnodeInfo.pvi_cdir.vip_path;
+					}
+					else
+					{
+						unresolvedProcessIDs.push_back(queriedSessionPair.first);
+					}
+				}
+				
+				// in a SINGLE query, find ALL remaining process’ directories
+				if (false == unresolvedProcessIDs.empty())
+				{
+					findDirectoriesUsingLsof(unresolvedProcessIDs, pathsByQueriedProcess);
+				}
+				
+				dispatch_async(dispatch_get_main_queue(),
+				^{
+					finishCurrentDirectoryQuery(sessionProcessByQueriedProcess, pathsByQueriedProcess);
+				});
+			});
+		}
 	}
 }// UpdateCurrentDirectoryCache
 
@@ -1320,7 +1465,8 @@ Local_UpdateCurrentDirectoryCache ()
 namespace {
 
 My_Process::
-My_Process	(CFArrayRef			inArgumentArray,
+My_Process	(SessionRef			inSession,
+			 CFArrayRef			inArgumentArray,
 			 CFStringRef		inWorkingDirectory,
 			 Local_TerminalID	inMasterTerminal,
 			 char const*		inSlaveDeviceName,
@@ -1333,7 +1479,14 @@ _pseudoTerminal(inMasterTerminal),
 _slaveDeviceName(inSlaveDeviceName),
 _commandLine(inArgumentArray, CFRetainRelease::kNotYetRetained),
 _recentDirectory(CFSTR(""), CFRetainRelease::kNotYetRetained),
-_originalDirectory(inWorkingDirectory, CFRetainRelease::kNotYetRetained)
+_originalDirectory(inWorkingDirectory, CFRetainRelease::kNotYetRetained),
+_directoryTime(0),
+_directoryGroup(-1),
+_directoryReported(false),
+_directoryUnresolvedID(0),
+_session(inSession),
+_foregroundGroup(inProcessID),
+_passwordMode(false)
 {
 #if 0
 	Console_WriteLine("process created with argument array:");
@@ -1355,34 +1508,244 @@ My_Process::
 
 
 /*!
-Fills in a UNIX "termios" structure using information
-that MacTerm provides about the environment.  Valid
-flag values are typically in "/usr/include/sys/termios.h"
-and defaults are in "/usr/include/sys/ttydefaults.h".
+Terminates a shell that was spawned ahead of time.  This
+does not remove the process from the list.
 
-(3.0)
+(2017.10)
 */
 void
-fillInTerminalControlStructure	(struct termios*	outTerminalControlPtr)
+discardPreSpawnedProcess	(My_PreSpawnedProcess&		inoutProcess)
 {
-	tcflag_t*	inputFlagsPtr = &outTerminalControlPtr->c_iflag;
-	tcflag_t*	outputFlagsPtr = &outTerminalControlPtr->c_oflag;
-	tcflag_t*	hardwareControlFlagsPtr = &outTerminalControlPtr->c_cflag;
-	tcflag_t*	localFlagsPtr = &outTerminalControlPtr->c_lflag;
-	cc_t*		controlCharacterArray = outTerminalControlPtr->c_cc;
-	speed_t*	inputSpeedPtr = &outTerminalControlPtr->c_ispeed;
-	speed_t*	outputSpeedPtr = &outTerminalControlPtr->c_ospeed;
-	
+	// closing the master side also hangs up the terminal; the
+	// process will be reaped by reapChildProcesses() (which does
+	// not need the ID stored here; see gUnreapedProcessIDs())
+	if (inoutProcess.masterTTY >= 0)
+	{
+		UNUSED_RETURN(int)close(inoutProcess.masterTTY);
+		inoutProcess.masterTTY = kLocal_InvalidTerminalID;
+	}
+	if (inoutProcess.processID > 0)
+	{
+		UNUSED_RETURN(int)kill(inoutProcess.processID, SIGHUP);
+		inoutProcess.processID = -1;
+	}
+}// discardPreSpawnedProcess
+
+
+/*!
+Terminates and removes any shell in the list of pre-spawned
+processes that can no longer be used: because it has exited,
+because it has been waiting longer than the idle timeout, or
+because it does not match the command line and terminal type
+that new sessions currently use.
+
+(2017.10)
+*/
+void
+discardUnusablePreSpawnedProcesses ()
+{
+	My_PreSpawnRequest&			request = gPreSpawnRequest();
+	My_PreSpawnedProcessList&	processList = gPreSpawnedProcesses();
+	CFAbsoluteTime const		kNow = CFAbsoluteTimeGetCurrent();
 	
-	//
-	// Set the same default values used by Mac OS X’s Terminal.app for STDIN;
-	// subtracting '@' from a capital letter gives its control character in
-	// ASCII (e.g. 'D' - '@' yields control-D).
-	//
-	// On Mac OS X you can use "man termios" to find out what all of this does.
-	//
 	
-	// Turn ON the following input mode flags:
+	for (auto toProcess = processList.begin(); toProcess != processList.end(); )
+	{
+		My_PreSpawnedProcess&	process = *toProcess;
+		Boolean					isUnusable = false;
+		
+		
+		if ((kNow - process.spawnTime) > gPreSpawnedProcessIdleTimeout)
+		{
+			isUnusable = true;
+		}
+		else if (0 != kill(process.processID, 0/* only check for existence */))
+		{
+			isUnusable = true;
+		}
+		else if (process.request.commandLine != request.commandLine)
+		{
+			isUnusable = true;
+		}
+		else if (process.request.terminalName.exists() != request.terminalName.exists())
+		{
+			isUnusable = true;
+		}
+		else if ((request.terminalName.exists()) && (process.request.terminalName != request.terminalName))
+		{
+			isUnusable = true;
+		}
+		
+		if (isUnusable)
+		{
+			discardPreSpawnedProcess(process);
+			toProcess = processList.erase(toProcess);
+		}
+		else
+		{
+			++toProcess;
+		}
+	}
+}// discardUnusablePreSpawnedProcesses
+
+
+/*!
+Runs the "lsof" program to find the current working directories
+of the given processes, and adds each one that is found to the
+given map.  This is slow (which is why all processes are given
+at once), so it is only used for processes that proc_pidinfo()
+could not examine.
+
+IMPORTANT:	This blocks until "lsof" exits, so call it only
+			from a background queue.
+
+(2017.10)
+*/
+void
+findDirectoriesUsingLsof	(std::vector< pid_t > const&		inProcessIDs,
+							 std::map< pid_t, std::string >&	inoutPathsByProcess)
+{
+	std::string		commandLine = "/usr/sbin/lsof -a -d cwd -Fn";
+	FILE*			outputStream = nullptr;
+	
+	
+	for (auto processID : inProcessIDs)
+	{
+		commandLine += " -p ";
+		commandLine += std::to_string(processID);
+	}
+	
+	// allow nonzero exits; if ANY of the given processes does not
+	// return something, the others might still return valid data
+	outputStream = popen(commandLine.c_str(), "r");
+	if (nullptr == outputStream)
+	{
+		Console_Warning(Console_WriteValue, "unable to run lsof for process working directories; errno", errno);
+	}
+	else
+	{
+		char	lineBuffer[PATH_MAX + 2/* type prefix and new-line */];
+		pid_t	processID = -1;
+		
+		
+		// each line of output has a single letter type prefix; the
+		// first should be a line with, e.g. "p12345" (process ID);
+		// a later one should be the directory, e.g. "n/some/path"
+		while (nullptr != std::fgets(lineBuffer, sizeof(lineBuffer), outputStream))
+		{
+			std::string		line(lineBuffer);
+			
+			
+			if ((false == line.empty()) && ('\n' == line.back()))
+			{
+				line.pop_back();
+			}
+			
+			if ((line.size() > 1) && ('p' == line[0]))
+			{
+				processID = STATIC_CAST(std::strtol(line.c_str() + 1, nullptr, 10), pid_t);
+			}
+			else if ((line.size() > 1) && ('n' == line[0]) && (processID > 0))
+			{
+				inoutPathsByProcess[processID] = line.substr(1);
+				processID = -1;
+			}
+		}
+		UNUSED_RETURN(int)pclose(outputStream);
+	}
+}// findDirectoriesUsingLsof
+
+
+/*!
+Completes Local_UpdateCurrentDirectoryCache() on the main queue
+by storing each directory found by the background query in the
+corresponding session process.  Processes that could not be
+examined are remembered, so that they are not queried again.
+
+(2017.10)
+*/
+void
+finishCurrentDirectoryQuery		(std::map< pid_t, pid_t > const&			inSessionProcessByQueriedProcess,
+								 std::map< pid_t, std::string > const&		inPathsByQueriedProcess)
+{
+	auto					storeDirectory = [](pid_t					inSessionProcessID,
+												pid_t					inQueriedProcessID,
+												std::string const*		inPathOrNull)
+							{
+								auto	toProcessByID = gProcessesByID().find(inSessionProcessID);
+								
+								
+								// the process may have exited while the query ran
+								if (gProcessesByID().end() != toProcessByID)
+								{
+									My_ProcessAutoLocker	ptr(gProcessPtrLocks(), toProcessByID->second);
+									
+									
+									if ((nullptr != ptr) && (nullptr == inPathOrNull))
+									{
+										// this process will not be queried again
+										ptr->_directoryUnresolvedID = inQueriedProcessID;
+									}
+									else if (nullptr != ptr)
+									{
+										ptr->_directoryUnresolvedID = 0;
+										
+										// a directory reported in the meantime is more accurate
+										unless (ptr->_directoryReported)
+										{
+											ptr->_recentDirectory.setWithNoRetain(CFStringCreateWithCString(kCFAllocatorDefault, inPathOrNull->c_str(),
+																											kCFStringEncodingUTF8));
+											ptr->_directoryTime = CFAbsoluteTimeGetCurrent();
+										}
+									}
+								}
+							};
+	
+	
+	gCurrentDirectoryQueryPending = false;
+	
+	for (auto queriedSessionPair : inSessionProcessByQueriedProcess)
+	{
+		auto	toPath = inPathsByQueriedProcess.find(queriedSessionPair.first);
+		
+		
+		// processes that could not be examined keep their previous values,
+		// and are not examined again while they are in the foreground
+		storeDirectory(queriedSessionPair.second, queriedSessionPair.first,
+						(inPathsByQueriedProcess.end() != toPath) ? &(toPath->second) : nullptr);
+	}
+}// finishCurrentDirectoryQuery
+
+
+/*!
+Fills in a UNIX "termios" structure using information
+that MacTerm provides about the environment.  Valid
+flag values are typically in "/usr/include/sys/termios.h"
+and defaults are in "/usr/include/sys/ttydefaults.h".
+
+(3.0)
+*/
+void
+fillInTerminalControlStructure	(struct termios*	outTerminalControlPtr)
+{
+	tcflag_t*	inputFlagsPtr = &outTerminalControlPtr->c_iflag;
+	tcflag_t*	outputFlagsPtr = &outTerminalControlPtr->c_oflag;
+	tcflag_t*	hardwareControlFlagsPtr = &outTerminalControlPtr->c_cflag;
+	tcflag_t*	localFlagsPtr = &outTerminalControlPtr->c_lflag;
+	cc_t*		controlCharacterArray = outTerminalControlPtr->c_cc;
+	speed_t*	inputSpeedPtr = &outTerminalControlPtr->c_ispeed;
+	speed_t*	outputSpeedPtr = &outTerminalControlPtr->c_ospeed;
+	
+	
+	//
+	// Set the same default values used by Mac OS X’s Terminal.app for STDIN;
+	// subtracting '@' from a capital letter gives its control character in
+	// ASCII (e.g. 'D' - '@' yields control-D).
+	//
+	// On Mac OS X you can use "man termios" to find out what all of this does.
+	//
+	
+	// Turn ON the following input mode flags:
 	//
 	// - BRKINT means that a sufficiently long string of zeroes will be
 	//   interpreted automatically as an interrupt-process signal.
@@ -1471,6 +1834,228 @@ fillInTerminalControlStructure	(struct termios*	outTerminalControlPtr)
 }// fillInTerminalControlStructure
 
 
+/*!
+Invoked on the main queue whenever the queue created by
+startMonitoringChildProcess() has events.  The events only
+indicate that something happened to a child process, so
+this drains them and then uses reapChildProcesses() to
+find out what happened.
+
+(2017.10)
+*/
+void
+handleChildProcessEvents ()
+{
+	struct kevent			eventList[16/* arbitrary; any remaining events trigger another call */];
+	struct timespec const	kNoWait = { 0, 0 };
+	int						eventCount = kevent(gChildProcessEventQueue, nullptr/* changes */, 0/* change count */,
+												eventList, sizeof(eventList) / sizeof(struct kevent), &kNoWait);
+	
+	
+	if (-1 == eventCount)
+	{
+		int const	kActualError = errno;
+		
+		
+		Console_Warning(Console_WriteValue, "failed to read child process events, errno", kActualError);
+	}
+	
+	reapChildProcesses();
+}// handleChildProcessEvents
+
+
+/*!
+Returns true only if the given command line is exactly the
+one that Local_GetDefaultShellCommandLine() constructs.  Only
+such command lines are spawned ahead of time.
+
+(2017.10)
+*/
+Boolean
+isDefaultShellCommandLine	(CFArrayRef		inArgumentArray)
+{
+	CFArrayRef	defaultCommandLine = nullptr;
+	Boolean		result = false;
+	
+	
+	if (kLocal_ResultOK == Local_GetDefaultShellCommandLine(defaultCommandLine))
+	{
+		result = CFEqual(defaultCommandLine, inArgumentArray);
+		CFRelease(defaultCommandLine), defaultCommandLine = nullptr;
+	}
+	return result;
+}// isDefaultShellCommandLine
+
+
+/*!
+Spawns a process attached to a new pseudo-terminal using
+posix_spawn(), which (unlike fork()) does not have to copy
+the page tables of this large, multi-threaded process.  The
+result should be indistinguishable from the forkpty() path
+in spawnProcessInPseudoTerminal(): the child is a session
+leader whose controlling terminal, standard input, output
+and error are the slave device, it starts in the given
+directory with signals unblocked, and it inherits the
+current environment (including TERM).
+
+The slave device name buffer must be large enough for any
+name returned by openpty().
+
+Returns the new process ID; or, -1 if the process could not
+be spawned this way, in which case the caller should use
+forkpty() instead.
+
+(2017.10)
+*/
+pid_t
+posixSpawnInPseudoTerminal	(char* const*		inArgv,
+							 char const*		inWorkingDirectory,
+							 struct termios*	inTerminalControlPtr,
+							 struct winsize*	inTerminalSizePtr,
+							 My_TTYMasterID&	outMasterTTY,
+							 char*				outSlaveDeviceName)
+{
+	pid_t		result = -1;
+	
+	
+#if defined(POSIX_SPAWN_SETSID) && defined(POSIX_SPAWN_CLOEXEC_DEFAULT)
+	// posix_spawn_file_actions_addchdir_np() is weak-linked
+	// because it is not available on older systems
+	if (nullptr != &posix_spawn_file_actions_addchdir_np)
+	{
+		My_TTYMasterID		masterTTY = kLocal_InvalidTerminalID;
+		My_TTYSlaveID		slaveTTY = kLocal_InvalidTerminalID;
+		
+		
+		if (0 != openpty(&masterTTY, &slaveTTY, outSlaveDeviceName, inTerminalControlPtr, inTerminalSizePtr))
+		{
+			int const	kActualError = errno;
+			
+			
+			Console_Warning(Console_WriteValue, "openpty() failed, errno", kActualError);
+		}
+		else
+		{
+			posix_spawn_file_actions_t	fileActions;
+			posix_spawnattr_t			attributes;
+			sigset_t					noSignals;
+			int							error = 0;
+			
+			
+			UNUSED_RETURN(int)posix_spawn_file_actions_init(&fileActions);
+			UNUSED_RETURN(int)posix_spawnattr_init(&attributes);
+			
+			// the equivalent of setsid() and of undoing gSignalsBlockedInThreads()
+			// in a forked child; all other file descriptors are closed, which is
+			// more than forkpty() does but the child has no use for them anyway
+			sigemptyset(&noSignals);
+			UNUSED_RETURN(int)posix_spawnattr_setsigmask(&attributes, &noSignals);
+			UNUSED_RETURN(int)posix_spawnattr_setflags(&attributes, POSIX_SPAWN_SETSID | POSIX_SPAWN_SETSIGMASK |
+																		POSIX_SPAWN_CLOEXEC_DEFAULT);
+			
+			// opening the slave device from the new session leader (without
+			// O_NOCTTY) makes it the controlling terminal, as login_tty()
+			// would do; then it becomes standard input, output and error
+			UNUSED_RETURN(int)posix_spawn_file_actions_addopen(&fileActions, STDIN_FILENO, outSlaveDeviceName, O_RDWR, 0);
+			UNUSED_RETURN(int)posix_spawn_file_actions_adddup2(&fileActions, STDIN_FILENO, STDOUT_FILENO);
+			UNUSED_RETURN(int)posix_spawn_file_actions_adddup2(&fileActions, STDIN_FILENO, STDERR_FILENO);
+			UNUSED_RETURN(int)posix_spawn_file_actions_addchdir_np(&fileActions, inWorkingDirectory);
+			
+			error = posix_spawnp(&result, inArgv[0], &fileActions, &attributes, inArgv, *_NSGetEnviron());
+			if (0 != error)
+			{
+				Console_Warning(Console_WriteValue, "posix_spawnp() failed, error", error);
+				result = -1;
+			}
+			
+			UNUSED_RETURN(int)posix_spawnattr_destroy(&attributes);
+			UNUSED_RETURN(int)posix_spawn_file_actions_destroy(&fileActions);
+			
+			// the parent only needs the master side
+			UNUSED_RETURN(int)close(slaveTTY);
+			if (-1 == result)
+			{
+				UNUSED_RETURN(int)close(masterTTY);
+			}
+			else
+			{
+				outMasterTTY = masterTTY;
+			}
+		}
+	}
+#else
+#	pragma unused(inArgv, inWorkingDirectory, inTerminalControlPtr, inTerminalSizePtr, outMasterTTY, outSlaveDeviceName)
+#endif
+	
+	return result;
+}// posixSpawnInPseudoTerminal
+
+
+/*!
+Spawns one shell ahead of time, according to the most recent
+request (see Local_AdoptPreSpawnedProcess()), and adds it to
+the list of waiting processes.  The command line is found
+again each time, so that only the user’s current default
+shell is ever spawned this way.
+
+\retval kLocal_ResultOK
+if the process was created successfully
+
+\retval kLocal_ResultParameterError
+if there is no request yet, no default shell or no home
+directory
+
+\retval kLocal_ResultForkError
+if the process cannot be spawned
+
+(2017.10)
+*/
+Local_Result
+preSpawnProcess ()
+{
+	My_PreSpawnRequest const&	kRequest = gPreSpawnRequest();
+	struct passwd*				userInfoPtr = getpwuid(getuid());
+	char const*					homeDir = (nullptr != userInfoPtr) ? userInfoPtr->pw_dir : getenv("HOME");
+	CFArrayRef					defaultCommandLine = nullptr;
+	Local_Result				result = kLocal_ResultOK;
+	
+	
+	if ((false == kRequest.commandLine.exists()) || (nullptr == homeDir) ||
+		(kLocal_ResultOK != Local_GetDefaultShellCommandLine(defaultCommandLine)))
+	{
+		result = kLocal_ResultParameterError;
+	}
+	else
+	{
+		CFRetainRelease			defaultCommandLineObject(defaultCommandLine, CFRetainRelease::kAlreadyRetained);
+		My_PreSpawnedProcess	process;
+		
+		
+		result = spawnProcessInPseudoTerminal(defaultCommandLine, homeDir,
+												kRequest.terminalName.returnCFStringRef(),
+												kRequest.columnCount, kRequest.rowCount,
+												process.masterTTY, process.slaveDeviceName, process.processID);
+		if (kLocal_ResultOK == result)
+		{
+			process.request = kRequest;
+			process.request.commandLine.setWithRetain(defaultCommandLine);
+			process.workingDirectory.setWithNoRetain(CFStringCreateWithCString(kCFAllocatorDefault, homeDir, kCFStringEncodingUTF8));
+			process.spawnTime = CFAbsoluteTimeGetCurrent();
+			gPreSpawnedProcesses().push_back(process);
+			
+			// there is no longer a periodic timer to notice idle shells
+			dispatch_after(dispatch_time(DISPATCH_TIME_NOW, STATIC_CAST((gPreSpawnedProcessIdleTimeout + 1.0) * NSEC_PER_SEC, int64_t)),
+							dispatch_get_main_queue(),
+			^{
+				discardUnusablePreSpawnedProcesses();
+			});
+		}
+	}
+	
+	return result;
+}// preSpawnProcess
+
+
 /*!
 For debugging - prints the data in a UNIX "termios"
 structure.
@@ -1714,6 +2299,79 @@ putTTYInRawMode		(Local_TerminalID		inTTY)
 }// putTTYInRawMode
 
 
+/*!
+Collects the status of every child process that has exited,
+stopped or continued since the last call.  Exits are given
+to reportProcessExit(), and stops update the state of the
+process (notifying its session).
+
+Only processes spawned by this module are examined (see
+gUnreapedProcessIDs()); this includes sessions that have
+already been destroyed and shells that were spawned ahead of
+time, whether or not they were discarded.  Other children of
+the application (such as those of popen()) are left for the
+code that started them to wait for.
+
+This is only called in response to events from the queue
+created by startMonitoringChildProcess(), never periodically.
+
+(2017.10)
+*/
+void
+reapChildProcesses ()
+{
+	// copy the set, since exits are removed from it
+	My_UnixProcessIDSet const	kProcessIDs = gUnreapedProcessIDs();
+	
+	
+	for (auto processID : kProcessIDs)
+	{
+		int		currentStatus = 0;
+		pid_t	waitResult = 0;
+		
+		
+		while ((waitResult = waitpid(processID, &currentStatus, WNOHANG | WUNTRACED | WCONTINUED)) > 0)
+		{
+			if (WIFSTOPPED(currentStatus) || WIFCONTINUED(currentStatus))
+			{
+				auto	toProcess = gProcessesByID().find(waitResult);
+				
+				
+				if (gProcessesByID().end() != toProcess)
+				{
+					SessionRef		session = nullptr;
+					
+					
+					{
+						My_ProcessAutoLocker	ptr(gProcessPtrLocks(), toProcess->second);
+						
+						
+						ptr->_stopped = WIFSTOPPED(currentStatus);
+						session = ptr->_session;
+					}
+					Session_ProcessStateChanged(session, false/* foreground changed */);
+				}
+			}
+			else
+			{
+				gUnreapedProcessIDs().erase(waitResult);
+				reportProcessExit(waitResult, currentStatus);
+			}
+		}
+		
+		if ((-1 == waitResult) && (ECHILD == errno))
+		{
+			// somehow already collected; stop looking for it
+			gUnreapedProcessIDs().erase(processID);
+		}
+	}
+	
+	// this is also a convenient time to terminate any shells
+	// that were spawned ahead of time and were never used
+	discardUnusablePreSpawnedProcesses();
+}// reapChildProcesses
+
+
 /*!
 Responds to certain signals by simply absorbing them.
 
@@ -1743,36 +2401,763 @@ receiveSignal	(int	UNUSED_ARGUMENT(inSignal))
 
 
 /*!
-Internal version of Local_TerminalResize().
-
-IMPORTANT:	This function is called within the child
-			portion of a fork, which limits its behavior!
+Invoked on the main queue by threadForLocalProcessDataLoop()
+when it sees that the foreground process group or the echo
+mode of a terminal has changed.  This updates the state of
+the process and notifies its session, so that nothing has to
+check the terminal periodically.
 
-\retval kLocal_ResultOK
-if the message is sent successfully
-
-\retval kLocal_ResultIOControlError
-if the message could not be sent
-
-(3.0)
+(2017.10)
 */
-Local_Result
-sendTerminalResizeMessage   (Local_TerminalID			inTTY,
-							 struct winsize const*		inTerminalSizePtr)
+void
+receiveTerminalStateChange	(pid_t		inProcessID,
+							 pid_t		inForegroundGroup,
+							 Boolean	inPasswordMode)
 {
-	Local_Result	result = kLocal_ResultOK;
+	auto	toProcess = gProcessesByID().find(inProcessID);
 	
 	
-	if (-1 == ioctl(inTTY, TIOCSWINSZ/* command */, inTerminalSizePtr))
+	// the process may have been destroyed since the change was seen
+	if (gProcessesByID().end() != toProcess)
 	{
-		int const	kActualError = errno;
+		SessionRef		session = nullptr;
+		Boolean			foregroundChanged = false;
 		
 		
-		Console_Warning(Console_WriteValue, "failed to send terminal resize message, errno", kActualError);
-		result = kLocal_ResultIOControlError;
+		{
+			My_ProcessAutoLocker	ptr(gProcessPtrLocks(), toProcess->second);
+			
+			
+			foregroundChanged = (inForegroundGroup != ptr->_foregroundGroup);
+			ptr->_foregroundGroup = inForegroundGroup;
+			ptr->_passwordMode = inPasswordMode;
+			session = ptr->_session;
+			if (foregroundChanged)
+			{
+				// a directory reported by the previous foreground process
+				// (typically the shell) may not apply to the new one
+				ptr->_directoryReported = false;
+			}
+		}
+		Session_ProcessStateChanged(session, foregroundChanged);
+		if (foregroundChanged)
+		{
+			Local_UpdateCurrentDirectoryCache();
+		}
+	}
+}// receiveTerminalStateChange
+
+
+/*!
+Arranges for shells to be spawned ahead of time until the
+limit set by Local_SetPreSpawnedProcessLimits() is reached.
+Shells are spawned one at a time on the main queue, after a
+short delay so that they do not compete with the session
+that was just created.
+
+(2017.10)
+*/
+void
+replenishPreSpawnedProcessesLater ()
+{
+	unless (gPreSpawnReplenishPending)
+	{
+		gPreSpawnReplenishPending = true;
+		dispatch_after(dispatch_time(DISPATCH_TIME_NOW, STATIC_CAST(1.0/* arbitrary; seconds */ * NSEC_PER_SEC, int64_t)),
+						dispatch_get_main_queue(),
+		^{
+			gPreSpawnReplenishPending = false;
+			if (gPreSpawnedProcesses().size() < gPreSpawnedProcessLimit)
+			{
+				Local_Result	spawnResult = preSpawnProcess();
+				
+				
+				if (kLocal_ResultOK == spawnResult)
+				{
+					replenishPreSpawnedProcessesLater();
+				}
+				else
+				{
+					Console_Warning(Console_WriteValue, "unable to pre-spawn process, error", spawnResult);
+				}
+			}
+		});
+	}
+}// replenishPreSpawnedProcessesLater
+
+
+/*!
+Responds to the exit of a child process, as found by
+reapChildProcesses().  If some unusual exit occurs, the user
+is notified in the background.
+
+(4.0)
+*/
+void
+reportProcessExit	(pid_t		inProcessID,
+					 int		inStatus)
+{
+	// only pay attention to reports for processes that were spawned by this module
+	if (gChildProcessIDs().end() != gChildProcessIDs().find(inProcessID))
+	{
+		CFStringRef					dialogTextTemplateCFString = nullptr;
+		CFStringRef					dialogTextCFString = nullptr;
+		CFStringRef					helpTextCFString = CFSTR(""); // not always used
+		CFStringRef					growlNotificationName = nullptr; // not released
+		CFStringRef					growlNotificationTitle = nullptr;
+		UIStrings_Result			stringResult = kUIStrings_ResultOK;
+		GrowlSupport_NoteDisplay	displayType = kGrowlSupport_NoteDisplayAlways;
+		Boolean						canDisplayAlert = false;
+		Boolean						canNotifyGrowl = false;
+		Boolean						releaseHelpText = false;
+		
+		
+		if (WIFEXITED(inStatus))
+		{
+			int const	kExitCode = WEXITSTATUS(inStatus);
+			
+			
+			canNotifyGrowl = true;
+			if (0 != kExitCode)
+			{
+				// failed exit
+				canDisplayAlert = true;
+				Console_WriteValuePair("process exit: pid,code", inProcessID, kExitCode);
+				
+				// if more is known about the type of exit status, add help text
+				helpTextCFString = nullptr; // initially...
+				switch (kExitCode)
+				{
+				case EX_USAGE:
+					stringResult = UIStrings_Copy(kUIStrings_AlertWindowNotifySysExitUsageHelpText, helpTextCFString);
+					break;
+				
+				case EX_DATAERR:
+					stringResult = UIStrings_Copy(kUIStrings_AlertWindowNotifySysExitDataErrHelpText, helpTextCFString);
+					break;
+				
+				case EX_NOINPUT:
+					stringResult = UIStrings_Copy(kUIStrings_AlertWindowNotifySysExitNoInputHelpText, helpTextCFString);
+					break;
+				
+				case EX_NOUSER:
+					stringResult = UIStrings_Copy(kUIStrings_AlertWindowNotifySysExitNoUserHelpText, helpTextCFString);
+					break;
+				
+				case EX_NOHOST:
+					stringResult = UIStrings_Copy(kUIStrings_AlertWindowNotifySysExitNoHostHelpText, helpTextCFString);
+					break;
+				
+				case EX_UNAVAILABLE:
+					stringResult = UIStrings_Copy(kUIStrings_AlertWindowNotifySysExitUnavailHelpText, helpTextCFString);
+					break;
+				
+				case EX_SOFTWARE:
+					stringResult = UIStrings_Copy(kUIStrings_AlertWindowNotifySysExitSoftwareHelpText, helpTextCFString);
+					break;
+				
+				case EX_OSERR:
+					stringResult = UIStrings_Copy(kUIStrings_AlertWindowNotifySysExitOSErrHelpText, helpTextCFString);
+					break;
+				
+				case EX_OSFILE:
+					stringResult = UIStrings_Copy(kUIStrings_AlertWindowNotifySysExitOSFileHelpText, helpTextCFString);
+					break;
+				
+				case EX_CANTCREAT:
+					stringResult = UIStrings_Copy(kUIStrings_AlertWindowNotifySysExitCreateHelpText, helpTextCFString);
+					break;
+				
+				case EX_IOERR:
+					stringResult = UIStrings_Copy(kUIStrings_AlertWindowNotifySysExitIOErrHelpText, helpTextCFString);
+					break;
+				
+				case EX_TEMPFAIL:
+					stringResult = UIStrings_Copy(kUIStrings_AlertWindowNotifySysExitTempFailHelpText, helpTextCFString);
+					break;
+				
+				case EX_PROTOCOL:
+					stringResult = UIStrings_Copy(kUIStrings_AlertWindowNotifySysExitProtocolHelpText, helpTextCFString);
+					break;
+				
+				case EX_NOPERM:
+					stringResult = UIStrings_Copy(kUIStrings_AlertWindowNotifySysExitNoPermHelpText, helpTextCFString);
+					break;
+				
+				case EX_CONFIG:
+					stringResult = UIStrings_Copy(kUIStrings_AlertWindowNotifySysExitConfigHelpText, helpTextCFString);
+					break;
+				
+				default:
+					break;
+				}
+				if (false == stringResult.ok())
+				{
+					helpTextCFString = nullptr;
+				}
+				if (nullptr != helpTextCFString)
+				{
+					releaseHelpText = true;
+				}
+				else
+				{
+					helpTextCFString = CFSTR("");
+				}
+				
+				growlNotificationName = CFSTR("Session failed"); // MUST match "Growl Registration Ticket.growlRegDict"
+				stringResult = UIStrings_Copy(kUIStrings_AlertWindowNotifyProcessDieTitle, growlNotificationTitle);
+				if (false == stringResult.ok())
+				{
+					growlNotificationTitle = growlNotificationName;
+					CFRetain(growlNotificationTitle);
+				}
+				stringResult = UIStrings_Copy(kUIStrings_AlertWindowNotifyProcessDieTemplate, dialogTextTemplateCFString);
+				if (stringResult.ok())
+				{
+					// WARNING: this format must agree with how the original template string is defined
+					dialogTextCFString = CFStringCreateWithFormat(kCFAllocatorDefault, nullptr/* options */,
+																	dialogTextTemplateCFString, kExitCode);
+				}
+			}
+			else
+			{
+				// successful exit
+				canDisplayAlert = false;
+				displayType = kGrowlSupport_NoteDisplayConfigurable;
+				
+				growlNotificationName = CFSTR("Session ended"); // MUST match "Growl Registration Ticket.growlRegDict"
+				stringResult = UIStrings_Copy(kUIStrings_AlertWindowNotifyProcessExitTitle, growlNotificationTitle);
+				if (false == stringResult.ok())
+				{
+					growlNotificationTitle = growlNotificationName;
+					CFRetain(growlNotificationTitle);
+				}
+				stringResult = UIStrings_Copy(kUIStrings_AlertWindowNotifyProcessExitPrimaryText, dialogTextCFString);
+			}
+		}
+		else if (WIFSIGNALED(inStatus))
+		{
+			int const	kSignal = WTERMSIG(inStatus);
+			
+			
+			canNotifyGrowl = true;
+			canDisplayAlert = true;
+			switch (kSignal)
+			{
+			// not all termination signals should be reported
+			case SIGKILL:
+			case SIGALRM:
+			case SIGTERM:
+				canNotifyGrowl = false;
+				canDisplayAlert = false;
+				break;
+			
+			default:
+				break;
+			}
+			
+			Console_WriteValuePair("process exit: pid,signal", inProcessID, kSignal);
+			growlNotificationName = CFSTR("Session failed"); // MUST match "Growl Registration Ticket.growlRegDict"
+			stringResult = UIStrings_Copy(kUIStrings_AlertWindowNotifyProcessDieTitle, growlNotificationTitle);
+			if (false == stringResult.ok())
+			{
+				growlNotificationTitle = growlNotificationName;
+				CFRetain(growlNotificationTitle);
+			}
+			stringResult = UIStrings_Copy(kUIStrings_AlertWindowNotifyProcessSignalTemplate, dialogTextTemplateCFString);
+			if (stringResult.ok())
+			{
+				// WARNING: this format must agree with how the original template string is defined
+				dialogTextCFString = CFStringCreateWithFormat(kCFAllocatorDefault, nullptr/* options */,
+																dialogTextTemplateCFString, kSignal);
+			}
+		}
+		else
+		{
+			Console_WriteValuePair("process returned unknown status", inProcessID, inStatus);
+		}
+		
+		// display a non-blocking alert to the user, or post a Growl notification;
+		// note that some events fall back to a modeless alert message when Growl
+		// is not available, but others simply do nothing (since an alert can be
+		// excessive)
+		if ((canNotifyGrowl) || (canDisplayAlert))
+		{
+			// page the Mac OS X user notification center (and Growl,
+			// if it is installed)
+			GrowlSupport_Notify(displayType, growlNotificationName, growlNotificationTitle,
+								dialogTextCFString/* description */);
+		}
+		
+		if (nullptr != growlNotificationTitle)
+		{
+			CFRelease(growlNotificationTitle), growlNotificationTitle = nullptr;
+		}
+		if (nullptr != dialogTextCFString)
+		{
+			CFRelease(dialogTextCFString), dialogTextCFString = nullptr;
+		}
+		if (releaseHelpText)
+		{
+			CFRelease(helpTextCFString), helpTextCFString = nullptr;
+		}
+		if (nullptr != dialogTextTemplateCFString)
+		{
+			CFRelease(dialogTextTemplateCFString), dialogTextTemplateCFString = nullptr;
+		}
+	}
+}// reportProcessExit
+
+
+/*!
+Internal version of Local_TerminalResize().
+
+IMPORTANT:	This function is called within the child
+			portion of a fork, which limits its behavior!
+
+\retval kLocal_ResultOK
+if the message is sent successfully
+
+\retval kLocal_ResultIOControlError
+if the message could not be sent
+
+(3.0)
+*/
+Local_Result
+sendTerminalResizeMessage   (Local_TerminalID			inTTY,
+							 struct winsize const*		inTerminalSizePtr)
+{
+	Local_Result	result = kLocal_ResultOK;
+	
+	
+	if (-1 == ioctl(inTTY, TIOCSWINSZ/* command */, inTerminalSizePtr))
+	{
+		int const	kActualError = errno;
+		
+		
+		Console_Warning(Console_WriteValue, "failed to send terminal resize message, errno", kActualError);
+		result = kLocal_ResultIOControlError;
+	}
+	return result;
+}// sendTerminalResizeMessage
+
+
+/*!
+Creates a pseudo-terminal of the given size and runs the
+specified command line in a child process attached to it,
+in the given working directory.  The TERM variable of the
+child is set to the given terminal name.
+
+This is the part of Local_SpawnProcess() that does not
+depend on a session, so it is also used to create shells
+ahead of time (see Local_AdoptPreSpawnedProcess()).
+
+\retval kLocal_ResultOK
+if the process was created successfully
+
+\retval kLocal_ResultParameterError
+if the argument array has no usable arguments
+
+\retval kLocal_ResultForkError
+if the process cannot be spawned
+
+(2017.10)
+*/
+Local_Result
+spawnProcessInPseudoTerminal	(CFArrayRef			inArgumentArray,
+								 char const*		inWorkingDirectory,
+								 CFStringRef		inTerminalName,
+								 UInt16				inColumnCount,
+								 UInt16				inRowCount,
+								 My_TTYMasterID&	outMasterTTY,
+								 std::string&		outSlaveDeviceName,
+								 pid_t&				outProcessID)
+{
+	CFIndex const	kArgumentCount = CFArrayGetCount(inArgumentArray);
+	char**			argvCopy = new char*[1 + kArgumentCount];
+	Local_Result	result = kLocal_ResultOK;
+	
+	
+	argvCopy[0] = nullptr;
+	if (kArgumentCount > 0)
+	{					
+		// construct an argument array of the form expected by the system call
+		CFStringEncoding const	kArgumentEncoding = kCFStringEncodingUTF8;
+		UInt16					j = 0;
+		
+		
+		for (UInt16 i = 0; i < kArgumentCount; ++i)
+		{
+			CFStringRef		argumentCFString = CFUtilities_StringCast
+												(CFArrayGetValueAtIndex(inArgumentArray, i));
+			
+			
+			// ignore completely empty strings (generally caused by
+			// a bad split on multiple whitespace characters)
+			if (CFStringGetLength(argumentCFString) > 0)
+			{
+				size_t const	kBufferSize = 1 + CFStringGetMaximumSizeForEncoding
+													(CFStringGetLength(argumentCFString), kArgumentEncoding);
+				
+				
+				// this memory is not leaked because execvp() is about to occur
+				argvCopy[j] = new char[kBufferSize];
+				CFStringGetCString(argumentCFString, argvCopy[j], kBufferSize, kArgumentEncoding);
+				++j;
+			}
+		}
+		argvCopy[j] = nullptr;
+	}
+	
+	if (nullptr == argvCopy[0])
+	{
+		result = kLocal_ResultParameterError;
+	}
+	else
+	{
+		My_TTYMasterID		masterTTY = 0;
+		char				slaveDeviceName[20/* arbitrary */];
+		pid_t				processID = -1;
+		struct termios		terminalControl;
+		
+		
+		// set the answer-back message
+		{
+			CFStringRef		answerBackCFString = inTerminalName;
+			
+			
+			if (nullptr != answerBackCFString)
+			{
+				size_t const	kAnswerBackSize = CFStringGetLength(answerBackCFString) + 1/* terminator */;
+				char*			answerBackCString = new char[kAnswerBackSize];
+				
+				
+				if (CFStringGetCString(answerBackCFString, answerBackCString, kAnswerBackSize, kCFStringEncodingASCII))
+				{
+					UNUSED_RETURN(int)setenv("TERM", answerBackCString, true/* overwrite */);
+				}
+				delete [] answerBackCString;
+			}
+		}
+		
+		// Apple’s Terminal sets the variables TERM_PROGRAM and
+		// TERM_PROGRAM_VERSION for some reason; it is possible
+		// that scripts could start to rely on these, so it seems
+		// harmless enough to set them correctly for MacTerm
+		{
+			CFBundleRef		mainBundle = AppResources_ReturnBundleForInfo();
+			CFStringRef		valueCFString = nullptr;
+			
+			
+			valueCFString = CFUtilities_StringCast
+							(CFBundleGetValueForInfoDictionaryKey(mainBundle, kCFBundleNameKey));
+			if (nullptr != valueCFString)
+			{
+				size_t const	kStringSize = CFStringGetLength(valueCFString) + 1/* terminator */;
+				char*			valueCString = new char[kStringSize];
+				
+				
+				if (CFStringGetCString(valueCFString, valueCString, kStringSize, kCFStringEncodingASCII))
+				{
+					UNUSED_RETURN(int)setenv("TERM_PROGRAM", valueCString, true/* overwrite */);
+				}
+				delete [] valueCString;
+			}
+			valueCFString = CFUtilities_StringCast
+							(CFBundleGetValueForInfoDictionaryKey(mainBundle, kCFBundleVersionKey));
+			if (nullptr != valueCFString)
+			{
+				size_t const	kStringSize = CFStringGetLength(valueCFString) + 1/* terminator */;
+				char*			valueCString = new char[kStringSize];
+				
+				
+				if (CFStringGetCString(valueCFString, valueCString, kStringSize, kCFStringEncodingASCII))
+				{
+					UNUSED_RETURN(int)setenv("TERM_PROGRAM_VERSION", valueCString, true/* overwrite */);
+				}
+				delete [] valueCString;
+			}
+		}
+		
+		// TEMPORARY - the UNIX structures are filled in with defaults that work,
+		//             but eventually MacTerm has to map user preferences, etc.
+		//             to these so that they affect “local” terminals in the same
+		//             way as they affect remote ones
+		std::memset(&terminalControl, 0, sizeof(terminalControl));
+		fillInTerminalControlStructure(&terminalControl); // TEMP
+		
+		// spawn a child process attached to a pseudo-terminal device; the child
+		// will be used to run the shell, and the shell’s I/O will be handled in
+		// a separate preemptive thread by MacTerm’s awesome terminal emulator
+		// and main event loop
+		{
+			struct winsize		terminalSize; // defined in "/usr/include/sys/ttycom.h"
+			
+			
+			terminalSize.ws_col = inColumnCount;
+			terminalSize.ws_row = inRowCount;
+			
+			// TEMPORARY; the TerminalView_GetTheoreticalScreenDimensions() API would be useful for this
+			terminalSize.ws_xpixel = 0;	// terminal width, in pixels; UNKNOWN
+			terminalSize.ws_ypixel = 0;	// terminal height, in pixels; UNKNOWN
+			
+			if (gInDebuggingMode && DebugInterface_LogsTeletypewriterState())
+			{
+				// in debugging mode, show the terminal configuration
+				Console_WriteLine("printing initial terminal configuration for process");
+				printTerminalControlStructure(&terminalControl);
+			}
+			
+			// posix_spawn() is much faster than fork() in a large process
+			// but it is not supported by every system; if it fails, the
+			// original approach is used (this also means that failures
+			// such as a bad command line are reported the same way)
+			processID = -1;
+			if (kMy_SpawnMethodPosixSpawn == gSpawnMethod)
+			{
+				processID = posixSpawnInPseudoTerminal(argvCopy, inWorkingDirectory, &terminalControl, &terminalSize,
+														masterTTY, slaveDeviceName);
+			}
+			if (-1 == processID)
+			{
+				processID = forkpty(&masterTTY, slaveDeviceName, &terminalControl, &terminalSize);
+			}
+		}
+		
+		if (-1 == processID) result = kLocal_ResultForkError;
+		else
+		{
+			if (0 == processID)
+			{
+				//
+				// this is executed inside the child process (forkpty() only); note that any
+				// console print-outs at this point will actually go to the
+				// child terminal (rendered by a MacTerm window!)
+				//
+				
+				// IMPORTANT: There are limitations on what a child process can do.
+				// For example, global data and framework calls are generally unsafe.
+				// See the "fork" man page for more information.
+				
+				// undo the effects on signals, because the user might be running
+				// a program like "bash" that inherits signal behavior from the
+				// parent; if this step were not performed, then "bash" would do
+				// odd things like ignore all control-C (interrupt) sequences
+				gSignalsBlockedInThreads(false);
+				
+				// set the current working directory...abort if this fails
+				// because presumably it is important that a command not
+				// start in the wrong directory
+				if (0 != chdir(inWorkingDirectory))
+				{
+					Console_WriteValueCString("aborting, failed to chdir(), target directory", inWorkingDirectory);
+					exit(EX_NOINPUT); // could abort(), but an exit() is easier to report gracefully to the user
+				}
+				
+				// run a Unix terminal-based application program; this is accomplished
+				// using an execvp() call, which DOES NOT RETURN UNLESS there is an
+				// error; technically the return value is -1 on error, but really it’s
+				// a problem if any return value is received, so never exit with a 0
+				// in this situation!
+				UNUSED_RETURN(int)execvp(argvCopy[0], argvCopy); // should not return
+				
+				// almost no chance this line will be run, but if it does, just kill the child process
+				Console_WriteLine("aborting, failed to exec()");
+				exit(EX_UNAVAILABLE); // could abort(), but an exit() is easier to report gracefully to the user
+			}
+			
+			//
+			// this is executed inside the parent process
+			//
+			
+			Console_WriteValue("spawned process ID", processID);
+			
+			// prevent threads from being the receivers of signals
+			gSignalsBlockedInThreads();
+			
+			// detect exits (including immediate failures) and stops
+			gUnreapedProcessIDs().insert(processID);
+			startMonitoringChildProcess(processID);
+			
+			// avoid special processing of data, allow the terminal to see it all (raw mode)
+			if (0)
+			{
+				// arrange for user’s TTY to be fixed at exit time
+				gTerminalToRestore = STDIN_FILENO;
+				if (-1 == atexit(putTTYInOriginalModeAtExit))
+				{
+					int const		kActualError = errno;
+					
+					
+					Console_Warning(Console_WriteValue, "unable to register atexit() routine for TTY mode", kActualError);
+				}
+				
+				// set user’s TTY to raw mode
+				{
+					Local_Result	rawSwitchResult = putTTYInRawMode(gTerminalToRestore);
+					
+					
+					if (kLocal_ResultOK != rawSwitchResult)
+					{
+						Console_Warning(Console_WriteValue, "error entering TTY raw-mode", rawSwitchResult);
+					}
+				}
+			}
+			
+			outMasterTTY = masterTTY;
+			outSlaveDeviceName = slaveDeviceName;
+			outProcessID = processID;
+		}
 	}
+	
+	// WARNING: this cleanup is not exception-safe, and should change
+	delete [] argvCopy, argvCopy = nullptr;
+	
 	return result;
-}// sendTerminalResizeMessage
+}// spawnProcessInPseudoTerminal
+
+
+/*!
+Arranges for handleChildProcessEvents() to be invoked when
+the given child process exits.  The first call also creates
+the single kqueue() that receives every child process event
+for this module, including SIGCHLD (which is also sent when
+a child stops or continues), so no polling is needed.
+
+(2017.10)
+*/
+void
+startMonitoringChildProcess		(pid_t		inProcessID)
+{
+	if (gChildProcessEventQueue < 0)
+	{
+		gChildProcessEventQueue = kqueue();
+		if (gChildProcessEventQueue < 0)
+		{
+			int const	kActualError = errno;
+			
+			
+			Console_Warning(Console_WriteValue, "unable to create queue for child process events, errno", kActualError);
+		}
+		else
+		{
+			struct kevent	signalEvent;
+			sig_t			signalResult = nullptr;
+			
+			
+			// install signal handlers to prevent the OS from popping up error
+			// dialogs just because some child process aborted
+			signalResult = signal(SIGABRT, receiveSignal);
+			if (SIG_ERR == signalResult)
+			{
+				Console_Warning(Console_WriteLine, "unable to install signal handler");
+			}
+			
+			// signal events are recorded even though SIGCHLD is not handled
+			EV_SET(&signalEvent, SIGCHLD, EVFILT_SIGNAL, EV_ADD, 0/* filter flags */, 0/* data */, nullptr/* context */);
+			if (-1 == kevent(gChildProcessEventQueue, &signalEvent, 1, nullptr/* events */, 0/* event count */, nullptr/* timeout */))
+			{
+				int const	kActualError = errno;
+				
+				
+				Console_Warning(Console_WriteValue, "unable to monitor SIGCHLD, errno", kActualError);
+			}
+			
+			gChildProcessEventSource = dispatch_source_create(DISPATCH_SOURCE_TYPE_READ, gChildProcessEventQueue,
+																0/* mask */, dispatch_get_main_queue());
+			dispatch_source_set_event_handler(gChildProcessEventSource,
+			^{
+				handleChildProcessEvents();
+			});
+			dispatch_resume(gChildProcessEventSource);
+		}
+	}
+	
+	if (gChildProcessEventQueue >= 0)
+	{
+		struct kevent	exitEvent;
+		
+		
+		EV_SET(&exitEvent, inProcessID, EVFILT_PROC, EV_ADD | EV_ONESHOT, NOTE_EXIT, 0/* data */, nullptr/* context */);
+		if (-1 == kevent(gChildProcessEventQueue, &exitEvent, 1, nullptr/* events */, 0/* event count */, nullptr/* timeout */))
+		{
+			// the process may have failed immediately (ESRCH); since
+			// there will be no event for it, check again shortly
+			dispatch_async(dispatch_get_main_queue(),
+			^{
+				reapChildProcesses();
+			});
+		}
+	}
+}// startMonitoringChildProcess
+
+
+/*!
+Associates a process created by spawnProcessInPseudoTerminal()
+with the given session, and starts a thread that transfers
+data between the session and the pseudo-terminal.  When this
+returns, the session is in the initialized state.
+
+\retval kLocal_ResultOK
+if the thread was started successfully
+
+\retval kLocal_ResultThreadError
+if a thread cannot be created to read data
+
+(2017.10)
+*/
+Local_Result
+startProcessDataLoop	(SessionRef			inUninitializedSession,
+						 CFArrayRef			inArgumentArray,
+						 CFStringRef		inWorkingDirectory,
+						 My_TTYMasterID		inMasterTTY,
+						 char const*		inSlaveDeviceName,
+						 pid_t				inProcessID)
+{
+	Local_Result	result = kLocal_ResultOK;
+	pthread_attr_t	attr;
+	int				error = 0;
+	
+	
+	error = pthread_attr_init(&attr);
+	if (0 != error) result = kLocal_ResultThreadError;
+	else
+	{
+		My_DataLoopThreadContextPtr		threadContextPtr = nullptr;
+		pthread_t						thread;
+		
+		
+		// store process information for session
+		{
+			My_Process*			newProcessPtr = new My_Process(inUninitializedSession, inArgumentArray, inWorkingDirectory,
+																inMasterTTY, inSlaveDeviceName, inProcessID);
+			Local_ProcessRef	newProcess = REINTERPRET_CAST(newProcessPtr, Local_ProcessRef);
+			
+			
+			Session_SetProcess(inUninitializedSession, newProcess);
+		}
+		threadContextPtr = REINTERPRET_CAST(Memory_NewPtrInterruptSafe(sizeof(My_DataLoopThreadContext)),
+											My_DataLoopThreadContextPtr);
+		if (nullptr == threadContextPtr) result = kLocal_ResultThreadError;
+		else
+		{
+			// set up context
+			threadContextPtr->eventQueue = nullptr; // set inside the handler
+			threadContextPtr->session = inUninitializedSession;
+			threadContextPtr->masterTTY = inMasterTTY;
+			threadContextPtr->processID = inProcessID;
+			
+			// create thread
+			error = pthread_create(&thread, &attr, threadForLocalProcessDataLoop, threadContextPtr);
+			if (0 != error) result = kLocal_ResultThreadError;
+		}
+		
+		// put the session in the initialized state, to indicate it is complete
+		Session_SetState(inUninitializedSession, kSession_StateInitialized);
+	}
+	
+	return result;
+}// startProcessDataLoop
 
 
 /*!
@@ -1800,6 +3185,8 @@ threadForLocalProcessDataLoop	(void*		inDataLoopThreadContextPtr)
 	char*							buffer = REINTERPRET_CAST(Memory_NewPtrInterruptSafe(kBufferSize), char*);
 	char*							processingBegin = buffer;
 	char*							processingPastEnd = processingBegin;
+	pid_t							recentForegroundGroup = contextPtr->processID; // see My_Process constructor
+	Boolean							recentPasswordMode = false;
 	OSStatus						error = noErr;
 	
 	
@@ -1831,6 +3218,34 @@ threadForLocalProcessDataLoop	(void*		inDataLoopThreadContextPtr)
 				break;
 			}
 			
+			// the foreground job and echo mode can only change while
+			// processes run, so checking whenever they produce output
+			// notices changes (such as password prompts) immediately
+			{
+				pid_t const		kForegroundGroup = tcgetpgrp(contextPtr->masterTTY);
+				struct termios	terminalInfo;
+				Boolean			isPasswordMode = false;
+				
+				
+				if (0 == tcgetattr(contextPtr->masterTTY, &terminalInfo))
+				{
+					isPasswordMode = ((0 != (terminalInfo.c_lflag & ICANON)) && (0 == (terminalInfo.c_lflag & ECHO)));
+				}
+				
+				if ((kForegroundGroup != recentForegroundGroup) || (isPasswordMode != recentPasswordMode))
+				{
+					pid_t const		kProcessID = contextPtr->processID;
+					
+					
+					recentForegroundGroup = kForegroundGroup;
+					recentPasswordMode = isPasswordMode;
+					dispatch_async(dispatch_get_main_queue(),
+					^{
+						receiveTerminalStateChange(kProcessID, kForegroundGroup, isPasswordMode);
+					});
+				}
+			}
+			
 			// adjust the total number of bytes remaining to be processed
 			processingBegin = buffer;
 			processingPastEnd = processingBegin + numberOfBytesRead;
@@ -1973,285 +3388,92 @@ threadForLocalProcessDataLoop	(void*		inDataLoopThreadContextPtr)
 	return nullptr;
 }// threadForLocalProcessDataLoop
 
+} // anonymous namespace
+
 
-/*!
-This is invoked periodically to see if any child process has exited.
-If some unusual exit occurs, the user is notified in the background.
+#pragma mark Internal Methods: Unit Tests
+namespace {
 
-Timers that draw must save and restore the current graphics port.
+/*!
+Spawns the given command in a pseudo-terminal with the given
+method, and waits for it to exit.  Returns the exit status
+of the process, or -1 if it could not be spawned.  Also
+returns the time spent creating the process.
 
-(4.0)
+(2017.10)
 */
-void
-watchForExitsTimer	(EventLoopTimerRef		UNUSED_ARGUMENT(inTimer),
-					 void*					UNUSED_ARGUMENT(inContext))
+int
+unitTestSpawnAndWait	(My_SpawnMethod		inMethod,
+						 CFArrayRef			inArgumentArray,
+						 CFAbsoluteTime&	outSpawnTime)
 {
-	static Boolean		gFirstCall = true;
-	int					currentStatus = 0;
-	pid_t				waitResult = waitpid(-1/* process or group, -1 is “any child” */, &currentStatus, WNOHANG/* options */);
-	
-	
-	if (gFirstCall)
+	My_SpawnMethod const	kOldMethod = gSpawnMethod;
+	My_TTYMasterID			masterTTY = kLocal_InvalidTerminalID;
+	std::string				slaveDeviceName;
+	pid_t					processID = -1;
+	CFAbsoluteTime const	kStartTime = CFAbsoluteTimeGetCurrent();
+	Local_Result			spawnResult = kLocal_ResultOK;
+	int						result = -1;
+	
+	
+	gSpawnMethod = inMethod;
+	spawnResult = spawnProcessInPseudoTerminal(inArgumentArray, "/", CFSTR("vt100"), 80, 24,
+												masterTTY, slaveDeviceName, processID);
+	outSpawnTime = (CFAbsoluteTimeGetCurrent() - kStartTime);
+	gSpawnMethod = kOldMethod;
+	
+	if (kLocal_ResultOK == spawnResult)
 	{
-		sig_t		signalResult = nullptr;
+		int		currentStatus = 0;
 		
 		
-		// install signal handlers to prevent the OS from popping up error
-		// dialogs just because some child process aborted
-		gFirstCall = false;
-		signalResult = signal(SIGABRT, receiveSignal);
-		if (SIG_ERR == signalResult)
+		if ((processID == waitpid(processID, &currentStatus, 0/* options */)) && WIFEXITED(currentStatus))
 		{
-			Console_Warning(Console_WriteLine, "unable to install signal handler");
+			result = WEXITSTATUS(currentStatus);
 		}
+		UNUSED_RETURN(int)close(masterTTY);
 	}
 	
-	if (0 == waitResult)
-	{
-		// no status yet...okay...
-	}
-	else
-	{
-		// process may have failed - if it is a “real” problem, tell the user
-		// INCOMPLETE - it is possible to be more specific here, if information is cached and
-		// looked up based on process ID (e.g. window, process name, session info)
-		pid_t const		kProcessID = waitResult;
-		
-		
-		// only pay attention to reports for processes that were spawned by this module
-		if (gChildProcessIDs().end() != gChildProcessIDs().find(kProcessID))
-		{
-			CFStringRef					dialogTextTemplateCFString = nullptr;
-			CFStringRef					dialogTextCFString = nullptr;
-			CFStringRef					helpTextCFString = CFSTR(""); // not always used
-			CFStringRef					growlNotificationName = nullptr; // not released
-			CFStringRef					growlNotificationTitle = nullptr;
-			UIStrings_Result			stringResult = kUIStrings_ResultOK;
-			GrowlSupport_NoteDisplay	displayType = kGrowlSupport_NoteDisplayAlways;
-			Boolean						canDisplayAlert = false;
-			Boolean						canNotifyGrowl = false;
-			Boolean						releaseHelpText = false;
-			
-			
-			if (WIFEXITED(currentStatus))
-			{
-				int const	kExitCode = WEXITSTATUS(currentStatus);
-				
-				
-				canNotifyGrowl = true;
-				if (0 != kExitCode)
-				{
-					// failed exit
-					canDisplayAlert = true;
-					Console_WriteValuePair("process exit: pid,code", kProcessID, kExitCode);
-					
-					// if more is known about the type of exit status, add help text
-					helpTextCFString = nullptr; // initially...
-					switch (kExitCode)
-					{
-					case EX_USAGE:
-						stringResult = UIStrings_Copy(kUIStrings_AlertWindowNotifySysExitUsageHelpText, helpTextCFString);
-						break;
-					
-					case EX_DATAERR:
-						stringResult = UIStrings_Copy(kUIStrings_AlertWindowNotifySysExitDataErrHelpText, helpTextCFString);
-						break;
-					
-					case EX_NOINPUT:
-						stringResult = UIStrings_Copy(kUIStrings_AlertWindowNotifySysExitNoInputHelpText, helpTextCFString);
-						break;
-					
-					case EX_NOUSER:
-						stringResult = UIStrings_Copy(kUIStrings_AlertWindowNotifySysExitNoUserHelpText, helpTextCFString);
-						break;
-					
-					case EX_NOHOST:
-						stringResult = UIStrings_Copy(kUIStrings_AlertWindowNotifySysExitNoHostHelpText, helpTextCFString);
-						break;
-					
-					case EX_UNAVAILABLE:
-						stringResult = UIStrings_Copy(kUIStrings_AlertWindowNotifySysExitUnavailHelpText, helpTextCFString);
-						break;
-					
-					case EX_SOFTWARE:
-						stringResult = UIStrings_Copy(kUIStrings_AlertWindowNotifySysExitSoftwareHelpText, helpTextCFString);
-						break;
-					
-					case EX_OSERR:
-						stringResult = UIStrings_Copy(kUIStrings_AlertWindowNotifySysExitOSErrHelpText, helpTextCFString);
-						break;
-					
-					case EX_OSFILE:
-						stringResult = UIStrings_Copy(kUIStrings_AlertWindowNotifySysExitOSFileHelpText, helpTextCFString);
-						break;
-					
-					case EX_CANTCREAT:
-						stringResult = UIStrings_Copy(kUIStrings_AlertWindowNotifySysExitCreateHelpText, helpTextCFString);
-						break;
-					
-					case EX_IOERR:
-						stringResult = UIStrings_Copy(kUIStrings_AlertWindowNotifySysExitIOErrHelpText, helpTextCFString);
-						break;
-					
-					case EX_TEMPFAIL:
-						stringResult = UIStrings_Copy(kUIStrings_AlertWindowNotifySysExitTempFailHelpText, helpTextCFString);
-						break;
-					
-					case EX_PROTOCOL:
-						stringResult = UIStrings_Copy(kUIStrings_AlertWindowNotifySysExitProtocolHelpText, helpTextCFString);
-						break;
-					
-					case EX_NOPERM:
-						stringResult = UIStrings_Copy(kUIStrings_AlertWindowNotifySysExitNoPermHelpText, helpTextCFString);
-						break;
-					
-					case EX_CONFIG:
-						stringResult = UIStrings_Copy(kUIStrings_AlertWindowNotifySysExitConfigHelpText, helpTextCFString);
-						break;
-					
-					default:
-						break;
-					}
-					if (false == stringResult.ok())
-					{
-						helpTextCFString = nullptr;
-					}
-					if (nullptr != helpTextCFString)
-					{
-						releaseHelpText = true;
-					}
-					else
-					{
-						helpTextCFString = CFSTR("");
-					}
-					
-					growlNotificationName = CFSTR("Session failed"); // MUST match "Growl Registration Ticket.growlRegDict"
-					stringResult = UIStrings_Copy(kUIStrings_AlertWindowNotifyProcessDieTitle, growlNotificationTitle);
-					if (false == stringResult.ok())
-					{
-						growlNotificationTitle = growlNotificationName;
-						CFRetain(growlNotificationTitle);
-					}
-					stringResult = UIStrings_Copy(kUIStrings_AlertWindowNotifyProcessDieTemplate, dialogTextTemplateCFString);
-					if (stringResult.ok())
-					{
-						// WARNING: this format must agree with how the original template string is defined
-						dialogTextCFString = CFStringCreateWithFormat(kCFAllocatorDefault, nullptr/* options */,
-																		dialogTextTemplateCFString, kExitCode);
-					}
-				}
-				else
-				{
-					// successful exit
-					canDisplayAlert = false;
-					displayType = kGrowlSupport_NoteDisplayConfigurable;
-					
-					growlNotificationName = CFSTR("Session ended"); // MUST match "Growl Registration Ticket.growlRegDict"
-					stringResult = UIStrings_Copy(kUIStrings_AlertWindowNotifyProcessExitTitle, growlNotificationTitle);
-					if (false == stringResult.ok())
-					{
-						growlNotificationTitle = growlNotificationName;
-						CFRetain(growlNotificationTitle);
-					}
-					stringResult = UIStrings_Copy(kUIStrings_AlertWindowNotifyProcessExitPrimaryText, dialogTextCFString);
-				}
-			}
-			else if (WIFSIGNALED(currentStatus))
-			{
-				int const	kSignal = WTERMSIG(currentStatus);
-				
-				
-				canNotifyGrowl = true;
-				canDisplayAlert = true;
-				switch (kSignal)
-				{
-				// not all termination signals should be reported
-				case SIGKILL:
-				case SIGALRM:
-				case SIGTERM:
-					canNotifyGrowl = false;
-					canDisplayAlert = false;
-					break;
-				
-				case SIGSTOP:
-				case SIGTSTP:
-				case SIGCONT:
+	return result;
+}// unitTestSpawnAndWait
+
+
+/*!
+Tests that processes created by each spawn method run
+successfully and have the pseudo-terminal as their
+controlling terminal (a shell requires this for job
+control).
+
+Returns "true" if ALL assertions pass; "false" is
+returned if any fail, however messages should be
+printed for ALL assertion failures regardless.
+
+(2017.10)
+*/
+Boolean
+unitTest000_Begin ()
+{
+	Boolean			result = true;
+	CFStringRef		commandLine[] =
 					{
-						auto	toProcess = gProcessesByID().find(kProcessID);
-						
-						
-						if (gProcessesByID().end() != toProcess)
-						{
-							Local_ProcessRef		thisProcess = toProcess->second;
-							My_ProcessAutoLocker	ptr(gProcessPtrLocks(), thisProcess);
-							
-							
-							ptr->_stopped = (SIGCONT != kSignal);
-						}
-					}
-					break;
-				
-				default:
-					break;
-				}
-				
-				Console_WriteValuePair("process exit: pid,signal", kProcessID, kSignal);
-				growlNotificationName = CFSTR("Session failed"); // MUST match "Growl Registration Ticket.growlRegDict"
-				stringResult = UIStrings_Copy(kUIStrings_AlertWindowNotifyProcessDieTitle, growlNotificationTitle);
-				if (false == stringResult.ok())
-				{
-					growlNotificationTitle = growlNotificationName;
-					CFRetain(growlNotificationTitle);
-				}
-				stringResult = UIStrings_Copy(kUIStrings_AlertWindowNotifyProcessSignalTemplate, dialogTextTemplateCFString);
-				if (stringResult.ok())
-				{
-					// WARNING: this format must agree with how the original template string is defined
-					dialogTextCFString = CFStringCreateWithFormat(kCFAllocatorDefault, nullptr/* options */,
-																	dialogTextTemplateCFString, kSignal);
-				}
-			}
-			else if (WIFSTOPPED(currentStatus))
-			{
-				// ignore (could examine WSTOPSIG(currentStatus))
-				// NOTE: this should never happen anyway, as MacTerm does not use ptrace() or the WUNTRACED option
-			}
-			else
-			{
-				Console_WriteValuePair("process returned unknown status", kProcessID, currentStatus);
-			}
-			
-			// display a non-blocking alert to the user, or post a Growl notification;
-			// note that some events fall back to a modeless alert message when Growl
-			// is not available, but others simply do nothing (since an alert can be
-			// excessive)
-			if ((canNotifyGrowl) || (canDisplayAlert))
-			{
-				// page the Mac OS X user notification center (and Growl,
-				// if it is installed)
-				GrowlSupport_Notify(displayType, growlNotificationName, growlNotificationTitle,
-									dialogTextCFString/* description */);
-			}
-			
-			if (nullptr != growlNotificationTitle)
-			{
-				CFRelease(growlNotificationTitle), growlNotificationTitle = nullptr;
-			}
-			if (nullptr != dialogTextCFString)
-			{
-				CFRelease(dialogTextCFString), dialogTextCFString = nullptr;
-			}
-			if (releaseHelpText)
-			{
-				CFRelease(helpTextCFString), helpTextCFString = nullptr;
-			}
-			if (nullptr != dialogTextTemplateCFString)
-			{
-				CFRelease(dialogTextTemplateCFString), dialogTextTemplateCFString = nullptr;
-			}
-		}
-	}
-}// watchForExitsTimer
+						CFSTR("/bin/sh"),
+						CFSTR("-c"),
+						// fails unless there is a controlling terminal that is also standard input
+						CFSTR(": < /dev/tty && test -t 0 && test -t 1 && test -t 2")
+					};
+	CFRetainRelease	argumentArray(CFArrayCreate(kCFAllocatorDefault, REINTERPRET_CAST(commandLine, void const**),
+												sizeof(commandLine) / sizeof(CFStringRef), &kCFTypeArrayCallBacks),
+									CFRetainRelease::kAlreadyRetained);
+	CFAbsoluteTime	spawnTime = 0;
+	
+	
+	result &= Console_Assert("fork() child has controlling terminal",
+								0 == unitTestSpawnAndWait(kMy_SpawnMethodFork, argumentArray.returnCFArrayRef(), spawnTime));
+	result &= Console_Assert("posix_spawn() child has controlling terminal",
+								0 == unitTestSpawnAndWait(kMy_SpawnMethodPosixSpawn, argumentArray.returnCFArrayRef(), spawnTime));
+	
+	return result;
+}// unitTest000_Begin
 
 } // anonymous namespace
 
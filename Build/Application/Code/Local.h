@@ -73,7 +73,8 @@ enum
 	kLocal_ResultConnectionRefused			= 8,	//!< if a connection was not allowed by the server
 	kLocal_ResultCannotResolveAtAll			= 9,	//!< if a host name was given whose address cannot be found
 	kLocal_ResultCannotResolveForNow		= 10,	//!< if an address cannot be found, but a retry might find it
-	kLocal_ResultInsufficientBufferSpace	= 11	//!< out of memory; free more memory and try again
+	kLocal_ResultInsufficientBufferSpace	= 11,	//!< out of memory; free more memory and try again
+	kLocal_ResultNoPreSpawnedProcess		= 12	//!< no suitable pre-spawned process is available; spawn a new one
 };
 
 typedef int/* file descriptor */	Local_TerminalID;
@@ -92,15 +93,36 @@ typedef std::map< Local_ProcessRef, CFStringRef >	Local_PathByProcess;
 
 #pragma mark Public Methods
 
+//!\name Module Tests
+//@{
+
+void
+	Local_RunSpawnBenchmark					();
+
+void
+	Local_RunTests							();
+
+//@}
+
 //!\name Creating Processes and Pseudo-Terminals
 //@{
 
+Local_Result
+	Local_AdoptPreSpawnedProcess			(SessionRef					inUninitializedSession,
+											 TerminalScreenRef			inContainer,
+											 CFArrayRef					inArgumentArray,
+											 CFStringRef				inWorkingDirectoryOrNull = nullptr);
+
 Local_Result
 	Local_GetDefaultShellCommandLine		(CFArrayRef&				outNewArgumentsArray);
 
 Local_Result
 	Local_GetLoginShellCommandLine			(CFArrayRef&				outNewArgumentsArray);
 
+void
+	Local_SetPreSpawnedProcessLimits		(UInt16						inMaximumProcessCount,
+											 CFTimeInterval				inIdleTimeout);
+
 Local_Result
 	Local_SpawnProcess						(SessionRef					inUninitializedSession,
 											 TerminalScreenRef			inContainer,
@@ -127,10 +149,16 @@ Boolean
 CFArrayRef
 	Local_ProcessReturnCommandLine			(Local_ProcessRef			inProcess);
 
-// NOTE: MUST CALL Local_UpdateCurrentDirectoryCache() PRIOR TO RELYING ON THIS VALUE
+// NOTE: UNLESS THE PROCESS REPORTS ITS DIRECTORY, THIS IS AS OF THE MOST RECENT Local_UpdateCurrentDirectoryCache()
 CFStringRef
 	Local_ProcessReturnCurrentDirectory		(Local_ProcessRef			inProcess);
 
+CFAbsoluteTime
+	Local_ProcessReturnCurrentDirectoryTime	(Local_ProcessRef			inProcess);
+
+pid_t
+	Local_ProcessReturnForegroundGroupID	(Local_ProcessRef			inProcess);
+
 Local_TerminalID
 	Local_ProcessReturnMasterTerminal		(Local_ProcessRef			inProcess);
 
@@ -143,6 +171,10 @@ char const*
 pid_t
 	Local_ProcessReturnUnixID				(Local_ProcessRef			inProcess);
 
+void
+	Local_ProcessSetCurrentDirectory		(Local_ProcessRef			inProcess,
+											 CFStringRef				inPOSIXPath);
+
 //@}
 
 //!\name Manipulating Pseudo-Terminals
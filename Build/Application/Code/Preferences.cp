@@ -701,7 +701,8 @@ Preferences_Result		copyClassDomainCFArray					(Quills::Prefs::Class, CFArrayRef
 CFDictionaryRef			copyDefaultPrefDictionary				();
 CFStringRef				copyDomainUserSpecifiedName				(CFStringRef);
 CFStringRef				copyUserSpecifiedName					(CFDataRef, CFStringRef);
-Preferences_Result		createAllPreferencesContextsFromDisk	();
+Preferences_Result		createPreferencesContextsFromDisk		(Quills::Prefs::Class);
+void					createRemainingPreferencesContextsFromDisk	();
 CFStringRef				createKeyAtIndex						(CFStringRef, UInt32);
 CFIndex					findDomainIndexInArray					(CFArrayRef, CFStringRef);
 Boolean					getDefaultContext						(Quills::Prefs::Class, My_ContextInterfacePtr&);
@@ -784,6 +785,7 @@ My_FavoriteContextList&		gTranslationNamedContexts ()	{ static My_FavoriteContex
 My_ContextInterface&		gWorkspaceDefaultContext ()	{ static My_ContextDefault x(Quills::Prefs::WORKSPACE); return x; }
 My_FavoriteContextList&		gWorkspaceNamedContexts ()	{ static My_FavoriteContextList x; return x; }
 My_TagSetPtrLocker&			gMyTagSetPtrLocks ()	{ static My_TagSetPtrLocker x; return x; }
+std::set< Quills::Prefs::Class >&	gClassesLoadedFromDisk ()	{ static std::set< Quills::Prefs::Class > x; return x; }
 
 } // anonymous namespace
 
@@ -1067,6 +1069,14 @@ Preferences_Init ()
 	My_PreferenceDefinition::create(kPreferences_TagPasteNewLineDelay,
 									CFSTR("data-send-paste-line-delay-milliseconds"), typeNetEvents_CFNumberRef,
 									sizeof(EventTime), Quills::Prefs::SESSION);
+	My_PreferenceDefinition::createFlag(kPreferences_TagPreSpawnedShellAllowed,
+										CFSTR("pre-spawned-shell-allowed"), Quills::Prefs::SESSION);
+	My_PreferenceDefinition::create(kPreferences_TagPreSpawnedShellCount,
+									CFSTR("pre-spawned-shell-count"), typeNetEvents_CFNumberRef,
+									sizeof(UInt16), Quills::Prefs::GENERAL);
+	My_PreferenceDefinition::create(kPreferences_TagPreSpawnedShellIdleTimeout,
+									CFSTR("pre-spawned-shell-idle-timeout-seconds"), typeNetEvents_CFNumberRef,
+									sizeof(UInt16), Quills::Prefs::GENERAL);
 	My_PreferenceDefinition::registerIndirectKeyName(CFSTR("command-key-terminal-home"));
 	My_PreferenceDefinition::registerIndirectKeyName(CFSTR("command-key-terminal-page-up"));
 	My_PreferenceDefinition::registerIndirectKeyName(CFSTR("command-key-terminal-page-down"));
@@ -1074,6 +1084,8 @@ Preferences_Init ()
 										CFSTR("terminal-inverse-selections"), Quills::Prefs::GENERAL);
 	My_PreferenceDefinition::createFlag(kPreferences_TagRandomTerminalFormats,
 										CFSTR("terminal-format-random"), Quills::Prefs::GENERAL);
+	My_PreferenceDefinition::createFlag(kPreferences_TagScriptHostSocketEnabled,
+										CFSTR("script-host-socket-enabled"), Quills::Prefs::GENERAL);
 	My_PreferenceDefinition::create(kPreferences_TagScrollDelay,
 									CFSTR("terminal-scroll-delay-milliseconds"), typeNetEvents_CFNumberRef,
 									sizeof(EventTime), Quills::Prefs::SESSION);
@@ -1261,14 +1273,31 @@ Preferences_Init ()
 	if (nullptr == gPreferenceEventListenerModel) result = kPreferences_ResultNotInitialized;
 	else
 	{
-		// create ALL preferences contexts based on available data on disk;
+		// create preferences contexts based on available data on disk;
 		// these are retained in memory so that they may be used on demand
-		// by things like user interface elements and the Preferences window
-		result = createAllPreferencesContextsFromDisk();
+		// by things like user interface elements and the Preferences window;
+		// only the classes needed to restore windows are read right away,
+		// since every other class is loaded on first use (and any class
+		// that is still not loaded once startup is over is read then)
+		result = createPreferencesContextsFromDisk(Quills::Prefs::_RESTORE_AT_LAUNCH);
+		if (kPreferences_ResultOK == result)
+		{
+			result = createPreferencesContextsFromDisk(Quills::Prefs::WORKSPACE);
+		}
 		
 		// success!
 		gInitialized = true;
 		gInitializing = false;
+		
+		// the main queue will not run this until the application
+		// has finished starting up (and opened its first window)
+		dispatch_async(dispatch_get_main_queue(),
+		^{
+			if (gInitialized)
+			{
+				createRemainingPreferencesContextsFromDisk();
+			}
+		});
 	}
 	
 	// if keypads were open at last Quit, construct them now;
@@ -3835,8 +3864,10 @@ Preferences_StartMonitoring		(ListenerModel_ListenerRef	inListener,
 	// Preferences_StopMonitoring().
 	case kPreferences_TagArrangeWindowsUsingTabs:
 	case kPreferences_TagBellSound:
+	case kPreferences_TagCopySelectedText:
 	case kPreferences_TagCursorBlinks:
 	case kPreferences_TagDontDimBackgroundScreens:
+	case kPreferences_TagFadeBackgroundWindows:
 	case kPreferences_TagFocusFollowsMouse:
 	case kPreferences_TagKioskNoSystemFullScreenMode:
 	case kPreferences_TagMapBackquote:
@@ -3847,6 +3878,7 @@ Preferences_StartMonitoring		(ListenerModel_ListenerRef	inListener,
 	case kPreferences_TagTerminalCursorType:
 	case kPreferences_TagTerminalResizeAffectsFontSize:
 	case kPreferences_TagTerminalShowMarginAtColumn:
+	case kPreferences_TagVisualBell:
 	case kPreferences_ChangeContextName:
 	case kPreferences_ChangeNumberOfContexts:
 		result = assertInitialized();
@@ -3909,8 +3941,10 @@ Preferences_StopMonitoring	(ListenerModel_ListenerRef	inListener,
 	// Keep this in sync with Preferences_StartMonitoring().
 	case kPreferences_TagArrangeWindowsUsingTabs:
 	case kPreferences_TagBellSound:
+	case kPreferences_TagCopySelectedText:
 	case kPreferences_TagCursorBlinks:
 	case kPreferences_TagDontDimBackgroundScreens:
+	case kPreferences_TagFadeBackgroundWindows:
 	case kPreferences_TagFocusFollowsMouse:
 	case kPreferences_TagKioskNoSystemFullScreenMode:
 	case kPreferences_TagMapBackquote:
@@ -3920,6 +3954,7 @@ Preferences_StopMonitoring	(ListenerModel_ListenerRef	inListener,
 	case kPreferences_TagTerminalCursorType:
 	case kPreferences_TagTerminalResizeAffectsFontSize:
 	case kPreferences_TagTerminalShowMarginAtColumn:
+	case kPreferences_TagVisualBell:
 	case kPreferences_ChangeContextName:
 	case kPreferences_ChangeNumberOfContexts:
 		result = assertInitialized();
@@ -6017,138 +6052,167 @@ copyUserSpecifiedName		(CFDataRef		inNameExternalUnicodeDataValue,
 
 
 /*!
-Reads the preferences on disk and creates lists of
-preferences contexts for every collection that is found.
-This way, user interface elements (for instance) can
-maintain an accurate list of available collections, and
-attempts to create new contexts will simply add to that
-established list.
+Reads the preferences on disk and creates a list of
+preferences contexts for every collection of the given
+class that is found.  This way, user interface elements
+(for instance) can maintain an accurate list of available
+collections, and attempts to create new contexts will
+simply add to that established list.
 
-IMPORTANT:	Only do this once, preferably at startup.
+Each class is only read once; subsequent calls do nothing.
+This is called for a few classes at startup and otherwise
+on demand by getMutableListOfContexts().
 
-(3.1)
+(2017.10)
 */
 Preferences_Result
-createAllPreferencesContextsFromDisk ()
+createPreferencesContextsFromDisk	(Quills::Prefs::Class	inClass)
 {
-	typedef std::vector< Quills::Prefs::Class >		PrefClassList;
-	static Boolean			gWasCalled = false;
-	PrefClassList			allClassesSupportingCollections;
 	Preferences_Result		result = kPreferences_ResultOK;
+	Preferences_Result		prefsResult = kPreferences_ResultOK;
+	CFArrayRef				namesInClass = nullptr;
 	
 	
-	assert(false == gWasCalled);
-	gWasCalled = true;
+	if (gClassesLoadedFromDisk().end() != gClassesLoadedFromDisk().find(inClass))
+	{
+		// already loaded
+		return result;
+	}
+	
+	// mark the class as loaded first, since creating contexts
+	// below will call getMutableListOfContexts() for this class
+	gClassesLoadedFromDisk().insert(inClass);
 	
-	// for every class that can have collections, create ALL contexts
-	// (based on saved names) for that class, so that the list is current
-	allClassesSupportingCollections.push_back(Quills::Prefs::_RESTORE_AT_LAUNCH);
-	allClassesSupportingCollections.push_back(Quills::Prefs::WORKSPACE);
-	allClassesSupportingCollections.push_back(Quills::Prefs::SESSION);
-	allClassesSupportingCollections.push_back(Quills::Prefs::TERMINAL);
-	allClassesSupportingCollections.push_back(Quills::Prefs::FORMAT);
-	allClassesSupportingCollections.push_back(Quills::Prefs::MACRO_SET);
-	allClassesSupportingCollections.push_back(Quills::Prefs::TRANSLATION);
-	for (auto prefsClass : allClassesSupportingCollections)
+	prefsResult = copyClassDomainCFArray(inClass, namesInClass);
+	if ((nullptr != namesInClass) && (0 == CFArrayGetCount(namesInClass)) &&
+		(Quills::Prefs::FORMAT == inClass))
 	{
-		Preferences_Result		prefsResult = kPreferences_ResultOK;
-		CFArrayRef				namesInClass = nullptr;
+		// the Format type is a special case; if there are no user-custom
+		// collections yet, then copy in all the default color schemes
+		// (this gives the user a list of Formats by default)
+		CFArrayRef		fileNameArray = CFUtilities_ArrayCast(CFBundleGetValueForInfoDictionaryKey(AppResources_ReturnBundleForInfo(),
+																									CFSTR("MyDefaultFormatPropertyLists")));
+		CFIndex			fileNameCount = (fileNameArray) ? CFArrayGetCount(fileNameArray) : 0;
 		
 		
-		prefsResult = copyClassDomainCFArray(prefsClass, namesInClass);
-		if ((nullptr != namesInClass) && (0 == CFArrayGetCount(namesInClass)) &&
-			(Quills::Prefs::FORMAT == prefsClass))
+		for (CFIndex i = 0; i < fileNameCount; ++i)
 		{
-			// the Format type is a special case; if there are no user-custom
-			// collections yet, then copy in all the default color schemes
-			// (this gives the user a list of Formats by default)
-			CFArrayRef		fileNameArray = CFUtilities_ArrayCast(CFBundleGetValueForInfoDictionaryKey(AppResources_ReturnBundleForInfo(),
-																										CFSTR("MyDefaultFormatPropertyLists")));
-			CFIndex			fileNameCount = (fileNameArray) ? CFArrayGetCount(fileNameArray) : 0;
+			// read a default format into a context, then create a target
+			// context that will save it in the Format collections list
+			// using the same name as that of the source context
+			CFStringRef		fileNameNoExtension = CFUtilities_StringCast(CFArrayGetValueAtIndex(fileNameArray, i));
+			CFURLRef		fileURL = CFBundleCopyResourceURL(AppResources_ReturnApplicationBundle(), fileNameNoExtension,
+																CFSTR("plist")/* type string */, nullptr/* subdirectory path */);
 			
 			
-			for (CFIndex i = 0; i < fileNameCount; ++i)
+			if (nullptr != fileURL)
 			{
-				// read a default format into a context, then create a target
-				// context that will save it in the Format collections list
-				// using the same name as that of the source context
-				CFStringRef		fileNameNoExtension = CFUtilities_StringCast(CFArrayGetValueAtIndex(fileNameArray, i));
-				CFURLRef		fileURL = CFBundleCopyResourceURL(AppResources_ReturnApplicationBundle(), fileNameNoExtension,
-																	CFSTR("plist")/* type string */, nullptr/* subdirectory path */);
+				// create a class-specific context so that it will automatically
+				// be stored in the appropriate preferences domain on disk (the
+				// name is implicitly changed by copying in the source context)
+				Preferences_ContextWrap		savedFormat(Preferences_NewContextFromFavorites(Quills::Prefs::FORMAT, nullptr/* generate name */),
+														Preferences_ContextWrap::kAlreadyRetained);
 				
 				
-				if (nullptr != fileURL)
+				if (savedFormat.exists())
 				{
-					// create a class-specific context so that it will automatically
-					// be stored in the appropriate preferences domain on disk (the
-					// name is implicitly changed by copying in the source context)
-					Preferences_ContextWrap		savedFormat(Preferences_NewContextFromFavorites(Quills::Prefs::FORMAT, nullptr/* generate name */),
-															Preferences_ContextWrap::kAlreadyRetained);
+					CFStringRef		inferredName = nullptr;
 					
 					
-					if (savedFormat.exists())
+					prefsResult = Preferences_ContextMergeInXMLFileURL(savedFormat.returnRef(), fileURL,
+																		nullptr/* class */, &inferredName);
+					if (kPreferences_ResultOK == prefsResult)
 					{
-						CFStringRef		inferredName = nullptr;
-						
-						
-						prefsResult = Preferences_ContextMergeInXMLFileURL(savedFormat.returnRef(), fileURL,
-																			nullptr/* class */, &inferredName);
-						if (kPreferences_ResultOK == prefsResult)
+						if (nullptr != inferredName)
 						{
-							if (nullptr != inferredName)
-							{
-								prefsResult = Preferences_ContextRename(savedFormat.returnRef(), inferredName);
-								if (kPreferences_ResultOK != prefsResult)
-								{
-									Console_Warning(Console_WriteValueCFString,
-													"unable to rename default format; name should be", inferredName);
-								}
-							}
-							
-							prefsResult = Preferences_ContextSave(savedFormat.returnRef());
-							if (kPreferences_ResultOK == prefsResult)
+							prefsResult = Preferences_ContextRename(savedFormat.returnRef(), inferredName);
+							if (kPreferences_ResultOK != prefsResult)
 							{
-								// success!
+								Console_Warning(Console_WriteValueCFString,
+												"unable to rename default format; name should be", inferredName);
 							}
 						}
+						
+						prefsResult = Preferences_ContextSave(savedFormat.returnRef());
+						if (kPreferences_ResultOK == prefsResult)
+						{
+							// success!
+						}
 					}
-					CFRelease(fileURL), fileURL = nullptr;
 				}
+				CFRelease(fileURL), fileURL = nullptr;
 			}
-			
-			// now that the set of Formats has been changed, reinitialize the array
-			prefsResult = copyClassDomainCFArray(prefsClass, namesInClass);
 		}
 		
-		// create contexts for every domain that was found for this class
-		if (kPreferences_ResultOK == prefsResult)
+		// now that the set of Formats has been changed, reinitialize the array
+		prefsResult = copyClassDomainCFArray(inClass, namesInClass);
+	}
+	
+	// create contexts for every domain that was found for this class
+	if (kPreferences_ResultOK == prefsResult)
+	{
+		CFIndex const	kNumberOfFavorites = CFArrayGetCount(namesInClass);
+		
+		
+		for (CFIndex i = 0; i < kNumberOfFavorites; ++i)
 		{
-			CFIndex const	kNumberOfFavorites = CFArrayGetCount(namesInClass);
+			// simply creating a context will ensure it is retained
+			// internally; so, the return value can be ignored (save
+			// for verifying that it was created successfully)
+			CFStringRef const		kDomainName = CFUtilities_StringCast(CFArrayGetValueAtIndex
+																			(namesInClass, i));
+			CFRetainRelease			favoriteNameCFString(copyDomainUserSpecifiedName(kDomainName), CFRetainRelease::kAlreadyRetained);
+			Preferences_ContextRef	newContext = Preferences_NewContextFromFavorites(inClass, favoriteNameCFString.returnCFStringRef(), kDomainName);
 			
 			
-			for (CFIndex i = 0; i < kNumberOfFavorites; ++i)
+			if (nullptr == newContext)
 			{
-				// simply creating a context will ensure it is retained
-				// internally; so, the return value can be ignored (save
-				// for verifying that it was created successfully)
-				CFStringRef const		kDomainName = CFUtilities_StringCast(CFArrayGetValueAtIndex
-																				(namesInClass, i));
-				CFRetainRelease			favoriteNameCFString(copyDomainUserSpecifiedName(kDomainName), CFRetainRelease::kAlreadyRetained);
-				Preferences_ContextRef	newContext = Preferences_NewContextFromFavorites(prefsClass, favoriteNameCFString.returnCFStringRef(), kDomainName);
-				
-				
-				if (nullptr == newContext)
-				{
-					Console_Warning(Console_WriteValueCFString, "sister domain could not be loaded; core application preferences refer to missing domain", kDomainName);
-					Console_Warning(Console_WriteValueCFString, "user-specified name for missing domain", favoriteNameCFString.returnCFStringRef());
-				}
+				Console_Warning(Console_WriteValueCFString, "sister domain could not be loaded; core application preferences refer to missing domain", kDomainName);
+				Console_Warning(Console_WriteValueCFString, "user-specified name for missing domain", favoriteNameCFString.returnCFStringRef());
 			}
-			CFRelease(namesInClass), namesInClass = nullptr;
 		}
+		CFRelease(namesInClass), namesInClass = nullptr;
 	}
 	
 	return result;
-}// createAllPreferencesContextsFromDisk
+}// createPreferencesContextsFromDisk
+
+
+/*!
+Reads the preferences on disk for every collection class
+that has not been loaded yet.  This is deferred until the
+application has started, so that the first window is not
+delayed by things (such as Macros or Translations) that
+it does not need.
+
+(2017.10)
+*/
+void
+createRemainingPreferencesContextsFromDisk ()
+{
+	std::vector< Quills::Prefs::Class > const	kAllClassesSupportingCollections =
+												{
+													Quills::Prefs::_RESTORE_AT_LAUNCH,
+													Quills::Prefs::WORKSPACE,
+													Quills::Prefs::SESSION,
+													Quills::Prefs::TERMINAL,
+													Quills::Prefs::FORMAT,
+													Quills::Prefs::MACRO_SET,
+													Quills::Prefs::TRANSLATION,
+												};
+	
+	
+	for (auto prefsClass : kAllClassesSupportingCollections)
+	{
+		Preferences_Result		prefsResult = createPreferencesContextsFromDisk(prefsClass);
+		
+		
+		if (kPreferences_ResultOK != prefsResult)
+		{
+			Console_Warning(Console_WriteValue, "failed to load favorites from disk; preferences class", prefsClass);
+		}
+	}
+}// createRemainingPreferencesContextsFromDisk
 
 
 /*!
@@ -6679,6 +6743,7 @@ getGeneralPreference	(My_ContextInterfaceConstPtr	inContextPtr,
 				case kPreferences_TagKioskShowsWindowFrame:
 				case kPreferences_TagKioskNoSystemFullScreenMode:
 				case kPreferences_TagNoAnimations:
+				case kPreferences_TagScriptHostSocketEnabled:
 					if (false == inContextPtr->exists(keyName))
 					{
 						result = kPreferences_ResultBadVersionDataNotAvailable;
@@ -6715,6 +6780,20 @@ getGeneralPreference	(My_ContextInterfaceConstPtr	inContextPtr,
 					}
 					break;
 				
+				case kPreferences_TagPreSpawnedShellCount:
+				case kPreferences_TagPreSpawnedShellIdleTimeout:
+					assert(typeNetEvents_CFNumberRef == keyValueType);
+					if (false == inContextPtr->exists(keyName))
+					{
+						result = kPreferences_ResultBadVersionDataNotAvailable;
+					}
+					else
+					{
+						// zero is a valid value for both of these settings
+						*(REINTERPRET_CAST(outDataPtr, UInt16*)) = STATIC_CAST(inContextPtr->returnInteger(keyName), UInt16);
+					}
+					break;
+				
 				case kPreferences_TagTerminalShowMarginAtColumn:
 					assert(typeNetEvents_CFNumberRef == keyValueType);
 					if (false == inContextPtr->exists(keyName))
@@ -7288,6 +7367,9 @@ Retrieves a modifiable version of the list that stores any in-memory
 settings for the specified class (only works for classes that can be
 collections).  Returns true unless this fails.
 
+If the favorites of the class have not been read from disk yet, they
+are read before this returns.
+
 IMPORTANT:	Unless you have a reason to modify the list, prefer
 			the read-only accessor "getListOfContexts()".  The
 			presence of a pointer in this list has implications on
@@ -7343,6 +7425,13 @@ getMutableListOfContexts	(Quills::Prefs::Class			inClass,
 		break;
 	}
 	
+	// favorites are read from disk on first use (or shortly after
+	// startup); this does nothing if the class is already loaded
+	if ((result) && (gInitialized))
+	{
+		UNUSED_RETURN(Preferences_Result)createPreferencesContextsFromDisk(inClass);
+	}
+	
 	return result;
 }// getMutableListOfContexts
 
@@ -7550,6 +7639,7 @@ getSessionPreference	(My_ContextInterfaceConstPtr	inContextPtr,
 				case kPreferences_TagLineModeEnabled:
 				case kPreferences_TagLocalEchoEnabled:
 				case kPreferences_TagNoPasteWarning:
+				case kPreferences_TagPreSpawnedShellAllowed:
 				case kPreferences_TagTektronixPAGEClearsScreen:
 					// all of these keys have Core Foundation Boolean values
 					if (false == inContextPtr->exists(keyName))
@@ -9201,6 +9291,7 @@ setGeneralPreference	(My_ContextInterfacePtr		inContextPtr,
 					
 					assert(typeNetEvents_CFBooleanRef == keyValueType);
 					setApplicationPreference(keyName, (data) ? kCFBooleanTrue : kCFBooleanFalse);
+					changeNotify(inDataPreferenceTag, inContextPtr->selfRef);
 				}
 				break;
 			
@@ -9278,6 +9369,7 @@ setGeneralPreference	(My_ContextInterfacePtr		inContextPtr,
 					
 					assert(typeNetEvents_CFBooleanRef == keyValueType);
 					setApplicationPreference(keyName, (data) ? kCFBooleanTrue : kCFBooleanFalse);
+					changeNotify(inDataPreferenceTag, inContextPtr->selfRef);
 				}
 				break;
 			
@@ -9308,6 +9400,7 @@ setGeneralPreference	(My_ContextInterfacePtr		inContextPtr,
 			case kPreferences_TagKioskShowsScrollBar:
 			case kPreferences_TagKioskShowsWindowFrame:
 			case kPreferences_TagNoAnimations:
+			case kPreferences_TagScriptHostSocketEnabled:
 				{
 					Boolean const	data = *(REINTERPRET_CAST(inDataPtr, Boolean const*));
 					
@@ -9408,6 +9501,23 @@ setGeneralPreference	(My_ContextInterfacePtr		inContextPtr,
 				}
 				break;
 			
+			case kPreferences_TagPreSpawnedShellCount:
+			case kPreferences_TagPreSpawnedShellIdleTimeout:
+				{
+					UInt16 const	unsignedData = *(REINTERPRET_CAST(inDataPtr, UInt16 const*));
+					SInt32 const	data = STATIC_CAST(unsignedData, SInt32);
+					CFNumberRef		numberRef = CFNumberCreate(kCFAllocatorDefault, kCFNumberSInt32Type, &data);
+					
+					
+					if (nullptr != numberRef)
+					{
+						assert(typeNetEvents_CFNumberRef == keyValueType);
+						setApplicationPreference(keyName, numberRef);
+						CFRelease(numberRef), numberRef = nullptr;
+					}
+				}
+				break;
+			
 			case kPreferences_TagPureInverse:
 				{
 					Boolean const	data = *(REINTERPRET_CAST(inDataPtr, Boolean const*));
@@ -9996,6 +10106,7 @@ setSessionPreference	(My_ContextInterfacePtr		inContextPtr,
 			case kPreferences_TagLineModeEnabled:
 			case kPreferences_TagLocalEchoEnabled:
 			case kPreferences_TagNoPasteWarning:
+			case kPreferences_TagPreSpawnedShellAllowed:
 			case kPreferences_TagTektronixPAGEClearsScreen:
 				{
 					Boolean const	data = *(REINTERPRET_CAST(inDataPtr, Boolean const*));
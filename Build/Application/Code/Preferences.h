@@ -206,8 +206,11 @@ enum
 	kPreferences_TagNoAnimations						= 'nanm',	//!< data: "Boolean"
 	kPreferences_TagNotification						= 'noti',	//!< data: "SInt16", a "kAlert_Notify…" constant
 	kPreferences_TagNotifyOfBeeps						= 'bnot',	//!< data: "Boolean"
+	kPreferences_TagPreSpawnedShellCount				= 'pspc',	//!< data: "UInt16"; 0 turns off, otherwise the number of shells kept ready for new sessions
+	kPreferences_TagPreSpawnedShellIdleTimeout			= 'psit',	//!< data: "UInt16", seconds that an unused pre-spawned shell is kept
 	kPreferences_TagPureInverse							= 'pinv',	//!< data: "Boolean"
 	kPreferences_TagRandomTerminalFormats				= 'rfmt',	//!< data: "Boolean"
+	kPreferences_TagScriptHostSocketEnabled				= 'shso',	//!< data: "Boolean"; if true, scripting host processes can connect through a socket
 	kPreferences_TagTerminalCursorType					= 'curs',	//!< data: "TerminalView_CursorType"
 	kPreferences_TagTerminalResizeAffectsFontSize		= 'rszf',	//!< data: "Boolean"
 	kPreferences_TagTerminalShowMarginAtColumn			= 'smar',	//!< data: "UInt16"; 0 turns off, 1 is first column, etc.
@@ -269,6 +272,7 @@ enum
 	kPreferences_TagNewLineMapping						= 'newl',	//!< data: "UInt16" (Session_NewlineMode)
 	kPreferences_TagNoPasteWarning						= 'npwr',	//!< data: "Boolean"
 	kPreferences_TagPasteNewLineDelay					= 'pnld',	//!< data: "EventTime"; stored as milliseconds, but scaled to EventTime when used
+	kPreferences_TagPreSpawnedShellAllowed				= 'psok',	//!< data: "Boolean"; if true, the session may adopt a shell that was spawned ahead of time
 	kPreferences_TagScrollDelay							= 'scrd',	//!< data: "EventTime"; stored as milliseconds, but scaled to EventTime when used
 	kPreferences_TagServerHost							= 'host',	//!< data: "CFStringRef" (domain name or IP address)
 	kPreferences_TagServerPort							= 'port',	//!< data: "SInt16"
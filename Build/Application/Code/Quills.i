@@ -40,6 +40,7 @@ extern "C" void init_quills(void);
 %template(_long_list) std::vector< long >;
 %template(_long_pair) std::pair< long, long >;
 %template(_string_list) std::vector< std::string >;
+%template(_float_by_string) std::map< std::string, double >;
 %template(_string_by_long) std::map< long, std::string >;
 
 // enable callbacks to be written in Python
@@ -248,6 +249,39 @@ _Quills_PropagateExceptions		(void*			inResultObject,
 %}
 #endif
 
+// allow native code to run without holding the interpreter lock
+#ifdef SWIGPYTHON
+%{
+/*!
+Releases the Python global interpreter lock for the lifetime
+of the object, so that other Python threads can run while a
+wrapped function does lengthy native work.  Use this only in
+"%exception" blocks for functions that never call Python, and
+declare it inside the "try" so that the lock is reacquired
+before any exception is converted into a Python error.
+
+(2017.10)
+*/
+class _Quills_ReleaseGIL
+{
+public:
+	_Quills_ReleaseGIL ()
+	:
+	_threadState(PyEval_SaveThread())
+	{
+	}
+	
+	~_Quills_ReleaseGIL ()
+	{
+		PyEval_RestoreThread(_threadState);
+	}
+
+private:
+	PyThreadState*		_threadState;
+};
+%}
+#endif
+
 // enable callbacks that take a long-integer-vector argument and return a map from long-integer to string
 #ifdef SWIGPYTHON
 %{
@@ -323,6 +357,62 @@ CallPythonLongVectorReturnStringByLong	(void*							inPythonFunctionObject,
 %}
 #endif
 
+// enable callbacks that take a long-integer-vector argument and return nothing
+#ifdef SWIGPYTHON
+%{
+static void
+CallPythonLongVectorReturnVoid	(void*							inPythonFunctionObject,
+								 const std::vector< long >&		inLongVector)
+{
+	std::vector< long >::size_type const	kNumLongs = inLongVector.size();
+	PyObject*								pythonDef = nullptr;
+	PyObject*								list = nullptr;
+	PyObject*								arguments = nullptr;	
+	PyObject*								pythonResult = nullptr;
+	
+	
+	pythonDef = reinterpret_cast< PyObject* >(inPythonFunctionObject);
+	list = PyList_New(kNumLongs);
+	assert(nullptr != list);
+	for (size_t i = 0; i < kNumLongs; ++i)
+	{
+		PyObject*	argValue = PyLong_FromLong(inLongVector[i]);
+		
+		
+		if (nullptr == argValue)
+		{
+			Py_DECREF(list); list = nullptr;
+			throw _Quills_CallbackError("Unable to construct long integer object for argument list", pythonDef);
+		}
+		PyList_SET_ITEM(list, i, argValue);
+	}
+	arguments = Py_BuildValue("(N)", list); // steals the list reference
+	assert(nullptr != arguments);
+	pythonResult = PyEval_CallObject(pythonDef, arguments); // call Python
+	Py_DECREF(arguments); arguments = nullptr;
+	_Quills_PropagateExceptions(pythonResult, PyEval_GetFuncName(pythonDef), PyEval_GetFuncDesc(pythonDef));
+	Py_XDECREF(pythonResult); pythonResult = nullptr;
+}
+%}
+#endif
+
+// allow native code to give up a Python object that it was keeping
+#ifdef SWIGPYTHON
+%{
+static void
+ReleasePythonObject		(void*	inPythonObject)
+{
+	Py_XDECREF(reinterpret_cast< PyObject* >(inPythonObject));
+}
+
+static void
+RetainPythonObject		(void*	inPythonObject)
+{
+	Py_XINCREF(reinterpret_cast< PyObject* >(inPythonObject));
+}
+%}
+#endif
+
 // enable callbacks that take a single string argument and return nothing
 #ifdef SWIGPYTHON
 %{
@@ -54,6 +54,7 @@ typedef std::pair< long, long > (*FunctionReturnLongPairArg1VoidPtrArg2CharPtrAr
 typedef std::string (*FunctionReturnStringArg1VoidPtrArg2CharPtr) (void*, char*);
 typedef std::map< long, std::string > (*FunctionReturnStringByLongArg1VoidPtrArg2LongVector) (void*, const std::vector< long >&);
 typedef void (*FunctionReturnVoidArg1VoidPtrArg2CharPtr) (void*, char*);
+typedef void (*FunctionReturnVoidArg1VoidPtrArg2LongVector) (void*, const std::vector< long >&);
 typedef void (*FunctionReturnVoidArg1VoidPtr) (void*);
 
 } // namespace Quills
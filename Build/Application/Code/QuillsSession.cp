@@ -37,6 +37,7 @@
 #include <algorithm>
 #include <functional>
 #include <map>
+#include <set>
 #include <stdexcept>
 #include <string>
 #include <utility>
@@ -46,12 +47,16 @@
 #include <CFRetainRelease.h>
 #include <CFUtilities.h>
 #include <Console.h>
+#include <ListenerModel.h>
 #include <SoundSystem.h>
 #include <StringUtilities.h>
 
 // application includes
 #include "OtherApps.h"
+#include "Session.h"
 #include "SessionFactory.h"
+#include "Terminal.h"
+#include "TerminalWindow.h"
 #include "URL.h"
 
 
@@ -65,6 +70,38 @@ typedef std::map< std::string, MyFileHandlerPythonObjectPair >					MyFileHandler
 typedef std::pair< Quills::FunctionReturnVoidArg1VoidPtrArg2CharPtr, void* >	MyURLHandlerPythonObjectPair;
 typedef std::map< std::string, MyURLHandlerPythonObjectPair >					MyURLHandlerPythonObjectPairBySchema;
 
+/*!
+Collects the lines that change in a session’s terminal so that
+a Python callback can be notified of many changes at once.
+*/
+struct MyLineChangeBatch
+{
+	MyLineChangeBatch	(SessionRef, TerminalScreenRef, Quills::FunctionReturnVoidArg1VoidPtrArg2LongVector, void*,
+						 Quills::FunctionReturnVoidArg1VoidPtr, Quills::FunctionReturnVoidArg1VoidPtr);
+	~MyLineChangeBatch	();
+	
+	SessionRef												session;			//!< the session whose lines are watched
+	TerminalScreenRef										screen;				//!< source of change notifications
+	Quills::FunctionReturnVoidArg1VoidPtrArg2LongVector		invoker;			//!< calls "pythonCallback" with a line list
+	void*													pythonCallback;		//!< registered Python function
+	Quills::FunctionReturnVoidArg1VoidPtr					retainer;			//!< adds a reference to "pythonCallback"
+	Quills::FunctionReturnVoidArg1VoidPtr					releaser;			//!< gives up a reference to "pythonCallback"
+	ListenerModel_ListenerWrap								screenListener;		//!< receives kTerminal_ChangeTextEdited
+	std::set< long >										changedLines;		//!< lines changed since the last delivery
+	bool													isDeliveryPending;	//!< has a delivery been scheduled on the main queue?
+};
+typedef std::map< SessionRef, MyLineChangeBatch* >		MyLineChangeBatchBySession;
+
+
+} // anonymous namespace
+
+#pragma mark Internal Method Prototypes
+namespace {
+
+void	deliverLineChanges		(SessionRef);
+void	forgetLineChanges		(SessionRef);
+void	lineChangeScreenChanged	(ListenerModel_Ref, ListenerModel_Event, void*, void*);
+void	sessionChanged			(ListenerModel_Ref, ListenerModel_Event, void*, void*);
 
 } // anonymous namespace
 
@@ -83,6 +120,14 @@ MyURLHandlerPythonObjectPairBySchema&							gURLOpenCallbackInvokerPythonObjectP
 																{
 																	static MyURLHandlerPythonObjectPairBySchema x; return x;
 																}
+MyLineChangeBatchBySession&										gLineChangeBatchesBySession ()
+																{
+																	static MyLineChangeBatchBySession x; return x;
+																}
+ListenerModel_ListenerWrap&										gSessionChangeListener ()
+																{
+																	static ListenerModel_ListenerWrap x; return x;
+																}
 std::string														gKeepAliveText(" "); // note; to override default, use Python
 
 } // anonymous namespace
@@ -229,6 +274,164 @@ Session::state_string ()
 }// state_string
 
 
+/*!
+See header or "pydoc" for Python docstrings.
+
+(2017.10)
+*/
+std::map< std::string, double >
+Session::statistics ()
+{
+	std::map< std::string, double >		result;
+	
+	
+	if (nullptr == _session)
+	{
+		QUILLS_THROW_MSG("specified session does not have this information");
+	}
+	else
+	{
+		Session_Statistics	sessionStatistics;
+		Session_Result		sessionResult = Session_GetStatistics(_session, sessionStatistics);
+		
+		
+		if (false == sessionResult.ok())
+		{
+			QUILLS_THROW_MSG("unable to find statistics for session");
+		}
+		result["bytes_read"] = sessionStatistics.bytesRead;
+		result["bytes_parsed"] = sessionStatistics.bytesParsed;
+		result["parse_seconds"] = sessionStatistics.parseTime;
+		result["echo_characters"] = sessionStatistics.echoCharacterCount;
+		result["scrollback_lines"] = sessionStatistics.scrollbackLineCount;
+		result["render_seconds"] = sessionStatistics.renderTime;
+		result["render_frames"] = sessionStatistics.renderFrameCount;
+		result["coalesced_frames"] = sessionStatistics.coalescedFrameCount;
+	}
+	return result;
+}// statistics
+
+
+/*!
+See header or "pydoc" for Python docstrings.
+
+(2017.10)
+*/
+std::string
+Session::text_lines		(long	inFirstLine,
+						 long	inLineCount)
+{
+	std::string		result;
+	
+	
+	if (nullptr == _session)
+	{
+		QUILLS_THROW_MSG("specified session does not have this information");
+	}
+	else
+	{
+		TerminalWindowRef	terminalWindow = Session_ReturnActiveTerminalWindow(_session);
+		TerminalScreenRef	screen = (nullptr == terminalWindow)
+										? nullptr
+										: TerminalWindow_ReturnScreenWithFocus(terminalWindow);
+		
+		
+		if (nullptr == screen)
+		{
+			QUILLS_THROW_MSG("specified session has no terminal");
+		}
+		else
+		{
+			long const	kFirstLine = std::max(inFirstLine, -STATIC_CAST(Terminal_ReturnInvisibleRowCount(screen), long));
+			long const	kPastEndLine = std::min(inFirstLine + std::max(inLineCount, 0L),
+												STATIC_CAST(Terminal_ReturnRowCount(screen), long));
+			
+			
+			if (kPastEndLine > kFirstLine)
+			{
+				Terminal_LineStackStorage	lineIteratorData;
+				Terminal_LineRef			lineIterator = (kFirstLine < 0)
+															? Terminal_NewScrollbackLineIterator(screen, STATIC_CAST(-kFirstLine - 1, UInt32),
+																									&lineIteratorData)
+															: Terminal_NewMainScreenLineIterator(screen, STATIC_CAST(kFirstLine, UInt16),
+																									&lineIteratorData);
+				
+				
+				if (nullptr == lineIterator)
+				{
+					QUILLS_THROW_MSG("unable to find first line " << kFirstLine);
+				}
+				
+				// all rows are exported in a single pass (crossing from the
+				// scrollback into the main screen if necessary), and each
+				// chunk is appended directly to the result
+				result.reserve(STATIC_CAST(kPastEndLine - kFirstLine, size_t) * (1 + Terminal_ReturnColumnCount(screen)));
+				if (kTerminal_ResultOK != Terminal_CopyRangeToSink(screen, lineIterator, STATIC_CAST(kPastEndLine - kFirstLine, UInt32),
+																	0/* first column */, -1/* past-end column; -1 means “last column” */,
+																	kTerminal_TextCopyFlagsLineSeparatorLF |
+																	kTerminal_TextCopyFlagsLastLineHasSeparator |
+																	kTerminal_TextCopyFlagsAlwaysNewLineAtRightMargin,
+																	0/* spaces to tab, or 0 */,
+																	[](UInt8 const* inUTF8Bytes, size_t inByteCount, void* inStringPtr) -> Boolean
+																	{
+																		REINTERPRET_CAST(inStringPtr, std::string*)->append
+																		(REINTERPRET_CAST(inUTF8Bytes, char const*), inByteCount);
+																		return true;
+																	}, &result))
+				{
+					Terminal_DisposeLineIterator(&lineIterator);
+					QUILLS_THROW_MSG("failed to read lines from terminal");
+				}
+				Terminal_DisposeLineIterator(&lineIterator);
+			}
+		}
+	}
+	return result;
+}// text_lines
+
+
+/*!
+See header or "pydoc" for Python docstrings.
+
+(2017.10)
+*/
+void
+Session::add_url_pattern	(std::string	inPrefix,
+							 std::string	inURLTemplate,
+							 std::string	inTail)
+{
+	CFRetainRelease		prefixCFString(CFStringCreateWithCString(kCFAllocatorDefault, inPrefix.c_str(), kCFStringEncodingUTF8),
+										CFRetainRelease::kAlreadyRetained);
+	CFRetainRelease		templateCFString(CFStringCreateWithCString(kCFAllocatorDefault, inURLTemplate.c_str(), kCFStringEncodingUTF8),
+											CFRetainRelease::kAlreadyRetained);
+	URL_PatternTail		tail = kURL_PatternTailDigits;
+	
+	
+	if ("digits" == inTail)
+	{
+		tail = kURL_PatternTailDigits;
+	}
+	else if ("name" == inTail)
+	{
+		tail = kURL_PatternTailName;
+	}
+	else if ("url" == inTail)
+	{
+		tail = kURL_PatternTailURL;
+	}
+	else
+	{
+		QUILLS_THROW_MSG("unrecognized pattern tail '" << inTail << "'; expected 'digits', 'name' or 'url'");
+	}
+	
+	if ((false == prefixCFString.exists()) || (false == templateCFString.exists()) ||
+		(false == URL_AddPattern(prefixCFString.returnCFStringRef(), tail, templateCFString.returnCFStringRef())))
+	{
+		QUILLS_THROW_MSG("failed to add URL pattern for prefix '" << inPrefix << "' (the prefix must be ASCII and the template must contain '%@')");
+	}
+}// add_url_pattern
+
+
 /*!
 See header or "pydoc" for Python docstrings.
 
@@ -553,6 +756,279 @@ Session::_stop_urlopen_call_py	(FunctionReturnVoidArg1VoidPtrArg2CharPtr	inRouti
 }// _stop_urlopen_call_py
 
 
+/*!
+See header or "pydoc" for Python docstrings.
+
+(2017.10)
+*/
+void
+Session::_on_lines_change_call_py	(FunctionReturnVoidArg1VoidPtrArg2LongVector	inRoutine,
+									 void*											inPythonFunctionObject,
+									 FunctionReturnVoidArg1VoidPtr					inRetainRoutine,
+									 FunctionReturnVoidArg1VoidPtr					inReleaseRoutine)
+{
+	TerminalWindowRef	terminalWindow = (nullptr == _session) ? nullptr : Session_ReturnActiveTerminalWindow(_session);
+	TerminalScreenRef	screen = (nullptr == terminalWindow) ? nullptr : TerminalWindow_ReturnScreenWithFocus(terminalWindow);
+	
+	
+	if (nullptr == screen)
+	{
+		QUILLS_THROW_MSG("specified session has no terminal to monitor");
+	}
+	
+	// only one callback is allowed per session
+	_stop_lines_change_call_py();
+	gLineChangeBatchesBySession()[_session] = new MyLineChangeBatch(_session, screen, inRoutine, inPythonFunctionObject,
+																	inRetainRoutine, inReleaseRoutine);
+	
+	// the first callback causes session changes to be monitored, so
+	// that callbacks can be forgotten when their sessions are closed
+	if (false == gSessionChangeListener().exists())
+	{
+		gSessionChangeListener() = ListenerModel_ListenerWrap(ListenerModel_NewStandardListener(sessionChanged),
+																ListenerModel_ListenerWrap::kAlreadyRetained);
+		SessionFactory_StartMonitoringSessions(kSession_ChangeState, gSessionChangeListener().returnRef());
+		SessionFactory_StartMonitoringSessions(kSession_ChangeWindowInvalid, gSessionChangeListener().returnRef());
+	}
+}// _on_lines_change_call_py
+
+
+/*!
+See header or "pydoc" for Python docstrings.
+
+(2017.10)
+*/
+void
+Session::_stop_lines_change_call_py ()
+{
+	forgetLineChanges(_session);
+}// _stop_lines_change_call_py
+
+
 } // namespace Quills
 
+
+#pragma mark Internal Methods
+namespace {
+
+/*!
+Constructor.  Starts monitoring the given screen.  The given
+Python callback must already be retained; the reference is
+given up (using the release routine) by the destructor.  The
+retain routine is used to keep the callback alive while it is
+being invoked (see deliverLineChanges()).
+
+(2017.10)
+*/
+MyLineChangeBatch::
+MyLineChangeBatch	(SessionRef												inSession,
+					 TerminalScreenRef										inScreen,
+					 Quills::FunctionReturnVoidArg1VoidPtrArg2LongVector	inInvoker,
+					 void*													inPythonCallback,
+					 Quills::FunctionReturnVoidArg1VoidPtr					inRetainer,
+					 Quills::FunctionReturnVoidArg1VoidPtr					inReleaser)
+:
+session(inSession),
+screen(inScreen),
+invoker(inInvoker),
+pythonCallback(inPythonCallback),
+retainer(inRetainer),
+releaser(inReleaser),
+screenListener(ListenerModel_NewStandardListener(lineChangeScreenChanged, this/* context */),
+				ListenerModel_ListenerWrap::kAlreadyRetained),
+changedLines(),
+isDeliveryPending(false)
+{
+	Terminal_StartMonitoring(this->screen, kTerminal_ChangeTextEdited, this->screenListener.returnRef());
+}// MyLineChangeBatch 6-argument constructor
+
+
+/*!
+Destructor.  Stops monitoring the screen and releases the
+Python callback; any delivery that is still scheduled will
+find no batch, and do nothing.
+
+(2017.10)
+*/
+MyLineChangeBatch::
+~MyLineChangeBatch ()
+{
+	Terminal_StopMonitoring(this->screen, kTerminal_ChangeTextEdited, this->screenListener.returnRef());
+	if (nullptr != this->releaser)
+	{
+		(*(this->releaser))(this->pythonCallback);
+	}
+}// MyLineChangeBatch destructor
+
+
+/*!
+Invokes the Python callback for the given session with every
+line that has changed since the last delivery.
+
+The callback may replace or stop itself (destroying the batch)
+so the batch is not used once the callback is invoked, and the
+callback holds its own reference for the duration of the call.
+
+(2017.10)
+*/
+void
+deliverLineChanges	(SessionRef		inSession)
+{
+	auto	toBatch = gLineChangeBatchesBySession().find(inSession);
+	
+	
+	if (gLineChangeBatchesBySession().end() != toBatch)
+	{
+		MyLineChangeBatch*										batchPtr = toBatch->second;
+		std::vector< long >										lineList(batchPtr->changedLines.begin(), batchPtr->changedLines.end());
+		Quills::FunctionReturnVoidArg1VoidPtrArg2LongVector		invoker = batchPtr->invoker;
+		void*													pythonCallback = batchPtr->pythonCallback;
+		Quills::FunctionReturnVoidArg1VoidPtr					retainer = batchPtr->retainer;
+		Quills::FunctionReturnVoidArg1VoidPtr					releaser = batchPtr->releaser;
+		
+		
+		// reset first, as the callback might cause more changes
+		batchPtr->changedLines.clear();
+		batchPtr->isDeliveryPending = false;
+		batchPtr = nullptr; // IMPORTANT: the callback may destroy the batch
+		
+		if (false == lineList.empty())
+		{
+			if (nullptr != retainer)
+			{
+				(*retainer)(pythonCallback);
+			}
+			try
+			{
+				(*invoker)(pythonCallback, lineList);
+			}
+			catch (std::exception const&	e)
+			{
+				CFStringRef			titleCFString = CFSTR("Exception while delivering terminal line changes"); // LOCALIZE THIS
+				CFRetainRelease		messageCFString(CFStringCreateWithCString
+													(kCFAllocatorDefault, e.what(), kCFStringEncodingUTF8),
+													CFRetainRelease::kAlreadyRetained); // LOCALIZE THIS?
+				
+				
+				Console_WriteScriptError(titleCFString, messageCFString.returnCFStringRef());
+			}
+			if (nullptr != releaser)
+			{
+				(*releaser)(pythonCallback);
+			}
+		}
+	}
+}// deliverLineChanges
+
+
+/*!
+Destroys the line change batch of the given session, if any,
+so that its Python callback is no longer invoked (or retained).
+
+(2017.10)
+*/
+void
+forgetLineChanges	(SessionRef		inSession)
+{
+	auto	toBatch = gLineChangeBatchesBySession().find(inSession);
+	
+	
+	if (gLineChangeBatchesBySession().end() != toBatch)
+	{
+		delete toBatch->second;
+		gLineChangeBatchesBySession().erase(toBatch);
+	}
+}// forgetLineChanges
+
+
+/*!
+Invoked whenever text changes in a terminal that a Python
+callback is watching (see on_lines_change_call()).  The
+changed lines are only recorded; a single delivery is then
+scheduled for the next pass of the main event loop, so that
+a burst of output does not call into Python repeatedly.
+
+(2017.10)
+*/
+void
+lineChangeScreenChanged		(ListenerModel_Ref		UNUSED_ARGUMENT(inUnusedModel),
+							 ListenerModel_Event	inTerminalChange,
+							 void*					inEventContextPtr,
+							 void*					inBatchPtr)
+{
+	MyLineChangeBatch*	batchPtr = REINTERPRET_CAST(inBatchPtr, MyLineChangeBatch*);
+	
+	
+	switch (inTerminalChange)
+	{
+	case kTerminal_ChangeTextEdited:
+		{
+			Terminal_RangeDescriptionConstPtr	rangeInfoPtr = REINTERPRET_CAST(inEventContextPtr,
+																				Terminal_RangeDescriptionConstPtr);
+			
+			
+			for (UInt32 i = 0; i < rangeInfoPtr->rowCount; ++i)
+			{
+				batchPtr->changedLines.insert(rangeInfoPtr->firstRow + STATIC_CAST(i, long));
+			}
+			
+			unless (batchPtr->isDeliveryPending)
+			{
+				SessionRef		session = batchPtr->session;
+				
+				
+				batchPtr->isDeliveryPending = true;
+				dispatch_async(dispatch_get_main_queue(),
+				^{
+					deliverLineChanges(session);
+				});
+			}
+		}
+		break;
+	
+	default:
+		// ???
+		break;
+	}
+}// lineChangeScreenChanged
+
+
+/*!
+Invoked whenever a session changes state or its terminal is
+about to be destroyed.  Any line change callback of the session
+is forgotten before the session (or its screen) goes away.
+
+(2017.10)
+*/
+void
+sessionChanged	(ListenerModel_Ref		UNUSED_ARGUMENT(inUnusedModel),
+				 ListenerModel_Event	inSessionChange,
+				 void*					inEventContextPtr,
+				 void*					UNUSED_ARGUMENT(inListenerContextPtr))
+{
+	SessionRef		session = REINTERPRET_CAST(inEventContextPtr, SessionRef);
+	
+	
+	switch (inSessionChange)
+	{
+	case kSession_ChangeState:
+		if (kSession_StateImminentDisposal == Session_ReturnState(session))
+		{
+			forgetLineChanges(session);
+		}
+		break;
+	
+	case kSession_ChangeWindowInvalid:
+		// the terminal is about to be destroyed
+		forgetLineChanges(session);
+		break;
+	
+	default:
+		// ???
+		break;
+	}
+}// sessionChanged
+
+} // anonymous namespace
+
 // BELOW IS REQUIRED NEWLINE TO END FILE
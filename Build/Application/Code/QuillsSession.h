@@ -135,6 +135,100 @@ The character encoding is UTF-8.\n\
 #endif
 	std::string state_string ();
 	
+#if SWIG
+%feature("docstring",
+"Return a dictionary of running totals that describe the data\n\
+handled by the session so far.  Keys are strings and values are\n\
+numbers; the counts are never reset, so take two samples and\n\
+subtract them to find a rate.\n\
+\n\
+The keys are: 'bytes_read' (from the running process),\n\
+'bytes_parsed' (by terminal emulators), 'parse_seconds',\n\
+'echo_characters', 'scrollback_lines', 'render_seconds',\n\
+'render_frames' and 'coalesced_frames' (invalidations that\n\
+were merged into a refresh that was already pending).\n\
+") statistics;
+
+// raise Python exception if C++ throws anything
+%exception statistics
+{
+	try
+	{
+		$action
+	}
+	SWIG_CATCH_STDEXCEPT // catch various std::exception derivatives
+	QUILLS_CATCH_ALL
+}
+#endif
+	std::map< std::string, double > statistics ();
+	
+#if SWIG
+%feature("docstring",
+"Return the text of a range of lines in the session’s terminal\n\
+as a single string, with a new-line after every line.  Line 0\n\
+is the top of the main screen and negative numbers refer to\n\
+scrollback lines (-1 is the line that most recently scrolled\n\
+off the top).  The range is clipped to the lines that exist so\n\
+you can ask for more than you need; for example, a range of\n\
+(-1000000, 2000000) returns all text.\n\
+\n\
+The text is exported in one pass into a single buffer while\n\
+the Python interpreter lock is released (other Python threads\n\
+continue to run), so this is much faster than reading lines\n\
+one at a time.\n\
+\n\
+The character encoding is UTF-8.\n\
+") text_lines;
+
+// raise Python exception if C++ throws anything; also, the
+// export does not use Python so the interpreter is unlocked
+%exception text_lines
+{
+	try
+	{
+		_Quills_ReleaseGIL	unlockedInterpreter;
+		
+		
+		$action
+	}
+	SWIG_CATCH_STDEXCEPT // catch various std::exception derivatives
+	QUILLS_CATCH_ALL
+}
+#endif
+	std::string text_lines (long	first_line,
+							long	line_count);
+	
+#if SWIG
+%feature("docstring",
+"Recognize text in terminal windows that starts with the given\n\
+prefix, so that it can be command-clicked to open a URL.  The\n\
+URL is created by replacing every '%@' in the given template\n\
+with the matching text.  The prefix is not case-sensitive, and\n\
+must use only ASCII characters.\n\
+\n\
+The tail determines what can follow the prefix: 'digits' (for\n\
+example, ticket numbers), 'name' (letters, digits, periods,\n\
+hyphens and underscores, such as host names) or 'url'.\n\
+\n\
+For example, add_url_pattern('BUG-', 'https://x.com/?id=%@')\n\
+allows 'BUG-123' to open 'https://x.com/?id=BUG-123'.\n\
+") add_url_pattern;
+
+// raise Python exception if C++ throws anything
+%exception add_url_pattern
+{
+	try
+	{
+		$action
+	}
+	SWIG_CATCH_STDEXCEPT // catch various std::exception derivatives
+	QUILLS_CATCH_ALL
+}
+#endif
+	static void add_url_pattern (std::string	prefix,
+								 std::string	url_template,
+								 std::string	tail = "digits");
+	
 #if SWIG
 %feature("docstring",
 "Either invoke a Python callback to handle the specified file,\n\
@@ -239,6 +333,9 @@ single space is typical.\n\
 	static void _stop_fileopen_ext_call_py (Quills::FunctionReturnVoidArg1VoidPtrArg2CharPtr, std::string);
 	static void _stop_new_call_py (Quills::FunctionReturnVoidArg1VoidPtr);
 	static void _stop_urlopen_call_py (Quills::FunctionReturnVoidArg1VoidPtrArg2CharPtr, std::string);
+	void _on_lines_change_call_py (Quills::FunctionReturnVoidArg1VoidPtrArg2LongVector, void*, Quills::FunctionReturnVoidArg1VoidPtr,
+									Quills::FunctionReturnVoidArg1VoidPtr);
+	void _stop_lines_change_call_py ();
 
 private:
 	SessionRef		_session;
@@ -246,7 +343,46 @@ private:
 
 // callback support
 #if SWIG
+// raise Python exception if C++ throws anything
+%exception on_lines_change_call
+{
+	try
+	{
+		$action
+	}
+	SWIG_CATCH_STDEXCEPT // catch various std::exception derivatives
+	QUILLS_CATCH_ALL
+}
+
 %extend Session {
+%feature("docstring",
+"Register a Python function to be called, with a list of line\n\
+numbers (as used by text_lines()), after text changes in the\n\
+session’s terminal.  Changes are collected and delivered at\n\
+most once per pass of the event loop: a burst of output results\n\
+in one call with every affected line (in ascending order, each\n\
+appearing only once), not one call per change.\n\
+\n\
+Use text_lines() to read the changed text efficiently.\n\
+\n\
+Only one function can be registered for each session; another\n\
+registration replaces the previous function.  The function is\n\
+forgotten automatically when the session is closed.\n\
+") on_lines_change_call;
+	// NOTE: "PyObject* inPythonFunction" is typemapped in Quills.i;
+	// "CallPythonLongVectorReturnVoid", "RetainPythonObject" and
+	// "ReleasePythonObject" are defined in Quills.i; the reference is
+	// released by the session when the function is replaced, stopped
+	// or its session closes
+	void
+	on_lines_change_call	(PyObject*	inPythonFunction)
+	{
+		$self->_on_lines_change_call_py(CallPythonLongVectorReturnVoid, reinterpret_cast< void* >(inPythonFunction),
+										RetainPythonObject, ReleasePythonObject);
+		Py_INCREF(inPythonFunction);
+	}
+	
+
 %feature("docstring",
 "Register a Python function to be called, with a single string\n\
 argument, every time an open is requested for a file with the\n\
@@ -383,6 +519,19 @@ to undo the effects of a previous call to on_fileopen_call().\n\
 		}
 	}
 	
+%feature("docstring",
+"Prevent a Python function from being called when text changes\n\
+in the session’s terminal.  This would be to undo the effects\n\
+of a previous call to on_lines_change_call().\n\
+") stop_lines_change_call;
+	// NOTE: "PyObject* inPythonFunction" is typemapped in Quills.i;
+	// the registered function’s reference is released by the session
+	void
+	stop_lines_change_call	(PyObject*	inPythonFunction)
+	{
+		$self->_stop_lines_change_call_py();
+	}
+	
 %feature("docstring",
 "Prevent a Python function from being called when sessions are\n\
 created.  This would be to undo the effects of a previous call\n\
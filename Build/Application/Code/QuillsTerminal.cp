@@ -40,8 +40,12 @@
 #include <vector>
 
 // library includes
+#include <CFRetainRelease.h>
 #include <Console.h>
 
+// application includes
+#include "TerminalView.h"
+
 
 
 #pragma mark variables
@@ -70,6 +74,26 @@ Terminal::set_dumb_string_for_char	(unsigned short		unicode,
 }
 
 
+/*!
+See header or "pydoc" for Python docstrings.
+
+(2017.10)
+*/
+void
+Terminal::set_word_separator_chars	(std::string	characters_utf8)
+{
+	CFRetainRelease		asCFString(CFStringCreateWithCString(kCFAllocatorDefault, characters_utf8.c_str(), kCFStringEncodingUTF8),
+									CFRetainRelease::kAlreadyRetained);
+	
+	
+	if (false == asCFString.exists())
+	{
+		throw std::invalid_argument("separator characters must use UTF-8 encoding");
+	}
+	TerminalView_SetWordSeparatorCharacters(asCFString.returnCFStringRef());
+}// set_word_separator_chars
+
+
 /*!
 See header or "pydoc" for Python docstrings.
 
@@ -114,6 +138,20 @@ Terminal::_on_seekword_call_py	(FunctionReturnLongPairArg1VoidPtrArg2CharPtrArg3
 }// _on_seekword_call_py
 
 
+/*!
+Returns true only if on_seekword_call() has registered a
+routine, in which case word_of_char_in_string() will use it.
+Otherwise, callers may use a faster native word finder.
+
+(2017.10)
+*/
+bool
+Terminal::_has_seekword_call ()
+{
+	return (nullptr != gTerminalSeekWordCallbackInvoker);
+}// _has_seekword_call
+
+
 } // namespace Quills
 
 // BELOW IS REQUIRED NEWLINE TO END FILE
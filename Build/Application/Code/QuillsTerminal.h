@@ -88,8 +88,10 @@ first element, and the second element is 1.\n\
 \n\
 The character encoding of the given string must be UTF-8.\n\
 \n\
-Note that this calls what was registered with on_seekword_call(),\n\
-and MacTerm installs its own routine by default.\n\
+Note that this calls what was registered with on_seekword_call();\n\
+if nothing is registered, the range is always the default above.\n\
+(MacTerm no longer installs a routine by default; double-clicks\n\
+use a faster built-in word finder unless one is registered.)\n\
 ") word_of_char_in_string;
 
 // raise Python exception if C++ throws anything
@@ -106,8 +108,26 @@ and MacTerm installs its own routine by default.\n\
 	static std::pair<long, long> word_of_char_in_string		(std::string	text_utf8,
 															 long			offset);
 	
+#if SWIG
+%feature("docstring",
+"Specify characters (in addition to white space) that separate\n\
+words for the built-in word finder used by double-clicks.  Pass\n\
+an empty string to restore the default.  URLs are still selected\n\
+entirely even if they contain separator characters.\n\
+\n\
+This has no effect if on_seekword_call() has registered a word\n\
+finder.\n\
+\n\
+The character encoding of the given string must be UTF-8.\n\
+") set_word_separator_chars;
+#endif
+	static void set_word_separator_chars	(std::string	characters_utf8);
+	
 	// only intended for direct use by the SWIG wrapper
 	static void _on_seekword_call_py 	(Quills::FunctionReturnLongPairArg1VoidPtrArg2CharPtrArg3Long, void*);
+	
+	// only intended for use by MacTerm
+	static bool _has_seekword_call	();
 };
 
 #if SWIG
@@ -0,0 +1,3005 @@
+/*!	\file ScriptHost.cp
+	\brief Serves sessions to scripts that run in another
+	process, using the protocol in "ScriptHostProtocol.h"
+	over a local (UNIX domain) socket.
+*/
+/*###############################################################
+
+	MacTerm
+		© 1998-2017 by Kevin Grant.
+		© 2001-2003 by Ian Anderson.
+		© 1986-1994 University of Illinois Board of Trustees
+		(see About box for full list of U of I contributors).
+	
+	This program is free software; you can redistribute it or
+	modify it under the terms of the GNU General Public License
+	as published by the Free Software Foundation; either version
+	2 of the License, or (at your option) any later version.
+	
+	This program is distributed in the hope that it will be
+	useful, but WITHOUT ANY WARRANTY; without even the implied
+	warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR
+	PURPOSE.  See the GNU General Public License for more
+	details.
+	
+	You should have received a copy of the GNU General Public
+	License along with this program; if not, write to:
+	
+		Free Software Foundation, Inc.
+		59 Temple Place, Suite 330
+		Boston, MA  02111-1307
+		USA
+
+###############################################################*/
+
+#include "ScriptHost.h"
+#include <UniversalDefines.h>
+
+// standard-C includes
+#include <climits>
+#include <cstdint>
+#include <cstring>
+
+// standard-C++ includes
+#include <algorithm>
+#include <deque>
+#include <map>
+#include <set>
+#include <string>
+#include <vector>
+
+// UNIX includes
+extern "C"
+{
+#	include <errno.h>
+#	include <fcntl.h>
+#	include <unistd.h>
+#	include <sys/socket.h>
+#	include <sys/stat.h>
+#	include <sys/types.h>
+#	include <sys/un.h>
+}
+
+// Mac includes
+#include <CoreFoundation/CoreFoundation.h>
+
+// library includes
+#include <CFRetainRelease.h>
+#include <Console.h>
+#include <ListenerModel.h>
+#include <ScriptHostProtocol.h>
+
+// application includes
+#include "Preferences.h"
+#include "Session.h"
+#include "SessionFactory.h"
+#include "Terminal.h"
+#include "TerminalWindow.h"
+#include "TextAttributes.h"
+
+
+
+#pragma mark Constants
+namespace {
+
+size_t const	kMy_OutputHighWaterMark = (1024 * 1024);	//!< requests are not read while more than this many reply bytes are unsent
+size_t const	kMy_OutputLowWaterMark = (64 * 1024);		//!< reading resumes once unsent reply bytes fall below this
+size_t const	kMy_ReadBufferSize = (64 * 1024);			//!< maximum number of bytes read from a client at once
+UInt16 const	kMy_MaximumHeadlessRowCount = 512;			//!< largest main screen that a client may request for a headless session
+UInt32 const	kMy_MaximumHeadlessScrollbackRowCount = USHRT_MAX;	//!< larger scrollback requests for headless sessions are reduced to this
+
+// attributes are sent as two 32-bit halves
+TextAttributes_Object::BitRange const	kMy_AttributeBitsLower(0xFFFFFFFF, 0);
+TextAttributes_Object::BitRange const	kMy_AttributeBitsUpper(0xFFFFFFFF, 32);
+
+} // anonymous namespace
+
+#pragma mark Types
+namespace {
+
+/*!
+An event that is waiting for the client to grant credit.
+*/
+struct My_PendingEvent
+{
+	UInt16		type;		//!< a ScriptHostProtocol_MessageType for a session event
+	UInt32		sessionID;	//!< the session that the event is about
+};
+
+typedef std::map< UInt32, std::set< SInt32 > >		My_LineSetBySessionID;
+
+/*!
+Where the text of a “read lines” reply is exported.  Lines are
+only sent whole, so the byte count of the last complete line
+is remembered in case the reply fills up.
+*/
+struct My_LineReplySink
+{
+	ScriptHostProtocol_Writer*	writer;				//!< the reply frame
+	size_t						byteLimit;			//!< most text bytes that fit in the reply
+	size_t						byteCount;			//!< text bytes appended so far
+	size_t						wholeLineByteCount;	//!< text bytes up to and including the last new-line
+	bool						isFull;				//!< true if some text did not fit
+};
+
+/*!
+Cells in one row that share attributes, as they are sent in
+a screen update.
+*/
+struct My_RowRun
+{
+	UInt16					firstColumn;	//!< zero-based column of the first cell
+	UInt16					columnCount;	//!< number of cells
+	TextAttributes_Object	attributes;		//!< never includes selection or search highlighting
+	std::string				text;			//!< UTF-8; empty if the cells are blank
+};
+typedef std::vector< My_RowRun >	My_RowRunList;
+
+/*!
+What a client that views a screen is known to have, so that
+each update only includes what changed since the last one.
+Rows are compared by hash, so a row that is rewritten with
+the same content (or that changes and then changes back
+before an update is sent) costs nothing.
+*/
+struct My_ScreenViewer
+{
+	My_ScreenViewer ();
+	
+	std::vector< UInt64 >	rowHashes;			//!< for each row, returnRowHash() as last sent; 0 if the row is unknown
+	std::set< UInt16 >		pendingRows;		//!< rows that changed since the last update, where they are now
+	std::set< UInt16 >		rowsBeforeScreenEdit;	//!< "pendingRows" as it was before the latest edit of every row
+	SInt32					pendingScrollDelta;	//!< rows scrolled since the last update (negative is upward)
+	UInt16					columnCount;		//!< screen width as last sent
+	UInt16					cursorColumn;		//!< cursor location as last sent
+	UInt16					cursorRow;			//!< cursor location as last sent
+	bool					isCursorVisible;	//!< cursor state as last sent
+	bool					isCursorPending;	//!< true if the cursor changed since the last update
+	bool					isSnapshotPending;	//!< true if the next update must be a snapshot
+	bool					isScreenEditLast;	//!< true if the latest change edited every row (as a scroll does)
+};
+typedef std::map< UInt32, My_ScreenViewer >		My_ScreenViewerBySessionID;
+
+/*!
+The state of one client.  Connections are only accessed on
+the main thread.  Closing a connection cancels its sources;
+the object is destroyed (and the descriptor is closed) when
+both cancellations are complete, so a connection that was
+just closed can still be examined safely.
+*/
+struct My_Connection
+{
+	My_Connection	(int);
+	
+	int								fileDescriptor;			//!< the host end of the socket
+	dispatch_source_t				readSource;				//!< fires on the main queue when requests arrive
+	dispatch_source_t				writeSource;			//!< fires on the main queue when more can be written
+	bool							isReadSuspended;		//!< true if requests are not being read (backpressure)
+	bool							isWriteSuspended;		//!< true unless unsent data is waiting for the socket
+	bool							isClosed;				//!< true once closeConnection() has been called
+	UInt16							pendingCancelCount;		//!< sources whose cancellation is still in progress
+	ScriptHostProtocol_FrameParser	parser;					//!< requests received but not yet handled
+	std::vector< UInt8 >			outputBuffer;			//!< replies and events not yet written
+	size_t							outputOffset;			//!< index in the output buffer of the first unsent byte
+	bool							isGreeted;				//!< true once a valid “hello” is received
+	UInt32							eventCredit;			//!< how many more events the client will accept
+	std::deque< My_PendingEvent >	pendingSessionEvents;	//!< session events waiting for credit
+	My_LineSetBySessionID			pendingLineChanges;		//!< changed lines waiting for credit (coalesced)
+	std::set< UInt32 >				watchedSessionIDs;		//!< sessions with “lines changed” events enabled
+	My_ScreenViewerBySessionID		screenViewers;			//!< sessions with “screen update” events enabled
+};
+typedef std::set< My_Connection* >		My_ConnectionSet;
+
+/*!
+Monitors the terminal of one session on behalf of every
+connection that watches its lines or views its screen.
+*/
+struct My_ScreenWatch
+{
+	UInt32							sessionID;		//!< the session whose terminal is watched
+	TerminalScreenRef				screen;			//!< the terminal being monitored
+	ListenerModel_ListenerWrap		listener;		//!< receives changes to text, scrolling, the cursor and the size
+	UInt16							watcherCount;	//!< line watches and screen viewers that currently use this
+};
+typedef std::map< UInt32, My_ScreenWatch* >		My_ScreenWatchBySessionID;
+
+} // anonymous namespace
+
+#pragma mark Internal Method Prototypes
+namespace {
+
+void				acceptConnections			();
+Boolean				appendLineReplyText			(UInt8 const*, size_t, void*);
+My_Connection*		attachConnection			(int);
+void				captureRowRun				(TerminalScreenRef, UInt16, CFStringRef, Terminal_LineRef, UInt16,
+												 TextAttributes_Object, void*);
+void				captureRowRuns				(TerminalScreenRef, UInt16, My_RowRunList&);
+void				closeConnection				(My_Connection*);
+void				connectionCanceled			(My_Connection*);
+void				flushOutput					(My_Connection*);
+void				forgetSession				(SessionRef);
+void				handleFrame					(My_Connection*, ScriptHostProtocol_Frame const&);
+void				handleReadable				(My_Connection*);
+void				handleWritable				(My_Connection*);
+bool				isOutputCongested			(My_Connection*);
+void				noteScreenChange			(My_ScreenViewer&, ListenerModel_Event, void*);
+void				processFrames				(My_Connection*);
+void				queueLineChanges			(UInt32, SInt32, UInt32);
+void				queueSessionEvent			(UInt16, UInt32);
+void				releaseScreenWatch			(UInt32);
+void				retainScreenWatch			(UInt32);
+UInt64				returnRowHash				(My_RowRunList const&);
+SessionRef			returnSessionForID			(UInt32);
+UInt32				returnSessionID				(SessionRef);
+TerminalScreenRef	returnSessionScreen			(SessionRef);
+void				scheduleEventDelivery		();
+void				screenChanged				(ListenerModel_Ref, ListenerModel_Event, void*, void*);
+void				sendError					(My_Connection*, UInt32, ScriptHostProtocol_ErrorCode, char const*);
+void				sendPendingEvents			(My_Connection*);
+bool				sendScreenUpdate			(My_Connection*);
+void				sessionChanged				(ListenerModel_Ref, ListenerModel_Event, void*, void*);
+void				sessionFactoryChanged		(ListenerModel_Ref, ListenerModel_Event, void*, void*);
+void				setResumed					(dispatch_source_t, bool&, bool);
+void				startWatchingLines			(My_Connection*, UInt32);
+void				startWatchingScreen			(My_Connection*, UInt32, bool);
+void				stopWatchingLines			(My_Connection*, UInt32);
+void				stopWatchingScreen			(My_Connection*, UInt32);
+Boolean				unitTest_Loopback_000		();
+Boolean				unitTest_Loopback_001		();
+Boolean				unitTest_Loopback_002		();
+Boolean				unitTest_Protocol_000		();
+std::vector< ScriptHostProtocol_Frame >
+					unitTest_ReadFrames			(int);
+Boolean				unitTest_ScreenUpdate_000	();
+bool				writeScreenUpdate			(std::vector< UInt8 >&, UInt32, TerminalScreenRef, My_ScreenViewer&);
+
+} // anonymous namespace
+
+#pragma mark Variables
+namespace {
+
+My_ConnectionSet&					gConnections ()				{ static My_ConnectionSet x; return x; }
+My_ScreenWatchBySessionID&			gScreenWatches ()			{ static My_ScreenWatchBySessionID x; return x; }
+std::map< SessionRef, UInt32 >&		gSessionIDsByRef ()			{ static std::map< SessionRef, UInt32 > x; return x; }
+std::map< UInt32, SessionRef >&		gSessionsByID ()			{ static std::map< UInt32, SessionRef > x; return x; }
+ListenerModel_ListenerWrap&			gSessionChangeListener ()	{ static ListenerModel_ListenerWrap x; return x; }
+ListenerModel_ListenerWrap&			gSessionFactoryChangeListener ()	{ static ListenerModel_ListenerWrap x; return x; }
+CFRetainRelease&					gSocketPath ()				{ static CFRetainRelease x; return x; }
+UInt32								gNextSessionID = 1;
+int									gListeningSocket = -1;
+dispatch_source_t					gListeningSource = nullptr;
+bool								gIsEventDeliveryPending = false;
+
+} // anonymous namespace
+
+
+
+#pragma mark Public Methods
+
+/*!
+Starts listening for scripting host processes, if the user
+has turned that on (see ScriptHost_ReturnSocketPath()).
+Otherwise, the only way to connect is through a connection
+made by ScriptHost_NewLoopbackConnection().
+
+(2017.10)
+*/
+void
+ScriptHost_Init ()
+{
+	Boolean		isSocketEnabled = false;
+	
+	
+	unless (kPreferences_ResultOK ==
+			Preferences_GetData(kPreferences_TagScriptHostSocketEnabled,
+								sizeof(isSocketEnabled), &isSocketEnabled))
+	{
+		isSocketEnabled = false; // assume a value, if preference can’t be found
+	}
+	
+	if (isSocketEnabled)
+	{
+		CFStringRef		socketPath = ScriptHost_ReturnSocketPath();
+		
+		
+		if (nullptr != socketPath)
+		{
+			Console_WriteValueCFString("script host is listening on socket", socketPath);
+		}
+	}
+}// Init
+
+
+/*!
+Closes every connection and stops listening for new ones.
+The socket file is removed.
+
+(2017.10)
+*/
+void
+ScriptHost_Done ()
+{
+	My_ConnectionSet	connectionsCopy = gConnections();
+	
+	
+	for (auto connectionPtr : connectionsCopy)
+	{
+		closeConnection(connectionPtr);
+	}
+	
+	if (nullptr != gListeningSource)
+	{
+		dispatch_source_cancel(gListeningSource);
+		dispatch_release(gListeningSource), gListeningSource = nullptr;
+		gListeningSocket = -1; // closed by the cancel handler
+	}
+	
+	if (gSocketPath().exists())
+	{
+		char	pathBuffer[PATH_MAX];
+		
+		
+		if (CFStringGetFileSystemRepresentation(gSocketPath().returnCFStringRef(), pathBuffer, sizeof(pathBuffer)))
+		{
+			UNUSED_RETURN(int)unlink(pathBuffer);
+		}
+		gSocketPath().clear();
+	}
+	
+	if (gSessionChangeListener().exists())
+	{
+		SessionFactory_StopMonitoringSessions(kSession_ChangeState, gSessionChangeListener().returnRef());
+		SessionFactory_StopMonitoringSessions(kSession_ChangeWindowInvalid, gSessionChangeListener().returnRef());
+		gSessionChangeListener().clear();
+	}
+	
+	if (gSessionFactoryChangeListener().exists())
+	{
+		SessionFactory_StopMonitoring(kSessionFactory_ChangeHeadlessSessionCount, gSessionFactoryChangeListener().returnRef());
+		gSessionFactoryChangeListener().clear();
+	}
+}// Done
+
+
+/*!
+A unit test for this module.  This should always
+be run before a release, after any substantial
+changes are made, or if you suspect bugs!  It
+should also be EXPANDED as new functionality is
+proposed (ideally, a test is written before the
+functionality is added).
+
+The connection tests use a local stand-in client
+(connected the way ScriptHost_NewLoopbackConnection()
+does it) and call the request handler directly, so
+they do not need an event loop or any open sessions
+(the headless session test starts and then closes a
+session of its own).  The screen update test uses a terminal that has no
+session.
+
+(2017.10)
+*/
+void
+ScriptHost_RunTests ()
+{
+	UInt16		totalTests = 0;
+	UInt16		failedTests = 0;
+	
+	
+	++totalTests; if (false == unitTest_Protocol_000()) ++failedTests;
+	++totalTests; if (false == unitTest_Loopback_000()) ++failedTests;
+	++totalTests; if (false == unitTest_Loopback_001()) ++failedTests;
+	++totalTests; if (false == unitTest_Loopback_002()) ++failedTests;
+	++totalTests; if (false == unitTest_ScreenUpdate_000()) ++failedTests;
+	
+	Console_WriteUnitTestReport("Script Host", failedTests, totalTests);
+}// RunTests
+
+
+/*!
+Creates a connection that is not reachable through the
+file system: the host end is served exactly like a client
+that connected to the socket, and the other end is returned
+(or -1 on failure).  The caller must close() the returned
+descriptor when finished.
+
+This is useful for a stand-in client in tests, and for
+handing a connection to a child process that inherits the
+descriptor.
+
+(2017.10)
+*/
+int
+ScriptHost_NewLoopbackConnection ()
+{
+	int		socketPair[2] = { -1, -1 };
+	int		result = -1;
+	
+	
+	if (0 != socketpair(AF_UNIX, SOCK_STREAM, 0, socketPair))
+	{
+		Console_Warning(Console_WriteValue, "failed to create script host socket pair; errno", errno);
+	}
+	else if (nullptr == attachConnection(socketPair[0]))
+	{
+		UNUSED_RETURN(int)close(socketPair[0]);
+		UNUSED_RETURN(int)close(socketPair[1]);
+	}
+	else
+	{
+		result = socketPair[1];
+	}
+	
+	return result;
+}// NewLoopbackConnection
+
+
+/*!
+Returns the path of the socket that a scripting host process
+should connect to, or nullptr if it cannot be created.  The
+host starts listening the first time this is called.
+
+The socket is in the per-user temporary directory (which is
+only accessible to the current user) and it is named after
+this process, so that each running copy of the application
+has its own.  Connections are also refused from any other
+user.
+
+(2017.10)
+*/
+CFStringRef
+ScriptHost_ReturnSocketPath ()
+{
+	if (false == gSocketPath().exists())
+	{
+		char	directoryBuffer[PATH_MAX];
+		size_t	directoryLength = confstr(_CS_DARWIN_USER_TEMP_DIR, directoryBuffer, sizeof(directoryBuffer));
+		
+		
+		if ((0 == directoryLength) || (directoryLength > sizeof(directoryBuffer)))
+		{
+			Console_Warning(Console_WriteLine, "unable to find temporary directory for script host socket");
+		}
+		else
+		{
+			std::string		socketPath(directoryBuffer);
+			sockaddr_un		socketAddress;
+			
+			
+			socketPath += "net.macterm.ScriptHost.";
+			socketPath += std::to_string(getpid());
+			
+			std::memset(&socketAddress, 0, sizeof(socketAddress));
+			socketAddress.sun_family = AF_UNIX;
+			if (socketPath.size() >= sizeof(socketAddress.sun_path))
+			{
+				Console_Warning(Console_WriteValueCString, "script host socket path is too long", socketPath.c_str());
+			}
+			else
+			{
+				std::strncpy(socketAddress.sun_path, socketPath.c_str(), sizeof(socketAddress.sun_path) - 1);
+				
+				// a stale file can only be left by a crashed process with the same ID
+				UNUSED_RETURN(int)unlink(socketPath.c_str());
+				
+				gListeningSocket = socket(AF_UNIX, SOCK_STREAM, 0);
+				if (gListeningSocket < 0)
+				{
+					Console_Warning(Console_WriteValue, "failed to create script host socket; errno", errno);
+				}
+				else if ((0 != bind(gListeningSocket, REINTERPRET_CAST(&socketAddress, sockaddr*), sizeof(socketAddress))) ||
+							(0 != chmod(socketPath.c_str(), S_IRUSR | S_IWUSR)) ||
+							(0 != listen(gListeningSocket, SOMAXCONN)) ||
+							(0 != fcntl(gListeningSocket, F_SETFL, O_NONBLOCK)))
+				{
+					Console_Warning(Console_WriteValue, "failed to listen on script host socket; errno", errno);
+					UNUSED_RETURN(int)close(gListeningSocket), gListeningSocket = -1;
+					UNUSED_RETURN(int)unlink(socketPath.c_str());
+				}
+				else
+				{
+					int const	kListeningSocket = gListeningSocket;
+					
+					
+					gListeningSource = dispatch_source_create(DISPATCH_SOURCE_TYPE_READ, gListeningSocket, 0/* mask */,
+																dispatch_get_main_queue());
+					dispatch_source_set_event_handler(gListeningSource, ^{ acceptConnections(); });
+					dispatch_source_set_cancel_handler(gListeningSource, ^{ UNUSED_RETURN(int)close(kListeningSocket); });
+					dispatch_resume(gListeningSource);
+					gSocketPath() = CFRetainRelease(CFStringCreateWithFileSystemRepresentation(kCFAllocatorDefault, socketPath.c_str()),
+													CFRetainRelease::kAlreadyRetained);
+				}
+			}
+		}
+	}
+	return gSocketPath().returnCFStringRef();
+}// ReturnSocketPath
+
+
+#pragma mark Internal Methods
+namespace {
+
+/*!
+Constructor.  The descriptor must already be non-blocking.
+
+(2017.10)
+*/
+My_Connection::
+My_Connection	(int	inFileDescriptor)
+:
+fileDescriptor(inFileDescriptor),
+readSource(dispatch_source_create(DISPATCH_SOURCE_TYPE_READ, inFileDescriptor, 0/* mask */, dispatch_get_main_queue())),
+writeSource(dispatch_source_create(DISPATCH_SOURCE_TYPE_WRITE, inFileDescriptor, 0/* mask */, dispatch_get_main_queue())),
+isReadSuspended(true), // sources are initially suspended
+isWriteSuspended(true),
+isClosed(false),
+pendingCancelCount(2),
+parser(),
+outputBuffer(),
+outputOffset(0),
+isGreeted(false),
+eventCredit(0),
+pendingSessionEvents(),
+pendingLineChanges(),
+watchedSessionIDs(),
+screenViewers()
+{
+}// My_Connection 1-argument constructor
+
+
+/*!
+Constructor.  The first update is a snapshot.
+
+(2017.10)
+*/
+My_ScreenViewer::
+My_ScreenViewer ()
+:
+rowHashes(),
+pendingRows(),
+rowsBeforeScreenEdit(),
+pendingScrollDelta(0),
+columnCount(0),
+cursorColumn(0),
+cursorRow(0),
+isCursorVisible(false),
+isCursorPending(false),
+isSnapshotPending(true),
+isScreenEditLast(false)
+{
+}// My_ScreenViewer default constructor
+
+
+/*!
+Accepts every waiting connection on the listening socket.
+Clients running as any other user are refused.
+
+(2017.10)
+*/
+void
+acceptConnections ()
+{
+	while (true)
+	{
+		int		newSocket = accept(gListeningSocket, nullptr, nullptr);
+		uid_t	peerUserID = 0;
+		gid_t	peerGroupID = 0;
+		
+		
+		if (newSocket < 0)
+		{
+			if ((EAGAIN != errno) && (EINTR != errno))
+			{
+				Console_Warning(Console_WriteValue, "failed to accept script host connection; errno", errno);
+			}
+			break;
+		}
+		
+		if ((0 != getpeereid(newSocket, &peerUserID, &peerGroupID)) || (geteuid() != peerUserID))
+		{
+			Console_Warning(Console_WriteValue, "refused script host connection from user", STATIC_CAST(peerUserID, SInt32));
+			UNUSED_RETURN(int)close(newSocket);
+		}
+		else if (nullptr == attachConnection(newSocket))
+		{
+			UNUSED_RETURN(int)close(newSocket);
+		}
+	}
+}// acceptConnections
+
+
+/*!
+A Terminal_TextSinkProcPtr for the text of a “read lines”
+reply (the context is a My_LineReplySink).  Bytes are appended
+until the reply is full; then only the part that fits is kept
+and false is returned, to stop the export.
+
+(2017.10)
+*/
+Boolean
+appendLineReplyText		(UInt8 const*	inUTF8Bytes,
+						 size_t			inByteCount,
+						 void*			inSinkPtr)
+{
+	My_LineReplySink*	sinkPtr = REINTERPRET_CAST(inSinkPtr, My_LineReplySink*);
+	size_t const		kByteCount = std::min(inByteCount, sinkPtr->byteLimit - sinkPtr->byteCount);
+	UInt8 const* const	kPastEnd = inUTF8Bytes + kByteCount;
+	UInt8 const*		lastNewLinePtr = std::find(std::reverse_iterator< UInt8 const* >(kPastEnd),
+													std::reverse_iterator< UInt8 const* >(inUTF8Bytes), '\n').base();
+	Boolean				result = (kByteCount == inByteCount);
+	
+	
+	sinkPtr->writer->appendBytes(inUTF8Bytes, kByteCount);
+	if (lastNewLinePtr != inUTF8Bytes)
+	{
+		// (the base of a reverse iterator is one past the byte that it finds)
+		sinkPtr->wholeLineByteCount = sinkPtr->byteCount + STATIC_CAST(lastNewLinePtr - inUTF8Bytes, size_t);
+	}
+	sinkPtr->byteCount += kByteCount;
+	sinkPtr->isFull = (false == result);
+	return result;
+}// appendLineReplyText
+
+
+/*!
+Starts serving a new client on the given socket, returning
+the connection (or nullptr on failure, in which case the
+caller still owns the descriptor).
+
+(2017.10)
+*/
+My_Connection*
+attachConnection	(int	inSocket)
+{
+	int const		kNoSignalOnBrokenPipe = 1;
+	My_Connection*	result = nullptr;
+	
+	
+	if ((0 != fcntl(inSocket, F_SETFL, O_NONBLOCK)) ||
+		(0 != setsockopt(inSocket, SOL_SOCKET, SO_NOSIGPIPE, &kNoSignalOnBrokenPipe, sizeof(kNoSignalOnBrokenPipe))))
+	{
+		Console_Warning(Console_WriteValue, "failed to configure script host connection; errno", errno);
+	}
+	else
+	{
+		result = new My_Connection(inSocket);
+		dispatch_source_set_event_handler(result->readSource, ^{ handleReadable(result); });
+		dispatch_source_set_cancel_handler(result->readSource, ^{ connectionCanceled(result); });
+		dispatch_source_set_event_handler(result->writeSource, ^{ handleWritable(result); });
+		dispatch_source_set_cancel_handler(result->writeSource, ^{ connectionCanceled(result); });
+		setResumed(result->readSource, result->isReadSuspended, true);
+		gConnections().insert(result);
+		
+		// the first client causes session changes to be monitored
+		if (false == gSessionChangeListener().exists())
+		{
+			gSessionChangeListener() = ListenerModel_ListenerWrap(ListenerModel_NewStandardListener(sessionChanged),
+																	ListenerModel_ListenerWrap::kAlreadyRetained);
+			SessionFactory_StartMonitoringSessions(kSession_ChangeState, gSessionChangeListener().returnRef());
+			SessionFactory_StartMonitoringSessions(kSession_ChangeWindowInvalid, gSessionChangeListener().returnRef());
+			
+			// headless sessions are reported separately
+			gSessionFactoryChangeListener() = ListenerModel_ListenerWrap(ListenerModel_NewStandardListener(sessionFactoryChanged),
+																			ListenerModel_ListenerWrap::kAlreadyRetained);
+			SessionFactory_StartMonitoring(kSessionFactory_ChangeHeadlessSessionCount, gSessionFactoryChangeListener().returnRef());
+		}
+	}
+	return result;
+}// attachConnection
+
+
+/*!
+A Terminal_ScreenRunProcPtr that adds a run to the end of
+the given My_RowRunList.  Attributes that only matter to
+local views (selection and search highlighting) are removed,
+and a run is merged with the previous one if that leaves
+them identical.
+
+(2017.10)
+*/
+void
+captureRowRun	(TerminalScreenRef		UNUSED_ARGUMENT(inScreen),
+				 UInt16					inLineTextBufferOrWhitespaceLength,
+				 CFStringRef			inLineTextBufferAsCFStringOrNull,
+				 Terminal_LineRef		UNUSED_ARGUMENT(inRow),
+				 UInt16					inZeroBasedStartColumnNumber,
+				 TextAttributes_Object	inAttributes,
+				 void*					inRunListPtr)
+{
+	My_RowRunList*		runListPtr = REINTERPRET_CAST(inRunListPtr, My_RowRunList*);
+	My_RowRun			run;
+	
+	
+	run.firstColumn = inZeroBasedStartColumnNumber;
+	run.columnCount = inLineTextBufferOrWhitespaceLength;
+	run.attributes = inAttributes;
+	run.attributes.removeAttributes(kTextAttributes_Selected);
+	run.attributes.removeAttributes(kTextAttributes_SearchHighlight);
+	if (nullptr != inLineTextBufferAsCFStringOrNull)
+	{
+		CFIndex const	kCharacterCount = CFStringGetLength(inLineTextBufferAsCFStringOrNull);
+		CFIndex			byteCount = 0;
+		
+		
+		run.text.resize(STATIC_CAST(CFStringGetMaximumSizeForEncoding(kCharacterCount, kCFStringEncodingUTF8), size_t));
+		UNUSED_RETURN(CFIndex)CFStringGetBytes(inLineTextBufferAsCFStringOrNull, CFRangeMake(0, kCharacterCount), kCFStringEncodingUTF8,
+												'?'/* loss byte */, false/* is external representation */,
+												REINTERPRET_CAST(&run.text[0], UInt8*), STATIC_CAST(run.text.size(), CFIndex), &byteCount);
+		run.text.resize(STATIC_CAST(byteCount, size_t));
+	}
+	
+	if ((false == runListPtr->empty()) && (runListPtr->back().attributes == run.attributes) &&
+		(runListPtr->back().text.empty() == run.text.empty()) &&
+		((runListPtr->back().firstColumn + runListPtr->back().columnCount) == run.firstColumn))
+	{
+		runListPtr->back().columnCount += run.columnCount;
+		runListPtr->back().text += run.text;
+	}
+	else
+	{
+		runListPtr->push_back(run);
+	}
+}// captureRowRun
+
+
+/*!
+Replaces the given list with the runs of the specified row
+of the main screen.
+
+(2017.10)
+*/
+void
+captureRowRuns	(TerminalScreenRef	inScreen,
+				 UInt16				inRow,
+				 My_RowRunList&		outRuns)
+{
+	Terminal_LineStackStorage	lineIteratorData;
+	Terminal_LineRef			lineIterator = Terminal_NewMainScreenLineIterator(inScreen, inRow, &lineIteratorData);
+	
+	
+	outRuns.clear();
+	if (nullptr != lineIterator)
+	{
+		UNUSED_RETURN(Terminal_Result)Terminal_ForEachLikeAttributeRunDo(inScreen, lineIterator, captureRowRun, &outRuns);
+		Terminal_DisposeLineIterator(&lineIterator);
+	}
+}// captureRowRuns
+
+
+/*!
+Stops serving a client: any unsent data is discarded, its
+line and screen watches are removed and its sources are
+canceled.  The
+connection is destroyed later, by connectionCanceled().
+Has no effect if the connection is already closed.
+
+(2017.10)
+*/
+void
+closeConnection		(My_Connection*		inConnection)
+{
+	unless (inConnection->isClosed)
+	{
+		std::set< UInt32 > const	kWatchedSessionIDs = inConnection->watchedSessionIDs;
+		std::set< UInt32 >			viewedSessionIDs;
+		
+		
+		inConnection->isClosed = true;
+		gConnections().erase(inConnection);
+		for (auto sessionID : kWatchedSessionIDs)
+		{
+			stopWatchingLines(inConnection, sessionID);
+		}
+		for (auto const& sessionViewerPair : inConnection->screenViewers)
+		{
+			viewedSessionIDs.insert(sessionViewerPair.first);
+		}
+		for (auto sessionID : viewedSessionIDs)
+		{
+			stopWatchingScreen(inConnection, sessionID);
+		}
+		
+		// a source must be running to be canceled and released
+		dispatch_source_cancel(inConnection->readSource);
+		dispatch_source_cancel(inConnection->writeSource);
+		setResumed(inConnection->readSource, inConnection->isReadSuspended, true);
+		setResumed(inConnection->writeSource, inConnection->isWriteSuspended, true);
+	}
+}// closeConnection
+
+
+/*!
+Invoked when either source of a closed connection has been
+canceled; after the second, the descriptor is no longer in
+use so it is closed and the connection is destroyed.
+
+(2017.10)
+*/
+void
+connectionCanceled	(My_Connection*		inConnection)
+{
+	--(inConnection->pendingCancelCount);
+	if (0 == inConnection->pendingCancelCount)
+	{
+		dispatch_release(inConnection->readSource), inConnection->readSource = nullptr;
+		dispatch_release(inConnection->writeSource), inConnection->writeSource = nullptr;
+		UNUSED_RETURN(int)close(inConnection->fileDescriptor), inConnection->fileDescriptor = -1;
+		delete inConnection;
+	}
+}// connectionCanceled
+
+
+/*!
+Writes as much unsent data as the socket will accept without
+blocking.  If anything remains, the write source is resumed
+so that writing continues when the client reads more; the
+connection is closed if the client is gone.
+
+(2017.10)
+*/
+void
+flushOutput		(My_Connection*		inConnection)
+{
+	while ((false == inConnection->isClosed) && (inConnection->outputOffset < inConnection->outputBuffer.size()))
+	{
+		ssize_t const	kBytesWritten = write(inConnection->fileDescriptor,
+												inConnection->outputBuffer.data() + inConnection->outputOffset,
+												inConnection->outputBuffer.size() - inConnection->outputOffset);
+		
+		
+		if (kBytesWritten > 0)
+		{
+			inConnection->outputOffset += STATIC_CAST(kBytesWritten, size_t);
+		}
+		else if ((kBytesWritten < 0) && (EINTR == errno))
+		{
+			// try again
+		}
+		else if ((kBytesWritten < 0) && (EAGAIN == errno))
+		{
+			break;
+		}
+		else
+		{
+			closeConnection(inConnection);
+		}
+	}
+	
+	unless (inConnection->isClosed)
+	{
+		if (inConnection->outputOffset == inConnection->outputBuffer.size())
+		{
+			inConnection->outputBuffer.clear();
+			inConnection->outputOffset = 0;
+			setResumed(inConnection->writeSource, inConnection->isWriteSuspended, false);
+		}
+		else
+		{
+			setResumed(inConnection->writeSource, inConnection->isWriteSuspended, true);
+		}
+	}
+}// flushOutput
+
+
+/*!
+Invoked when a session is about to be destroyed: it is no
+longer watched, its ID becomes invalid and clients are told
+that it closed.  Has no effect if the session has no ID.
+
+(2017.10)
+*/
+void
+forgetSession	(SessionRef		inSession)
+{
+	auto	toID = gSessionIDsByRef().find(inSession);
+	
+	
+	if (gSessionIDsByRef().end() != toID)
+	{
+		UInt32 const	kSessionID = toID->second;
+		
+		
+		for (auto connectionPtr : gConnections())
+		{
+			stopWatchingLines(connectionPtr, kSessionID);
+			stopWatchingScreen(connectionPtr, kSessionID);
+			connectionPtr->pendingLineChanges.erase(kSessionID);
+		}
+		gSessionsByID().erase(kSessionID);
+		gSessionIDsByRef().erase(toID);
+		queueSessionEvent(kScriptHostProtocol_MessageEventSessionClosed, kSessionID);
+	}
+}// forgetSession
+
+
+/*!
+Responds to one request.  Every request except “grant credit”
+receives exactly one reply or error, with the same request ID.
+
+(2017.10)
+*/
+void
+handleFrame		(My_Connection*						inConnection,
+				 ScriptHostProtocol_Frame const&	inFrame)
+{
+	ScriptHostProtocol_Reader	reader(inFrame.payload);
+	
+	
+	if ((kScriptHostProtocol_MessageHello != inFrame.type) && (false == inConnection->isGreeted))
+	{
+		sendError(inConnection, inFrame.requestID, kScriptHostProtocol_ErrorNotGreeted, "expected hello");
+		return;
+	}
+	
+	switch (inFrame.type)
+	{
+	case kScriptHostProtocol_MessageHello:
+		{
+			UInt16		version = 0;
+			UInt32		initialCredit = 0;
+			
+			
+			if ((false == reader.readUInt16(version)) || (false == reader.readUInt32(initialCredit)) || (false == reader.isAtEnd()))
+			{
+				sendError(inConnection, inFrame.requestID, kScriptHostProtocol_ErrorMalformedPayload, "hello");
+			}
+			else if (kScriptHostProtocol_Version != version)
+			{
+				sendError(inConnection, inFrame.requestID, kScriptHostProtocol_ErrorVersionMismatch, "unsupported version");
+			}
+			else
+			{
+				ScriptHostProtocol_Writer	writer(inConnection->outputBuffer, kScriptHostProtocol_MessageReply, inFrame.requestID);
+				
+				
+				writer.appendUInt16(kScriptHostProtocol_Version);
+				writer.finish();
+				inConnection->isGreeted = true;
+				inConnection->eventCredit = initialCredit;
+			}
+		}
+		break;
+	
+	case kScriptHostProtocol_MessageGrantCredit:
+		{
+			UInt32		additionalCredit = 0;
+			
+			
+			if ((false == reader.readUInt32(additionalCredit)) || (false == reader.isAtEnd()))
+			{
+				sendError(inConnection, inFrame.requestID, kScriptHostProtocol_ErrorMalformedPayload, "grant credit");
+			}
+			else
+			{
+				inConnection->eventCredit += std::min(additionalCredit, UINT32_MAX - inConnection->eventCredit);
+				sendPendingEvents(inConnection);
+			}
+		}
+		break;
+	
+	case kScriptHostProtocol_MessageListSessions:
+		if (false == reader.isAtEnd())
+		{
+			sendError(inConnection, inFrame.requestID, kScriptHostProtocol_ErrorMalformedPayload, "list sessions");
+		}
+		else
+		{
+			__block std::vector< UInt32 >	sessionIDs;
+			SessionFactory_SessionBlock		addSessionID = ^(SessionRef	inSession,
+															 Boolean&	UNUSED_ARGUMENT(outStopFlag))
+															{
+																sessionIDs.push_back(returnSessionID(inSession));
+															};
+			ScriptHostProtocol_Writer		writer(inConnection->outputBuffer, kScriptHostProtocol_MessageReply, inFrame.requestID);
+			
+			
+			SessionFactory_ForEachSession(addSessionID);
+			SessionFactory_ForEachHeadlessSession(addSessionID);
+			writer.appendUInt32(STATIC_CAST(sessionIDs.size(), UInt32));
+			for (auto sessionID : sessionIDs)
+			{
+				writer.appendUInt32(sessionID);
+			}
+			writer.finish();
+		}
+		break;
+	
+	case kScriptHostProtocol_MessageWatchLines:
+		{
+			UInt32		sessionID = 0;
+			UInt8		isStart = 0;
+			
+			
+			if ((false == reader.readUInt32(sessionID)) || (false == reader.readUInt8(isStart)) || (false == reader.isAtEnd()))
+			{
+				sendError(inConnection, inFrame.requestID, kScriptHostProtocol_ErrorMalformedPayload, "watch lines");
+			}
+			else if ((0 != isStart) && (nullptr == returnSessionScreen(returnSessionForID(sessionID))))
+			{
+				sendError(inConnection, inFrame.requestID, kScriptHostProtocol_ErrorNoSuchSession, "no terminal for session");
+			}
+			else
+			{
+				ScriptHostProtocol_Writer	writer(inConnection->outputBuffer, kScriptHostProtocol_MessageReply, inFrame.requestID);
+				
+				
+				if (0 != isStart)
+				{
+					startWatchingLines(inConnection, sessionID);
+				}
+				else
+				{
+					stopWatchingLines(inConnection, sessionID);
+				}
+				writer.finish();
+			}
+		}
+		break;
+	
+	case kScriptHostProtocol_MessageWatchScreen:
+		{
+			UInt32		sessionID = 0;
+			UInt8		mode = 0;
+			
+			
+			if ((false == reader.readUInt32(sessionID)) || (false == reader.readUInt8(mode)) || (mode > 2) ||
+				(false == reader.isAtEnd()))
+			{
+				sendError(inConnection, inFrame.requestID, kScriptHostProtocol_ErrorMalformedPayload, "watch screen");
+			}
+			else if ((0 != mode) && (nullptr == returnSessionScreen(returnSessionForID(sessionID))))
+			{
+				sendError(inConnection, inFrame.requestID, kScriptHostProtocol_ErrorNoSuchSession, "no terminal for session");
+			}
+			else
+			{
+				ScriptHostProtocol_Writer	writer(inConnection->outputBuffer, kScriptHostProtocol_MessageReply, inFrame.requestID);
+				
+				
+				if (0 != mode)
+				{
+					startWatchingScreen(inConnection, sessionID, (2 == mode)/* resynchronize */);
+				}
+				else
+				{
+					stopWatchingScreen(inConnection, sessionID);
+				}
+				writer.finish();
+			}
+		}
+		break;
+	
+	case kScriptHostProtocol_MessageReadLines:
+		{
+			UInt32				sessionID = 0;
+			SInt32				firstLine = 0;
+			UInt32				lineCount = 0;
+			TerminalScreenRef	screen = nullptr;
+			
+			
+			if ((false == reader.readUInt32(sessionID)) || (false == reader.readSInt32(firstLine)) ||
+				(false == reader.readUInt32(lineCount)) || (false == reader.isAtEnd()))
+			{
+				sendError(inConnection, inFrame.requestID, kScriptHostProtocol_ErrorMalformedPayload, "read lines");
+			}
+			else if (nullptr == (screen = returnSessionScreen(returnSessionForID(sessionID))))
+			{
+				sendError(inConnection, inFrame.requestID, kScriptHostProtocol_ErrorNoSuchSession, "no terminal for session");
+			}
+			else
+			{
+				size_t const				kFrameOffset = inConnection->outputBuffer.size();
+				SInt64 const				kFirstLine = std::max(STATIC_CAST(firstLine, SInt64),
+																	-STATIC_CAST(Terminal_ReturnInvisibleRowCount(screen), SInt64));
+				SInt64 const				kPastEndLine = std::min(STATIC_CAST(firstLine, SInt64) + lineCount,
+																	STATIC_CAST(Terminal_ReturnRowCount(screen), SInt64));
+				ScriptHostProtocol_Writer	writer(inConnection->outputBuffer, kScriptHostProtocol_MessageReply, inFrame.requestID);
+				My_LineReplySink			sink = { &writer, kScriptHostProtocol_MaximumPayloadSize, 0, 0, false };
+				bool						isOK = true;
+				
+				
+				if (kPastEndLine > kFirstLine)
+				{
+					Terminal_LineStackStorage	lineIteratorData;
+					Terminal_LineRef			lineIterator = (kFirstLine < 0)
+																? Terminal_NewScrollbackLineIterator(screen, STATIC_CAST(-kFirstLine - 1, UInt32),
+																										&lineIteratorData)
+																: Terminal_NewMainScreenLineIterator(screen, STATIC_CAST(kFirstLine, UInt16),
+																										&lineIteratorData);
+					
+					
+					// the text is exported straight into the reply frame; the sink
+					// stops the export when the frame is full (the cells of a line
+					// can need any number of bytes, so a full reply is clipped to
+					// the last whole line rather than sized from the line count)
+					isOK = ((nullptr != lineIterator) &&
+							(kTerminal_ResultOK == Terminal_CopyRangeToSink(screen, lineIterator, STATIC_CAST(kPastEndLine - kFirstLine, UInt32),
+																			0/* first column */, -1/* past-end column; -1 means “last column” */,
+																			kTerminal_TextCopyFlagsLineSeparatorLF |
+																			kTerminal_TextCopyFlagsLastLineHasSeparator |
+																			kTerminal_TextCopyFlagsAlwaysNewLineAtRightMargin,
+																			0/* spaces to tab, or 0 */,
+																			appendLineReplyText, &sink)));
+					if (sink.isFull)
+					{
+						inConnection->outputBuffer.resize(kFrameOffset + kScriptHostProtocol_HeaderSize + sink.wholeLineByteCount);
+						isOK = true;
+					}
+					if (nullptr != lineIterator)
+					{
+						Terminal_DisposeLineIterator(&lineIterator);
+					}
+				}
+				
+				if (isOK)
+				{
+					writer.finish();
+				}
+				else
+				{
+					// discard the partial reply
+					inConnection->outputBuffer.resize(kFrameOffset);
+					sendError(inConnection, inFrame.requestID, kScriptHostProtocol_ErrorOperationFailed, "unable to read lines");
+				}
+			}
+		}
+		break;
+	
+	case kScriptHostProtocol_MessageInjectInput:
+		{
+			UInt32			sessionID = 0;
+			SessionRef		session = nullptr;
+			
+			
+			if (false == reader.readUInt32(sessionID))
+			{
+				sendError(inConnection, inFrame.requestID, kScriptHostProtocol_ErrorMalformedPayload, "inject input");
+			}
+			else if (nullptr == (session = returnSessionForID(sessionID)))
+			{
+				sendError(inConnection, inFrame.requestID, kScriptHostProtocol_ErrorNoSuchSession, "no such session");
+			}
+			else
+			{
+				size_t				byteCount = 0;
+				UInt8 const*		bytePtr = reader.returnRemainingBytes(byteCount);
+				CFRetainRelease		inputCFString(CFStringCreateWithBytes(kCFAllocatorDefault, bytePtr, STATIC_CAST(byteCount, CFIndex),
+																			kCFStringEncodingUTF8, false/* is external representation */),
+												CFRetainRelease::kAlreadyRetained);
+				
+				
+				if (false == inputCFString.exists())
+				{
+					sendError(inConnection, inFrame.requestID, kScriptHostProtocol_ErrorMalformedPayload, "input is not UTF-8");
+				}
+				else
+				{
+					ScriptHostProtocol_Writer	writer(inConnection->outputBuffer, kScriptHostProtocol_MessageReply, inFrame.requestID);
+					
+					
+					Session_UserInputCFString(session, inputCFString.returnCFStringRef());
+					writer.finish();
+				}
+			}
+		}
+		break;
+	
+	case kScriptHostProtocol_MessageSpawnHeadless:
+		{
+			UInt16				columnCount = 0;
+			UInt16				rowCount = 0;
+			UInt32				scrollbackRowCount = 0;
+			UInt8 const*		directoryBytes = nullptr;
+			UInt32				directoryByteCount = 0;
+			UInt32				argumentCount = 0;
+			CFRetainRelease		argumentArray(CFArrayCreateMutable(kCFAllocatorDefault, 0/* capacity */, &kCFTypeArrayCallBacks),
+												CFRetainRelease::kAlreadyRetained);
+			CFRetainRelease		workingDirectory;
+			bool				isOK = (reader.readUInt16(columnCount) && reader.readUInt16(rowCount) &&
+										reader.readUInt32(scrollbackRowCount) &&
+										reader.readCountedBytes(directoryBytes, directoryByteCount) &&
+										reader.readUInt32(argumentCount) && (argumentCount > 0));
+			
+			
+			if (isOK && (directoryByteCount > 0))
+			{
+				workingDirectory.setWithNoRetain(CFStringCreateWithBytes(kCFAllocatorDefault, directoryBytes, STATIC_CAST(directoryByteCount, CFIndex),
+																			kCFStringEncodingUTF8, false/* is external representation */));
+				isOK = workingDirectory.exists();
+			}
+			for (UInt32 i = 0; (isOK && (i < argumentCount)); ++i)
+			{
+				UInt8 const*	argumentBytes = nullptr;
+				UInt32			argumentByteCount = 0;
+				
+				
+				isOK = reader.readCountedBytes(argumentBytes, argumentByteCount);
+				if (isOK)
+				{
+					CFRetainRelease		argumentCFString(CFStringCreateWithBytes(kCFAllocatorDefault, argumentBytes,
+																					STATIC_CAST(argumentByteCount, CFIndex),
+																					kCFStringEncodingUTF8, false/* is external representation */),
+														CFRetainRelease::kAlreadyRetained);
+					
+					
+					isOK = argumentCFString.exists();
+					if (isOK)
+					{
+						CFArrayAppendValue(argumentArray.returnCFMutableArrayRef(), argumentCFString.returnCFStringRef());
+					}
+				}
+			}
+			
+			if ((false == isOK) || (false == reader.isAtEnd()))
+			{
+				sendError(inConnection, inFrame.requestID, kScriptHostProtocol_ErrorMalformedPayload, "spawn headless");
+			}
+			else if ((columnCount > Terminal_ReturnAllocatedColumnCount()) || (rowCount > kMy_MaximumHeadlessRowCount))
+			{
+				// a screen that is too large is rejected (instead of being
+				// reduced) so that the client never sees a different size
+				sendError(inConnection, inFrame.requestID, kScriptHostProtocol_ErrorMalformedPayload, "screen size is too large");
+			}
+			else
+			{
+				// scrollback rows are only allocated as text scrolls off the screen
+				// but a limit is still set so that a session cannot grow forever
+				SessionRef		session = SessionFactory_NewHeadlessSession(argumentArray.returnCFArrayRef(), columnCount, rowCount,
+																			std::min(scrollbackRowCount, kMy_MaximumHeadlessScrollbackRowCount),
+																			workingDirectory.returnCFStringRef());
+				
+				
+				if (nullptr == session)
+				{
+					sendError(inConnection, inFrame.requestID, kScriptHostProtocol_ErrorOperationFailed, "unable to start session");
+				}
+				else
+				{
+					ScriptHostProtocol_Writer	writer(inConnection->outputBuffer, kScriptHostProtocol_MessageReply, inFrame.requestID);
+					
+					
+					writer.appendUInt32(returnSessionID(session));
+					writer.finish();
+				}
+			}
+		}
+		break;
+	
+	case kScriptHostProtocol_MessageCloseSession:
+		{
+			UInt32			sessionID = 0;
+			SessionRef		session = nullptr;
+			
+			
+			if ((false == reader.readUInt32(sessionID)) || (false == reader.isAtEnd()))
+			{
+				sendError(inConnection, inFrame.requestID, kScriptHostProtocol_ErrorMalformedPayload, "close session");
+			}
+			else if (nullptr == (session = returnSessionForID(sessionID)))
+			{
+				sendError(inConnection, inFrame.requestID, kScriptHostProtocol_ErrorNoSuchSession, "no such session");
+			}
+			else if (nullptr == SessionFactory_ReturnHeadlessSessionScreen(session))
+			{
+				sendError(inConnection, inFrame.requestID, kScriptHostProtocol_ErrorNotHeadless, "session has a window");
+			}
+			else
+			{
+				ScriptHostProtocol_Writer	writer(inConnection->outputBuffer, kScriptHostProtocol_MessageReply, inFrame.requestID);
+				
+				
+				// this terminates the process; the “session closed” event is
+				// only queued (for every client, including this one) so the
+				// reply cannot be interrupted
+				Session_Dispose(&session);
+				writer.finish();
+			}
+		}
+		break;
+	
+	default:
+		sendError(inConnection, inFrame.requestID, kScriptHostProtocol_ErrorUnknownMessage, "unknown message type");
+		break;
+	}
+}// handleFrame
+
+
+/*!
+Reads whatever the client has sent and handles every complete
+request.  The connection is closed at end-of-file, on error,
+or if the stream cannot be parsed.
+
+(2017.10)
+*/
+void
+handleReadable	(My_Connection*		inConnection)
+{
+	UInt8	buffer[kMy_ReadBufferSize];
+	
+	
+	unless (inConnection->isClosed)
+	{
+		ssize_t const	kBytesRead = read(inConnection->fileDescriptor, buffer, sizeof(buffer));
+		
+		
+		if (kBytesRead > 0)
+		{
+			inConnection->parser.appendBytes(buffer, STATIC_CAST(kBytesRead, size_t));
+			processFrames(inConnection);
+		}
+		else if ((kBytesRead < 0) && ((EAGAIN == errno) || (EINTR == errno)))
+		{
+			// nothing to do (the source fires again if necessary)
+		}
+		else
+		{
+			closeConnection(inConnection);
+		}
+	}
+}// handleReadable
+
+
+/*!
+Continues writing to a client that can accept more data and,
+once the backlog is small enough, resumes handling requests
+that arrived in the meantime.
+
+(2017.10)
+*/
+void
+handleWritable	(My_Connection*		inConnection)
+{
+	flushOutput(inConnection);
+	if ((false == inConnection->isClosed) && (inConnection->isReadSuspended) &&
+		((inConnection->outputBuffer.size() - inConnection->outputOffset) < kMy_OutputLowWaterMark))
+	{
+		setResumed(inConnection->readSource, inConnection->isReadSuspended, true);
+		processFrames(inConnection);
+		sendPendingEvents(inConnection);
+	}
+}// handleWritable
+
+
+/*!
+Returns true if so many bytes are waiting to be written that
+no more requests should be handled (or events sent) until
+the client catches up.
+
+(2017.10)
+*/
+bool
+isOutputCongested	(My_Connection*		inConnection)
+{
+	return ((inConnection->outputBuffer.size() - inConnection->outputOffset) > kMy_OutputHighWaterMark);
+}// isOutputCongested
+
+
+/*!
+Records a terminal change in what the next screen update
+for a viewer must cover.  Nothing is read from the terminal
+until the update is sent, so any number of changes costs the
+same as one.
+
+Pending rows move with each scroll, so that an update only
+checks the rows that a scroll blanks and the rows that were
+actually edited.  A terminal scroll reports an edit of every
+row just before it reports the scroll; that edit is undone
+here, as the viewer already has every row that only moved.
+
+(2017.10)
+*/
+void
+noteScreenChange	(My_ScreenViewer&		inoutViewer,
+					 ListenerModel_Event	inTerminalChange,
+					 void*					inEventContextPtr)
+{
+	switch (inTerminalChange)
+	{
+	case kTerminal_ChangeTextEdited:
+		{
+			Terminal_RangeDescriptionConstPtr	rangeInfoPtr = REINTERPRET_CAST(inEventContextPtr,
+																				Terminal_RangeDescriptionConstPtr);
+			SInt64 const						kPastEndRow = std::min(STATIC_CAST(rangeInfoPtr->firstRow, SInt64) + rangeInfoPtr->rowCount,
+																		STATIC_CAST(inoutViewer.rowHashes.size(), SInt64));
+			
+			
+			inoutViewer.isScreenEditLast = ((false == inoutViewer.rowHashes.empty()) && (rangeInfoPtr->firstRow <= 0) &&
+											(kPastEndRow == STATIC_CAST(inoutViewer.rowHashes.size(), SInt64)));
+			if (inoutViewer.isScreenEditLast)
+			{
+				inoutViewer.rowsBeforeScreenEdit = inoutViewer.pendingRows;
+			}
+			
+			// scrollback rows are not part of the screen
+			for (SInt64 i = std::max(STATIC_CAST(rangeInfoPtr->firstRow, SInt64), STATIC_CAST(0, SInt64)); i < kPastEndRow; ++i)
+			{
+				inoutViewer.pendingRows.insert(STATIC_CAST(i, UInt16));
+			}
+		}
+		break;
+	
+	case kTerminal_ChangeScrollActivity:
+		{
+			Terminal_ScrollDescriptionConstPtr	scrollInfoPtr = REINTERPRET_CAST(inEventContextPtr,
+																				Terminal_ScrollDescriptionConstPtr);
+			SInt32 const						kRowCount = STATIC_CAST(inoutViewer.rowHashes.size(), SInt32);
+			SInt32 const						kRowDelta = scrollInfoPtr->rowDelta;
+			std::set< UInt16 >					shiftedRows;
+			
+			
+			inoutViewer.pendingScrollDelta += kRowDelta;
+			if (0 != kRowDelta)
+			{
+				// the edit of every row that came with the scroll only
+				// moved rows, and the viewer moves its own copy of them
+				if (inoutViewer.isScreenEditLast)
+				{
+					inoutViewer.pendingRows.swap(inoutViewer.rowsBeforeScreenEdit);
+				}
+				
+				for (auto rowNumber : inoutViewer.pendingRows)
+				{
+					SInt32 const	kShiftedRow = rowNumber + kRowDelta;
+					
+					
+					if ((kShiftedRow >= 0) && (kShiftedRow < kRowCount))
+					{
+						shiftedRows.insert(shiftedRows.end(), STATIC_CAST(kShiftedRow, UInt16));
+					}
+				}
+				
+				// rows that the scroll blanks are unknown to the viewer
+				for (SInt32 i = std::max(((kRowDelta < 0) ? (kRowCount + kRowDelta) : 0), 0);
+						i < std::min(((kRowDelta < 0) ? kRowCount : kRowDelta), kRowCount); ++i)
+				{
+					shiftedRows.insert(STATIC_CAST(i, UInt16));
+				}
+				
+				inoutViewer.pendingRows.swap(shiftedRows);
+			}
+			inoutViewer.rowsBeforeScreenEdit.clear();
+			inoutViewer.isScreenEditLast = false;
+		}
+		break;
+	
+	case kTerminal_ChangeCursorLocation:
+	case kTerminal_ChangeCursorState:
+		inoutViewer.isCursorPending = true;
+		break;
+	
+	case kTerminal_ChangeScreenSize:
+		inoutViewer.isSnapshotPending = true;
+		break;
+	
+	default:
+		// ???
+		break;
+	}
+}// noteScreenChange
+
+
+/*!
+Handles every complete request that has been received, in
+order, and writes the replies.  If the client stops reading
+replies, requests are left in the parser and the socket is
+no longer read; this pushes back on a client that pipelines
+requests faster than it consumes the results.
+
+(2017.10)
+*/
+void
+processFrames	(My_Connection*		inConnection)
+{
+	ScriptHostProtocol_Frame	frame;
+	
+	
+	while ((false == inConnection->isClosed) && (false == isOutputCongested(inConnection)) &&
+			inConnection->parser.nextFrame(frame))
+	{
+		handleFrame(inConnection, frame);
+	}
+	
+	unless (inConnection->isClosed)
+	{
+		if (inConnection->parser.isCorrupt())
+		{
+			Console_Warning(Console_WriteLine, "closing script host connection with invalid frame");
+			closeConnection(inConnection);
+		}
+		else
+		{
+			flushOutput(inConnection);
+			if (isOutputCongested(inConnection))
+			{
+				setResumed(inConnection->readSource, inConnection->isReadSuspended, false);
+			}
+		}
+	}
+}// processFrames
+
+
+/*!
+Records that lines changed in the given session, for every
+connection that watches it, and arranges for events to be
+sent soon.  Lines that change again before their event is
+sent are only reported once.
+
+(2017.10)
+*/
+void
+queueLineChanges	(UInt32		inSessionID,
+					 SInt32		inFirstLine,
+					 UInt32		inLineCount)
+{
+	for (auto connectionPtr : gConnections())
+	{
+		if (connectionPtr->watchedSessionIDs.end() != connectionPtr->watchedSessionIDs.find(inSessionID))
+		{
+			std::set< SInt32 >&		lineSet = connectionPtr->pendingLineChanges[inSessionID];
+			
+			
+			for (UInt32 i = 0; i < inLineCount; ++i)
+			{
+				lineSet.insert(inFirstLine + STATIC_CAST(i, SInt32));
+			}
+		}
+	}
+	scheduleEventDelivery();
+}// queueLineChanges
+
+
+/*!
+Queues a session event for every greeted connection, and
+arranges for events to be sent soon.
+
+(2017.10)
+*/
+void
+queueSessionEvent	(UInt16		inEventType,
+					 UInt32		inSessionID)
+{
+	My_PendingEvent		event = { inEventType, inSessionID };
+	
+	
+	for (auto connectionPtr : gConnections())
+	{
+		if (connectionPtr->isGreeted)
+		{
+			connectionPtr->pendingSessionEvents.push_back(event);
+		}
+	}
+	scheduleEventDelivery();
+}// queueSessionEvent
+
+
+/*!
+Balances a call to retainScreenWatch(); once nothing uses
+the watch of the given session, its terminal is no longer
+monitored.
+
+(2017.10)
+*/
+void
+releaseScreenWatch	(UInt32		inSessionID)
+{
+	auto	toWatch = gScreenWatches().find(inSessionID);
+	
+	
+	if (gScreenWatches().end() != toWatch)
+	{
+		My_ScreenWatch*		watchPtr = toWatch->second;
+		
+		
+		--(watchPtr->watcherCount);
+		if (0 == watchPtr->watcherCount)
+		{
+			Terminal_StopMonitoring(watchPtr->screen, kTerminal_ChangeTextEdited, watchPtr->listener.returnRef());
+			Terminal_StopMonitoring(watchPtr->screen, kTerminal_ChangeScrollActivity, watchPtr->listener.returnRef());
+			Terminal_StopMonitoring(watchPtr->screen, kTerminal_ChangeCursorLocation, watchPtr->listener.returnRef());
+			Terminal_StopMonitoring(watchPtr->screen, kTerminal_ChangeCursorState, watchPtr->listener.returnRef());
+			Terminal_StopMonitoring(watchPtr->screen, kTerminal_ChangeScreenSize, watchPtr->listener.returnRef());
+			gScreenWatches().erase(toWatch);
+			delete watchPtr;
+		}
+	}
+}// releaseScreenWatch
+
+
+/*!
+Ensures that the terminal of the given session is monitored,
+until a balancing call to releaseScreenWatch().  The session
+must have a terminal.
+
+(2017.10)
+*/
+void
+retainScreenWatch	(UInt32		inSessionID)
+{
+	My_ScreenWatch*&	watchPtr = gScreenWatches()[inSessionID];
+	
+	
+	if (nullptr == watchPtr)
+	{
+		watchPtr = new My_ScreenWatch;
+		watchPtr->sessionID = inSessionID;
+		watchPtr->screen = returnSessionScreen(returnSessionForID(inSessionID));
+		watchPtr->listener = ListenerModel_ListenerWrap(ListenerModel_NewStandardListener(screenChanged, watchPtr/* context */),
+														ListenerModel_ListenerWrap::kAlreadyRetained);
+		watchPtr->watcherCount = 0;
+		Terminal_StartMonitoring(watchPtr->screen, kTerminal_ChangeTextEdited, watchPtr->listener.returnRef());
+		Terminal_StartMonitoring(watchPtr->screen, kTerminal_ChangeScrollActivity, watchPtr->listener.returnRef());
+		Terminal_StartMonitoring(watchPtr->screen, kTerminal_ChangeCursorLocation, watchPtr->listener.returnRef());
+		Terminal_StartMonitoring(watchPtr->screen, kTerminal_ChangeCursorState, watchPtr->listener.returnRef());
+		Terminal_StartMonitoring(watchPtr->screen, kTerminal_ChangeScreenSize, watchPtr->listener.returnRef());
+	}
+	++(watchPtr->watcherCount);
+}// retainScreenWatch
+
+
+/*!
+Returns a 64-bit FNV-1a hash of everything that a screen
+update would send for a row; it is never 0.
+
+(2017.10)
+*/
+UInt64
+returnRowHash	(My_RowRunList const&	inRuns)
+{
+	UInt64 const	kPrime = 0x00000100000001B3ULL;
+	UInt64			result = 0xCBF29CE484222325ULL;
+	auto			addBytes = [&result, kPrime](void const* inBytes, size_t inByteCount)
+					{
+						UInt8 const*	bytePtr = STATIC_CAST(inBytes, UInt8 const*);
+						
+						
+						for (size_t i = 0; i < inByteCount; ++i)
+						{
+							result = ((result ^ bytePtr[i]) * kPrime);
+						}
+					};
+	
+	
+	for (auto const& run : inRuns)
+	{
+		UInt32 const	kFields[] =
+						{
+							run.firstColumn, run.columnCount,
+							run.attributes.returnValueInRange(kMy_AttributeBitsUpper),
+							run.attributes.returnValueInRange(kMy_AttributeBitsLower),
+							STATIC_CAST(run.text.size(), UInt32)
+						};
+		
+		
+		addBytes(kFields, sizeof(kFields));
+		addBytes(run.text.data(), run.text.size());
+	}
+	
+	// 0 means “unknown” to a viewer
+	if (0 == result)
+	{
+		result = 1;
+	}
+	return result;
+}// returnRowHash
+
+
+/*!
+Returns the session with the given protocol ID, or nullptr
+if there is no such session (or it is no longer valid).
+
+(2017.10)
+*/
+SessionRef
+returnSessionForID	(UInt32		inSessionID)
+{
+	auto		toSession = gSessionsByID().find(inSessionID);
+	SessionRef	result = nullptr;
+	
+	
+	if ((gSessionsByID().end() != toSession) && Session_IsValid(toSession->second))
+	{
+		result = toSession->second;
+	}
+	return result;
+}// returnSessionForID
+
+
+/*!
+Returns the ID that identifies the given session in the
+protocol, assigning a new one if necessary.  IDs are never
+reused while the application is running.
+
+(2017.10)
+*/
+UInt32
+returnSessionID		(SessionRef		inSession)
+{
+	auto	toID = gSessionIDsByRef().find(inSession);
+	UInt32	result = 0;
+	
+	
+	if (gSessionIDsByRef().end() != toID)
+	{
+		result = toID->second;
+	}
+	else
+	{
+		result = gNextSessionID++;
+		gSessionIDsByRef()[inSession] = result;
+		gSessionsByID()[result] = inSession;
+	}
+	return result;
+}// returnSessionID
+
+
+/*!
+Returns the terminal that a session is currently displaying
+(or the only terminal of a headless session), or nullptr if
+there is none (or the session is nullptr).
+
+(2017.10)
+*/
+TerminalScreenRef
+returnSessionScreen		(SessionRef		inSessionOrNull)
+{
+	TerminalWindowRef	terminalWindow = (nullptr == inSessionOrNull) ? nullptr : Session_ReturnActiveTerminalWindow(inSessionOrNull);
+	TerminalScreenRef	result = (nullptr == terminalWindow) ? nullptr : TerminalWindow_ReturnScreenWithFocus(terminalWindow);
+	
+	
+	if ((nullptr == result) && (nullptr != inSessionOrNull))
+	{
+		result = SessionFactory_ReturnHeadlessSessionScreen(inSessionOrNull);
+	}
+	return result;
+}// returnSessionScreen
+
+
+/*!
+Arranges for sendPendingEvents() to be called for every
+connection on the next pass of the main queue.  This is how
+a burst of changes becomes a single event per session.
+
+(2017.10)
+*/
+void
+scheduleEventDelivery ()
+{
+	unless (gIsEventDeliveryPending)
+	{
+		gIsEventDeliveryPending = true;
+		dispatch_async(dispatch_get_main_queue(),
+		^{
+			My_ConnectionSet const	kConnectionsCopy = gConnections();
+			
+			
+			gIsEventDeliveryPending = false;
+			for (auto connectionPtr : kConnectionsCopy)
+			{
+				sendPendingEvents(connectionPtr);
+			}
+		});
+	}
+}// scheduleEventDelivery
+
+
+/*!
+Invoked whenever text, scrolling, the cursor or the size
+changes in a terminal that at least one client is watching.
+
+(2017.10)
+*/
+void
+screenChanged	(ListenerModel_Ref		UNUSED_ARGUMENT(inUnusedModel),
+				 ListenerModel_Event	inTerminalChange,
+				 void*					inEventContextPtr,
+				 void*					inScreenWatchPtr)
+{
+	My_ScreenWatch*		watchPtr = REINTERPRET_CAST(inScreenWatchPtr, My_ScreenWatch*);
+	
+	
+	switch (inTerminalChange)
+	{
+	case kTerminal_ChangeTextEdited:
+		{
+			Terminal_RangeDescriptionConstPtr	rangeInfoPtr = REINTERPRET_CAST(inEventContextPtr,
+																				Terminal_RangeDescriptionConstPtr);
+			
+			
+			queueLineChanges(watchPtr->sessionID, rangeInfoPtr->firstRow, rangeInfoPtr->rowCount);
+		}
+		break;
+	
+	default:
+		// other changes only affect screen updates
+		break;
+	}
+	
+	for (auto connectionPtr : gConnections())
+	{
+		auto	toViewer = connectionPtr->screenViewers.find(watchPtr->sessionID);
+		
+		
+		if (connectionPtr->screenViewers.end() != toViewer)
+		{
+			noteScreenChange(toViewer->second, inTerminalChange, inEventContextPtr);
+		}
+	}
+	scheduleEventDelivery();
+}// screenChanged
+
+
+/*!
+Appends an error reply for the given request.
+
+(2017.10)
+*/
+void
+sendError	(My_Connection*					inConnection,
+			 UInt32							inRequestID,
+			 ScriptHostProtocol_ErrorCode	inErrorCode,
+			 char const*					inDescription)
+{
+	ScriptHostProtocol_Writer	writer(inConnection->outputBuffer, kScriptHostProtocol_MessageError, inRequestID);
+	
+	
+	writer.appendUInt32(inErrorCode);
+	writer.appendBytes(inDescription, std::strlen(inDescription));
+	writer.finish();
+}// sendError
+
+
+/*!
+Sends as many waiting events as the client has granted credit
+for (session events first, since line numbers only make sense
+for open sessions), one credit per event.  Screen updates are
+last; a viewer without credit accumulates changes, so when it
+catches up it receives one update per screen.
+
+(2017.10)
+*/
+void
+sendPendingEvents	(My_Connection*		inConnection)
+{
+	while ((false == inConnection->isClosed) && (inConnection->eventCredit > 0) && (false == isOutputCongested(inConnection)))
+	{
+		if (false == inConnection->pendingSessionEvents.empty())
+		{
+			My_PendingEvent const		kEvent = inConnection->pendingSessionEvents.front();
+			ScriptHostProtocol_Writer	writer(inConnection->outputBuffer, kEvent.type, 0/* request ID */);
+			
+			
+			inConnection->pendingSessionEvents.pop_front();
+			writer.appendUInt32(kEvent.sessionID);
+			writer.finish();
+		}
+		else if (false == inConnection->pendingLineChanges.empty())
+		{
+			auto						toLineSet = inConnection->pendingLineChanges.begin();
+			ScriptHostProtocol_Writer	writer(inConnection->outputBuffer, kScriptHostProtocol_MessageEventLinesChanged, 0/* request ID */);
+			
+			
+			writer.appendUInt32(toLineSet->first);
+			writer.appendUInt32(STATIC_CAST(toLineSet->second.size(), UInt32));
+			for (auto lineNumber : toLineSet->second)
+			{
+				writer.appendSInt32(lineNumber);
+			}
+			writer.finish();
+			inConnection->pendingLineChanges.erase(toLineSet);
+		}
+		else if (sendScreenUpdate(inConnection))
+		{
+			// the update has been written
+		}
+		else
+		{
+			break;
+		}
+		--(inConnection->eventCredit);
+	}
+	flushOutput(inConnection);
+}// sendPendingEvents
+
+
+/*!
+Writes a screen update for the first viewed session that
+has pending changes, returning true if one was written.
+Changes that turn out to be invisible to the client (such
+as text that was rewritten with the same content) are
+discarded without using credit.
+
+(2017.10)
+*/
+bool
+sendScreenUpdate	(My_Connection*		inConnection)
+{
+	bool	result = false;
+	
+	
+	for (auto& sessionViewerPair : inConnection->screenViewers)
+	{
+		My_ScreenViewer&	viewer = sessionViewerPair.second;
+		
+		
+		if (viewer.isSnapshotPending || viewer.isCursorPending || (0 != viewer.pendingScrollDelta) ||
+			(false == viewer.pendingRows.empty()))
+		{
+			TerminalScreenRef	screen = returnSessionScreen(returnSessionForID(sessionViewerPair.first));
+			
+			
+			if (nullptr != screen)
+			{
+				result = writeScreenUpdate(inConnection->outputBuffer, sessionViewerPair.first, screen, viewer);
+			}
+			if (result)
+			{
+				break;
+			}
+		}
+	}
+	return result;
+}// sendScreenUpdate
+
+
+/*!
+Invoked whenever a session changes state or its window is
+about to be destroyed; clients are told about sessions that
+open and close, and screens that go away are no longer
+watched.
+
+(2017.10)
+*/
+void
+sessionChanged	(ListenerModel_Ref		UNUSED_ARGUMENT(inUnusedModel),
+				 ListenerModel_Event	inSessionChange,
+				 void*					inEventContextPtr,
+				 void*					UNUSED_ARGUMENT(inListenerContextPtr))
+{
+	SessionRef		session = REINTERPRET_CAST(inEventContextPtr, SessionRef);
+	auto			toID = gSessionIDsByRef().find(session);
+	
+	
+	switch (inSessionChange)
+	{
+	case kSession_ChangeState:
+		switch (Session_ReturnState(session))
+		{
+		case kSession_StateInitialized:
+		case kSession_StateActiveUnstable:
+			if (gSessionIDsByRef().end() == toID)
+			{
+				queueSessionEvent(kScriptHostProtocol_MessageEventSessionOpened, returnSessionID(session));
+			}
+			break;
+		
+		case kSession_StateImminentDisposal:
+			forgetSession(session);
+			break;
+		
+		default:
+			// ???
+			break;
+		}
+		break;
+	
+	case kSession_ChangeWindowInvalid:
+		// the terminal is about to be destroyed
+		if (gSessionIDsByRef().end() != toID)
+		{
+			for (auto connectionPtr : gConnections())
+			{
+				stopWatchingLines(connectionPtr, toID->second);
+				stopWatchingScreen(connectionPtr, toID->second);
+			}
+		}
+		break;
+	
+	default:
+		// ???
+		break;
+	}
+}// sessionChanged
+
+
+/*!
+Invoked whenever a headless session is created or is about
+to be destroyed; clients are told about these exactly as
+they are about sessions that have windows.
+
+(2017.10)
+*/
+void
+sessionFactoryChanged	(ListenerModel_Ref		UNUSED_ARGUMENT(inUnusedModel),
+						 ListenerModel_Event	inFactoryChange,
+						 void*					inEventContextPtr,
+						 void*					UNUSED_ARGUMENT(inListenerContextPtr))
+{
+	switch (inFactoryChange)
+	{
+	case kSessionFactory_ChangeHeadlessSessionCount:
+		{
+			SessionRef		session = REINTERPRET_CAST(inEventContextPtr, SessionRef);
+			
+			
+			if (kSession_StateImminentDisposal == Session_ReturnState(session))
+			{
+				forgetSession(session);
+			}
+			else if (gSessionIDsByRef().end() == gSessionIDsByRef().find(session))
+			{
+				queueSessionEvent(kScriptHostProtocol_MessageEventSessionOpened, returnSessionID(session));
+			}
+		}
+		break;
+	
+	default:
+		// ???
+		break;
+	}
+}// sessionFactoryChanged
+
+
+/*!
+Resumes or suspends a dispatch source, unless it is already
+in the requested state.  (Suspensions are counted, so they
+must be balanced exactly.)
+
+(2017.10)
+*/
+void
+setResumed	(dispatch_source_t	inSource,
+			 bool&				inoutIsSuspended,
+			 bool				inResume)
+{
+	if (inResume && inoutIsSuspended)
+	{
+		inoutIsSuspended = false;
+		dispatch_resume(inSource);
+	}
+	else if ((false == inResume) && (false == inoutIsSuspended))
+	{
+		inoutIsSuspended = true;
+		dispatch_suspend(inSource);
+	}
+}// setResumed
+
+
+/*!
+Enables “lines changed” events for the given session on the
+given connection; the session’s terminal is monitored as long
+as at least one connection watches it.  The session must have
+a terminal.
+
+(2017.10)
+*/
+void
+startWatchingLines	(My_Connection*		inConnection,
+					 UInt32				inSessionID)
+{
+	if (inConnection->watchedSessionIDs.insert(inSessionID).second)
+	{
+		retainScreenWatch(inSessionID);
+	}
+}// startWatchingLines
+
+
+/*!
+Enables “screen update” events for the given session on the
+given connection; the next update is a snapshot if the screen
+was not already being viewed or if resynchronization is
+requested (for instance, because the client lost its copy).
+The session must have a terminal.
+
+(2017.10)
+*/
+void
+startWatchingScreen		(My_Connection*		inConnection,
+						 UInt32				inSessionID,
+						 bool				inResynchronize)
+{
+	auto	insertResult = inConnection->screenViewers.insert(std::make_pair(inSessionID, My_ScreenViewer()));
+	
+	
+	if (insertResult.second)
+	{
+		retainScreenWatch(inSessionID);
+	}
+	else if (inResynchronize)
+	{
+		insertResult.first->second.isSnapshotPending = true;
+	}
+	scheduleEventDelivery();
+}// startWatchingScreen
+
+
+/*!
+Disables “lines changed” events for the given session on the
+given connection, if they were enabled.  If no other client
+watches the session, its terminal is no longer monitored.
+
+(2017.10)
+*/
+void
+stopWatchingLines	(My_Connection*		inConnection,
+					 UInt32				inSessionID)
+{
+	if (inConnection->watchedSessionIDs.erase(inSessionID) > 0)
+	{
+		releaseScreenWatch(inSessionID);
+	}
+}// stopWatchingLines
+
+
+/*!
+Disables “screen update” events for the given session on the
+given connection, if they were enabled; changes that were not
+sent yet are discarded.  If nothing else watches the session,
+its terminal is no longer monitored.
+
+(2017.10)
+*/
+void
+stopWatchingScreen	(My_Connection*		inConnection,
+					 UInt32				inSessionID)
+{
+	if (inConnection->screenViewers.erase(inSessionID) > 0)
+	{
+		releaseScreenWatch(inSessionID);
+	}
+}// stopWatchingScreen
+
+
+/*!
+Tests pipelined requests from a stand-in client: several
+requests are written at once (including one sent before the
+“hello” and one of an unknown type), and every reply must
+arrive in order with the matching request ID.
+
+Returns "true" if ALL assertions pass; "false" is
+returned if any fail, however messages should be
+printed for ALL assertion failures regardless.
+
+(2017.10)
+*/
+Boolean
+unitTest_Loopback_000 ()
+{
+	int			socketPair[2] = { -1, -1 };
+	Boolean		result = true;
+	
+	
+	result &= Console_Assert("socket pair created", 0 == socketpair(AF_UNIX, SOCK_STREAM, 0, socketPair));
+	if (result)
+	{
+		My_Connection*			connectionPtr = attachConnection(socketPair[0]);
+		int						clientSocket = socketPair[1];
+		std::vector< UInt8 >	requests;
+		
+		
+		UNUSED_RETURN(int)fcntl(clientSocket, F_SETFL, O_NONBLOCK);
+		result &= Console_Assert("connection attached", nullptr != connectionPtr);
+		
+		// write all requests before reading any replies
+		{
+			ScriptHostProtocol_Writer	writer(requests, kScriptHostProtocol_MessageListSessions, 1);
+			
+			
+			writer.finish();
+		}
+		{
+			ScriptHostProtocol_Writer	writer(requests, kScriptHostProtocol_MessageHello, 2);
+			
+			
+			writer.appendUInt16(kScriptHostProtocol_Version);
+			writer.appendUInt32(0/* event credit */);
+			writer.finish();
+		}
+		{
+			ScriptHostProtocol_Writer	writer(requests, 0x7777/* not a valid type */, 3);
+			
+			
+			writer.finish();
+		}
+		{
+			ScriptHostProtocol_Writer	writer(requests, kScriptHostProtocol_MessageReadLines, 4);
+			
+			
+			writer.appendUInt32(0/* no session has this ID */);
+			writer.appendSInt32(0);
+			writer.appendUInt32(10);
+			writer.finish();
+		}
+		result &= Console_Assert("requests written", STATIC_CAST(requests.size(), ssize_t) ==
+														write(clientSocket, requests.data(), requests.size()));
+		
+		if (nullptr != connectionPtr)
+		{
+			handleReadable(connectionPtr);
+			
+			{
+				std::vector< ScriptHostProtocol_Frame >		replies = unitTest_ReadFrames(clientSocket);
+				
+				
+				result &= Console_Assert("reply count", 4 == replies.size());
+				if (4 == replies.size())
+				{
+					result &= Console_Assert("reply 1 is error", kScriptHostProtocol_MessageError == replies[0].type);
+					result &= Console_Assert("reply 1 ID", 1 == replies[0].requestID);
+					result &= Console_Assert("reply 2 is hello", kScriptHostProtocol_MessageReply == replies[1].type);
+					result &= Console_Assert("reply 2 ID", 2 == replies[1].requestID);
+					result &= Console_Assert("reply 3 is error", kScriptHostProtocol_MessageError == replies[2].type);
+					result &= Console_Assert("reply 3 ID", 3 == replies[2].requestID);
+					result &= Console_Assert("reply 4 is error", kScriptHostProtocol_MessageError == replies[3].type);
+					result &= Console_Assert("reply 4 ID", 4 == replies[3].requestID);
+					{
+						ScriptHostProtocol_Reader	reader(replies[3].payload);
+						UInt32						errorCode = 0;
+						
+						
+						result &= Console_Assert("reply 4 has code", reader.readUInt32(errorCode));
+						result &= Console_Assert("reply 4 code", kScriptHostProtocol_ErrorNoSuchSession == errorCode);
+					}
+				}
+			}
+			
+			closeConnection(connectionPtr);
+		}
+		UNUSED_RETURN(int)close(clientSocket);
+	}
+	
+	return result;
+}// unitTest_Loopback_000
+
+
+/*!
+Tests event flow control with a stand-in client: changes to
+watched lines must be coalesced into one event per session,
+and nothing may be sent without credit until the client
+grants more.
+
+Returns "true" if ALL assertions pass; "false" is
+returned if any fail, however messages should be
+printed for ALL assertion failures regardless.
+
+(2017.10)
+*/
+Boolean
+unitTest_Loopback_001 ()
+{
+	UInt32 const	kFakeSessionID = 0xFFFFFFF0; // not a real session; lines are queued directly
+	int				socketPair[2] = { -1, -1 };
+	Boolean			result = true;
+	
+	
+	result &= Console_Assert("socket pair created", 0 == socketpair(AF_UNIX, SOCK_STREAM, 0, socketPair));
+	if (result)
+	{
+		My_Connection*			connectionPtr = attachConnection(socketPair[0]);
+		int						clientSocket = socketPair[1];
+		
+		
+		UNUSED_RETURN(int)fcntl(clientSocket, F_SETFL, O_NONBLOCK);
+		result &= Console_Assert("connection attached", nullptr != connectionPtr);
+		if (nullptr != connectionPtr)
+		{
+			connectionPtr->isGreeted = true;
+			connectionPtr->eventCredit = 1;
+			connectionPtr->watchedSessionIDs.insert(kFakeSessionID); // bypass the screen monitor
+			
+			// a burst of changes, delivered with one credit
+			queueLineChanges(kFakeSessionID, 3, 2);
+			queueLineChanges(kFakeSessionID, 2, 3);
+			queueLineChanges(kFakeSessionID, -1, 1);
+			sendPendingEvents(connectionPtr);
+			{
+				std::vector< ScriptHostProtocol_Frame >		events = unitTest_ReadFrames(clientSocket);
+				
+				
+				result &= Console_Assert("one event for burst", 1 == events.size());
+				if (1 == events.size())
+				{
+					ScriptHostProtocol_Reader	reader(events[0].payload);
+					UInt32						sessionID = 0;
+					UInt32						lineCount = 0;
+					SInt32						lineNumber = 0;
+					
+					
+					result &= Console_Assert("event type", kScriptHostProtocol_MessageEventLinesChanged == events[0].type);
+					result &= Console_Assert("event has no request ID", 0 == events[0].requestID);
+					result &= Console_Assert("event session", reader.readUInt32(sessionID) && (kFakeSessionID == sessionID));
+					result &= Console_Assert("event line count", reader.readUInt32(lineCount) && (4 == lineCount));
+					result &= Console_Assert("event first line", reader.readSInt32(lineNumber) && (-1 == lineNumber));
+					result &= Console_Assert("event second line", reader.readSInt32(lineNumber) && (2 == lineNumber));
+				}
+			}
+			
+			// without credit, changes are held
+			queueLineChanges(kFakeSessionID, 9, 1);
+			sendPendingEvents(connectionPtr);
+			result &= Console_Assert("no event without credit", unitTest_ReadFrames(clientSocket).empty());
+			
+			// granting credit releases them
+			{
+				std::vector< UInt8 >		request;
+				ScriptHostProtocol_Writer	writer(request, kScriptHostProtocol_MessageGrantCredit, 5);
+				
+				
+				writer.appendUInt32(10);
+				writer.finish();
+				result &= Console_Assert("credit written", STATIC_CAST(request.size(), ssize_t) ==
+															write(clientSocket, request.data(), request.size()));
+				handleReadable(connectionPtr);
+				{
+					std::vector< ScriptHostProtocol_Frame >		events = unitTest_ReadFrames(clientSocket);
+					
+					
+					result &= Console_Assert("held event sent after credit", 1 == events.size());
+					result &= Console_Assert("credit consumed", 9 == connectionPtr->eventCredit);
+				}
+			}
+			
+			closeConnection(connectionPtr);
+		}
+		UNUSED_RETURN(int)close(clientSocket);
+	}
+	
+	return result;
+}// unitTest_Loopback_001
+
+
+/*!
+Tests headless sessions with a stand-in client: a screen
+that is too wide or too tall must be rejected, a valid
+request must start a session (with a screen of the given
+size) and reply with its ID, and closing the session must
+destroy it.
+
+Returns "true" if ALL assertions pass; "false" is
+returned if any fail, however messages should be
+printed for ALL assertion failures regardless.
+
+(2017.10)
+*/
+Boolean
+unitTest_Loopback_002 ()
+{
+	int			socketPair[2] = { -1, -1 };
+	Boolean		result = true;
+	
+	
+	result &= Console_Assert("socket pair created", 0 == socketpair(AF_UNIX, SOCK_STREAM, 0, socketPair));
+	if (result)
+	{
+		My_Connection*			connectionPtr = attachConnection(socketPair[0]);
+		int						clientSocket = socketPair[1];
+		std::vector< UInt8 >	requests;
+		auto					appendSpawnRequest = [&requests](UInt32 inRequestID, UInt16 inColumnCount, UInt16 inRowCount)
+												{
+													ScriptHostProtocol_Writer	writer(requests, kScriptHostProtocol_MessageSpawnHeadless,
+																						inRequestID);
+													
+													
+													writer.appendUInt16(inColumnCount);
+													writer.appendUInt16(inRowCount);
+													writer.appendUInt32(0/* scrollback rows */);
+													writer.appendCountedBytes("", 0/* default working directory */);
+													writer.appendUInt32(1/* argument count */);
+													writer.appendCountedBytes("/bin/cat", 8);
+													writer.finish();
+												};
+		
+		
+		UNUSED_RETURN(int)fcntl(clientSocket, F_SETFL, O_NONBLOCK);
+		result &= Console_Assert("connection attached", nullptr != connectionPtr);
+		
+		{
+			ScriptHostProtocol_Writer	writer(requests, kScriptHostProtocol_MessageHello, 1);
+			
+			
+			writer.appendUInt16(kScriptHostProtocol_Version);
+			writer.appendUInt32(0/* event credit */);
+			writer.finish();
+		}
+		appendSpawnRequest(2, STATIC_CAST(Terminal_ReturnAllocatedColumnCount() + 1, UInt16), 24);
+		appendSpawnRequest(3, 80, kMy_MaximumHeadlessRowCount + 1);
+		appendSpawnRequest(4, 80, 24);
+		result &= Console_Assert("requests written", STATIC_CAST(requests.size(), ssize_t) ==
+														write(clientSocket, requests.data(), requests.size()));
+		
+		if (nullptr != connectionPtr)
+		{
+			UInt32		sessionID = 0;
+			
+			
+			handleReadable(connectionPtr);
+			
+			{
+				std::vector< ScriptHostProtocol_Frame >		replies = unitTest_ReadFrames(clientSocket);
+				
+				
+				result &= Console_Assert("reply count", 4 == replies.size());
+				if (4 == replies.size())
+				{
+					result &= Console_Assert("too wide is error", kScriptHostProtocol_MessageError == replies[1].type);
+					result &= Console_Assert("too wide ID", 2 == replies[1].requestID);
+					result &= Console_Assert("too tall is error", kScriptHostProtocol_MessageError == replies[2].type);
+					result &= Console_Assert("too tall ID", 3 == replies[2].requestID);
+					for (size_t i = 1; i <= 2; ++i)
+					{
+						ScriptHostProtocol_Reader	reader(replies[i].payload);
+						UInt32						errorCode = 0;
+						
+						
+						result &= Console_Assert("too large code", reader.readUInt32(errorCode) &&
+																	(kScriptHostProtocol_ErrorMalformedPayload == errorCode));
+					}
+					result &= Console_Assert("spawn is reply", kScriptHostProtocol_MessageReply == replies[3].type);
+					result &= Console_Assert("spawn ID", 4 == replies[3].requestID);
+					{
+						ScriptHostProtocol_Reader	reader(replies[3].payload);
+						
+						
+						result &= Console_Assert("spawn session ID", reader.readUInt32(sessionID) && reader.isAtEnd());
+					}
+				}
+			}
+			
+			{
+				SessionRef			session = returnSessionForID(sessionID);
+				TerminalScreenRef	screen = (nullptr == session) ? nullptr : SessionFactory_ReturnHeadlessSessionScreen(session);
+				
+				
+				result &= Console_Assert("session exists", nullptr != session);
+				result &= Console_Assert("session is headless", nullptr != screen);
+				if (nullptr != screen)
+				{
+					result &= Console_Assert("screen columns", 80 == Terminal_ReturnColumnCount(screen));
+					result &= Console_Assert("screen rows", 24 == Terminal_ReturnRowCount(screen));
+				}
+			}
+			
+			// close the session
+			if (nullptr != returnSessionForID(sessionID))
+			{
+				std::vector< UInt8 >		request;
+				ScriptHostProtocol_Writer	writer(request, kScriptHostProtocol_MessageCloseSession, 5);
+				
+				
+				writer.appendUInt32(sessionID);
+				writer.finish();
+				result &= Console_Assert("close written", STATIC_CAST(request.size(), ssize_t) ==
+															write(clientSocket, request.data(), request.size()));
+				handleReadable(connectionPtr);
+				{
+					std::vector< ScriptHostProtocol_Frame >		replies = unitTest_ReadFrames(clientSocket);
+					
+					
+					result &= Console_Assert("close reply count", 1 == replies.size());
+					result &= Console_Assert("close is reply", (1 == replies.size()) &&
+																(kScriptHostProtocol_MessageReply == replies[0].type) &&
+																(5 == replies[0].requestID));
+				}
+				result &= Console_Assert("session closed", nullptr == returnSessionForID(sessionID));
+			}
+			
+			closeConnection(connectionPtr);
+		}
+		UNUSED_RETURN(int)close(clientSocket);
+	}
+	
+	return result;
+}// unitTest_Loopback_002
+
+
+/*!
+Tests the frame parser with a stream of frames that arrives
+in arbitrary pieces, and with a corrupt header.
+
+Returns "true" if ALL assertions pass; "false" is
+returned if any fail, however messages should be
+printed for ALL assertion failures regardless.
+
+(2017.10)
+*/
+Boolean
+unitTest_Protocol_000 ()
+{
+	std::vector< UInt8 >	stream;
+	Boolean					result = true;
+	
+	
+	for (UInt32 i = 1; i <= 50; ++i)
+	{
+		ScriptHostProtocol_Writer	writer(stream, kScriptHostProtocol_MessageReadLines, i);
+		
+		
+		writer.appendUInt32(i);
+		writer.appendSInt32(-STATIC_CAST(i, SInt32));
+		writer.appendBytes("text", 4 * (i % 3));
+		writer.finish();
+	}
+	
+	for (UInt16 iteration = 0; ((result) && (iteration < 100)); ++iteration)
+	{
+		ScriptHostProtocol_FrameParser	parser;
+		ScriptHostProtocol_Frame		frame;
+		size_t							offset = 0;
+		UInt32							expectedID = 1;
+		
+		
+		while (offset < stream.size())
+		{
+			size_t const	kPieceSize = std::min(STATIC_CAST(1 + arc4random_uniform(40), size_t), stream.size() - offset);
+			
+			
+			parser.appendBytes(stream.data() + offset, kPieceSize);
+			offset += kPieceSize;
+			while (parser.nextFrame(frame))
+			{
+				ScriptHostProtocol_Reader	reader(frame.payload);
+				UInt32						value = 0;
+				SInt32						negativeValue = 0;
+				size_t						restCount = 0;
+				
+				
+				result &= Console_Assert("frame type", kScriptHostProtocol_MessageReadLines == frame.type);
+				result &= Console_Assert("frame ID", expectedID == frame.requestID);
+				result &= Console_Assert("frame value", reader.readUInt32(value) && (expectedID == value));
+				result &= Console_Assert("frame signed value", reader.readSInt32(negativeValue) &&
+																(-STATIC_CAST(expectedID, SInt32) == negativeValue));
+				UNUSED_RETURN(UInt8 const*)reader.returnRemainingBytes(restCount);
+				result &= Console_Assert("frame remainder", (4 * (expectedID % 3)) == restCount);
+				result &= Console_Assert("frame fully read", reader.isAtEnd());
+				++expectedID;
+			}
+		}
+		result &= Console_Assert("all frames parsed", 51 == expectedID);
+	}
+	
+	// a length beyond the maximum cannot be recovered from
+	{
+		ScriptHostProtocol_FrameParser	parser;
+		ScriptHostProtocol_Frame		frame;
+		UInt8 const						kBadHeader[kScriptHostProtocol_HeaderSize] = { 0xFF, 0xFF, 0xFF, 0xFF, 0x01, 0x00 };
+		
+		
+		parser.appendBytes(kBadHeader, sizeof(kBadHeader));
+		result &= Console_Assert("corrupt frame not returned", false == parser.nextFrame(frame));
+		result &= Console_Assert("corrupt stream detected", parser.isCorrupt());
+	}
+	
+	// counted fields must be complete to be read
+	{
+		std::vector< UInt8 >		payload;
+		ScriptHostProtocol_Reader	reader(payload);
+		UInt8 const*				bytePtr = nullptr;
+		UInt32						byteCount = 0;
+		
+		
+		payload.assign({ 0x05, 0x00, 0x00, 0x00, 'a', 'b', 'c', 'd' });
+		result &= Console_Assert("truncated counted field", false == reader.readCountedBytes(bytePtr, byteCount));
+		payload.assign({ 0x00, 0x00, 0x00, 0x00, 0x05, 0x00, 0x00, 0x00, 'a', 'b', 'c', 'd', 'e' });
+		result &= Console_Assert("empty counted field", reader.readCountedBytes(bytePtr, byteCount) && (0 == byteCount));
+		result &= Console_Assert("counted field", reader.readCountedBytes(bytePtr, byteCount) && (5 == byteCount) &&
+													(0 == std::memcmp(bytePtr, "abcde", byteCount)));
+		result &= Console_Assert("counted fields fully read", reader.isAtEnd());
+	}
+	
+	return result;
+}// unitTest_Protocol_000
+
+
+/*!
+Reads every frame that is currently available on a stand-in
+client’s socket, without blocking.
+
+(2017.10)
+*/
+std::vector< ScriptHostProtocol_Frame >
+unitTest_ReadFrames		(int	inClientSocket)
+{
+	std::vector< ScriptHostProtocol_Frame >		result;
+	ScriptHostProtocol_FrameParser				parser;
+	ScriptHostProtocol_Frame					frame;
+	UInt8										buffer[4096];
+	ssize_t										bytesRead = 0;
+	
+	
+	while ((bytesRead = read(inClientSocket, buffer, sizeof(buffer))) > 0)
+	{
+		parser.appendBytes(buffer, STATIC_CAST(bytesRead, size_t));
+	}
+	while (parser.nextFrame(frame))
+	{
+		result.push_back(frame);
+	}
+	return result;
+}// unitTest_ReadFrames
+
+
+/*!
+Tests screen updates for a terminal that is not attached
+to any session: the first update must be a complete
+snapshot, an unchanged screen must not produce an update,
+and later updates must only include what changed
+(including after a scroll).
+
+Returns "true" if ALL assertions pass; "false" is
+returned if any fail, however messages should be
+printed for ALL assertion failures regardless.
+
+(2017.10)
+*/
+Boolean
+unitTest_ScreenUpdate_000 ()
+{
+	Preferences_ContextWrap		terminalConfig(Preferences_NewContext(Quills::Prefs::TERMINAL),
+												Preferences_ContextWrap::kAlreadyRetained);
+	Preferences_ContextWrap		translationConfig(Preferences_NewContext(Quills::Prefs::TRANSLATION),
+													Preferences_ContextWrap::kAlreadyRetained);
+	TerminalScreenRef			screen = nullptr;
+	Boolean						result = true;
+	
+	
+	result &= Console_Assert("screen created", kTerminal_ResultOK == Terminal_NewScreen(terminalConfig.returnRef(),
+																						translationConfig.returnRef(), &screen));
+	if (nullptr != screen)
+	{
+		UInt16 const			kRowCount = Terminal_ReturnRowCount(screen);
+		My_ScreenViewer			viewer;
+		std::vector< UInt8 >	buffer;
+		
+		
+		Terminal_EmulatorProcessCString(screen, "hello\r\nworld");
+		
+		// the first update has every row
+		result &= Console_Assert("snapshot written", writeScreenUpdate(buffer, 1/* session ID */, screen, viewer));
+		{
+			ScriptHostProtocol_FrameParser	parser;
+			ScriptHostProtocol_Frame		frame;
+			
+			
+			parser.appendBytes(buffer.data(), buffer.size());
+			result &= Console_Assert("snapshot frame", parser.nextFrame(frame));
+			{
+				ScriptHostProtocol_Reader	reader(frame.payload);
+				UInt32						sessionID = 0;
+				UInt8						flags = 0;
+				UInt16						columnCount = 0;
+				UInt16						rowCount = 0;
+				SInt32						scrollDelta = 0;
+				UInt16						cursorColumn = 0;
+				UInt16						cursorRow = 0;
+				UInt16						attributeCount = 0;
+				UInt32						attributeHalf = 0;
+				UInt16						changedRowCount = 0;
+				UInt16						rowNumber = 0;
+				UInt16						runCount = 0;
+				UInt16						runValue = 0;
+				UInt8 const*				textPtr = nullptr;
+				UInt32						textByteCount = 0;
+				
+				
+				result &= Console_Assert("snapshot type", kScriptHostProtocol_MessageEventScreenUpdate == frame.type);
+				result &= Console_Assert("snapshot session", reader.readUInt32(sessionID) && (1 == sessionID));
+				result &= Console_Assert("snapshot flag", reader.readUInt8(flags) &&
+															(0 != (flags & kScriptHostProtocol_ScreenUpdateFlagSnapshot)));
+				result &= Console_Assert("snapshot columns", reader.readUInt16(columnCount) &&
+																(Terminal_ReturnColumnCount(screen) == columnCount));
+				result &= Console_Assert("snapshot rows", reader.readUInt16(rowCount) && (kRowCount == rowCount));
+				result &= Console_Assert("snapshot scroll", reader.readSInt32(scrollDelta) && (0 == scrollDelta));
+				result &= Console_Assert("snapshot cursor column", reader.readUInt16(cursorColumn) && (5 == cursorColumn));
+				result &= Console_Assert("snapshot cursor row", reader.readUInt16(cursorRow) && (1 == cursorRow));
+				result &= Console_Assert("snapshot attributes", reader.readUInt16(attributeCount) && (attributeCount > 0));
+				for (UInt16 i = 0; i < (2 * attributeCount); ++i)
+				{
+					result &= Console_Assert("snapshot attribute", reader.readUInt32(attributeHalf));
+				}
+				result &= Console_Assert("snapshot row count", reader.readUInt16(changedRowCount) && (kRowCount == changedRowCount));
+				result &= Console_Assert("snapshot first row", reader.readUInt16(rowNumber) && (0 == rowNumber));
+				result &= Console_Assert("snapshot first row runs", reader.readUInt16(runCount) && (runCount > 0));
+				result &= Console_Assert("first run column", reader.readUInt16(runValue) && (0 == runValue));
+				result &= Console_Assert("first run width", reader.readUInt16(runValue) && (runValue >= 5));
+				result &= Console_Assert("first run attributes", reader.readUInt16(runValue) && (runValue < attributeCount));
+				result &= Console_Assert("first run text", reader.readCountedBytes(textPtr, textByteCount) &&
+															(textByteCount >= 5) && (0 == std::memcmp(textPtr, "hello", 5)));
+			}
+		}
+		
+		// nothing changed, so nothing is sent
+		buffer.clear();
+		viewer.isCursorPending = true;
+		result &= Console_Assert("no update without change", false == writeScreenUpdate(buffer, 1, screen, viewer));
+		result &= Console_Assert("nothing written", buffer.empty());
+		
+		// only the edited row is sent
+		Terminal_EmulatorProcessCString(screen, "!");
+		viewer.pendingRows.insert(0);
+		viewer.pendingRows.insert(1);
+		viewer.isCursorPending = true;
+		result &= Console_Assert("diff written", writeScreenUpdate(buffer, 1, screen, viewer));
+		{
+			ScriptHostProtocol_FrameParser	parser;
+			ScriptHostProtocol_Frame		frame;
+			
+			
+			parser.appendBytes(buffer.data(), buffer.size());
+			result &= Console_Assert("diff frame", parser.nextFrame(frame));
+			{
+				ScriptHostProtocol_Reader	reader(frame.payload);
+				UInt32						value32 = 0;
+				UInt16						value16 = 0;
+				UInt8						flags = 0;
+				SInt32						scrollDelta = 0;
+				UInt16						attributeCount = 0;
+				
+				
+				result &= Console_Assert("diff session", reader.readUInt32(value32));
+				result &= Console_Assert("diff is not snapshot", reader.readUInt8(flags) &&
+																	(0 == (flags & kScriptHostProtocol_ScreenUpdateFlagSnapshot)));
+				result &= Console_Assert("diff columns", reader.readUInt16(value16));
+				result &= Console_Assert("diff rows", reader.readUInt16(value16));
+				result &= Console_Assert("diff scroll", reader.readSInt32(scrollDelta) && (0 == scrollDelta));
+				result &= Console_Assert("diff cursor column", reader.readUInt16(value16) && (6 == value16));
+				result &= Console_Assert("diff cursor row", reader.readUInt16(value16) && (1 == value16));
+				result &= Console_Assert("diff attributes", reader.readUInt16(attributeCount));
+				for (UInt16 i = 0; i < (2 * attributeCount); ++i)
+				{
+					result &= Console_Assert("diff attribute", reader.readUInt32(value32));
+				}
+				result &= Console_Assert("diff has one row", reader.readUInt16(value16) && (1 == value16));
+				result &= Console_Assert("diff row number", reader.readUInt16(value16) && (1 == value16));
+			}
+		}
+		
+		// after a scroll, only the row that the scroll blanked is
+		// sent (the terminal reports an edit of every row and then
+		// the scroll, and the new text is then an edit of one row)
+		buffer.clear();
+		for (UInt16 i = 1; i < kRowCount; ++i)
+		{
+			Terminal_EmulatorProcessCString(screen, "\r\n");
+		}
+		Terminal_EmulatorProcessCString(screen, "new");
+		{
+			Terminal_RangeDescription	range;
+			Terminal_ScrollDescription	scrollInfo;
+			
+			
+			bzero(&range, sizeof(range));
+			range.screen = screen;
+			range.firstRow = 0;
+			range.columnCount = Terminal_ReturnColumnCount(screen);
+			range.rowCount = kRowCount;
+			noteScreenChange(viewer, kTerminal_ChangeTextEdited, &range);
+			
+			bzero(&scrollInfo, sizeof(scrollInfo));
+			scrollInfo.screen = screen;
+			scrollInfo.rowDelta = -1;
+			noteScreenChange(viewer, kTerminal_ChangeScrollActivity, &scrollInfo);
+			
+			range.firstRow = kRowCount - 1;
+			range.rowCount = 1;
+			noteScreenChange(viewer, kTerminal_ChangeTextEdited, &range);
+			noteScreenChange(viewer, kTerminal_ChangeCursorLocation, nullptr);
+		}
+		result &= Console_Assert("only the bottom row is pending", (1 == viewer.pendingRows.size()) &&
+																	((kRowCount - 1) == *(viewer.pendingRows.begin())));
+		result &= Console_Assert("scroll written", writeScreenUpdate(buffer, 1, screen, viewer));
+		{
+			ScriptHostProtocol_FrameParser	parser;
+			ScriptHostProtocol_Frame		frame;
+			
+			
+			parser.appendBytes(buffer.data(), buffer.size());
+			result &= Console_Assert("scroll frame", parser.nextFrame(frame));
+			{
+				ScriptHostProtocol_Reader	reader(frame.payload);
+				UInt32						value32 = 0;
+				UInt16						value16 = 0;
+				UInt8						flags = 0;
+				SInt32						scrollDelta = 0;
+				UInt16						attributeCount = 0;
+				UInt8 const*				textPtr = nullptr;
+				UInt32						textByteCount = 0;
+				
+				
+				result &= Console_Assert("scroll session", reader.readUInt32(value32));
+				result &= Console_Assert("scroll is not snapshot", reader.readUInt8(flags) &&
+																	(0 == (flags & kScriptHostProtocol_ScreenUpdateFlagSnapshot)));
+				result &= Console_Assert("scroll columns", reader.readUInt16(value16));
+				result &= Console_Assert("scroll rows", reader.readUInt16(value16));
+				result &= Console_Assert("scroll delta", reader.readSInt32(scrollDelta) && (-1 == scrollDelta));
+				result &= Console_Assert("scroll cursor column", reader.readUInt16(value16) && (3 == value16));
+				result &= Console_Assert("scroll cursor row", reader.readUInt16(value16) && ((kRowCount - 1) == value16));
+				result &= Console_Assert("scroll attributes", reader.readUInt16(attributeCount));
+				for (UInt16 i = 0; i < (2 * attributeCount); ++i)
+				{
+					result &= Console_Assert("scroll attribute", reader.readUInt32(value32));
+				}
+				result &= Console_Assert("scroll has one row", reader.readUInt16(value16) && (1 == value16));
+				result &= Console_Assert("scroll row number", reader.readUInt16(value16) && ((kRowCount - 1) == value16));
+				result &= Console_Assert("scroll row runs", reader.readUInt16(value16) && (value16 > 0));
+				result &= Console_Assert("scroll run column", reader.readUInt16(value16) && (0 == value16));
+				result &= Console_Assert("scroll run width", reader.readUInt16(value16));
+				result &= Console_Assert("scroll run attributes", reader.readUInt16(value16));
+				result &= Console_Assert("scroll run text", reader.readCountedBytes(textPtr, textByteCount) &&
+															(textByteCount >= 3) && (0 == std::memcmp(textPtr, "new", 3)));
+			}
+		}
+		
+		Terminal_ReleaseScreen(&screen);
+	}
+	
+	return result;
+}// unitTest_ScreenUpdate_000
+
+
+/*!
+Appends a screen update for the given viewer of a terminal
+and records that the viewer has it, returning true; or,
+returns false without writing anything if the viewer
+already has everything that an update would include.
+
+Rows are read through Terminal_ForEachLikeAttributeRunDo(),
+so an update has the same runs that a local view draws.
+After a scroll, the viewer moves its copy of the rows as
+well, so rows that only moved are not checked or sent
+again (see noteScreenChange()).  Only pending rows are
+checked, unless the update is a snapshot.
+
+(2017.10)
+*/
+bool
+writeScreenUpdate	(std::vector< UInt8 >&	inoutBuffer,
+					 UInt32					inSessionID,
+					 TerminalScreenRef		inScreen,
+					 My_ScreenViewer&		inoutViewer)
+{
+	UInt16 const						kColumnCount = Terminal_ReturnColumnCount(inScreen);
+	UInt16 const						kRowCount = Terminal_ReturnRowCount(inScreen);
+	bool const							kIsSnapshot = (inoutViewer.isSnapshotPending ||
+														(kColumnCount != inoutViewer.columnCount) ||
+														(kRowCount != inoutViewer.rowHashes.size()));
+	SInt32 const						kScrollDelta = (kIsSnapshot)
+														? 0
+														: std::max(std::min(inoutViewer.pendingScrollDelta, STATIC_CAST(kRowCount, SInt32)),
+																	-STATIC_CAST(kRowCount, SInt32));
+	std::set< UInt16 >					rowsToCheck;
+	std::map< UInt16, My_RowRunList >	changedRows;
+	UInt16								cursorColumn = 0;
+	UInt16								cursorRow = 0;
+	bool								isCursorVisible = Terminal_CursorIsVisible(inScreen);
+	bool								result = false;
+	
+	
+	UNUSED_RETURN(Terminal_Result)Terminal_CursorGetLocation(inScreen, &cursorColumn, &cursorRow);
+	
+	// bring the record of the viewer’s rows up to date with the
+	// scroll (rows that the viewer blanks are unknown, so they
+	// are always checked)
+	if (kIsSnapshot)
+	{
+		inoutViewer.rowHashes.assign(kRowCount, 0);
+		inoutViewer.columnCount = kColumnCount;
+	}
+	else if (kScrollDelta < 0)
+	{
+		std::copy(inoutViewer.rowHashes.begin() - kScrollDelta, inoutViewer.rowHashes.end(), inoutViewer.rowHashes.begin());
+		std::fill(inoutViewer.rowHashes.end() + kScrollDelta, inoutViewer.rowHashes.end(), 0);
+	}
+	else if (kScrollDelta > 0)
+	{
+		std::copy_backward(inoutViewer.rowHashes.begin(), inoutViewer.rowHashes.end() - kScrollDelta, inoutViewer.rowHashes.end());
+		std::fill(inoutViewer.rowHashes.begin(), inoutViewer.rowHashes.begin() + kScrollDelta, 0);
+	}
+	
+	if (kIsSnapshot)
+	{
+		for (UInt16 i = 0; i < kRowCount; ++i)
+		{
+			rowsToCheck.insert(rowsToCheck.end(), i);
+		}
+	}
+	else
+	{
+		rowsToCheck.swap(inoutViewer.pendingRows);
+	}
+	
+	for (auto rowNumber : rowsToCheck)
+	{
+		if (rowNumber < kRowCount)
+		{
+			My_RowRunList	runs;
+			
+			
+			captureRowRuns(inScreen, rowNumber, runs);
+			{
+				UInt64 const	kRowHash = returnRowHash(runs);
+				
+				
+				if (kRowHash != inoutViewer.rowHashes[rowNumber])
+				{
+					inoutViewer.rowHashes[rowNumber] = kRowHash;
+					changedRows[rowNumber].swap(runs);
+				}
+			}
+		}
+	}
+	
+	inoutViewer.pendingRows.clear();
+	inoutViewer.rowsBeforeScreenEdit.clear();
+	inoutViewer.pendingScrollDelta = 0;
+	inoutViewer.isScreenEditLast = false;
+	inoutViewer.isCursorPending = false;
+	inoutViewer.isSnapshotPending = false;
+	
+	result = (kIsSnapshot || (0 != kScrollDelta) || (false == changedRows.empty()) ||
+				(cursorColumn != inoutViewer.cursorColumn) || (cursorRow != inoutViewer.cursorRow) ||
+				(isCursorVisible != inoutViewer.isCursorVisible));
+	if (result)
+	{
+		ScriptHostProtocol_Writer		writer(inoutBuffer, kScriptHostProtocol_MessageEventScreenUpdate, 0/* request ID */);
+		std::map< UInt64, UInt16 >		attributeIndices;
+		std::vector< UInt64 >			attributeTable;
+		
+		
+		inoutViewer.cursorColumn = cursorColumn;
+		inoutViewer.cursorRow = cursorRow;
+		inoutViewer.isCursorVisible = isCursorVisible;
+		
+		// each distinct combination of attributes is sent once
+		for (auto const& rowRunsPair : changedRows)
+		{
+			for (auto const& run : rowRunsPair.second)
+			{
+				UInt64 const	kBits = ((STATIC_CAST(run.attributes.returnValueInRange(kMy_AttributeBitsUpper), UInt64) << 32) |
+											run.attributes.returnValueInRange(kMy_AttributeBitsLower));
+				
+				
+				if (attributeIndices.insert(std::make_pair(kBits, STATIC_CAST(attributeTable.size(), UInt16))).second)
+				{
+					attributeTable.push_back(kBits);
+				}
+			}
+		}
+		
+		writer.appendUInt32(inSessionID);
+		writer.appendUInt8(STATIC_CAST(((kIsSnapshot) ? kScriptHostProtocol_ScreenUpdateFlagSnapshot : 0) |
+										((isCursorVisible) ? kScriptHostProtocol_ScreenUpdateFlagCursorVisible : 0), UInt8));
+		writer.appendUInt16(kColumnCount);
+		writer.appendUInt16(kRowCount);
+		writer.appendSInt32(kScrollDelta);
+		writer.appendUInt16(cursorColumn);
+		writer.appendUInt16(cursorRow);
+		writer.appendUInt16(STATIC_CAST(attributeTable.size(), UInt16));
+		for (auto bits : attributeTable)
+		{
+			writer.appendUInt32(STATIC_CAST(bits >> 32, UInt32));
+			writer.appendUInt32(STATIC_CAST(bits & 0xFFFFFFFF, UInt32));
+		}
+		writer.appendUInt16(STATIC_CAST(changedRows.size(), UInt16));
+		for (auto const& rowRunsPair : changedRows)
+		{
+			writer.appendUInt16(rowRunsPair.first);
+			writer.appendUInt16(STATIC_CAST(rowRunsPair.second.size(), UInt16));
+			for (auto const& run : rowRunsPair.second)
+			{
+				UInt64 const	kBits = ((STATIC_CAST(run.attributes.returnValueInRange(kMy_AttributeBitsUpper), UInt64) << 32) |
+											run.attributes.returnValueInRange(kMy_AttributeBitsLower));
+				
+				
+				writer.appendUInt16(run.firstColumn);
+				writer.appendUInt16(run.columnCount);
+				writer.appendUInt16(attributeIndices[kBits]);
+				writer.appendCountedBytes(run.text.data(), STATIC_CAST(run.text.size(), UInt32));
+			}
+		}
+		writer.finish();
+	}
+	return result;
+}// writeScreenUpdate
+
+} // anonymous namespace
+
+// BELOW IS REQUIRED NEWLINE TO END FILE
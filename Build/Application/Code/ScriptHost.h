@@ -0,0 +1,84 @@
+/*!	\file ScriptHost.h
+	\brief Serves sessions to scripts that run in another
+	process, using the protocol in "ScriptHostProtocol.h"
+	over a local (UNIX domain) socket.
+	
+	A script in a separate process cannot stall the user
+	interface or crash the application; it only sees what
+	this module is willing to send.  All requests are handled
+	on the main thread, in the order they arrive, and replies
+	are written without blocking: a client that sends faster
+	than it reads is simply not read from until its replies
+	have drained.
+*/
+/*###############################################################
+
+	MacTerm
+		© 1998-2017 by Kevin Grant.
+		© 2001-2003 by Ian Anderson.
+		© 1986-1994 University of Illinois Board of Trustees
+		(see About box for full list of U of I contributors).
+	
+	This program is free software; you can redistribute it or
+	modify it under the terms of the GNU General Public License
+	as published by the Free Software Foundation; either version
+	2 of the License, or (at your option) any later version.
+	
+	This program is distributed in the hope that it will be
+	useful, but WITHOUT ANY WARRANTY; without even the implied
+	warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR
+	PURPOSE.  See the GNU General Public License for more
+	details.
+	
+	You should have received a copy of the GNU General Public
+	License along with this program; if not, write to:
+	
+		Free Software Foundation, Inc.
+		59 Temple Place, Suite 330
+		Boston, MA  02111-1307
+		USA
+
+###############################################################*/
+
+#include <UniversalDefines.h>
+
+#pragma once
+
+// Mac includes
+#include <CoreFoundation/CoreFoundation.h>
+
+
+
+#pragma mark Public Methods
+
+//!\name Initialization
+//@{
+
+void
+	ScriptHost_Init							();
+
+void
+	ScriptHost_Done							();
+
+//@}
+
+//!\name Module Tests
+//@{
+
+void
+	ScriptHost_RunTests						();
+
+//@}
+
+//!\name Connections
+//@{
+
+int
+	ScriptHost_NewLoopbackConnection		();
+
+CFStringRef
+	ScriptHost_ReturnSocketPath				();
+
+//@}
+
+// BELOW IS REQUIRED NEWLINE TO END FILE
@@ -90,6 +90,16 @@ enum
 	kSession_AllChanges					= '****',	//!< wildcard to indicate all events (context:
 													//!  varies)
 	
+	kSession_ChangeForegroundProcess	= 'FgPr',	//!< a different process group now owns the terminal of a
+													//!  monitored Session (for instance, the shell started or
+													//!  finished a job); use Session_ReturnForegroundProcessGroupID()
+													//!  to find the new group (context: SessionRef)
+	
+	kSession_ChangePasteProgress		= 'Pste',	//!< more of a pending Paste has been written to a monitored
+													//!  Session, or the Paste has ended; use the routine
+													//!  Session_GetPasteProgress() to find out how much remains
+													//!  (context: SessionRef)
+	
 	kSession_ChangeResourceLocation		= 'SURL',	//!< the URL of a monitored Session has been updated
 													//!  (context: SessionRef)
 	
@@ -284,7 +294,10 @@ enum
 {
 	kSession_StateAttributeNotification		= (1 << 0),	//!< a watch has triggered for the session that has not been cleared by user focus
 	kSession_StateAttributeOpenDialog		= (1 << 1),	//!< an alert element (typically a sheet) is currently applicable to the session
-	kSession_StateAttributeSuspendNetwork	= (1 << 2)	//!< a Scroll Lock (XOFF) was initiated, so data has stopped transmitting
+	kSession_StateAttributeSuspendNetwork	= (1 << 2),	//!< a Scroll Lock (XOFF) was initiated, so data has stopped transmitting
+	kSession_StateAttributePasteInProgress	= (1 << 3),	//!< a Paste is too large to send at once, and is still being streamed to the session
+	kSession_StateAttributePasswordMode		= (1 << 4),	//!< the terminal has turned off echo for line input, typically for a password prompt
+	kSession_StateAttributeProcessStopped	= (1 << 5)	//!< the main process of the session has been stopped (e.g. by a job-control signal)
 };
 
 /*!
@@ -360,6 +373,23 @@ struct Session_EventKeys
 	Boolean					keypadRemappedForVT220;	//!< if false, arrows are not special; if true, they become Emacs cursor keys
 };
 
+/*!
+Running totals that describe how much data a session has
+handled and what it cost; see Session_GetStatistics().  The
+counts are never reset, so rates are found by sampling twice.
+*/
+struct Session_Statistics
+{
+	UInt64			bytesRead;				//!< number of bytes that have arrived from the running process
+	UInt64			bytesParsed;			//!< number of bytes given to terminal emulators (counted once per terminal)
+	CFTimeInterval	parseTime;				//!< total time spent in terminal emulators, in seconds
+	UInt64			echoCharacterCount;		//!< number of characters echoed by the emulators of the session
+	UInt64			scrollbackLineCount;	//!< number of lines that the emulators have added to scrollback buffers
+	CFTimeInterval	renderTime;				//!< total time spent drawing terminal views of the session, in seconds
+	UInt64			renderFrameCount;		//!< number of times terminal views of the session have been drawn
+	UInt64			coalescedFrameCount;	//!< number of view invalidations that merged into an already-pending refresh
+};
+
 
 
 #pragma mark Public Methods
@@ -437,6 +467,9 @@ Session_Result
 	Session_UserInputPaste					(SessionRef							inRef,
 											 PasteboardRef						inSourceOrNull = nullptr);
 
+Session_Result
+	Session_UserInputPasteCancel			(SessionRef							inRef);
+
 //@}
 
 //!\name Write-Targeting Routines
@@ -573,6 +606,11 @@ Session_Result
 	Session_FillInSessionDescription		(SessionRef							inRef,
 											 SessionDescription_Ref*			outNewSaveFileMemoryModelPtr);
 
+Session_Result
+	Session_GetPasteProgress				(SessionRef							inRef,
+											 size_t&							outBytesWritten,
+											 size_t&							outBytesTotal);
+
 Session_Result
 	Session_GetStateIconName				(SessionRef							inRef,
 											 CFStringRef&						outUncopiedString);
@@ -581,6 +619,10 @@ Session_Result
 	Session_GetStateString					(SessionRef							inRef,
 											 CFStringRef&						outUncopiedString);
 
+Session_Result
+	Session_GetStatistics					(SessionRef							inRef,
+											 Session_Statistics&				outStatistics);
+
 Session_Result
 	Session_GetWindowUserDefinedTitle		(SessionRef							inRef,
 											 CFStringRef&						outUncopiedString);
@@ -594,6 +636,10 @@ Boolean
 Boolean
 	Session_NetworkIsSuspended				(SessionRef							inRef);
 
+void
+	Session_ProcessStateChanged				(SessionRef							inRef,
+											 Boolean							inForegroundChanged);
+
 NSWindow*
 	Session_ReturnActiveNSWindow			(SessionRef							inRef);
 
@@ -605,7 +651,8 @@ HIWindowRef
 	Session_ReturnActiveWindow				(SessionRef							inRef);
 
 CFStringRef
-	Session_ReturnCachedWorkingDirectory	(SessionRef							inRef);
+	Session_ReturnCachedWorkingDirectory	(SessionRef							inRef,
+											 CFAbsoluteTime*					outUpdateTimeOrNull = nullptr);
 
 CFArrayRef
 	Session_ReturnCommandLine				(SessionRef							inRef);
@@ -617,6 +664,9 @@ Preferences_ContextRef
 Session_EventKeys
 	Session_ReturnEventKeys					(SessionRef							inRef);
 
+pid_t
+	Session_ReturnForegroundProcessGroupID	(SessionRef							inRef);
+
 CFStringRef
 	Session_ReturnOriginalWorkingDirectory	(SessionRef							inRef);
 
@@ -636,6 +686,9 @@ Session_StateAttributes
 Preferences_ContextRef
 	Session_ReturnTranslationConfiguration	(SessionRef							inRef);
 
+size_t
+	Session_ReturnWriteQueueByteCount		(SessionRef							inRef);
+
 void
 	Session_SetEventKeys					(SessionRef							inRef,
 											 Session_EventKeys const&			inKeys);
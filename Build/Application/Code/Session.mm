@@ -38,18 +38,22 @@
 
 // standard-C includes
 #import <cctype>
+#import <cerrno>
+#import <cmath>
 #import <cstring>
 #import <sstream>
 #import <string>
 
 // standard-C++ includes
 #import <algorithm>
+#import <atomic>
 #import <map>
 #import <set>
 #import <vector>
 
 // Unix includes
 #import <strings.h>
+#import <unistd.h>
 
 // Mac includes
 #import <ApplicationServices/ApplicationServices.h>
@@ -123,6 +127,10 @@ enum My_SessionSheetType
 	kMy_SessionSheetTypeSpecialKeySequences		= 1
 };
 
+size_t const	kMy_WriteQueueCapacity = 1024 * 1024;	//!< arbitrary; maximum number of bytes that may wait to be written to a process
+size_t const	kMy_PasteChunkSize = 16384;				//!< arbitrary; bytes of a Paste to queue at once (small enough that keystrokes
+														//!  typed during the Paste, such as an interrupt, are not delayed for long)
+
 } // anonymous namespace
 
 #pragma mark Types
@@ -148,6 +156,121 @@ typedef std::vector< TerminalScreenRef >	My_CaptureFileList;
 
 typedef std::map< HIViewRef, EventHandlerRef >		My_DragDropHandlerByView;
 
+/*!
+Holds data that is waiting to be written to a session’s
+process, so that the main thread never waits for the
+pseudo-terminal (for instance, when the remote side of an
+“ssh” connection stops reading).  The data is written on a
+serial dispatch queue, the output equivalent of the data
+loop thread in "Local.cp", and only when the device is
+writable.  Consecutive small writes (such as keystrokes)
+are coalesced into a single buffer.
+
+The queue is bounded; append() accepts only as many bytes
+as will fit.
+
+The queue uses its own duplicate of the device descriptor,
+so it never depends on when the data loop thread closes the
+original.  A queue is destroyed with dispose(), which never
+waits: the object deletes itself on its own queue once the
+write source has been canceled.
+
+IMPORTANT:	Only append(), notifyWhenDrained() and dispose()
+			may be called from the main thread; all other
+			state belongs to the dispatch queue.
+*/
+class My_WriteQueue
+{
+public:
+	My_WriteQueue	(Local_TerminalID, size_t);
+	
+	static void
+	dispose		(My_WriteQueue**);
+	
+	size_t
+	append	(void const*, size_t);
+	
+	//! Returns the number of bytes that append() would accept
+	//! right now.
+	inline size_t
+	returnAvailableByteCount () const
+	{
+		size_t const	kQueuedByteCount = _queuedByteCount.load();
+		
+		
+		return ((nullptr != _writeSource) && (kQueuedByteCount < _capacity)) ? (_capacity - kQueuedByteCount) : 0;
+	}
+	
+	void
+	notifyWhenDrained	(size_t, dispatch_block_t);
+	
+	//! Returns the number of bytes waiting to be written; this
+	//! can be read from any thread.
+	inline size_t
+	returnQueuedByteCount () const
+	{
+		return _queuedByteCount.load();
+	}
+
+protected:
+	~My_WriteQueue	();
+	
+	void
+	writeAvailable	(size_t);
+
+private:
+	Local_TerminalID			_fileDescriptor;		//!< duplicate of the pseudo-terminal master device of the process
+	size_t const				_capacity;				//!< maximum value of "_queuedByteCount"
+	std::atomic< size_t >		_queuedByteCount;		//!< bytes accepted by append() that are not yet written
+	dispatch_queue_t			_ioQueue;				//!< serial queue that owns all of the state below
+	dispatch_source_t			_writeSource;			//!< fires on "_ioQueue" whenever the device can accept more data
+	std::vector< UInt8 >		_buffer;				//!< coalesced data; bytes before "_bufferOffset" were written already
+	size_t						_bufferOffset;			//!< index of first unwritten byte in "_buffer"
+	bool						_isSourceSuspended;		//!< true while there is nothing to write
+	bool						_isCanceled;			//!< true once dispose() has been called; nothing more is written
+	size_t						_drainLowWaterMark;		//!< "_drainBlock" runs once no more than this many bytes are queued
+	dispatch_block_t			_drainBlock;			//!< if not nullptr, invoked (once) on the main queue as the queue drains
+};
+
+typedef std::vector< SessionRef >	My_SessionRefList;
+
+/*!
+Tracks every session that has a timed watch (for inactivity
+or keep-alive), so that a single one-second timer serves all
+of them.  Each slot of the wheel holds the sessions whose
+deadlines fall in one particular second (or, for distant
+deadlines, that should at least be checked then).
+
+Deadlines are evaluated lazily: the data path only records
+the time of the latest activity, and when a session’s slot
+comes around, it is either triggered or placed in a later
+slot according to its actual deadline.  So, the cost of a
+watch does not depend on how much data arrives.
+*/
+class My_WatchWheel
+{
+public:
+	My_WatchWheel	();
+	
+	void
+	advance		(My_SessionRefList&);
+	
+	void
+	insert		(SessionRef, CFTimeInterval);
+	
+	void
+	remove		(SessionRef);
+
+protected:
+
+private:
+	std::vector< My_SessionRefList >	_slots;				//!< sessions to check, indexed by second (modulo the slot count)
+	size_t								_currentSlot;		//!< index into "_slots" of the most recent second checked
+	size_t								_sessionCount;		//!< total number of entries in all slots
+	EventLoopTimerUPP					_timerUPP;			//!< wrapper for watchWheelTimerFired()
+	EventLoopTimerRef					_timer;				//!< fires once per second, but only while "_sessionCount" is nonzero
+};
+
 /*!
 A “safe” wrapper around the help tag structure.
 Useful for constructing it in one shot while
@@ -266,8 +389,12 @@ struct My_Session
 	CFRetainRelease				commandLineArguments;		// CFArrayRef of CFStringRef; typically agrees with "resourceLocationString"
 	CFRetainRelease				originalDirectoryString;	// pathname of the directory that was current when the session was executed
 	CFRetainRelease				deviceNameString;			// pathname of slave pseudo-terminal device attached to the session
-	CFRetainRelease				pendingPasteLines;			// CFArrayRef of CFStringRef; lines that have not yet been pasted
-	CFIndex						pendingPasteCurrentLine;	// index into "pendingPasteLines" of current line to be pasted
+	std::vector< UInt8 >		pendingPasteBytes;			// encoded text of a Paste that has not been completely written yet
+	size_t						pendingPasteOffset;			// number of bytes of "pendingPasteBytes" that have been written so far
+	std::vector< UInt8 >		pendingPasteNewLine;		// encoded new-line sequence that separates lines of "pendingPasteBytes"
+	EventTime					pendingPasteLineDelay;		// minimum time between lines of a Paste; 0 writes as fast as possible
+	UInt32						pendingPasteID;				// changes with each Paste, so that delayed writes of an old Paste are ignored
+	CFAbsoluteTime				pendingPasteNotifyTime;		// result of CFAbsoluteTimeGetCurrent() call when Paste progress was last reported
 	CFAbsoluteTime				activationAbsoluteTime;		// result of CFAbsoluteTimeGetCurrent() call when the command starts or restarts
 	CFAbsoluteTime				terminationAbsoluteTime;	// result of CFAbsoluteTimeGetCurrent() call when the command ends
 	CFAbsoluteTime				watchTriggerAbsoluteTime;	// result of CFAbsoluteTimeGetCurrent() call when the last watch of any kind went off
@@ -284,6 +411,7 @@ struct My_Session
 	ListenerModel_Ref			changeListenerModel;		// who to notify for various kinds of changes to this session data
 	ListenerModel_ListenerWrap	windowValidationListener;	// responds after a window is created, and just before it dies
 	ListenerModel_ListenerWrap	terminalWindowListener;		// responds when terminal window states change
+	ListenerModel_ListenerWrap	terminalScreenListener;		// responds when terminal screen buffer states change
 	ListenerModel_ListenerWrap	vectorWindowListener;		// responds when vector graphics window states change
 	ListenerModel_ListenerWrap	preferencesListener;		// responds when certain preference values are initialized or changed
 	EventLoopTimerUPP			autoActivateDragTimerUPP;	// procedure that is called when a drag hovers over an inactive window
@@ -314,10 +442,10 @@ struct My_Session
 	UInt8*						readBufferPtr;				// buffer space for processing data
 	CFStringEncoding			writeEncoding;				// the character set that text (data) sent to a session should be using
 	Session_Watch				activeWatch;				// if any, what notification is currently set up for internal data events
-	EventLoopTimerUPP			inactivityWatchTimerUPP;	// procedure that is called if data has not arrived after awhile
-	EventLoopTimerRef			inactivityWatchTimer;		// short timer
-	EventLoopTimerUPP			pendingPasteTimerUPP;		// procedure that is called periodically when pasting lines
-	EventLoopTimerRef			pendingPasteTimer;			// paste timer, reset only when a Paste or an equivalent (like a drag) occurs
+	CFAbsoluteTime				watchActivityAbsoluteTime;	// result of CFAbsoluteTimeGetCurrent() call when data last arrived (timed watches only)
+	CFTimeInterval				watchTimeoutInterval;		// for timed watches, how long data must be absent before the watch triggers
+	Boolean						watchIsArmed;				// true if the session is waiting in the watch wheel for a timed watch to trigger
+	My_WriteQueue*				writeQueue;					// data waiting to be written to "mainProcess"; see Session_SendData()
 	Preferences_ContextWrap		recentSheetContext;			// defined temporarily while a Preferences-dependent sheet (such as key sequences) is up
 	My_SessionSheetType			sheetType;					// if "kMy_SessionSheetTypeNone", no significant sheet is currently open
 	WindowTitleDialog_Ref		renameDialog;				// if defined, the user interface for renaming the terminal window
@@ -336,6 +464,13 @@ struct My_Session
 		Boolean		cursorFlashes;				//!< preferences callback should update this value
 		Boolean		remapBackquoteToEscape;		//!< preferences callback should update this value
 	} preferencesCache;
+	
+	struct
+	{
+		UInt64			bytesRead;		//!< see Session_GetStatistics()
+		UInt64			bytesParsed;	//!< see Session_GetStatistics()
+		CFTimeInterval	parseTime;		//!< see Session_GetStatistics()
+	} statistics;
 };
 typedef My_Session*		My_SessionPtr;
 typedef My_SessionPtr*	My_SessionHandle;
@@ -351,6 +486,7 @@ namespace {
 
 void						autoActivateWindow					(EventLoopTimerRef, void*);
 Boolean						autoCaptureSessionToFile			(My_SessionPtr);
+Boolean						bracketedPasteIsEnabled				(My_SessionPtr);
 Boolean						captureToFile						(My_SessionPtr, CFURLRef, CFStringRef);
 void						changeNotifyForSession				(My_SessionPtr, Session_Change, void*);
 void						changeStateAttributes				(My_SessionPtr, Session_StateAttributes,
@@ -372,7 +508,9 @@ Boolean						handleSessionKeyDown				(ListenerModel_Ref, ListenerModel_Event,
 Boolean						isReadOnly							(My_SessionPtr);
 void						localEchoKey						(My_SessionPtr, UInt8);
 void						localEchoString						(My_SessionPtr, CFStringRef);
-void						pasteLineFromTimer					(EventLoopTimerRef, void*);
+void						pasteStreamBegin					(My_SessionPtr, CFArrayRef);
+void						pasteStreamEnd						(My_SessionPtr);
+void						pasteStreamWrite					(My_SessionPtr);
 void						preferenceChanged					(ListenerModel_Ref, ListenerModel_Event,
 																 void*, void*);
 size_t						processMoreData						(My_SessionPtr);
@@ -393,6 +531,8 @@ Preferences_ContextRef		sheetContextBegin					(My_SessionPtr, Quills::Prefs::Cla
 void						sheetContextEnd						(My_SessionPtr);
 void						terminalHoverLocalEchoString		(My_SessionPtr, UInt8 const*, size_t);
 void						terminalInsertLocalEchoString		(My_SessionPtr, UInt8 const*, size_t);
+void						terminalScreenChanged				(ListenerModel_Ref, ListenerModel_Event,
+																 void*, void*);
 void						terminalWindowChanged				(ListenerModel_Ref, ListenerModel_Event,
 																 void*, void*);
 void						terminationWarningClose				(SessionRef&, Boolean, Boolean);
@@ -402,8 +542,8 @@ void						vectorGraphicsWindowChanged			(ListenerModel_Ref, ListenerModel_Event,
 																 void*, void*);
 void						watchClearForSession				(My_SessionPtr);
 void						watchNotifyForSession				(My_SessionPtr, Session_Watch);
-void						watchNotifyFromTimer				(EventLoopTimerRef, void*);
-void						watchTimerResetForSession			(My_SessionPtr, Session_Watch);
+void						watchStartForSession				(My_SessionPtr);
+void						watchWheelTimerFired				(EventLoopTimerRef, void*);
 void						windowValidationStateChanged		(ListenerModel_Ref, ListenerModel_Event,
 																 void*, void*);
 
@@ -416,6 +556,7 @@ My_SessionPtrLocker&	gSessionPtrLocks ()	{ static My_SessionPtrLocker x; return
 IconRef					gSessionActiveIcon () { static IconRef x = createSessionStateActiveIcon(); return x; }
 IconRef					gSessionDeadIcon () { static IconRef x = createSessionStateDeadIcon(); return x; }
 My_SessionRefTracker&	gInvalidSessions () { static My_SessionRefTracker x; return x; }
+My_WatchWheel&			gWatchWheel () { static My_WatchWheel x; return x; }
 
 } // anonymous namespace
 
@@ -463,6 +604,10 @@ to be printable.  In other words, it assumes
 the terminal is “dumb” and will not know what
 to do with such characters.
 
+The data is made printable once, when the writer
+is constructed, so the same writer should be used
+for every dumb terminal that receives the data.
+
 Model of STL Unary Function.
 
 (1.0)
@@ -474,48 +619,45 @@ public std::unary_function< TerminalScreenRef/* argument */, void/* return */ >
 public:
 	terminalDumbDataWriter	(UInt8 const*	inBuffer,
 							 size_t			inBufferSize)
-	: _buffer(inBuffer), _bufferSize(inBufferSize)
-	{
-	}
-	
-	void
-	operator()	(TerminalScreenRef	inScreen)
+	: _printableData()
 	{
 		// dumb terminal - raw mode for debugging, pass through escape sequences
 		// and other special characters as <27> symbols
-		size_t			i = 0;
-		UInt8 const*	currentCharPtr = _buffer;
+		std::ostringstream	tempBuffer;
+		size_t				i = 0;
+		UInt8 const*		currentCharPtr = inBuffer;
 		
 		
-		for (i = 0; i < _bufferSize; ++i, ++currentCharPtr)
+		for (i = 0; i < inBufferSize; ++i, ++currentCharPtr)
 		{
 			if ((*currentCharPtr < ' '/* codes below a plain space are control characters */) ||
 				(*currentCharPtr >= 127))
 			{
-				std::ostringstream		tempBuffer;
-				
-				
 				tempBuffer
 				<< "<"
 				<< STATIC_CAST(*currentCharPtr, unsigned int)
 				<< ">"
 				;
-				_tempBufferString = tempBuffer.str();
-				Terminal_EmulatorProcessCString(inScreen, _tempBufferString.c_str());
 			}
 			else
 			{
-				Terminal_EmulatorProcessData(inScreen, currentCharPtr, 1);
+				tempBuffer << STATIC_CAST(*currentCharPtr, char);
 			}
 		}
+		_printableData = tempBuffer.str();
+	}
+	
+	void
+	operator()	(TerminalScreenRef	inScreen)
+	{
+		Terminal_EmulatorProcessData(inScreen, REINTERPRET_CAST(_printableData.data(), UInt8 const*),
+										STATIC_CAST(_printableData.size(), UInt32));
 	}
 
 protected:
 
 private:
-	UInt8 const*	_buffer;
-	size_t			_bufferSize;
-	std::string		_tempBufferString;
+	std::string		_printableData;
 };
 
 /*!
@@ -677,6 +819,11 @@ Session_AddDataTarget	(SessionRef				inRef,
 			
 			ptr->targetTerminals.push_back(REINTERPRET_CAST(inTargetData, TerminalScreenRef));
 			assert(ptr->targetTerminals.size() == (1 + listSize));
+			
+			// directories reported by the shell are cheaper and more
+			// accurate than process queries (see Session_ReturnCachedWorkingDirectory())
+			Terminal_StartMonitoring(ptr->targetTerminals.back(), kTerminal_ChangeWorkingDirectory,
+										ptr->terminalScreenListener.returnRef());
 		}
 		break;
 	
@@ -739,6 +886,7 @@ Session_AppendDataForProcessing		(SessionRef		inRef,
 		result = inSize - numberOfBytesToCopy;
 		CPP_STD::memcpy(ptr->readBufferPtr + ptr->readBufferSizeInUse, inDataPtr, numberOfBytesToCopy);
 		ptr->readBufferSizeInUse += numberOfBytesToCopy;
+		ptr->statistics.bytesRead += numberOfBytesToCopy;
 		
 		processMoreData(ptr);
 		
@@ -751,8 +899,16 @@ Session_AppendDataForProcessing		(SessionRef		inRef,
 		else if ((kSession_WatchForKeepAlive == ptr->activeWatch) ||
 					(kSession_WatchForInactivity == ptr->activeWatch))
 		{
-			// reset timer, start waiting again
-			watchTimerResetForSession(ptr, ptr->activeWatch);
+			// start waiting again; if the watch is already waiting, this
+			// just moves its deadline (see watchWheelTimerFired())
+			if (ptr->watchIsArmed)
+			{
+				ptr->watchActivityAbsoluteTime = CFAbsoluteTimeGetCurrent();
+			}
+			else
+			{
+				watchStartForSession(ptr);
+			}
 		}
 	}
 	return result;
@@ -1646,6 +1802,57 @@ Session_FlushNetwork	(SessionRef		inRef)
 }// FlushNetwork
 
 
+/*!
+Returns the number of bytes of the most recent Paste that
+have been written to the session so far, and the total
+number of bytes that will be written when it is done.  The
+counts include any bracketed-paste markers.
+
+Listeners for "kSession_ChangePasteProgress" are notified
+(periodically) while a large Paste is written, and when it
+completes or is cancelled.
+
+\retval kSession_ResultOK
+if a Paste is in progress and the counts were returned
+
+\retval kSession_ResultInvalidReference
+if "inRef" is invalid
+
+\retval kSession_ResultNotReady
+if no Paste is currently in progress (counts are set to 0)
+
+(2017.10)
+*/
+Session_Result
+Session_GetPasteProgress	(SessionRef		inRef,
+							 size_t&		outBytesWritten,
+							 size_t&		outBytesTotal)
+{
+	Session_Result		result = kSession_ResultOK;
+	
+	
+	outBytesWritten = 0;
+	outBytesTotal = 0;
+	if (nullptr == inRef) result = kSession_ResultInvalidReference;
+	else
+	{
+		My_SessionAutoLocker	ptr(gSessionPtrLocks(), inRef);
+		
+		
+		if (ptr->pendingPasteBytes.empty())
+		{
+			result = kSession_ResultNotReady;
+		}
+		else
+		{
+			outBytesWritten = ptr->pendingPasteOffset;
+			outBytesTotal = ptr->pendingPasteBytes.size();
+		}
+	}
+	return result;
+}// GetPasteProgress
+
+
 /*!
 Returns the name of an image file in the bundle (suitable
 for use with APIs such as NSImage’s "iconNamed:"), to
@@ -1699,6 +1906,84 @@ Session_GetStateString		(SessionRef		inRef,
 }// GetStateString
 
 
+/*!
+Returns running totals that describe the data handled by
+the specified session: bytes read from its process, bytes
+parsed (and the time spent parsing), and the activity of
+its terminal screens and views.  Screen and view totals are
+summed over everything currently attached to the session.
+
+The totals are maintained unconditionally; they are cheap
+enough (a clock read per batch of data or per frame) that
+there is no need to turn them on and off.
+
+\retval kSession_ResultOK
+if the statistics are returned successfully
+
+\retval kSession_ResultInvalidReference
+if "inRef" is invalid
+
+(2017.10)
+*/
+Session_Result
+Session_GetStatistics	(SessionRef				inRef,
+						 Session_Statistics&	outStatistics)
+{
+	Session_Result		result = kSession_ResultOK;
+	
+	
+	bzero(&outStatistics, sizeof(outStatistics));
+	if (nullptr == inRef) result = kSession_ResultInvalidReference;
+	else
+	{
+		My_SessionAutoLocker	ptr(gSessionPtrLocks(), inRef);
+		
+		
+		outStatistics.bytesRead = ptr->statistics.bytesRead;
+		outStatistics.bytesParsed = ptr->statistics.bytesParsed;
+		outStatistics.parseTime = ptr->statistics.parseTime;
+		
+		for (auto screenRef : ptr->targetTerminals)
+		{
+			Terminal_Statistics		screenStatistics;
+			
+			
+			if (kTerminal_ResultOK == Terminal_GetStatistics(screenRef, screenStatistics))
+			{
+				outStatistics.echoCharacterCount += screenStatistics.echoCharacterCount;
+				outStatistics.scrollbackLineCount += screenStatistics.scrollbackLineCount;
+			}
+		}
+		
+		if (nullptr != ptr->terminalWindow)
+		{
+			UInt16							viewCount = TerminalWindow_ReturnViewCount(ptr->terminalWindow);
+			std::vector< TerminalViewRef >	viewArray(viewCount);
+			
+			
+			if (viewCount > 0)
+			{
+				TerminalWindow_GetViews(ptr->terminalWindow, viewCount, &viewArray[0], &viewCount/* actual length */);
+				viewArray.resize(viewCount);
+			}
+			for (auto viewRef : viewArray)
+			{
+				TerminalView_Statistics		viewStatistics;
+				
+				
+				if (kTerminalView_ResultOK == TerminalView_GetStatistics(viewRef, viewStatistics))
+				{
+					outStatistics.renderTime += viewStatistics.renderTime;
+					outStatistics.renderFrameCount += viewStatistics.renderFrameCount;
+					outStatistics.coalescedFrameCount += viewStatistics.coalescedFrameCount;
+				}
+			}
+		}
+	}
+	return result;
+}// GetStatistics
+
+
 /*!
 Returns the most recent user-specified window title;
 defaults to the one given in the New Sessions dialog,
@@ -1744,6 +2029,10 @@ main process of the session has currently disabled echoing
 (typically done by programs that are displaying a password
 prompt).
 
+This is a cached state attribute, so it is cheap to call; the
+"kSession_ChangeStateAttributes" event is sent whenever it
+changes (see Session_ProcessStateChanged()).
+
 (4.1)
 */
 Boolean
@@ -1753,9 +2042,9 @@ Session_IsInPasswordMode		(SessionRef		inRef)
 	Boolean					result = false;
 	
 	
-	if ((nullptr != ptr) && (nullptr != ptr->mainProcess))
+	if (nullptr != ptr)
 	{
-		result = Local_ProcessIsInPasswordMode(ptr->mainProcess);
+		result = (0 != (ptr->statusAttributes & kSession_StateAttributePasswordMode));
 	}
 	return result;
 }// IsInPasswordMode
@@ -1853,17 +2142,62 @@ Boolean
 Session_NetworkIsSuspended		(SessionRef		inRef)
 {
 	My_SessionAutoLocker	ptr(gSessionPtrLocks(), inRef);
-	Boolean					result = (0 != (ptr->statusAttributes & kSession_StateAttributeSuspendNetwork));
+	Boolean					result = (0 != (ptr->statusAttributes & (kSession_StateAttributeSuspendNetwork |
+																		kSession_StateAttributeProcessStopped)));
 	
 	
-	if ((false == result) && (nullptr != ptr->mainProcess))
-	{
-		result = Local_ProcessIsStopped(ptr->mainProcess);
-	}
 	return result;
 }// NetworkIsSuspended
 
 
+/*!
+Called by the Local module whenever the child process monitor
+sees that the main process of the session has stopped or
+continued, or that the terminal has changed its echo mode or
+foreground process group.  This updates the corresponding
+state attributes and notifies listeners of the session.
+
+(2017.10)
+*/
+void
+Session_ProcessStateChanged		(SessionRef		inRef,
+								 Boolean		inForegroundChanged)
+{
+	My_SessionAutoLocker	ptr(gSessionPtrLocks(), inRef);
+	
+	
+	if ((nullptr != ptr) && (nullptr != ptr->mainProcess))
+	{
+		Session_StateAttributes		attributesToSet = 0;
+		Session_StateAttributes		attributesToClear = 0;
+		Session_StateAttributes const	kAffectedAttributes = (kSession_StateAttributePasswordMode |
+																kSession_StateAttributeProcessStopped);
+		
+		
+		if (Local_ProcessIsInPasswordMode(ptr->mainProcess))
+		{
+			attributesToSet |= kSession_StateAttributePasswordMode;
+		}
+		if (Local_ProcessIsStopped(ptr->mainProcess))
+		{
+			attributesToSet |= kSession_StateAttributeProcessStopped;
+		}
+		attributesToClear = (kAffectedAttributes & ~attributesToSet);
+		
+		// only notify listeners when something is actually different
+		if ((ptr->statusAttributes & kAffectedAttributes) != attributesToSet)
+		{
+			changeStateAttributes(ptr, attributesToSet, attributesToClear);
+		}
+		
+		if (inForegroundChanged)
+		{
+			changeNotifyForSession(ptr, kSession_ChangeForegroundProcess, ptr->selfRef/* context */);
+		}
+	}
+}// ProcessStateChanged
+
+
 /*!
 Creates a "kMyCarbonEventKindSessionDataArrived" event
 from class "kMyCarbonEventClassSession" and sends it
@@ -1978,14 +2312,27 @@ Session_ReceiveData		(SessionRef		inRef,
 		
 		
 		// dumb terminals are considered compatible with any kind of data and always receive data
-		std::for_each(ptr->targetDumbTerminals.begin(), ptr->targetDumbTerminals.end(),
-						terminalDumbDataWriter(kBuffer, inByteCount));
+		unless (ptr->targetDumbTerminals.empty())
+		{
+			terminalDumbDataWriter	dumbWriter(kBuffer, inByteCount);
+			
+			
+			for (auto screenRef : ptr->targetDumbTerminals)
+			{
+				dumbWriter(screenRef);
+			}
+		}
 		
 		// if any TEK canvases are installed, they take precedence
 		if (ptr->targetVectorGraphics.empty())
 		{
+			CFAbsoluteTime const	kStartTime = CFAbsoluteTimeGetCurrent();
+			
+			
 			// this is the typical case; send data to a sophisticated terminal emulator
 			std::for_each(ptr->targetTerminals.begin(), ptr->targetTerminals.end(), terminalDataWriter(kBuffer, inByteCount));
+			ptr->statistics.bytesParsed += (inByteCount * ptr->targetTerminals.size());
+			ptr->statistics.parseTime += (CFAbsoluteTimeGetCurrent() - kStartTime);
 		}
 		else
 		{
@@ -2032,6 +2379,8 @@ Session_RemoveDataTarget	(SessionRef				inRef,
 	switch (inTarget)
 	{
 	case kSession_DataTargetStandardTerminal:
+		Terminal_StopMonitoring(REINTERPRET_CAST(inTargetData, TerminalScreenRef), kTerminal_ChangeWorkingDirectory,
+								ptr->terminalScreenListener.returnRef());
 		ptr->targetTerminals.erase(std::remove(ptr->targetTerminals.begin(), ptr->targetTerminals.end(),
 												REINTERPRET_CAST(inTargetData, TerminalScreenRef)),
 									ptr->targetTerminals.end());
@@ -2139,33 +2488,54 @@ Session_ReturnActiveWindow	(SessionRef		inRef)
 
 
 /*!
-Returns the POSIX path of the directory that was current as of
-the most recent call to Local_UpdateCurrentDirectoryCache().
-If this is empty, it means that the information may not be
-available (due to permission issues, for example, or because
-Local_UpdateCurrentDirectoryCache() was never called).
+Returns the POSIX path of the most recently known working
+directory of the session.  Shells that report their directory
+to the terminal (with “ESC]7;file://host/path”, as many do
+before each prompt) keep this up-to-date automatically.  For
+other programs, the value is as of the most recent query by
+Local_UpdateCurrentDirectoryCache(), which happens whenever
+the foreground process changes.  If this is empty, it means
+that the information may not be available (due to permission
+issues, for example, or because there has been no report and
+no query).
 
-IMPORTANT:	Local_UpdateCurrentDirectoryCache() does expensive
-			scans that (in exchange for being slow) update the
-			results for ALL open Sessions.  So be sure to gather
-			this information for as many relevant Sessions as
-			possible, and avoid unnecessary cache updates.
+If "outUpdateTimeOrNull" is given, it is set to the time at
+which the value was found (or 0 if it has never been found).
+
+IMPORTANT:	This also calls Local_UpdateCurrentDirectoryCache()
+			so that an old value is eventually refreshed.  That
+			only examines processes whose values are out of
+			date, and it finishes asynchronously; so this is
+			cheap to call, but a refreshed value is only
+			returned by a later call.
 
 See also Session_ReturnOriginalWorkingDirectory().
 
 (4.0)
 */
 CFStringRef
-Session_ReturnCachedWorkingDirectory	(SessionRef		inRef)
+Session_ReturnCachedWorkingDirectory	(SessionRef			inRef,
+										 CFAbsoluteTime*	outUpdateTimeOrNull)
 {
 	My_SessionAutoLocker	ptr(gSessionPtrLocks(), inRef);
 	CFStringRef				result = CFSTR("");
 	
 	
+	if (nullptr != outUpdateTimeOrNull)
+	{
+		*outUpdateTimeOrNull = 0;
+	}
+	
+	Local_UpdateCurrentDirectoryCache();
+	
 	if (nullptr != ptr->mainProcess)
 	{
 		// this might return an empty string on failure
 		result = Local_ProcessReturnCurrentDirectory(ptr->mainProcess);
+		if (nullptr != outUpdateTimeOrNull)
+		{
+			*outUpdateTimeOrNull = Local_ProcessReturnCurrentDirectoryTime(ptr->mainProcess);
+		}
 	}
 	
 	return result;
@@ -2309,6 +2679,29 @@ Session_ReturnEventKeys		(SessionRef		inRef)
 }// ReturnEventKeys
 
 
+/*!
+Returns the ID of the process group that most recently owned
+the terminal of the session (normally, the foreground job of
+a shell), or -1 if the session has no local process.  Monitor
+"kSession_ChangeForegroundProcess" to find out when it changes.
+
+(2017.10)
+*/
+pid_t
+Session_ReturnForegroundProcessGroupID	(SessionRef		inRef)
+{
+	My_SessionAutoLocker	ptr(gSessionPtrLocks(), inRef);
+	pid_t					result = -1;
+	
+	
+	if (nullptr != ptr->mainProcess)
+	{
+		result = Local_ProcessReturnForegroundGroupID(ptr->mainProcess);
+	}
+	return result;
+}// ReturnForegroundProcessGroupID
+
+
 /*!
 Returns the POSIX path of the directory that was current
 when the session was started.  If this is empty, it means
@@ -2456,6 +2849,30 @@ Session_ReturnTranslationConfiguration		(SessionRef		inRef)
 }// ReturnTranslationConfiguration
 
 
+/*!
+Returns the number of bytes that have been sent to the
+session (with Session_SendData() or a routine that calls
+it) but that the process has not yet been able to read.
+A large value means the process is not keeping up, or has
+stopped reading its input entirely.
+
+(2017.10)
+*/
+size_t
+Session_ReturnWriteQueueByteCount		(SessionRef		inRef)
+{
+	My_SessionAutoLocker	ptr(gSessionPtrLocks(), inRef);
+	size_t					result = 0;
+	
+	
+	if (nullptr != ptr->writeQueue)
+	{
+		result = ptr->writeQueue->returnQueuedByteCount();
+	}
+	return result;
+}// ReturnWriteQueueByteCount
+
+
 /*!
 Activates the specified session, from the user’s
 perspective.  For example, brings all of its
@@ -2491,11 +2908,13 @@ Session_Select	(SessionRef		inRef)
 /*!
 Adds the specified data to a buffer, which will be sent to the
 local or remote process for the given session when the receiver
-is ready.
+is ready.  This never waits for the process to read the data.
 
-Returns the number of bytes actually written; if this number is
-less than "inByteCount", offset the buffer by the difference
-and try again to send the rest.
+Returns the number of bytes actually accepted; if this number
+is less than "inByteCount", the buffer is full (or more than
+32767 bytes were given), so offset the buffer by the difference
+and try again later to send the rest.  See also the routine
+Session_ReturnWriteQueueByteCount().
 
 See also Session_SendDataCFString().
 
@@ -2518,11 +2937,12 @@ Session_SendData	(SessionRef		inRef,
 	SInt16					result = 0;
 	
 	
-	if (nullptr != ptr->mainProcess)
+	if (nullptr != ptr->writeQueue)
 	{
-		result = STATIC_CAST(Local_TerminalWriteBytes(Local_ProcessReturnMasterTerminal(ptr->mainProcess),
-														inBufferPtr, inByteCount),
-								SInt16);
+		size_t const	kByteCount = std::min(inByteCount, STATIC_CAST(INT16_MAX, size_t));
+		
+		
+		result = STATIC_CAST(ptr->writeQueue->append(inBufferPtr, kByteCount), SInt16);
 	}
 	return result;
 }// SendData
@@ -2554,7 +2974,10 @@ Returns the number of CHARACTERS actually written, or a
 negative number on error.  If this result is any less than
 "CFStringGetLength(inString)", then the string was written
 incompletely and you should attempt to write the remaining
-characters in a new call.
+characters in a new call.  Characters are only counted once
+all of their bytes have been accepted by the session’s write
+queue; if the queue is full (the process is not reading its
+input), nothing more is sent and the result is short.
 
 (4.0)
 */
@@ -2569,6 +2992,7 @@ Session_SendDataCFString	(SessionRef		inRef,
 	UInt8					byteArray[1024]; // arbitrary size
 	UInt8*					currentPtr = byteArray;
 	size_t					sizeRemaining = sizeof(byteArray);
+	CFIndex					pendingCharacterCount = 0; // characters in "byteArray" that have not been sent yet
 	CFIndex					result = 0;
 	
 	
@@ -2614,7 +3038,7 @@ Session_SendDataCFString	(SessionRef		inRef,
 			assert(sizeRemaining >= STATIC_CAST(bytesForChar, size_t));
 			sizeRemaining -= bytesForChar;
 			currentPtr += bytesForChar;
-			result += targetRange.length;
+			pendingCharacterCount += targetRange.length;
 			targetRange.location += targetRange.length;
 		}
 		
@@ -2622,22 +3046,25 @@ Session_SendDataCFString	(SessionRef		inRef,
 			(sizeRemaining < 4/* arbitrary */) ||
 			(targetRange.location >= kLength))
 		{
-			// send what has been accumulated, and then reset the pointer
-			size_t		bytesLeft = sizeof(byteArray) - sizeRemaining;
-			size_t		bytesWritten = 0;
+			// send what has been accumulated, and then reset the pointer;
+			// since only the main thread adds to the write queue, if the
+			// whole buffer fits now, it is accepted in its entirety (if
+			// not, none of it is sent, so that the caller can retry
+			// starting from the first character that was not counted)
+			size_t const	kByteCount = sizeof(byteArray) - sizeRemaining;
 			
 			
-			currentPtr = byteArray;
-			while (bytesLeft > 0)
+			if ((kByteCount > 0) &&
+				((nullptr == ptr->writeQueue) || (ptr->writeQueue->returnAvailableByteCount() < kByteCount)))
 			{
-				bytesWritten = Session_SendData(inRef, currentPtr, bytesLeft);
-				if (bytesWritten > 0)
-				{
-					assert(bytesLeft >= bytesWritten);
-					bytesLeft -= bytesWritten;
-					currentPtr += bytesWritten;
-				}
+				break;
+			}
+			if (kByteCount > 0)
+			{
+				UNUSED_RETURN(SInt16)Session_SendData(inRef, byteArray, kByteCount);
 			}
+			result += pendingCharacterCount;
+			pendingCharacterCount = 0;
 			currentPtr = byteArray;
 			sizeRemaining = sizeof(byteArray);
 		}
@@ -2679,19 +3106,21 @@ Session_SendDeleteBackward	(SessionRef		inRef)
 Sends any data waiting to be sent (i.e. in the buffer) to the
 local or remote process for the given session immediately,
 clearing out the buffer if possible.  Returns the number of
-bytes left in the buffer.
+bytes left in the buffer (at most 32767).
+
+Since data is always written as soon as the process is able
+to accept it, this does not wait; it only reports what is
+still queued.  See also Session_ReturnWriteQueueByteCount().
 
 (3.0)
 */
 SInt16
 Session_SendFlush	(SessionRef		inRef)
 {
-	My_SessionAutoLocker	ptr(gSessionPtrLocks(), inRef);
-	SInt16					result = 0;
+	SInt16		result = STATIC_CAST(std::min(Session_ReturnWriteQueueByteCount(inRef), STATIC_CAST(INT16_MAX, size_t)),
+										SInt16);
 	
 	
-	// not currently defined
-	
 	return result;
 }// SendFlush
 
@@ -2947,6 +3376,10 @@ Session_SetProcess	(SessionRef			inRef,
 	assert(nullptr != inRunningProcess);
 	ptr->mainProcess = inRunningProcess;
 	
+	// all data sent to the process is buffered and written asynchronously
+	My_WriteQueue::dispose(&ptr->writeQueue);
+	ptr->writeQueue = new My_WriteQueue(Local_ProcessReturnMasterTerminal(ptr->mainProcess), kMy_WriteQueueCapacity);
+	
 	// store important information about the process that spawned
 	{
 		// set device name string
@@ -3148,10 +3581,18 @@ Session_SetState	(SessionRef			inRef,
 			{
 				if (kSession_StateDead == ptr->status)
 				{
+					// any Paste in progress (and any other data that has not
+					// been written yet) cannot be sent once the pseudo-terminal
+					// is gone
+					pasteStreamEnd(ptr);
+					
 					// killing the process may trigger a state change, but this
 					// is OK as long as the state it chooses is the same as
-					// the state that triggers this call
+					// the state that triggers this call; the process goes
+					// first so that any write in progress is interrupted
+					// (the write queue is then disposed without waiting)
 					Local_KillProcess(&ptr->mainProcess);
+					My_WriteQueue::dispose(&ptr->writeQueue);
 				}
 			}
 			
@@ -3234,29 +3675,19 @@ Session_SetWatch	(SessionRef		inRef,
 	
 	ptr->activeWatch = inNewWatch;
 	
-	// for watches requiring timers, create a timer if none exists;
-	// but wait until data arrives to actually set the clock
+	// any previous timed watch no longer applies
+	if (ptr->watchIsArmed)
+	{
+		ptr->watchIsArmed = false;
+		gWatchWheel().remove(inRef);
+	}
+	
+	// for inactivity timers, start the clock right now (also,
+	// the deadline automatically moves as new data arrives)
 	if ((kSession_WatchForInactivity == inNewWatch) ||
 		(kSession_WatchForKeepAlive == inNewWatch))
 	{
-		if (nullptr == ptr->inactivityWatchTimer)
-		{
-			// first time; create the timer
-			OSStatus	error = noErr;
-			
-			
-			ptr->inactivityWatchTimerUPP = NewEventLoopTimerUPP(watchNotifyFromTimer);
-			error = InstallEventLoopTimer(GetCurrentEventLoop(),
-											kEventDurationForever/* start time - do not start yet */,
-											kEventDurationForever/* time between fires - this timer does not repeat */,
-											ptr->inactivityWatchTimerUPP, ptr->selfRef/* user data */,
-											&ptr->inactivityWatchTimer);
-			assert_noerr(error);
-		}
-		
-		// for inactivity timers, start the clock right now (also,
-		// the timer automatically resets as new data arrives)
-		watchTimerResetForSession(ptr, inNewWatch);
+		watchStartForSession(ptr);
 	}
 }// SetWatch
 
@@ -3378,6 +3809,8 @@ Session_StartMonitoring		(SessionRef					inRef,
 	if (inForWhatChange == kSession_AllChanges)
 	{
 		// recursively invoke for ALL session change types listed in "Session.h"
+		Session_StartMonitoring(inRef, kSession_ChangeForegroundProcess, inListener);
+		Session_StartMonitoring(inRef, kSession_ChangePasteProgress, inListener);
 		Session_StartMonitoring(inRef, kSession_ChangeResourceLocation, inListener);
 		Session_StartMonitoring(inRef, kSession_ChangeSelected, inListener);
 		Session_StartMonitoring(inRef, kSession_ChangeState, inListener);
@@ -3576,6 +4009,8 @@ Session_StopMonitoring	(SessionRef					inRef,
 	if (inForWhatChange == kSession_AllChanges)
 	{
 		// recursively invoke for ALL session change types listed in "Session.h"
+		Session_StopMonitoring(inRef, kSession_ChangeForegroundProcess, inListener);
+		Session_StopMonitoring(inRef, kSession_ChangePasteProgress, inListener);
 		Session_StopMonitoring(inRef, kSession_ChangeResourceLocation, inListener);
 		Session_StopMonitoring(inRef, kSession_ChangeSelected, inListener);
 		Session_StopMonitoring(inRef, kSession_ChangeState, inListener);
@@ -3855,9 +4290,10 @@ to the session.  If local echoing is enabled for the session,
 the string will be written to the local data target (usually a
 terminal) before it is sent to the underlying process.
 
-This function will block until every character in the string
-has been sent to the session.  To have more direct control over
-the data transmission rate, see Session_SendData().
+This function returns once every character in the string has
+been queued for the session (or the session’s write queue is
+full, in which case the rest is discarded with a warning).  To have more direct
+control over the data transmission rate, see Session_SendData().
 
 (3.0)
 */
@@ -3888,6 +4324,11 @@ Session_UserInputCFString	(SessionRef		inRef,
 		CFIndex		charactersSent = Session_SendDataCFString(inRef, inStringBuffer, offset);
 		
 		
+		if (charactersSent <= 0)
+		{
+			Console_Warning(Console_WriteValue, "session write queue is full; characters not sent", kLength - offset);
+			break;
+		}
 		offset += charactersSent;
 		if (++loopGuard > 4/* arbitrary */)
 		{
@@ -3910,6 +4351,10 @@ telnet "IP" sequence.
 void
 Session_UserInputInterruptProcess	(SessionRef		inRef)
 {
+	// an interrupt is the natural way to abandon a large Paste
+	// that the user did not mean to send, so stop that first
+	UNUSED_RETURN(Session_Result)Session_UserInputPasteCancel(inRef);
+	
 	// clear the Suspend state from MacTerm’s point of view,
 	// since the process already considers the pipe reopened
 	Session_SetNetworkSuspended(inRef, false);
@@ -5211,7 +5656,15 @@ With some terminal applications (like shells), pasting in more
 than one line can cause unexpected results.  So, if the given
 text is multi-line, the user is warned and given options on how
 to perform the Paste.  This also means that this function could
-return before the Paste actually occurs.
+return before the Paste actually occurs.  (No warning is given
+if the application has requested bracketed-paste mode, as the
+text is then surrounded by markers that it will recognize.)
+
+The text is converted once into the session’s encoding and then
+streamed to the session in chunks, as quickly as the pseudo-
+terminal is able to accept them; so even very large pastes do
+not block the user interface.  See Session_GetPasteProgress()
+and Session_UserInputPasteCancel().
 
 \retval kSession_ResultOK
 always; no other return codes currently defined
@@ -5257,15 +5710,20 @@ Session_UserInputPaste	(SessionRef			inRef,
 									^{
 										// first join the text into one line (replace new-line sequences
 										// with single spaces), then Paste
-										CFRetainRelease		pastedLines(pendingLines.returnCFArrayRef(),
-																		CFRetainRelease::kNotYetRetained);
-										CFRetainRelease		joinedCFString(CFStringCreateByCombiningStrings(kCFAllocatorDefault,
-																											pastedLines.returnCFArrayRef(),
-																											CFSTR("")/* separator */),
+										My_SessionAutoLocker	sessionPtr(gSessionPtrLocks(), inRef);
+										CFRetainRelease			pastedLines(pendingLines.returnCFArrayRef(),
+																			CFRetainRelease::kNotYetRetained);
+										CFRetainRelease			joinedCFString(CFStringCreateByCombiningStrings(kCFAllocatorDefault,
+																												pastedLines.returnCFArrayRef(),
+																												CFSTR("")/* separator */),
+																				CFRetainRelease::kAlreadyRetained);
+										CFTypeRef				joinedValue = joinedCFString.returnCFTypeRef();
+										CFRetainRelease			joinedLines(CFArrayCreate(kCFAllocatorDefault, &joinedValue, 1/* count */,
+																							&kCFTypeArrayCallBacks),
 																			CFRetainRelease::kAlreadyRetained);
 										
 										
-										Session_UserInputCFString(inRef, joinedCFString.returnCFStringRef());
+										pasteStreamBegin(sessionPtr, joinedLines.returnCFArrayRef());
 									};
 			auto					normalPasteResponder =
 									^{
@@ -5274,46 +5732,9 @@ Session_UserInputPaste	(SessionRef			inRef,
 																			CFRetainRelease::kNotYetRetained);
 										
 										
-										// regular Paste; periodically (but fairly rapidly) insert
-										// each line into the session, using a timer for delays
-										if (nullptr == sessionPtr->pendingPasteTimer)
-										{
-											// first time; create the timer
-											OSStatus			error = noErr;
-											Preferences_Result	prefsResult = kPreferences_ResultOK;
-											EventTime			delayValue = 0;
-											
-											
-											// determine how long the delay between lines should be
-											prefsResult = Preferences_GetData(kPreferences_TagPasteNewLineDelay, sizeof(delayValue),
-																				&delayValue);
-											if (kPreferences_ResultOK != prefsResult)
-											{
-												// set an arbitrary default value
-												delayValue = 50 * kEventDurationMillisecond;
-											}
-											
-											// due to timer limitations the delay cannot be exactly zero
-											if (delayValue < 0.001)
-											{
-												delayValue = 0.001; // arbitrary
-											}
-											
-											sessionPtr->pendingPasteTimerUPP = NewEventLoopTimerUPP(pasteLineFromTimer);
-											error = InstallEventLoopTimer(GetCurrentEventLoop(),
-																			kEventDurationNoWait + 0.01/* start time; must be nonzero for Mac OS X 10.3 */,
-																			delayValue/* time between fires */,
-																			sessionPtr->pendingPasteTimerUPP, sessionPtr->selfRef/* user data */,
-																			&sessionPtr->pendingPasteTimer);
-											assert_noerr(error);
-										}
-										
-										// NOTE: this assignment will replace any previous set of lines
-										// that might still exist; although very unlikely, this could
-										// happen if the user decided to invoke Paste again while a
-										// large and time-consuming Paste was already in progress
-										sessionPtr->pendingPasteLines.setWithRetain(pastedLines.returnCFArrayRef());
-										sessionPtr->pendingPasteCurrentLine = 0;
+										// regular Paste; the lines are streamed to the session
+										// as quickly as its pseudo-terminal will accept them
+										pasteStreamBegin(sessionPtr, pastedLines.returnCFArrayRef());
 									};
 			
 			
@@ -5322,10 +5743,12 @@ Session_UserInputPaste	(SessionRef			inRef,
 				// the Clipboard contains only one line of text; Paste immediately without warning
 				joinResponder();
 			}
-			else if (noWarning)
+			else if (noWarning || bracketedPasteIsEnabled(ptr))
 			{
-				// the Clipboard contains more than one line, and the user does not want to be warned;
-				// proceed with the Paste, but do it without joining (“other button” option)
+				// the Clipboard contains more than one line, and the user does not want to be warned
+				// (or the application has asked for bracketed paste, so it will not mistake the
+				// new-lines for typed commands); proceed with the Paste, but do it without joining
+				// (“other button” option)
 				normalPasteResponder();
 			}
 			else
@@ -5398,11 +5821,58 @@ Session_UserInputPaste	(SessionRef			inRef,
 
 
 /*!
-Returns "true" only if the specified session is being
-watched for a lack of activity over a short period of
-time.
+Abandons any Paste that is still being streamed to the
+session, as if the remaining text had never been on the
+Clipboard.  Whatever has already been written cannot be
+taken back, of course.
 
-See Session_SetWatch().
+If bracketed-paste mode was in effect, the terminating
+marker is NOT sent; the application is expected to cope
+with the incomplete paste (as it would if, say, a remote
+connection dropped during the Paste).
+
+\retval kSession_ResultOK
+if a Paste was in progress and has been stopped
+
+\retval kSession_ResultInvalidReference
+if "inRef" is invalid
+
+\retval kSession_ResultNotReady
+if no Paste is currently in progress
+
+(2017.10)
+*/
+Session_Result
+Session_UserInputPasteCancel	(SessionRef		inRef)
+{
+	Session_Result		result = kSession_ResultOK;
+	
+	
+	if (nullptr == inRef) result = kSession_ResultInvalidReference;
+	else
+	{
+		My_SessionAutoLocker	ptr(gSessionPtrLocks(), inRef);
+		
+		
+		if (ptr->pendingPasteBytes.empty())
+		{
+			result = kSession_ResultNotReady;
+		}
+		else
+		{
+			pasteStreamEnd(ptr);
+		}
+	}
+	return result;
+}// UserInputPasteCancel
+
+
+/*!
+Returns "true" only if the specified session is being
+watched for a lack of activity over a short period of
+time.
+
+See Session_SetWatch().
 
 (3.1)
 */
@@ -5507,8 +5977,12 @@ resourceLocationString(),
 commandLineArguments(),
 originalDirectoryString(),
 deviceNameString(),
-pendingPasteLines(),
-pendingPasteCurrentLine(0),
+pendingPasteBytes(),
+pendingPasteOffset(0),
+pendingPasteNewLine(),
+pendingPasteLineDelay(0),
+pendingPasteID(0),
+pendingPasteNotifyTime(0),
 activationAbsoluteTime(CFAbsoluteTimeGetCurrent()),
 terminationAbsoluteTime(0),
 watchTriggerAbsoluteTime(CFAbsoluteTimeGetCurrent()),
@@ -5527,6 +6001,8 @@ changeListenerModel(ListenerModel_New(kListenerModel_StyleStandard,
 windowValidationListener(ListenerModel_NewStandardListener(windowValidationStateChanged),
 							ListenerModel_ListenerWrap::kAlreadyRetained),
 terminalWindowListener(), // set at window validation time
+terminalScreenListener(ListenerModel_NewStandardListener(terminalScreenChanged, this/* context */),
+						ListenerModel_ListenerWrap::kAlreadyRetained),
 vectorWindowListener(ListenerModel_NewStandardListener(vectorGraphicsWindowChanged, this/* context */),
 						ListenerModel_ListenerWrap::kAlreadyRetained),
 preferencesListener(ListenerModel_NewStandardListener(preferenceChanged, this/* context */),
@@ -5557,10 +6033,10 @@ readBufferSizeInUse(0),
 readBufferPtr(new UInt8[this->readBufferSizeMaximum]),
 writeEncoding(kCFStringEncodingUTF8), // initially...
 activeWatch(kSession_WatchNothing),
-inactivityWatchTimerUPP(nullptr),
-inactivityWatchTimer(nullptr),
-pendingPasteTimerUPP(nullptr),
-pendingPasteTimer(nullptr),
+watchActivityAbsoluteTime(0),
+watchTimeoutInterval(0),
+watchIsArmed(false),
+writeQueue(nullptr), // set by Session_SetProcess()
 recentSheetContext(),
 sheetType(kMy_SessionSheetTypeNone),
 renameDialog(nullptr),
@@ -5568,9 +6044,11 @@ weakRefEraser(this),
 selfRef(REINTERPRET_CAST(this, SessionRef))
 // echo initialized below
 // preferencesCache initialized below
+// statistics initialized below
 {
 	bzero(&this->echo, sizeof(this->echo));
 	bzero(&this->preferencesCache, sizeof(this->preferencesCache));
+	bzero(&this->statistics, sizeof(this->statistics));
 	
 	assert(nullptr != this->readBufferPtr);
 	
@@ -5672,16 +6150,21 @@ My_Session::
 	this->status = kSession_StateImminentDisposal;
 	changeNotifyForSession(this, kSession_ChangeState, this->selfRef/* context */);
 	gInvalidSessions().insert(this->selfRef);
+	gWatchWheel().remove(this->selfRef);
 	
 	// 3.1 - record the time when the command exited; the structure
 	// will be deallocated shortly, so this is really only usable
 	// by callbacks invoked from this destructor
 	this->terminationAbsoluteTime = CFAbsoluteTimeGetCurrent();
 	
+	// the process goes first so that any write in progress is
+	// interrupted; the write queue (which has its own descriptor)
+	// is then disposed without waiting
 	if (nullptr != this->mainProcess)
 	{
 		Local_KillProcess(&this->mainProcess);
 	}
+	My_WriteQueue::dispose(&this->writeQueue);
 	
 	if (Session_StateIsActive(this->selfRef))
 	{
@@ -5700,6 +6183,16 @@ My_Session::
 		WindowTitleDialog_Dispose(&this->renameDialog);
 	}
 	
+	// screen buffers can outlive the session so they must not
+	// continue to notify it
+	for (auto screenRef : this->targetTerminals)
+	{
+		if (Terminal_IsValid(screenRef))
+		{
+			Terminal_StopMonitoring(screenRef, kTerminal_ChangeWorkingDirectory, this->terminalScreenListener.returnRef());
+		}
+	}
+	
 	closeTerminalWindow(this);
 	
 	// clean up
@@ -5724,11 +6217,6 @@ My_Session::
 		RemoveEventLoopTimer(this->longLifeTimer), this->longLifeTimer = nullptr;
 	}
 	DisposeEventLoopTimerUPP(this->longLifeTimerUPP), this->longLifeTimerUPP = nullptr;
-	if (nullptr != this->pendingPasteTimer)
-	{
-		RemoveEventLoopTimer(this->pendingPasteTimer), this->pendingPasteTimer = nullptr;
-	}
-	DisposeEventLoopTimerUPP(this->pendingPasteTimerUPP), this->pendingPasteTimerUPP = nullptr;
 	if (nullptr != this->respawnSessionTimer)
 	{
 		RemoveEventLoopTimer(this->respawnSessionTimer), this->respawnSessionTimer = nullptr;
@@ -5752,6 +6240,395 @@ My_Session::
 }// My_Session destructor
 
 
+/*!
+Constructor.  See Session_SetProcess().
+
+(2017.10)
+*/
+My_WriteQueue::
+My_WriteQueue	(Local_TerminalID	inFileDescriptor,
+				 size_t				inCapacity)
+:
+// IMPORTANT: THESE ARE EXECUTED IN THE ORDER MEMBERS APPEAR IN THE CLASS.
+_fileDescriptor(dup(inFileDescriptor)),
+_capacity(inCapacity),
+_queuedByteCount(0),
+_ioQueue(dispatch_queue_create("net.macterm.session.write", DISPATCH_QUEUE_SERIAL)),
+_writeSource((_fileDescriptor < 0)
+				? nullptr
+				: dispatch_source_create(DISPATCH_SOURCE_TYPE_WRITE, _fileDescriptor, 0/* mask */, _ioQueue)),
+_buffer(),
+_bufferOffset(0),
+_isSourceSuspended(true), // sources are initially suspended
+_isCanceled(false),
+_drainLowWaterMark(0),
+_drainBlock(nullptr)
+{
+	if (nullptr == _writeSource)
+	{
+		// append() will not accept anything
+		Console_Warning(Console_WriteValue, "failed to create write queue for session; Unix error", errno);
+	}
+	else
+	{
+		// NOTE: the descriptor cannot be made non-blocking because
+		// the data loop thread shares it (and relies on blocking
+		// reads); instead, the handler writes no more than the
+		// space that the device reports, so the write does not
+		// block (and if no space is reported, nothing is written)
+		dispatch_source_set_event_handler(_writeSource,
+											^{
+												writeAvailable(STATIC_CAST(dispatch_source_get_data(_writeSource), size_t));
+											});
+		
+		// the last thing the queue does is to delete itself
+		dispatch_source_set_cancel_handler(_writeSource,
+											^{
+												delete this;
+											});
+	}
+}// My_WriteQueue constructor
+
+
+/*!
+Destructor.  Only the cancel handler of the write source
+should delete the queue; see dispose().
+
+(2017.10)
+*/
+My_WriteQueue::
+~My_WriteQueue ()
+{
+	if (_fileDescriptor >= 0)
+	{
+		UNUSED_RETURN(int)close(_fileDescriptor), _fileDescriptor = kLocal_InvalidTerminalID;
+	}
+	if (nullptr != _writeSource)
+	{
+		dispatch_release(_writeSource), _writeSource = nullptr;
+	}
+	dispatch_release(_ioQueue), _ioQueue = nullptr;
+	if (nullptr != _drainBlock)
+	{
+		Block_release(_drainBlock), _drainBlock = nullptr;
+	}
+}// My_WriteQueue destructor
+
+
+/*!
+Discards any data that is still queued, stops writing to
+the device and destroys the queue.  This returns at once,
+even if a write is in progress; the object is deleted later
+on its own queue.  The given pointer is set to nullptr.
+
+(2017.10)
+*/
+void
+My_WriteQueue::
+dispose		(My_WriteQueue**	inoutQueuePtrPtr)
+{
+	My_WriteQueue*		queuePtr = *inoutQueuePtrPtr;
+	
+	
+	*inoutQueuePtrPtr = nullptr;
+	if (nullptr != queuePtr)
+	{
+		if (nullptr == queuePtr->_writeSource)
+		{
+			delete queuePtr;
+		}
+		else
+		{
+			// the source is canceled from its own queue, after any
+			// work that is already queued; the cancel handler then
+			// deletes the object once no handler can use it anymore
+			dispatch_async(queuePtr->_ioQueue,
+							^{
+								dispatch_source_t	writeSource = queuePtr->_writeSource;
+								
+								
+								queuePtr->_isCanceled = true;
+								if (queuePtr->_isSourceSuspended)
+								{
+									// a source must be running to be canceled
+									queuePtr->_isSourceSuspended = false;
+									dispatch_resume(writeSource);
+								}
+								
+								// IMPORTANT: the cancel handler deletes the queue so
+								// nothing can use "queuePtr" after this point
+								dispatch_source_cancel(writeSource);
+							});
+		}
+	}
+}// My_WriteQueue::dispose
+
+
+/*!
+Copies as much of the given data as will fit into the queue,
+and arranges for it to be written when the device is ready.
+Returns the number of bytes accepted, which is less than
+"inByteCount" only if the queue is full.
+
+(2017.10)
+*/
+size_t
+My_WriteQueue::
+append	(void const*	inBufferPtr,
+		 size_t			inByteCount)
+{
+	size_t		result = std::min(inByteCount, returnAvailableByteCount());
+	
+	
+	if (result > 0)
+	{
+		UInt8 const*				bytePtr = REINTERPRET_CAST(inBufferPtr, UInt8 const*);
+		std::vector< UInt8 > const	dataCopy(bytePtr, bytePtr + result);
+		
+		
+		// NOTE: only the queue decreases this count, so the space
+		// found above cannot be taken by anything else meanwhile
+		_queuedByteCount += result;
+		dispatch_async(_ioQueue,
+						^{
+							_buffer.insert(_buffer.end(), dataCopy.begin(), dataCopy.end());
+							if ((_isSourceSuspended) && (false == _isCanceled))
+							{
+								_isSourceSuspended = false;
+								dispatch_resume(_writeSource);
+							}
+						});
+	}
+	return result;
+}// My_WriteQueue::append
+
+
+/*!
+Arranges for the given block to be invoked on the main
+queue, once, as soon as no more than the specified number
+of bytes remain queued (which might be immediately).  This
+replaces any block given previously; nullptr cancels the
+notification.
+
+(2017.10)
+*/
+void
+My_WriteQueue::
+notifyWhenDrained	(size_t				inLowWaterMark,
+					 dispatch_block_t	inBlock)
+{
+	dispatch_block_t	blockCopy = (nullptr == inBlock) ? nullptr : Block_copy(inBlock);
+	
+	
+	if (nullptr == _writeSource)
+	{
+		// nothing can ever be queued, so the queue is already drained
+		if (nullptr != blockCopy)
+		{
+			dispatch_async(dispatch_get_main_queue(), blockCopy);
+			Block_release(blockCopy), blockCopy = nullptr;
+		}
+	}
+	else
+	{
+		dispatch_async(_ioQueue,
+						^{
+							if (nullptr != _drainBlock)
+							{
+								Block_release(_drainBlock), _drainBlock = nullptr;
+							}
+							_drainLowWaterMark = inLowWaterMark;
+							_drainBlock = blockCopy;
+							
+							// if there is not much data already, respond now
+							writeAvailable(0);
+						});
+	}
+}// My_WriteQueue::notifyWhenDrained
+
+
+/*!
+Writes as much queued data as the device can accept, up
+to the given amount (which may be zero, to only check the
+state of the queue).  Then, notifies the main queue if a
+drain block is waiting, and stops monitoring the device if
+the queue is empty.
+
+IMPORTANT:	Only invoke this on "_ioQueue".
+
+(2017.10)
+*/
+void
+My_WriteQueue::
+writeAvailable	(size_t		inBytesWritable)
+{
+	size_t const	kCompactionThreshold = 65536; // arbitrary; avoid moving data in the buffer too often
+	size_t const	kBytesPending = _buffer.size() - _bufferOffset;
+	
+	
+	if (_isCanceled)
+	{
+		// the queue is being destroyed; nothing else is written and
+		// no drain notification can be useful anymore
+		_queuedByteCount -= kBytesPending;
+		_buffer.clear();
+		_bufferOffset = 0;
+		if (nullptr != _drainBlock)
+		{
+			Block_release(_drainBlock), _drainBlock = nullptr;
+		}
+	}
+	else
+	{
+		if ((kBytesPending > 0) && (inBytesWritable > 0))
+		{
+			ssize_t		bytesWritten = write(_fileDescriptor, &_buffer[_bufferOffset],
+												std::min(kBytesPending, inBytesWritable));
+			
+			
+			if (bytesWritten > 0)
+			{
+				_bufferOffset += bytesWritten;
+				_queuedByteCount -= bytesWritten;
+			}
+			else if ((bytesWritten < 0) && (EAGAIN != errno) && (EINTR != errno))
+			{
+				// the device cannot be written to (e.g. the process has
+				// ended); nothing else will be written, so discard it
+				Console_Warning(Console_WriteValue, "failed to write to session, discarding queued data; Unix error", errno);
+				_bufferOffset = _buffer.size();
+				_queuedByteCount -= kBytesPending;
+			}
+		}
+		
+		if (_bufferOffset >= _buffer.size())
+		{
+			_buffer.clear();
+			_bufferOffset = 0;
+			if (false == _isSourceSuspended)
+			{
+				// until more data arrives, there is no reason to know
+				// whether or not the device is writable
+				_isSourceSuspended = true;
+				dispatch_suspend(_writeSource);
+			}
+		}
+		else if (_bufferOffset > kCompactionThreshold)
+		{
+			_buffer.erase(_buffer.begin(), _buffer.begin() + _bufferOffset);
+			_bufferOffset = 0;
+		}
+		
+		if ((nullptr != _drainBlock) && (_queuedByteCount.load() <= _drainLowWaterMark))
+		{
+			dispatch_async(dispatch_get_main_queue(), _drainBlock);
+			Block_release(_drainBlock), _drainBlock = nullptr;
+		}
+	}
+}// My_WriteQueue::writeAvailable
+
+
+/*!
+Constructor.  See gWatchWheel().
+
+(2017.10)
+*/
+My_WatchWheel::
+My_WatchWheel ()
+:
+// IMPORTANT: THESE ARE EXECUTED IN THE ORDER MEMBERS APPEAR IN THE CLASS.
+_slots(64/* arbitrary; deadlines farther away are simply checked more than once */),
+_currentSlot(0),
+_sessionCount(0),
+_timerUPP(NewEventLoopTimerUPP(watchWheelTimerFired)),
+_timer(nullptr)
+{
+	OSStatus	error = noErr;
+	
+	
+	error = InstallEventLoopTimer(GetCurrentEventLoop(),
+									kEventDurationForever/* start time - do not start yet */,
+									kEventDurationSecond/* time between fires */,
+									_timerUPP, nullptr/* user data */, &_timer);
+	assert_noerr(error);
+}// My_WatchWheel default constructor
+
+
+/*!
+Moves the wheel ahead by one second, and returns (and
+removes) the sessions that should be checked now.  If
+the wheel becomes empty, its timer stops.
+
+(2017.10)
+*/
+void
+My_WatchWheel::
+advance		(My_SessionRefList&		outSessionsToCheck)
+{
+	_currentSlot = (_currentSlot + 1) % _slots.size();
+	outSessionsToCheck.clear();
+	outSessionsToCheck.swap(_slots[_currentSlot]);
+	_sessionCount -= outSessionsToCheck.size();
+	if (0 == _sessionCount)
+	{
+		UNUSED_RETURN(OSStatus)SetEventLoopTimerNextFireTime(_timer, kEventDurationForever);
+	}
+}// My_WatchWheel::advance
+
+
+/*!
+Arranges for the given session to be checked after the
+specified number of seconds (or after the longest delay
+that the wheel can represent, if that is sooner).  The
+timer starts if the wheel was empty.
+
+(2017.10)
+*/
+void
+My_WatchWheel::
+insert	(SessionRef			inSession,
+		 CFTimeInterval		inSecondsFromNow)
+{
+	size_t const	kMaximumDelay = _slots.size() - 1;
+	size_t const	kDelay = (inSecondsFromNow >= kMaximumDelay)
+								? kMaximumDelay
+								: ((inSecondsFromNow <= 1.0)
+									? 1
+									: STATIC_CAST(std::ceil(inSecondsFromNow), size_t));
+	
+	
+	_slots[(_currentSlot + kDelay) % _slots.size()].push_back(inSession);
+	if (0 == _sessionCount++)
+	{
+		UNUSED_RETURN(OSStatus)SetEventLoopTimerNextFireTime(_timer, kEventDurationSecond);
+	}
+}// My_WatchWheel::insert
+
+
+/*!
+Ensures that the given session is not in the wheel.
+
+(2017.10)
+*/
+void
+My_WatchWheel::
+remove	(SessionRef		inSession)
+{
+	for (auto& slotSessions : _slots)
+	{
+		auto	toErase = std::remove(slotSessions.begin(), slotSessions.end(), inSession);
+		
+		
+		_sessionCount -= std::distance(toErase, slotSessions.end());
+		slotSessions.erase(toErase, slotSessions.end());
+	}
+	if (0 == _sessionCount)
+	{
+		UNUSED_RETURN(OSStatus)SetEventLoopTimerNextFireTime(_timer, kEventDurationForever);
+	}
+}// My_WatchWheel::remove
+
+
 /*!
 Brings the session window to the front.  This is installed when
 a drag enters a background window, and is cancelled only if the
@@ -5872,6 +6749,31 @@ autoCaptureSessionToFile	(My_SessionPtr		inPtr)
 }// autoCaptureSessionToFile
 
 
+/*!
+Returns "true" only if any terminal that receives data from
+the given session has been put in bracketed-paste mode by
+its application.
+
+(2017.10)
+*/
+Boolean
+bracketedPasteIsEnabled		(My_SessionPtr		inPtr)
+{
+	Boolean		result = false;
+	
+	
+	for (auto screenRef : inPtr->targetTerminals)
+	{
+		if (Terminal_BracketedPasteIsEnabled(screenRef))
+		{
+			result = true;
+			break;
+		}
+	}
+	return result;
+}// bracketedPasteIsEnabled
+
+
 /*!
 Initiates a capture of the underlying terminal’s text stream
 to the given file.  Returns true unless there is a problem.
@@ -7362,48 +8264,285 @@ localEchoString		(My_SessionPtr		inPtr,
 
 
 /*!
-This is invoked after a user-defined delay, and it pastes the
-next pending line of text (if any).  Once all lines are pasted,
-the timer is destroyed and will not trigger again until the
-user tries to Paste something else.
+Begins to stream the given lines of text to the session
+(replacing any Paste that is still in progress).  The text is
+converted into the session’s encoding all at once, with each
+line separated by the session’s new-line sequence; and if the
+application requested bracketed-paste mode, the result is
+surrounded by the appropriate markers.
 
-Timers that draw must save and restore the current graphics port.
+The data is given to the session’s write queue in parts by
+pasteStreamWrite(), so this returns right away.  If the user
+has set a line insertion delay, lines are written one at a
+time with at least that much time in between.
 
-(4.0)
+(2017.10)
 */
 void
-pasteLineFromTimer	(EventLoopTimerRef		UNUSED_ARGUMENT(inTimer),
-					 void*					inSessionRef)
+pasteStreamBegin	(My_SessionPtr	inPtr,
+					 CFArrayRef		inLines)
 {
-	SessionRef				ref = REINTERPRET_CAST(inSessionRef, SessionRef);
-	My_SessionAutoLocker	ptr(gSessionPtrLocks(), ref);
+	UInt8 const		kBracketBegin[] = { '\033', '[', '2', '0', '0', '~' };
+	UInt8 const		kBracketEnd[] = { '\033', '[', '2', '0', '1', '~' };
+	CFIndex const	kLineCount = CFArrayGetCount(inLines);
+	Boolean const	kIsBracketed = bracketedPasteIsEnabled(inPtr);
+	char const*		newlineBytes = "\012";
+	size_t			newlineSize = 1;
+	
+	
+	// NOTE: this will replace any previous set of lines that might still
+	// be pending; although very unlikely, this could happen if the user
+	// decided to invoke Paste again while a time-consuming Paste was
+	// already in progress
+	pasteStreamEnd(inPtr);
+	++(inPtr->pendingPasteID);
+	
+	unless (kPreferences_ResultOK ==
+			Preferences_ContextGetData(inPtr->configuration.returnRef(), kPreferences_TagPasteNewLineDelay,
+										sizeof(inPtr->pendingPasteLineDelay), &inPtr->pendingPasteLineDelay,
+										true/* search for defaults */))
+	{
+		inPtr->pendingPasteLineDelay = 0; // assume a value, if preference can’t be found
+	}
+	
+	switch (inPtr->eventKeys.newline)
+	{
+	case kSession_NewlineModeMapCR:
+		newlineBytes = "\015";
+		newlineSize = 1;
+		break;
+	
+	case kSession_NewlineModeMapCRLF:
+		newlineBytes = "\015\012";
+		newlineSize = 2;
+		break;
+	
+	case kSession_NewlineModeMapCRNull:
+		newlineBytes = "\015\000";
+		newlineSize = 2;
+		break;
+	
+	case kSession_NewlineModeMapLF:
+	default:
+		break;
+	}
+	inPtr->pendingPasteNewLine.assign(newlineBytes, newlineBytes + newlineSize);
 	
+	if (kIsBracketed)
+	{
+		inPtr->pendingPasteBytes.insert(inPtr->pendingPasteBytes.end(), std::begin(kBracketBegin), std::end(kBracketBegin));
+	}
 	
-	if (ptr->pendingPasteLines.exists())
+	for (CFIndex i = 0; i < kLineCount; ++i)
 	{
-		CFArrayRef		asCFArray = ptr->pendingPasteLines.returnCFArrayRef();
-		CFIndex			arrayLength = CFArrayGetCount(asCFArray);
+		CFStringRef		lineCFString = CFUtilities_StringCast(CFArrayGetValueAtIndex(inLines, i));
+		CFRange const	kWholeLine = CFRangeMake(0, CFStringGetLength(lineCFString));
+		CFIndex			bytesRequired = 0;
+		CFIndex			charactersConverted = 0;
 		
 		
-		if ((ptr->pendingPasteCurrentLine >= arrayLength) || (0 == arrayLength))
+		// dump to the local terminal first, if this mode is turned on
+		if (inPtr->echo.enabled)
 		{
-			// all lines have been pasted; the array is no longer needed
-			ptr->pendingPasteLines.clear();
-			RemoveEventLoopTimer(ptr->pendingPasteTimer), ptr->pendingPasteTimer = nullptr;
-			DisposeEventLoopTimerUPP(ptr->pendingPasteTimerUPP), ptr->pendingPasteTimerUPP = nullptr;
+			localEchoString(inPtr, lineCFString);
+			if (i < (kLineCount - 1))
+			{
+				localEchoKey(inPtr, 0x0D/* carriage return character */);
+			}
 		}
-		else
+		
+		// find out how much space is needed, then convert directly into the buffer
+		charactersConverted = CFStringGetBytes(lineCFString, kWholeLine, inPtr->writeEncoding,
+												0/* loss byte, or 0 for no lossy conversion */,
+												false/* is external representation */,
+												nullptr/* buffer */, 0/* buffer size */, &bytesRequired);
+		if (charactersConverted < kWholeLine.length)
+		{
+			Console_Warning(Console_WriteValueCFString, "pasted line could not be completely converted to the session’s encoding", lineCFString);
+		}
+		if (bytesRequired > 0)
 		{
-			Session_UserInputCFString(ref, CFUtilities_StringCast(CFArrayGetValueAtIndex
-																	(asCFArray, ptr->pendingPasteCurrentLine)));
-			if (ptr->pendingPasteCurrentLine < (arrayLength - 1))
+			size_t const	kOldSize = inPtr->pendingPasteBytes.size();
+			
+			
+			inPtr->pendingPasteBytes.resize(kOldSize + bytesRequired);
+			UNUSED_RETURN(CFIndex)CFStringGetBytes(lineCFString, CFRangeMake(0, charactersConverted), inPtr->writeEncoding,
+													0/* loss byte, or 0 for no lossy conversion */,
+													false/* is external representation */,
+													&inPtr->pendingPasteBytes[kOldSize], bytesRequired, &bytesRequired);
+		}
+		
+		if (i < (kLineCount - 1))
+		{
+			inPtr->pendingPasteBytes.insert(inPtr->pendingPasteBytes.end(), newlineBytes, newlineBytes + newlineSize);
+		}
+	}
+	
+	if (kIsBracketed)
+	{
+		// the text itself must not be able to end the paste early,
+		// so remove any terminating markers that it might contain
+		size_t const	kContentStart = sizeof(kBracketBegin);
+		auto			markerPos = std::search(inPtr->pendingPasteBytes.begin() + kContentStart, inPtr->pendingPasteBytes.end(),
+												std::begin(kBracketEnd), std::end(kBracketEnd));
+		
+		
+		while (markerPos != inPtr->pendingPasteBytes.end())
+		{
+			// since removal could cause a new marker to be formed from
+			// the bytes on either side, resume the search a bit earlier
+			size_t const	kErasedOffset = (markerPos - inPtr->pendingPasteBytes.begin());
+			size_t const	kResumeOffset = std::max(kContentStart, kErasedOffset - std::min(kErasedOffset, sizeof(kBracketEnd) - 1));
+			
+			
+			inPtr->pendingPasteBytes.erase(markerPos, markerPos + sizeof(kBracketEnd));
+			markerPos = std::search(inPtr->pendingPasteBytes.begin() + kResumeOffset, inPtr->pendingPasteBytes.end(),
+									std::begin(kBracketEnd), std::end(kBracketEnd));
+		}
+		inPtr->pendingPasteBytes.insert(inPtr->pendingPasteBytes.end(), std::begin(kBracketEnd), std::end(kBracketEnd));
+	}
+	
+	if ((inPtr->pendingPasteBytes.empty()) || (nullptr == inPtr->writeQueue))
+	{
+		// nothing to do
+		pasteStreamEnd(inPtr);
+	}
+	else
+	{
+		pasteStreamWrite(inPtr);
+	}
+}// pasteStreamBegin
+
+
+/*!
+Stops any Paste that is in progress, releasing its data and
+notifying listeners if they were told the Paste had started.
+
+(2017.10)
+*/
+void
+pasteStreamEnd		(My_SessionPtr	inPtr)
+{
+	if (nullptr != inPtr->writeQueue)
+	{
+		inPtr->writeQueue->notifyWhenDrained(0, nullptr/* block */);
+	}
+	
+	// swap instead of clearing, so that the memory of a large Paste is freed
+	std::vector< UInt8 >().swap(inPtr->pendingPasteBytes);
+	inPtr->pendingPasteOffset = 0;
+	
+	if (inPtr->statusAttributes & kSession_StateAttributePasteInProgress)
+	{
+		changeStateAttributes(inPtr, 0/* attributes to set */,
+								kSession_StateAttributePasteInProgress/* attributes to clear */);
+		changeNotifyForSession(inPtr, kSession_ChangePasteProgress, inPtr->selfRef/* context */);
+	}
+}// pasteStreamEnd
+
+
+/*!
+Adds the next part of a pending Paste to the session’s write
+queue, and arranges to be called again once the queue has
+mostly drained (that is, when the pseudo-terminal has been
+able to accept the data).  Only a small part of the Paste is
+queued at any one time, so that other input (such as an
+interrupt) is not stuck behind it.
+
+If there is a line insertion delay, only one line is queued
+at a time, and the next line is not queued until the queue
+has completely drained and the delay has passed.
+
+If the Paste cannot be completed in one step, the session is
+given the "kSession_StateAttributePasteInProgress" attribute
+and progress is reported to listeners a few times per second
+until the Paste ends.
+
+(2017.10)
+*/
+void
+pasteStreamWrite	(My_SessionPtr	inPtr)
+{
+	if ((nullptr != inPtr->writeQueue) && (inPtr->pendingPasteOffset < inPtr->pendingPasteBytes.size()))
+	{
+		size_t const	kBytesRemaining = inPtr->pendingPasteBytes.size() - inPtr->pendingPasteOffset;
+		size_t			bytesToQueue = std::min(kBytesRemaining, kMy_PasteChunkSize);
+		size_t			bytesAccepted = 0;
+		
+		
+		if (inPtr->pendingPasteLineDelay > 0)
+		{
+			// stop after the next new-line sequence, so that the delay
+			// can be inserted before the following line
+			auto const	kLineStart = inPtr->pendingPasteBytes.begin() + inPtr->pendingPasteOffset;
+			auto const	kNewLinePos = std::search(kLineStart, inPtr->pendingPasteBytes.end(),
+													inPtr->pendingPasteNewLine.begin(), inPtr->pendingPasteNewLine.end());
+			
+			
+			if (inPtr->pendingPasteBytes.end() != kNewLinePos)
 			{
-				Session_SendNewline(ref, kSession_EchoCurrentSessionValue);
+				bytesToQueue = std::min(bytesToQueue, STATIC_CAST(kNewLinePos - kLineStart, size_t) + inPtr->pendingPasteNewLine.size());
 			}
-			++(ptr->pendingPasteCurrentLine);
 		}
+		bytesAccepted = inPtr->writeQueue->append(&inPtr->pendingPasteBytes[inPtr->pendingPasteOffset], bytesToQueue);
+		inPtr->pendingPasteOffset += bytesAccepted;
+	}
+	
+	if ((nullptr == inPtr->writeQueue) || (inPtr->pendingPasteOffset >= inPtr->pendingPasteBytes.size()))
+	{
+		// all data has been queued (or can no longer be sent)
+		pasteStreamEnd(inPtr);
 	}
-}// pasteLineFromTimer
+	else
+	{
+		SessionRef const		kSessionRef = inPtr->selfRef;
+		UInt32 const			kPasteID = inPtr->pendingPasteID;
+		CFAbsoluteTime const	kNow = CFAbsoluteTimeGetCurrent();
+		EventTime const			kLineDelay = inPtr->pendingPasteLineDelay;
+		dispatch_block_t		continueBlock = ^{
+													if (Session_IsValid(kSessionRef))
+													{
+														My_SessionAutoLocker	ptr(gSessionPtrLocks(), kSessionRef);
+														
+														
+														if ((kPasteID == ptr->pendingPasteID) && (false == ptr->pendingPasteBytes.empty()))
+														{
+															pasteStreamWrite(ptr);
+														}
+													}
+												};
+		
+		
+		if (0 == (inPtr->statusAttributes & kSession_StateAttributePasteInProgress))
+		{
+			changeStateAttributes(inPtr, kSession_StateAttributePasteInProgress/* attributes to set */,
+									0/* attributes to clear */);
+			inPtr->pendingPasteNotifyTime = 0;
+		}
+		
+		if ((kNow - inPtr->pendingPasteNotifyTime) > 0.25/* arbitrary; seconds */)
+		{
+			inPtr->pendingPasteNotifyTime = kNow;
+			changeNotifyForSession(inPtr, kSession_ChangePasteProgress, inPtr->selfRef/* context */);
+		}
+		
+		if (kLineDelay > 0)
+		{
+			// continue after the pseudo-terminal has accepted the whole
+			// line and the user’s delay has passed
+			inPtr->writeQueue->notifyWhenDrained(0,
+													^{
+														dispatch_after(dispatch_time(DISPATCH_TIME_NOW, STATIC_CAST(kLineDelay * NSEC_PER_SEC, int64_t)),
+																		dispatch_get_main_queue(), continueBlock);
+													});
+		}
+		else
+		{
+			// continue when the pseudo-terminal has accepted most of the data
+			inPtr->writeQueue->notifyWhenDrained(kMy_PasteChunkSize / 2, continueBlock);
+		}
+	}
+}// pasteStreamWrite
 
 
 /*!
@@ -8492,6 +9631,51 @@ terminalInsertLocalEchoString	(My_SessionPtr		inPtr,
 }// terminalInsertLocalEchoString
 
 
+/*!
+Invoked whenever a monitored terminal screen buffer state
+is changed (see Session_AddDataTarget() to see which states
+are monitored).  Currently this records the directories that
+are reported by the running process, so that process queries
+are not needed to find them.
+
+(2017.10)
+*/
+void
+terminalScreenChanged	(ListenerModel_Ref		UNUSED_ARGUMENT(inUnusedModel),
+						 ListenerModel_Event	inTerminalSettingThatChanged,
+						 void*					inEventContextPtr,
+						 void*					inListenerContextPtr)
+{
+	My_SessionPtr	ptr = REINTERPRET_CAST(inListenerContextPtr, My_SessionPtr);
+	
+	
+	switch (inTerminalSettingThatChanged)
+	{
+	case kTerminal_ChangeWorkingDirectory:
+		{
+			TerminalScreenRef	screen = REINTERPRET_CAST(inEventContextPtr, TerminalScreenRef);
+			CFStringRef			directoryCFString = nullptr;
+			
+			
+			Terminal_CopyWorkingDirectory(screen, directoryCFString);
+			if (nullptr != directoryCFString)
+			{
+				if (nullptr != ptr->mainProcess)
+				{
+					Local_ProcessSetCurrentDirectory(ptr->mainProcess, directoryCFString);
+				}
+				CFRelease(directoryCFString), directoryCFString = nullptr;
+			}
+		}
+		break;
+	
+	default:
+		// ???
+		break;
+	}
+}// terminalScreenChanged
+
+
 /*!
 Invoked whenever a monitored terminal window state is
 changed (see where TerminalWindow_New() is called for
@@ -8953,99 +10137,111 @@ watchNotifyForSession	(My_SessionPtr	inPtr,
 
 
 /*!
-This is invoked after a period of inactivity, and simply sends
-notification that the session is now inactive (from the point of
-view of the user).  This is not to be confused with the session
-active state.
-
-Timers that draw must save and restore the current graphics port.
-
-(3.1)
-*/
-void
-watchNotifyFromTimer	(EventLoopTimerRef		UNUSED_ARGUMENT(inTimer),
-						 void*					inSessionRef)
-{
-	SessionRef				ref = REINTERPRET_CAST(inSessionRef, SessionRef);
-	My_SessionAutoLocker	ptr(gSessionPtrLocks(), ref);
-	
-	
-	watchNotifyForSession(ptr, ptr->activeWatch);
-}// watchNotifyFromTimer
-
+Starts the clock for a timed watch (inactivity or keep-alive)
+of the specified session: the current time is recorded as the
+time of the latest activity, the timeout is read from user
+preferences, and the session is added to the watch wheel.
 
-/*!
-If a watch is currently active on the specified session and
-the watch is of a type that fires periodically (idle timers),
-this routine will reset the timer.  In other words, do this
-when you want to start waiting for the precise duration of
-the watch (usually, immediately after data arrives or some
-other event indicates the watch should start over).
+This is only needed when a watch is set, or when data arrives
+after a watch has triggered; otherwise, arriving data simply
+updates the time of the latest activity.
 
 Has no effect for other kinds of watches.
 
-(3.1)
+(2017.10)
 */
 void
-watchTimerResetForSession	(My_SessionPtr	inPtr,
-							 Session_Watch	inWatchType)
+watchStartForSession	(My_SessionPtr	inPtr)
 {
-	OSStatus	error = noErr;
-	
-	
-	if (kSession_WatchForKeepAlive == inWatchType)
+	if ((kSession_WatchForKeepAlive == inPtr->activeWatch) ||
+		(kSession_WatchForInactivity == inPtr->activeWatch))
 	{
 		Preferences_Result	prefsResult = kPreferences_ResultOK;
 		UInt16				intValue = 0;
 		
 		
-		prefsResult = Preferences_GetData(kPreferences_TagKeepAlivePeriodInMinutes, sizeof(intValue),
-											&intValue);
-		if (kPreferences_ResultOK != prefsResult)
+		// an arbitrary length of dead time must elapse before a session
+		// is considered inactive and triggers a notification
+		if (kSession_WatchForKeepAlive == inPtr->activeWatch)
 		{
-			// set an arbitrary default value
-			intValue = 10;
+			prefsResult = Preferences_GetData(kPreferences_TagKeepAlivePeriodInMinutes, sizeof(intValue),
+												&intValue);
+			if (kPreferences_ResultOK != prefsResult)
+			{
+				// set an arbitrary default value
+				intValue = 10;
+			}
+			inPtr->watchTimeoutInterval = 60.0 * intValue;
 		}
-		
+		else
 		{
-			// an arbitrary length of dead time must elapse before a session
-			// is considered inactive and triggers a notification
-			EventTimerInterval const	kTimeBeforeInactive = kEventDurationMinute * intValue;
-			
-			
-			// install or reset timer to trigger the no-activity notification when appropriate
-			assert(nullptr != inPtr->inactivityWatchTimer);
-			error = SetEventLoopTimerNextFireTime(inPtr->inactivityWatchTimer, kTimeBeforeInactive);
-			assert_noerr(error);
+			prefsResult = Preferences_GetData(kPreferences_TagIdleAfterInactivityInSeconds, sizeof(intValue),
+												&intValue);
+			if (kPreferences_ResultOK != prefsResult)
+			{
+				// set an arbitrary default value
+				intValue = 30;
+			}
+			inPtr->watchTimeoutInterval = intValue;
 		}
-	}
-	else if (kSession_WatchForInactivity == inWatchType)
-	{
-		Preferences_Result	prefsResult = kPreferences_ResultOK;
-		UInt16				intValue = 0;
-		
 		
-		prefsResult = Preferences_GetData(kPreferences_TagIdleAfterInactivityInSeconds, sizeof(intValue),
-											&intValue);
-		if (kPreferences_ResultOK != prefsResult)
+		inPtr->watchActivityAbsoluteTime = CFAbsoluteTimeGetCurrent();
+		unless (inPtr->watchIsArmed)
 		{
-			// set an arbitrary default value
-			intValue = 30;
+			inPtr->watchIsArmed = true;
+			gWatchWheel().insert(inPtr->selfRef, inPtr->watchTimeoutInterval);
 		}
-		
+	}
+}// watchStartForSession
+
+
+/*!
+This is invoked once per second while any session has a timed
+watch.  It checks the deadlines of only those sessions in the
+current slot of the watch wheel; each one that has really gone
+without data for the length of its watch is notified (from
+the point of view of the user, it is now inactive; this is not
+to be confused with the session active state) and the others
+are moved to the slots where their deadlines now fall.
+
+A triggered watch starts again only when more data arrives.
+
+(2017.10)
+*/
+void
+watchWheelTimerFired	(EventLoopTimerRef		UNUSED_ARGUMENT(inTimer),
+						 void*					UNUSED_ARGUMENT(inContext))
+{
+	CFAbsoluteTime const	kNow = CFAbsoluteTimeGetCurrent();
+	My_SessionRefList		sessionsToCheck;
+	
+	
+	gWatchWheel().advance(sessionsToCheck);
+	for (auto sessionRef : sessionsToCheck)
+	{
+		if (Session_IsValid(sessionRef))
 		{
-			// an arbitrary length of dead time must elapse before a session
-			// is considered inactive and triggers a notification
-			EventTimerInterval const	kTimeBeforeInactive = kEventDurationSecond * intValue;
+			My_SessionAutoLocker	ptr(gSessionPtrLocks(), sessionRef);
 			
 			
-			// install or reset timer to trigger the no-activity notification when appropriate
-			assert(nullptr != inPtr->inactivityWatchTimer);
-			error = SetEventLoopTimerNextFireTime(inPtr->inactivityWatchTimer, kTimeBeforeInactive);
-			assert_noerr(error);
+			if (ptr->watchIsArmed)
+			{
+				CFAbsoluteTime const	kDeadline = ptr->watchActivityAbsoluteTime + ptr->watchTimeoutInterval;
+				
+				
+				if (kNow >= kDeadline)
+				{
+					ptr->watchIsArmed = false;
+					watchNotifyForSession(ptr, ptr->activeWatch);
+				}
+				else
+				{
+					gWatchWheel().insert(sessionRef, kDeadline - kNow);
+				}
+			}
 		}
 	}
-}// watchTimerResetForSession
+}// watchWheelTimerFired
 
 
 /*!
@@ -81,6 +81,8 @@ enum
 {
 	kSessionFactory_ChangeActivatingSession		= 'news',	//!< context: SessionRef of session that is becoming active
 	kSessionFactory_ChangeDeactivatingSession	= 'olds',	//!< context: SessionRef of session that is becoming inactive
+	kSessionFactory_ChangeHeadlessSessionCount	= 'hdl#',	//!< context: SessionRef of headless session that was created, or that
+															//!  is about to be destroyed (in "kSession_StateImminentDisposal")
 	kSessionFactory_ChangeNewSessionCount		= 'cxn#'	//!< context: reserved
 };
 
@@ -142,6 +144,13 @@ SessionRef
 	SessionFactory_NewCloneSession					(TerminalWindowRef				inTerminalWindow,
 													 SessionRef						inBaseSession);
 
+SessionRef
+	SessionFactory_NewHeadlessSession				(CFArrayRef						inArgumentArray,
+													 UInt16							inColumnCount,
+													 UInt16							inRowCount,
+													 UInt32							inScrollbackRowCount,
+													 CFStringRef					inWorkingDirectoryOrNull = nullptr);
+
 SessionRef
 	SessionFactory_NewSessionArbitraryCommand		(TerminalWindowRef				inTerminalWindow,
 													 CFArrayRef						inArgumentArray,
@@ -227,6 +236,13 @@ void
 void
 	SessionFactory_ForEachTerminalWindow			(SessionFactory_TerminalWindowBlock		inBlock);
 
+// HEADLESS SESSIONS ARE NEVER INCLUDED BY THE ITERATORS ABOVE
+void
+	SessionFactory_ForEachHeadlessSession			(SessionFactory_SessionBlock	inBlock);
+
+TerminalScreenRef
+	SessionFactory_ReturnHeadlessSessionScreen		(SessionRef						inSession);
+
 //@}
 
 //!\name Indexing Sessions
@@ -88,6 +88,7 @@
 namespace {
 
 typedef std::vector< SessionRef >						SessionList;
+typedef std::map< SessionRef, TerminalScreenRef >		SessionToScreenMap;
 typedef std::vector< TerminalWindowRef >				TerminalWindowList;
 typedef std::multimap< TerminalWindowRef, SessionRef >	TerminalWindowToSessionsMap;
 typedef std::vector< Workspace_Ref >					MyWorkspaceList;
@@ -148,6 +149,7 @@ Boolean					displayTerminalWindow			(TerminalWindowRef, Preferences_ContextRef =
 void					forEachSessionInListDo			(SessionList const&, SessionFactory_SessionBlock);
 void					forEachTerminalWindowInListDo	(TerminalWindowList const&, SessionFactory_TerminalWindowBlock);
 void					handleNewSessionDialogClose		(GenericDialog_Ref, Boolean);
+void					headlessSessionStateChanged		(ListenerModel_Ref, ListenerModel_Event, void*, void*);
 Boolean					newSessionFromCommand			(TerminalWindowRef, UInt32, Preferences_ContextRef, UInt16);
 OSStatus				receiveHICommand				(EventHandlerCallRef, EventRef, void*);
 OSStatus				receiveWindowActivated			(EventHandlerCallRef, EventRef, void*);
@@ -156,8 +158,10 @@ Workspace_Ref			returnActiveWorkspace			();
 void					sessionChanged					(ListenerModel_Ref, ListenerModel_Event, void*, void*);
 void					sessionStateChanged				(ListenerModel_Ref, ListenerModel_Event, void*, void*);
 OSStatus				setSessionState					(EventHandlerCallRef, EventRef, void*);
+void					startTrackingHeadlessSession	(SessionRef, TerminalScreenRef);
 void					startTrackingSession			(SessionRef, TerminalWindowRef);
 void					startTrackingTerminalWindow		(TerminalWindowRef);
+void					stopTrackingHeadlessSession		(SessionRef);
 void					stopTrackingSession				(SessionRef);
 void					stopTrackingTerminalWindow		(TerminalWindowRef);
 
@@ -171,6 +175,7 @@ ListenerModel_Ref				gSessionFactoryStateChangeListenerModel = nullptr;
 ListenerModel_Ref				gSessionStateChangeListenerModel = nullptr;
 ListenerModel_ListenerRef		gSessionChangeListenerRef = nullptr;
 ListenerModel_ListenerRef		gSessionStateChangeListener = nullptr;
+ListenerModel_ListenerRef		gHeadlessSessionStateChangeListener = nullptr;
 CarbonEventHandlerWrap			gNewSessionCommandHandler(GetApplicationEventTarget(),
 															receiveHICommand,
 															CarbonEventSetInClass
@@ -203,6 +208,8 @@ SessionList&					gSessionListSortedByCreationTime ()		{ static SessionList x; re
 TerminalWindowList&				gTerminalWindowListSortedByCreationTime ()	{ static TerminalWindowList x; return x; }
 MyWorkspaceList&				gWorkspaceListSortedByCreationTime ()	{ static MyWorkspaceList x; return x; }
 TerminalWindowToSessionsMap&	gTerminalWindowToSessions()	{ static TerminalWindowToSessionsMap x; return x; }
+SessionList&					gHeadlessSessionListSortedByCreationTime ()	{ static SessionList x; return x; }
+SessionToScreenMap&				gHeadlessSessionScreens ()	{ static SessionToScreenMap x; return x; }
 
 } // anonymous namespace
 
@@ -374,6 +381,9 @@ SessionFactory_Init ()
 	gSessionStateChangeListener = ListenerModel_NewStandardListener(sessionStateChanged);
 	SessionFactory_StartMonitoringSessions(kSession_ChangeState, gSessionStateChangeListener);
 	
+	// headless sessions are monitored separately (see SessionFactory_NewHeadlessSession())
+	gHeadlessSessionStateChangeListener = ListenerModel_NewStandardListener(headlessSessionStateChanged);
+	
 	// under Carbon, listen for special Carbon Events that effectively invoke Session_SetState();
 	// this is for thread safety, to force these calls to always take place in the main thread
 	{
@@ -409,6 +419,28 @@ SessionFactory_Init ()
 												&gCarbonEventSessionProcessDataHandler/* event handler reference */);
 		assert_noerr(error);
 	}
+	
+	// if requested, keep shells ready for new sessions (the shells
+	// themselves are not spawned until the first session is created)
+	{
+		UInt16		preSpawnedShellCount = 0;
+		UInt16		idleTimeoutSeconds = 0;
+		
+		
+		unless (kPreferences_ResultOK ==
+				Preferences_GetData(kPreferences_TagPreSpawnedShellCount,
+									sizeof(preSpawnedShellCount), &preSpawnedShellCount))
+		{
+			preSpawnedShellCount = 0; // assume a value, if preference can’t be found
+		}
+		unless (kPreferences_ResultOK ==
+				Preferences_GetData(kPreferences_TagPreSpawnedShellIdleTimeout,
+									sizeof(idleTimeoutSeconds), &idleTimeoutSeconds))
+		{
+			idleTimeoutSeconds = 600; // assume a value, if preference can’t be found
+		}
+		Local_SetPreSpawnedProcessLimits(preSpawnedShellCount, STATIC_CAST(idleTimeoutSeconds, CFTimeInterval));
+	}
 }// Init
 
 
@@ -423,6 +455,18 @@ the Session Factory.
 void
 SessionFactory_Done ()
 {
+	// nothing else would ever end the processes of headless sessions
+	SessionFactory_ForEachHeadlessSession
+	(^(SessionRef	inSession,
+	   Boolean&		UNUSED_ARGUMENT(outStopFlag))
+	{
+		SessionRef		disposedSession = inSession;
+		
+		
+		Session_Dispose(&disposedSession);
+	});
+	
+	ListenerModel_ReleaseListener(&gHeadlessSessionStateChangeListener);
 	ListenerModel_ReleaseListener(&gSessionStateChangeListener);
 	ListenerModel_ReleaseListener(&gSessionChangeListenerRef);
 	ListenerModel_Dispose(&gSessionStateChangeListenerModel);
@@ -509,6 +553,129 @@ SessionFactory_NewCloneSession	(TerminalWindowRef		inTerminalWindow,
 }// NewCloneSession
 
 
+/*!
+Creates a session that runs the given command in a terminal
+screen with no window or view: the process output is still
+fully emulated, so the screen can be read (and input can be
+sent) by anything that has the session, such as a client of
+the Script Host.  This is meant for long-running automated
+sessions, so that a person only has to look at a terminal
+when something needs attention.
+
+Each headless session costs only its process, the Session and
+the screen buffer.  Scrollback is not allocated unless a row
+count is given (regardless of user preferences); if a screen
+dimension is zero, the user’s default is used.
+
+Headless sessions are not in the lists used by other routines
+in this module (such as SessionFactory_ForEachSession()), and
+their changes are not sent to SessionFactory_StartMonitoringSessions()
+listeners; all of those assume a terminal window.  Instead,
+"kSessionFactory_ChangeHeadlessSessionCount" is sent as each
+one is created or destroyed.  A headless session is destroyed
+when its process ends (unless the user preference to keep
+windows open is set) or by Session_Dispose().
+
+INCOMPLETE: There is not yet any way to give a headless
+session a terminal window, so the user can only see one
+through a Script Host client (such as a viewer that draws the
+screen updates sent over the socket of ScriptHost_Init()).
+Eventually a window should be able to attach to (and detach
+from) a running headless session.
+
+Returns nullptr if the session cannot be created.
+
+(2017.10)
+*/
+SessionRef
+SessionFactory_NewHeadlessSession	(CFArrayRef		inArgumentArray,
+									 UInt16			inColumnCount,
+									 UInt16			inRowCount,
+									 UInt32			inScrollbackRowCount,
+									 CFStringRef	inWorkingDirectoryOrNull)
+{
+	Preferences_ContextWrap		terminalConfig(Preferences_NewContext(Quills::Prefs::TERMINAL),
+												Preferences_ContextWrap::kAlreadyRetained);
+	Preferences_ContextRef		translationConfig = nullptr;
+	SessionRef					result = nullptr;
+	
+	
+	if ((false == terminalConfig.exists()) ||
+		(kPreferences_ResultOK != Preferences_GetDefaultContext(&translationConfig, Quills::Prefs::TRANSLATION)))
+	{
+		Console_Warning(Console_WriteLine, "unable to create settings for headless session");
+	}
+	else
+	{
+		Terminal_ScrollbackType const	kScrollbackType = (0 == inScrollbackRowCount)
+															? kTerminal_ScrollbackTypeDisabled
+															: kTerminal_ScrollbackTypeFixed;
+		TerminalScreenRef				screen = nullptr;
+		Terminal_Result					terminalResult = kTerminal_ResultOK;
+		
+		
+		if (0 != inColumnCount)
+		{
+			UNUSED_RETURN(Preferences_Result)Preferences_ContextSetData(terminalConfig.returnRef(), kPreferences_TagTerminalScreenColumns,
+																		sizeof(inColumnCount), &inColumnCount);
+		}
+		if (0 != inRowCount)
+		{
+			UNUSED_RETURN(Preferences_Result)Preferences_ContextSetData(terminalConfig.returnRef(), kPreferences_TagTerminalScreenRows,
+																		sizeof(inRowCount), &inRowCount);
+		}
+		UNUSED_RETURN(Preferences_Result)Preferences_ContextSetData(terminalConfig.returnRef(), kPreferences_TagTerminalScreenScrollbackType,
+																	sizeof(kScrollbackType), &kScrollbackType);
+		UNUSED_RETURN(Preferences_Result)Preferences_ContextSetData(terminalConfig.returnRef(), kPreferences_TagTerminalScreenScrollbackRows,
+																	sizeof(inScrollbackRowCount), &inScrollbackRowCount);
+		
+		terminalResult = Terminal_NewScreen(terminalConfig.returnRef(), translationConfig, &screen);
+		if (kTerminal_ResultOK != terminalResult)
+		{
+			Console_Warning(Console_WriteValue, "failed to create screen for headless session, error", terminalResult);
+		}
+		else
+		{
+			result = Session_New();
+			if (nullptr == result)
+			{
+				Terminal_ReleaseScreen(&screen);
+			}
+			else
+			{
+				// pre-spawned shells are not used, since they are
+				// only kept for the user’s default command line
+				Local_Result	localResult = Local_SpawnProcess(result, screen, inArgumentArray, inWorkingDirectoryOrNull);
+				
+				
+				if (kLocal_ResultOK != localResult)
+				{
+					Console_Warning(Console_WriteValue, "headless process spawn failed, error", localResult);
+					Session_Dispose(&result);
+					Terminal_ReleaseScreen(&screen);
+				}
+				else
+				{
+					// as in SessionFactory_NewSessionArbitraryCommand(), the
+					// encoding is fixed once the process exists
+					if (false == TextTranslation_ContextSetEncoding(Session_ReturnTranslationConfiguration(result),
+																	TextTranslation_ContextReturnEncoding
+																	(translationConfig, kCFStringEncodingUTF8),
+																	true/* via copy */))
+					{
+						Console_Warning(Console_WriteLine, "failed to set text encoding of new headless session");
+					}
+					
+					startTrackingHeadlessSession(result, screen);
+				}
+			}
+		}
+	}
+	
+	return result;
+}// NewHeadlessSession
+
+
 /*!
 Creates a terminal window (or uses the specified window, if not
 nullptr), and attempts to run the specified process inside it.
@@ -574,12 +741,34 @@ SessionFactory_NewSessionArbitraryCommand	(TerminalWindowRef			inTerminalWindow,
 		result = Session_New(inContextOrNull);
 		if (nullptr != result)
 		{
-			Local_Result	localResult = kLocal_ResultOK;
+			TerminalScreenRef	screenBuffer = TerminalWindow_ReturnScreenWithFocus(terminalWindow);
+			Local_Result		localResult = kLocal_ResultNoPreSpawnedProcess;
+			Boolean				allowPreSpawned = true;
 			
 			
+			// unless the session disallows it, try to use a shell that was
+			// spawned ahead of time (this only works if the command line is
+			// the user’s default shell, and is also how the set of shells
+			// is replenished)
+			if (nullptr != inContextOrNull)
+			{
+				unless (kPreferences_ResultOK ==
+						Preferences_ContextGetData(inContextOrNull, kPreferences_TagPreSpawnedShellAllowed,
+													sizeof(allowPreSpawned), &allowPreSpawned, true/* search defaults */))
+				{
+					allowPreSpawned = true; // assume a value, if preference can’t be found
+				}
+			}
+			if (allowPreSpawned)
+			{
+				localResult = Local_AdoptPreSpawnedProcess(result, screenBuffer, inArgumentArray, inWorkingDirectoryOrNull);
+			}
+			
 			// see also SessionFactory_RespawnSession(), which must do something similar
-			localResult = Local_SpawnProcess(result, TerminalWindow_ReturnScreenWithFocus(terminalWindow),
-												inArgumentArray, inWorkingDirectoryOrNull);
+			if (kLocal_ResultNoPreSpawnedProcess == localResult)
+			{
+				localResult = Local_SpawnProcess(result, screenBuffer, inArgumentArray, inWorkingDirectoryOrNull);
+			}
 			if (kLocal_ResultOK == localResult)
 			{
 				// success!
@@ -1498,6 +1687,24 @@ SessionFactory_DisplayUserCustomizationUI	(TerminalWindowRef			inTerminalWindow,
 }// DisplayUserCustomizationUI
 
 
+/*!
+Performs the specified operation on every headless session
+(see SessionFactory_NewHeadlessSession()), in the order they
+were created.  A copy of the list is used, so the block may
+create or destroy sessions.
+
+(2017.10)
+*/
+void
+SessionFactory_ForEachHeadlessSession	(SessionFactory_SessionBlock	inBlock)
+{
+	SessionList		listCopy = gHeadlessSessionListSortedByCreationTime();
+	
+	
+	forEachSessionInListDo(listCopy, inBlock);
+}// ForEachHeadlessSession
+
+
 /*!
 Performs the specified operation on every session in
 the list.  The list must NOT change during iteration;
@@ -1833,6 +2040,29 @@ SessionFactory_ReturnCount ()
 }// ReturnCount
 
 
+/*!
+Returns the terminal screen of the specified headless session
+(see SessionFactory_NewHeadlessSession()), or nullptr if the
+session is not headless.  The screen is valid until the session
+enters the state "kSession_StateImminentDisposal".
+
+(2017.10)
+*/
+TerminalScreenRef
+SessionFactory_ReturnHeadlessSessionScreen	(SessionRef		inSession)
+{
+	auto				toSessionScreenPair = gHeadlessSessionScreens().find(inSession);
+	TerminalScreenRef	result = nullptr;
+	
+	
+	if (gHeadlessSessionScreens().end() != toSessionScreenPair)
+	{
+		result = toSessionScreenPair->second;
+	}
+	return result;
+}// ReturnHeadlessSessionScreen
+
+
 /*!
 Traverses all sessions and counts the number of
 sessions with the specified status.
@@ -2793,6 +3023,39 @@ handleNewSessionDialogClose		(GenericDialog_Ref		inDialogThatClosed,
 }// handleNewSessionDialogClose
 
 
+/*!
+Invoked whenever a headless session changes state; when
+it is about to be destroyed, its screen is released.
+
+(2017.10)
+*/
+void
+headlessSessionStateChanged		(ListenerModel_Ref		UNUSED_ARGUMENT(inUnusedModel),
+								 ListenerModel_Event	inSessionChange,
+								 void*					inEventContextPtr,
+								 void*					UNUSED_ARGUMENT(inListenerContextPtr))
+{
+	switch (inSessionChange)
+	{
+	case kSession_ChangeState:
+		{
+			SessionRef		session = REINTERPRET_CAST(inEventContextPtr, SessionRef);
+			
+			
+			if (kSession_StateImminentDisposal == Session_ReturnState(session))
+			{
+				stopTrackingHeadlessSession(session);
+			}
+		}
+		break;
+	
+	default:
+		// ???
+		break;
+	}
+}// headlessSessionStateChanged
+
+
 /*!
 Creates a new session based on a command ID (such as from a
 menu); or, arranges for the appropriate user interface to
@@ -3380,6 +3643,32 @@ setSessionState		(EventHandlerCallRef	UNUSED_ARGUMENT(inHandlerCallRef),
 }// setSessionState
 
 
+/*!
+The headless equivalent of startTrackingSession(): the
+session is connected to its screen (which this module now
+owns) and activated, and listeners are notified.  See also
+stopTrackingHeadlessSession().
+
+(2017.10)
+*/
+void
+startTrackingHeadlessSession	(SessionRef				inSession,
+								 TerminalScreenRef		inScreen)
+{
+	Session_StartMonitoring(inSession, kSession_ChangeState, gHeadlessSessionStateChangeListener);
+	
+	Session_AddDataTarget(inSession, kSession_DataTargetStandardTerminal, inScreen);
+	Terminal_SetListeningSession(inScreen, inSession);
+	
+	gHeadlessSessionListSortedByCreationTime().push_back(inSession);
+	gHeadlessSessionScreens()[inSession] = inScreen;
+	
+	Session_SetState(inSession, kSession_StateActiveUnstable);
+	
+	changeNotifyGlobal(kSessionFactory_ChangeHeadlessSessionCount, inSession/* context */);
+}// startTrackingHeadlessSession
+
+
 /*!
 Invoke this routine from every factory method, to
 start tracking the new SessionRef in this module.
@@ -3452,6 +3741,39 @@ startTrackingTerminalWindow		(TerminalWindowRef		inTerminalWindow)
 }// startTrackingTerminalWindow
 
 
+/*!
+Invoke this routine when a headless session is being
+destroyed, to undo the effects of startTrackingHeadlessSession().
+Listeners are notified first, while the screen is still
+valid.
+
+(2017.10)
+*/
+void
+stopTrackingHeadlessSession		(SessionRef		inSession)
+{
+	TerminalScreenRef	screen = SessionFactory_ReturnHeadlessSessionScreen(inSession);
+	
+	
+	if (nullptr != screen)
+	{
+		SessionList&	targetList = gHeadlessSessionListSortedByCreationTime();
+		
+		
+		changeNotifyGlobal(kSessionFactory_ChangeHeadlessSessionCount, inSession/* context */);
+		
+		Session_StopMonitoring(inSession, kSession_ChangeState, gHeadlessSessionStateChangeListener);
+		targetList.erase(std::remove(targetList.begin(), targetList.end(), inSession), targetList.end());
+		gHeadlessSessionScreens().erase(inSession);
+		
+		// nothing else refers to the screen
+		UNUSED_RETURN(Session_Result)Session_RemoveDataTarget(inSession, kSession_DataTargetStandardTerminal, screen);
+		UNUSED_RETURN(Terminal_Result)Terminal_SetListeningSession(screen, nullptr);
+		Terminal_ReleaseScreen(&screen);
+	}
+}// stopTrackingHeadlessSession
+
+
 /*!
 Invoke this routine when a session is being destroyed,
 to undo the effects of startTrackingSession().
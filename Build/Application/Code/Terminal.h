@@ -129,6 +129,9 @@ enum
 	kTerminal_ChangeWindowMinimization	= 'MnmR',	//!< terminal received a request to minimize or restore;
 													//!  use Terminal_WindowIsToBeMinimized() for more info
 													//!  (context: TerminalScreenRef)
+	kTerminal_ChangeWorkingDirectory	= 'CWDr',	//!< terminal received a new working directory (via “ESC]7”);
+													//!  use Terminal_CopyWorkingDirectory() to determine path
+													//!  (context: TerminalScreenRef)
 	kTerminal_ChangeXTermColor			= 'XTCl'	//!< a new value has been set for some color in the table of 256
 													//!  XTerm colors (context: Terminal_XTermColorDescriptionConstPtr)
 };
@@ -188,11 +191,15 @@ typedef UInt32 Terminal_TextCopyFlags;
 enum
 {
 	kTerminal_TextCopyFlagsRectangular					= (1 << 0),		//!< only considers text within a rectangular area
-	kTerminal_TextCopyFlagsAlwaysNewLineAtRightMargin	= (1 << 1)		//!< normally, the new-line sequence is skipped for
+	kTerminal_TextCopyFlagsAlwaysNewLineAtRightMargin	= (1 << 1),		//!< normally, the new-line sequence is skipped for
 																		//!  any line where the copy area includes the right
 																		//!  margin and the right margin character is not a
 																		//!  whitespace character; set this flag to force
 																		//!  new-line appendages in these cases
+	kTerminal_TextCopyFlagsNoEndWhitespace				= (1 << 2),		//!< skip all whitespace characters at the end of lines
+	kTerminal_TextCopyFlagsInline						= (1 << 3),		//!< do not write any new-line sequences between lines
+	kTerminal_TextCopyFlagsLineSeparatorLF				= (1 << 4),		//!< use LF as line ending (default is CR)
+	kTerminal_TextCopyFlagsLastLineHasSeparator			= (1 << 5)		//!< also write a line ending after the final line
 };
 
 /*!
@@ -238,6 +245,17 @@ struct Terminal_ScrollDescription
 };
 typedef Terminal_ScrollDescription const*	Terminal_ScrollDescriptionConstPtr;
 
+/*!
+Running totals that a terminal screen keeps about its own
+activity; see Terminal_GetStatistics().  The counts are
+never reset, so rates are found by sampling twice.
+*/
+struct Terminal_Statistics
+{
+	UInt64		echoCharacterCount;		//!< number of characters echoed to the screen (or to captures)
+	UInt64		scrollbackLineCount;	//!< number of lines that have been added to the scrollback
+};
+
 struct Terminal_XTermColorDescription
 {
 	TerminalScreenRef	screen;				//!< the screen for which the color applies
@@ -297,6 +315,33 @@ Terminal_InvokeScreenRunProc	(Terminal_ScreenRunProcPtr		inUserRoutine,
 
 
 
+/*!
+Text Sink Routine
+
+This defines a function that receives text exported from a
+terminal screen by Terminal_CopyRangeToSink().  The bytes
+are always in UTF-8 encoding and they are only valid for the
+duration of the call; the caller reuses its buffer for each
+chunk.  A chunk never ends in the middle of an encoded code
+point, but chunks have no relationship to line boundaries.
+
+Return false to abort the export (for instance, if a write
+fails); otherwise, return true to receive more data.
+*/
+typedef Boolean (*Terminal_TextSinkProcPtr)		(UInt8 const*		inUTF8Bytes,
+												 size_t				inByteCount,
+												 void*				inContextPtr);
+inline Boolean
+Terminal_InvokeTextSinkProc		(Terminal_TextSinkProcPtr	inUserRoutine,
+								 UInt8 const*				inUTF8Bytes,
+								 size_t						inByteCount,
+								 void*						inContextPtr)
+{
+	return (*inUserRoutine)(inUTF8Bytes, inByteCount, inContextPtr);
+}
+
+
+
 #pragma mark Public Methods
 
 //!\name Creating and Destroying Terminal Screen Buffers
@@ -421,6 +466,17 @@ Terminal_Result
 											 TextAttributes_Object		inAttributesToSet,
 											 TextAttributes_Object		inAttributesToClear);
 
+Terminal_Result
+	Terminal_CopyRangeToSink				(TerminalScreenRef			inScreen,
+											 Terminal_LineRef			inStartRow,
+											 UInt32						inNumberOfRowsToConsider,
+											 UInt16						inZeroBasedStartColumn,
+											 SInt16						inZeroBasedPastEndColumnOrNegativeForLastColumn,
+											 Terminal_TextCopyFlags		inFlags,
+											 UInt16						inMaxSpacesToReplaceWithTabOrZero,
+											 Terminal_TextSinkProcPtr	inSink,
+											 void*						inSinkContextPtr);
+
 OSStatus
 	Terminal_CreateContentsAEDesc			(TerminalScreenRef			inScreen,
 											 Terminal_LineRef			inStartRow,
@@ -451,6 +507,16 @@ Terminal_Result
 											 UniChar const*&			outReferencePastEnd,
 											 Terminal_TextFilterFlags	inFlags = 0);
 
+Boolean
+	Terminal_TextSinkToCFMutableData		(UInt8 const*				inUTF8Bytes,
+											 size_t						inByteCount,
+											 void*						inCFMutableDataRef);
+
+Boolean
+	Terminal_TextSinkToFileDescriptor		(UInt8 const*				inUTF8Bytes,
+											 size_t						inByteCount,
+											 void*						inFileDescriptorPtr);
+
 //@}
 
 //!\name Terminal State
@@ -459,6 +525,9 @@ Terminal_Result
 Boolean
 	Terminal_BellIsEnabled					(TerminalScreenRef			inScreen);
 
+Boolean
+	Terminal_BracketedPasteIsEnabled		(TerminalScreenRef			inScreen);
+
 void
 	Terminal_CopyTitleForIcon				(TerminalScreenRef			inRef,
 											 CFStringRef&				outTitle);
@@ -467,6 +536,10 @@ void
 	Terminal_CopyTitleForWindow				(TerminalScreenRef			inRef,
 											 CFStringRef&				outTitle);
 
+void
+	Terminal_CopyWorkingDirectory			(TerminalScreenRef			inRef,
+											 CFStringRef&				outPOSIXPath);
+
 Terminal_Result
 	Terminal_CursorGetLocation				(TerminalScreenRef			inScreen,
 											 UInt16*					outZeroBasedColumnPtr,
@@ -504,6 +577,10 @@ Terminal_Result
 	Terminal_EmulatorSet					(TerminalScreenRef			inScreen,
 											 Emulation_FullType			inEmulator);
 
+Terminal_Result
+	Terminal_GetStatistics					(TerminalScreenRef			inScreen,
+											 Terminal_Statistics&		outStatistics);
+
 Boolean
 	Terminal_IsInPasswordMode				(TerminalScreenRef			inScreen);
 
@@ -56,6 +56,7 @@ extern "C"
 {
 #	include <errno.h>
 #	include <pthread.h>
+#	include <unistd.h>
 }
 
 // Mac includes
@@ -68,10 +69,9 @@ extern "C"
 #import <CFRetainRelease.h>
 #import <CFUtilities.h>
 #import <Console.h>
-#import <MemoryBlockReferenceLocker.template.h>
+#import <MemoryBlockReferenceTable.template.h>
 #import <MemoryBlocks.h>
 #import <RegionUtilities.h>
-#import <Registrar.template.h>
 #import <SoundSystem.h>
 #import <StringUtilities.h>
 
@@ -323,11 +323,13 @@ enum
 	kMy_ParserStateSeenESCRightSqBracket2		= 'ES]2',	//!< generic state used to define emulator-specific states, below
 	kMy_ParserStateSeenESCRightSqBracket3		= 'ES]3',	//!< generic state used to define emulator-specific states, below
 	kMy_ParserStateSeenESCRightSqBracket4		= 'ES]4',	//!< generic state used to define emulator-specific states, below
+	kMy_ParserStateSeenESCRightSqBracket7		= 'ES]7',	//!< generic state used to define emulator-specific states, below
 	kMy_ParserStateSeenESCRightSqBracket0Semi	= 'E]0;',	//!< generic state used to define emulator-specific states, below
 	kMy_ParserStateSeenESCRightSqBracket1Semi	= 'E]1;',	//!< generic state used to define emulator-specific states, below
 	kMy_ParserStateSeenESCRightSqBracket2Semi	= 'E]2;',	//!< generic state used to define emulator-specific states, below
 	kMy_ParserStateSeenESCRightSqBracket3Semi	= 'E]3;',	//!< generic state used to define emulator-specific states, below
 	kMy_ParserStateSeenESCRightSqBracket4Semi	= 'E]4;',	//!< generic state used to define emulator-specific states, below
+	kMy_ParserStateSeenESCRightSqBracket7Semi	= 'E]7;',	//!< generic state used to define emulator-specific states, below
 	kMy_ParserStateSeenESCA						= 'ESCA',	//!< generic state used to define emulator-specific states, below
 	kMy_ParserStateSeenESCB						= 'ESCB',	//!< generic state used to define emulator-specific states, below
 	kMy_ParserStateSeenESCC						= 'ESCC',	//!< generic state used to define emulator-specific states, below
@@ -476,8 +478,9 @@ WARNING:	The specified buffer is a limited slice of the
 			translation will not work.  You must be prepared
 			to “backtrack” and ignore zero or more bytes at
 			the end of the buffer, to find a valid segment.
-			TextTranslation_PersistentCFStringCreate() is
-			very useful for this!
+			A decoder from TextTranslation_NewDecoder() is
+			very useful for this, as it holds incomplete
+			characters until the rest of their bytes arrive.
 */
 typedef UInt32 (*My_EmulatorEchoDataProcPtr)	(My_ScreenBuffer*	inDataPtr,
 												 UInt8 const*		inBuffer,
@@ -614,40 +617,6 @@ invokeEmulatorStateTransitionProc	(My_EmulatorStateTransitionProcPtr	inProc,
 	return (*inProc)(inDataPtr, inOldNew, outHandled);
 }
 
-/*!
-Screen Line Operation Routine
-
-This defines a function that can be used as an iterator
-over all of the rows of a virtual screen buffer (either
-the main screen or the scrollback).  The specified text
-buffer (which is read/write) includes the contents of
-the current row.
-
-The row number passed into the routine is relative to the
-iteration currently being done; for example, if someone
-iterates over lines 5 to 8 of a buffer, the line number
-is 0 when starting at line 5, and maximizes at 3 when
-line 8 is hit.
-
-If your operation modifies the buffer (which is allowed),
-return "true" to notify the virtual screen module that
-you changed the text.  Otherwise, return "false" if you
-leave the text alone.
-*/
-typedef void (*My_ScreenLineOperationProcPtr)	(My_ScreenBuffer*		inScreen,
-												 CFMutableStringRef		inLineTextBuffer,
-												 UInt32					inZeroBasedRowNumberOrNegativeForScrollbackRow,
-												 void*					inContextPtr);
-inline void
-invokeScreenLineOperationProc	(My_ScreenLineOperationProcPtr	inUserRoutine,
-								 My_ScreenBuffer*				inScreen,
-								 CFMutableStringRef				inLineTextBuffer,
-								 UInt32							inZeroBasedRowNumberRelativeToStartOfIterationRange,
-								 void*							inContextPtr)
-{
-	(*inUserRoutine)(inScreen, inLineTextBuffer, inZeroBasedRowNumberRelativeToStartOfIterationRange, inContextPtr);
-}
-
 } // anonymous namespace
 
 #pragma mark Types
@@ -1034,6 +1003,7 @@ public:
 	My_ParserState						stringAccumulatorState;	//!< state that was in effect when the "stringAccumulator" was recently cleared
 	std::string							stringAccumulator;		//!< used to gather characters for such things as XTerm window changes
 	UTF8Decoder_StateMachine			multiByteDecoder;		//!< as individual bytes are processed, this tracks complete or invalid sequences
+	TextTranslation_DecoderRef			echoDecoder;			//!< translates bytes to be echoed; recreated whenever "inputTextEncoding" no longer matches
 	UInt16								stateRepetitions;		//!< to guard against looping; counts repetitions of same state
 	SInt16								argLastIndex;			//!< zero-based last parameter position in the "values" array
 	ParameterList						argList;				//!< all values provided for the current escape sequence
@@ -1075,8 +1045,8 @@ private:
 };
 typedef My_Emulator*	My_EmulatorPtr;
 
-typedef MemoryBlockReferenceTracker< TerminalScreenRef >	My_RefTracker;
-typedef Registrar< TerminalScreenRef, My_RefTracker >		My_RefRegistrar;
+typedef MemoryBlockReferenceTable< TerminalScreenRef, My_ScreenBuffer >				My_ScreenReferenceTable;
+typedef MemoryBlockReferenceTableRegistrar< TerminalScreenRef, My_ScreenBuffer >	My_RefRegistrar;
 
 struct My_ScreenBuffer
 {
@@ -1129,7 +1099,7 @@ public:
 	Boolean
 	returnXTermWindowAlteration		(Preferences_ContextRef);
 	
-	My_RefRegistrar						refValidator;				//!< ensures this reference is recognized as a valid one
+	My_RefRegistrar						refValidator;				//!< assigns the reference to this structure and ensures it is recognized as a valid one
 	Preferences_ContextWrap				configuration;
 	My_Emulator							emulator;					//!< handles all parsing of the data stream
 	SessionRef							listeningSession;			//!< may be nullptr; the currently attached session, where certain terminal reports are sent
@@ -1138,6 +1108,7 @@ public:
 																	//!  TEMPORARY: the speaker REALLY shouldn’t be part of the terminal data model!
 	CFRetainRelease						windowTitleCFString;		//!< stores the string that the terminal considers its window title
 	CFRetainRelease						iconTitleCFString;			//!< stores the string that the terminal considers its icon title
+	CFRetainRelease						workingDirectoryCFString;	//!< most recent POSIX path reported by the application (via "ESC]7"); may be empty
 	
 	ListenerModel_Ref					changeListenerModel;		//!< registry of listeners for various terminal events
 	ListenerModel_ListenerWrap			preferenceMonitor;			//!< listener for changes to preferences that affect a particular screen
@@ -1153,6 +1124,7 @@ public:
 	My_ScreenBufferLineList				screenBuffer;				//!< all of the visible text for the terminal;
 																	//!  IMPORTANT: ONLY modify the screen buffer using screen...() routines!
 	My_ByteString						bytesToEcho;				//!< captures contiguous blocks of text to be translated and echoed
+	std::vector< UniChar >				charactersToEcho;			//!< scratch space for the translation of "bytesToEcho"
 	
 	// Error Counts
 	//
@@ -1172,6 +1144,7 @@ public:
 																	//!  reconsider the chosen translation table for the session
 	UInt32								errorCountTotal;			//!< used to eventually fire "kTerminal_ChangeExcessiveErrors", if things have
 																	//!  become just ridiculous
+	Terminal_Statistics					statistics;					//!< running totals of activity, returned by Terminal_GetStatistics()
 	
 	My_TabStopList						tabSettings;				//!< array of characters representing tab stops; values are either kMy_TabClear
 																	//!  (for most columns), or kMy_TabSet at tab columns
@@ -1234,6 +1207,8 @@ public:
 																	//!  sequence, but if the latter, ESC-character sequences are allowed instead
 	Boolean								modeApplicationKeys;		//!< DECKPAM mode: true only if the keypad is in application mode
 	Boolean								modeAutoWrap;				//!< DECAWM mode: true only if line wrapping is automatic
+	Boolean								modeBracketedPaste;			//!< XTerm bracketed-paste mode: true only if pasted text should be surrounded
+																	//!  by the sequences ESC [ 200 ~ and ESC [ 201 ~ when it is sent to the session
 	Boolean								modeCursorKeysForApp;		//!< DECCKM mode: true only if the keypad should not act as cursor movement arrows
 																	//!  (note also that the VT100 manual states this setting has no effect unless
 																	//!  the terminal is also in ANSI mode and the keypad is in application mode
@@ -1308,7 +1283,7 @@ public:
 typedef My_ScreenBuffer*			My_ScreenBufferPtr;
 typedef My_ScreenBuffer const*		My_ScreenBufferConstPtr;
 
-typedef MemoryBlockReferenceLocker< TerminalScreenRef, My_ScreenBuffer >	My_ScreenReferenceLocker;
+typedef std::set< My_ScreenBufferPtr >		My_ScreenBufferSet;
 
 /*!
 Manages state determination and transition for conditions
@@ -1726,6 +1701,8 @@ public:
 		kStateSWTAcquireStr		= kMy_ParserStateSeenESCRightSqBracket2Semi,			//!< seen ESC]2, gathering characters of string
 		kStateSetColor			= kMy_ParserStateSeenESCRightSqBracket4,				//!< subsequent string is a color specification
 		kStateColorAcquireStr	= kMy_ParserStateSeenESCRightSqBracket4Semi,			//!< seen ESC]4, gathering characters of string
+		kStateSetCWD			= kMy_ParserStateSeenESCRightSqBracket7,				//!< subsequent string is a URL for the working directory
+		kStateCWDAcquireStr		= kMy_ParserStateSeenESCRightSqBracket7Semi,			//!< seen ESC]7, gathering characters of string
 		kStateStringTerminator	= kMy_ParserStateSeenESCBackslash,						//!< perform action according to accumulated string
 	};
 };
@@ -1752,8 +1729,7 @@ typedef My_SearchThreadContext const*	My_SearchThreadContextConstPtr;
 #pragma mark Internal Method Prototypes
 namespace {
 
-void						addScreenLineLength						(My_ScreenBufferPtr, CFMutableStringRef, UInt32, void*);
-void						appendScreenLineRawToCFString			(My_ScreenBufferPtr, CFMutableStringRef, UInt32, void*);
+size_t						appendUTF8ForCharacters					(UniChar const*, UniChar const*, UInt16, UInt8*);
 void						assertScrollingRegion					(My_ScreenBufferPtr);
 void						bufferEraseCursorLine					(My_ScreenBufferPtr, My_BufferChanges);
 void						bufferEraseFromCursorColumn				(My_ScreenBufferPtr, My_BufferChanges, UInt16);
@@ -1781,6 +1757,9 @@ void						changeLineGlobalAttributes				(My_ScreenBufferPtr, My_ScreenBufferLine
 void						changeLineRangeAttributes				(My_ScreenBufferPtr, My_ScreenBufferLine&, UInt16,
 																	 SInt16, TextAttributes_Object, TextAttributes_Object);
 void						changeNotifyForTerminal					(My_ScreenBufferConstPtr, Terminal_Change, void*);
+void						clearWideCharacterAtColumn				(My_ScreenBufferLine&, UInt16);
+CFStringRef					copyLocalPathForWorkingDirectoryURL		(std::string const&);
+CFStringRef					copyTextForSearch						(My_ScreenBufferLine const&, std::vector< UInt16 >&);
 My_ScreenBufferLinePtr		createLinePtr							();
 void						cursorRestore							(My_ScreenBufferPtr);
 void						cursorSave								(My_ScreenBufferPtr);
@@ -1789,8 +1768,6 @@ Boolean						defineTrueColor							(My_ScreenBufferPtr, UInt8, UInt8, UInt8, Tex
 void						deleteLinePtr							(My_ScreenBufferLinePtr&);
 void						echoCFString							(My_ScreenBufferPtr, CFStringRef);
 void						eraseRightHalfOfLine					(My_ScreenBufferPtr, My_ScreenBufferLine&);
-Terminal_Result				forEachLineDo							(TerminalScreenRef, Terminal_LineRef, UInt32,
-																	 My_ScreenLineOperationProcPtr, void*);
 inline My_LineIteratorPtr	getLineIterator							(Terminal_LineRef);
 My_ScreenBufferPtr			getVirtualScreenData					(TerminalScreenRef);
 void						highlightLED							(My_ScreenBufferPtr, SInt16);
@@ -1815,6 +1792,7 @@ void						moveCursorUpOrScroll					(My_ScreenBufferPtr);
 void						moveCursorX								(My_ScreenBufferPtr, SInt16);
 void						moveCursorY								(My_ScreenBufferPtr, My_ScreenRowIndex);
 void						resetTerminal							(My_ScreenBufferPtr, Boolean = false);
+UniChar						returnCellForCluster					(CFStringRef);
 SessionRef					returnListeningSession					(My_ScreenBufferPtr);
 Boolean						screenCopyLinesToScrollback				(My_ScreenBufferPtr);
 Boolean						screenInsertNewLines					(My_ScreenBufferPtr, My_ScreenBufferLineList::size_type);
@@ -1824,7 +1802,7 @@ void						setCursorVisible						(My_ScreenBufferPtr, Boolean);
 void						setScrollbackSize						(My_ScreenBufferPtr, UInt32);
 Terminal_Result				setVisibleColumnCount					(My_ScreenBufferPtr, UInt16);
 Terminal_Result				setVisibleRowCount						(My_ScreenBufferPtr, UInt16);
-CFStringRef					stringByStrippingEndWhitespace			(CFStringRef);
+NSString*					stringForCells							(My_ScreenBufferLine const&, NSRange);
 // IMPORTANT: Attribute bit manipulation is fully described in "TextAttributes.h".
 //            Changes must be kept consistent everywhere.  See below, for usage.
 inline TextAttributes_Object	styleOfVTParameter					(UInt16	inPs)
@@ -1843,9 +1821,10 @@ UniChar						translateCharacter						(My_ScreenBufferPtr, UniChar, TextAttribute
 #pragma mark Variables
 namespace {
 
+CFAbsoluteTime&					gClusterReclaimTime ()		{ static CFAbsoluteTime x = 0; return x; }
 My_PrintableByUniChar&			gDumbTerminalRenderings ()	{ static My_PrintableByUniChar x; return x; }
-My_ScreenReferenceLocker&		gScreenRefLocks ()			{ static My_ScreenReferenceLocker x; return x; }
-My_RefTracker&					gTerminalScreenValidRefs ()	{ static My_RefTracker x; return x; }
+My_ScreenBufferSet&				gScreenBuffers ()			{ static My_ScreenBufferSet x; return x; }		//!< every screen, for returnCellForCluster()
+My_ScreenReferenceTable&		gScreenRefLocks ()			{ static My_ScreenReferenceTable x; return x; }
 
 } // anonymous namespace
 
@@ -1889,7 +1868,10 @@ Terminal_NewScreen	(Preferences_ContextRef		inTerminalConfig,
 		
 		try
 		{
-			*outScreenPtr = REINTERPRET_CAST(new My_ScreenBuffer(inTerminalConfig, inTranslationConfig), TerminalScreenRef);
+			My_ScreenBufferPtr		ptr = new My_ScreenBuffer(inTerminalConfig, inTranslationConfig);
+			
+			
+			*outScreenPtr = ptr->selfRef;
 		}
 		catch (std::bad_alloc)
 		{
@@ -2175,6 +2157,32 @@ Terminal_BellIsEnabled		(TerminalScreenRef	inRef)
 }// BellIsEnabled
 
 
+/*!
+Returns "true" only if the application running in the given
+terminal has requested bracketed-paste mode (with the XTerm
+sequence ESC [ ? 2004 h).  In this mode, pasted text should
+be preceded by ESC [ 200 ~ and followed by ESC [ 201 ~ so
+that the application can tell it apart from typed input.
+
+See Session_UserInputPaste().
+
+(2017.10)
+*/
+Boolean
+Terminal_BracketedPasteIsEnabled	(TerminalScreenRef	inRef)
+{
+	My_ScreenBufferPtr	dataPtr = getVirtualScreenData(inRef);
+	Boolean				result = false;
+	
+	
+	if (dataPtr != nullptr)
+	{
+		result = dataPtr->modeBracketedPaste;
+	}
+	return result;
+}// BracketedPasteIsEnabled
+
+
 /*!
 Applies the specified changes to every single attribute
 for a single line of the screen buffer (no effect on
@@ -2415,6 +2423,162 @@ Terminal_ChangeRangeAttributes	(TerminalScreenRef			inRef,
 }// ChangeRangeAttributes
 
 
+/*!
+Exports the given range of text from the specified terminal
+screen in UTF-8 encoding, without creating any intermediate
+string objects.  Text is accumulated into a large internal
+buffer and the sink is invoked only when that buffer fills
+up (and once more at the end), so this is suitable for very
+large ranges such as an entire scrollback buffer.
+
+The start row iterator is not modified; the range begins at
+the row it refers to and continues for the given number of
+rows (stopping early at the end of the screen).
+
+If "kTerminal_TextCopyFlagsRectangular" is set, or the range
+contains only one row, the column range applies to every row.
+Otherwise, the start column only applies to the first row and
+the past-end column only applies to the last row, so that the
+rows in between are exported from margin to margin.
+
+If a nonzero number of spaces is given, every series of that
+many consecutive spaces (and any shorter remainder) becomes a
+single tab character.
+
+Unless "kTerminal_TextCopyFlagsAlwaysNewLineAtRightMargin" is
+set, no line separator follows a row whose range reaches the
+right margin when the character there is not whitespace (as
+that row was probably wrapped onto the next one).
+
+\retval kTerminal_ResultOK
+if the text was exported successfully
+
+\retval kTerminal_ResultInvalidID
+if the specified screen reference is invalid
+
+\retval kTerminal_ResultInvalidIterator
+if the specified row reference is invalid
+
+\retval kTerminal_ResultParameterError
+if the sink is not defined, or the sink aborted the export
+
+(2017.10)
+*/
+Terminal_Result
+Terminal_CopyRangeToSink	(TerminalScreenRef			inRef,
+							 Terminal_LineRef			inStartRow,
+							 UInt32						inNumberOfRowsToConsider,
+							 UInt16						inZeroBasedStartColumn,
+							 SInt16						inZeroBasedPastEndColumnOrNegativeForLastColumn,
+							 Terminal_TextCopyFlags		inFlags,
+							 UInt16						inMaxSpacesToReplaceWithTabOrZero,
+							 Terminal_TextSinkProcPtr	inSink,
+							 void*						inSinkContextPtr)
+{
+	Terminal_Result				result = kTerminal_ResultOK;
+	My_ScreenBufferConstPtr		dataPtr = getVirtualScreenData(inRef);
+	My_LineIteratorPtr			iteratorPtr = getLineIterator(inStartRow);
+	
+	
+	if (nullptr == dataPtr) result = kTerminal_ResultInvalidID;
+	else if (nullptr == iteratorPtr) result = kTerminal_ResultInvalidIterator;
+	else if (nullptr == inSink) result = kTerminal_ResultParameterError;
+	else
+	{
+		size_t const			kChunkSize = 65536; // arbitrary; large enough that the sink is rarely invoked
+		UInt16 const			kColumnCount = dataPtr->text.visibleScreen.numberOfColumnsPermitted;
+		UInt16 const			kPastEndColumn = (inZeroBasedPastEndColumnOrNegativeForLastColumn < 0)
+													? kColumnCount
+													: std::min(STATIC_CAST(inZeroBasedPastEndColumnOrNegativeForLastColumn, UInt16),
+																kColumnCount);
+		Boolean const			kIsRectangular = ((0 != (inFlags & kTerminal_TextCopyFlagsRectangular)) ||
+													(1 == inNumberOfRowsToConsider));
+		UInt8 const				kLineSeparator = (inFlags & kTerminal_TextCopyFlagsLineSeparatorLF) ? '\012' : '\015';
+		My_LineIterator			lineIterator(*iteratorPtr); // copy, so that the caller’s iterator does not move
+		std::vector< UInt8 >	chunk(kChunkSize);
+		size_t					chunkLength = 0;
+		Boolean					isEnd = false;
+		
+		
+		for (UInt32 i = 0; ((i < inNumberOfRowsToConsider) && (false == isEnd)); ++i)
+		{
+			My_ScreenBufferLine const&	kLine = lineIterator.currentLine();
+			Boolean const				kIsLastRow = ((inNumberOfRowsToConsider - 1) == i);
+			size_t const				kLineStart = (kIsRectangular || (0 == i)) ? inZeroBasedStartColumn : 0;
+			size_t const				kLinePastEnd = std::min((kIsRectangular || kIsLastRow)
+																	? STATIC_CAST(kPastEndColumn, size_t)
+																	: STATIC_CAST(kColumnCount, size_t),
+																kLine.textVectorSize);
+			UniChar const*				textBegin = kLine.textVectorBegin + std::min(kLineStart, kLinePastEnd);
+			UniChar const*				textPastEnd = kLine.textVectorBegin + kLinePastEnd;
+			
+			
+			if (inFlags & kTerminal_TextCopyFlagsNoEndWhitespace)
+			{
+				// LOCALIZE THIS
+				while ((textPastEnd != textBegin) && (*(textPastEnd - 1) <= 0x7F) && std::isspace(*(textPastEnd - 1)))
+				{
+					--textPastEnd;
+				}
+			}
+			
+			// a UTF-16 unit never requires more than 3 bytes in UTF-8 (surrogate
+			// pairs require 4 bytes for 2 units) and a cell refers to at most
+			// one cluster, plus one byte is needed for the new-line; if that
+			// worst case might not fit, hand off the buffer first
+			if ((chunkLength + (3 * kTerminalLine_MaximumClusterLength * (textPastEnd - textBegin)) + 1) > kChunkSize)
+			{
+				if (false == Terminal_InvokeTextSinkProc(inSink, &chunk[0], chunkLength, inSinkContextPtr))
+				{
+					result = kTerminal_ResultParameterError;
+					break;
+				}
+				chunkLength = 0;
+			}
+			
+			chunkLength += appendUTF8ForCharacters(textBegin, textPastEnd, inMaxSpacesToReplaceWithTabOrZero, &chunk[chunkLength]);
+			
+			if ((0 == (inFlags & kTerminal_TextCopyFlagsInline)) &&
+				((false == kIsLastRow) || (inFlags & kTerminal_TextCopyFlagsLastLineHasSeparator)))
+			{
+				Boolean		skipSeparator = false;
+				
+				
+				if ((0 == (inFlags & kTerminal_TextCopyFlagsAlwaysNewLineAtRightMargin)) &&
+					(kColumnCount > 0) && (kColumnCount == kLinePastEnd))
+				{
+					UniChar const	kMarginCharacter = kLine.textVectorBegin[kColumnCount - 1];
+					
+					
+					// LOCALIZE THIS
+					skipSeparator = ((kMarginCharacter > 0x7F) || (false == std::isspace(kMarginCharacter)));
+				}
+				
+				unless (skipSeparator)
+				{
+					chunk[chunkLength++] = kLineSeparator;
+				}
+			}
+			
+			if (false == kIsLastRow)
+			{
+				UNUSED_RETURN(My_ScreenBufferLine&)lineIterator.goToNextLine(isEnd);
+			}
+		}
+		
+		if ((kTerminal_ResultOK == result) && (chunkLength > 0))
+		{
+			if (false == Terminal_InvokeTextSinkProc(inSink, &chunk[0], chunkLength, inSinkContextPtr))
+			{
+				result = kTerminal_ResultParameterError;
+			}
+		}
+	}
+	
+	return result;
+}// CopyRangeToSink
+
+
 /*!
 Returns the title assigned to the iconified version of this
 terminal.  In MacTerm this is symbolic, as no assumption is
@@ -2468,6 +2632,34 @@ Terminal_CopyTitleForWindow		(TerminalScreenRef	inRef,
 }// CopyTitleForWindow
 
 
+/*!
+Returns the POSIX path of the directory most recently reported
+by the running program through an “ESC]7;file://host/path”
+sequence (which many shells send before each prompt).  If no
+local directory has been reported, the result is nullptr; in
+that case, a process query is the only way to find the value
+(see Session_ReturnCachedWorkingDirectory()).
+
+IMPORTANT:	You must eventually use CFRelease() on the returned
+			string.
+
+(2017.10)
+*/
+void
+Terminal_CopyWorkingDirectory	(TerminalScreenRef	inRef,
+								 CFStringRef&		outPOSIXPath)
+{
+	My_ScreenBufferPtr		dataPtr = getVirtualScreenData(inRef);
+	
+	
+	outPOSIXPath = dataPtr->workingDirectoryCFString.returnCFStringRef();
+	if (outPOSIXPath != nullptr)
+	{
+		CFRetain(outPOSIXPath);
+	}
+}// CopyWorkingDirectory
+
+
 /*!
 Creates a data descriptor or object specifier that describes
 the given range of text in the given terminal screen.
@@ -2479,6 +2671,10 @@ negative number, the bottommost line of the visible screen
 is one less than the number of rows high that the terminal
 screen is.
 
+The descriptor has type "typeUnicodeText" (UTF-16 in native
+byte order), as it always has; the text is only gathered as
+UTF-8 and converted once at the end.
+
 IMPORTANT:	Currently this performs text duplication, when in
 			fact a smarter approach would probably be to “copy
 			on write” and otherwise return a light-weight
@@ -2492,37 +2688,45 @@ Terminal_CreateContentsAEDesc	(TerminalScreenRef		inRef,
 								 UInt32					inNumberOfRowsToConsider,
 								 AEDesc*				outDescPtr)
 {
-	OSStatus	result = noErr;
-	CFIndex		totalLength = 0L;
+	OSStatus			result = noErr;
+	CFRetainRelease		bufferData(CFDataCreateMutable(kCFAllocatorDefault, 0/* capacity, or zero for no limit */),
+									CFRetainRelease::kAlreadyRetained);
 	
 	
-	if (kTerminal_ResultOK != forEachLineDo(inRef, inStartRow, inNumberOfRowsToConsider, addScreenLineLength, &totalLength))
-	{
-		result = memFullErr;
-	}
+	if (false == bufferData.exists()) result = memFullErr;
 	else
 	{
-		UniChar*			buffer = new UniChar[totalLength];
-		CFRetainRelease		mutableCFString(CFStringCreateMutableWithExternalCharactersNoCopy
-											(kCFAllocatorDefault, buffer, totalLength, totalLength/* capacity */,
-												kCFAllocatorNull/* reallocator */),
-											CFRetainRelease::kAlreadyRetained);
+		CFMutableDataRef	asMutableData = bufferData.returnCFMutableDataRef();
 		
 		
-		if (false == mutableCFString.exists()) result = memFullErr;
+		if (kTerminal_ResultOK != Terminal_CopyRangeToSink(inRef, inStartRow, inNumberOfRowsToConsider,
+															0/* start column */, -1/* past-end column; negative means “very end” */,
+															kTerminal_TextCopyFlagsInline, 0/* spaces per tab */,
+															Terminal_TextSinkToCFMutableData, asMutableData))
+		{
+			// No data?  Out of memory!
+			result = memFullErr;
+		}
 		else
 		{
-			if (kTerminal_ResultOK != forEachLineDo(inRef, inStartRow, inNumberOfRowsToConsider,
-													appendScreenLineRawToCFString, mutableCFString.returnCFMutableStringRef()))
+			CFRetainRelease		asString(CFStringCreateWithBytes(kCFAllocatorDefault, CFDataGetBytePtr(asMutableData),
+																	CFDataGetLength(asMutableData), kCFStringEncodingUTF8,
+																	false/* is external representation */),
+											CFRetainRelease::kAlreadyRetained);
+			
+			
+			if (false == asString.exists()) result = memFullErr;
+			else
 			{
-				// No data?  Out of memory!
-				result = memFullErr;
+				CFStringRef				stringRef = asString.returnCFStringRef();
+				CFIndex const			kLength = CFStringGetLength(stringRef);
+				std::vector< UniChar >	characters(std::max(kLength, STATIC_CAST(1, CFIndex)));
+				
+				
+				CFStringGetCharacters(stringRef, CFRangeMake(0, kLength), &characters[0]);
+				result = AECreateDesc(typeUnicodeText, &characters[0], kLength * sizeof(UniChar), outDescPtr);
 			}
-			else result = AECreateDesc(typeUnicodeText, buffer,
-										CFStringGetLength(mutableCFString.returnCFMutableStringRef()) * sizeof(UniChar),
-										outDescPtr);
 		}
-		delete [] buffer;
 	}
 	
 	return result;
@@ -2634,6 +2838,7 @@ Terminal_DebugDumpDetailedSnapshot		(TerminalScreenRef		inRef)
 	Console_WriteValuePair("Current scrolling region first and last rows", dataPtr->originRegionPtr->firstRow,
 																			dataPtr->originRegionPtr->lastRow);
 	Console_WriteValue("Mode: auto-wrap", dataPtr->modeAutoWrap);
+	Console_WriteValue("Mode: bracketed paste", dataPtr->modeBracketedPaste);
 	Console_WriteValue("Mode: cursor keys for application", dataPtr->modeCursorKeysForApp);
 	Console_WriteValue("Mode: application keys", dataPtr->modeApplicationKeys);
 	Console_WriteValue("Mode: origin redefined", dataPtr->modeOriginRedefined);
@@ -3021,6 +3226,11 @@ Terminal_EmulatorProcessData	(TerminalScreenRef	inRef,
 									{
 										interrupt = (dataPtr->emulator.stateRepetitions > 255/* arbitrary */);
 									}
+									else if (states.second == My_XTermCore::kStateCWDAcquireStr)
+									{
+										// percent-encoded paths can be quite long
+										interrupt = (dataPtr->emulator.stateRepetitions > 4096/* arbitrary */);
+									}
 								}
 								
 								if (interrupt)
@@ -3592,7 +3802,8 @@ Terminal_ForEachLikeAttributeRunDo	(TerminalScreenRef			inRef,
 				++textIterator, ++attrIterator, ++characterIndex)
 		{
 			currentAttributes = *attrIterator;
-			if ((currentAttributes != previousAttributes) ||
+			if (((currentAttributes != previousAttributes) &&
+					(kTerminalLine_WidePaddingCell != *textIterator)/* never split a double-width character */) ||
 				(characterIndex == STATIC_CAST(currentLine.textVectorSize - 1, SInt16)) ||
 				(characterIndex == STATIC_CAST(currentAttributeVector.size() - 1, SInt16)))
 			{
@@ -3603,9 +3814,7 @@ Terminal_ForEachLikeAttributeRunDo	(TerminalScreenRef			inRef,
 				{
 					TextAttributes_Object		rangeAttributes = previousAttributes;
 					NSRange						runRange = NSMakeRange(runStartCharacterIndex, styleRunLength);
-					CFStringRef					lineAsCFString = currentLine.textCFString.returnCFStringRef();
-					NSString*					lineAsNSString = BRIDGE_CAST(lineAsCFString, NSString*);
-					NSString*					styleRunSubstring = [lineAsNSString substringWithRange:runRange];
+					NSString*					styleRunSubstring = stringForCells(currentLine, runRange);
 					
 					
 					rangeAttributes.addAttributes(currentLine.returnGlobalAttributes());
@@ -3798,6 +4007,35 @@ Terminal_GetLineRange	(TerminalScreenRef			inScreen,
 }// GetLineRange
 
 
+/*!
+Copies the running activity totals of the specified screen,
+such as the number of characters echoed.  The totals are
+maintained unconditionally, since they cost only an addition
+on paths that already do far more work.
+
+\retval kTerminal_ResultOK
+if the statistics are returned successfully
+
+\retval kTerminal_ResultInvalidID
+if the specified screen reference is not valid
+
+(2017.10)
+*/
+Terminal_Result
+Terminal_GetStatistics	(TerminalScreenRef		inRef,
+						 Terminal_Statistics&	outStatistics)
+{
+	My_ScreenBufferConstPtr		dataPtr = getVirtualScreenData(inRef);
+	Terminal_Result				result = kTerminal_ResultOK;
+	
+	
+	if (nullptr == dataPtr) result = kTerminal_ResultInvalidID;
+	else outStatistics = dataPtr->statistics;
+	
+	return result;
+}// GetStatistics
+
+
 /*!
 Returns true only if the most recent check of the raw
 terminal device showed that it was not echoing (e.g.
@@ -3828,17 +4066,19 @@ Returns "true" only if the specified terminal screen has
 not been destroyed with Terminal_ReleaseScreen(), and is
 not in the process of being destroyed.
 
-Most of the time, checking for a null reference is enough,
-and efficient; this check may be slower, but is important
-if you are handling something indirectly or asynchronously
-(where a terminal could have been destroyed at any time).
+Most of the time, checking for a null reference is enough;
+this check is important if you are handling something
+indirectly or asynchronously (where a terminal could have
+been destroyed at any time).  It is a constant-time check
+of the reference’s generation, and it works even after the
+same storage has been reused by a newer terminal.
 
 (4.1)
 */
 Boolean
 Terminal_IsValid        (TerminalScreenRef      inRef)
 {
-	Boolean		result = ((nullptr != inRef) && (gTerminalScreenValidRefs().find(inRef) != gTerminalScreenValidRefs().end()));
+	Boolean		result = gScreenRefLocks().isValid(inRef);
 	
 	
 	return result;
@@ -4974,6 +5214,67 @@ Terminal_StopMonitoring		(TerminalScreenRef			inRef,
 }// StopMonitoring
 
 
+/*!
+A method of standard Terminal_TextSinkProcPtr form, this
+routine appends exported text to the CFMutableDataRef that
+is given as the context.
+
+(2017.10)
+*/
+Boolean
+Terminal_TextSinkToCFMutableData	(UInt8 const*		inUTF8Bytes,
+									 size_t				inByteCount,
+									 void*				inCFMutableDataRef)
+{
+	CFMutableDataRef	mutableData = REINTERPRET_CAST(inCFMutableDataRef, CFMutableDataRef);
+	
+	
+	CFDataAppendBytes(mutableData, inUTF8Bytes, STATIC_CAST(inByteCount, CFIndex));
+	return true;
+}// TextSinkToCFMutableData
+
+
+/*!
+A method of standard Terminal_TextSinkProcPtr form, this
+routine writes exported text to the open file descriptor
+that is pointed to by the context.  Partial writes are
+retried, and the export is aborted if a write fails.
+
+(2017.10)
+*/
+Boolean
+Terminal_TextSinkToFileDescriptor	(UInt8 const*		inUTF8Bytes,
+									 size_t				inByteCount,
+									 void*				inFileDescriptorPtr)
+{
+	int const*		fileDescriptorPtr = REINTERPRET_CAST(inFileDescriptorPtr, int const*);
+	size_t			bytesLeft = inByteCount;
+	Boolean			result = true;
+	
+	
+	while (bytesLeft > 0)
+	{
+		ssize_t		bytesWritten = write(*fileDescriptorPtr, inUTF8Bytes + (inByteCount - bytesLeft), bytesLeft);
+		
+		
+		if (bytesWritten < 0)
+		{
+			if (EINTR != errno)
+			{
+				Console_Warning(Console_WriteValue, "failed to write exported text, errno", errno);
+				result = false;
+				break;
+			}
+		}
+		else
+		{
+			bytesLeft -= bytesWritten;
+		}
+	}
+	return result;
+}// TextSinkToFileDescriptor
+
+
 /*!
 Returns the red, green and blue intensity fractions for
 the given “true” color, which is defined whenever a
@@ -5808,6 +6109,7 @@ currentState(kMy_ParserStateInitial),
 stringAccumulatorState(kMy_ParserStateInitial),
 stringAccumulator(),
 multiByteDecoder(),
+echoDecoder(nullptr), // set later
 stateRepetitions(0),
 argLastIndex(0),
 argList(kMy_MaximumANSIParameters),
@@ -5844,6 +6146,7 @@ My_Emulator::~My_Emulator()
 	delete trueColorTableReds;
 	delete trueColorTableGreens;
 	delete trueColorTableBlues;
+	TextTranslation_DisposeDecoder(&echoDecoder);
 }// My_Emulator destructor
 
 
@@ -6476,7 +6779,7 @@ My_ScreenBuffer	(Preferences_ContextRef		inTerminalConfig,
 				 Preferences_ContextRef		inTranslationConfig)
 :
 // IMPORTANT: THESE ARE EXECUTED IN THE ORDER MEMBERS APPEAR IN THE CLASS.
-refValidator(REINTERPRET_CAST(this, TerminalScreenRef), gTerminalScreenValidRefs()),
+refValidator(this, gScreenRefLocks()),
 configuration(Preferences_NewCloneContext(inTerminalConfig, true/* detach */),
 				Preferences_ContextWrap::kAlreadyRetained),
 emulator(returnEmulator(inTerminalConfig), returnAnswerBackMessage(inTerminalConfig), returnTextEncoding(inTranslationConfig)),
@@ -6484,6 +6787,7 @@ listeningSession(nullptr),
 speaker(nullptr),
 windowTitleCFString(),
 iconTitleCFString(),
+workingDirectoryCFString(),
 changeListenerModel(ListenerModel_New(kListenerModel_StyleStandard, kConstantsRegistry_ListenerModelDescriptorTerminalChanges)),
 preferenceMonitor(ListenerModel_NewStandardListener(preferenceChanged, this/* context */),
 					ListenerModel_ListenerWrap::kAlreadyRetained),
@@ -6491,9 +6795,11 @@ scrollbackBufferCachedSize(0),
 scrollbackBuffer(),
 screenBuffer(),
 bytesToEcho(),
+charactersToEcho(),
 echoErrorCount(0),
 translationErrorCount(0),
 errorCountTotal(0),
+statistics(),
 tabSettings(),
 captureStream(StreamCapture_New(returnLineEndings())),
 printingStream(nullptr),
@@ -6520,6 +6826,7 @@ wrapPending(false),
 modeANSIEnabled(true),
 modeApplicationKeys(false),
 modeAutoWrap(false),
+modeBracketedPaste(false),
 modeCursorKeysForApp(false),
 modeInsertNotReplace(false),
 modeNewLineOption(false),
@@ -6528,7 +6835,7 @@ originRegionPtr(&visibleBoundary.rows),
 // speech elements - not initialized
 current(*this),
 // previous elements - not initialized
-selfRef(REINTERPRET_CAST(this, TerminalScreenRef))
+selfRef(refValidator.returnReference())
 // TEMPORARY: initialize other members here...
 {
 	this->text.visibleScreen.numberOfColumnsAllocated = Terminal_ReturnAllocatedColumnCount(); // always allocate max columns
@@ -6630,7 +6937,7 @@ selfRef(REINTERPRET_CAST(this, TerminalScreenRef))
 	this->customScrollingRegion = this->visibleBoundary.rows; // initially...
 	assertScrollingRegion(this);
 	
-	this->speaker = TerminalSpeaker_New(REINTERPRET_CAST(this, TerminalScreenRef));
+	this->speaker = TerminalSpeaker_New(this->selfRef);
 	
 	{
 		Preferences_Result		prefsResult = kPreferences_ResultOK;
@@ -6644,6 +6951,8 @@ selfRef(REINTERPRET_CAST(this, TerminalScreenRef))
 		}
 	}
 	
+	gScreenBuffers().insert(this);
+	
 	assert(Terminal_IsValid(this->selfRef));
 	//Console_WriteValueAddress("validated screen", this);
 }// My_ScreenBuffer 1-argument constructor
@@ -6675,6 +6984,7 @@ My_ScreenBuffer::
 	TerminalSpeaker_Dispose(&this->speaker);
 	ListenerModel_Dispose(&this->changeListenerModel);
 	
+	gScreenBuffers().erase(this);
 	for (My_ScreenBufferLinePtr& linePtrRef : this->scrollbackBuffer)
 	{
 		deleteLinePtr(linePtrRef);
@@ -7166,20 +7476,28 @@ echoData	(My_ScreenBufferPtr		inDataPtr,
 	
 	if (inLength > 0)
 	{
-		CFIndex				bytesRequired = 0;
-		CFRetainRelease		bufferAsCFString(TextTranslation_PersistentCFStringCreate
-												(kCFAllocatorDefault, inBuffer, inLength, inDataPtr->emulator.inputTextEncoding,
-													false/* is external representation */, bytesRequired, inLength/* maximum trim/repeat */),
-												CFRetainRelease::kAlreadyRetained);
+		My_Emulator&		emulator = inDataPtr->emulator;
+		CFRetainRelease		bufferAsCFString;
 		
 		
-		if (false == bufferAsCFString.exists())
+		// the decoder consumes every byte, holding the start of any
+		// character that is split across buffers until the rest of
+		// it arrives (so the result is always the entire length)
+		if (emulator.inputTextEncoding != TextTranslation_DecoderReturnEncoding(emulator.echoDecoder))
 		{
-			// TEMPORARY: this should probably be handled better
-			++(inDataPtr->translationErrorCount);
-			result = 0;
+			TextTranslation_DisposeDecoder(&emulator.echoDecoder);
+			emulator.echoDecoder = TextTranslation_NewDecoder(emulator.inputTextEncoding);
 		}
-		else
+		inDataPtr->charactersToEcho.clear();
+		inDataPtr->translationErrorCount += TextTranslation_DecoderAppendCharacters(emulator.echoDecoder, inBuffer, inLength,
+																					inDataPtr->charactersToEcho);
+		if (false == inDataPtr->charactersToEcho.empty())
+		{
+			bufferAsCFString.setWithNoRetain(CFStringCreateWithCharacters(kCFAllocatorDefault, &inDataPtr->charactersToEcho[0],
+																			inDataPtr->charactersToEcho.size()));
+		}
+		
+		if (bufferAsCFString.exists())
 		{
 			// send the data wherever it needs to go
 			echoCFString(inDataPtr, bufferAsCFString.returnCFStringRef());
@@ -8020,6 +8338,10 @@ stateDeterminant	(My_EmulatorPtr			inEmulatorPtr,
 				inNowOutNext.second = kMy_ParserStateSeenESCRightSqBracket4;
 				break;
 			
+			case '7':
+				inNowOutNext.second = kMy_ParserStateSeenESCRightSqBracket7;
+				break;
+			
 			default:
 				inNowOutNext.second = kDefaultNextState;
 				result = 0; // do not absorb the unknown
@@ -8097,6 +8419,20 @@ stateDeterminant	(My_EmulatorPtr			inEmulatorPtr,
 			}
 			break;
 		
+		case kMy_ParserStateSeenESCRightSqBracket7:
+			switch (kTriggerChar)
+			{
+			case ';':
+				inNowOutNext.second = kMy_ParserStateSeenESCRightSqBracket7Semi;
+				break;
+			
+			default:
+				inNowOutNext.second = kDefaultNextState;
+				result = 0; // do not absorb the unknown
+				break;
+			}
+			break;
+		
 		case kMy_ParserStateSeenESCPound:
 			switch (kTriggerChar)
 			{
@@ -9060,6 +9396,10 @@ modeSetReset	(My_ScreenBufferPtr		inDataPtr,
 					if (false == inIsModeEnabled) inDataPtr->wrapPending = false;
 					break;
 				
+				case 2004: // XTerm bracketed-paste mode
+					inDataPtr->modeBracketedPaste = inIsModeEnabled;
+					break;
+				
 				case 4: // DECSCLM (if enabled, scrolling is smooth at 6 lines per second; otherwise, instantaneous)
 				case 8: // DECARM (auto-repeating)
 				case 9: // DECINLM (interlace)
@@ -13098,6 +13438,27 @@ stateDeterminant	(My_EmulatorPtr			inEmulatorPtr,
 		}
 		break;
 	
+	case kStateCWDAcquireStr:
+		// working directory notifications do not affect the display
+		// so they are accepted regardless of the XTerm variant flags
+		switch (kTriggerChar)
+		{
+		case '\007':
+			inNowOutNext.second = kStateStringTerminator;
+			break;
+		
+		case '\033':
+			inNowOutNext.second = kMy_ParserStateSeenESC;
+			break;
+		
+		default:
+			// continue extending the string until a known terminator is found
+			inNowOutNext.second = kStateCWDAcquireStr;
+			result = 0; // do not absorb the unknown
+			break;
+		}
+		break;
+	
 	case kStateColorAcquireStr:
 		if (inEmulatorPtr->supportsVariant(My_Emulator::kVariantFlagXTerm256Color))
 		{
@@ -13175,6 +13536,7 @@ stateTransition		(My_ScreenBufferPtr			inDataPtr,
 	case kStateSIT:
 	case kStateSWT:
 	case kStateSetColor:
+	case kStateSetCWD:
 		inDataPtr->emulator.stringAccumulator.clear();
 		inDataPtr->emulator.stringAccumulatorState = inOldNew.second;
 		break;
@@ -13183,6 +13545,7 @@ stateTransition		(My_ScreenBufferPtr			inDataPtr,
 	case kStateSITAcquireStr:
 	case kStateSWTAcquireStr:
 	case kStateColorAcquireStr:
+	case kStateCWDAcquireStr:
 		// upon first entry to the state, ignore the code point (semicolon)
 		// that caused the state to be selected; only accumulate code points
 		// that occurred while the previous state was also accumulating
@@ -13299,6 +13662,27 @@ stateTransition		(My_ScreenBufferPtr			inDataPtr,
 			}
 			break;
 		
+		case kStateSetCWD:
+			{
+				// the accumulated string should be a URL of the form
+				// "file://host/path" with percent-encoded path bytes
+				CFRetainRelease		directoryCFString(copyLocalPathForWorkingDirectoryURL(inDataPtr->emulator.stringAccumulator),
+														CFRetainRelease::kAlreadyRetained);
+				
+				
+				if (directoryCFString.exists())
+				{
+					if ((false == inDataPtr->workingDirectoryCFString.exists()) ||
+						(kCFCompareEqualTo != CFStringCompare(directoryCFString.returnCFStringRef(),
+																inDataPtr->workingDirectoryCFString.returnCFStringRef(), 0/* options */)))
+					{
+						inDataPtr->workingDirectoryCFString = directoryCFString;
+						changeNotifyForTerminal(inDataPtr, kTerminal_ChangeWorkingDirectory, inDataPtr->selfRef/* context */);
+					}
+				}
+			}
+			break;
+		
 		default:
 			// ignore
 			outHandled = false;
@@ -13322,55 +13706,102 @@ stateTransition		(My_ScreenBufferPtr			inDataPtr,
 
 
 /*!
-A method of standard My_ScreenLineOperationProcPtr form,
-this routine adds the length of the specified line of
-text to an overall sum, pointed to by "inoutLengthPtr"
-(assumed to be a CFIndex*).
+Writes the UTF-8 encoding of the given range of cells to the
+specified buffer, and returns the number of bytes that were
+written.  The buffer must have room for at least 3 bytes per
+UTF-16 unit of the longest cluster (that is, 3 times
+"kTerminalLine_MaximumClusterLength") for every cell in the
+range.
 
-Since this operation never modifies the buffer, "false"
-is always returned.
+Cells that refer to clusters are written as the complete
+cluster, and the right halves of double-width characters are
+skipped; a reference to an unknown cluster is written as the
+same error character that is used by the UTF-8 decoder.  If a
+nonzero number of
+spaces is given, each series of consecutive spaces is written
+as one tab for every group of that many spaces (rounded up).
 
-(3.0)
+(2017.10)
 */
-void
-addScreenLineLength		(My_ScreenBufferPtr		UNUSED_ARGUMENT(inRef),
-						 CFMutableStringRef		inLineTextBuffer,
-						 UInt32					UNUSED_ARGUMENT(inOneBasedLineNumber),
-						 void*					inoutLengthPtr)
+size_t
+appendUTF8ForCharacters		(UniChar const*		inBegin,
+							 UniChar const*		inPastEnd,
+							 UInt16				inMaxSpacesToReplaceWithTabOrZero,
+							 UInt8*				outBytes)
 {
-	CFIndex*	sumPtr = REINTERPRET_CAST(inoutLengthPtr, CFIndex*);
+	UInt8*		outPtr = outBytes;
 	
 	
-	(*sumPtr) += (CFStringGetLength(inLineTextBuffer) + 1/* for newline */);
-}// addScreenLineLength
-
-
-/*!
-A method of standard My_ScreenLineOperationProcPtr form,
-this routine adds the data from the specified line text
-buffer to a CFMutableStringRef, pointed to by
-"inoutCFMutableStringRef".
-
-This is a “raw” append, there is no new-line or other
-delimiter between appended lines.
-
-Currently, this routine is somewhat naïve, but in the
-future it will do its best to express the actual rendered
-content of the line in Unicode.
-
-(3.1)
-*/
-void
-appendScreenLineRawToCFString	(My_ScreenBufferPtr		UNUSED_ARGUMENT(inRef),
-								 CFMutableStringRef		inLineTextBuffer,
-								 UInt32					UNUSED_ARGUMENT(inOneBasedLineNumber),
-								 void*					inoutCFMutableStringRef)
-{
-	CFMutableStringRef	mutableCFString = REINTERPRET_CAST(inoutCFMutableStringRef, CFMutableStringRef);
-	
-	
-	CFStringAppend(mutableCFString, inLineTextBuffer);
-}// appendScreenLineRawToCFString
+	for (UniChar const* ptr = inBegin; ptr != inPastEnd; ++ptr)
+	{
+		UnicodeScalarValue		codePoint = *ptr;
+		
+		
+		if ((' ' == codePoint) && (inMaxSpacesToReplaceWithTabOrZero > 0))
+		{
+			UniChar const*		spacesPastEnd = ptr;
+			size_t				spaceCount = 0;
+			
+			
+			while ((spacesPastEnd != inPastEnd) && (' ' == *spacesPastEnd))
+			{
+				++spacesPastEnd;
+			}
+			spaceCount = (spacesPastEnd - ptr);
+			for (size_t i = 0; i < spaceCount; i += inMaxSpacesToReplaceWithTabOrZero)
+			{
+				*outPtr++ = '\011';
+			}
+			ptr = spacesPastEnd - 1;
+		}
+		else if (codePoint <= 0x7F)
+		{
+			*outPtr++ = STATIC_CAST(codePoint, UInt8);
+		}
+		else if (codePoint <= 0x07FF)
+		{
+			*outPtr++ = STATIC_CAST(0xC0 | (codePoint >> 6), UInt8);
+			*outPtr++ = STATIC_CAST(0x80 | (codePoint & 0x3F), UInt8);
+		}
+		else if (kTerminalLine_WidePaddingCell == codePoint)
+		{
+			// the character to the left already represents this column
+		}
+		else if (TerminalLine_IsSpecialCell(*ptr))
+		{
+			CFRetainRelease		clusterCFString(TerminalLine_CopyClusterForCell(*ptr), CFRetainRelease::kAlreadyRetained);
+			
+			
+			if (clusterCFString.exists())
+			{
+				CFIndex const	kMaximumBytes = 3 * kTerminalLine_MaximumClusterLength;
+				CFIndex			bytesUsed = 0;
+				
+				
+				UNUSED_RETURN(CFIndex)CFStringGetBytes(clusterCFString.returnCFStringRef(),
+														CFRangeMake(0, CFStringGetLength(clusterCFString.returnCFStringRef())),
+														kCFStringEncodingUTF8, '?'/* loss byte */, false/* is external representation */,
+														outPtr, kMaximumBytes, &bytesUsed);
+				outPtr += bytesUsed;
+			}
+			else
+			{
+				UTF8Decoder_ByteString		errorBytes;
+				
+				
+				UTF8Decoder_StateMachine::appendErrorCharacter(errorBytes);
+				outPtr = std::copy(errorBytes.begin(), errorBytes.end(), outPtr);
+			}
+		}
+		else
+		{
+			*outPtr++ = STATIC_CAST(0xE0 | (codePoint >> 12), UInt8);
+			*outPtr++ = STATIC_CAST(0x80 | ((codePoint >> 6) & 0x3F), UInt8);
+			*outPtr++ = STATIC_CAST(0x80 | (codePoint & 0x3F), UInt8);
+		}
+	}
+	return (outPtr - outBytes);
+}// appendUTF8ForCharacters
 
 
 /*!
@@ -14453,6 +14884,195 @@ changeNotifyForTerminal		(My_ScreenBufferConstPtr	inPtr,
 }// changeNotifyForTerminal
 
 
+/*!
+Prepares to write to one column of a line by making sure
+that no double-width character will be left half-overwritten:
+if the column holds either half of such a character, the other
+half becomes a blank space.  NO update events are sent.
+
+(2017.10)
+*/
+void
+clearWideCharacterAtColumn	(My_ScreenBufferLine&	inRow,
+							 UInt16					inColumn)
+{
+	if (inColumn < inRow.textVectorSize)
+	{
+		if ((kTerminalLine_WidePaddingCell == inRow.textVectorBegin[inColumn]) && (inColumn > 0))
+		{
+			inRow.textVectorBegin[inColumn - 1] = ' ';
+		}
+		if (((inColumn + 1U) < inRow.textVectorSize) && (kTerminalLine_WidePaddingCell == inRow.textVectorBegin[inColumn + 1]))
+		{
+			inRow.textVectorBegin[inColumn + 1] = ' ';
+		}
+	}
+}// clearWideCharacterAtColumn
+
+
+/*!
+Parses the string given in an “ESC]7;...” sequence, which is a
+URL such as “file://host/path%20name”, and returns the decoded
+POSIX path.  Returns nullptr if the URL cannot be parsed, does
+not use the “file” scheme, or refers to a host other than this
+computer (as happens when a shell on a remote machine reports
+its directory through an SSH session).
+
+The caller must CFRelease() any non-nullptr result.
+
+(2017.10)
+*/
+CFStringRef
+copyLocalPathForWorkingDirectoryURL		(std::string const&		inURLString)
+{
+	CFStringRef		result = nullptr;
+	CFRetainRelease	urlObject(CFURLCreateWithBytes(kCFAllocatorDefault, REINTERPRET_CAST(inURLString.data(), UInt8 const*),
+													inURLString.size(), kCFStringEncodingUTF8, nullptr/* base URL */),
+								CFRetainRelease::kAlreadyRetained);
+	
+	
+	if (urlObject.exists())
+	{
+		CFURLRef			asURL = urlObject.returnCFURLRef();
+		CFRetainRelease		schemeCFString(CFURLCopyScheme(asURL), CFRetainRelease::kAlreadyRetained);
+		CFRetainRelease		hostCFString(CFURLCopyHostName(asURL), CFRetainRelease::kAlreadyRetained);
+		Boolean				isLocal = false;
+		
+		
+		if (schemeCFString.exists() &&
+			(kCFCompareEqualTo == CFStringCompare(schemeCFString.returnCFStringRef(), CFSTR("file"), kCFCompareCaseInsensitive)))
+		{
+			if ((false == hostCFString.exists()) || (0 == CFStringGetLength(hostCFString.returnCFStringRef())) ||
+				(kCFCompareEqualTo == CFStringCompare(hostCFString.returnCFStringRef(), CFSTR("localhost"), kCFCompareCaseInsensitive)))
+			{
+				isLocal = true;
+			}
+			else
+			{
+				char	hostNameBuffer[256];
+				
+				
+				if (0 == gethostname(hostNameBuffer, sizeof(hostNameBuffer)))
+				{
+					CFRetainRelease		localHostCFString(CFStringCreateWithCString(kCFAllocatorDefault, hostNameBuffer, kCFStringEncodingUTF8),
+															CFRetainRelease::kAlreadyRetained);
+					
+					
+					if (localHostCFString.exists())
+					{
+						CFStringRef		reportedHost = hostCFString.returnCFStringRef();
+						CFStringRef		localHost = localHostCFString.returnCFStringRef();
+						
+						
+						// shells may report either a short or fully-qualified name
+						isLocal = ((kCFCompareEqualTo == CFStringCompare(reportedHost, localHost, kCFCompareCaseInsensitive)) ||
+									CFStringHasPrefix(localHost, reportedHost) ||
+									CFStringHasPrefix(reportedHost, localHost));
+						if (isLocal && (CFStringGetLength(reportedHost) != CFStringGetLength(localHost)))
+						{
+							// a prefix only counts if it ends at a domain separator
+							CFStringRef		longerHost = (CFStringGetLength(reportedHost) > CFStringGetLength(localHost))
+															? reportedHost
+															: localHost;
+							CFIndex			shorterLength = std::min(CFStringGetLength(reportedHost), CFStringGetLength(localHost));
+							
+							
+							isLocal = ('.' == CFStringGetCharacterAtIndex(longerHost, shorterLength));
+						}
+					}
+				}
+			}
+		}
+		
+		if (isLocal)
+		{
+			// this also decodes any percent-escaped bytes in the path
+			result = CFURLCopyFileSystemPath(asURL, kCFURLPOSIXPathStyle);
+			if ((nullptr != result) && (0 == CFStringGetLength(result)))
+			{
+				CFRelease(result), result = nullptr;
+			}
+		}
+	}
+	
+	return result;
+}// copyLocalPathForWorkingDirectoryURL
+
+
+/*!
+Returns the text of the given line as the user sees it (as in
+stringForCells(), clusters are expanded and the right halves of
+double-width characters are omitted), without any whitespace at
+the end, since there is no benefit to searching beyond the text
+portion of a line.  Also fills in the column of every UTF-16
+unit of the result, so that offsets into the string can be
+translated back into cells.
+
+Unlike stringForCells(), this is safe to call from a search
+thread.  The result may be nullptr.
+
+IMPORTANT:	You must eventually use CFRelease() on the returned
+			string.
+
+(2017.10)
+*/
+CFStringRef
+copyTextForSearch	(My_ScreenBufferLine const&		inLine,
+					 std::vector< UInt16 >&			outColumnsByIndex)
+{
+	UniChar const* const	kBegin = inLine.textVectorBegin;
+	UniChar const*			pastEnd = kBegin + inLine.textVectorSize;
+	std::vector< UniChar >	characters;
+	
+	
+	// LOCALIZE THIS
+	while ((pastEnd != kBegin) && (*(pastEnd - 1) <= 0x7F) && std::isspace(*(pastEnd - 1)))
+	{
+		--pastEnd;
+	}
+	
+	characters.reserve(pastEnd - kBegin);
+	outColumnsByIndex.clear();
+	outColumnsByIndex.reserve(pastEnd - kBegin);
+	for (UniChar const* ptr = kBegin; ptr != pastEnd; ++ptr)
+	{
+		UInt16 const	kColumn = STATIC_CAST(ptr - kBegin, UInt16);
+		
+		
+		if (kTerminalLine_WidePaddingCell == *ptr)
+		{
+			// the character to the left already represents this column
+		}
+		else if (TerminalLine_IsSpecialCell(*ptr))
+		{
+			CFRetainRelease		clusterCFString(TerminalLine_CopyClusterForCell(*ptr), CFRetainRelease::kAlreadyRetained);
+			
+			
+			if (clusterCFString.exists())
+			{
+				CFIndex const	kClusterLength = CFStringGetLength(clusterCFString.returnCFStringRef());
+				
+				
+				characters.resize(characters.size() + kClusterLength);
+				CFStringGetCharacters(clusterCFString.returnCFStringRef(), CFRangeMake(0, kClusterLength),
+										&characters[characters.size() - kClusterLength]);
+			}
+			else
+			{
+				characters.push_back(0xFFFD); // replacement character
+			}
+		}
+		else
+		{
+			characters.push_back(*ptr);
+		}
+		outColumnsByIndex.resize(characters.size(), kColumn);
+	}
+	
+	return CFStringCreateWithCharacters(kCFAllocatorDefault, characters.data(), characters.size());
+}// copyTextForSearch
+
+
 /*!
 Uniform interface for creating new entries in line-lists.
 DO NOT attempt manual memory management, as the scheme
@@ -14667,6 +15287,8 @@ echoCFString	(My_ScreenBufferPtr		inDataPtr,
 	Boolean const	kPrinterOnly = (0 != (inDataPtr->printingModes & kMy_PrintingModePrintController));
 	
 	
+	inDataPtr->statistics.echoCharacterCount += kLength;
+	
 	// append to capture file, if one is open; try to avoid conversion,
 	// but if necessary convert the bytes into a Unicode format
 	if ((nullptr != inDataPtr->captureStream) || (nullptr != inDataPtr->printingStream))
@@ -14747,42 +15369,86 @@ echoCFString	(My_ScreenBufferPtr		inDataPtr,
 		{
 			UniChar			thisCharacter = CFStringGetCharacterFromInlineBuffer(&inlineBuffer, i);
 			CFIndex const	kCharacterCountToCompose = CFStringGetRangeOfComposedCharactersAtIndex(inString, i).length;
+			UInt16			columnCount = 1;
 			
 			
-			// compose the character for display purposes
-			// IMPORTANT: this is a bit of a hack, as it is technically possible
-			// for Unicode combinations to have no single character equivalent
-			// (i.e. they can only be described in decomposed form); however, this
-			// is rare; for now composition is considered an acceptable work-around
-			if (kCharacterCountToCompose > 1)
+			// a cluster of several UTF-16 units (such as a letter and its
+			// accents, or any character beyond the Basic Multilingual Plane)
+			// is composed if possible and otherwise stored out-of-line; either
+			// way, the cell refers to the entire cluster
+			if ((kCharacterCountToCompose > 1) || TerminalLine_IsSpecialCell(thisCharacter))
 			{
-				CFRetainRelease		composedCharacter(CFStringCreateMutable(kCFAllocatorDefault, kCharacterCountToCompose),
-														CFRetainRelease::kAlreadyRetained);
+				CFRetainRelease		clusterCFString(CFStringCreateWithSubstring(kCFAllocatorDefault, inString,
+																				CFRangeMake(i, kCharacterCountToCompose)),
+													CFRetainRelease::kAlreadyRetained);
 				
 				
-				for (CFIndex j = i; j < (i + kCharacterCountToCompose); ++j)
-				{
-					UniChar const	kNextChar = CFStringGetCharacterFromInlineBuffer(&inlineBuffer, j);
-					
-					
-					CFStringAppendCharacters(composedCharacter.returnCFMutableStringRef(), &kNextChar, 1);
-				}
-				CFStringNormalize(composedCharacter.returnCFMutableStringRef(), kCFStringNormalizationFormC);
-				thisCharacter = CFStringGetCharacterAtIndex(composedCharacter.returnCFStringRef(), 0);
+				thisCharacter = returnCellForCluster(clusterCFString.returnCFStringRef());
+				columnCount = TerminalLine_ReturnClusterWidth(clusterCFString.returnCFStringRef());
+			}
+			else
+			{
+				columnCount = TerminalLine_ReturnCharacterWidth(thisCharacter);
 			}
 			
 		#if 0
 			// debug
 			{
-				CFRetainRelease		s(CFStringCreateWithCharacters(kCFAllocatorDefault, &thisCharacter, 1), true);
-				
-				
-				Console_WriteValueCFString("echo character: glyph", s.returnCFStringRef());
 				Console_WriteValue("echo character: value", thisCharacter);
 				Console_WriteValue("echo character: count", kCharacterCountToCompose);
+				Console_WriteValue("echo character: width", columnCount);
 			}
 		#endif
 			
+			// a character with no width of its own (such as a combining
+			// accent that arrived separately from the letter it modifies)
+			// joins the cluster of the most recently written character
+			if ((0 == columnCount) && (inDataPtr->wrapPending || (inDataPtr->current.cursorX > 0)))
+			{
+				My_ScreenBufferLine&	cursorLine = **cursorLineIterator;
+				SInt16					targetColumn = (inDataPtr->wrapPending)
+														? inDataPtr->current.cursorX
+														: (inDataPtr->current.cursorX - 1);
+				CFRetainRelease			targetCluster;
+				CFRetainRelease			joinedCluster(CFStringCreateMutable(kCFAllocatorDefault, 0/* maximum length */),
+														CFRetainRelease::kAlreadyRetained);
+				CFRetainRelease			addedCluster(CFStringCreateWithSubstring(kCFAllocatorDefault, inString,
+																					CFRangeMake(i, kCharacterCountToCompose)),
+														CFRetainRelease::kAlreadyRetained);
+				
+				
+				if ((kTerminalLine_WidePaddingCell == cursorLine.textVectorBegin[targetColumn]) && (targetColumn > 0))
+				{
+					--targetColumn;
+				}
+				targetCluster.setWithNoRetain(TerminalLine_CopyClusterForCell(cursorLine.textVectorBegin[targetColumn]));
+				if (targetCluster.exists())
+				{
+					CFStringAppend(joinedCluster.returnCFMutableStringRef(), targetCluster.returnCFStringRef());
+				}
+				else
+				{
+					CFStringAppendCharacters(joinedCluster.returnCFMutableStringRef(), &cursorLine.textVectorBegin[targetColumn], 1);
+				}
+				CFStringAppend(joinedCluster.returnCFMutableStringRef(), addedCluster.returnCFStringRef());
+				cursorLine.textVectorBegin[targetColumn] = returnCellForCluster(joinedCluster.returnCFStringRef());
+				
+				// make sure that the modified column is redrawn
+				preWriteCursorX = std::min(preWriteCursorX, targetColumn);
+				
+				i += (kCharacterCountToCompose - 1/* loop has a ++i by default */);
+				continue;
+			}
+			
+			// a double-width character cannot begin in the last column; when
+			// wrapping is enabled it moves to the next line, otherwise only
+			// its left half is written
+			if ((2 == columnCount) && (false == inDataPtr->wrapPending) && inDataPtr->modeAutoWrap &&
+				(inDataPtr->current.cursorX >= (inDataPtr->current.returnNumberOfColumnsPermitted() - 1)))
+			{
+				inDataPtr->wrapPending = true;
+			}
+			
 			// if the cursor was about to wrap on the previous
 			// write, perform that wrap now
 			if (inDataPtr->wrapPending)
@@ -14799,12 +15465,25 @@ echoCFString	(My_ScreenBufferPtr		inDataPtr,
 			// write characters on a single line
 			if (inDataPtr->modeInsertNotReplace)
 			{
-				bufferInsertBlanksAtCursorColumnWithoutUpdate(inDataPtr, 1/* number of blank characters */, kMy_AttributeRuleInitialize);
+				bufferInsertBlanksAtCursorColumnWithoutUpdate(inDataPtr, columnCount/* number of blank characters */, kMy_AttributeRuleInitialize);
+			}
+			clearWideCharacterAtColumn(**cursorLineIterator, inDataPtr->current.cursorX);
+			if (2 == columnCount)
+			{
+				clearWideCharacterAtColumn(**cursorLineIterator, inDataPtr->current.cursorX + 1);
 			}
 			(*cursorLineIterator)->textVectorBegin[inDataPtr->current.cursorX] = translateCharacter(inDataPtr, thisCharacter,
 																									inDataPtr->current.drawingAttributes,
 																									temporaryAttributes);
 			(*cursorLineIterator)->returnMutableAttributeVector()[inDataPtr->current.cursorX] = temporaryAttributes;
+			if ((2 == columnCount) && (inDataPtr->current.cursorX < (inDataPtr->current.returnNumberOfColumnsPermitted() - 1)))
+			{
+				// the right half of a double-width character is a placeholder
+				// that has the same attributes; the cursor advances past it
+				moveCursorRight(inDataPtr);
+				(*cursorLineIterator)->textVectorBegin[inDataPtr->current.cursorX] = kTerminalLine_WidePaddingCell;
+				(*cursorLineIterator)->returnMutableAttributeVector()[inDataPtr->current.cursorX] = temporaryAttributes;
+			}
 			
 			if (false == inDataPtr->wrapPending)
 			{
@@ -14908,66 +15587,6 @@ eraseRightHalfOfLine	(My_ScreenBufferPtr		inDataPtr,
 }// eraseRightHalfOfLine
 
 
-/*!
-Iterates over the given range of lines on the specified
-terminal screen, executing a function on each of them.
-
-The ranges are zero-based, but can be negative; 0 is the
-first line of the main screen area, and -1 is the first
-scrollback line.  The oldest scrollback row is a larger
-negative number, the bottommost line of the visible screen
-is one less than the number of rows high that the terminal
-screen is.
-
-The context is defined by you, and is passed directly to
-the specified function each time it is invoked.
-
-\retval kTerminal_ResultOK
-if no error occurred
-
-\retval kTerminal_ResultParameterError
-if the screen line operation function, screen reference or
-line iterator reference is invalid
-
-\retval kTerminal_ResultNotEnoughMemory
-if any line buffers are unexpectedly empty
-
-(3.0)
-*/
-Terminal_Result
-forEachLineDo	(TerminalScreenRef				inRef,
-				 Terminal_LineRef				inStartRow,
-				 UInt32							inNumberOfRowsToConsider,
-				 My_ScreenLineOperationProcPtr	inDoWhat,
-				 void*							inContextPtr)
-{
-	Terminal_Result			result = kTerminal_ResultOK;
-	My_ScreenBufferPtr		screenPtr = getVirtualScreenData(inRef);
-	My_LineIteratorPtr		iteratorPtr = getLineIterator(inStartRow);
-	
-	
-	if ((inDoWhat == nullptr) || (screenPtr == nullptr) || (iteratorPtr == nullptr))
-	{
-		result = kTerminal_ResultParameterError;
-	}
-	else
-	{
-		UInt32		lineNumber = 0;
-		Boolean		isEnd = false;
-		
-		
-		// iterate over all lines in the range
-		for (; ((lineNumber < inNumberOfRowsToConsider) && (false == isEnd));
-				iteratorPtr->goToNextLine(isEnd), ++lineNumber)
-		{
-			invokeScreenLineOperationProc(inDoWhat, screenPtr, iteratorPtr->currentLine().textCFString.returnCFMutableStringRef(),
-											lineNumber, inContextPtr);
-		}
-	}
-	return result;
-}// forEachLineDo
-
-
 /*!
 Returns a pointer to the internal structure, given a
 reference to it.
@@ -14983,14 +15602,16 @@ getLineIterator		(Terminal_LineRef	inIterator)
 
 /*!
 Returns a pointer to the internal structure, given a
-reference to it.
+reference to it.  This is a constant-time lookup in the
+table of screens; the result is nullptr if the reference
+is not valid (and debug builds log a warning in that case).
 
 (3.0)
 */
 inline My_ScreenBufferPtr
 getVirtualScreenData	(TerminalScreenRef		inScreen)
 {
-	return REINTERPRET_CAST(inScreen, My_ScreenBufferPtr);
+	return gScreenRefLocks().returnPointer(inScreen);
 }// getVirtualScreenData
 
 
@@ -15462,9 +16083,9 @@ moveCursorX		(My_ScreenBufferPtr		inDataPtr,
 {
 	if (0 == (inDataPtr->printingModes & kMy_PrintingModePrintController))
 	{
-		// arbitrarily check the state of password mode whenever the cursor
-		// moves to a different column (TEMPORARY; may need a more intelligent
-		// way to check this, such as a periodic timer?)
+		// check the state of password mode whenever the cursor moves to a
+		// different column; this only reads a flag that the session keeps
+		// up-to-date, so it is not expensive
 		{
 			Boolean		currentPasswordMode = Session_IsInPasswordMode(inDataPtr->listeningSession);
 			
@@ -15611,6 +16232,7 @@ resetTerminal   (My_ScreenBufferPtr		inDataPtr,
 	//inDataPtr->modeAutoWrap = false; // 3.0 - do not touch the auto-wrap setting
 	inDataPtr->modeCursorKeysForApp = false;
 	inDataPtr->modeApplicationKeys = false;
+	inDataPtr->modeBracketedPaste = false;
 	inDataPtr->modeOriginRedefined = false; // also requires cursor homing (below), according to manual
 	inDataPtr->originRegionPtr = &inDataPtr->visibleBoundary.rows;
 	inDataPtr->previous.drawingAttributes = kTextAttributes_Invalid;
@@ -15641,6 +16263,53 @@ resetTerminal   (My_ScreenBufferPtr		inDataPtr,
 }// resetTerminal
 
 
+/*!
+Returns the cell value for the given cluster, as with the
+routine TerminalLine_ReturnCellForCluster(); but if every
+possible cluster cell is taken, first reclaims the cells
+that no line of any screen refers to anymore.  The full
+scan is done at most every few seconds, so a terminal that
+really does show thousands of unique clusters degrades to
+approximations instead of scanning constantly.
+
+(2017.10)
+*/
+UniChar
+returnCellForCluster	(CFStringRef	inCluster)
+{
+	CFTimeInterval const	kMinimumReclaimInterval = 5.0; // arbitrary
+	
+	
+	if (TerminalLine_ClusterTableIsFull() &&
+		((CFAbsoluteTimeGetCurrent() - gClusterReclaimTime()) > kMinimumReclaimInterval))
+	{
+		TerminalLine_ClusterCellUsage	usage;
+		
+		
+		for (My_ScreenBufferPtr screenPtr : gScreenBuffers())
+		{
+			for (My_ScreenBufferLinePtr const& linePtr : screenPtr->scrollbackBuffer)
+			{
+				My_ScreenBufferLine const&	kLine = *linePtr;
+				
+				
+				TerminalLine_MarkClusterCellsInUse(kLine.textVectorBegin, kLine.textVectorBegin + kLine.textVectorSize, usage);
+			}
+			for (My_ScreenBufferLinePtr const& linePtr : screenPtr->screenBuffer)
+			{
+				My_ScreenBufferLine const&	kLine = *linePtr;
+				
+				
+				TerminalLine_MarkClusterCellsInUse(kLine.textVectorBegin, kLine.textVectorBegin + kLine.textVectorSize, usage);
+			}
+		}
+		UNUSED_RETURN(size_t)TerminalLine_ReclaimClusterCells(usage);
+		gClusterReclaimTime() = CFAbsoluteTimeGetCurrent();
+	}
+	return TerminalLine_ReturnCellForCluster(inCluster);
+}// returnCellForCluster
+
+
 /*!
 Returns the currently attached SessionRef, or nullptr
 if none is attached.  This is necessary for a small
@@ -15679,6 +16348,7 @@ screenCopyLinesToScrollback		(My_ScreenBufferPtr		inDataPtr)
 		
 		inDataPtr->scrollbackBuffer.insert(inDataPtr->scrollbackBuffer.begin(), kLineCount/* number of lines */, templateLine);
 		inDataPtr->scrollbackBufferCachedSize += kLineCount;
+		inDataPtr->statistics.scrollbackLineCount += kLineCount;
 		std::copy(inDataPtr->screenBuffer.rbegin(), inDataPtr->screenBuffer.rend(), inDataPtr->scrollbackBuffer.begin());
 		
 		if (inDataPtr->scrollbackBufferCachedSize > inDataPtr->text.scrollback.numberOfRowsPermitted)
@@ -15788,6 +16458,11 @@ screenMoveLinesToScrollback		(My_ScreenBufferPtr						inDataPtr,
 		Boolean		recycleLines = false;
 		
 		
+		if (inDataPtr->text.scrollback.enabled)
+		{
+			inDataPtr->statistics.scrollbackLineCount += inNumberOfElements;
+		}
+		
 		// scrolling will be done; figure out whether or not to recycle old lines
 		recycleLines = (!(inDataPtr->text.scrollback.enabled)) ||
 						(!(inDataPtr->scrollbackBuffer.empty()) &&
@@ -16237,43 +16912,65 @@ setVisibleRowCount	(My_ScreenBufferPtr		inPtr,
 
 
 /*!
-Returns an autoreleased string that is a substring of the
-given string, keeping all leading whitespace but stopping
-before all trailing whitespace.
-
-This is useful when searching, for example, as there is no
-benefit to scanning beyond the text portion of a line.
+Returns a string for the given range of cells of a line,
+suitable for display: clusters that are stored out-of-line
+are expanded, and the right halves of double-width characters
+are omitted (the glyph to the left covers both columns).  The
+result is autoreleased.
 
-TEMPORARY:	Could move this to String Utilities module but
-			that file is pure C++ right now.
+Since ordinary lines have no special cells, they are simply
+returned as substrings of the line’s own string.
 
-(4.1)
+(2017.10)
 */
-CFStringRef
-stringByStrippingEndWhitespace		(CFStringRef	inSourceString)
+NSString*
+stringForCells	(My_ScreenBufferLine const&		inLine,
+				 NSRange						inRange)
 {
-	CFStringRef		result = inSourceString;
+	UniChar const* const	kBegin = inLine.textVectorBegin + inRange.location;
+	UniChar const* const	kPastEnd = kBegin + inRange.length;
+	NSString*				result = nil;
 	
 	
-	if (nullptr != inSourceString)
+	if (std::none_of(kBegin, kPastEnd, TerminalLine_IsSpecialCell))
 	{
-		CFIndex const		kStringLength = CFStringGetLength(inSourceString);
-		NSCharacterSet*		whitespaceSet = [NSCharacterSet whitespaceAndNewlineCharacterSet];
-		NSString*			asNSString = BRIDGE_CAST(inSourceString, NSString*);
-		NSInteger			i = 0;
+		result = [BRIDGE_CAST(inLine.textCFString.returnCFStringRef(), NSString*) substringWithRange:inRange];
+	}
+	else
+	{
+		NSMutableString*	mutableResult = [NSMutableString stringWithCapacity:inRange.length];
 		
 		
-		for (i = (kStringLength - 1);
-				((i >= 0) && [whitespaceSet characterIsMember:[asNSString characterAtIndex:i]]); --i)
+		for (UniChar const* ptr = kBegin; ptr != kPastEnd; ++ptr)
 		{
-			// empty loop
+			if (kTerminalLine_WidePaddingCell == *ptr)
+			{
+				// normally nothing is needed; but if the character to the
+				// left is not part of this range, leave a blank space
+				if (kBegin == ptr)
+				{
+					[mutableResult appendString:@" "];
+				}
+			}
+			else if (TerminalLine_IsSpecialCell(*ptr))
+			{
+				CFRetainRelease		clusterCFString(TerminalLine_CopyClusterForCell(*ptr), CFRetainRelease::kAlreadyRetained);
+				
+				
+				[mutableResult appendString:((clusterCFString.exists())
+												? BRIDGE_CAST(clusterCFString.returnCFStringRef(), NSString*)
+												: @"\uFFFD")];
+			}
+			else
+			{
+				CFStringAppendCharacters(BRIDGE_CAST(mutableResult, CFMutableStringRef), ptr, 1);
+			}
 		}
-		
-		result = BRIDGE_CAST([asNSString substringToIndex:(i + 1)], CFStringRef);
+		result = mutableResult;
 	}
 	
 	return result;
-}// stringByStrippingEndWhitespace
+}// stringForCells
 
 
 /*!
@@ -16403,15 +17100,24 @@ threadForTerminalSearch		(void*	inSearchThreadContextPtr)
 		// find ALL matches; NOTE that this technically will not find words
 		// that begin at the end of one line and continue at the start of
 		// the next, but that is a known limitation right now (TEMPORARY)
+		// (the line’s own string contains special cells, such as references
+		// to clusters; its expanded text is searched instead, and offsets
+		// into that text are translated back into columns)
 		My_ScreenBufferLine const&	kLine = **toLine;
-		CFStringRef const			kCFStringToSearch = stringByStrippingEndWhitespace(kLine.textCFString.returnCFStringRef());
-		CFRetainRelease				resultsArray(CFStringCreateArrayWithFindResults
-													(kCFAllocatorDefault, kCFStringToSearch, contextPtr->queryCFString,
-														CFRangeMake(0, CFStringGetLength(kCFStringToSearch)),
-														contextPtr->searchFlags),
+		std::vector< UInt16 >		columnsByIndex;
+		CFRetainRelease				stringToSearch(copyTextForSearch(kLine, columnsByIndex),
 													CFRetainRelease::kAlreadyRetained);
+		CFRetainRelease				resultsArray;
 		
 		
+		if (stringToSearch.exists())
+		{
+			resultsArray.setWithNoRetain(CFStringCreateArrayWithFindResults
+											(kCFAllocatorDefault, stringToSearch.returnCFStringRef(), contextPtr->queryCFString,
+												CFRangeMake(0, CFStringGetLength(stringToSearch.returnCFStringRef())),
+												contextPtr->searchFlags));
+		}
+		
 		if (resultsArray.exists())
 		{
 			// return the range of text that was found
@@ -16429,13 +17135,26 @@ threadForTerminalSearch		(void*	inSearchThreadContextPtr)
 																		CFRange const*);
 				SInt32						firstRow = rowIndex;
 				UInt16						firstColumn = 0;
+				UInt16						pastEndColumn = 0;
 				Terminal_RangeDescription	textRegion;
 				
 				
+				if (toRange->length <= 0)
+				{
+					continue;
+				}
+				
 				// translate all results ranges into external form; the
 				// caller understands rows and columns, etc. not offsets
-				// into a giant buffer
-				firstColumn = STATIC_CAST(toRange->location, UInt16);
+				// into a giant buffer (a match that ends with a double-width
+				// character includes the column of its right half)
+				firstColumn = columnsByIndex[toRange->location];
+				pastEndColumn = columnsByIndex[toRange->location + toRange->length - 1] + 1;
+				while ((pastEndColumn < kLine.textVectorSize) &&
+						(kTerminalLine_WidePaddingCell == kLine.textVectorBegin[pastEndColumn]))
+				{
+					++pastEndColumn;
+				}
 				if (false == kIsScreen)
 				{
 					// translate scrollback into negative coordinates (zero-based)
@@ -16445,7 +17164,7 @@ threadForTerminalSearch		(void*	inSearchThreadContextPtr)
 				textRegion.screen = contextPtr->screenBufferPtr->selfRef;
 				textRegion.firstRow = firstRow;
 				textRegion.firstColumn = firstColumn;
-				textRegion.columnCount = STATIC_CAST(toRange->length, UInt16);
+				textRegion.columnCount = (pastEndColumn - firstColumn);
 				textRegion.rowCount = 1;
 				contextPtr->matchesVectorPtr->push_back(textRegion);
 			}
@@ -33,24 +33,455 @@
 #include "TerminalLine.h"
 #include <UniversalDefines.h>
 
+// standard-C++ includes
+#include <algorithm>
+#include <map>
+#include <mutex>
+#include <string>
+#include <vector>
+
+// Mac includes
+#include <CoreFoundation/CoreFoundation.h>
+
 // library includes
 #include <Console.h>
 
 
 
+#pragma mark Types
+namespace {
+
+/*!
+An inclusive range of Unicode code points.
+*/
+struct My_CodePointRange
+{
+	UnicodeScalarValue	first;
+	UnicodeScalarValue	last;
+};
+
+typedef std::basic_string< UniChar >				My_ClusterString;
+typedef std::map< My_ClusterString, UniChar >		My_CellByCluster;
+typedef std::vector< CFRetainRelease >				My_ClusterList;
+typedef std::vector< UniChar >						My_ClusterCellList;
+
+} // anonymous namespace
+
+#pragma mark Constants
+namespace {
+
+UniChar const		kMy_ReplacementCharacter = 0xFFFD;	//!< used if a cluster cannot be stored at all
+
+/*!
+Code points that have no width of their own (combining marks,
+zero-width formatting characters, etc.), in ascending order.
+This and "kMy_DoubleWidthRanges" follow the conventions of the
+common wcwidth() implementations, and cover Unicode 10.
+*/
+My_CodePointRange const		kMy_ZeroWidthRanges[] =
+{
+	{ 0x0300, 0x036F }, { 0x0483, 0x0489 }, { 0x0591, 0x05BD }, { 0x05BF, 0x05BF }, { 0x05C1, 0x05C2 },
+	{ 0x05C4, 0x05C5 }, { 0x05C7, 0x05C7 }, { 0x0610, 0x061A }, { 0x061C, 0x061C }, { 0x064B, 0x065F },
+	{ 0x0670, 0x0670 }, { 0x06D6, 0x06DC }, { 0x06DF, 0x06E4 }, { 0x06E7, 0x06E8 }, { 0x06EA, 0x06ED },
+	{ 0x0711, 0x0711 }, { 0x0730, 0x074A }, { 0x07A6, 0x07B0 }, { 0x07EB, 0x07F3 }, { 0x0816, 0x0819 },
+	{ 0x081B, 0x0823 }, { 0x0825, 0x0827 }, { 0x0829, 0x082D }, { 0x0859, 0x085B }, { 0x08D4, 0x08E1 },
+	{ 0x08E3, 0x0902 }, { 0x093A, 0x093A }, { 0x093C, 0x093C }, { 0x0941, 0x0948 }, { 0x094D, 0x094D },
+	{ 0x0951, 0x0957 }, { 0x0962, 0x0963 }, { 0x0981, 0x0981 }, { 0x09BC, 0x09BC }, { 0x09C1, 0x09C4 },
+	{ 0x09CD, 0x09CD }, { 0x09E2, 0x09E3 }, { 0x0A01, 0x0A02 }, { 0x0A3C, 0x0A3C }, { 0x0A41, 0x0A42 },
+	{ 0x0A47, 0x0A48 }, { 0x0A4B, 0x0A4D }, { 0x0A51, 0x0A51 }, { 0x0A70, 0x0A71 }, { 0x0A75, 0x0A75 },
+	{ 0x0A81, 0x0A82 }, { 0x0ABC, 0x0ABC }, { 0x0AC1, 0x0AC5 }, { 0x0AC7, 0x0AC8 }, { 0x0ACD, 0x0ACD },
+	{ 0x0AE2, 0x0AE3 }, { 0x0AFA, 0x0AFF }, { 0x0B01, 0x0B01 }, { 0x0B3C, 0x0B3C }, { 0x0B3F, 0x0B3F },
+	{ 0x0B41, 0x0B44 }, { 0x0B4D, 0x0B4D }, { 0x0B56, 0x0B56 }, { 0x0B62, 0x0B63 }, { 0x0B82, 0x0B82 },
+	{ 0x0BC0, 0x0BC0 }, { 0x0BCD, 0x0BCD }, { 0x0C00, 0x0C00 }, { 0x0C3E, 0x0C40 }, { 0x0C46, 0x0C48 },
+	{ 0x0C4A, 0x0C4D }, { 0x0C55, 0x0C56 }, { 0x0C62, 0x0C63 }, { 0x0C81, 0x0C81 }, { 0x0CBC, 0x0CBC },
+	{ 0x0CBF, 0x0CBF }, { 0x0CC6, 0x0CC6 }, { 0x0CCC, 0x0CCD }, { 0x0CE2, 0x0CE3 }, { 0x0D00, 0x0D01 },
+	{ 0x0D3B, 0x0D3C }, { 0x0D41, 0x0D44 }, { 0x0D4D, 0x0D4D }, { 0x0D62, 0x0D63 }, { 0x0DCA, 0x0DCA },
+	{ 0x0DD2, 0x0DD4 }, { 0x0DD6, 0x0DD6 }, { 0x0E31, 0x0E31 }, { 0x0E34, 0x0E3A }, { 0x0E47, 0x0E4E },
+	{ 0x0EB1, 0x0EB1 }, { 0x0EB4, 0x0EB9 }, { 0x0EBB, 0x0EBC }, { 0x0EC8, 0x0ECD }, { 0x0F18, 0x0F19 },
+	{ 0x0F35, 0x0F35 }, { 0x0F37, 0x0F37 }, { 0x0F39, 0x0F39 }, { 0x0F71, 0x0F7E }, { 0x0F80, 0x0F84 },
+	{ 0x0F86, 0x0F87 }, { 0x0F8D, 0x0F97 }, { 0x0F99, 0x0FBC }, { 0x0FC6, 0x0FC6 }, { 0x102D, 0x1030 },
+	{ 0x1032, 0x1037 }, { 0x1039, 0x103A }, { 0x103D, 0x103E }, { 0x1058, 0x1059 }, { 0x105E, 0x1060 },
+	{ 0x1071, 0x1074 }, { 0x1082, 0x1082 }, { 0x1085, 0x1086 }, { 0x108D, 0x108D }, { 0x109D, 0x109D },
+	{ 0x1160, 0x11FF }, { 0x135D, 0x135F }, { 0x1712, 0x1714 }, { 0x1732, 0x1734 }, { 0x1752, 0x1753 },
+	{ 0x1772, 0x1773 }, { 0x17B4, 0x17B5 }, { 0x17B7, 0x17BD }, { 0x17C6, 0x17C6 }, { 0x17C9, 0x17D3 },
+	{ 0x17DD, 0x17DD }, { 0x180B, 0x180E }, { 0x1885, 0x1886 }, { 0x18A9, 0x18A9 }, { 0x1920, 0x1922 },
+	{ 0x1927, 0x1928 }, { 0x1932, 0x1932 }, { 0x1939, 0x193B }, { 0x1A17, 0x1A18 }, { 0x1A1B, 0x1A1B },
+	{ 0x1A56, 0x1A56 }, { 0x1A58, 0x1A5E }, { 0x1A60, 0x1A60 }, { 0x1A62, 0x1A62 }, { 0x1A65, 0x1A6C },
+	{ 0x1A73, 0x1A7C }, { 0x1A7F, 0x1A7F }, { 0x1AB0, 0x1ABE }, { 0x1B00, 0x1B03 }, { 0x1B34, 0x1B34 },
+	{ 0x1B36, 0x1B3A }, { 0x1B3C, 0x1B3C }, { 0x1B42, 0x1B42 }, { 0x1B6B, 0x1B73 }, { 0x1B80, 0x1B81 },
+	{ 0x1BA2, 0x1BA5 }, { 0x1BA8, 0x1BA9 }, { 0x1BAB, 0x1BAD }, { 0x1BE6, 0x1BE6 }, { 0x1BE8, 0x1BE9 },
+	{ 0x1BED, 0x1BED }, { 0x1BEF, 0x1BF1 }, { 0x1C2C, 0x1C33 }, { 0x1C36, 0x1C37 }, { 0x1CD0, 0x1CD2 },
+	{ 0x1CD4, 0x1CE0 }, { 0x1CE2, 0x1CE8 }, { 0x1CED, 0x1CED }, { 0x1CF4, 0x1CF4 }, { 0x1CF8, 0x1CF9 },
+	{ 0x1DC0, 0x1DF9 }, { 0x1DFB, 0x1DFF }, { 0x200B, 0x200F }, { 0x202A, 0x202E }, { 0x2060, 0x2064 },
+	{ 0x2066, 0x206F }, { 0x20D0, 0x20F0 }, { 0x2CEF, 0x2CF1 }, { 0x2D7F, 0x2D7F }, { 0x2DE0, 0x2DFF },
+	{ 0x302A, 0x302D }, { 0x3099, 0x309A }, { 0xA66F, 0xA672 }, { 0xA674, 0xA67D }, { 0xA69E, 0xA69F },
+	{ 0xA6F0, 0xA6F1 }, { 0xA802, 0xA802 }, { 0xA806, 0xA806 }, { 0xA80B, 0xA80B }, { 0xA825, 0xA826 },
+	{ 0xA8C4, 0xA8C5 }, { 0xA8E0, 0xA8F1 }, { 0xA926, 0xA92D }, { 0xA947, 0xA951 }, { 0xA980, 0xA982 },
+	{ 0xA9B3, 0xA9B3 }, { 0xA9B6, 0xA9B9 }, { 0xA9BC, 0xA9BC }, { 0xA9E5, 0xA9E5 }, { 0xAA29, 0xAA2E },
+	{ 0xAA31, 0xAA32 }, { 0xAA35, 0xAA36 }, { 0xAA43, 0xAA43 }, { 0xAA4C, 0xAA4C }, { 0xAA7C, 0xAA7C },
+	{ 0xAAB0, 0xAAB0 }, { 0xAAB2, 0xAAB4 }, { 0xAAB7, 0xAAB8 }, { 0xAABE, 0xAABF }, { 0xAAC1, 0xAAC1 },
+	{ 0xAAEC, 0xAAED }, { 0xAAF6, 0xAAF6 }, { 0xABE5, 0xABE5 }, { 0xABE8, 0xABE8 }, { 0xABED, 0xABED },
+	{ 0xFB1E, 0xFB1E }, { 0xFE00, 0xFE0F }, { 0xFE20, 0xFE2F }, { 0xFEFF, 0xFEFF }, { 0xFFF9, 0xFFFB },
+	{ 0x101FD, 0x101FD }, { 0x102E0, 0x102E0 }, { 0x10376, 0x1037A }, { 0x10A01, 0x10A03 }, { 0x10A05, 0x10A06 },
+	{ 0x10A0C, 0x10A0F }, { 0x10A38, 0x10A3A }, { 0x10A3F, 0x10A3F }, { 0x10AE5, 0x10AE6 }, { 0x11001, 0x11001 },
+	{ 0x11038, 0x11046 }, { 0x1107F, 0x11081 }, { 0x110B3, 0x110B6 }, { 0x110B9, 0x110BA }, { 0x11100, 0x11102 },
+	{ 0x11127, 0x1112B }, { 0x1112D, 0x11134 }, { 0x11173, 0x11173 }, { 0x11180, 0x11181 }, { 0x111B6, 0x111BE },
+	{ 0x1D167, 0x1D169 }, { 0x1D173, 0x1D182 }, { 0x1D185, 0x1D18B }, { 0x1D1AA, 0x1D1AD }, { 0x1D242, 0x1D244 },
+	{ 0x1E8D0, 0x1E8D6 }, { 0x1E944, 0x1E94A }, { 0x1F3FB, 0x1F3FF }, { 0xE0001, 0xE0001 }, { 0xE0020, 0xE007F },
+	{ 0xE0100, 0xE01EF },
+};
+
+/*!
+Code points that occupy two columns (East Asian Wide and
+Fullwidth characters, and emoji that are presented as images
+by default), in ascending order.
+*/
+My_CodePointRange const		kMy_DoubleWidthRanges[] =
+{
+	{ 0x1100, 0x115F }, { 0x231A, 0x231B }, { 0x2329, 0x232A }, { 0x23E9, 0x23EC }, { 0x23F0, 0x23F0 },
+	{ 0x23F3, 0x23F3 }, { 0x25FD, 0x25FE }, { 0x2614, 0x2615 }, { 0x2648, 0x2653 }, { 0x267F, 0x267F },
+	{ 0x2693, 0x2693 }, { 0x26A1, 0x26A1 }, { 0x26AA, 0x26AB }, { 0x26BD, 0x26BE }, { 0x26C4, 0x26C5 },
+	{ 0x26CE, 0x26CE }, { 0x26D4, 0x26D4 }, { 0x26EA, 0x26EA }, { 0x26F2, 0x26F3 }, { 0x26F5, 0x26F5 },
+	{ 0x26FA, 0x26FA }, { 0x26FD, 0x26FD }, { 0x2705, 0x2705 }, { 0x270A, 0x270B }, { 0x2728, 0x2728 },
+	{ 0x274C, 0x274C }, { 0x274E, 0x274E }, { 0x2753, 0x2755 }, { 0x2757, 0x2757 }, { 0x2795, 0x2797 },
+	{ 0x27B0, 0x27B0 }, { 0x27BF, 0x27BF }, { 0x2B1B, 0x2B1C }, { 0x2B50, 0x2B50 }, { 0x2B55, 0x2B55 },
+	{ 0x2E80, 0x303E }, { 0x3041, 0x33FF }, { 0x3400, 0x4DBF }, { 0x4E00, 0x9FFF }, { 0xA000, 0xA4CF },
+	{ 0xA960, 0xA97F }, { 0xAC00, 0xD7A3 }, { 0xF900, 0xFAFF }, { 0xFE10, 0xFE19 }, { 0xFE30, 0xFE6F },
+	{ 0xFF00, 0xFF60 }, { 0xFFE0, 0xFFE6 }, { 0x16FE0, 0x16FE1 }, { 0x17000, 0x18AFF }, { 0x1B000, 0x1B2FF },
+	{ 0x1F004, 0x1F004 }, { 0x1F0CF, 0x1F0CF }, { 0x1F18E, 0x1F18E }, { 0x1F191, 0x1F19A }, { 0x1F1E6, 0x1F1FF },
+	{ 0x1F200, 0x1F202 }, { 0x1F210, 0x1F23B }, { 0x1F240, 0x1F248 }, { 0x1F250, 0x1F251 }, { 0x1F260, 0x1F265 },
+	{ 0x1F300, 0x1F320 }, { 0x1F32D, 0x1F335 }, { 0x1F337, 0x1F37C }, { 0x1F37E, 0x1F393 }, { 0x1F3A0, 0x1F3CA },
+	{ 0x1F3CF, 0x1F3D3 }, { 0x1F3E0, 0x1F3F0 }, { 0x1F3F4, 0x1F3F4 }, { 0x1F3F8, 0x1F43E }, { 0x1F440, 0x1F440 },
+	{ 0x1F442, 0x1F4FC }, { 0x1F4FF, 0x1F53D }, { 0x1F54B, 0x1F54E }, { 0x1F550, 0x1F567 }, { 0x1F57A, 0x1F57A },
+	{ 0x1F595, 0x1F596 }, { 0x1F5A4, 0x1F5A4 }, { 0x1F5FB, 0x1F64F }, { 0x1F680, 0x1F6C5 }, { 0x1F6CC, 0x1F6CC },
+	{ 0x1F6D0, 0x1F6D2 }, { 0x1F6EB, 0x1F6EC }, { 0x1F6F4, 0x1F6F8 }, { 0x1F910, 0x1F93E }, { 0x1F940, 0x1F94C },
+	{ 0x1F950, 0x1F96B }, { 0x1F980, 0x1F997 }, { 0x1F9C0, 0x1F9C0 }, { 0x1F9D0, 0x1F9E6 }, { 0x20000, 0x2FFFD },
+	{ 0x30000, 0x3FFFD },
+};
+
+} // anonymous namespace
+
 #pragma mark Variables
 namespace {
 
 
 TerminalLine_AttributeInfo&		gEmptyLineAttributes ()		{ static TerminalLine_AttributeInfo x; return x; }
 TerminalLine_Object const&		gEmptyLineData ()			{ static TerminalLine_Object x; return x; }
+My_CellByCluster&				gClusterCells ()			{ static My_CellByCluster x; return x; }
+My_ClusterList&					gClusters ()				{ static My_ClusterList x; return x; }
+My_ClusterCellList&				gFreeClusterCells ()		{ static My_ClusterCellList x; return x; }
+std::mutex&						gClusterTableLock ()		{ static std::mutex x; return x; }		//!< guards the three tables above
+
+
+} // anonymous namespace
+
+#pragma mark Internal Method Prototypes
+namespace {
 
+Boolean		rangeTableContains		(My_CodePointRange const*, size_t, UnicodeScalarValue);
 
 } // anonymous namespace
 
 
 #pragma mark Public Methods
 
+/*!
+Returns the value that a cell should hold in order to display
+the given cluster (a sequence of one or more UTF-16 units that
+forms a single character, such as a letter and its accents).
+
+The cluster is first composed; if that produces one character
+from the Basic Multilingual Plane, that character is returned.
+Otherwise, the cluster is stored in a table shared by all
+lines and the returned value is a special cell that refers to
+it (see TerminalLine_CopyClusterForCell()).  Equal clusters
+always produce the same cell value.  If the table is full, an
+approximation is returned: the first character of the cluster,
+or a replacement character.  To avoid that, check the routine
+TerminalLine_ClusterTableIsFull() first and reclaim the cells
+that are no longer used by any line (see the routine
+TerminalLine_ReclaimClusterCells()).
+
+This is thread-safe.
+
+(2017.10)
+*/
+UniChar
+TerminalLine_ReturnCellForCluster	(CFStringRef	inCluster)
+{
+	UniChar		result = kMy_ReplacementCharacter;
+	
+	
+	if ((nullptr != inCluster) && (CFStringGetLength(inCluster) > 0))
+	{
+		CFRetainRelease		composedCluster(CFStringCreateMutableCopy(kCFAllocatorDefault, 0/* maximum length */, inCluster),
+											CFRetainRelease::kAlreadyRetained);
+		CFIndex				clusterLength = 0;
+		
+		
+		CFStringNormalize(composedCluster.returnCFMutableStringRef(), kCFStringNormalizationFormC);
+		clusterLength = std::min(CFStringGetLength(composedCluster.returnCFStringRef()), kTerminalLine_MaximumClusterLength);
+		if (CFStringIsSurrogateHighCharacter(CFStringGetCharacterAtIndex(composedCluster.returnCFStringRef(), clusterLength - 1)))
+		{
+			// never cut off a surrogate pair
+			--clusterLength;
+		}
+		
+		if (clusterLength > 0)
+		{
+			My_ClusterString	clusterCharacters(clusterLength, 0);
+			
+			
+			CFStringGetCharacters(composedCluster.returnCFStringRef(), CFRangeMake(0, clusterLength), &clusterCharacters[0]);
+			if ((1 == clusterLength) && (false == TerminalLine_IsSpecialCell(clusterCharacters[0])))
+			{
+				// the common case: the cluster fits in one cell
+				result = clusterCharacters[0];
+			}
+			else
+			{
+				std::lock_guard< std::mutex >	tableLock(gClusterTableLock());
+				auto							toCell = gClusterCells().find(clusterCharacters);
+				
+				
+				if (gClusterCells().end() != toCell)
+				{
+					result = toCell->second;
+				}
+				else if (false == gFreeClusterCells().empty())
+				{
+					// reuse a cell that was reclaimed
+					result = gFreeClusterCells().back();
+					gFreeClusterCells().pop_back();
+					gClusters()[result - kTerminalLine_FirstSpecialCell].setWithNoRetain
+					(CFStringCreateWithCharacters(kCFAllocatorDefault, clusterCharacters.data(), clusterLength));
+					gClusterCells()[clusterCharacters] = result;
+				}
+				else if (gClusters().size() <= STATIC_CAST(kTerminalLine_LastClusterCell - kTerminalLine_FirstSpecialCell, size_t))
+				{
+					result = STATIC_CAST(kTerminalLine_FirstSpecialCell + gClusters().size(), UniChar);
+					gClusters().push_back(CFRetainRelease(CFStringCreateWithCharacters(kCFAllocatorDefault, clusterCharacters.data(),
+																						clusterLength),
+															CFRetainRelease::kAlreadyRetained));
+					gClusterCells()[clusterCharacters] = result;
+				}
+				else if (false == TerminalLine_IsSpecialCell(clusterCharacters[0]))
+				{
+					result = clusterCharacters[0];
+				}
+			}
+		}
+	}
+	return result;
+}// ReturnCellForCluster
+
+
+/*!
+Returns the number of columns that the given character
+requires: 0 for combining marks and other characters that
+modify a preceding character, 2 for East Asian wide and full-
+width characters (and most emoji), and 1 otherwise.
+
+(2017.10)
+*/
+UInt16
+TerminalLine_ReturnCharacterWidth	(UnicodeScalarValue		inCodePoint)
+{
+	UInt16		result = 1;
+	
+	
+	if (inCodePoint < kMy_ZeroWidthRanges[0].first)
+	{
+		// the common case: nothing to look up
+		result = 1;
+	}
+	else if (rangeTableContains(kMy_ZeroWidthRanges, sizeof(kMy_ZeroWidthRanges) / sizeof(My_CodePointRange), inCodePoint))
+	{
+		result = 0;
+	}
+	else if (rangeTableContains(kMy_DoubleWidthRanges, sizeof(kMy_DoubleWidthRanges) / sizeof(My_CodePointRange), inCodePoint))
+	{
+		result = 2;
+	}
+	return result;
+}// ReturnCharacterWidth
+
+
+/*!
+Returns a copy of the cluster that the given special cell
+refers to, or nullptr if the cell holds an ordinary character
+(or refers to nothing).  See TerminalLine_ReturnCellForCluster().
+
+Since unused cells may be reclaimed and given to other
+clusters, a string is returned (instead of a reference into
+the table).  This is thread-safe, so that (for instance) a
+search thread can expand the text of lines.
+
+IMPORTANT:	You must eventually use CFRelease() on the
+			returned string.
+
+(2017.10)
+*/
+CFStringRef
+TerminalLine_CopyClusterForCell		(UniChar	inCellValue)
+{
+	CFStringRef		result = nullptr;
+	
+	
+	if ((inCellValue >= kTerminalLine_FirstSpecialCell) && (inCellValue <= kTerminalLine_LastClusterCell))
+	{
+		std::lock_guard< std::mutex >	tableLock(gClusterTableLock());
+		size_t const					kIndex = (inCellValue - kTerminalLine_FirstSpecialCell);
+		
+		
+		if ((kIndex < gClusters().size()) && gClusters()[kIndex].exists())
+		{
+			result = gClusters()[kIndex].returnCFStringRef();
+			CFRetain(result);
+		}
+	}
+	return result;
+}// CopyClusterForCell
+
+
+/*!
+Returns true only if every possible cluster cell is in use,
+so that TerminalLine_ReturnCellForCluster() could only give
+approximations for new clusters.
+
+This is thread-safe.
+
+(2017.10)
+*/
+Boolean
+TerminalLine_ClusterTableIsFull ()
+{
+	std::lock_guard< std::mutex >	tableLock(gClusterTableLock());
+	
+	
+	return ((gFreeClusterCells().empty()) &&
+			(gClusters().size() > STATIC_CAST(kTerminalLine_LastClusterCell - kTerminalLine_FirstSpecialCell, size_t)));
+}// ClusterTableIsFull
+
+
+/*!
+Sets the flag for every cluster cell in the given range of
+cells, resizing the usage list if necessary.  Call this for
+the text of every line that exists, before calling the routine
+TerminalLine_ReclaimClusterCells().
+
+(2017.10)
+*/
+void
+TerminalLine_MarkClusterCellsInUse	(UniChar const*						inBegin,
+									 UniChar const*						inPastEnd,
+									 TerminalLine_ClusterCellUsage&		inoutUsage)
+{
+	inoutUsage.resize(kTerminalLine_LastClusterCell - kTerminalLine_FirstSpecialCell + 1, false);
+	for (UniChar const* ptr = inBegin; ptr != inPastEnd; ++ptr)
+	{
+		if ((*ptr >= kTerminalLine_FirstSpecialCell) && (*ptr <= kTerminalLine_LastClusterCell))
+		{
+			inoutUsage[*ptr - kTerminalLine_FirstSpecialCell] = true;
+		}
+	}
+}// MarkClusterCellsInUse
+
+
+/*!
+Releases every cluster whose cell is not flagged in the given
+usage list (see TerminalLine_MarkClusterCellsInUse()), so that
+its cell can be given to a new cluster.  Returns the number of
+cells that were reclaimed.
+
+IMPORTANT:	The usage list must account for every line, or
+			some cells could change meaning.  This is
+			thread-safe but that alone does not make the
+			result correct: lines must not change between
+			marking and reclaiming.
+
+(2017.10)
+*/
+size_t
+TerminalLine_ReclaimClusterCells	(TerminalLine_ClusterCellUsage const&	inUsage)
+{
+	std::lock_guard< std::mutex >	tableLock(gClusterTableLock());
+	size_t							result = 0;
+	
+	
+	for (auto toEntry = gClusterCells().begin(); toEntry != gClusterCells().end(); )
+	{
+		size_t const	kIndex = (toEntry->second - kTerminalLine_FirstSpecialCell);
+		
+		
+		if ((kIndex < inUsage.size()) && inUsage[kIndex])
+		{
+			++toEntry;
+		}
+		else
+		{
+			gClusters()[kIndex].clear();
+			gFreeClusterCells().push_back(toEntry->second);
+			toEntry = gClusterCells().erase(toEntry);
+			++result;
+		}
+	}
+	return result;
+}// ReclaimClusterCells
+
+
+/*!
+Returns the number of columns that the given cluster requires;
+see TerminalLine_ReturnCharacterWidth().  This is normally the
+width of its first character, although variation selectors
+can explicitly request emoji (wide) or text (narrow) display.
+
+(2017.10)
+*/
+UInt16
+TerminalLine_ReturnClusterWidth		(CFStringRef	inCluster)
+{
+	CFIndex const	kLength = (nullptr == inCluster) ? 0 : CFStringGetLength(inCluster);
+	UInt16			result = 1;
+	
+	
+	if (kLength > 0)
+	{
+		CFStringInlineBuffer	inlineBuffer;
+		UniChar const			kFirstCharacter = CFStringGetCharacterAtIndex(inCluster, 0);
+		UnicodeScalarValue		codePoint = kFirstCharacter;
+		
+		
+		CFStringInitInlineBuffer(inCluster, &inlineBuffer, CFRangeMake(0, kLength));
+		if (CFStringIsSurrogateHighCharacter(kFirstCharacter) && (kLength > 1))
+		{
+			codePoint = CFStringGetLongCharacterForSurrogatePair(kFirstCharacter, CFStringGetCharacterFromInlineBuffer(&inlineBuffer, 1));
+		}
+		result = TerminalLine_ReturnCharacterWidth(codePoint);
+		if (0 != result)
+		{
+			for (CFIndex i = 1; i < kLength; ++i)
+			{
+				UniChar const	kNextCharacter = CFStringGetCharacterFromInlineBuffer(&inlineBuffer, i);
+				
+				
+				if (0xFE0F == kNextCharacter)
+				{
+					// emoji presentation
+					result = 2;
+				}
+				else if (0xFE0E == kNextCharacter)
+				{
+					// text presentation
+					result = 1;
+				}
+			}
+		}
+	}
+	return result;
+}// ReturnClusterWidth
+
+
 /*!
 Creates a new screen buffer line.
 
@@ -429,4 +860,34 @@ reset ()
 	assert(this->isDefault());
 }// TerminalLine_Handle::reset
 
+
+
+#pragma mark Internal Methods
+namespace {
+
+/*!
+Returns true only if the given code point is in one of the
+ranges of the given table, which must be in ascending order.
+
+(2017.10)
+*/
+Boolean
+rangeTableContains	(My_CodePointRange const*	inRanges,
+					 size_t						inRangeCount,
+					 UnicodeScalarValue			inCodePoint)
+{
+	My_CodePointRange const*	kPastEnd = inRanges + inRangeCount;
+	My_CodePointRange const*	toRange = std::lower_bound(inRanges, kPastEnd, inCodePoint,
+															[](My_CodePointRange const& inRange, UnicodeScalarValue inValue)
+															{
+																return (inRange.last < inValue);
+															});
+	Boolean						result = ((kPastEnd != toRange) && (toRange->first <= inCodePoint));
+	
+	
+	return result;
+}// rangeTableContains
+
+} // anonymous namespace
+
 // BELOW IS REQUIRED NEWLINE TO END FILE
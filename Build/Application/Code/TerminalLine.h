@@ -59,11 +59,32 @@ enum
 	kTerminalLine_MaximumCharacterCount = 256		//!< maximum number of columns allowed; must be a multiple of "kMy_TabStop"
 };
 
+/*!
+Each cell of a line is one UTF-16 unit, which is enough for
+almost all text.  A cell never holds half of a surrogate pair,
+so the surrogate range is used for special cells instead: the
+right half of a double-width character, and references to
+clusters (combining sequences or characters beyond the Basic
+Multilingual Plane) that are stored out-of-line; see
+TerminalLine_ReturnCellForCluster().
+*/
+UniChar const	kTerminalLine_FirstSpecialCell = 0xD800;		//!< lowest cell value that is not a character
+UniChar const	kTerminalLine_LastClusterCell = 0xDFFE;			//!< highest cell value that refers to a cluster
+UniChar const	kTerminalLine_WidePaddingCell = 0xDFFF;			//!< fills the column to the right of a double-width character
+CFIndex const	kTerminalLine_MaximumClusterLength = 32;		//!< longest cluster, in UTF-16 units, that is stored; longer ones are cut off
+
 #pragma mark Types
 
 typedef UniChar*								TerminalLine_TextIterator;
 typedef std::vector< TextAttributes_Object >	TerminalLine_TextAttributesList;
 
+/*!
+One flag for each possible cluster cell (in order, starting
+with "kTerminalLine_FirstSpecialCell"); see the routine
+TerminalLine_ReclaimClusterCells().
+*/
+typedef std::vector< bool >						TerminalLine_ClusterCellUsage;
+
 
 /*!
 All the information required to represent the attributes
@@ -238,6 +259,45 @@ private:
 
 
 
+#pragma mark Public Methods
+
+//!\name Character Cells
+//@{
+
+Boolean
+	TerminalLine_ClusterTableIsFull				();
+
+CFStringRef
+	TerminalLine_CopyClusterForCell				(UniChar					inCellValue);
+
+void
+	TerminalLine_MarkClusterCellsInUse			(UniChar const*				inBegin,
+												 UniChar const*				inPastEnd,
+												 TerminalLine_ClusterCellUsage&	inoutUsage);
+
+size_t
+	TerminalLine_ReclaimClusterCells			(TerminalLine_ClusterCellUsage const&	inUsage);
+
+UniChar
+	TerminalLine_ReturnCellForCluster			(CFStringRef				inCluster);
+
+UInt16
+	TerminalLine_ReturnCharacterWidth			(UnicodeScalarValue			inCodePoint);
+
+UInt16
+	TerminalLine_ReturnClusterWidth				(CFStringRef				inCluster);
+
+// true for cells that are not characters themselves (see "kTerminalLine_FirstSpecialCell")
+inline Boolean
+	TerminalLine_IsSpecialCell					(UniChar					inCellValue)
+{
+	return ((inCellValue >= kTerminalLine_FirstSpecialCell) && (inCellValue <= kTerminalLine_WidePaddingCell));
+}
+
+//@}
+
+
+
 #pragma mark Inline Methods
 
 /*!
@@ -69,6 +69,7 @@ class NSWindow;
 
 // application includes
 #include "Preferences.h"
+#include "Terminal.h"
 #include "TerminalRangeDescription.typedef.h"
 #include "TerminalScreenRef.typedef.h"
 
@@ -234,6 +235,18 @@ typedef std::pair< TerminalView_Cell, TerminalView_Cell >	TerminalView_CellRange
 
 typedef std::vector< TerminalView_CellRange >				TerminalView_CellRangeList;
 
+/*!
+Running totals that a terminal view keeps about its own
+rendering; see TerminalView_GetStatistics().  The counts
+are never reset, so rates are found by sampling twice.
+*/
+struct TerminalView_Statistics
+{
+	CFTimeInterval	renderTime;				//!< total time spent drawing the content area, in seconds
+	UInt64			renderFrameCount;		//!< number of times the content area has been drawn
+	UInt64			coalescedFrameCount;	//!< number of invalidations merged into a refresh that was already pending
+};
+
 #ifdef __OBJC__
 
 /*!
@@ -324,6 +337,9 @@ void
 void
 	TerminalView_Done				();
 
+void
+	TerminalView_RunTests			();
+
 //@}
 
 //!\name Creating and Destroying Terminal Views
@@ -424,6 +440,10 @@ void
 	TerminalView_GetSelectedTextAsVirtualRange	(TerminalViewRef				inView,
 												 TerminalView_CellRange&		outSelection);
 
+TerminalView_Result
+	TerminalView_GetStatistics					(TerminalViewRef				inView,
+												 TerminalView_Statistics&		outStatistics);
+
 void
 	TerminalView_MakeSelectionsRectangular		(TerminalViewRef				inView,
 												 Boolean						inAreSelectionsNotAttachedToScreenEdges);
@@ -468,6 +488,9 @@ void
 	TerminalView_SelectVirtualRange				(TerminalViewRef				inView,
 												 TerminalView_CellRange const&	inSelection);
 
+void
+	TerminalView_SetWordSeparatorCharacters		(CFStringRef					inCharactersOrNull);
+
 TerminalView_Result
 	TerminalView_SetTextSelectionRenderingEnabled	(TerminalViewRef			inView,
 												 Boolean						inIsSelectionEnabled);
@@ -478,6 +501,13 @@ Boolean
 Boolean
 	TerminalView_TextSelectionIsRectangular		(TerminalViewRef				inView);
 
+Boolean
+	TerminalView_WriteSelectedText				(TerminalViewRef				inView,
+												 UInt16							inNumberOfSpacesToReplaceWithOneTabOrZero,
+												 TerminalView_TextFlags			inFlags,
+												 Terminal_TextSinkProcPtr		inSink,
+												 void*							inSinkContextPtr);
+
 //@}
 
 //!\name Window Management
@@ -42,8 +42,20 @@
 #import <algorithm>
 #import <cctype>
 #import <set>
+#import <string>
 #import <vector>
 
+// UNIX includes
+extern "C"
+{
+#	include <errno.h>
+#	include <fcntl.h>
+#	include <stdio.h>
+#	include <stdlib.h>
+#	include <unistd.h>
+#	include <sys/stat.h>
+}
+
 // Mac includes
 #import <ApplicationServices/ApplicationServices.h>
 #import <Carbon/Carbon.h>
@@ -211,6 +223,31 @@ Float32 const	kBlendingByPhase[kMy_BlinkingColorCount] =
 					0.4725f, 0.56f, 0.6525f, 0.75f, 0.8525f
 				};
 
+/*!
+Classes of characters that affect the boundaries of words
+(see findWordRange()).  Every character is one of these.
+*/
+enum My_WordCharacterClass : UInt8
+{
+	kMy_WordCharacterClassWord				= 0,	//!< part of a word
+	kMy_WordCharacterClassSpace				= 1,	//!< white space (always separates words, and URLs)
+	kMy_WordCharacterClassSeparator			= 2,	//!< user-defined separator (does not break URLs)
+	kMy_WordCharacterClassEndPunctuation	= 3,	//!< period, comma, colon or semicolon; not allowed at the end of a word
+	kMy_WordCharacterClassOpenParenthesis	= 4,
+	kMy_WordCharacterClassCloseParenthesis	= 5,
+	kMy_WordCharacterClassOpenBracket		= 6,
+	kMy_WordCharacterClassCloseBracket		= 7,
+	kMy_WordCharacterClassOpenBrace			= 8,
+	kMy_WordCharacterClassCloseBrace		= 9,
+	kMy_WordCharacterClassOpenAngle			= 10,
+	kMy_WordCharacterClassCloseAngle		= 11,
+	kMy_WordCharacterClassDoubleQuote		= 12,
+	kMy_WordCharacterClassApostrophe		= 13,
+	kMy_WordCharacterClassBackquote			= 14	//!< treated as a single quotation mark, as GNU tools often use it that way
+};
+
+UInt16 const	kMy_MaximumWordContinuationRows = 8;	// arbitrary; limits how far a double-click can follow a wrapped word
+
 } // anonymous namespace
 
 #pragma mark Types
@@ -219,16 +256,21 @@ namespace {
 struct My_PreferenceProxies
 {
 	TerminalView_CursorType		cursorType;
+	Boolean						copySelectedText;
 	Boolean						cursorBlinks;
 	Boolean						dontDimTerminals;
+	Boolean						fadeBackgroundWindows;
 	Boolean						invertSelections;
 	Boolean						notifyOfBeeps;
+	Boolean						resizeAffectsFontSize;
+	Boolean						visualBellOnly;
 	UInt16						renderMarginAtColumn; // the value 0 means “no rendering”; column 1 is first column, etc.
 };
 
 typedef std::vector< CGDeviceColor >			My_CGColorList;
 typedef std::map< UInt16, CGDeviceColor >		My_CGColorByIndex; // a map is necessary because "vector" cannot handle 256 sequential color structures
 typedef std::vector< EventTime >				My_TimeIntervalList;
+typedef std::vector< My_WordCharacterClass >	My_WordCharacterClassTable; // one entry for every possible UniChar
 
 /*!
 A wrapper that calls HIViewConvertRegion() at construction
@@ -286,6 +328,7 @@ struct My_TerminalView
 	CommonEventHandlers_HIViewResizer	containerResizeHandler;		// responds to changes in the terminal view container boundaries
 	CarbonEventHandlerWrap		contextualMenuHandler;		// responds to right-clicks
 	CarbonEventHandlerWrap		rawKeyDownHandler;			// responds to keystrokes that change the text selection
+	TerminalView_Statistics		statistics;					// running totals of rendering work, returned by TerminalView_GetStatistics()
 	
 	struct
 	{
@@ -415,6 +458,13 @@ TerminalView_PixelHeight	heightPerCell;	// number of pixels high each character
 		
 		TerminalView_CellRangeList				searchResults;			// regions matching the most recent Find results
 		TerminalView_CellRangeList::iterator	toCurrentSearchResult;	// most recently focused match; MUST change if "searchResults" changes
+		
+		struct
+		{
+			std::vector< URL_MatchList >	matchesByRow;	// URLs and other patterns on each main screen row (scrollback is not annotated)
+			std::vector< bool >				rowIsStale;		// if true, the list for the corresponding row must be rebuilt before use
+			Boolean							isHighlighted;	// are links underlined (e.g. while the command key is down)?
+		} links;
 	} text;
 	
 	TerminalViewRef		selfRef;				// redundant opaque reference that would resolve to point to this structure
@@ -470,6 +520,7 @@ NSCursor*			customCursorIBeam					(Boolean = false);
 NSCursor*			customCursorMoveTerminalCursor		(Boolean = false);
 void				delayMinimumTicks					(UInt16 = 8);
 OSStatus			dragTextSelection					(My_TerminalViewPtr, RgnHandle, EventRecord*, Boolean*);
+void				drawRowLinks						(My_TerminalViewPtr, CGContextRef);
 void				drawSingleColorImage				(CGContextRef, CGColorRef, CGRect, id);
 void				drawSingleColorPattern				(CGContextRef, CGColorRef, CGRect, id);
 Boolean				drawSection							(My_TerminalViewPtr, CGContextRef, UInt16, TerminalView_RowIndex,
@@ -483,11 +534,15 @@ void				drawVTGraphicsGlyph					(My_TerminalViewPtr, CGContextRef, CGRect const&
 														 CGFloat, TextAttributes_Object);
 void				eraseSection						(My_TerminalViewPtr, CGContextRef, SInt16, SInt16, CGRect&);
 void				eventNotifyForView					(My_TerminalViewConstPtr, TerminalView_Event, void*);
+void				fillWordCharacterClassTable			(My_WordCharacterClassTable&, CFStringRef);
+Boolean				findLinkAtCell						(My_TerminalViewPtr, TerminalView_Cell const&, TerminalView_CellRange&);
 Terminal_LineRef	findRowIterator						(My_TerminalViewPtr, TerminalView_RowIndex, Terminal_LineStackStorage*);
 Terminal_LineRef	findRowIteratorRelativeTo			(My_TerminalViewPtr, TerminalView_RowIndex, TerminalView_RowIndex,
 														 Terminal_LineStackStorage*);
+URL_MatchList const&	findRowLinks					(My_TerminalViewPtr, TerminalView_RowIndex);
 Boolean				findVirtualCellFromLocalPoint		(My_TerminalViewPtr, Point, TerminalView_Cell&, SInt16&, SInt16&);
 Boolean				findVirtualCellFromScreenPoint		(My_TerminalViewPtr, HIPoint, TerminalView_Cell&, SInt16&, SInt16&);
+std::pair< UInt16, UInt16 >	findWordRange				(UniChar const*, UniChar const*, UInt16);
 void				getBlinkAnimationColor				(My_TerminalViewPtr, UInt16, CGDeviceColor*);
 void				getRowBounds						(My_TerminalViewPtr, TerminalView_RowIndex, Rect*);
 TerminalView_PixelWidth		getRowCharacterWidth		(My_TerminalViewPtr, TerminalView_RowIndex);
@@ -513,6 +568,7 @@ void				handlePendingUpdates				();
 void				highlightCurrentSelection			(My_TerminalViewPtr, Boolean, Boolean);
 void				highlightVirtualRange				(My_TerminalViewPtr, TerminalView_CellRange const&, TextAttributes_Object,
 														 Boolean, Boolean);
+void				invalidateLinks						(My_TerminalViewPtr, TerminalView_RowIndex, UInt32);
 void				invalidateRowSection				(My_TerminalViewPtr, TerminalView_RowIndex, UInt16, UInt16);
 Boolean				isMonospacedFont					(FMFontFamily);
 Boolean				isSmallIBeam						(My_TerminalViewPtr);
@@ -559,12 +615,17 @@ void				sortAnchors							(TerminalView_Cell&, TerminalView_Cell&, Boolean);
 Boolean				startMonitoringDataSource			(My_TerminalViewPtr, TerminalScreenRef);
 Boolean				stopMonitoringDataSource			(My_TerminalViewPtr, TerminalScreenRef);
 void				trackTextSelection					(My_TerminalViewPtr, Point, EventModifiers, Point*, UInt32*);
+void				trimWordPunctuation					(UniChar const*, UInt16&, UInt16&);
+std::pair< UInt16, UInt16 >	unitTest_FindWord			(char const*, UInt16);
+Boolean				unitTest_FindWord_000				();
 void				updateDisplay						(My_TerminalViewPtr);
 void				updateDisplayInRegion				(My_TerminalViewPtr, RgnHandle);
 void				updateDisplayTimer					(EventLoopTimerRef, void*);
 void				useTerminalTextAttributes			(My_TerminalViewPtr, CGContextRef, TextAttributes_Object);
 void				useTerminalTextColors				(My_TerminalViewPtr, CGContextRef, TextAttributes_Object, Boolean, Float32 = 1.0);
 void				visualBell							(TerminalViewRef);
+Boolean				writeSelectedText					(My_TerminalViewPtr, UInt16, TerminalView_TextFlags,
+														 Terminal_TextSinkProcPtr, void*);
 
 } // anonymous namespace
 
@@ -629,6 +690,17 @@ Boolean						gTerminalViewInitialized = false;
 My_TerminalViewPtrLocker&	gTerminalViewPtrLocks ()				{ static My_TerminalViewPtrLocker x; return x; }
 RgnHandle					gInvalidationScratchRegion ()			{ static RgnHandle x = NewRgn(); assert(nullptr != x); return x; }
 My_XTerm256Table&			gColorGrid ()							{ static My_XTerm256Table x; return x; }
+My_WordCharacterClassTable&	gWordCharacterClasses ()
+							{
+								static My_WordCharacterClassTable x;
+								
+								
+								if (x.empty())
+								{
+									fillWordCharacterClassTable(x, nullptr/* additional separators */);
+								}
+								return x;
+							}
 
 } // anonymous namespace
 
@@ -718,6 +790,30 @@ TerminalView_Init ()
 		{
 			Console_Warning(Console_WriteValue, "failed to set up global monitor for show-margin-line setting, error", prefsResult);
 		}
+		prefsResult = Preferences_StartMonitoring(gPreferenceChangeEventListener, kPreferences_TagCopySelectedText,
+													true/* call immediately to get initial value */);
+		if (kPreferences_ResultOK != prefsResult)
+		{
+			Console_Warning(Console_WriteValue, "failed to set up global monitor for copy-on-select setting, error", prefsResult);
+		}
+		prefsResult = Preferences_StartMonitoring(gPreferenceChangeEventListener, kPreferences_TagFadeBackgroundWindows,
+													true/* call immediately to get initial value */);
+		if (kPreferences_ResultOK != prefsResult)
+		{
+			Console_Warning(Console_WriteValue, "failed to set up global monitor for fade-in-background setting, error", prefsResult);
+		}
+		prefsResult = Preferences_StartMonitoring(gPreferenceChangeEventListener, kPreferences_TagTerminalResizeAffectsFontSize,
+													true/* call immediately to get initial value */);
+		if (kPreferences_ResultOK != prefsResult)
+		{
+			Console_Warning(Console_WriteValue, "failed to set up global monitor for resize-affects-font setting, error", prefsResult);
+		}
+		prefsResult = Preferences_StartMonitoring(gPreferenceChangeEventListener, kPreferences_TagVisualBell,
+													true/* call immediately to get initial value */);
+		if (kPreferences_ResultOK != prefsResult)
+		{
+			Console_Warning(Console_WriteValue, "failed to set up global monitor for visual-bell setting, error", prefsResult);
+		}
 	}
 	
 	// on older Mac OS X systems, custom cursors do not seem
@@ -760,6 +856,10 @@ TerminalView_Done ()
 	Preferences_StopMonitoring(gPreferenceChangeEventListener, kPreferences_TagPureInverse);
 	Preferences_StopMonitoring(gPreferenceChangeEventListener, kPreferences_TagTerminalCursorType);
 	Preferences_StopMonitoring(gPreferenceChangeEventListener, kPreferences_TagTerminalShowMarginAtColumn);
+	Preferences_StopMonitoring(gPreferenceChangeEventListener, kPreferences_TagCopySelectedText);
+	Preferences_StopMonitoring(gPreferenceChangeEventListener, kPreferences_TagFadeBackgroundWindows);
+	Preferences_StopMonitoring(gPreferenceChangeEventListener, kPreferences_TagTerminalResizeAffectsFontSize);
+	Preferences_StopMonitoring(gPreferenceChangeEventListener, kPreferences_TagVisualBell);
 	ListenerModel_ReleaseListener(&gPreferenceChangeEventListener);
 }// Done
 
@@ -1278,27 +1378,57 @@ TerminalView_DisplaySaveSelectedTextUI	(TerminalViewRef	inView)
 					{
 						if (NSFileHandlingPanelOKButton == aReturnCode)
 						{
-							CFRetainRelease		textSelection(TerminalView_ReturnSelectedTextCopyAsUnicode
-																(inView, 0/* spaces equal to one tab, or zero for no substitution */,
-																	kTerminalView_TextFlagLineSeparatorLF |
-																	kTerminalView_TextFlagLastLineHasSeparator),
-																CFRetainRelease::kAlreadyRetained);
+							// text is streamed into a temporary file in the same
+							// directory and only renamed over the destination once
+							// it is complete, so that a failure part-way through
+							// (e.g. a full disk) never destroys an existing file
+							std::string		targetPath([[savePanel.URL path] fileSystemRepresentation]);
+							std::string		temporaryPath(targetPath + ".XXXXXX");
+							int				fileDescriptor = mkstemp(&temporaryPath[0]);
 							
 							
-							if (textSelection.exists())
+							if (fileDescriptor < 0)
 							{
-								NSString*	asNSString = BRIDGE_CAST
-															(textSelection.returnCFStringRef(), NSString*);
-								NSError*	error = nil;
+								Sound_StandardAlert();
+								Console_Warning(Console_WriteValue, "failed to open file for selected text, errno", errno);
+							}
+							else
+							{
+								mode_t		oldMask = umask(0);
+								bool		saveOK = false;
+								
 								
+								// "mkstemp()" always creates a private file; give
+								// the result the same permissions as any new file
+								umask(oldMask);
+								UNUSED_RETURN(int)fchmod(fileDescriptor, 0666 & ~oldMask);
+								
+								// text is streamed directly to the file so that even
+								// very large selections do not have to be duplicated
+								saveOK = TerminalView_WriteSelectedText
+											(inView, 0/* spaces equal to one tab, or zero for no substitution */,
+												kTerminalView_TextFlagLineSeparatorLF |
+												kTerminalView_TextFlagLastLineHasSeparator,
+												Terminal_TextSinkToFileDescriptor, &fileDescriptor);
+								if (saveOK)
+								{
+									saveOK = (0 == fsync(fileDescriptor));
+								}
+								if (0 != close(fileDescriptor))
+								{
+									saveOK = false;
+								}
+								fileDescriptor = -1;
+								if (saveOK)
+								{
+									saveOK = (0 == rename(temporaryPath.c_str(), targetPath.c_str()));
+								}
 								
-								if (NO == [asNSString writeToURL:savePanel.URL atomically:YES
-														encoding:NSUTF8StringEncoding error:&error])
+								unless (saveOK)
 								{
 									Sound_StandardAlert();
-									Console_Warning(Console_WriteValueCFString,
-													"failed to save selected text to file, error",
-													BRIDGE_CAST([error localizedDescription], CFStringRef));
+									Console_Warning(Console_WriteValue, "failed to save selected text to file, errno", errno);
+									UNUSED_RETURN(int)unlink(temporaryPath.c_str());
 								}
 							}
 						}
@@ -1787,6 +1917,37 @@ TerminalView_GetSelectedTextAsVirtualRange	(TerminalViewRef			inView,
 }// GetSelectedTextAsVirtualRange
 
 
+/*!
+Copies the running rendering totals of the specified view,
+such as the time spent drawing.  The totals are maintained
+unconditionally, since they cost only a clock read per
+frame.
+
+\retval kTerminalView_ResultOK
+if no error occurred
+
+\retval kTerminalView_ResultInvalidID
+if the view reference is unrecognized
+
+(2017.10)
+*/
+TerminalView_Result
+TerminalView_GetStatistics	(TerminalViewRef			inView,
+							 TerminalView_Statistics&	outStatistics)
+{
+	TerminalView_Result			result = kTerminalView_ResultOK;
+	My_TerminalViewAutoLocker	viewPtr(gTerminalViewPtrLocks(), inView);
+	
+	
+	if (nullptr == viewPtr) result = kTerminalView_ResultInvalidID;
+	else
+	{
+		outStatistics = viewPtr->statistics;
+	}
+	return result;
+}// GetStatistics
+
+
 /*!
 Calculates the number of rows and columns that the
 specified screen, using its current font metrics,
@@ -2662,6 +2823,28 @@ TerminalView_RotateSearchResultHighlight	(TerminalViewRef	inView,
 }// RotateSearchResultHighlight
 
 
+/*!
+A unit test suite for this module.  Results are
+printed to the console.
+
+The word tests temporarily change the word separators,
+and restore the default before returning.
+
+(2017.10)
+*/
+void
+TerminalView_RunTests ()
+{
+	UInt16		totalTests = 0;
+	UInt16		failedTests = 0;
+	
+	
+	++totalTests; if (false == unitTest_FindWord_000()) ++failedTests;
+	
+	Console_WriteUnitTestReport("Terminal View", failedTests, totalTests);
+}// RunTests
+
+
 /*!
 Scrolls the contents of the terminal screen both
 horizontally and vertically.  If a delta is negative,
@@ -3765,6 +3948,24 @@ TerminalView_SetUserInteractionEnabled	(TerminalViewRef	inView,
 }// SetUserInteractionEnabled
 
 
+/*!
+Specifies characters that separate words (in addition to
+white space, which always separates words) when text is
+selected by double-clicking in any terminal view.  Pass
+nullptr or an empty string to restore the default.
+
+Even if separators are defined, a double-click on any part
+of a URL will still select the whole URL.
+
+(2017.10)
+*/
+void
+TerminalView_SetWordSeparatorCharacters		(CFStringRef	inCharactersOrNull)
+{
+	fillWordCharacterClassTable(gWordCharacterClasses(), inCharactersOrNull);
+}// SetWordSeparatorCharacters
+
+
 /*!
 Arranges for a callback to be invoked whenever an event
 occurs on a view (such as scrolling).
@@ -3923,6 +4124,40 @@ TerminalView_TranslateTerminalScreenRange	(TerminalViewRef					inView,
 }// TranslateTerminalScreenRange
 
 
+/*!
+Writes all selected text from the specified view to the given
+sink, in UTF-8 encoding, without creating any intermediate
+strings.  This is the most efficient way to capture a large
+selection (e.g. to save it to a file).
+
+The flags and tab-substitution rules are the same as those of
+TerminalView_ReturnSelectedTextCopyAsUnicode().  If there is no
+selection, the sink is not invoked and the result is true.
+
+Returns false only if the text could not be completely written
+(e.g. the sink aborted the operation).
+
+(2017.10)
+*/
+Boolean
+TerminalView_WriteSelectedText	(TerminalViewRef			inView,
+								 UInt16						inMaxSpacesToReplaceWithTabOrZero,
+								 TerminalView_TextFlags		inFlags,
+								 Terminal_TextSinkProcPtr	inSink,
+								 void*						inSinkContextPtr)
+{
+	My_TerminalViewAutoLocker	viewPtr(gTerminalViewPtrLocks(), inView);
+	Boolean						result = false;
+	
+	
+	if (nullptr != viewPtr)
+	{
+		result = writeSelectedText(viewPtr, inMaxSpacesToReplaceWithTabOrZero, inFlags, inSink, inSinkContextPtr);
+	}
+	return result;
+}// WriteSelectedText
+
+
 /*!
 Displays an “opening” animation from the current text selection.
 This is currently used for opening URLs.
@@ -4329,6 +4564,7 @@ contentHIView(inSuperclassViewInstance),
 containerResizeHandler(), // set later
 contextualMenuHandler(),
 rawKeyDownHandler(),
+statistics(),
 selfRef(REINTERPRET_CAST(this, TerminalViewRef))
 {
 }// My_TerminalView 1-argument constructor (HIViewRef)
@@ -4376,6 +4612,7 @@ contentHIView(nullptr),
 containerResizeHandler(), // set later
 contextualMenuHandler(),
 rawKeyDownHandler(),
+statistics(),
 selfRef(REINTERPRET_CAST(this, TerminalViewRef))
 {
 }// My_TerminalView 1-argument constructor (NSView*)
@@ -4420,20 +4657,8 @@ initialize		(TerminalScreenRef			inScreenDataSource,
 	this->changeListenerModel = ListenerModel_New(kListenerModel_StyleStandard,
 													kConstantsRegistry_ListenerModelDescriptorTerminalViewChanges);
 	
-	// automatically read the user preference for window resize behavior
-	// and initialize appropriately
-	{
-		Boolean		affectsFontSize = false;
-		
-		
-		if (kPreferences_ResultOK !=
-			Preferences_GetData(kPreferences_TagTerminalResizeAffectsFontSize, sizeof(affectsFontSize), &affectsFontSize))
-		{
-			// assume a default, if the value cannot be found...
-			affectsFontSize = false;
-		}
-		this->displayMode = (affectsFontSize) ? kTerminalView_DisplayModeZoom : kTerminalView_DisplayModeNormal;
-	}
+	// initialize according to the user preference for window resize behavior
+	this->displayMode = (gPreferenceProxies.resizeAffectsFontSize) ? kTerminalView_DisplayModeZoom : kTerminalView_DisplayModeNormal;
 	
 	// retain the screen reference
 	this->screen.ref = nullptr; // initially (asserted by addDataSource())
@@ -4467,6 +4692,7 @@ initialize		(TerminalScreenRef			inScreenDataSource,
 	this->screen.cursor.isCustomColor = false;
 	this->screen.currentRenderContext = nullptr;
 	this->text.toCurrentSearchResult = this->text.searchResults.end();
+	this->text.links.isHighlighted = false;
 	
 	// read user preferences for the spacing around the edges
 	{
@@ -5343,19 +5569,9 @@ Use this when the user changes the text selection.
 void
 copySelectedTextIfUserPreference	(My_TerminalViewPtr		inTerminalViewPtr)
 {
-	if (inTerminalViewPtr->text.selection.exists)
+	if ((inTerminalViewPtr->text.selection.exists) && (gPreferenceProxies.copySelectedText))
 	{
-		Boolean		copySelectedText = false;
-		
-		
-		unless (kPreferences_ResultOK ==
-				Preferences_GetData(kPreferences_TagCopySelectedText, sizeof(copySelectedText),
-									&copySelectedText))
-		{
-			copySelectedText = false; // assume text isn’t automatically copied, if preference can’t be found
-		}
-		
-		if (copySelectedText) Clipboard_TextToScrap(inTerminalViewPtr->selfRef, kClipboard_CopyMethodStandard);
+		Clipboard_TextToScrap(inTerminalViewPtr->selfRef, kClipboard_CopyMethodStandard);
 	}
 }// copySelectedTextIfUserPreference
 
@@ -5633,6 +5849,45 @@ dragTextSelection	(My_TerminalViewPtr		inTerminalViewPtr,
 }// dragTextSelection
 
 
+/*!
+Underlines every link (see findRowLinks()) on the row that
+is currently being drawn.  This only has an effect during a
+drawSection() call.
+
+(2017.10)
+*/
+void
+drawRowLinks	(My_TerminalViewPtr		inTerminalViewPtr,
+				 CGContextRef			inDrawingContext)
+{
+	URL_MatchList const&	kLinks = findRowLinks(inTerminalViewPtr, inTerminalViewPtr->screen.currentRenderedLine +
+																		inTerminalViewPtr->screen.topVisibleEdgeInRows);
+	
+	
+	if ((nullptr != inDrawingContext) && (false == kLinks.empty()))
+	{
+		CGDeviceColor const&	kLinkColor = inTerminalViewPtr->text.colors[kMyBasicColorIndexNormalText];
+		
+		
+		CGContextSetRGBStrokeColor(inDrawingContext, kLinkColor.red, kLinkColor.green, kLinkColor.blue, 1.0/* alpha */);
+		CGContextSetLineWidth(inDrawingContext, 1.0);
+		for (auto const& kLink : kLinks)
+		{
+			Rect		linkBounds;
+			CGFloat		baseline = 0;
+			
+			
+			getRowSectionBounds(inTerminalViewPtr, inTerminalViewPtr->screen.currentRenderedLine,
+								kLink.offset, kLink.length, &linkBounds);
+			baseline = linkBounds.bottom - 1.5f;
+			CGContextMoveToPoint(inDrawingContext, linkBounds.left, baseline);
+			CGContextAddLineToPoint(inDrawingContext, linkBounds.right, baseline);
+		}
+		CGContextStrokePath(inDrawingContext);
+	}
+}// drawRowLinks
+
+
 /*!
 Redraws the specified part of the given view.  Returns
 "true" only if the text was drawn successfully.
@@ -5731,6 +5986,10 @@ drawSection		(My_TerminalViewPtr		inTerminalViewPtr,
 					else
 					{
 						result = true;
+						if (inTerminalViewPtr->text.links.isHighlighted)
+						{
+							drawRowLinks(inTerminalViewPtr, inDrawingContext);
+						}
 					}
 					
 					// since double-width text is a row-wide attribute, it must be applied
@@ -6198,7 +6457,10 @@ drawTerminalText	(My_TerminalViewPtr			inTerminalViewPtr,
 	else
 	{
 		// TEMPORARY: Unicode imaging is not supported yet, so the data
-		// must first be converted into Mac Roman so QuickDraw can use it
+		// must first be converted into Mac Roman so QuickDraw can use it;
+		// note that the string can be shorter than the column count (e.g.
+		// because a double-width character spans two columns)
+		CFIndex const	kCharacterCount = std::min(inCharacterCount, CFStringGetLength(inTextBufferAsCFString));
 		char const*		oldMacRomanBufferForQuickDraw = CFStringGetCStringPtr(inTextBufferAsCFString, kCFStringEncodingMacRoman);
 		UInt8*			deletedBufferPtr = nullptr;
 		
@@ -6208,13 +6470,13 @@ drawTerminalText	(My_TerminalViewPtr			inTerminalViewPtr,
 			// TEMPORARY (convert renderer to Unicode!)
 			// not ideal, but if the internal buffer is not a byte array,
 			// it must be copied before it can be interpreted that way
-			deletedBufferPtr = new UInt8[inCharacterCount];
+			deletedBufferPtr = new UInt8[kCharacterCount];
 			
 			CFIndex		bytesUsed = 0;
-			CFIndex		conversionResult = CFStringGetBytes(inTextBufferAsCFString, CFRangeMake(0, inCharacterCount),
+			CFIndex		conversionResult = CFStringGetBytes(inTextBufferAsCFString, CFRangeMake(0, kCharacterCount),
 															kCFStringEncodingMacRoman, '?'/* loss byte */,
 															false/* is external representation */,
-															deletedBufferPtr, inCharacterCount, &bytesUsed);
+															deletedBufferPtr, kCharacterCount, &bytesUsed);
 			if (conversionResult > 0)
 			{
 				oldMacRomanBufferForQuickDraw = REINTERPRET_CAST(deletedBufferPtr, char*);
@@ -6282,7 +6544,7 @@ drawTerminalText	(My_TerminalViewPtr			inTerminalViewPtr,
 			if (terminalFontSize == kArbitraryDoubleWidthDoubleHeightPseudoFontSize)
 			{
 				// top half of double-sized text; this is not rendered, but the pen should move double the distance anyway
-				Move(STATIC_CAST(inCharacterCount * INTEGER_TIMES_2(inTerminalViewPtr->text.font.widthPerCell.integralPixels()), SInt16), 0);
+				Move(STATIC_CAST(kCharacterCount * INTEGER_TIMES_2(inTerminalViewPtr->text.font.widthPerCell.integralPixels()), SInt16), 0);
 			}
 			else if (terminalFontSize == inTerminalViewPtr->text.font.doubleMetrics.size)
 			{
@@ -6296,7 +6558,7 @@ drawTerminalText	(My_TerminalViewPtr			inTerminalViewPtr,
 															inBoundaries.size.height/*INTEGER_TIMES_2(inTerminalViewPtr->text.font.heightPerCell)*/ + 4);
 				
 				
-				for (i = 0; i < inCharacterCount; ++i)
+				for (i = 0; i < kCharacterCount; ++i)
 				{
 					GetPen(&oldPen);
 					if (terminalFontID == kArbitraryVTGraphicsPseudoFontID)
@@ -6331,7 +6593,7 @@ drawTerminalText	(My_TerminalViewPtr			inTerminalViewPtr,
 															inBoundaries.size.height/*inTerminalViewPtr->text.font.heightPerCell.precisePixels()*/ + 4);
 				
 				
-				for (i = 0; i < inCharacterCount; ++i)
+				for (i = 0; i < kCharacterCount; ++i)
 				{
 					char const	thisChar = *(oldMacRomanBufferForQuickDraw + i);
 					SInt16		offset = 0;
@@ -6436,7 +6698,7 @@ drawTerminalText	(My_TerminalViewPtr			inTerminalViewPtr,
 				// fastest if rendered all at once using a single QuickDraw call, and since there are no
 				// forced font metrics with normal text, this can be a lot simpler (this is also almost
 				// certainly the common case, so it’s good if this is as efficient as possible)
-				DrawText(oldMacRomanBufferForQuickDraw, 0/* offset */, STATIC_CAST(inCharacterCount, short)); // draw text using current font, size, color, etc.
+				DrawText(oldMacRomanBufferForQuickDraw, 0/* offset */, STATIC_CAST(kCharacterCount, short)); // draw text using current font, size, color, etc.
 			}
 		}
 		
@@ -7372,6 +7634,108 @@ eventNotifyForView	(My_TerminalViewConstPtr	inPtr,
 }// eventNotifyForView
 
 
+/*!
+Initializes the given table so that it has a word character
+class for every possible UniChar.  Any characters in the given
+string (which may be nullptr) are classified as separators.
+
+The table is built once (and whenever the separators change)
+so that double-clicks only need a simple lookup per character.
+
+(2017.10)
+*/
+void
+fillWordCharacterClassTable		(My_WordCharacterClassTable&	inoutTable,
+								 CFStringRef					inAdditionalSeparatorsOrNull)
+{
+	CFCharacterSetRef const		kWhitespaceSet = CFCharacterSetGetPredefined(kCFCharacterSetWhitespaceAndNewline);
+	CFCharacterSetRef const		kControlSet = CFCharacterSetGetPredefined(kCFCharacterSetControl);
+	
+	
+	inoutTable.resize(1 << (8 * sizeof(UniChar)));
+	for (size_t i = 0; i < inoutTable.size(); ++i)
+	{
+		UniChar const	kCharacter = STATIC_CAST(i, UniChar);
+		
+		
+		if (CFCharacterSetIsCharacterMember(kWhitespaceSet, kCharacter) ||
+			CFCharacterSetIsCharacterMember(kControlSet, kCharacter))
+		{
+			inoutTable[i] = kMy_WordCharacterClassSpace;
+		}
+		else
+		{
+			inoutTable[i] = kMy_WordCharacterClassWord;
+		}
+	}
+	inoutTable['.'] = kMy_WordCharacterClassEndPunctuation;
+	inoutTable[','] = kMy_WordCharacterClassEndPunctuation;
+	inoutTable[';'] = kMy_WordCharacterClassEndPunctuation;
+	inoutTable[':'] = kMy_WordCharacterClassEndPunctuation;
+	inoutTable['('] = kMy_WordCharacterClassOpenParenthesis;
+	inoutTable[')'] = kMy_WordCharacterClassCloseParenthesis;
+	inoutTable['['] = kMy_WordCharacterClassOpenBracket;
+	inoutTable[']'] = kMy_WordCharacterClassCloseBracket;
+	inoutTable['{'] = kMy_WordCharacterClassOpenBrace;
+	inoutTable['}'] = kMy_WordCharacterClassCloseBrace;
+	inoutTable['<'] = kMy_WordCharacterClassOpenAngle;
+	inoutTable['>'] = kMy_WordCharacterClassCloseAngle;
+	inoutTable['"'] = kMy_WordCharacterClassDoubleQuote;
+	inoutTable['\''] = kMy_WordCharacterClassApostrophe;
+	inoutTable['`'] = kMy_WordCharacterClassBackquote;
+	
+	if (nullptr != inAdditionalSeparatorsOrNull)
+	{
+		CFIndex const	kLength = CFStringGetLength(inAdditionalSeparatorsOrNull);
+		
+		
+		for (CFIndex i = 0; i < kLength; ++i)
+		{
+			UniChar const	kCharacter = CFStringGetCharacterAtIndex(inAdditionalSeparatorsOrNull, i);
+			
+			
+			unless (kMy_WordCharacterClassSpace == inoutTable[kCharacter])
+			{
+				inoutTable[kCharacter] = kMy_WordCharacterClassSeparator;
+			}
+		}
+	}
+}// fillWordCharacterClassTable
+
+
+/*!
+Returns true only if the given cell is part of a link (such
+as a URL) and in that case defines the range of the link.
+
+Since links are found in advance for each row (see
+findRowLinks()), this is fast enough to use whenever the
+mouse moves.
+
+(2017.10)
+*/
+Boolean
+findLinkAtCell	(My_TerminalViewPtr			inTerminalViewPtr,
+				 TerminalView_Cell const&	inCell,
+				 TerminalView_CellRange&	outLinkRange)
+{
+	URL_MatchList const&	kLinks = findRowLinks(inTerminalViewPtr, inCell.second);
+	Boolean					result = false;
+	
+	
+	for (auto const& kLink : kLinks)
+	{
+		if ((inCell.first >= kLink.offset) && (inCell.first < (kLink.offset + kLink.length)))
+		{
+			outLinkRange.first = std::make_pair(kLink.offset, inCell.second);
+			outLinkRange.second = std::make_pair(STATIC_CAST(kLink.offset + kLink.length, UInt16), inCell.second + 1);
+			result = true;
+			break;
+		}
+	}
+	return result;
+}// findLinkAtCell
+
+
 /*!
 Returns the terminal buffer iterator for the specified line,
 which is relative to the currently visible portion of the
@@ -7468,6 +7832,59 @@ findRowIteratorRelativeTo	(My_TerminalViewPtr				inTerminalViewPtr,
 }// findRowIteratorRelativeTo
 
 
+/*!
+Returns all links (such as URLs) on the specified row of
+the main screen; scrollback rows never have links.
+
+The list is only rebuilt if the row has changed since the
+last time it was requested (see invalidateLinks()), so the
+cost of pattern matching is only paid for rows that change
+and are actually used.
+
+(2017.10)
+*/
+URL_MatchList const&
+findRowLinks	(My_TerminalViewPtr		inTerminalViewPtr,
+				 TerminalView_RowIndex	inZeroBasedRowIndex)
+{
+	static URL_MatchList const	kNoLinks;
+	UInt16 const				kRowCount = Terminal_ReturnRowCount(inTerminalViewPtr->screen.ref);
+	auto&						links = inTerminalViewPtr->text.links;
+	
+	
+	if ((inZeroBasedRowIndex < 0) || (inZeroBasedRowIndex >= kRowCount))
+	{
+		return kNoLinks;
+	}
+	
+	if (links.matchesByRow.size() != kRowCount)
+	{
+		links.matchesByRow.assign(kRowCount, URL_MatchList());
+		links.rowIsStale.assign(kRowCount, true);
+	}
+	
+	if (links.rowIsStale[inZeroBasedRowIndex])
+	{
+		Terminal_LineStackStorage	lineIteratorData;
+		Terminal_LineRef			lineIterator = findRowIteratorRelativeTo(inTerminalViewPtr, inZeroBasedRowIndex,
+																				0/* origin row */, &lineIteratorData);
+		UniChar const*				textStart = nullptr;
+		UniChar const*				textPastEnd = nullptr;
+		
+		
+		links.matchesByRow[inZeroBasedRowIndex].clear();
+		if ((nullptr != lineIterator) &&
+			(kTerminal_ResultOK == Terminal_GetLine(inTerminalViewPtr->screen.ref, lineIterator, textStart, textPastEnd, 0/* flags */)))
+		{
+			URL_FindMatchesInCharacterRange(textStart, textPastEnd, links.matchesByRow[inZeroBasedRowIndex]);
+		}
+		releaseRowIterator(inTerminalViewPtr, &lineIterator);
+		links.rowIsStale[inZeroBasedRowIndex] = false;
+	}
+	return links.matchesByRow[inZeroBasedRowIndex];
+}// findRowLinks
+
+
 /*!
 Finds the cell position in the visible screen area of
 the indicated window that is closest to the given point.
@@ -7652,6 +8069,109 @@ findVirtualCellFromScreenPoint	(My_TerminalViewPtr		inTerminalViewPtr,
 }// findVirtualCellFromScreenPoint
 
 
+/*!
+Returns the zero-based offset and character count of the word
+that includes the specified character in the given text.  If
+there is no word (e.g. the offset is out of range), the pair
+holds the original offset and a count of 1.
+
+A word is normally a run of characters surrounded by white
+space or user-defined separators (see the routine
+TerminalView_SetWordSeparatorCharacters()).  If the offset is
+itself on a separator, the run of separators is the “word”.
+Surrounding punctuation and unbalanced quotation marks or
+parentheses are then removed (see trimWordPunctuation()).
+
+A word that is part of a URL is extended to include the whole
+URL, even if the URL contains user-defined separators.
+
+This is designed to match the results of the original Python
+routine "pymacterm.term_text.find_word()", without the cost of
+calling into the Python interpreter on every double-click.
+
+(2017.10)
+*/
+std::pair< UInt16, UInt16 >
+findWordRange	(UniChar const*		inTextStart,
+				 UniChar const*		inTextPastEnd,
+				 UInt16				inOffset)
+{
+	My_WordCharacterClassTable const&	kClasses = gWordCharacterClasses();
+	UInt16 const						kLength = STATIC_CAST(inTextPastEnd - inTextStart, UInt16);
+	std::pair< UInt16, UInt16 >			result = std::make_pair(inOffset, 1);
+	
+	
+	if (inOffset < kLength)
+	{
+		auto			isSeparator = [&](UInt16 inIndex) -> Boolean
+										{
+											My_WordCharacterClass const		kClass = kClasses[inTextStart[inIndex]];
+											
+											
+											return ((kMy_WordCharacterClassSpace == kClass) ||
+													(kMy_WordCharacterClassSeparator == kClass));
+										};
+		Boolean const	kInvert = isSeparator(inOffset);
+		UInt16			first = inOffset;
+		UInt16			pastEnd = inOffset + 1;
+		
+		
+		// special case; when starting on non-word characters, look for all
+		// non-word characters
+		while ((first > 0) && (kInvert == isSeparator(first - 1)))
+		{
+			--first;
+		}
+		while ((pastEnd < kLength) && (kInvert == isSeparator(pastEnd)))
+		{
+			++pastEnd;
+		}
+		
+		unless (kInvert)
+		{
+			UInt16		tokenFirst = first;
+			UInt16		tokenPastEnd = pastEnd;
+			
+			
+			// find the text between white space around the word; if that
+			// is a URL, select the entire URL (this only matters if
+			// other separators have been defined)
+			while ((tokenFirst > 0) && (kMy_WordCharacterClassSpace != kClasses[inTextStart[tokenFirst - 1]]))
+			{
+				--tokenFirst;
+			}
+			while ((tokenPastEnd < kLength) && (kMy_WordCharacterClassSpace != kClasses[inTextStart[tokenPastEnd]]))
+			{
+				++tokenPastEnd;
+			}
+			if ((tokenFirst != first) || (tokenPastEnd != pastEnd))
+			{
+				CFRetainRelease		tokenCFString(CFStringCreateWithCharactersNoCopy
+													(kCFAllocatorDefault, inTextStart + tokenFirst, tokenPastEnd - tokenFirst,
+														kCFAllocatorNull/* deallocator */),
+													CFRetainRelease::kAlreadyRetained);
+				
+				
+				if (tokenCFString.exists() &&
+					((kCFNotFound != CFStringFind(tokenCFString.returnCFStringRef(), CFSTR("://"), 0).location) ||
+						CFStringHasPrefix(tokenCFString.returnCFStringRef(), CFSTR("www.")) ||
+						CFStringHasPrefix(tokenCFString.returnCFStringRef(), CFSTR("mailto:"))))
+				{
+					first = tokenFirst;
+					pastEnd = tokenPastEnd;
+				}
+			}
+			
+			trimWordPunctuation(inTextStart, first, pastEnd);
+		}
+		
+		result.first = first;
+		result.second = pastEnd - first;
+	}
+	return result;
+}// findWordRange
+
+
 /*!
 Given a stage of blink animation, returns its rendering color.
 
@@ -8652,7 +9172,94 @@ handleMultiClick	(My_TerminalViewPtr		inTerminalViewPtr,
 		// and the range is exclusive so the row difference must be 1
 		selectionPastEnd.second = selectionStart.second + 1;
 		
-		if (inClickCount == 2)
+		if ((inClickCount == 2) && (false == Quills::Terminal::_has_seekword_call()))
+		{
+			// double-click; find the word natively, joining adjacent rows
+			// when a word appears to wrap across the edge of the screen
+			// (there is no record of soft wraps so this is only attempted
+			// if the terminal is wrapping lines and the word touches an
+			// edge; rectangular selections never cross rows)
+			Boolean const				kMayJoinRows = ((false == inTerminalViewPtr->text.selection.isRectangular) &&
+														(Terminal_LineWrapIsEnabled(inTerminalViewPtr->screen.ref)));
+			std::vector< UniChar >		rowText;
+			std::vector< UniChar >		joinedText;
+			TerminalView_RowIndex		firstRow = selectionStart.second;
+			TerminalView_RowIndex		lastRow = selectionStart.second;
+			auto						copyRow = [&](TerminalView_RowIndex inRow, std::vector< UniChar >& outText) -> Boolean
+										{
+											Terminal_LineStackStorage	lineIteratorData;
+											Terminal_LineRef			lineIterator = findRowIteratorRelativeTo
+																						(inTerminalViewPtr, inRow, 0/* origin row */,
+																							&lineIteratorData);
+											UniChar const*				textStart = nullptr;
+											UniChar const*				textPastEnd = nullptr;
+											Boolean						copyOK = false;
+											
+											
+											if ((nullptr != lineIterator) &&
+												(kTerminal_ResultOK == Terminal_GetLine(inTerminalViewPtr->screen.ref, lineIterator,
+																						textStart, textPastEnd, 0/* flags */)))
+											{
+												outText.assign(textStart, textPastEnd);
+												copyOK = (outText.size() == STATIC_CAST(kColumnCount, size_t));
+											}
+											releaseRowIterator(inTerminalViewPtr, &lineIterator);
+											return copyOK;
+										};
+			auto						isSeparator = [](UniChar inCharacter) -> Boolean
+										{
+											My_WordCharacterClass const		kClass = gWordCharacterClasses()[inCharacter];
+											
+											
+											return ((kMy_WordCharacterClassSpace == kClass) ||
+													(kMy_WordCharacterClassSeparator == kClass));
+										};
+			
+			
+			if (copyRow(selectionStart.second, joinedText))
+			{
+				std::pair< UInt16, UInt16 >		wordInfo;
+				size_t							clickOffset = selectionStart.first;
+				
+				
+				if (kMayJoinRows && (clickOffset < joinedText.size()) && (false == isSeparator(joinedText[clickOffset])))
+				{
+					// join preceding rows while a word spans the boundary
+					while ((joinedText.size() < (kMy_MaximumWordContinuationRows * STATIC_CAST(kColumnCount, size_t))) &&
+							(false == isSeparator(joinedText.front())) &&
+							copyRow(firstRow - 1, rowText) && (false == isSeparator(rowText.back())))
+					{
+						joinedText.insert(joinedText.begin(), rowText.begin(), rowText.end());
+						clickOffset += rowText.size();
+						--firstRow;
+					}
+					
+					// join following rows while a word spans the boundary
+					while ((joinedText.size() < (2 * kMy_MaximumWordContinuationRows * STATIC_CAST(kColumnCount, size_t))) &&
+							(false == isSeparator(joinedText.back())) &&
+							copyRow(lastRow + 1, rowText) && (false == isSeparator(rowText.front())))
+					{
+						joinedText.insert(joinedText.end(), rowText.begin(), rowText.end());
+						++lastRow;
+					}
+				}
+				
+				wordInfo = findWordRange(joinedText.data(), joinedText.data() + joinedText.size(), STATIC_CAST(clickOffset, UInt16));
+				if ((wordInfo.second > 0) && ((wordInfo.first + wordInfo.second) <= joinedText.size()))
+				{
+					UInt16 const	kLastOffset = wordInfo.first + wordInfo.second - 1;
+					
+					
+					// since every joined row is exactly one screen wide,
+					// offsets map directly to cells
+					selectionStart.first = wordInfo.first % kColumnCount;
+					selectionStart.second = firstRow + (wordInfo.first / kColumnCount);
+					selectionPastEnd.first = (kLastOffset % kColumnCount) + 1;
+					selectionPastEnd.second = firstRow + (kLastOffset / kColumnCount) + 1;
+				}
+			}
+		}
+		else if (inClickCount == 2)
 		{
 			// double-click; invoke the registered Python word-finding callback
 			// to determine which text should be selected
@@ -8668,10 +9275,8 @@ handleMultiClick	(My_TerminalViewPtr		inTerminalViewPtr,
 			if (inTerminalViewPtr->text.selection.isRectangular) flags |= kTerminal_TextCopyFlagsRectangular;
 			
 			// double-click - select a word; or, do intelligent double-click
-			// based on the character underneath the cursor
-			// TEMPORARY; only one line is examined, but this is probably
-			// more useful if it joins at least the preceding line, and
-			// possible the following line as well
+			// based on the character underneath the cursor (a Python
+			// routine only ever sees one line)
 			if (kTerminal_ResultOK ==
 				Terminal_GetLine(inTerminalViewPtr->screen.ref, lineIterator, textStart, textPastEnd, flags))
 			{
@@ -9060,6 +9665,30 @@ highlightVirtualRange	(My_TerminalViewPtr				inTerminalViewPtr,
 }// highlightVirtualRange
 
 
+/*!
+Marks the links of the given main screen rows as out of date,
+so that the next findRowLinks() call for any of those rows will
+search the row again.  Rows outside the main screen are ignored.
+
+(2017.10)
+*/
+void
+invalidateLinks		(My_TerminalViewPtr		inTerminalViewPtr,
+					 TerminalView_RowIndex	inFirstRow,
+					 UInt32					inRowCount)
+{
+	std::vector< bool >&	staleFlags = inTerminalViewPtr->text.links.rowIsStale;
+	TerminalView_RowIndex	pastEndRow = std::min(STATIC_CAST(inFirstRow + inRowCount, TerminalView_RowIndex),
+													STATIC_CAST(staleFlags.size(), TerminalView_RowIndex));
+	
+	
+	for (TerminalView_RowIndex i = std::max(inFirstRow, 0); i < pastEndRow; ++i)
+	{
+		staleFlags[i] = true;
+	}
+}// invalidateLinks
+
+
 /*!
 Marks a portion of text from a single line as requiring
 rendering.  If the specified terminal view currently has
@@ -9244,22 +9873,14 @@ mainEventLoopEvent	(ListenerModel_Ref		UNUSED_ARGUMENT(inUnusedModel),
 	{
 	case kEventLoop_GlobalEventSuspendResume:
 		{
-			Boolean		fadeWindows = false;
 			Float32		alpha = 1.0;
 			
 			
 			// update the internal variable to reflect the current suspended state of the application
 			gApplicationIsSuspended = FlagManager_Test(kFlagSuspended);
 			
-			unless (kPreferences_ResultOK ==
-					Preferences_GetData(kPreferences_TagFadeBackgroundWindows,
-					sizeof(fadeWindows), &fadeWindows))
-			{
-				fadeWindows = false; // assume a value, if preference can’t be found
-			}
-			
 			// modify windows
-			if (fadeWindows)
+			if (gPreferenceProxies.fadeBackgroundWindows)
 			{
 				Float32		fadeAlpha = 1.0;
 				
@@ -9736,6 +10357,48 @@ preferenceChanged	(ListenerModel_Ref		UNUSED_ARGUMENT(inUnusedModel),
 		}
 		break;
 	
+	case kPreferences_TagCopySelectedText:
+		// update global variable with current preference value
+		unless (kPreferences_ResultOK ==
+				Preferences_GetData(kPreferences_TagCopySelectedText, sizeof(gPreferenceProxies.copySelectedText),
+									&gPreferenceProxies.copySelectedText))
+		{
+			gPreferenceProxies.copySelectedText = false; // assume text isn’t automatically copied, if preference can’t be found
+		}
+		break;
+	
+	case kPreferences_TagFadeBackgroundWindows:
+		// update global variable with current preference value
+		unless (kPreferences_ResultOK ==
+				Preferences_GetData(kPreferences_TagFadeBackgroundWindows, sizeof(gPreferenceProxies.fadeBackgroundWindows),
+									&gPreferenceProxies.fadeBackgroundWindows))
+		{
+			gPreferenceProxies.fadeBackgroundWindows = false; // assume a value, if preference can’t be found
+		}
+		break;
+	
+	case kPreferences_TagTerminalResizeAffectsFontSize:
+		// update global variable with current preference value (the
+		// display mode of existing views is changed separately, by
+		// preferenceChangedForView())
+		unless (kPreferences_ResultOK ==
+				Preferences_GetData(kPreferences_TagTerminalResizeAffectsFontSize, sizeof(gPreferenceProxies.resizeAffectsFontSize),
+									&gPreferenceProxies.resizeAffectsFontSize))
+		{
+			gPreferenceProxies.resizeAffectsFontSize = false; // assume a value, if preference can’t be found
+		}
+		break;
+	
+	case kPreferences_TagVisualBell:
+		// update global variable with current preference value
+		unless (kPreferences_ResultOK ==
+				Preferences_GetData(kPreferences_TagVisualBell, sizeof(gPreferenceProxies.visualBellOnly),
+									&gPreferenceProxies.visualBellOnly))
+		{
+			gPreferenceProxies.visualBellOnly = false; // assume audible bell, if preference can’t be found
+		}
+		break;
+	
 	default:
 		// ???
 		break;
@@ -10561,10 +11224,11 @@ receiveTerminalViewDraw		(EventHandlerCallRef	UNUSED_ARGUMENT(inHandlerCallRef),
 				// draw text
 				if (nullptr != viewPtr)
 				{
-					Rect		clipBounds;
-					HIRect		floatBounds;
-					CGRect		floatClipBounds;
-					HIShapeRef	optionalTargetShape = nullptr;
+					CFAbsoluteTime const	kStartTime = CFAbsoluteTimeGetCurrent();
+					Rect					clipBounds;
+					HIRect					floatBounds;
+					CGRect					floatClipBounds;
+					HIShapeRef				optionalTargetShape = nullptr;
 					
 					
 					SetPort(drawingPort);
@@ -10845,6 +11509,9 @@ receiveTerminalViewDraw		(EventHandlerCallRef	UNUSED_ARGUMENT(inHandlerCallRef),
 						// draw the cursor at its ghost location (with ghost appearance)
 						// UNIMPLEMENTED
 					}
+					
+					viewPtr->statistics.renderTime += (CFAbsoluteTimeGetCurrent() - kStartTime);
+					++(viewPtr->statistics.renderFrameCount);
 				}
 			}
 			
@@ -11624,19 +12291,28 @@ receiveTerminalViewTrack	(EventHandlerCallRef	inHandlerCallRef,
 							(false == TerminalView_PtInSelection(viewPtr->selfRef, localMouse)))
 						{
 							// find the URL around the click location, if possible
-							SInt16		deltaColumn = 0;
-							SInt16		deltaRow = 0;
+							SInt16					deltaColumn = 0;
+							SInt16					deltaRow = 0;
+							TerminalView_CellRange	linkRange;
 							
 							
 							// cancel any previous selection
 							TerminalView_SelectNothing(viewPtr->selfRef);
 							
-							// select an entire word
+							// select the link that was already found at this location;
+							// otherwise, select an entire word
 							UNUSED_RETURN(Boolean)findVirtualCellFromLocalPoint(viewPtr, localMouse,
 																				viewPtr->text.selection.range.first,
 																				deltaColumn, deltaRow);
-							viewPtr->text.selection.range.second = viewPtr->text.selection.range.first;
-							handleMultiClick(viewPtr, 2/* click count */);
+							if (findLinkAtCell(viewPtr, viewPtr->text.selection.range.first, linkRange))
+							{
+								TerminalView_SelectVirtualRange(viewPtr->selfRef, linkRange);
+							}
+							else
+							{
+								viewPtr->text.selection.range.second = viewPtr->text.selection.range.first;
+								handleMultiClick(viewPtr, 2/* click count */);
+							}
 						}
 						
 						// open the selection (apparently a URL)
@@ -11824,6 +12500,9 @@ returnNumberOfCharacters	(My_TerminalViewPtr		inTerminalViewPtr)
 /*!
 Internal version of TerminalView_ReturnSelectedTextCopyAsUnicode().
 
+The text is exported once in UTF-8 (see writeSelectedText()) and
+converted into a string in a single step.
+
 (3.1)
 */
 CFStringRef
@@ -11831,200 +12510,28 @@ returnSelectedTextCopyAsUnicode		(My_TerminalViewPtr			inTerminalViewPtr,
 									 UInt16						inMaxSpacesToReplaceWithTabOrZero,
 									 TerminalView_TextFlags		inFlags)
 {
-    CFStringRef		result = nullptr;
+	CFStringRef		result = nullptr;
 	
 	
 	if (inTerminalViewPtr->text.selection.exists)
 	{
-		TerminalView_Cell const&	kSelectionStart = inTerminalViewPtr->text.selection.range.first;
-		TerminalView_Cell const&	kSelectionPastEnd = inTerminalViewPtr->text.selection.range.second;
-		// TEMPORARY: It is probably easy enough to determine what this size should be in advance,
-		// which would save a lot of reallocations.
-		CFMutableStringRef			resultMutable = CFStringCreateMutable(kCFAllocatorDefault, 0/* size limit */);
+		CFRetainRelease		bufferData(CFDataCreateMutable(kCFAllocatorDefault, 0/* capacity, or zero for no limit */),
+										CFRetainRelease::kAlreadyRetained);
 		
 		
-		if (nullptr != resultMutable)
+		if (bufferData.exists())
 		{
-			Terminal_LineStackStorage	lineIteratorData;
-			Terminal_LineRef			lineIterator = findRowIteratorRelativeTo(inTerminalViewPtr, 0,
-																					kSelectionStart.second,
-																					&lineIteratorData);
-			Terminal_Result				iteratorAdvanceResult = kTerminal_ResultOK;
-			Terminal_Result				textGrabResult = kTerminal_ResultOK;
+			CFMutableDataRef	asMutableData = bufferData.returnCFMutableDataRef();
 			
 			
-			// read every line of Unicode characters within this range;
-			// if appropriate, ignore some characters on each line
-			for (CFIndex i = kSelectionStart.second; i < kSelectionPastEnd.second; ++i)
+			if (false == writeSelectedText(inTerminalViewPtr, inMaxSpacesToReplaceWithTabOrZero, inFlags,
+											Terminal_TextSinkToCFMutableData, asMutableData))
 			{
-				UniChar const*		textBegin = nullptr;
-				UniChar const*		textPastEnd = nullptr;
-				
-				
-				if ((inTerminalViewPtr->text.selection.isRectangular) ||
-					(1 == (kSelectionPastEnd.second - kSelectionStart.second)))
-				{
-					// for rectangular or one-line selections, copy a specific column range
-					textGrabResult = Terminal_GetLineRange(inTerminalViewPtr->screen.ref, lineIterator,
-															kSelectionStart.first, kSelectionPastEnd.first,
-															textBegin, textPastEnd);
-					if (kTerminal_ResultOK != textGrabResult)
-					{
-						Console_Warning(Console_WriteValue, "one-line text copy failed, terminal error", textGrabResult);
-						break;
-					}
-				}
-				else
-				{
-					// for standard selections, the first and last lines are different
-					// TEMPORARY: whitespace exclusion flags are mostly a hack to work
-					// around the fact that terminals do not currently know where a
-					// line actually ends; they store whitespace for the full width,
-					// and it is undesirable to pad copied lines with meaningless spaces;
-					// heuristics are employed to arbitrarily strip this end space most
-					// of the time, making an exception for short (~2 line) wraps that
-					// are most likely part of the same, continuing line anyway
-					if (i == kSelectionStart.second)
-					{
-						// first line is anchored at the end (LOCALIZE THIS)
-						textGrabResult = Terminal_GetLineRange(inTerminalViewPtr->screen.ref, lineIterator,
-																kSelectionStart.first, -1/* end column */,
-																textBegin, textPastEnd,
-																(2/* arbitrary */ == (kSelectionPastEnd.second - kSelectionStart.second))
-																	? 0/* flags */
-																	: kTerminal_TextFilterFlagsNoEndWhitespace);
-						if (kTerminal_ResultOK != textGrabResult)
-						{
-							Console_Warning(Console_WriteValue, "first-line-anchored-at-end text copy failed, terminal error", textGrabResult);
-							break;
-						}
-					}
-					else if (i == (kSelectionPastEnd.second - 1))
-					{
-						// last line is anchored at the beginning (LOCALIZE THIS)
-						textGrabResult = Terminal_GetLineRange(inTerminalViewPtr->screen.ref, lineIterator,
-																0/* start column */, kSelectionPastEnd.first,
-																textBegin, textPastEnd, kTerminal_TextFilterFlagsNoEndWhitespace);
-						if (kTerminal_ResultOK != textGrabResult)
-						{
-							Console_Warning(Console_WriteValue, "last-line-anchored-at-beginning text copy failed, terminal error", textGrabResult);
-							break;
-						}
-					}
-					else
-					{
-						// middle lines span the whole width
-						textGrabResult = Terminal_GetLine(inTerminalViewPtr->screen.ref, lineIterator,
-															textBegin, textPastEnd, kTerminal_TextFilterFlagsNoEndWhitespace);
-						if (kTerminal_ResultOK != textGrabResult)
-						{
-							Console_Warning(Console_WriteValue, "middle-spanning-line text copy failed, terminal error", textGrabResult);
-							break;
-						}
-					}
-				}
-				
-				// add the characters for the line...
-				{
-					ptrdiff_t	copyLength = (textPastEnd - textBegin);
-					
-					
-					if (copyLength < 0)
-					{
-						Console_Warning(Console_WriteValue, "internal error, copy range ended up negative; proposed size", copyLength);
-						copyLength = 0;
-					}
-					
-					if (copyLength > 0)
-					{
-						ptrdiff_t const		kSanityCheckCopyLimit = 256; // arbitrary, but matches maximum line buffer size
-						
-						
-						if (copyLength > kSanityCheckCopyLimit)
-						{
-							Console_Warning(Console_WriteValue, "internal error, unexpectedly large line copy (truncating); proposed size", copyLength);
-							copyLength = kSanityCheckCopyLimit;
-						}
-						CFStringAppendCharacters(resultMutable, textBegin, copyLength/* number of characters */);
-						
-						// perform spaces-to-tabs substitution; this could be done while
-						// appending text in the first place but instead it is done as a
-						// lazy post-processing step (also, no effort is made to perform
-						// particularly well...multiple linear searches are done to
-						// iteratively replace ranges of spaces)
-						if (inMaxSpacesToReplaceWithTabOrZero > 0)
-						{
-							CFRetainRelease		spacesString(CFStringCreateMutable
-																(kCFAllocatorDefault,
-																	inMaxSpacesToReplaceWithTabOrZero),
-																	CFRetainRelease::kAlreadyRetained);
-							CFStringRef			singleSpaceString = CFSTR(" "); // LOCALIZE THIS?
-							CFStringRef			tabString = CFSTR("\011"); // LOCALIZE THIS?
-							
-							
-							// create a string to represent the required whitespace range
-							// (TEMPORARY: there is no reason to do this every time, it
-							// could be cached at the time the user preference changes;
-							// for now however the lazy approach is being taken)
-							for (UInt16 spaceIndex = 0; spaceIndex < inMaxSpacesToReplaceWithTabOrZero; ++spaceIndex)
-							{
-								CFStringAppend(spacesString.returnCFMutableStringRef(), singleSpaceString);
-							}
-							
-							// first replace all “long” series of spaces with single tabs, as per user preference
-							UNUSED_RETURN(CFIndex)CFStringFindAndReplace(resultMutable, spacesString.returnCFStringRef(), tabString,
-																			CFRangeMake(0, CFStringGetLength(resultMutable)),
-																			0/* comparison options */);
-							
-							// replace all smaller ranges of spaces with one tab as well
-							for (UInt16 maxSpaces = (inMaxSpacesToReplaceWithTabOrZero - 1); maxSpaces > 0; --maxSpaces)
-							{
-								// create a string representing the next-largest range of spaces...
-								CFStringReplaceAll(spacesString.returnCFMutableStringRef(), CFSTR(""));
-								for (UInt16 spaceIndex = 0; spaceIndex < maxSpaces; ++spaceIndex)
-								{
-									CFStringAppend(spacesString.returnCFMutableStringRef(), singleSpaceString);
-								}
-								
-								// ...and turn those spaces into a tab
-								UNUSED_RETURN(CFIndex)CFStringFindAndReplace(resultMutable, spacesString.returnCFStringRef(), tabString,
-																				CFRangeMake(0, CFStringGetLength(resultMutable)),
-																				0/* comparison options */);
-							}
-						}
-					}
-				}
-				
-				// if requested, add a new-line
-				if (0 == (inFlags & kTerminalView_TextFlagInline))
-				{
-					// do not terminate last line unless requested
-					if ((i < (kSelectionPastEnd.second - 1)) ||
-						(0 != (inFlags & kTerminalView_TextFlagLastLineHasSeparator)))
-					{
-						// TEMPORARY; should this also have the option of capturing
-						// text in other ways, such as the session’s default line-endings?
-						if (inFlags & kTerminalView_TextFlagLineSeparatorLF)
-						{
-							CFStringAppendCString(resultMutable, "\012", kCFStringEncodingASCII);
-						}
-						else
-						{
-							CFStringAppendCString(resultMutable, "\015", kCFStringEncodingASCII);
-						}
-					}
-				}
-				
-				iteratorAdvanceResult = Terminal_LineIteratorAdvance(inTerminalViewPtr->screen.ref, lineIterator, +1);
-				if (kTerminal_ResultIteratorCannotAdvance == iteratorAdvanceResult)
-				{
-					// last line of the buffer has been reached
-					break;
-				}
+				Console_Warning(Console_WriteLine, "text copy failed; result may be incomplete");
 			}
-			releaseRowIterator(inTerminalViewPtr, &lineIterator);
-			
-			result = resultMutable;
+			result = CFStringCreateWithBytes(kCFAllocatorDefault, CFDataGetBytePtr(asMutableData),
+												CFDataGetLength(asMutableData), kCFStringEncodingUTF8,
+												false/* is external representation */);
 		}
 	}
 	else
@@ -12061,6 +12568,14 @@ screenBufferChanged		(ListenerModel_Ref		UNUSED_ARGUMENT(inUnusedModel),
 	switch (inTerminalChange)
 	{
 	case kTerminal_ChangeTextEdited:
+		{
+			Terminal_RangeDescriptionConstPtr	rangeInfoPtr = REINTERPRET_CAST(inEventContextPtr,
+																				Terminal_RangeDescriptionConstPtr);
+			
+			
+			// links are only found again when they are next needed
+			invalidateLinks(viewPtr, rangeInfoPtr->firstRow, rangeInfoPtr->rowCount);
+		}
 		if (IsValidWindowRef(HIViewGetWindow(viewPtr->contentHIView)))
 		{
 			Terminal_RangeDescriptionConstPtr	rangeInfoPtr = REINTERPRET_CAST(inEventContextPtr,
@@ -12091,6 +12606,9 @@ screenBufferChanged		(ListenerModel_Ref		UNUSED_ARGUMENT(inUnusedModel),
 			}
 			recalculateCachedDimensions(viewPtr);
 			
+			// scrolling can move any row of the main screen
+			invalidateLinks(viewPtr, 0, STATIC_CAST(viewPtr->text.links.rowIsStale.size(), UInt32));
+			
 			highlightCurrentSelection(viewPtr, false/* highlight */, true/* draw */);
 			viewPtr->text.selection.range.first.second += rangeInfoPtr->rowDelta;
 			viewPtr->text.selection.range.second.second += rangeInfoPtr->rowDelta;
@@ -13451,6 +13969,249 @@ trackTextSelection	(My_TerminalViewPtr		inTerminalViewPtr,
 }// trackTextSelection
 
 
+/*!
+Adjusts the given range of a word (from findWordRange()) to
+make word selections more sensible: trailing punctuation is
+removed, as are unbalanced parentheses and quotation marks at
+either end (e.g. “xyz()” is kept but “xyz)” becomes “xyz”),
+and finally any brackets that appear at both ends.
+
+(2017.10)
+*/
+void
+trimWordPunctuation		(UniChar const*		inText,
+						 UInt16&			inoutFirst,
+						 UInt16&			inoutPastEnd)
+{
+	My_WordCharacterClassTable const&	kClasses = gWordCharacterClasses();
+	auto								classAt = [&](UInt16 inIndex) { return kClasses[inText[inIndex]]; };
+	auto								stripEndPunctuation = [&]()
+										{
+											if ((inoutPastEnd > inoutFirst) &&
+												(kMy_WordCharacterClassEndPunctuation == classAt(inoutPastEnd - 1)))
+											{
+												--inoutPastEnd;
+											}
+										};
+	
+	
+	// strip basic punctuation off the end (this is repeated below)
+	stripEndPunctuation();
+	
+	if ((inoutPastEnd - inoutFirst) > 1)
+	{
+		UInt16		openParenthesisCount = 0;
+		UInt16		closeParenthesisCount = 0;
+		UInt16		doubleQuoteCount = 0;
+		UInt16		singleQuoteCount = 0;
+		
+		
+		// study the word’s characters
+		for (UInt16 i = inoutFirst; i < inoutPastEnd; ++i)
+		{
+			switch (classAt(i))
+			{
+			case kMy_WordCharacterClassDoubleQuote:
+				++doubleQuoteCount;
+				break;
+			
+			case kMy_WordCharacterClassApostrophe:
+			case kMy_WordCharacterClassBackquote:
+				++singleQuoteCount;
+				break;
+			
+			case kMy_WordCharacterClassOpenParenthesis:
+				++openParenthesisCount;
+				break;
+			
+			case kMy_WordCharacterClassCloseParenthesis:
+				++closeParenthesisCount;
+				break;
+			
+			default:
+				break;
+			}
+		}
+		
+		// strip trailing punctuation as long as the word does not
+		// contain balanced brackets
+		while (inoutPastEnd > inoutFirst)
+		{
+			My_WordCharacterClass const		kLastClass = classAt(inoutPastEnd - 1);
+			
+			
+			if ((kMy_WordCharacterClassCloseParenthesis == kLastClass) && (closeParenthesisCount > openParenthesisCount))
+			{
+				--closeParenthesisCount;
+			}
+			else if ((kMy_WordCharacterClassDoubleQuote == kLastClass) && (0 != (doubleQuoteCount % 2)))
+			{
+				--doubleQuoteCount;
+			}
+			else if (((kMy_WordCharacterClassApostrophe == kLastClass) || (kMy_WordCharacterClassBackquote == kLastClass)) &&
+						(0 != (singleQuoteCount % 2)))
+			{
+				--singleQuoteCount;
+			}
+			else
+			{
+				break;
+			}
+			--inoutPastEnd;
+		}
+		
+		// strip leading punctuation as long as the word does not
+		// contain balanced brackets
+		while (inoutPastEnd > inoutFirst)
+		{
+			My_WordCharacterClass const		kFirstClass = classAt(inoutFirst);
+			
+			
+			if ((kMy_WordCharacterClassOpenParenthesis == kFirstClass) && (openParenthesisCount > closeParenthesisCount))
+			{
+				--openParenthesisCount;
+			}
+			else if ((kMy_WordCharacterClassDoubleQuote == kFirstClass) && (0 != (doubleQuoteCount % 2)))
+			{
+				--doubleQuoteCount;
+			}
+			else if (((kMy_WordCharacterClassApostrophe == kFirstClass) || (kMy_WordCharacterClassBackquote == kFirstClass)) &&
+						(0 != (singleQuoteCount % 2)))
+			{
+				--singleQuoteCount;
+			}
+			else
+			{
+				break;
+			}
+			++inoutFirst;
+		}
+		
+		// repeat this rule, as punctuation sometimes appears inside brackets
+		stripEndPunctuation();
+	}
+	
+	// strip any brackets that appear balanced at both ends
+	while ((inoutPastEnd - inoutFirst) > 1)
+	{
+		My_WordCharacterClass const		kFirstClass = classAt(inoutFirst);
+		My_WordCharacterClass const		kLastClass = classAt(inoutPastEnd - 1);
+		
+		
+		if (((kMy_WordCharacterClassDoubleQuote == kFirstClass) && (kMy_WordCharacterClassDoubleQuote == kLastClass)) ||
+			((kMy_WordCharacterClassApostrophe == kFirstClass) && (kMy_WordCharacterClassApostrophe == kLastClass)) ||
+			((kMy_WordCharacterClassBackquote == kFirstClass) &&
+				((kMy_WordCharacterClassBackquote == kLastClass) || (kMy_WordCharacterClassApostrophe == kLastClass))) ||
+			((kMy_WordCharacterClassOpenAngle == kFirstClass) && (kMy_WordCharacterClassCloseAngle == kLastClass)) ||
+			((kMy_WordCharacterClassOpenParenthesis == kFirstClass) && (kMy_WordCharacterClassCloseParenthesis == kLastClass)) ||
+			((kMy_WordCharacterClassOpenBracket == kFirstClass) && (kMy_WordCharacterClassCloseBracket == kLastClass)) ||
+			((kMy_WordCharacterClassOpenBrace == kFirstClass) && (kMy_WordCharacterClassCloseBrace == kLastClass)))
+		{
+			++inoutFirst;
+			--inoutPastEnd;
+		}
+		else
+		{
+			break;
+		}
+	}
+}// trimWordPunctuation
+
+
+/*!
+Returns the result of findWordRange() for the given UTF-8
+text and zero-based UTF-16 offset.
+
+(2017.10)
+*/
+std::pair< UInt16, UInt16 >
+unitTest_FindWord	(char const*	inUTF8Text,
+					 UInt16			inOffset)
+{
+	CFRetainRelease					textCFString(CFStringCreateWithCString(kCFAllocatorDefault, inUTF8Text, kCFStringEncodingUTF8),
+													CFRetainRelease::kAlreadyRetained);
+	CFIndex const					kLength = CFStringGetLength(textCFString.returnCFStringRef());
+	std::pair< UInt16, UInt16 >		result = std::make_pair(inOffset, 0);
+	
+	
+	if (kLength > 0)
+	{
+		std::vector< UniChar >	buffer(kLength);
+		
+		
+		CFStringGetCharacters(textCFString.returnCFStringRef(), CFRangeMake(0, kLength), &buffer[0]);
+		result = findWordRange(&buffer[0], &buffer[0] + kLength, inOffset);
+	}
+	return result;
+}// unitTest_FindWord
+
+
+/*!
+Tests findWordRange(), which finds the word under a
+double-click: word boundaries, runs of separators, the
+trimming of punctuation, quotation marks and parentheses,
+non-ASCII text, and URLs that contain separators.
+
+Returns "true" if ALL assertions pass; "false" is
+returned if any fail, however messages should be
+printed for ALL assertion failures regardless.
+
+(2017.10)
+*/
+Boolean
+unitTest_FindWord_000 ()
+{
+	std::pair< UInt16, UInt16 >		wordInfo;
+	Boolean							result = true;
+	
+	
+	fillWordCharacterClassTable(gWordCharacterClasses(), nullptr/* additional separators */);
+	
+	wordInfo = unitTest_FindWord("hello world", 1);
+	result &= Console_Assert("first word", (0 == wordInfo.first) && (5 == wordInfo.second));
+	wordInfo = unitTest_FindWord("hello world", 10);
+	result &= Console_Assert("last word", (6 == wordInfo.first) && (5 == wordInfo.second));
+	wordInfo = unitTest_FindWord("a   b", 2);
+	result &= Console_Assert("run of white space", (1 == wordInfo.first) && (3 == wordInfo.second));
+	wordInfo = unitTest_FindWord("hello", 5);
+	result &= Console_Assert("offset past end", (5 == wordInfo.first) && (1 == wordInfo.second));
+	
+	wordInfo = unitTest_FindWord("see foo.", 5);
+	result &= Console_Assert("trailing period", (4 == wordInfo.first) && (3 == wordInfo.second));
+	wordInfo = unitTest_FindWord("call xyz() now", 6);
+	result &= Console_Assert("balanced parentheses", (5 == wordInfo.first) && (5 == wordInfo.second));
+	wordInfo = unitTest_FindWord("see xyz) now", 5);
+	result &= Console_Assert("unbalanced parenthesis", (4 == wordInfo.first) && (3 == wordInfo.second));
+	wordInfo = unitTest_FindWord("(see [x]),", 6);
+	result &= Console_Assert("brackets at both ends", (6 == wordInfo.first) && (1 == wordInfo.second));
+	wordInfo = unitTest_FindWord("\"word\",", 2);
+	result &= Console_Assert("double quotes and comma", (1 == wordInfo.first) && (4 == wordInfo.second));
+	wordInfo = unitTest_FindWord("it's `cmd'", 6);
+	result &= Console_Assert("GNU-style quotes", (6 == wordInfo.first) && (3 == wordInfo.second));
+	wordInfo = unitTest_FindWord("it's `cmd'", 1);
+	result &= Console_Assert("apostrophe within a word", (0 == wordInfo.first) && (4 == wordInfo.second));
+	
+	// non-ASCII letters are part of words, and non-ASCII white
+	// space (here, an ideographic space) separates them
+	wordInfo = unitTest_FindWord("naïve café.", 7);
+	result &= Console_Assert("accented word", (6 == wordInfo.first) && (4 == wordInfo.second));
+	wordInfo = unitTest_FindWord("日本語\xE3\x80\x80テキスト", 5);
+	result &= Console_Assert("ideographic space", (4 == wordInfo.first) && (4 == wordInfo.second));
+	
+	// separators divide words, but not URLs
+	fillWordCharacterClassTable(gWordCharacterClasses(), CFSTR("/"));
+	wordInfo = unitTest_FindWord("path/to/file", 5);
+	result &= Console_Assert("separator", (5 == wordInfo.first) && (2 == wordInfo.second));
+	wordInfo = unitTest_FindWord("path//file", 5);
+	result &= Console_Assert("run of separators", (4 == wordInfo.first) && (2 == wordInfo.second));
+	wordInfo = unitTest_FindWord("see http://a.b/c now", 11);
+	result &= Console_Assert("URL with separators", (4 == wordInfo.first) && (12 == wordInfo.second));
+	fillWordCharacterClassTable(gWordCharacterClasses(), nullptr/* additional separators */);
+	
+	return result;
+}// unitTest_FindWord_000
+
+
 /*!
 Arranges for the entire terminal screen to be redrawn at the
 next opportunity.
@@ -13492,6 +14253,10 @@ updateDisplayInRegion	(My_TerminalViewPtr		inTerminalViewPtr,
 {
 	// it is potentially slow to call HIViewSetNeedsDisplay() here, so instead
 	// an internal region is maintained and refreshed regularly via a timer
+	if (false == EmptyRgn(inTerminalViewPtr->screen.refreshRegion))
+	{
+		++(inTerminalViewPtr->statistics.coalescedFrameCount);
+	}
 	UnionRgn(inTerminalViewPtr->screen.refreshRegion, inoutRegion, inTerminalViewPtr->screen.refreshRegion);
 }// updateDisplayInRegion
 
@@ -14150,18 +14915,11 @@ visualBell	(TerminalViewRef	inView)
 	HIWindowRef const			kViewWindow = HIViewGetWindow(viewPtr->contentHIView);
 	Boolean const				kWasReverseVideo = viewPtr->screen.isReverseVideo;
 	Boolean						visual = false;				// is visual used?
-	Boolean						visualPreference = false;	// is ONLY visual used?
 	
 	
 	// If the user turned off audible bells, always use a visual;
 	// otherwise, use a visual if the beep is in a background window.
-	unless (kPreferences_ResultOK ==
-			Preferences_GetData(kPreferences_TagVisualBell, sizeof(visualPreference),
-								&visualPreference))
-	{
-		visualPreference = false; // assume audible bell, if preference can’t be found
-	}
-	visual = (visualPreference || (!IsWindowHilited(kViewWindow)));
+	visual = (gPreferenceProxies.visualBellOnly || (!IsWindowHilited(kViewWindow)));
 	
 	if (visual)
 	{
@@ -14189,6 +14947,106 @@ visualBell	(TerminalViewRef	inView)
 	if (gPreferenceProxies.notifyOfBeeps) Alert_BackgroundNotification();
 }// visualBell
 
+
+/*!
+Internal version of TerminalView_WriteSelectedText().
+
+(2017.10)
+*/
+Boolean
+writeSelectedText	(My_TerminalViewPtr			inTerminalViewPtr,
+					 UInt16						inMaxSpacesToReplaceWithTabOrZero,
+					 TerminalView_TextFlags		inFlags,
+					 Terminal_TextSinkProcPtr	inSink,
+					 void*						inSinkContextPtr)
+{
+	Boolean		result = true;
+	
+	
+	if (inTerminalViewPtr->text.selection.exists)
+	{
+		TerminalView_Cell const&	kSelectionStart = inTerminalViewPtr->text.selection.range.first;
+		TerminalView_Cell const&	kSelectionPastEnd = inTerminalViewPtr->text.selection.range.second;
+		UInt32 const				kRowCount = (kSelectionPastEnd.second - kSelectionStart.second);
+		Terminal_LineStackStorage	lineIteratorData;
+		Terminal_LineRef			lineIterator = findRowIteratorRelativeTo(inTerminalViewPtr, 0,
+																				kSelectionStart.second,
+																				&lineIteratorData);
+		Terminal_TextCopyFlags		lineFlags = kTerminal_TextCopyFlagsAlwaysNewLineAtRightMargin; // every selected row ends a line
+		Terminal_TextCopyFlags		lastLineFlags = 0;
+		Terminal_Result				copyResult = kTerminal_ResultOK;
+		
+		
+		if (inFlags & kTerminalView_TextFlagInline)
+		{
+			lineFlags |= kTerminal_TextCopyFlagsInline;
+		}
+		if (inFlags & kTerminalView_TextFlagLineSeparatorLF)
+		{
+			// TEMPORARY; should this also have the option of capturing
+			// text in other ways, such as the session’s default line-endings?
+			lineFlags |= kTerminal_TextCopyFlagsLineSeparatorLF;
+		}
+		if (inFlags & kTerminalView_TextFlagLastLineHasSeparator)
+		{
+			lastLineFlags |= kTerminal_TextCopyFlagsLastLineHasSeparator;
+		}
+		
+		if ((inTerminalViewPtr->text.selection.isRectangular) || (1 == kRowCount))
+		{
+			// for rectangular or one-line selections, copy a specific column range
+			copyResult = Terminal_CopyRangeToSink(inTerminalViewPtr->screen.ref, lineIterator, kRowCount,
+													kSelectionStart.first, kSelectionPastEnd.first,
+													lineFlags | lastLineFlags | kTerminal_TextCopyFlagsRectangular,
+													inMaxSpacesToReplaceWithTabOrZero, inSink, inSinkContextPtr);
+			if (kTerminal_ResultOK != copyResult)
+			{
+				Console_Warning(Console_WriteValue, "one-line or rectangular text copy failed, terminal error", copyResult);
+			}
+		}
+		else
+		{
+			// for standard selections, the first line is anchored at the end
+			// and the last line is anchored at the beginning (LOCALIZE THIS);
+			// TEMPORARY: whitespace exclusion flags are mostly a hack to work
+			// around the fact that terminals do not currently know where a
+			// line actually ends; they store whitespace for the full width,
+			// and it is undesirable to pad copied lines with meaningless spaces;
+			// heuristics are employed to arbitrarily strip this end space most
+			// of the time, making an exception for short (~2 line) wraps that
+			// are most likely part of the same, continuing line anyway
+			copyResult = Terminal_CopyRangeToSink(inTerminalViewPtr->screen.ref, lineIterator, 1/* row count */,
+													kSelectionStart.first, -1/* past-end column; negative means “very end” */,
+													lineFlags | kTerminal_TextCopyFlagsLastLineHasSeparator |
+													((2/* arbitrary */ == kRowCount)
+														? 0
+														: kTerminal_TextCopyFlagsNoEndWhitespace),
+													inMaxSpacesToReplaceWithTabOrZero, inSink, inSinkContextPtr);
+			if (kTerminal_ResultOK != copyResult)
+			{
+				Console_Warning(Console_WriteValue, "first-line-anchored-at-end text copy failed, terminal error", copyResult);
+			}
+			else if (kTerminal_ResultOK == Terminal_LineIteratorAdvance(inTerminalViewPtr->screen.ref, lineIterator, +1))
+			{
+				// middle lines span the whole width, and the last line ends at the selection
+				copyResult = Terminal_CopyRangeToSink(inTerminalViewPtr->screen.ref, lineIterator, kRowCount - 1,
+														0/* start column */, kSelectionPastEnd.first,
+														lineFlags | lastLineFlags | kTerminal_TextCopyFlagsNoEndWhitespace,
+														inMaxSpacesToReplaceWithTabOrZero, inSink, inSinkContextPtr);
+				if (kTerminal_ResultOK != copyResult)
+				{
+					Console_Warning(Console_WriteValue, "remaining-lines text copy failed, terminal error", copyResult);
+				}
+			}
+		}
+		releaseRowIterator(inTerminalViewPtr, &lineIterator);
+		
+		result = (kTerminal_ResultOK == copyResult);
+	}
+	
+	return result;
+}// writeSelectedText
+
 } // anonymous namespace
 
 
@@ -14521,9 +15379,25 @@ cache can be updated (used to change the cursor shape).
 - (void)
 flagsChanged:(NSEvent*)		anEvent
 {
+	My_TerminalViewPtr		viewPtr = self.internalViewPtr;
+	
+	
 	[super flagsChanged:anEvent];
 	self.modifierFlagsForCursor = [anEvent modifierFlags];
 	[[self window] invalidateCursorRectsForView:self];
+	
+	// links are underlined while they can be command-clicked
+	if (nullptr != viewPtr)
+	{
+		Boolean const	kShowLinks = (0 != (self.modifierFlagsForCursor & NSCommandKeyMask));
+		
+		
+		if (kShowLinks != viewPtr->text.links.isHighlighted)
+		{
+			viewPtr->text.links.isHighlighted = kShowLinks;
+			updateDisplay(viewPtr);
+		}
+	}
 }// flagsChanged:
 
 
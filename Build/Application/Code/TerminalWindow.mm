@@ -2209,6 +2209,11 @@ TerminalWindow_SetWindowTitle	(TerminalWindowRef	inRef,
 	
 	if (nil != ptr->window)
 	{
+		SessionRef		session = SessionFactory_ReturnTerminalWindowSession(inRef);
+		size_t			pasteBytesWritten = 0;
+		size_t			pasteBytesTotal = 0;
+		
+		
 		if (ptr->isDead)
 		{
 			// add a visual indicator to the window title of disconnected windows
@@ -2224,8 +2229,29 @@ TerminalWindow_SetWindowTitle	(TerminalWindowRef	inRef,
 				setWindowAndTabTitle(ptr, adornedCFString.returnCFStringRef());
 			}
 		}
-		else if (nullptr != inName)
+		else if ((nullptr != session) && Session_IsValid(session) &&
+					(Session_ReturnStateAttributes(session) & kSession_StateAttributePasteInProgress) &&
+					Session_GetPasteProgress(session, pasteBytesWritten, pasteBytesTotal).ok() &&
+					(pasteBytesTotal > 0))
+		{
+			// add a progress indicator to the window title while a large Paste is written
+			CFRetainRelease		adornedCFString(CFStringCreateWithFormat
+												(kCFAllocatorDefault, nullptr/* format options */,
+													CFSTR("%@ (Paste %u%%)")/* LOCALIZE THIS? */,
+													ptr->baseTitleString.returnCFStringRef(),
+													STATIC_CAST((100 * pasteBytesWritten) / pasteBytesTotal, unsigned int)),
+												CFRetainRelease::kAlreadyRetained);
+			
+			
+			if (adornedCFString.exists())
+			{
+				setWindowAndTabTitle(ptr, adornedCFString.returnCFStringRef());
+			}
+		}
+		else
 		{
+			// NOTE: this is done even if the base title has not changed,
+			// because an adornment (such as Paste progress) may have ended
 			setWindowAndTabTitle(ptr, ptr->baseTitleString.returnCFStringRef());
 		}
 	}
@@ -2767,6 +2793,7 @@ installedActions()
 	// set up callbacks to receive various state change notifications
 	this->sessionStateChangeEventListener.setWithNoRetain(ListenerModel_NewStandardListener
 															(sessionStateChanged, this->selfRef/* context */));
+	SessionFactory_StartMonitoringSessions(kSession_ChangePasteProgress, this->sessionStateChangeEventListener.returnRef());
 	SessionFactory_StartMonitoringSessions(kSession_ChangeSelected, this->sessionStateChangeEventListener.returnRef());
 	SessionFactory_StartMonitoringSessions(kSession_ChangeState, this->sessionStateChangeEventListener.returnRef());
 	SessionFactory_StartMonitoringSessions(kSession_ChangeStateAttributes, this->sessionStateChangeEventListener.returnRef());
@@ -3023,6 +3050,7 @@ My_TerminalWindow::
 	DisposeControlActionUPP(this->scrollProcUPP), this->scrollProcUPP = nullptr;
 	
 	// unregister session callbacks
+	SessionFactory_StopMonitoringSessions(kSession_ChangePasteProgress, this->sessionStateChangeEventListener.returnRef());
 	SessionFactory_StopMonitoringSessions(kSession_ChangeSelected, this->sessionStateChangeEventListener.returnRef());
 	SessionFactory_StopMonitoringSessions(kSession_ChangeState, this->sessionStateChangeEventListener.returnRef());
 	SessionFactory_StopMonitoringSessions(kSession_ChangeStateAttributes, this->sessionStateChangeEventListener.returnRef());
@@ -6800,6 +6828,21 @@ sessionStateChanged		(ListenerModel_Ref		UNUSED_ARGUMENT(inUnusedModel),
 	
 	switch (inSessionSettingThatChanged)
 	{
+	case kSession_ChangePasteProgress:
+		// update the progress that is displayed in the window title
+		{
+			SessionRef		session = REINTERPRET_CAST(inEventContextPtr, SessionRef);
+			
+			
+			// this handler is invoked for changes to ANY session,
+			// but the response is specific to one, so check first
+			if (Session_ReturnActiveTerminalWindow(session) == terminalWindow)
+			{
+				TerminalWindow_SetWindowTitle(terminalWindow, nullptr/* keep title, evaluate state again */);
+			}
+		}
+		break;
+	
 	case kSession_ChangeSelected:
 		// bring the window to the front, unhiding it if necessary
 		{
@@ -39,6 +39,7 @@
 
 // standard-C++ includes
 #include <algorithm>
+#include <map>
 #include <vector>
 
 // Mac includes
@@ -49,12 +50,96 @@
 #include <Console.h>
 #include <MemoryBlocks.h>
 #include <StringUtilities.h>
+#include <UTF8Decoder.h>
 
 
 
+#pragma mark Constants
+namespace {
+
+UInt8 const		kMy_DFAAccept = 0;					//!< transition completes a character (returning to the initial state)
+UInt8 const		kMy_DFAError = 0xFF;				//!< transition is not allowed; the pending sequence is invalid
+size_t const	kMy_FallbackCarryLimit = 16;		//!< most bytes an untabled decoder will hold while waiting for a character to end
+UniChar const	kMy_ReplacementCharacter = 0xFFFD;	//!< emitted in place of any invalid or unmappable sequence
+UniChar const	kMy_UnmappedCharacter = 0xFFFF;		//!< noncharacter; in a table, means the sequence must be converted individually
+
+} // anonymous namespace
+
 #pragma mark Types
 namespace {
 
+/*!
+One state of a decoder’s deterministic finite automaton: for
+each possible byte, the state to move to; "kMy_DFAAccept" or
+"kMy_DFAError".  State 0 is always the initial state, and it
+is only reentered by accepting a complete character.
+*/
+struct My_DFAState
+{
+	UInt8	next[256];
+	
+	void
+	setRange	(UInt8		inFirstByte,
+				 UInt8		inLastByte,
+				 UInt8		inTransition)
+	{
+		std::fill(next + inFirstByte, next + inLastByte + 1, inTransition);
+	}
+};
+
+typedef std::vector< My_DFAState >		My_DFA;
+
+/*!
+Lookup tables for a table-driven encoding.  These are shared
+by all decoders of the same encoding and are never destroyed.
+Rows of double-byte characters are filled the first time that
+their lead byte appears, so that only the parts of a large
+character set that are actually used are ever converted.
+*/
+struct My_DecoderTables
+{
+	My_DecoderTables	(CFStringEncoding, My_DFA const&);
+	
+	UniChar
+	returnDoubleByteCharacter	(UInt8, UInt8);
+	
+	CFStringEncoding						encoding;		//!< the encoding that the tables convert from
+	My_DFA									dfa;			//!< determines where each encoded character ends
+	UniChar									singleBytes[256];//!< translation of every byte that is a complete character
+	std::vector< std::vector< UniChar > >	doubleByteRows;	//!< by lead byte, the translation of each trail byte (empty until used)
+};
+typedef My_DecoderTables*	My_DecoderTablesPtr;
+
+typedef std::map< CFStringEncoding, My_DecoderTablesPtr >	My_DecoderTablesByEncoding;
+
+/*!
+The internal representation of a TextTranslation_DecoderRef.
+*/
+struct My_Decoder
+{
+	My_Decoder	(CFStringEncoding);
+	
+	UInt32
+	appendCharacters	(UInt8 const*, size_t, std::vector< UniChar >&);
+	
+	UInt32
+	appendCharactersUntabled	(UInt8 const*, size_t, std::vector< UniChar >&);
+	
+	UInt32
+	appendCharactersUTF8		(UInt8 const*, size_t, std::vector< UniChar >&);
+	
+	UInt32
+	appendSequence		(UInt8 const*, size_t, std::vector< UniChar >&);
+	
+	CFStringEncoding			encoding;		//!< the encoding of the bytes to be decoded
+	My_DecoderTablesPtr			tables;			//!< lookup tables; nullptr if the encoding is not table-driven
+	UInt8						state;			//!< current DFA state (0 between characters)
+	std::vector< UInt8 >		pendingBytes;	//!< bytes of a character that has not been completely seen yet
+	UTF8Decoder_StateMachine	utf8Decoder;	//!< for UTF-8 only; holds any incomplete sequence
+	UTF8Decoder_CodePointList	codePoints;		//!< for UTF-8 only; buffer reused by each conversion
+};
+typedef My_Decoder*		My_DecoderPtr;
+
 struct My_TextEncodingInfo
 {
 	CFRetainRelease		name;
@@ -74,14 +159,19 @@ namespace {
 Boolean						gInitialized = false;
 TextEncodingBase			gPreferredEncodingBase = kCFStringEncodingMacRoman;
 My_TextEncodingInfoList&	gTextEncodingInfoList ()	{ static My_TextEncodingInfoList x; return x; }
+My_DecoderTablesByEncoding&	gDecoderTablesByEncoding ()	{ static My_DecoderTablesByEncoding x; return x; }
 
 } // anonymous namespace
 
 #pragma mark Internal Method Prototypes
 namespace {
 
-void	fillInCharacterSetList		(Boolean = false);
-bool	textEncodingInfoComparer	(My_TextEncodingInfoPtr, My_TextEncodingInfoPtr);
+Boolean				appendConvertedSequence		(CFStringEncoding, UInt8 const*, size_t, std::vector< UniChar >&);
+void				fillInCharacterSetList		(Boolean = false);
+Boolean				fillInDFA					(CFStringEncoding, My_DFA&);
+My_DecoderTablesPtr	returnDecoderTables			(CFStringEncoding);
+UniChar				returnTableEntry			(CFStringEncoding, UInt8 const*, size_t);
+bool				textEncodingInfoComparer	(My_TextEncodingInfoPtr, My_TextEncodingInfoPtr);
 
 } // anonymous namespace
 
@@ -262,6 +352,112 @@ TextTranslation_ContextSetEncoding	(Preferences_ContextRef		inContext,
 }// ContextSetEncoding
 
 
+/*!
+Decodes the given bytes and appends the resulting UTF-16
+characters to the given vector.  The decoder consumes every
+byte: if the bytes end with only part of a character, those
+bytes are held by the decoder and the character is completed
+by the next call.  Each invalid or unmappable sequence is
+replaced by U+FFFD, and the return value is the number of
+such replacements (normally zero).
+
+For most single-byte and multi-byte character sets, decoding
+is driven by lookup tables and a small state machine so that
+each byte is examined once.  UTF-8 is decoded in bulk by
+UTF8Decoder_StateMachine::appendCodePoints().  Other encodings (such as those
+with shift states) fall back to TextTranslation_PersistentCFStringCreate().
+
+(2017.10)
+*/
+UInt32
+TextTranslation_DecoderAppendCharacters		(TextTranslation_DecoderRef	inDecoder,
+											 UInt8 const*				inBytes,
+											 size_t						inByteCount,
+											 std::vector< UniChar >&	inoutCharacters)
+{
+	My_DecoderPtr	ptr = REINTERPRET_CAST(inDecoder, My_DecoderPtr);
+	UInt32			result = 0;
+	
+	
+	if (nullptr == ptr)
+	{
+		Console_Warning(Console_WriteLine, "attempt to decode text with an invalid decoder");
+	}
+	else
+	{
+		result = ptr->appendCharacters(inBytes, inByteCount, inoutCharacters);
+	}
+	return result;
+}// DecoderAppendCharacters
+
+
+/*!
+Returns the encoding that the given decoder was created for.
+
+(2017.10)
+*/
+CFStringEncoding
+TextTranslation_DecoderReturnEncoding	(TextTranslation_DecoderRef		inDecoder)
+{
+	My_DecoderPtr		ptr = REINTERPRET_CAST(inDecoder, My_DecoderPtr);
+	CFStringEncoding	result = kCFStringEncodingInvalidId;
+	
+	
+	if (nullptr != ptr)
+	{
+		result = ptr->encoding;
+	}
+	return result;
+}// DecoderReturnEncoding
+
+
+/*!
+Destroys a decoder created with TextTranslation_NewDecoder()
+(discarding any bytes that it was holding), and sets your copy
+of the reference to nullptr.  It is safe to pass a reference
+to nullptr.
+
+(2017.10)
+*/
+void
+TextTranslation_DisposeDecoder	(TextTranslation_DecoderRef*	inoutRefPtr)
+{
+	if (nullptr != inoutRefPtr)
+	{
+		delete *(REINTERPRET_CAST(inoutRefPtr, My_DecoderPtr*));
+		*inoutRefPtr = nullptr;
+	}
+}// DisposeDecoder
+
+
+/*!
+Creates an object that incrementally converts bytes in the
+given encoding into Unicode; see
+TextTranslation_DecoderAppendCharacters().  Dispose of it
+with TextTranslation_DisposeDecoder().
+
+Returns nullptr if any problem occurs.
+
+(2017.10)
+*/
+TextTranslation_DecoderRef
+TextTranslation_NewDecoder	(CFStringEncoding	inEncoding)
+{
+	TextTranslation_DecoderRef	result = nullptr;
+	
+	
+	try
+	{
+		result = REINTERPRET_CAST(new My_Decoder(inEncoding), TextTranslation_DecoderRef);
+	}
+	catch (std::bad_alloc)
+	{
+		result = nullptr;
+	}
+	return result;
+}// NewDecoder
+
+
 /*!
 This is like CFStringCreateWithBytes(), except on failure it
 will loop up to "inByteMaxBacktrack" times; each time the tail
@@ -436,6 +632,361 @@ TextTranslation_ReturnIndexedCharacterSet	(UInt16		inOneBasedIndex)
 #pragma mark Internal Methods
 namespace {
 
+/*!
+Creates the lookup tables for an encoding, using the given
+state machine to decide which byte sequences to translate.
+The double-byte rows are allocated but left empty; see
+returnDoubleByteCharacter().
+
+(2017.10)
+*/
+My_DecoderTables::
+My_DecoderTables	(CFStringEncoding	inEncoding,
+					 My_DFA const&		inDFA)
+:
+// IMPORTANT: THESE ARE EXECUTED IN THE ORDER MEMBERS APPEAR IN THE CLASS.
+encoding(inEncoding),
+dfa(inDFA),
+doubleByteRows(256)
+// singleBytes initialized below
+{
+	for (UInt16 i = 0; i < 256; ++i)
+	{
+		UInt8 const		kByte = STATIC_CAST(i, UInt8);
+		
+		
+		if (kMy_DFAAccept == this->dfa[0].next[kByte])
+		{
+			this->singleBytes[kByte] = returnTableEntry(inEncoding, &kByte, 1);
+		}
+		else
+		{
+			this->singleBytes[kByte] = kMy_ReplacementCharacter; // not reached; this byte starts a longer sequence
+		}
+	}
+}// My_DecoderTables 2-argument constructor
+
+
+/*!
+Returns the translation of the specified two-byte character,
+filling in the entire row for the lead byte if this is the
+first time that the lead byte has been seen.  The result may
+be "kMy_UnmappedCharacter", which means that the caller must
+convert the sequence individually.
+
+(2017.10)
+*/
+UniChar
+My_DecoderTables::
+returnDoubleByteCharacter	(UInt8		inLeadByte,
+							 UInt8		inTrailByte)
+{
+	std::vector< UniChar >&		row = this->doubleByteRows[inLeadByte];
+	
+	
+	if (row.empty())
+	{
+		UInt8 const		kTrailState = this->dfa[0].next[inLeadByte];
+		
+		
+		row.resize(256, kMy_ReplacementCharacter);
+		if ((kMy_DFAAccept != kTrailState) && (kMy_DFAError != kTrailState))
+		{
+			for (UInt16 i = 0; i < 256; ++i)
+			{
+				UInt8 const		kPair[] = { inLeadByte, STATIC_CAST(i, UInt8) };
+				
+				
+				if (kMy_DFAAccept == this->dfa[kTrailState].next[kPair[1]])
+				{
+					row[kPair[1]] = returnTableEntry(this->encoding, kPair, sizeof(kPair));
+				}
+			}
+		}
+	}
+	return row[inTrailByte];
+}// My_DecoderTables::returnDoubleByteCharacter
+
+
+/*!
+Creates a decoder for the given encoding, using (and if
+necessary creating) the shared lookup tables for that
+encoding.  If the encoding cannot be table-driven, the
+decoder falls back to Core Foundation conversions.
+
+(2017.10)
+*/
+My_Decoder::
+My_Decoder	(CFStringEncoding	inEncoding)
+:
+// IMPORTANT: THESE ARE EXECUTED IN THE ORDER MEMBERS APPEAR IN THE CLASS.
+encoding(inEncoding),
+tables(returnDecoderTables(inEncoding)),
+state(0),
+pendingBytes(),
+utf8Decoder(),
+codePoints()
+{
+	this->pendingBytes.reserve(kMy_FallbackCarryLimit);
+}// My_Decoder 1-argument constructor
+
+
+/*!
+Implements TextTranslation_DecoderAppendCharacters().
+
+(2017.10)
+*/
+UInt32
+My_Decoder::
+appendCharacters	(UInt8 const*				inBytes,
+					 size_t						inByteCount,
+					 std::vector< UniChar >&	inoutCharacters)
+{
+	UInt32		result = 0;
+	
+	
+	if (kCFStringEncodingUTF8 == this->encoding)
+	{
+		result = appendCharactersUTF8(inBytes, inByteCount, inoutCharacters);
+	}
+	else if (nullptr == this->tables)
+	{
+		result = appendCharactersUntabled(inBytes, inByteCount, inoutCharacters);
+	}
+	else
+	{
+		My_DFA const&		kDFA = this->tables->dfa;
+		UInt8 const*		ptr = inBytes;
+		UInt8 const* const	kPastEnd = inBytes + inByteCount;
+		
+		
+		inoutCharacters.reserve(inoutCharacters.size() + inByteCount);
+		while (ptr != kPastEnd)
+		{
+			UInt8 const		kNextState = kDFA[this->state].next[*ptr];
+			
+			
+			if (kMy_DFAError == kNextState)
+			{
+				// the byte cannot continue the current sequence; if a sequence
+				// was pending, it is invalid and the byte is examined again as
+				// the start of a new character, otherwise the byte is skipped
+				inoutCharacters.push_back(kMy_ReplacementCharacter);
+				++result;
+				if (this->pendingBytes.empty())
+				{
+					++ptr;
+				}
+				else
+				{
+					this->pendingBytes.clear();
+				}
+				this->state = 0;
+			}
+			else if ((kMy_DFAAccept == kNextState) && this->pendingBytes.empty())
+			{
+				// single-byte character (by far the most common case)
+				UniChar const	kCharacter = this->tables->singleBytes[*ptr];
+				
+				
+				if (kMy_UnmappedCharacter == kCharacter)
+				{
+					result += appendSequence(ptr, 1, inoutCharacters);
+				}
+				else
+				{
+					if (kMy_ReplacementCharacter == kCharacter)
+					{
+						++result;
+					}
+					inoutCharacters.push_back(kCharacter);
+				}
+				++ptr;
+			}
+			else
+			{
+				this->pendingBytes.push_back(*ptr);
+				++ptr;
+				if (kMy_DFAAccept == kNextState)
+				{
+					result += appendSequence(&this->pendingBytes[0], this->pendingBytes.size(), inoutCharacters);
+					this->pendingBytes.clear();
+					this->state = 0;
+				}
+				else
+				{
+					this->state = kNextState;
+				}
+			}
+		}
+	}
+	return result;
+}// My_Decoder::appendCharacters
+
+
+/*!
+Decodes bytes of an encoding that has no lookup tables, by
+letting Core Foundation convert as much as it can and holding
+the rest for next time.  The amount held is limited, so that
+a stream that never converts cannot grow without bound.
+
+Returns the number of replacement characters appended.
+
+(2017.10)
+*/
+UInt32
+My_Decoder::
+appendCharactersUntabled	(UInt8 const*				inBytes,
+							 size_t						inByteCount,
+							 std::vector< UniChar >&	inoutCharacters)
+{
+	UInt32		result = 0;
+	
+	
+	this->pendingBytes.insert(this->pendingBytes.end(), inBytes, inBytes + inByteCount);
+	if (false == this->pendingBytes.empty())
+	{
+		CFIndex				bytesUsed = 0;
+		CFRetainRelease		decodedCFString(TextTranslation_PersistentCFStringCreate
+											(kCFAllocatorDefault, &this->pendingBytes[0], this->pendingBytes.size(), this->encoding,
+												false/* is external representation */, bytesUsed, this->pendingBytes.size()/* maximum trim/repeat */),
+											CFRetainRelease::kAlreadyRetained);
+		
+		
+		if (decodedCFString.exists())
+		{
+			CFIndex const	kLength = CFStringGetLength(decodedCFString.returnCFStringRef());
+			size_t const	kOldSize = inoutCharacters.size();
+			
+			
+			inoutCharacters.resize(kOldSize + kLength);
+			CFStringGetCharacters(decodedCFString.returnCFStringRef(), CFRangeMake(0, kLength), &inoutCharacters[kOldSize]);
+			this->pendingBytes.erase(this->pendingBytes.begin(), this->pendingBytes.begin() + bytesUsed);
+		}
+		
+		if (this->pendingBytes.size() > kMy_FallbackCarryLimit)
+		{
+			// no character can be this long; give up on these bytes
+			inoutCharacters.push_back(kMy_ReplacementCharacter);
+			++result;
+			this->pendingBytes.clear();
+		}
+	}
+	return result;
+}// My_Decoder::appendCharactersUntabled
+
+
+/*!
+Decodes UTF-8 in a single pass, without Core Foundation.  The
+errors (and their replacement characters) are exactly those
+of the UTF-8 state machine used by terminal emulators.
+
+Returns the number of replacement characters appended.
+
+(2017.10)
+*/
+UInt32
+My_Decoder::
+appendCharactersUTF8	(UInt8 const*				inBytes,
+						 size_t						inByteCount,
+						 std::vector< UniChar >&	inoutCharacters)
+{
+	UInt32		result = 0;
+	
+	
+	this->codePoints.clear();
+	result = this->utf8Decoder.appendCodePoints(inBytes, inByteCount, this->codePoints);
+	inoutCharacters.reserve(inoutCharacters.size() + this->codePoints.size());
+	for (UnicodeScalarValue codePoint : this->codePoints)
+	{
+		if (codePoint > 0xFFFF)
+		{
+			// UTF-16 requires a surrogate pair
+			codePoint -= 0x10000;
+			inoutCharacters.push_back(STATIC_CAST(0xD800 + (codePoint >> 10), UniChar));
+			inoutCharacters.push_back(STATIC_CAST(0xDC00 + (codePoint & 0x03FF), UniChar));
+		}
+		else
+		{
+			inoutCharacters.push_back(STATIC_CAST(codePoint, UniChar));
+		}
+	}
+	return result;
+}// My_Decoder::appendCharactersUTF8
+
+
+/*!
+Appends the translation of one complete character, using the
+lookup tables if possible.
+
+Returns the number of replacement characters appended (0 or 1).
+
+(2017.10)
+*/
+UInt32
+My_Decoder::
+appendSequence	(UInt8 const*				inBytes,
+				 size_t						inByteCount,
+				 std::vector< UniChar >&	inoutCharacters)
+{
+	UniChar		tableCharacter = kMy_UnmappedCharacter;
+	UInt32		result = 0;
+	
+	
+	if (2 == inByteCount)
+	{
+		tableCharacter = this->tables->returnDoubleByteCharacter(inBytes[0], inBytes[1]);
+	}
+	
+	if (kMy_UnmappedCharacter != tableCharacter)
+	{
+		if (kMy_ReplacementCharacter == tableCharacter)
+		{
+			++result;
+		}
+		inoutCharacters.push_back(tableCharacter);
+	}
+	else if (false == appendConvertedSequence(this->encoding, inBytes, inByteCount, inoutCharacters))
+	{
+		inoutCharacters.push_back(kMy_ReplacementCharacter);
+		++result;
+	}
+	return result;
+}// My_Decoder::appendSequence
+
+
+/*!
+Converts a complete byte sequence with Core Foundation and
+appends all of the resulting characters.  Returns true only
+if the conversion succeeded.
+
+(2017.10)
+*/
+Boolean
+appendConvertedSequence		(CFStringEncoding			inEncoding,
+							 UInt8 const*				inBytes,
+							 size_t						inByteCount,
+							 std::vector< UniChar >&	inoutCharacters)
+{
+	CFRetainRelease		convertedCFString(CFStringCreateWithBytes(kCFAllocatorDefault, inBytes, inByteCount, inEncoding,
+																	false/* is external representation */),
+											CFRetainRelease::kAlreadyRetained);
+	Boolean				result = false;
+	
+	
+	if (convertedCFString.exists())
+	{
+		CFIndex const	kLength = CFStringGetLength(convertedCFString.returnCFStringRef());
+		size_t const	kOldSize = inoutCharacters.size();
+		
+		
+		inoutCharacters.resize(kOldSize + kLength);
+		CFStringGetCharacters(convertedCFString.returnCFStringRef(), CFRangeMake(0, kLength), &inoutCharacters[kOldSize]);
+		result = (kLength > 0);
+	}
+	return result;
+}// appendConvertedSequence
+
 /*!
 Constructs the internal menu of available text
 encodings, and the sorted list of character set
@@ -518,6 +1069,197 @@ fillInCharacterSetList	(Boolean	inForce)
 }// fillInCharacterSetList
 
 
+/*!
+Defines the state machine that finds character boundaries in
+the given encoding.  Returns true only if the encoding is one
+that can be decoded with tables: any single-byte character
+set, or one of the common multi-byte sets (Shift-JIS, EUC,
+Big 5, GBK, GB 18030 and Unified Hangul Code).
+
+The machines are deliberately lenient about exactly which
+trail bytes are defined; the lookup tables turn undefined
+combinations into U+FFFD.
+
+(2017.10)
+*/
+Boolean
+fillInDFA	(CFStringEncoding	inEncoding,
+			 My_DFA&			outDFA)
+{
+	Boolean		result = true;
+	
+	
+	outDFA.clear();
+	switch (inEncoding)
+	{
+	case kCFStringEncodingShiftJIS:
+	case kCFStringEncodingShiftJIS_X0213:
+	case kCFStringEncodingDOSJapanese:
+		outDFA.resize(2);
+		outDFA[0].setRange(0x00, 0xFF, kMy_DFAAccept);
+		outDFA[0].setRange(0x81, 0x9F, 1);
+		outDFA[0].setRange(0xE0, 0xFC, 1);
+		outDFA[1].setRange(0x00, 0xFF, kMy_DFAError);
+		outDFA[1].setRange(0x40, 0x7E, kMy_DFAAccept);
+		outDFA[1].setRange(0x80, 0xFC, kMy_DFAAccept);
+		break;
+	
+	case kCFStringEncodingEUC_JP:
+	case kCFStringEncodingEUC_KR:
+	case kCFStringEncodingEUC_CN:
+	case kCFStringEncodingEUC_TW:
+		// each state N means “N more bytes are needed”
+		outDFA.resize(4);
+		outDFA[0].setRange(0x00, 0xFF, kMy_DFAAccept);
+		outDFA[0].setRange(0xA1, 0xFE, 1);
+		outDFA[1].setRange(0x00, 0xFF, kMy_DFAError);
+		outDFA[1].setRange(0xA1, 0xFE, kMy_DFAAccept);
+		outDFA[2].setRange(0x00, 0xFF, kMy_DFAError);
+		outDFA[2].setRange(0xA1, 0xFE, 1);
+		outDFA[3].setRange(0x00, 0xFF, kMy_DFAError);
+		outDFA[3].setRange(0xA1, 0xB0, 2);
+		if (kCFStringEncodingEUC_JP == inEncoding)
+		{
+			outDFA[0].next[0x8E] = 1; // single shift 2: half-width katakana
+			outDFA[0].next[0x8F] = 2; // single shift 3: JIS X 0212
+		}
+		else if (kCFStringEncodingEUC_TW == inEncoding)
+		{
+			outDFA[0].next[0x8E] = 3; // single shift 2: CNS 11643 plane and character
+		}
+		break;
+	
+	case kCFStringEncodingBig5:
+	case kCFStringEncodingBig5_HKSCS_1999:
+	case kCFStringEncodingBig5_E:
+	case kCFStringEncodingDOSChineseTrad:
+		outDFA.resize(2);
+		outDFA[0].setRange(0x00, 0xFF, kMy_DFAAccept);
+		outDFA[0].setRange(0x81, 0xFE, 1);
+		outDFA[1].setRange(0x00, 0xFF, kMy_DFAError);
+		outDFA[1].setRange(0x40, 0x7E, kMy_DFAAccept);
+		outDFA[1].setRange(0xA1, 0xFE, kMy_DFAAccept);
+		break;
+	
+	case kCFStringEncodingGBK_95:
+	case kCFStringEncodingDOSChineseSimplif:
+	case kCFStringEncodingGB_18030_2000:
+		outDFA.resize(4);
+		outDFA[0].setRange(0x00, 0xFF, kMy_DFAAccept);
+		outDFA[0].setRange(0x81, 0xFE, 1);
+		outDFA[1].setRange(0x00, 0xFF, kMy_DFAError);
+		outDFA[1].setRange(0x40, 0x7E, kMy_DFAAccept);
+		outDFA[1].setRange(0x80, 0xFE, kMy_DFAAccept);
+		outDFA[2].setRange(0x00, 0xFF, kMy_DFAError);
+		outDFA[2].setRange(0x81, 0xFE, 3);
+		outDFA[3].setRange(0x00, 0xFF, kMy_DFAError);
+		outDFA[3].setRange(0x30, 0x39, kMy_DFAAccept);
+		if (kCFStringEncodingGB_18030_2000 == inEncoding)
+		{
+			outDFA[1].setRange(0x30, 0x39, 2); // four-byte sequence
+		}
+		break;
+	
+	case kCFStringEncodingDOSKorean:
+		outDFA.resize(2);
+		outDFA[0].setRange(0x00, 0xFF, kMy_DFAAccept);
+		outDFA[0].setRange(0x81, 0xFE, 1);
+		outDFA[1].setRange(0x00, 0xFF, kMy_DFAError);
+		outDFA[1].setRange(0x41, 0x5A, kMy_DFAAccept);
+		outDFA[1].setRange(0x61, 0x7A, kMy_DFAAccept);
+		outDFA[1].setRange(0x81, 0xFE, kMy_DFAAccept);
+		break;
+	
+	case kCFStringEncodingNonLossyASCII:
+	case kCFStringEncodingUTF7:
+		// these spell characters with escapes, so bytes are not characters
+		result = false;
+		break;
+	
+	default:
+		if (1 == CFStringGetMaximumSizeForEncoding(1, inEncoding))
+		{
+			// single-byte character set; every byte is a character
+			outDFA.resize(1);
+			outDFA[0].setRange(0x00, 0xFF, kMy_DFAAccept);
+		}
+		else
+		{
+			// Unicode encodings, shift-state encodings (such as
+			// ISO 2022) and others are not table-driven
+			result = false;
+		}
+		break;
+	}
+	return result;
+}// fillInDFA
+
+
+/*!
+Returns the shared lookup tables for the given encoding,
+creating them the first time.  Returns nullptr if the encoding
+cannot be table-driven (see fillInDFA()).
+
+(2017.10)
+*/
+My_DecoderTablesPtr
+returnDecoderTables		(CFStringEncoding	inEncoding)
+{
+	My_DecoderTablesPtr						result = nullptr;
+	My_DecoderTablesByEncoding::iterator	toTables = gDecoderTablesByEncoding().find(inEncoding);
+	
+	
+	if (gDecoderTablesByEncoding().end() != toTables)
+	{
+		result = toTables->second;
+	}
+	else
+	{
+		My_DFA		dfa;
+		
+		
+		if (fillInDFA(inEncoding, dfa))
+		{
+			result = new My_DecoderTables(inEncoding, dfa);
+		}
+		gDecoderTablesByEncoding()[inEncoding] = result; // nullptr is also remembered
+	}
+	return result;
+}// returnDecoderTables
+
+
+/*!
+Converts one complete character for storage in a lookup table:
+the character itself if it is a single UTF-16 unit, U+FFFD if
+it cannot be converted, or "kMy_UnmappedCharacter" if it must
+be converted every time (e.g. it produces a surrogate pair).
+
+(2017.10)
+*/
+UniChar
+returnTableEntry	(CFStringEncoding	inEncoding,
+					 UInt8 const*		inBytes,
+					 size_t				inByteCount)
+{
+	std::vector< UniChar >	characters;
+	UniChar					result = kMy_ReplacementCharacter;
+	
+	
+	if (appendConvertedSequence(inEncoding, inBytes, inByteCount, characters))
+	{
+		if ((1 == characters.size()) && (kMy_UnmappedCharacter != characters[0]))
+		{
+			result = characters[0];
+		}
+		else
+		{
+			result = kMy_UnmappedCharacter;
+		}
+	}
+	return result;
+}// returnTableEntry
+
+
 /*!
 A standard comparison function that expects
 both of its operands to be of type
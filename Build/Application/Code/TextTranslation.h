@@ -35,6 +35,9 @@
 
 #pragma once
 
+// standard-C++ includes
+#include <vector>
+
 // Mac includes
 #include <Carbon/Carbon.h>
 #include <CoreServices/CoreServices.h>
@@ -44,6 +47,12 @@
 
 
 
+#pragma mark Types
+
+typedef struct TextTranslation_OpaqueDecoder*	TextTranslation_DecoderRef;	//!< incremental converter of bytes into Unicode
+
+
+
 #pragma mark Public Methods
 
 //!\name Initialization
@@ -57,6 +66,26 @@ void
 
 //@}
 
+//!\name Incremental Decoding
+//@{
+
+TextTranslation_DecoderRef
+	TextTranslation_NewDecoder					(CFStringEncoding		inEncoding);
+
+void
+	TextTranslation_DisposeDecoder				(TextTranslation_DecoderRef*	inoutRefPtr);
+
+UInt32
+	TextTranslation_DecoderAppendCharacters		(TextTranslation_DecoderRef	inDecoder,
+												 UInt8 const*				inBytes,
+												 size_t						inByteCount,
+												 std::vector< UniChar >&	inoutCharacters);
+
+CFStringEncoding
+	TextTranslation_DecoderReturnEncoding		(TextTranslation_DecoderRef	inDecoder);
+
+//@}
+
 //!\name Utilities
 //@{
 
@@ -40,6 +40,9 @@
 
 // standard-C++ includes
 #include <algorithm>
+#include <bitset>
+#include <deque>
+#include <vector>
 
 // Mac includes
 #include <ApplicationServices/ApplicationServices.h>
@@ -70,6 +73,77 @@
 #define IS_WHITE_SPACE_CHARACTER(a)			(' ' == (a) || '\t' == (a))
 #define IS_WHITE_SPACE_OR_CR_CHARACTER(a)	(IS_WHITE_SPACE_CHARACTER(a) || CR == (a))
 
+namespace {
+
+UInt16 const	kMy_AutomatonCharacterCount = 128;	// prefixes may only use ASCII characters
+
+} // anonymous namespace
+
+#pragma mark Types
+namespace {
+
+/*!
+A prefix that identifies a URL (or some other text that can
+be opened as a URL), and the rules for the rest of the text.
+*/
+struct My_Pattern
+{
+	My_Pattern	(CFStringRef, URL_PatternTail, URL_Type, CFStringRef = nullptr);
+	
+	CFRetainRelease		prefix;			//!< text that starts the pattern; compared without regard to case
+	CFRetainRelease		urlTemplate;	//!< if defined, "%@" is replaced by the matched text to produce a URL
+	URL_PatternTail		tail;			//!< rule for the text after the prefix
+	URL_Type			type;			//!< the kind of URL matched by this pattern
+};
+typedef std::vector< My_Pattern >	My_PatternList;
+
+/*!
+A deterministic automaton that can find any number of pattern
+prefixes in a single pass over text (Aho-Corasick); since every
+state has a complete transition table, scanning never needs to
+follow failure links.  Each prefix match is then checked by a
+simple loop for the rest of its pattern (see scanPatternTail()).
+
+This is rebuilt whenever patterns are added.
+*/
+struct My_PrefixAutomaton
+{
+	struct State
+	{
+		State ();
+		
+		UInt16		next[kMy_AutomatonCharacterCount];	//!< state to enter for each lowercase ASCII character
+		SInt16		output;								//!< index of longest pattern whose prefix ends here, or -1
+		UInt16		depth;								//!< number of characters matched from the start of a prefix
+	};
+	
+	My_PrefixAutomaton ();
+	
+	void
+	compile ();
+	
+	std::vector< State >	states;			//!< state 0 is the initial state
+	My_PatternList			patterns;		//!< every pattern, built-in or otherwise
+	Boolean					isCompiled;		//!< if false, "states" must be rebuilt before use
+};
+
+} // anonymous namespace
+
+#pragma mark Internal Method Prototypes
+namespace {
+
+CFStringRef		copyPatternURL				(CFStringRef);
+Boolean			isURLCharacter				(UniChar);
+Boolean			isWordCharacter				(UniChar);
+UniChar const*	scanPatternTail				(UniChar const*, UniChar const*, URL_PatternTail);
+Boolean			unitTest_Automaton_000		();
+URL_MatchList	unitTest_FindMatches		(char const*);
+Boolean			unitTest_Matches_000		();
+Boolean			unitTest_Patterns_000		();
+Boolean			unitTest_Tails_000			();
+
+} // anonymous namespace
+
 #pragma mark Variables
 namespace {
 
@@ -100,11 +174,153 @@ char const*		gURLSchemeNames[] =
 	nullptr // this list must end with a nullptr
 };
 
+My_PrefixAutomaton&		gPrefixAutomaton ()
+						{
+							static My_PrefixAutomaton	x;
+							
+							
+							unless (x.isCompiled)
+							{
+								x.compile();
+							}
+							return x;
+						}
+
 } // anonymous namespace
 
 
 #pragma mark Public Methods
 
+/*!
+Adds a pattern that allows text to be found by routines such
+as URL_FindMatchesInCharacterRange() and opened as a URL (for
+example, ticket numbers in a bug database).
+
+The prefix must be nonempty and use only ASCII characters; it
+is matched without regard to case, and only at the start of a
+word.  At least one character must follow the prefix, and the
+tail rule determines which characters are part of the match.
+
+The template is used to open matching text as a URL: every
+occurrence of "%@" is replaced by the complete match.  For
+example, the prefix "BUG-" with a digit tail and the template
+"https://bugs.example.com/show?id=%@" allows text such as
+"BUG-123" to be command-clicked.
+
+Returns true only if the pattern was added.
+
+(2017.10)
+*/
+Boolean
+URL_AddPattern	(CFStringRef		inPrefix,
+				 URL_PatternTail	inTail,
+				 CFStringRef		inURLTemplate)
+{
+	Boolean		result = false;
+	
+	
+	if ((nullptr != inPrefix) && (nullptr != inURLTemplate) && (CFStringGetLength(inPrefix) > 0) &&
+		(kCFNotFound != CFStringFind(inURLTemplate, CFSTR("%@"), 0).location))
+	{
+		CFIndex const	kLength = CFStringGetLength(inPrefix);
+		
+		
+		result = true;
+		for (CFIndex i = 0; i < kLength; ++i)
+		{
+			if (CFStringGetCharacterAtIndex(inPrefix, i) >= kMy_AutomatonCharacterCount)
+			{
+				result = false;
+				break;
+			}
+		}
+		
+		if (result)
+		{
+			My_PrefixAutomaton&		automaton = gPrefixAutomaton();
+			
+			
+			automaton.patterns.push_back(My_Pattern(inPrefix, inTail, kURL_TypeInvalid, inURLTemplate));
+			automaton.isCompiled = false;
+		}
+	}
+	return result;
+}// AddPattern
+
+
+/*!
+Finds every URL (or user-defined pattern; see URL_AddPattern())
+in the given text, replacing the contents of the given list.
+Matches never overlap, and they are in order of offset.
+
+Absolute pathnames (such as "/usr/local/x" or "~/foo.txt")
+are also found, and have the type "kURL_TypeFile".  Relative
+pathnames are not found, since they depend on the directory
+of whatever process printed them.
+
+All patterns are found in a single pass over the text, so this
+is efficient enough to run on every row that changes in a
+terminal screen.
+
+(2017.10)
+*/
+void
+URL_FindMatchesInCharacterRange		(UniChar const*		inBegin,
+									 UniChar const*		inPastEnd,
+									 URL_MatchList&		outMatches)
+{
+	My_PrefixAutomaton const&	kAutomaton = gPrefixAutomaton();
+	UInt16						state = 0;
+	
+	
+	outMatches.clear();
+	for (UniChar const* ptr = inBegin; ptr < inPastEnd; ++ptr)
+	{
+		UniChar const	kCharacter = *ptr;
+		SInt16			output = -1;
+		
+		
+		state = (kCharacter < kMy_AutomatonCharacterCount)
+				? kAutomaton.states[state].next[std::tolower(kCharacter)]
+				: 0;
+		output = kAutomaton.states[state].output;
+		if (output >= 0)
+		{
+			My_Pattern const&	kPattern = kAutomaton.patterns[output];
+			UniChar const*		matchBegin = ptr + 1 - CFStringGetLength(kPattern.prefix.returnCFStringRef());
+			
+			
+			// patterns may only begin at the start of a word (and pathnames
+			// are not found within relative paths such as "./x" or "../x",
+			// or within URLs that were not matched, such as "xyz://host/x")
+			if ((inBegin == matchBegin) ||
+				((false == isWordCharacter(matchBegin[-1])) &&
+					((kURL_PatternTailPath != kPattern.tail) ||
+						(('.' != matchBegin[-1]) && (':' != matchBegin[-1]) && ('/' != matchBegin[-1])))))
+			{
+				UniChar const*		matchPastEnd = scanPatternTail(ptr + 1, inPastEnd, kPattern.tail);
+				
+				
+				if (matchPastEnd != (ptr + 1))
+				{
+					URL_Match	match;
+					
+					
+					match.offset = STATIC_CAST(matchBegin - inBegin, UInt16);
+					match.length = STATIC_CAST(matchPastEnd - matchBegin, UInt16);
+					match.type = kPattern.type;
+					outMatches.push_back(match);
+					
+					// resume after the match
+					ptr = matchPastEnd - 1;
+					state = 0;
+				}
+			}
+		}
+	}
+}// FindMatchesInCharacterRange
+
+
 /*!
 Examines the currently-selected text of the specified
 terminal view for a valid URL.  If it finds one, the
@@ -129,6 +345,21 @@ URL_HandleForScreenView		(TerminalScreenRef	UNUSED_ARGUMENT(inScreen),
 		URL_Type		urlKind = URL_ReturnTypeFromCFString(urlAsCFString);
 		
 		
+		if (kURL_TypeInvalid == urlKind)
+		{
+			// the text may match a pattern that can be converted into a URL
+			// (such as a host name, or a user-defined pattern)
+			CFRetainRelease		patternURL(copyPatternURL(urlAsCFString), CFRetainRelease::kAlreadyRetained);
+			
+			
+			if (patternURL.exists())
+			{
+				urlObject = patternURL;
+				urlAsCFString = urlObject.returnCFStringRef();
+				urlKind = URL_ReturnTypeFromCFString(urlAsCFString);
+			}
+		}
+		
 		if (kURL_TypeInvalid != urlKind)
 		{
 			std::string		urlUTF8;
@@ -335,27 +566,751 @@ URL_Type
 URL_ReturnTypeFromCharacterRange	(char const*	inBegin,
 									 char const*	inPastEnd)
 {
-	URL_Type	result = kURL_TypeInvalid;
-	SInt16		i = 0;
+	My_PrefixAutomaton const&	kAutomaton = gPrefixAutomaton();
+	URL_Type					result = kURL_TypeInvalid;
+	UInt16						state = 0;
 	
 	
-	// look for a match on the prefix (e.g. "http:")
-	for (i = 0; (nullptr != gURLSchemeNames[i]); ++i)
+	// look for a match on the prefix (e.g. "http:"); the automaton
+	// reports the longest prefix ending at each character, so the
+	// match is valid only if it spans the whole string so far
+	for (char const* ptr = inBegin; ptr != inPastEnd; ++ptr)
 	{
-		char const* const	kCStringPtr = gURLSchemeNames[i];
+		UInt8 const		kCharacter = STATIC_CAST(*ptr, UInt8);
+		SInt16			output = -1;
 		
 		
-		// obviously the URL must be at least as long as its prefix!
-		if ((inPastEnd - inBegin) > STATIC_CAST(std::strlen(kCStringPtr), ptrdiff_t))
+		if (kCharacter >= kMy_AutomatonCharacterCount)
+		{
+			break;
+		}
+		state = kAutomaton.states[state].next[std::tolower(kCharacter)];
+		output = kAutomaton.states[state].output;
+		if (output >= 0)
 		{
-			if (std::equal(kCStringPtr, kCStringPtr + std::strlen(kCStringPtr), inBegin))
+			My_Pattern const&	kPattern = kAutomaton.patterns[output];
+			
+			
+			// patterns that require a template are not real URLs;
+			// and obviously the URL must be longer than its prefix!
+			if (CFStringGetLength(kPattern.prefix.returnCFStringRef()) == (ptr + 1 - inBegin))
 			{
-				result = STATIC_CAST(i, URL_Type);
+				if ((false == kPattern.urlTemplate.exists()) && ((ptr + 1) != inPastEnd))
+				{
+					result = kPattern.type;
+				}
 				break;
 			}
 		}
+		if (kAutomaton.states[state].depth != (ptr + 1 - inBegin))
+		{
+			// no prefix can begin at the start of the string
+			break;
+		}
 	}
 	return result;
 }// ReturnTypeFromCharacterRange
 
+
+/*!
+A unit test suite for this module.  Results are
+printed to the console.
+
+The pattern test temporarily adds patterns, and
+restores the original list before returning.
+
+(2017.10)
+*/
+void
+URL_RunTests ()
+{
+	UInt16		totalTests = 0;
+	UInt16		failedTests = 0;
+	
+	
+	++totalTests; if (false == unitTest_Automaton_000()) ++failedTests;
+	++totalTests; if (false == unitTest_Tails_000()) ++failedTests;
+	++totalTests; if (false == unitTest_Matches_000()) ++failedTests;
+	++totalTests; if (false == unitTest_Patterns_000()) ++failedTests;
+	
+	Console_WriteUnitTestReport("URL", failedTests, totalTests);
+}// RunTests
+
+
+#pragma mark Internal Methods
+namespace {
+
+/*!
+Constructor.
+
+(2017.10)
+*/
+My_Pattern::
+My_Pattern	(CFStringRef		inPrefix,
+			 URL_PatternTail	inTail,
+			 URL_Type			inType,
+			 CFStringRef		inURLTemplateOrNull)
+:
+prefix(CFStringCreateCopy(kCFAllocatorDefault, inPrefix), CFRetainRelease::kAlreadyRetained),
+urlTemplate(inURLTemplateOrNull, CFRetainRelease::kNotYetRetained),
+tail(inTail),
+type(inType)
+{
+}// My_Pattern 4-argument constructor
+
+
+/*!
+Constructor.  Adds every pattern for the standard URL
+schemes; the automaton is compiled when first used.
+
+(2017.10)
+*/
+My_PrefixAutomaton::
+My_PrefixAutomaton ()
+:
+states(),
+patterns(),
+isCompiled(false)
+{
+	// the first entry only exists to represent an invalid URL
+	for (SInt16 i = 1; (nullptr != gURLSchemeNames[i]); ++i)
+	{
+		CFRetainRelease		schemeCFString(CFStringCreateWithCString(kCFAllocatorDefault, gURLSchemeNames[i], kCFStringEncodingASCII),
+											CFRetainRelease::kAlreadyRetained);
+		
+		
+		this->patterns.push_back(My_Pattern(schemeCFString.returnCFStringRef(), kURL_PatternTailURL, STATIC_CAST(i, URL_Type)));
+	}
+	
+	// host names are common enough to be recognized without a scheme
+	this->patterns.push_back(My_Pattern(CFSTR("www."), kURL_PatternTailName, kURL_TypeHTTP, CFSTR("http://%@")));
+	
+	// absolute pathnames (including those relative to the home directory)
+	// are opened as file URLs; see copyPatternURL()
+	this->patterns.push_back(My_Pattern(CFSTR("/"), kURL_PatternTailPath, kURL_TypeFile, CFSTR("file://%@")));
+	this->patterns.push_back(My_Pattern(CFSTR("~/"), kURL_PatternTailPath, kURL_TypeFile, CFSTR("file://%@")));
+}// My_PrefixAutomaton default constructor
+
+
+/*!
+Constructor.
+
+(2017.10)
+*/
+My_PrefixAutomaton::State::
+State ()
+:
+output(-1),
+depth(0)
+{
+	std::fill(next, next + kMy_AutomatonCharacterCount, 0);
+}// My_PrefixAutomaton::State default constructor
+
+
+/*!
+Rebuilds the states of the automaton for all current patterns:
+first as a tree of prefixes, then (by walking the tree in order
+of depth) filling in every missing transition with the state
+that the failure link would eventually reach.
+
+(2017.10)
+*/
+void
+My_PrefixAutomaton::
+compile ()
+{
+	std::vector< UInt16 >	failureLinks;
+	std::deque< UInt16 >	queue;
+	
+	
+	this->states.clear();
+	this->states.push_back(State());
+	
+	// build a tree of prefixes; since no state can transition
+	// back to the initial state, zero means “no transition”
+	for (size_t i = 0; i < this->patterns.size(); ++i)
+	{
+		CFStringRef const	kPrefix = this->patterns[i].prefix.returnCFStringRef();
+		CFIndex const		kLength = CFStringGetLength(kPrefix);
+		UInt16				state = 0;
+		
+		
+		for (CFIndex j = 0; j < kLength; ++j)
+		{
+			UniChar const	kCharacter = STATIC_CAST(std::tolower(CFStringGetCharacterAtIndex(kPrefix, j)), UniChar);
+			
+			
+			if (0 == this->states[state].next[kCharacter])
+			{
+				this->states[state].next[kCharacter] = STATIC_CAST(this->states.size(), UInt16);
+				this->states.push_back(State());
+				this->states.back().depth = this->states[state].depth + 1;
+			}
+			state = this->states[state].next[kCharacter];
+		}
+		
+		// if the same prefix is added twice, the first one wins
+		if (this->states[state].output < 0)
+		{
+			this->states[state].output = STATIC_CAST(i, SInt16);
+		}
+	}
+	
+	// convert the tree into a complete automaton, breadth-first
+	failureLinks.resize(this->states.size(), 0);
+	for (UInt16 i = 0; i < kMy_AutomatonCharacterCount; ++i)
+	{
+		UInt16 const	kChild = this->states[0].next[i];
+		
+		
+		if (0 != kChild)
+		{
+			queue.push_back(kChild);
+		}
+	}
+	while (false == queue.empty())
+	{
+		UInt16 const	kState = queue.front();
+		UInt16 const	kFailureState = failureLinks[kState];
+		
+		
+		queue.pop_front();
+		
+		// a state that ends no prefix still reports the longest
+		// prefix that ends with the same characters
+		if (this->states[kState].output < 0)
+		{
+			this->states[kState].output = this->states[kFailureState].output;
+		}
+		
+		for (UInt16 i = 0; i < kMy_AutomatonCharacterCount; ++i)
+		{
+			UInt16 const	kChild = this->states[kState].next[i];
+			
+			
+			if (0 != kChild)
+			{
+				failureLinks[kChild] = this->states[kFailureState].next[i];
+				queue.push_back(kChild);
+			}
+			else
+			{
+				this->states[kState].next[i] = this->states[kFailureState].next[i];
+			}
+		}
+	}
+	
+	this->isCompiled = true;
+}// My_PrefixAutomaton::compile
+
+
+/*!
+If the given text exactly matches a pattern that has a URL
+template (see URL_AddPattern()), returns a new string with
+the URL; otherwise, returns nullptr.  Release the string with
+CFRelease() when finished.
+
+Pathnames are converted into file URLs (with any “~” replaced
+by the home directory, and any special characters escaped)
+instead of using their template.
+
+(2017.10)
+*/
+CFStringRef
+copyPatternURL	(CFStringRef	inText)
+{
+	CFStringRef		result = nullptr;
+	CFIndex const	kLength = CFStringGetLength(inText);
+	
+	
+	if (kLength > 0)
+	{
+		std::vector< UniChar >	buffer(kLength);
+		URL_MatchList			matches;
+		
+		
+		CFStringGetCharacters(inText, CFRangeMake(0, kLength), &buffer[0]);
+		URL_FindMatchesInCharacterRange(&buffer[0], &buffer[0] + kLength, matches);
+		if ((1 == matches.size()) && (0 == matches[0].offset) && (kLength == matches[0].length))
+		{
+			// find the pattern that matched; it must be a template
+			My_PrefixAutomaton const&	kAutomaton = gPrefixAutomaton();
+			
+			
+			for (auto const& kPattern : kAutomaton.patterns)
+			{
+				if (kPattern.urlTemplate.exists() && (kLength > CFStringGetLength(kPattern.prefix.returnCFStringRef())) &&
+					(kCFCompareEqualTo == CFStringCompareWithOptions(inText, kPattern.prefix.returnCFStringRef(),
+																		CFRangeMake(0, CFStringGetLength(kPattern.prefix.returnCFStringRef())),
+																		kCFCompareCaseInsensitive)))
+				{
+					if (kURL_TypeFile == kPattern.type)
+					{
+						CFMutableStringRef	mutablePath = CFStringCreateMutableCopy(kCFAllocatorDefault, 0/* length or 0 for unlimited */,
+																					inText);
+						
+						
+						if (nullptr != mutablePath)
+						{
+							if ('~' == CFStringGetCharacterAtIndex(mutablePath, 0))
+							{
+								CFRetainRelease		homeURL(CFCopyHomeDirectoryURL(), CFRetainRelease::kAlreadyRetained);
+								CFRetainRelease		homePath((homeURL.exists())
+																? CFURLCopyFileSystemPath(homeURL.returnCFURLRef(), kCFURLPOSIXPathStyle)
+																: nullptr,
+																CFRetainRelease::kAlreadyRetained);
+								
+								
+								if (homePath.exists())
+								{
+									CFStringReplace(mutablePath, CFRangeMake(0, 1), homePath.returnCFStringRef());
+								}
+							}
+							
+							{
+								CFRetainRelease		fileURL(CFURLCreateWithFileSystemPath(kCFAllocatorDefault, mutablePath,
+																							kCFURLPOSIXPathStyle, false/* is directory */),
+															CFRetainRelease::kAlreadyRetained);
+								
+								
+								if (fileURL.exists())
+								{
+									result = CFStringCreateCopy(kCFAllocatorDefault, CFURLGetString(fileURL.returnCFURLRef()));
+								}
+							}
+							CFRelease(mutablePath), mutablePath = nullptr;
+						}
+					}
+					else
+					{
+						CFMutableStringRef	mutableURL = CFStringCreateMutableCopy(kCFAllocatorDefault, 0/* length or 0 for unlimited */,
+																					kPattern.urlTemplate.returnCFStringRef());
+						
+						
+						if (nullptr != mutableURL)
+						{
+							UNUSED_RETURN(CFIndex)CFStringFindAndReplace(mutableURL, CFSTR("%@"), inText,
+																			CFRangeMake(0, CFStringGetLength(mutableURL)), 0/* options */);
+							result = mutableURL;
+						}
+					}
+					break;
+				}
+			}
+		}
+	}
+	return result;
+}// copyPatternURL
+
+
+/*!
+Returns true only if the given character can appear in a URL
+(ignoring the position of the character).  Non-ASCII characters
+are allowed, since terminals often display decoded URLs.
+
+(2017.10)
+*/
+Boolean
+isURLCharacter	(UniChar	inCharacter)
+{
+	static std::bitset< kMy_AutomatonCharacterCount >	allowedASCII;
+	Boolean												result = true;
+	
+	
+	if (allowedASCII.none())
+	{
+		char const*		kDisallowed = "<>\"{}|\\^`";
+		
+		
+		for (UInt16 i = 0x21; i < 0x7F; ++i)
+		{
+			allowedASCII[i] = (nullptr == std::strchr(kDisallowed, i));
+		}
+	}
+	
+	if (inCharacter < kMy_AutomatonCharacterCount)
+	{
+		result = allowedASCII[inCharacter];
+	}
+	else
+	{
+		// exclude some common Unicode spaces and quotation marks
+		result = ((inCharacter > 0x00A0) && (0x2028 != inCharacter) && (0x3000 != inCharacter) &&
+					((inCharacter < 0x2018) || (inCharacter > 0x201F)));
+	}
+	return result;
+}// isURLCharacter
+
+
+/*!
+Returns true only if the given character is a letter or
+digit (in any script); patterns may not start after such
+characters.  Other characters, such as punctuation (including
+non-ASCII quotation marks) and spaces, allow a pattern to
+start immediately after them.
+
+(2017.10)
+*/
+Boolean
+isWordCharacter		(UniChar	inCharacter)
+{
+	Boolean		result = false;
+	
+	
+	if (inCharacter < kMy_AutomatonCharacterCount)
+	{
+		result = (0 != std::isalnum(inCharacter));
+	}
+	else
+	{
+		CFCharacterSetRef const		kAlphanumericSet = CFCharacterSetGetPredefined(kCFCharacterSetAlphaNumeric);
+		
+		
+		result = CFCharacterSetIsCharacterMember(kAlphanumericSet, inCharacter);
+	}
+	return result;
+}// isWordCharacter
+
+
+/*!
+Returns the end of the text (starting immediately after a
+pattern’s prefix) that satisfies the given rule.  If nothing
+matches, the result is the same as "inBegin".
+
+For URLs, trailing punctuation is not included (since it
+is more likely to be part of the surrounding sentence), nor
+is a closing parenthesis that has no opening parenthesis.
+
+(2017.10)
+*/
+UniChar const*
+scanPatternTail		(UniChar const*		inBegin,
+					 UniChar const*		inPastEnd,
+					 URL_PatternTail	inTail)
+{
+	UniChar const*		result = inBegin;
+	
+	
+	switch (inTail)
+	{
+	case kURL_PatternTailDigits:
+		while ((result != inPastEnd) && (*result >= '0') && (*result <= '9'))
+		{
+			++result;
+		}
+		break;
+	
+	case kURL_PatternTailName:
+		while ((result != inPastEnd) && (*result < kMy_AutomatonCharacterCount) &&
+				(std::isalnum(*result) || ('.' == *result) || ('-' == *result) || ('_' == *result)))
+		{
+			++result;
+		}
+		while ((result != inBegin) && (('.' == result[-1]) || ('-' == result[-1])))
+		{
+			--result;
+		}
+		break;
+	
+	case kURL_PatternTailPath:
+	case kURL_PatternTailURL:
+	default:
+		{
+			SInt16		parenthesisDepth = 0;
+			
+			
+			if ((kURL_PatternTailPath == inTail) && (result != inPastEnd) && ('/' == *result))
+			{
+				// a pathname cannot begin with two slashes (this is more
+				// likely to be a comment marker, such as "// text")
+				break;
+			}
+			
+			for (; (result != inPastEnd) && isURLCharacter(*result); ++result)
+			{
+				if ('(' == *result)
+				{
+					++parenthesisDepth;
+				}
+				else if (')' == *result)
+				{
+					if (0 == parenthesisDepth)
+					{
+						break;
+					}
+					--parenthesisDepth;
+				}
+			}
+			while ((result != inBegin) && (result[-1] < kMy_AutomatonCharacterCount) && (0 != result[-1]) &&
+					(nullptr != std::strchr(".,;:!?'*", STATIC_CAST(result[-1], char))))
+			{
+				--result;
+			}
+		}
+		break;
+	}
+	return result;
+}// scanPatternTail
+
+
+/*!
+Tests the compiled automaton with prefixes that overlap in
+every way (one inside another, one ending another, and one
+extending another), and the prefix checks that rely on it.
+
+Returns "true" if ALL assertions pass; "false" is
+returned if any fail, however messages should be
+printed for ALL assertion failures regardless.
+
+(2017.10)
+*/
+Boolean
+unitTest_Automaton_000 ()
+{
+	My_PrefixAutomaton		automaton;
+	char const*				kText = "ushers";
+	std::vector< SInt16 >	outputs;
+	UInt16					state = 0;
+	Boolean					result = true;
+	
+	
+	automaton.patterns.clear();
+	automaton.patterns.push_back(My_Pattern(CFSTR("he"), kURL_PatternTailURL, kURL_TypeInvalid));
+	automaton.patterns.push_back(My_Pattern(CFSTR("SHE"), kURL_PatternTailURL, kURL_TypeInvalid));
+	automaton.patterns.push_back(My_Pattern(CFSTR("his"), kURL_PatternTailURL, kURL_TypeInvalid));
+	automaton.patterns.push_back(My_Pattern(CFSTR("hers"), kURL_PatternTailURL, kURL_TypeInvalid));
+	automaton.compile();
+	result &= Console_Assert("automaton compiled", automaton.isCompiled);
+	
+	for (char const* ptr = kText; '\0' != *ptr; ++ptr)
+	{
+		state = automaton.states[state].next[STATIC_CAST(*ptr, UInt8)];
+		outputs.push_back(automaton.states[state].output);
+	}
+	// "she" (not "he") is reported at the first "e", since it is
+	// longer; "hers" is reported even though "he" was a match
+	result &= Console_Assert("automaton output count", 6 == outputs.size());
+	result &= Console_Assert("automaton no early output", (-1 == outputs[0]) && (-1 == outputs[1]) && (-1 == outputs[2]));
+	result &= Console_Assert("automaton longest overlapping prefix (case-insensitive)", 1 == outputs[3]);
+	result &= Console_Assert("automaton no output within prefix", -1 == outputs[4]);
+	result &= Console_Assert("automaton extended prefix", 3 == outputs[5]);
+	result &= Console_Assert("automaton depth", 4 == automaton.states[state].depth);
+	
+	// the built-in patterns, as used to classify complete strings
+	{
+		auto	returnType = [](char const* inString) -> URL_Type
+							{
+								return URL_ReturnTypeFromCharacterRange(inString, inString + std::strlen(inString));
+							};
+		
+		
+		result &= Console_Assert("type of ssh URL", kURL_TypeSSH == returnType("ssh://host"));
+		result &= Console_Assert("type of sftp URL", kURL_TypeSFTP == returnType("sftp:x"));
+		result &= Console_Assert("type of https URL", kURL_TypeHTTPS == returnType("HTTPS://a.b"));
+		result &= Console_Assert("type of x-man-page URL", kURL_TypeXManPage == returnType("x-man-page://ls"));
+		result &= Console_Assert("type of prefix only", kURL_TypeInvalid == returnType("http:"));
+		result &= Console_Assert("type of text before scheme", kURL_TypeInvalid == returnType("xhttp://a"));
+		result &= Console_Assert("type of host name (template)", kURL_TypeInvalid == returnType("www.example.com"));
+		result &= Console_Assert("type of pathname (template)", kURL_TypeInvalid == returnType("/usr/bin"));
+	}
+	
+	return result;
+}// unitTest_Automaton_000
+
+
+/*!
+Returns the result of URL_FindMatchesInCharacterRange() for
+the given UTF-8 text.
+
+(2017.10)
+*/
+URL_MatchList
+unitTest_FindMatches	(char const*	inUTF8Text)
+{
+	CFRetainRelease		textCFString(CFStringCreateWithCString(kCFAllocatorDefault, inUTF8Text, kCFStringEncodingUTF8),
+										CFRetainRelease::kAlreadyRetained);
+	CFIndex const		kLength = CFStringGetLength(textCFString.returnCFStringRef());
+	URL_MatchList		result;
+	
+	
+	if (kLength > 0)
+	{
+		std::vector< UniChar >	buffer(kLength);
+		
+		
+		CFStringGetCharacters(textCFString.returnCFStringRef(), CFRangeMake(0, kLength), &buffer[0]);
+		URL_FindMatchesInCharacterRange(&buffer[0], &buffer[0] + kLength, result);
+	}
+	return result;
+}// unitTest_FindMatches
+
+
+/*!
+Tests URL_FindMatchesInCharacterRange() with the built-in
+patterns: word boundaries (including non-ASCII text), the
+trimming of punctuation and parentheses, and pathnames.
+
+Returns "true" if ALL assertions pass; "false" is
+returned if any fail, however messages should be
+printed for ALL assertion failures regardless.
+
+(2017.10)
+*/
+Boolean
+unitTest_Matches_000 ()
+{
+	URL_MatchList	matches;
+	Boolean			result = true;
+	
+	
+	matches = unitTest_FindMatches("see http://example.com/a(b)c). ok");
+	result &= Console_Assert("balanced parentheses, count", 1 == matches.size());
+	result &= Console_Assert("balanced parentheses, range", (1 == matches.size()) && (4 == matches[0].offset) &&
+																(24 == matches[0].length) && (kURL_TypeHTTP == matches[0].type));
+	
+	matches = unitTest_FindMatches("HTTPS://A.B, mailto:a@b.c; nntp:x");
+	result &= Console_Assert("several URLs, count", 3 == matches.size());
+	result &= Console_Assert("several URLs, first (longest scheme, trailing comma)",
+								(3 == matches.size()) && (0 == matches[0].offset) && (11 == matches[0].length) &&
+								(kURL_TypeHTTPS == matches[0].type));
+	result &= Console_Assert("several URLs, second (trailing semicolon)",
+								(3 == matches.size()) && (13 == matches[1].offset) && (12 == matches[1].length) &&
+								(kURL_TypeMailTo == matches[1].type));
+	result &= Console_Assert("several URLs, third (end of text)",
+								(3 == matches.size()) && (27 == matches[2].offset) && (6 == matches[2].length) &&
+								(kURL_TypeNNTP == matches[2].type));
+	
+	result &= Console_Assert("no match within a word", unitTest_FindMatches("xhttp://a.b").empty());
+	result &= Console_Assert("no match within a non-ASCII word", unitTest_FindMatches("éhttp://a.b").empty());
+	result &= Console_Assert("no match for a prefix alone", unitTest_FindMatches("http: and http:.").empty());
+	
+	matches = unitTest_FindMatches("“http://example.com”");
+	result &= Console_Assert("after non-ASCII quotation mark", (1 == matches.size()) && (1 == matches[0].offset) &&
+																(18 == matches[0].length));
+	
+	matches = unitTest_FindMatches("go to www.example.com.");
+	result &= Console_Assert("host name", (1 == matches.size()) && (6 == matches[0].offset) && (15 == matches[0].length) &&
+											(kURL_TypeHTTP == matches[0].type));
+	
+	matches = unitTest_FindMatches("ls /usr/local/x and ~/foo.txt.");
+	result &= Console_Assert("pathnames, count", 2 == matches.size());
+	result &= Console_Assert("absolute pathname", (2 == matches.size()) && (3 == matches[0].offset) && (12 == matches[0].length) &&
+													(kURL_TypeFile == matches[0].type));
+	result &= Console_Assert("home pathname", (2 == matches.size()) && (20 == matches[1].offset) && (9 == matches[1].length) &&
+												(kURL_TypeFile == matches[1].type));
+	
+	result &= Console_Assert("no comment or relative pathnames", unitTest_FindMatches("// comment ./rel ../up and/or xyz://host/x").empty());
+	
+	return result;
+}// unitTest_Matches_000
+
+
+/*!
+Tests URL_AddPattern(), finding user-defined patterns and
+converting matched text into URLs.  The original patterns
+are restored afterwards.
+
+Returns "true" if ALL assertions pass; "false" is
+returned if any fail, however messages should be
+printed for ALL assertion failures regardless.
+
+(2017.10)
+*/
+Boolean
+unitTest_Patterns_000 ()
+{
+	My_PrefixAutomaton&		automaton = gPrefixAutomaton();
+	My_PatternList const	kOriginalPatterns = automaton.patterns;
+	URL_MatchList			matches;
+	Boolean					result = true;
+	
+	
+	result &= Console_Assert("pattern with non-ASCII prefix rejected",
+								false == URL_AddPattern(CFSTR("\u00E9-"), kURL_PatternTailDigits, CFSTR("x:%@")));
+	result &= Console_Assert("pattern with no template marker rejected",
+								false == URL_AddPattern(CFSTR("BUG-"), kURL_PatternTailDigits, CFSTR("https://bugs.example.com/")));
+	result &= Console_Assert("pattern added",
+								URL_AddPattern(CFSTR("BUG-"), kURL_PatternTailDigits, CFSTR("https://bugs.example.com/?id=%@")));
+	
+	matches = unitTest_FindMatches("fix bug-42, not bug-x");
+	result &= Console_Assert("user pattern found", (1 == matches.size()) && (4 == matches[0].offset) && (6 == matches[0].length) &&
+													(kURL_TypeInvalid == matches[0].type));
+	
+	{
+		CFRetainRelease		patternURL(copyPatternURL(CFSTR("bug-42")), CFRetainRelease::kAlreadyRetained);
+		
+		
+		result &= Console_Assert("user pattern URL", patternURL.exists() &&
+														(kCFCompareEqualTo == CFStringCompare(patternURL.returnCFStringRef(),
+																								CFSTR("https://bugs.example.com/?id=bug-42"), 0)));
+	}
+	{
+		CFRetainRelease		patternURL(copyPatternURL(CFSTR("www.example.com")), CFRetainRelease::kAlreadyRetained);
+		
+		
+		result &= Console_Assert("host name URL", patternURL.exists() &&
+													(kCFCompareEqualTo == CFStringCompare(patternURL.returnCFStringRef(),
+																							CFSTR("http://www.example.com"), 0)));
+	}
+	{
+		CFRetainRelease		patternURL(copyPatternURL(CFSTR("/tmp/x")), CFRetainRelease::kAlreadyRetained);
+		
+		
+		result &= Console_Assert("pathname URL", patternURL.exists() &&
+													(kCFCompareEqualTo == CFStringCompare(patternURL.returnCFStringRef(),
+																							CFSTR("file:///tmp/x"), 0)));
+	}
+	{
+		CFRetainRelease		patternURL(copyPatternURL(CFSTR("not a URL")), CFRetainRelease::kAlreadyRetained);
+		
+		
+		result &= Console_Assert("no URL for other text", false == patternURL.exists());
+	}
+	
+	automaton.patterns = kOriginalPatterns;
+	automaton.isCompiled = false;
+	
+	return result;
+}// unitTest_Patterns_000
+
+
+/*!
+Tests the rule for each kind of text that can follow a
+prefix, including the trimming of trailing punctuation.
+
+Returns "true" if ALL assertions pass; "false" is
+returned if any fail, however messages should be
+printed for ALL assertion failures regardless.
+
+(2017.10)
+*/
+Boolean
+unitTest_Tails_000 ()
+{
+	auto		scanLength = [](char const* inText, URL_PatternTail inTail) -> size_t
+						{
+							std::vector< UniChar >	buffer(inText, inText + std::strlen(inText));
+							UniChar const*			bufferStart = buffer.data();
+							
+							
+							return STATIC_CAST(scanPatternTail(bufferStart, bufferStart + buffer.size(), inTail) - bufferStart, size_t);
+						};
+	Boolean		result = true;
+	
+	
+	result &= Console_Assert("digits tail", 3 == scanLength("123abc", kURL_PatternTailDigits));
+	result &= Console_Assert("empty digits tail", 0 == scanLength("abc", kURL_PatternTailDigits));
+	result &= Console_Assert("name tail, trailing period and hyphen", 9 == scanLength("host.name.- x", kURL_PatternTailName));
+	result &= Console_Assert("URL tail, trailing punctuation", 3 == scanLength("a.b?!'", kURL_PatternTailURL));
+	result &= Console_Assert("URL tail, query kept", 7 == scanLength("a?b=c&d.", kURL_PatternTailURL));
+	result &= Console_Assert("URL tail, unbalanced parenthesis", 4 == scanLength("a(b))", kURL_PatternTailURL));
+	result &= Console_Assert("URL tail, disallowed character", 2 == scanLength("ab<c>", kURL_PatternTailURL));
+	result &= Console_Assert("path tail", 5 == scanLength("usr/x y", kURL_PatternTailPath));
+	result &= Console_Assert("path tail, no second slash", 0 == scanLength("/x", kURL_PatternTailPath));
+	
+	return result;
+}// unitTest_Tails_000
+
+} // anonymous namespace
+
 // BELOW IS REQUIRED NEWLINE TO END FILE
@@ -41,6 +41,9 @@
 
 #pragma once
 
+// standard-C++ includes
+#include <vector>
+
 // application includes
 #include "TerminalScreenRef.typedef.h"
 #include "TerminalViewRef.typedef.h"
@@ -83,10 +86,48 @@ enum URL_Type
 	kURL_TypeXManPage
 };
 
+/*!
+Determines which characters may follow the prefix of a pattern
+given to URL_AddPattern().
+*/
+enum URL_PatternTail
+{
+	kURL_PatternTailURL		= 0,	//!< any characters that are valid in a URL (trailing punctuation is excluded)
+	kURL_PatternTailDigits	= 1,	//!< decimal digits only (e.g. a ticket number)
+	kURL_PatternTailName	= 2,	//!< letters, digits, periods, hyphens and underscores (e.g. a host name)
+	kURL_PatternTailPath	= 3		//!< like "kURL_PatternTailURL" but the first character cannot be a slash
+									//!  (e.g. the rest of a Unix pathname)
+};
+
+
+
+#pragma mark Types
+
+/*!
+Describes text that was found by URL_FindMatchesInCharacterRange().
+*/
+struct URL_Match
+{
+	UInt16		offset;		//!< zero-based index of the first character of the match
+	UInt16		length;		//!< number of characters in the match
+	URL_Type	type;		//!< kind of URL; "kURL_TypeInvalid" for a user-defined pattern
+};
+typedef std::vector< URL_Match >	URL_MatchList;
+
 
 
 #pragma mark Public Methods
 
+Boolean
+	URL_AddPattern						(CFStringRef					inPrefix,
+										 URL_PatternTail				inTail,
+										 CFStringRef					inURLTemplate);
+
+void
+	URL_FindMatchesInCharacterRange		(UniChar const*					inBegin,
+										 UniChar const*					inPastEnd,
+										 URL_MatchList&					outMatches);
+
 void
 	URL_HandleForScreenView				(TerminalScreenRef				inScreen,
 										 TerminalViewRef				inView);
@@ -104,4 +145,7 @@ URL_Type
 	URL_ReturnTypeFromCharacterRange	(char const*					inBegin,
 										 char const*					inPastEnd);
 
+void
+	URL_RunTests						();
+
 // BELOW IS REQUIRED NEWLINE TO END FILE
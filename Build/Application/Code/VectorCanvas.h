@@ -42,6 +42,7 @@
 #else
 class NSView;
 #endif
+#include <CoreGraphics/CoreGraphics.h>
 
 // library includes
 #include <ResultCode.template.h>
@@ -157,12 +158,21 @@ VectorCanvas_Result
 										 VectorCanvas_PathPurpose	inPurpose,
 										 VectorCanvas_PathTarget	inTarget = kVectorCanvas_PathTargetPrimary);
 
+void
+	VectorCanvas_InvalidateNewDrawing	(VectorCanvas_Ref		inRef);
+
 void
 	VectorCanvas_InvalidateView			(VectorCanvas_Ref		inRef);
 
 SInt16
 	VectorCanvas_MonitorMouse			(VectorCanvas_Ref		inRef);
 
+VectorCanvas_Result
+	VectorCanvas_RenderInContext		(VectorCanvas_Ref		inRef,
+										 CGContextRef			inContext,
+										 CGRect					inBounds,
+										 Boolean				inIsPrinting = false);
+
 VectorInterpreter_Ref
 	VectorCanvas_ReturnInterpreter		(VectorCanvas_Ref		inRef);
 
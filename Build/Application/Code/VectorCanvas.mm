@@ -42,6 +42,7 @@
 
 // Mac includes
 #import <Cocoa/Cocoa.h>
+#import <simd/simd.h>
 
 // library includes
 #import <CocoaFuture.objc++.h>
@@ -67,6 +68,7 @@ UInt16 const	kMy_MaximumX = 4095;
 UInt16 const	kMy_MaximumY = 3139;	// TEMPORARY - figure out where the hell this value comes from
 Float32 const	kMy_DefaultStrokeWidth = 0.5;
 Float32 const	kMy_DefaultTextStrokeWidth = 0.25;
+Float32 const	kMy_InvalidationMargin = 10.0;	// extra area redrawn around new lines, for line width and shadows
 
 enum
 {
@@ -95,13 +97,21 @@ vector graphic.  A path itself only holds geometric
 data (points), so if a drawing is multi-colored or
 has lines of different widths it must consist of an
 array of elements of this type.
+
+Stroked elements keep their line segments in flat arrays
+of end points, in the coordinates given to the canvas by
+the interpreter; these are transformed in batches as
+needed (see updateDeviceSegmentPoints()) and are drawn
+all at once.  Filled elements use a Core Graphics path.
 */
 @interface VectorCanvas_Path : NSObject //{
 {
 @public
 	VectorCanvas_PathPurpose	purpose;
-	NSBezierPath*				bezierPath;
-	Float32						normalLineWidth;
+	std::vector< CGPoint >		segmentPoints;			// pairs of end points in interpreter coordinates
+	std::vector< CGPoint >		deviceSegmentPoints;	// "segmentPoints" in canvas coordinates (filled in lazily)
+	CGMutablePathRef			fillPath;				// only defined for filled elements
+	Float32						lineWidth;
 	CGPathDrawingMode			drawingMode;
 	SInt16						fillColorIndex;
 	SInt16						strokeColorIndex;
@@ -147,7 +157,12 @@ struct My_VectorCanvas
 	SInt16					height;
 	VectorCanvas_View*		canvasView;
 	NSMutableArray*			drawingPathElements;
-	NSBezierPath*			scrapPath;
+	CGMutablePathRef		scrapPath;
+	Boolean					hasNewDrawing;	// if true, the "newDrawing..." fields define an area not yet redrawn
+	SInt16					newDrawingLeft;
+	SInt16					newDrawingBottom;
+	SInt16					newDrawingRight;
+	SInt16					newDrawingTop;
 };
 typedef My_VectorCanvas*		My_VectorCanvasPtr;
 typedef My_VectorCanvas const*	My_VectorCanvasConstPtr;
@@ -161,12 +176,14 @@ typedef MemoryBlockReferenceLocker< VectorCanvas_Ref, My_VectorCanvas >		My_Vect
 #pragma mark Internal Method Prototypes
 namespace {
 
-UInt16				copyColorPreferences	(My_VectorCanvasPtr, Preferences_ContextRef, Boolean = true);
-void				getPaletteColor			(My_VectorCanvasPtr, SInt16, CGDeviceColor&);
-void				handleMouseDown			(My_VectorCanvasPtr, Point);
-Boolean				inSplash				(Point, Point);
-VectorCanvas_Path*	pathElementWithPurpose	(My_VectorCanvasPtr, VectorCanvas_PathPurpose, Boolean = false);
-void				setPaletteColor			(My_VectorCanvasPtr, SInt16, CGDeviceColor const&);
+UInt16				copyColorPreferences		(My_VectorCanvasPtr, Preferences_ContextRef, Boolean = true);
+void				getPaletteColor				(My_VectorCanvasPtr, SInt16, CGDeviceColor&);
+void				handleMouseDown				(My_VectorCanvasPtr, Point);
+Boolean				inSplash					(Point, Point);
+VectorCanvas_Path*	pathElementWithPurpose		(My_VectorCanvasPtr, VectorCanvas_PathPurpose, Boolean = false);
+void				renderDrawing				(My_VectorCanvasPtr, CGContextRef, CGRect, Boolean);
+void				setPaletteColor				(My_VectorCanvasPtr, SInt16, CGDeviceColor const&);
+void				updateDeviceSegmentPoints	(My_VectorCanvasPtr, VectorCanvas_Path*);
 
 } // anonymous namespace
 
@@ -218,7 +235,12 @@ VectorCanvas_New	(VectorInterpreter_Ref	inData)
 	// contents of the entire drawing to be rendered and the “scrap
 	// path“ represents something used temporarily by drawing commands
 	ptr->drawingPathElements = [[NSMutableArray alloc] initWithCapacity:10/* arbitrary; expands as needed */];
-	ptr->scrapPath = [[NSBezierPath bezierPath] retain];
+	ptr->scrapPath = CGPathCreateMutable();
+	ptr->hasNewDrawing = false;
+	ptr->newDrawingLeft = 0;
+	ptr->newDrawingBottom = 0;
+	ptr->newDrawingRight = 0;
+	ptr->newDrawingTop = 0;
 	
 	ptr->canvasView = nil;
 	
@@ -285,7 +307,7 @@ VectorCanvas_Release	(VectorCanvas_Ref*		inoutRefPtr)
 			
 			[ptr->canvasView release], ptr->canvasView = nil;
 			[ptr->drawingPathElements release], ptr->drawingPathElements = nil;
-			[ptr->scrapPath release], ptr->scrapPath = nil;
+			CGPathRelease(ptr->scrapPath), ptr->scrapPath = nullptr;
 		}
 		delete *(REINTERPRET_CAST(inoutRefPtr, My_VectorCanvasPtr*)), *inoutRefPtr = nullptr;
 	}
@@ -318,7 +340,8 @@ VectorCanvas_ClearCaches	(VectorCanvas_Ref	inRef)
 	
 	
 	[ptr->drawingPathElements removeAllObjects];
-	[ptr->scrapPath removeAllPoints];
+	CGPathRelease(ptr->scrapPath), ptr->scrapPath = CGPathCreateMutable();
+	ptr->hasNewDrawing = false;
 	[ptr->canvasView setNeedsDisplay:YES];
 }// ClearCaches
 
@@ -363,19 +386,33 @@ VectorCanvas_DrawLine	(VectorCanvas_Ref			inRef,
 	
 	if (nullptr != ptr)
 	{
-		Float32		x0 = (STATIC_CAST(inStartX, SInt32) * ptr->width) / kVectorInterpreter_MaxX;
-		Float32		y0 = STATIC_CAST(ptr->height, SInt32) -
-							((STATIC_CAST(inStartY, SInt32) * ptr->height) / kVectorInterpreter_MaxY);
-		Float32		x1 = (STATIC_CAST(inEndX, SInt32) * ptr->width) / kVectorInterpreter_MaxX;
-		Float32		y1 = STATIC_CAST(ptr->height, SInt32) -
-							((STATIC_CAST(inEndY, SInt32) * ptr->height) / kVectorInterpreter_MaxY);
-		Boolean		isSinglePoint = ((x0 == x1) && (y0 == y1));
+		Boolean		isSinglePoint = ((inStartX == inEndX) && (inStartY == inEndY));
 		
 		
+		// extend the area that VectorCanvas_InvalidateNewDrawing() will redraw
+		if (false == ptr->hasNewDrawing)
+		{
+			ptr->newDrawingLeft = ptr->newDrawingRight = inStartX;
+			ptr->newDrawingBottom = ptr->newDrawingTop = inStartY;
+			ptr->hasNewDrawing = true;
+		}
+		ptr->newDrawingLeft = std::min(ptr->newDrawingLeft, std::min(inStartX, inEndX));
+		ptr->newDrawingRight = std::max(ptr->newDrawingRight, std::max(inStartX, inEndX));
+		ptr->newDrawingBottom = std::min(ptr->newDrawingBottom, std::min(inStartY, inEndY));
+		ptr->newDrawingTop = std::max(ptr->newDrawingTop, std::max(inStartY, inEndY));
+		
 		if (kVectorCanvas_PathTargetScrap == inTarget)
 		{
 			// line is being added to a temporary scrap path, not the main drawing
-			assert(nil != ptr->scrapPath);
+			CGFloat const	kScaleX = STATIC_CAST(ptr->width, CGFloat) / kVectorInterpreter_MaxX;
+			CGFloat const	kScaleY = STATIC_CAST(ptr->height, CGFloat) / kVectorInterpreter_MaxY;
+			CGFloat			x0 = inStartX * kScaleX;
+			CGFloat			y0 = ptr->height - (inStartY * kScaleY);
+			CGFloat			x1 = inEndX * kScaleX;
+			CGFloat			y1 = ptr->height - (inEndY * kScaleY);
+			
+			
+			assert(nullptr != ptr->scrapPath);
 			
 			// normally lone points are drawn with special line caps, but with a
 			// single path there is currently no real solution except to force the
@@ -386,29 +423,27 @@ VectorCanvas_DrawLine	(VectorCanvas_Ref			inRef,
 				y1 += 0.1;
 			}
 			
-			[ptr->scrapPath moveToPoint:NSMakePoint(x0, y0)];
-			[ptr->scrapPath lineToPoint:NSMakePoint(x1, y1)];
+			CGPathMoveToPoint(ptr->scrapPath, nullptr/* transform */, x0, y0);
+			CGPathAddLineToPoint(ptr->scrapPath, nullptr/* transform */, x1, y1);
 		}
 		else
 		{
-			// line is being added to the main drawing
+			// line is being added to the main drawing; the coordinates
+			// are only transformed when the drawing is next rendered
 			VectorCanvas_Path*	currentElement = pathElementWithPurpose(ptr, inPurpose, isSinglePoint/* force create */);
 			
 			
-			// lone points are invisible unless the line cap is specifically set
-			// to make them visible
+			currentElement->segmentPoints.push_back(CGPointMake(inStartX, inStartY));
+			currentElement->segmentPoints.push_back(CGPointMake(inEndX, inEndY));
+			
+			// lone points are only visible because of round line caps;
+			// force the next drawing element to have a separate path
+			// (cannot afford to have the single point made invisible
+			// by future changes to the line width)
 			if (isSinglePoint)
 			{
-				[currentElement->bezierPath setLineCapStyle:NSRoundLineCapStyle];
-				
-				// force the next drawing element to have a separate path
-				// (cannot afford to have the single point made invisible
-				// by future changes to the line width)
 				UNUSED_RETURN(VectorCanvas_Path*)pathElementWithPurpose(ptr, inPurpose, true/* force create */);
 			}
-			
-			[currentElement->bezierPath moveToPoint:NSMakePoint(x0, y0)];
-			[currentElement->bezierPath lineToPoint:NSMakePoint(x1, y1)];
 		}
 		result = kVectorCanvas_ResultOK;
 	}
@@ -417,6 +452,47 @@ VectorCanvas_DrawLine	(VectorCanvas_Ref			inRef,
 }// DrawLine
 
 
+/*!
+Marks only the part of the canvas view that contains lines
+drawn since the previous call (or since the view was last
+invalidated completely), which will trigger a redraw of that
+area at the next opportunity.  Does nothing if there has been
+no new drawing.
+
+This should be used when data arrives incrementally, so that
+streaming graphics do not repeatedly redraw the whole view.
+
+(2017.10)
+*/
+void
+VectorCanvas_InvalidateNewDrawing	(VectorCanvas_Ref	inRef)
+{
+	My_VectorCanvasAutoLocker	ptr(gVectorCanvasPtrLocks(), inRef);
+	
+	
+	if ((nullptr != ptr) && (ptr->hasNewDrawing))
+	{
+		if ((nil != ptr->canvasView) && (ptr->width > 0))
+		{
+			NSRect			viewBounds = [ptr->canvasView bounds];
+			CGFloat const	kScaleX = (viewBounds.size.width / kVectorInterpreter_MaxX);
+			CGFloat const	kScaleY = (viewBounds.size.height / kVectorInterpreter_MaxY);
+			CGFloat const	kMargin = (kMy_InvalidationMargin * viewBounds.size.width / ptr->width);
+			NSRect			dirtyRect = NSMakeRect(ptr->newDrawingLeft * kScaleX,
+													// the view is flipped but canvas coordinates
+													// have a bottom-left origin
+													viewBounds.size.height - (ptr->newDrawingTop * kScaleY),
+													(ptr->newDrawingRight - ptr->newDrawingLeft) * kScaleX,
+													(ptr->newDrawingTop - ptr->newDrawingBottom) * kScaleY);
+			
+			
+			[ptr->canvasView setNeedsDisplayInRect:NSInsetRect(dirtyRect, -kMargin, -kMargin)];
+		}
+		ptr->hasNewDrawing = false;
+	}
+}// InvalidateNewDrawing
+
+
 /*!
 Marks the canvas view as invalid, which will trigger a redraw
 at the next opportunity.
@@ -429,6 +505,7 @@ VectorCanvas_InvalidateView		(VectorCanvas_Ref	inRef)
 	My_VectorCanvasAutoLocker	ptr(gVectorCanvasPtrLocks(), inRef);
 	
 	
+	ptr->hasNewDrawing = false;
 	[ptr->canvasView setNeedsDisplay:YES];
 }// InvalidateView
 
@@ -453,6 +530,47 @@ VectorCanvas_MonitorMouse	(VectorCanvas_Ref	inRef)
 }// MonitorMouse
 
 
+/*!
+Draws the entire picture into the given graphics context,
+scaled to fill the specified bounds.  This does not require
+a view; for instance, a bitmap context created with
+CGBitmapContextCreate() can be used to rasterize a drawing
+offscreen (such as for automated tests or image export).
+
+\retval kVectorCanvas_ResultOK
+if there are no errors
+
+\retval kVectorCanvas_ResultInvalidReference
+if the specified canvas is unrecognized
+
+\retval kVectorCanvas_ResultParameterError
+if the context is invalid
+
+(2017.10)
+*/
+VectorCanvas_Result
+VectorCanvas_RenderInContext	(VectorCanvas_Ref	inRef,
+								 CGContextRef		inContext,
+								 CGRect				inBounds,
+								 Boolean			inIsPrinting)
+{
+	My_VectorCanvasAutoLocker	ptr(gVectorCanvasPtrLocks(), inRef);
+	VectorCanvas_Result			result = kVectorCanvas_ResultInvalidReference;
+	
+	
+	if (nullptr == inContext)
+	{
+		result = kVectorCanvas_ResultParameterError;
+	}
+	else if (nullptr != ptr)
+	{
+		renderDrawing(ptr, inContext, inBounds, inIsPrinting);
+		result = kVectorCanvas_ResultOK;
+	}
+	return result;
+}// RenderInContext
+
+
 /*!
 Returns the intepreter whose commands affect this canvas.
 
@@ -528,14 +646,14 @@ VectorCanvas_ScrapPathFill	(VectorCanvas_Ref	inRef,
 		// draw the path that has accumulated so far in the temporary space
 		{
 			assert(nil != ptr->drawingPathElements);
-			assert(nil != ptr->scrapPath);
+			assert(nullptr != ptr->scrapPath);
 			VectorCanvas_Path*	elementData = [[VectorCanvas_Path alloc] init];
 			
 			
-			[elementData->bezierPath appendBezierPath:ptr->scrapPath];
+			elementData->fillPath = CGPathCreateMutableCopy(ptr->scrapPath);
 			if (inFrameWidthOrZero > 0.001/* arbitrary */)
 			{
-				[elementData->bezierPath setLineWidth:(inFrameWidthOrZero * elementData->normalLineWidth)];
+				elementData->lineWidth *= inFrameWidthOrZero;
 			}
 			elementData->drawingMode = kCGPathFill;
 			elementData->fillColorIndex = inFillColor;
@@ -579,8 +697,7 @@ VectorCanvas_ScrapPathReset		(VectorCanvas_Ref	inRef)
 		// assumed to be taking place at this time, so simply
 		// ensure that the scrap path target is empty and do
 		// not begin a path in any particular drawing context
-		assert(nil != ptr->scrapPath);
-		[ptr->scrapPath removeAllPoints];
+		CGPathRelease(ptr->scrapPath), ptr->scrapPath = CGPathCreateMutable();
 		result = kVectorCanvas_ResultOK;
 	}
 	return result;
@@ -1038,6 +1155,139 @@ pathElementWithPurpose	(My_VectorCanvasPtr			inPtr,
 }// pathElementWithPurpose
 
 
+/*!
+Renders the entire vector drawing in the given graphics
+context, scaled to fill the specified rectangle.  The output
+varies slightly if this is for a print-out.
+
+Line segments are transformed in batches (only segments added
+since the previous rendering are transformed) and each path
+element is submitted to Core Graphics in a single call.
+
+(2017.10)
+*/
+void
+renderDrawing	(My_VectorCanvasPtr		inPtr,
+				 CGContextRef			inDrawingContext,
+				 CGRect					inContentBounds,
+				 Boolean				inIsPrinting)
+{
+	// draw the background (unless this is for printing)
+	unless (inIsPrinting)
+	{
+		SInt16			backgroundColorIndex = VectorInterpreter_ReturnBackgroundColor(inPtr->interpreter);
+		CGDeviceColor	backgroundColor;
+		
+		
+		assert((backgroundColorIndex >= 0) && (backgroundColorIndex < kMy_MaxColors));
+		getPaletteColor(inPtr, backgroundColorIndex, backgroundColor);
+		CGContextSetRGBFillColor(inDrawingContext, backgroundColor.red, backgroundColor.green,
+									backgroundColor.blue, 1.0/* alpha */);
+		CGContextFillRect(inDrawingContext, inContentBounds);
+	}
+	
+	// draw the vector graphics; this is achieved by iterating over
+	// stored drawing commands and replicating them
+	if (nil != inPtr->drawingPathElements)
+	{
+		CGDeviceColor	scratchColor;
+		SInt16			currentFillColorIndex = 0;
+		SInt16			currentStrokeColorIndex = 0;
+		
+		
+		CGContextSaveGState(inDrawingContext);
+		
+		// scale the entire drawing to fill the view
+		if ((inPtr->width > 0) && (inPtr->height > 0))
+		{
+			CGContextScaleCTM(inDrawingContext, inContentBounds.size.width / inPtr->width,
+								inContentBounds.size.height / inPtr->height);
+		}
+		
+		// initialize state
+		unless (inIsPrinting)
+		{
+			CGContextSetShadow(inDrawingContext, CGSizeMake(2.2f, -2.2f)/* offset; arbitrary */, 6.0f/* blur; arbitrary */);
+		}
+		CGContextSetLineCap(inDrawingContext, kCGLineCapRound);
+		CGContextSetLineJoin(inDrawingContext, kCGLineJoinBevel);
+		
+		// render each piece of the drawing; for a drawing that always uses the
+		// same colors and line sizes, etc. this loop will only iterate once
+		for (VectorCanvas_Path* pathElement in inPtr->drawingPathElements)
+		{
+			// update graphics context state if it should change
+			if (pathElement->fillColorIndex != currentFillColorIndex)
+			{
+				assert((pathElement->fillColorIndex >= 0) && (pathElement->fillColorIndex < kMy_MaxColors));
+				if ((inIsPrinting) && (kMy_ColorIndexBackground == pathElement->fillColorIndex))
+				{
+					// when printing, do not allow the background color to print
+					// (because it might be reformatted, e.g. white-on-black);
+					// instead, force the background to be white
+					CGContextSetRGBFillColor(inDrawingContext, 1.0, 1.0, 1.0, 1.0/* alpha */);
+				}
+				else
+				{
+					getPaletteColor(inPtr, pathElement->fillColorIndex, scratchColor);
+					CGContextSetRGBFillColor(inDrawingContext, scratchColor.red, scratchColor.green,
+												scratchColor.blue, 1.0/* alpha */);
+				}
+				currentFillColorIndex = pathElement->fillColorIndex;
+			}
+			if (pathElement->strokeColorIndex != currentStrokeColorIndex)
+			{
+				assert((pathElement->strokeColorIndex >= 0) && (pathElement->strokeColorIndex < kMy_MaxColors));
+				if ((inIsPrinting) && (kMy_ColorIndexForeground == pathElement->strokeColorIndex))
+				{
+					// when printing, do not allow the foreground color to print
+					// (because it might be reformatted, e.g. white-on-black);
+					// instead, force the foreground to be black
+					CGContextSetRGBStrokeColor(inDrawingContext, 0.0, 0.0, 0.0, 1.0/* alpha */);
+				}
+				else
+				{
+					getPaletteColor(inPtr, pathElement->strokeColorIndex, scratchColor);
+					CGContextSetRGBStrokeColor(inDrawingContext, scratchColor.red, scratchColor.green,
+												scratchColor.blue, 1.0/* alpha */);
+				}
+				currentStrokeColorIndex = pathElement->strokeColorIndex;
+			}
+			
+			// make lines thicker when the drawing is bigger, up to a certain maximum thickness
+			CGContextSetLineWidth(inDrawingContext,
+									std::max(std::min((inContentBounds.size.width / inPtr->width) * pathElement->lineWidth,
+														pathElement->lineWidth * 2/* arbitrary maximum */),
+												pathElement->lineWidth / 3 * 2/* arbitrary minimum */));
+			
+			// add the new sub-path
+			switch (pathElement->drawingMode)
+			{
+			case kCGPathFill:
+				if (nullptr != pathElement->fillPath)
+				{
+					CGContextAddPath(inDrawingContext, pathElement->fillPath);
+					CGContextFillPath(inDrawingContext);
+				}
+				break;
+			
+			case kCGPathStroke:
+			default:
+				updateDeviceSegmentPoints(inPtr, pathElement);
+				if (false == pathElement->deviceSegmentPoints.empty())
+				{
+					CGContextStrokeLineSegments(inDrawingContext, pathElement->deviceSegmentPoints.data(),
+												pathElement->deviceSegmentPoints.size());
+				}
+				break;
+			}
+		}
+		
+		CGContextRestoreGState(inDrawingContext);
+	}
+}// renderDrawing
+
+
 /*!
 Changes the RGB color for the specified TEK color index.
 
@@ -1051,6 +1301,49 @@ setPaletteColor		(My_VectorCanvasPtr		inPtr,
 	inPtr->deviceColors[inZeroBasedIndex] = inColor;
 }// setPaletteColor
 
+
+/*!
+Transforms any line segments that have been added to the given
+path element since it was last rendered, from the coordinates
+of the interpreter into the coordinates of the canvas.  Since
+points are only appended, earlier results are reused.
+
+The transformation is a single scale-and-offset so it is done
+with SIMD vector operations on each point.
+
+(2017.10)
+*/
+void
+updateDeviceSegmentPoints	(My_VectorCanvasPtr		inPtr,
+							 VectorCanvas_Path*		inoutElement)
+{
+	size_t const	kPointCount = inoutElement->segmentPoints.size();
+	size_t const	kFirstNewPoint = inoutElement->deviceSegmentPoints.size();
+	
+	
+	if (kFirstNewPoint < kPointCount)
+	{
+		vector_double2 const	kScale = { STATIC_CAST(inPtr->width, double) / kVectorInterpreter_MaxX,
+											-STATIC_CAST(inPtr->height, double) / kVectorInterpreter_MaxY };
+		vector_double2 const	kOffset = { 0.0, STATIC_CAST(inPtr->height, double) };
+		CGPoint const*			sourcePtr = inoutElement->segmentPoints.data() + kFirstNewPoint;
+		CGPoint*				destPtr = nullptr;
+		
+		
+		inoutElement->deviceSegmentPoints.resize(kPointCount);
+		destPtr = inoutElement->deviceSegmentPoints.data() + kFirstNewPoint;
+		for (size_t i = kFirstNewPoint; i < kPointCount; ++i, ++sourcePtr, ++destPtr)
+		{
+			vector_double2		devicePoint = { sourcePtr->x, sourcePtr->y };
+			
+			
+			devicePoint = devicePoint * kScale + kOffset;
+			destPtr->x = devicePoint.x;
+			destPtr->y = devicePoint.y;
+		}
+	}
+}// updateDeviceSegmentPoints
+
 } // anonymous namespace
 
 
@@ -1087,10 +1380,7 @@ initWithPurpose:(VectorCanvas_PathPurpose)	aPurpose
 	if (nil != self)
 	{
 		[self setPurpose:aPurpose]; // sets purpose and line width
-		self->bezierPath = [[NSBezierPath bezierPath] copy];
-		[self->bezierPath setLineWidth:self->normalLineWidth];
-		[self->bezierPath setLineCapStyle:NSRoundLineCapStyle];
-		[self->bezierPath setLineJoinStyle:NSBevelLineJoinStyle];
+		self->fillPath = nullptr;
 		self->drawingMode = kCGPathStroke;
 		self->fillColorIndex = 0;
 		self->strokeColorIndex = 0;
@@ -1107,7 +1397,10 @@ Destructor.
 - (void)
 dealloc
 {
-	[bezierPath release];
+	if (nullptr != fillPath)
+	{
+		CGPathRelease(fillPath), fillPath = nullptr;
+	}
 	[super dealloc];
 }// dealloc
 
@@ -1125,7 +1418,7 @@ setPurpose:(VectorCanvas_PathPurpose)	aPurpose
 {
 	// the line width is directly dependent on the purpose of the path
 	self->purpose = aPurpose;
-	self->normalLineWidth = ((kVectorCanvas_PathPurposeText == aPurpose) ? kMy_DefaultTextStrokeWidth : kMy_DefaultStrokeWidth);
+	self->lineWidth = ((kVectorCanvas_PathPurposeText == aPurpose) ? kMy_DefaultTextStrokeWidth : kMy_DefaultStrokeWidth);
 }// setPurpose:
 
 
@@ -1146,8 +1439,7 @@ copyWithEmptyPathAndPurpose:(VectorCanvas_PathPurpose)	aPurpose
 	if (nil != result)
 	{
 		result->purpose = purpose;
-		result->normalLineWidth = normalLineWidth;
-		result->bezierPath = [[NSBezierPath bezierPath] copy];
+		result->lineWidth = lineWidth;
 		result->drawingMode = drawingMode;
 		result->fillColorIndex = fillColorIndex;
 		result->strokeColorIndex = strokeColorIndex;
@@ -1561,109 +1853,12 @@ renderDrawingInCurrentFocusWithRect:(NSRect)	aRect
 	if (nullptr != canvasPtr)
 	{
 		NSGraphicsContext*	contextMgr = [NSGraphicsContext currentContext];
-		NSPrintOperation*	printOp = [NSPrintOperation currentOperation];
 		CGContextRef		drawingContext = REINTERPRET_CAST([contextMgr graphicsPort], CGContextRef);
 		CGRect				contentBounds = CGRectMake(aRect.origin.x, aRect.origin.y, aRect.size.width, aRect.size.height);
-		BOOL				isPrinting = (nil != printOp);
+		BOOL				isPrinting = (nil != [NSPrintOperation currentOperation]);
 		
 		
-		// draw the background (unless this is for printing)
-		unless (isPrinting)
-		{
-			SInt16			backgroundColorIndex = VectorInterpreter_ReturnBackgroundColor(canvasPtr->interpreter);
-			CGDeviceColor	backgroundColor;
-			
-			
-			assert((backgroundColorIndex >= 0) && (backgroundColorIndex < kMy_MaxColors));
-			getPaletteColor(canvasPtr, backgroundColorIndex, backgroundColor);
-			CGContextSetRGBFillColor(drawingContext, backgroundColor.red, backgroundColor.green,
-										backgroundColor.blue, 1.0/* alpha */);
-			CGContextFillRect(drawingContext, contentBounds);
-		}
-		
-		// draw the vector graphics; this is achieved by iterating over
-		// stored drawing commands and replicating them
-		if (nil != canvasPtr->drawingPathElements)
-		{
-			CGDeviceColor	scratchColor;
-			SInt16			currentFillColorIndex = 0;
-			SInt16			currentStrokeColorIndex = 0;
-			
-			
-			// scale the entire drawing to fill the view
-			if ((canvasPtr->width > 0) && (canvasPtr->height > 0))
-			{
-				CGContextScaleCTM(drawingContext, contentBounds.size.width / canvasPtr->width,
-									contentBounds.size.height / canvasPtr->height);
-			}
-			
-			// initialize state
-			unless (isPrinting)
-			{
-				CGContextSetShadow(drawingContext, CGSizeMake(2.2f, -2.2f)/* offset; arbitrary */, 6.0f/* blur; arbitrary */);
-			}
-			
-			// render each piece of the drawing; for a drawing that always uses the
-			// same colors and line sizes, etc. this loop will only iterate once
-			for (VectorCanvas_Path* pathElement in canvasPtr->drawingPathElements)
-			{
-				// update graphics context state if it should change
-				if (pathElement->fillColorIndex != currentFillColorIndex)
-				{
-					assert((pathElement->fillColorIndex >= 0) && (pathElement->fillColorIndex < kMy_MaxColors));
-					if ((nil != printOp) && (kMy_ColorIndexBackground == pathElement->fillColorIndex))
-					{
-						// when printing, do not allow the background color to print
-						// (because it might be reformatted, e.g. white-on-black);
-						// instead, force the background to be white
-						CGContextSetRGBFillColor(drawingContext, 1.0, 1.0, 1.0, 1.0/* alpha */);
-					}
-					else
-					{
-						getPaletteColor(canvasPtr, pathElement->fillColorIndex, scratchColor);
-						CGContextSetRGBFillColor(drawingContext, scratchColor.red, scratchColor.green,
-													scratchColor.blue, 1.0/* alpha */);
-					}
-					currentFillColorIndex = pathElement->fillColorIndex;
-				}
-				if (pathElement->strokeColorIndex != currentStrokeColorIndex)
-				{
-					assert((pathElement->strokeColorIndex >= 0) && (pathElement->strokeColorIndex < kMy_MaxColors));
-					if ((nil != printOp) && (kMy_ColorIndexForeground == pathElement->strokeColorIndex))
-					{
-						// when printing, do not allow the foreground color to print
-						// (because it might be reformatted, e.g. white-on-black);
-						// instead, force the foreground to be black
-						CGContextSetRGBStrokeColor(drawingContext, 0.0, 0.0, 0.0, 1.0/* alpha */);
-					}
-					else
-					{
-						getPaletteColor(canvasPtr, pathElement->strokeColorIndex, scratchColor);
-						CGContextSetRGBStrokeColor(drawingContext, scratchColor.red, scratchColor.green,
-													scratchColor.blue, 1.0/* alpha */);
-					}
-					currentStrokeColorIndex = pathElement->strokeColorIndex;
-				}
-				
-				// make lines thicker when the drawing is bigger, up to a certain maximum thickness
-				[pathElement->bezierPath setLineWidth:std::max(std::min((contentBounds.size.width / canvasPtr->width) * pathElement->normalLineWidth,
-																		pathElement->normalLineWidth * 2/* arbitrary maximum */),
-																pathElement->normalLineWidth / 3 * 2/* arbitrary minimum */)];
-				
-				// add the new sub-path
-				switch (pathElement->drawingMode)
-				{
-				case kCGPathFill:
-					[pathElement->bezierPath fill];
-					break;
-				
-				case kCGPathStroke:
-				default:
-					[pathElement->bezierPath stroke];
-					break;
-				}
-			}
-		}
+		renderDrawing(canvasPtr, drawingContext, contentBounds, isPrinting);
 	}
 	gVectorCanvasPtrLocks().releaseLock(canvasRef, &canvasPtr);
 }// renderDrawingInCurrentFocusWithRect:
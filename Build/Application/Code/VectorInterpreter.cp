@@ -34,16 +34,17 @@
 #include <UniversalDefines.h>
 
 // standard-C++ includes
+#include <algorithm>
+#include <climits>
 #include <deque>
+#include <vector>
 
 // library includes
 #include <Console.h>
-#include <MemoryBlockPtrLocker.template.h>
 #include <MemoryBlockReferenceLocker.template.h>
-#include <MemoryBlockReferenceTracker.template.h>
+#include <MemoryBlockReferenceTable.template.h>
 #include <MemoryBlocks.h>
 #include <RegionUtilities.h>
-#include <Registrar.template.h>
 
 // application includes
 #include "VectorCanvas.h"
@@ -109,6 +110,25 @@ namespace {
 #define CHARH		10		/* horz. unit size */
 #define CHARV		13		/* vert. unit size */
 
+/*!
+The decoded display list is indexed by a uniform grid over
+the virtual TEK space (4096 x 3120), so that a redraw of a
+zoomed region only visits primitives in nearby cells.
+*/
+SInt16 const	kMy_DisplayGridCellSize = 128;
+SInt16 const	kMy_DisplayGridColumnCount = (4096 / kMy_DisplayGridCellSize);
+SInt16 const	kMy_DisplayGridRowCount = ((3120 + kMy_DisplayGridCellSize - 1) / kMy_DisplayGridCellSize);
+
+/*!
+The kinds of primitives in a decoded display list.
+*/
+enum My_DisplayItemKind : UInt8
+{
+	kMy_DisplayItemKindLine			= 0,	//!< a line segment (or a lone point) in the main drawing
+	kMy_DisplayItemKindPanelEdge	= 1,	//!< a line segment that is part of the outline of a filled panel
+	kMy_DisplayItemKindPanelFill	= 2		//!< fills the panel formed by the edges that immediately precede it
+};
+
 } // anonymous namespace
 
 #pragma mark Types
@@ -170,8 +190,39 @@ Used to store drawing commands.
 */
 typedef std::deque< SInt16 >	My_VectorDB;
 
-typedef MemoryBlockReferenceTracker< VectorInterpreter_Ref >						My_VectorInterpreterReferenceTracker;
-typedef Registrar< VectorInterpreter_Ref, My_VectorInterpreterReferenceTracker >	My_VecIntRefRegistrar;
+/*!
+A primitive that has already been decoded from the command
+stream, in virtual (unzoomed) TEK coordinates.  Replaying
+these is much cheaper than interpreting all the original
+commands again.
+
+For kMy_DisplayItemKindPanelFill, the coordinates are the
+bounding box of the panel and "edgeCount" is the number of
+kMy_DisplayItemKindPanelEdge items immediately before it.
+*/
+struct My_DisplayItem
+{
+	SInt16				startX;
+	SInt16				startY;
+	SInt16				endX;
+	SInt16				endY;
+	SInt16				color;		// pen color, or fill color for panels
+	My_DisplayItemKind	kind;
+	UInt8				purpose;	// a VectorCanvas_PathPurpose value; for panels, nonzero if outlined
+	UInt32				edgeCount;	// only used by panels
+};
+typedef std::vector< My_DisplayItem >	My_DisplayList;
+
+/*!
+The indices of display list items that intersect a grid cell,
+in the order they were drawn.
+*/
+typedef std::vector< UInt32 >					My_DisplayItemIndexList;
+typedef std::vector< My_DisplayItemIndexList >	My_DisplayGrid;
+
+struct My_VectorInterpreter;	// declared here because the registrar declaration uses it (defined later)
+typedef MemoryBlockReferenceTable< VectorInterpreter_Ref, My_VectorInterpreter >			My_VectorInterpreterPtrLocker;
+typedef MemoryBlockReferenceTableRegistrar< VectorInterpreter_Ref, My_VectorInterpreter >	My_VecIntRefRegistrar;
 
 /*!
 Stores information used to interpret vector graphics
@@ -181,13 +232,31 @@ struct My_VectorInterpreter
 {
 	My_VectorInterpreter	(VectorInterpreter_Mode);
 	
+	void
+	addLine		(SInt16, SInt16, SInt16, SInt16, VectorCanvas_PathPurpose, VectorCanvas_PathTarget = kVectorCanvas_PathTargetPrimary);
+	
+	void
+	addPanelFill	(SInt16, Boolean);
+	
+	void
+	beginPanel ();
+	
+	void
+	clearDisplayList ();
+	
 	inline void
 	drawLine	(SInt16, SInt16, SInt16, SInt16, VectorCanvas_PathPurpose, VectorCanvas_PathTarget = kVectorCanvas_PathTargetPrimary);
 	
+	void
+	indexDisplayItem	(UInt32);
+	
+	void
+	setPenColor		(SInt16, VectorCanvas_PathPurpose);
+	
 	inline void
 	shrinkVectorDB	(My_VectorDB::size_type);
 	
-	My_VecIntRefRegistrar	refValidator;	// ensures this reference is recognized as a valid one
+	My_VecIntRefRegistrar	refValidator;	// assigns the ID of this structure and ensures it is recognized as a valid one
 	VectorInterpreter_Ref	selfRef;		// the ID given to this structure at construction time
 	VectorInterpreter_Mode	commandSet;		// how data is interpreted
 	Boolean					pageClears;		// true if PAGE clears the screen, false if it opens a new window
@@ -217,13 +286,17 @@ struct My_VectorInterpreter
 	char	state;
 	char	savstate;
 	// WARNING: shrinkVectorDB() is the recommended way to reduce the size of "commandList", to keep iterators in sync
-	My_VectorDB				commandList;		// list of commands
+	My_VectorDB				commandList;		// list of commands, as received; only kept for exporting the original data
 	My_VectorDB::iterator	toCurrentCommand;	// used to track drawing
+	My_DisplayList			displayList;		// decoded primitives, used for all redraws
+	My_DisplayGrid			displayGrid;		// spatial index into "displayList"
+	UInt32					panelStartIndex;	// index in "displayList" of the first edge of the panel being built
+	SInt16					penColorForPurpose[2];	// most recent pen color given to the canvas, for each VectorCanvas_PathPurpose
+	Boolean					isViewStale;		// set when something other than new drawing changes the picture (e.g. the background)
 };
 typedef My_VectorInterpreter*			My_VectorInterpreterPtr;
 typedef My_VectorInterpreter const*		My_VectorInterpreterConstPtr;
 
-typedef MemoryBlockPtrLocker< VectorInterpreter_Ref, My_VectorInterpreter >			My_VectorInterpreterPtrLocker;
 typedef LockAcquireRelease< VectorInterpreter_Ref, My_VectorInterpreter >			My_VectorInterpreterAutoLocker;
 typedef MemoryBlockReferenceLocker< VectorInterpreter_Ref, My_VectorInterpreter >	My_VectorInterpreterReferenceLocker;
 
@@ -232,12 +305,15 @@ typedef MemoryBlockReferenceLocker< VectorInterpreter_Ref, My_VectorInterpreter
 #pragma mark Internal Method Prototypes
 namespace {
 
+void			completeCoordinates			(My_VectorInterpreterPtr);
+UInt8 const*	decodeCoordinateRun			(My_VectorInterpreterPtr, UInt8 const*, UInt8 const*);
 short			drawc						(My_VectorInterpreterPtr, short);
 short			fontnum						(My_VectorInterpreterPtr, UInt16);
 Boolean			isValidID					(VectorInterpreter_Ref);
 short			joinup						(short, short, short);
 void			linefeed					(My_VectorInterpreterPtr);
 void			newcoord					(My_VectorInterpreterPtr);
+void			renderDisplayList			(My_VectorInterpreterConstPtr, My_VectorInterpreterPtr);
 void			storexy						(My_VectorInterpreterPtr, short, short);
 void			VGclrstor					(My_VectorInterpreterPtr);
 void			VGdraw						(My_VectorInterpreterPtr, char);
@@ -507,7 +583,6 @@ char const*		gTEK4105Font[106] =
 
 My_VectorInterpreterPtrLocker&			gVectorInterpreterPtrLocks ()	{ static My_VectorInterpreterPtrLocker x; return x; }
 My_VectorInterpreterReferenceLocker&	gVectorInterpreterRefLocks ()	{ static My_VectorInterpreterReferenceLocker x; return x; }
-My_VectorInterpreterReferenceTracker&	gVectorInterpreterValidRefs ()	{ static My_VectorInterpreterReferenceTracker x; return x; }
 
 } // anonymous namespace
 
@@ -532,7 +607,10 @@ VectorInterpreter_New	(VectorInterpreter_Mode		inCommandSet)
 	
 	try
 	{
-		result = REINTERPRET_CAST(new My_VectorInterpreter(inCommandSet), VectorInterpreter_Ref);
+		My_VectorInterpreterPtr		ptr = new My_VectorInterpreter(inCommandSet);
+		
+		
+		result = ptr->selfRef;
 	}
 	catch (std::bad_alloc)
 	{
@@ -549,7 +627,7 @@ VectorInterpreter_New	(VectorInterpreter_Mode		inCommandSet)
 		fontnum(ptr, 0);
 		storexy(ptr, 0, 3071);
 		
-		(VectorCanvas_Result)VectorCanvas_SetPenColor(ptr->canvas, 1, kVectorCanvas_PathPurposeGraphics);
+		ptr->setPenColor(1, kVectorCanvas_PathPurposeGraphics);
 	#if 1
 		VectorInterpreter_Zoom(result, 0, 0, 4095, 3119); // important!
 	#else
@@ -593,13 +671,13 @@ VectorInterpreter_Release	(VectorInterpreter_Ref*		inoutRefPtr)
 		gVectorInterpreterRefLocks().releaseLock(*inoutRefPtr);
 		unless (gVectorInterpreterRefLocks().isLocked(*inoutRefPtr))
 		{
-			{
-				My_VectorInterpreterAutoLocker	ptr(gVectorInterpreterPtrLocks(), *inoutRefPtr);
-				
-				
-				VectorCanvas_Release(&ptr->canvas);
-				delete ptr;
-			}
+			// the structure is found without locking it, because its
+			// reference is no longer valid once it is deleted
+			My_VectorInterpreterPtr		ptr = gVectorInterpreterPtrLocks().returnPointer(*inoutRefPtr);
+			
+			
+			VectorCanvas_Release(&ptr->canvas);
+			delete ptr;
 		}
 	}
 	*inoutRefPtr = nullptr;
@@ -690,7 +768,11 @@ VectorInterpreter_PageCommand	(VectorInterpreter_Ref	inRef)
 	if (nullptr != ptr->canvas)
 	{
 		VectorCanvas_ClearCaches(ptr->canvas);
-		(VectorCanvas_Result)VectorCanvas_SetPenColor(ptr->canvas, 1, kVectorCanvas_PathPurposeGraphics);
+		
+		// a cleared canvas reverts to its default colors
+		ptr->penColorForPurpose[kVectorCanvas_PathPurposeGraphics] = 0;
+		ptr->penColorForPurpose[kVectorCanvas_PathPurposeText] = 0;
+		ptr->setPenColor(1, kVectorCanvas_PathPurposeGraphics);
 	}
 }// PageCommand
 
@@ -702,6 +784,13 @@ Stores and renders the specified data, returning the number of
 bytes accepted before possible cancellation.  The data should
 use the command set specified by VectorInterpreter_ReturnMode().
 
+Runs of coordinate bytes (the bulk of most plots) are decoded
+in a tight loop and stored all at once; everything else goes
+through the complete interpreter one character at a time.
+Only the area covered by new drawing is invalidated, unless
+a command changed the whole picture (such as the background
+color) in which case the entire view is redrawn.
+
 (3.1)
 */
 size_t
@@ -719,15 +808,36 @@ VectorInterpreter_ProcessData	(VectorInterpreter_Ref	inRef,
 		UInt8 const*					charPtr = nullptr;
 		
 		
-		for (charPtr = inDataPtr;
-				((kPastEnd != charPtr) && (24/* CAN(CEL) character */ != *charPtr)); ++charPtr)
+		charPtr = inDataPtr;
+		while ((kPastEnd != charPtr) && (24/* CAN(CEL) character */ != *charPtr))
 		{
-			ptr->commandList.push_back(*charPtr);
-		#if 1
-			VGdraw(ptr, *charPtr);
-		#endif
+			UInt8 const*	runPastEnd = decodeCoordinateRun(ptr, charPtr, kPastEnd);
+			
+			
+			if (runPastEnd != charPtr)
+			{
+				// coordinate bytes are never removed from the command list
+				// (unlike certain other characters; see shrinkVectorDB())
+				// so they can be stored together
+				ptr->commandList.insert(ptr->commandList.end(), charPtr, runPastEnd);
+				charPtr = runPastEnd;
+			}
+			else
+			{
+				ptr->commandList.push_back(*charPtr);
+				VGdraw(ptr, *charPtr);
+				++charPtr;
+			}
+		}
+		if (ptr->isViewStale)
+		{
+			ptr->isViewStale = false;
+			VectorCanvas_InvalidateView(ptr->canvas);
+		}
+		else
+		{
+			VectorCanvas_InvalidateNewDrawing(ptr->canvas);
 		}
-		VectorCanvas_InvalidateView(ptr->canvas);
 		result = charPtr - inDataPtr;
 	}
 	return result;
@@ -735,8 +845,13 @@ VectorInterpreter_ProcessData	(VectorInterpreter_Ref	inRef,
 
 
 /*!
-Redraws the whole graphic.  Clear the screen before invoking
-a redraw.
+Redraws the graphic into the canvas of the destination,
+using the zoom region of the destination.  Clear the screen
+before invoking a redraw.
+
+This replays the decoded display list instead of the original
+commands, and only visits primitives that can be seen in the
+zoom region.
 
 (2.6)
 */
@@ -745,13 +860,18 @@ VectorInterpreter_Redraw	(VectorInterpreter_Ref	inRef,
 							 VectorInterpreter_Ref	inDestinationGraphicID)
 {
 	My_VectorInterpreterAutoLocker	ptr(gVectorInterpreterPtrLocks(), inRef);
-	My_VectorInterpreterAutoLocker	destPtr(gVectorInterpreterPtrLocks(), inDestinationGraphicID);
 	
 	
-	for (ptr->toCurrentCommand = ptr->commandList.begin();
-			ptr->commandList.end() != ptr->toCurrentCommand; ++(ptr->toCurrentCommand))
+	if (inDestinationGraphicID == inRef)
 	{
-		VGdraw(destPtr, STATIC_CAST(*(ptr->toCurrentCommand), char));
+		renderDisplayList(ptr, ptr);
+	}
+	else
+	{
+		My_VectorInterpreterAutoLocker	destPtr(gVectorInterpreterPtrLocks(), inDestinationGraphicID);
+		
+		
+		renderDisplayList(ptr, destPtr);
 	}
 }// Redraw
 
@@ -827,7 +947,8 @@ VectorInterpreter_SetPageClears		(VectorInterpreter_Ref	inRef,
 
 /*	Set new borders for zoom/pan region.
  *	x0,y0 is lower left; x1,y1 is upper right.
- *	User should redraw after calling this.
+ *	The canvas is rebuilt from the display list, visiting
+ *	only the primitives that are visible in the new region.
  */
 void
 VectorInterpreter_Zoom	(VectorInterpreter_Ref	inRef,
@@ -847,6 +968,12 @@ VectorInterpreter_Zoom	(VectorInterpreter_Ref	inRef,
 		ptr->winright = inX1;
 		ptr->wintall = inY1 - inY0 + 1;
 		ptr->winwide = inX1 - inX0 + 1;
+		
+		if ((nullptr != ptr->canvas) && (false == ptr->displayList.empty()))
+		{
+			VectorCanvas_ClearCaches(ptr->canvas);
+			renderDisplayList(ptr, ptr);
+		}
 	}
 }// Zoom
 
@@ -854,6 +981,176 @@ VectorInterpreter_Zoom	(VectorInterpreter_Ref	inRef,
 #pragma mark Internal Methods
 namespace {
 
+/*!
+Acts on a complete set of new coordinates according to the
+current mode (for instance, drawing a line to the new point
+in vector mode).  This is invoked whenever the interpreter
+returns to the DONE state.
+
+(2017.10)
+*/
+void
+completeCoordinates		(My_VectorInterpreterPtr	vp)
+{
+	My_PointList	temppoint = nullptr;
+	
+	
+	if (vp->mode == PANEL)
+	{
+		vp->mode = DONE;
+		vp->state = INTEGER;
+		vp->savstate = PANEL;
+	}
+	else if ((vp->TEKPanel) && ((vp->mode == DRAW) || (vp->mode == TEMPDRAW)
+			|| (vp->mode == MARK) || (vp->mode == TEMPMARK) ||
+				(vp->mode == TEMPMOVE)))
+	{
+		temppoint = new My_Point;
+		vp->current->next = temppoint;
+		vp->current = temppoint;
+		vp->current->x = joinup(vp->nhix,vp->nlox,vp->nex);
+		vp->current->y = joinup(vp->nhiy,vp->nloy,vp->ney);
+		vp->current->next = (My_PointList) nullptr;
+		if ((vp->mode == TEMPDRAW) || (vp->mode == TEMPMOVE) ||
+			(vp->mode == TEMPMARK))
+			vp->mode = vp->modesave;
+		newcoord(vp);
+	}
+	else if (vp->mode == TEMPMOVE)
+	{
+		vp->mode = vp->modesave;
+		newcoord(vp);
+	}
+	else if ((vp->mode == DRAW) || (vp->mode == TEMPDRAW))
+	{
+		vp->addLine(vp->curx, vp->cury, joinup(vp->nhix, vp->nlox, vp->nex), joinup(vp->nhiy, vp->nloy, vp->ney),
+						kVectorCanvas_PathPurposeGraphics);
+		newcoord(vp);
+		if (vp->mode == TEMPDRAW) vp->mode = vp->modesave;
+	}
+	else if ((vp->mode == MARK) || (vp->mode == TEMPMARK))
+	{
+		newcoord(vp);
+		if (kVectorInterpreter_ModeTEK4105 == vp->commandSet) drawc(vp,127 + vp->TEKMarker);
+		newcoord(vp);
+		if (vp->mode == TEMPMARK) vp->mode = vp->modesave;
+	}
+}// completeCoordinates
+
+
+/*!
+Decodes as many coordinate bytes as possible from the given
+range, returning a pointer just past the last byte consumed
+(which is the start of the range if the first byte cannot be
+handled here).  This is equivalent to passing each byte to
+VGdraw(), but it avoids the general state machine for the
+common case of a stream of points in vector or marker mode.
+
+Decoding stops at any control character, or whenever the
+interpreter is not waiting for part of a coordinate, so that
+VGdraw() can handle everything else.
+
+(2017.10)
+*/
+UInt8 const*
+decodeCoordinateRun		(My_VectorInterpreterPtr	vp,
+						 UInt8 const*				inBegin,
+						 UInt8 const*				inPastEnd)
+{
+	UInt8 const*	result = inBegin;
+	
+	
+	for (; inPastEnd != result; ++result)
+	{
+		char const		kCommand = STATIC_CAST((*result >> 5) & 0x03, char);
+		char const		kValue = STATIC_CAST(*result & 0x1f, char);
+		
+		
+		if (0 == kCommand)
+		{
+			// control characters may change the mode or state
+			break;
+		}
+		
+		if ((DONE == vp->state) && ((DRAW == vp->mode) || (MARK == vp->mode)))
+		{
+			// in vector or marker mode, a non-control character
+			// always begins another point
+			vp->state = HIY;
+		}
+		
+		switch (vp->state)
+		{
+		case HIY: /* beginning of a vector */
+			vp->nhiy = vp->hiy;
+			vp->nhix = vp->hix;
+			vp->nloy = vp->loy;
+			vp->nlox = vp->lox;
+			vp->ney  = vp->ey;
+			vp->nex  = vp->ex;
+			switch (kCommand)
+			{
+			case 1: vp->nhiy = kValue; vp->state = EXTRA; break;
+			case 2: vp->nlox = kValue; vp->state = DONE; break;
+			default: vp->nloy = kValue; vp->state = LOY; break;
+			}
+			break;
+		
+		case EXTRA: /* got hiy; expecting extra or loy */
+			switch (kCommand)
+			{
+			case 1: vp->nhix = kValue; vp->state = LOX; break;
+			case 2: vp->nlox = kValue; vp->state = DONE; break;
+			default: vp->nloy = kValue; vp->state = LOY; break;
+			}
+			break;
+		
+		case LOY: /* got extra or loy; next may be loy or something else */
+			switch (kCommand)
+			{
+			case 1: vp->nhix = kValue; vp->state = LOX; break;
+			case 2: vp->nlox = kValue; vp->state = DONE; break;
+			default:
+				/* this is loy; previous loy was really extra */
+				vp->ney = (vp->nloy >> 2) & 3;
+				vp->nex = vp->nloy & 3;
+				vp->nloy = kValue;
+				vp->state = HIX;
+				break;
+			}
+			break;
+		
+		case HIX: /* hix or lox */
+			switch (kCommand)
+			{
+			case 1: vp->nhix = kValue; vp->state = LOX; break;
+			case 2: vp->nlox = kValue; vp->state = DONE; break;
+			default: break; // ignored
+			}
+			break;
+		
+		case LOX: /* must be lox */
+			if (2 == kCommand)
+			{
+				vp->nlox = kValue;
+				vp->state = DONE;
+			}
+			break;
+		
+		default:
+			// not decoding a coordinate
+			return result;
+		}
+		
+		if (DONE == vp->state)
+		{
+			completeCoordinates(vp);
+		}
+	}
+	return result;
+}// decodeCoordinateRun
+
+
 /*!
 Constructor.
 
@@ -868,8 +1165,8 @@ My_VectorInterpreter::
 My_VectorInterpreter	(VectorInterpreter_Mode		inCommandSet)
 :
 // IMPORTANT: THESE ARE EXECUTED IN THE ORDER MEMBERS APPEAR IN THE CLASS.
-refValidator(REINTERPRET_CAST(this, VectorInterpreter_Ref), gVectorInterpreterValidRefs()),
-selfRef(REINTERPRET_CAST(this, VectorInterpreter_Ref)),
+refValidator(this, gVectorInterpreterPtrLocks()),
+selfRef(refValidator.returnReference()),
 commandSet(inCommandSet),
 pageClears(false),
 canvas(nullptr),
@@ -917,7 +1214,12 @@ current(nullptr),
 state(DONE),
 savstate(0),
 commandList(),
-toCurrentCommand(commandList.begin())
+toCurrentCommand(commandList.begin()),
+displayList(),
+displayGrid(kMy_DisplayGridColumnCount * kMy_DisplayGridRowCount),
+panelStartIndex(0),
+penColorForPurpose{0, 0},
+isViewStale(false)
 {
 	// the canvas should be initialized last, because it will trigger
 	// rendering that depends on all the initializations above
@@ -925,6 +1227,129 @@ toCurrentCommand(commandList.begin())
 }// My_VectorInterpreter default constructor
 
 
+/*!
+Adds the specified line (in virtual coordinates) to the
+decoded display list, and draws it into the canvas.  This
+should be used by the interpreter for all new drawing, so
+that later redraws can skip command interpretation.
+
+A target of "kVectorCanvas_PathTargetScrap" adds an edge
+to the panel started by beginPanel().
+
+(2017.10)
+*/
+void
+My_VectorInterpreter::
+addLine		(SInt16						inStartX,
+			 SInt16						inStartY,
+			 SInt16						inEndX,
+			 SInt16						inEndY,
+			 VectorCanvas_PathPurpose	inPurpose,
+			 VectorCanvas_PathTarget	inTarget)
+{
+	My_DisplayItem		newItem;
+	
+	
+	newItem.startX = inStartX;
+	newItem.startY = inStartY;
+	newItem.endX = inEndX;
+	newItem.endY = inEndY;
+	newItem.color = this->penColorForPurpose[inPurpose];
+	newItem.kind = (kVectorCanvas_PathTargetScrap == inTarget)
+					? kMy_DisplayItemKindPanelEdge
+					: kMy_DisplayItemKindLine;
+	newItem.purpose = STATIC_CAST(inPurpose, UInt8);
+	newItem.edgeCount = 0;
+	this->displayList.push_back(newItem);
+	
+	// panel edges are only indexed as part of the whole panel
+	if (kMy_DisplayItemKindLine == newItem.kind)
+	{
+		indexDisplayItem(STATIC_CAST(this->displayList.size() - 1, UInt32));
+	}
+	
+	drawLine(inStartX, inStartY, inEndX, inEndY, inPurpose, inTarget);
+}// addLine
+
+
+/*!
+Completes the panel started by beginPanel(), filling the
+region bounded by all edges added since then.  The panel
+is added to the decoded display list as one primitive.
+
+(2017.10)
+*/
+void
+My_VectorInterpreter::
+addPanelFill	(SInt16		inFillColor,
+				 Boolean	inOutline)
+{
+	UInt32 const		kEdgeCount = STATIC_CAST(this->displayList.size() - this->panelStartIndex, UInt32);
+	My_DisplayItem		newItem;
+	
+	
+	newItem.startX = SHRT_MAX;
+	newItem.startY = SHRT_MAX;
+	newItem.endX = SHRT_MIN;
+	newItem.endY = SHRT_MIN;
+	for (auto i = this->panelStartIndex; i < this->displayList.size(); ++i)
+	{
+		My_DisplayItem const&	edge = this->displayList[i];
+		
+		
+		newItem.startX = std::min(newItem.startX, std::min(edge.startX, edge.endX));
+		newItem.startY = std::min(newItem.startY, std::min(edge.startY, edge.endY));
+		newItem.endX = std::max(newItem.endX, std::max(edge.startX, edge.endX));
+		newItem.endY = std::max(newItem.endY, std::max(edge.startY, edge.endY));
+	}
+	newItem.color = inFillColor;
+	newItem.kind = kMy_DisplayItemKindPanelFill;
+	newItem.purpose = (inOutline) ? 1 : 0;
+	newItem.edgeCount = kEdgeCount;
+	this->displayList.push_back(newItem);
+	if (kEdgeCount > 0)
+	{
+		indexDisplayItem(STATIC_CAST(this->displayList.size() - 1, UInt32));
+	}
+	
+	UNUSED_RETURN(VectorCanvas_Result)VectorCanvas_ScrapPathFill(this->canvas, inFillColor, (inOutline) ? 1.0 : 0.0);
+}// addPanelFill
+
+
+/*!
+Starts a new filled panel; subsequent calls to addLine()
+with the scrap target define its edges, and addPanelFill()
+completes it.
+
+(2017.10)
+*/
+void
+My_VectorInterpreter::
+beginPanel ()
+{
+	this->panelStartIndex = STATIC_CAST(this->displayList.size(), UInt32);
+	UNUSED_RETURN(VectorCanvas_Result)VectorCanvas_ScrapPathReset(this->canvas);
+}// beginPanel
+
+
+/*!
+Removes all decoded primitives and their spatial index.
+
+(2017.10)
+*/
+void
+My_VectorInterpreter::
+clearDisplayList ()
+{
+	this->displayList.clear();
+	for (auto& cellItems : this->displayGrid)
+	{
+		cellItems.clear();
+	}
+	this->panelStartIndex = 0;
+}// clearDisplayList
+
+
 /*!
 Adds the specified line to the underlying canvas’ current
 drawing, accounting for any current offset and scaling.
@@ -964,6 +1389,66 @@ drawLine	(SInt16						inStartX,
 }// drawLine
 
 
+/*!
+Adds the specified item from the display list to every cell
+of the spatial grid that its bounding box intersects.
+Coordinates outside the virtual space are clipped to the
+outermost cells.
+
+(2017.10)
+*/
+void
+My_VectorInterpreter::
+indexDisplayItem	(UInt32		inIndex)
+{
+	My_DisplayItem const&	item = this->displayList[inIndex];
+	auto					cellColumn = [](SInt16 inX) -> SInt16
+							{
+								return std::max(STATIC_CAST(0, SInt16),
+												std::min(STATIC_CAST(inX / kMy_DisplayGridCellSize, SInt16),
+															STATIC_CAST(kMy_DisplayGridColumnCount - 1, SInt16)));
+							};
+	auto					cellRow = [](SInt16 inY) -> SInt16
+							{
+								return std::max(STATIC_CAST(0, SInt16),
+												std::min(STATIC_CAST(inY / kMy_DisplayGridCellSize, SInt16),
+															STATIC_CAST(kMy_DisplayGridRowCount - 1, SInt16)));
+							};
+	SInt16 const			kFirstColumn = cellColumn(std::min(item.startX, item.endX));
+	SInt16 const			kLastColumn = cellColumn(std::max(item.startX, item.endX));
+	SInt16 const			kFirstRow = cellRow(std::min(item.startY, item.endY));
+	SInt16 const			kLastRow = cellRow(std::max(item.startY, item.endY));
+	
+	
+	for (SInt16 row = kFirstRow; row <= kLastRow; ++row)
+	{
+		for (SInt16 column = kFirstColumn; column <= kLastColumn; ++column)
+		{
+			this->displayGrid[row * kMy_DisplayGridColumnCount + column].push_back(inIndex);
+		}
+	}
+}// indexDisplayItem
+
+
+/*!
+Changes the pen color of the canvas for the given purpose,
+and remembers it so that new display list items record the
+color they were drawn with.
+
+(2017.10)
+*/
+void
+My_VectorInterpreter::
+setPenColor		(SInt16						inColor,
+				 VectorCanvas_PathPurpose	inPurpose)
+{
+	if (kVectorCanvas_ResultOK == VectorCanvas_SetPenColor(this->canvas, inColor, inPurpose))
+	{
+		this->penColorForPurpose[inPurpose] = inColor;
+	}
+}// setPenColor
+
+
 /*!
 This is the recommended way to shrink the command vector,
 because it keeps the current command iterator in sync!!!
@@ -1053,10 +1538,10 @@ drawc		(My_VectorInterpreterPtr	inPtr,
 		if (c > 126)
 		{
 			height = 1;
-			(VectorCanvas_Result)VectorCanvas_SetPenColor(inPtr->canvas,inPtr->pencolor, kVectorCanvas_PathPurposeText);
+			inPtr->setPenColor(inPtr->pencolor, kVectorCanvas_PathPurposeText);
 		}
 		else
-			(VectorCanvas_Result)VectorCanvas_SetPenColor(inPtr->canvas,inPtr->TEKIndex, kVectorCanvas_PathPurposeText);
+			inPtr->setPenColor(inPtr->TEKIndex, kVectorCanvas_PathPurposeText);
 		hmag = (height*8);
 		vmag = (height*8);
 		
@@ -1120,7 +1605,7 @@ drawc		(My_VectorInterpreterPtr	inPtr,
 		{
 		case 'r': case 't': case 'y': case 'f': case 'h':
 		case 'v': case 'b': case 'n':
-			inPtr->drawLine(strokex, strokey, x, y, kVectorCanvas_PathPurposeText);
+			inPtr->addLine(strokex, strokey, x, y, kVectorCanvas_PathPurposeText);
 			break;
 		}
 	
@@ -1137,7 +1622,7 @@ drawc		(My_VectorInterpreterPtr	inPtr,
 
 	if (kVectorInterpreter_ModeTEK4105 == inPtr->commandSet)
 	{
-		(VectorCanvas_Result)VectorCanvas_SetPenColor(inPtr->canvas, inPtr->pencolor, kVectorCanvas_PathPurposeText);
+		inPtr->setPenColor(inPtr->pencolor, kVectorCanvas_PathPurposeText);
 	}
 
 	inPtr->cury = savey;
@@ -1184,7 +1669,7 @@ an existing interpreter.
 Boolean
 isValidID	(VectorInterpreter_Ref	inRef)
 {
-	return (gVectorInterpreterValidRefs().end() != gVectorInterpreterValidRefs().find(inRef));
+	return gVectorInterpreterPtrLocks().isValid(inRef);
 }// isValidID
 
 
@@ -1241,6 +1726,124 @@ newcoord	(My_VectorInterpreterPtr	inPtr)
 }
 
 
+/*!
+Draws the decoded display list of the source interpreter into
+the canvas of the destination interpreter, using the zoom
+region of the destination.  The source and destination may be
+the same.
+
+If the zoom region covers the whole virtual space then every
+item is drawn in order; otherwise, the spatial grid is used
+to find only the items that may be visible.  Either way, items
+are drawn in their original order so that overlaps look the
+same as they did when the data first arrived.
+
+(2017.10)
+*/
+void
+renderDisplayList	(My_VectorInterpreterConstPtr	inSource,
+					 My_VectorInterpreterPtr		inDestination)
+{
+	My_DisplayList const&		kItems = inSource->displayList;
+	My_DisplayItemIndexList		visibleItems;
+	SInt16						canvasColorForPurpose[2] = { -1, -1 };
+	auto						drawItem = [&](UInt32 inIndex)
+	{
+		My_DisplayItem const&	item = kItems[inIndex];
+		
+		
+		switch (item.kind)
+		{
+		case kMy_DisplayItemKindLine:
+			if (canvasColorForPurpose[item.purpose] != item.color)
+			{
+				UNUSED_RETURN(VectorCanvas_Result)VectorCanvas_SetPenColor(inDestination->canvas, item.color,
+																			STATIC_CAST(item.purpose, VectorCanvas_PathPurpose));
+				canvasColorForPurpose[item.purpose] = item.color;
+			}
+			inDestination->drawLine(item.startX, item.startY, item.endX, item.endY,
+									STATIC_CAST(item.purpose, VectorCanvas_PathPurpose));
+			break;
+		
+		case kMy_DisplayItemKindPanelFill:
+			UNUSED_RETURN(VectorCanvas_Result)VectorCanvas_ScrapPathReset(inDestination->canvas);
+			for (UInt32 i = inIndex - item.edgeCount; i < inIndex; ++i)
+			{
+				My_DisplayItem const&	edge = kItems[i];
+				
+				
+				inDestination->drawLine(edge.startX, edge.startY, edge.endX, edge.endY,
+										kVectorCanvas_PathPurposeGraphics, kVectorCanvas_PathTargetScrap);
+			}
+			UNUSED_RETURN(VectorCanvas_Result)VectorCanvas_ScrapPathFill(inDestination->canvas, item.color,
+																			(0 != item.purpose) ? 1.0 : 0.0);
+			break;
+		
+		case kMy_DisplayItemKindPanelEdge:
+		default:
+			// panel edges are drawn by their panel
+			break;
+		}
+	};
+	
+	
+	if ((inDestination->winleft <= 0) && (inDestination->winbot <= 0) &&
+		(inDestination->winright >= (kMy_DisplayGridColumnCount * kMy_DisplayGridCellSize - 1)) &&
+		(inDestination->wintop >= (kMy_DisplayGridRowCount * kMy_DisplayGridCellSize - 1)))
+	{
+		// everything is visible; the index is not needed
+		for (UInt32 i = 0; i < kItems.size(); ++i)
+		{
+			drawItem(i);
+		}
+	}
+	else
+	{
+		SInt16 const	kFirstColumn = std::max(0, inDestination->winleft / kMy_DisplayGridCellSize);
+		SInt16 const	kLastColumn = std::min(kMy_DisplayGridColumnCount - 1, inDestination->winright / kMy_DisplayGridCellSize);
+		SInt16 const	kFirstRow = std::max(0, inDestination->winbot / kMy_DisplayGridCellSize);
+		SInt16 const	kLastRow = std::min(kMy_DisplayGridRowCount - 1, inDestination->wintop / kMy_DisplayGridCellSize);
+		
+		
+		// collect items from every cell in the zoom region; since
+		// an item can span several cells, duplicates are removed
+		// (sorting also restores the original drawing order)
+		for (SInt16 row = kFirstRow; row <= kLastRow; ++row)
+		{
+			for (SInt16 column = kFirstColumn; column <= kLastColumn; ++column)
+			{
+				My_DisplayItemIndexList const&	cellItems = inSource->displayGrid[row * kMy_DisplayGridColumnCount + column];
+				
+				
+				visibleItems.insert(visibleItems.end(), cellItems.begin(), cellItems.end());
+			}
+		}
+		std::sort(visibleItems.begin(), visibleItems.end());
+		visibleItems.erase(std::unique(visibleItems.begin(), visibleItems.end()), visibleItems.end());
+		
+		for (auto i : visibleItems)
+		{
+			drawItem(i);
+		}
+	}
+	
+	// restore the colors that the destination was using, so that
+	// any further live drawing continues with the right colors
+	// (the canvas may have been cleared, so this is done even if
+	// no items changed a color)
+	for (SInt16 purpose = kVectorCanvas_PathPurposeGraphics; purpose <= kVectorCanvas_PathPurposeText; ++purpose)
+	{
+		if (canvasColorForPurpose[purpose] != inDestination->penColorForPurpose[purpose])
+		{
+			UNUSED_RETURN(VectorCanvas_Result)VectorCanvas_SetPenColor(inDestination->canvas, inDestination->penColorForPurpose[purpose],
+																		STATIC_CAST(purpose, VectorCanvas_PathPurpose));
+		}
+	}
+	
+	VectorCanvas_InvalidateView(inDestination->canvas);
+}// renderDisplayList
+
+
 void
 storexy		(My_VectorInterpreterPtr	inPtr,
 			 short		x,
@@ -1260,6 +1863,7 @@ void	VGclrstor(My_VectorInterpreterPtr	inPtr)
 {
 	inPtr->commandList.clear();
 	inPtr->toCurrentCommand = inPtr->commandList.begin();
+	inPtr->clearDisplayList();
 }
 
 
@@ -1527,7 +2131,7 @@ void VGdraw(My_VectorInterpreterPtr vp, char c)			/* the latest input char */
 			}
 			if (vp->mode == DRAW)
 			{
-				vp->drawLine(vp->curx, vp->cury, vp->curx, vp->cury, kVectorCanvas_PathPurposeGraphics);
+				vp->addLine(vp->curx, vp->cury, vp->curx, vp->cury, kVectorCanvas_PathPurposeGraphics);
 			}
 			break;
 		case CMD0: /* *->CMD0: get 1st letter of cmd */
@@ -1618,7 +2222,18 @@ void VGdraw(My_VectorInterpreterPtr vp, char c)			/* the latest input char */
 			goagain = true;
 			break;
 		case VIEWAT2:
-			vp->TEKBackground = vp->intin < 0 ? 0 : vp->intin > 7 ? 7 : vp->intin;
+			{
+				short const		kNewBackground = vp->intin < 0 ? 0 : vp->intin > 7 ? 7 : vp->intin;
+				
+				
+				// the background is not drawing, so the new-drawing
+				// area does not include it; redraw everything
+				if (kNewBackground != vp->TEKBackground)
+				{
+					vp->TEKBackground = kNewBackground;
+					vp->isViewStale = true;
+				}
+			}
 			vp->state = INTEGER;
 			vp->savstate = DONE;
 			goagain = true;
@@ -1726,10 +2341,10 @@ void VGdraw(My_VectorInterpreterPtr vp, char c)			/* the latest input char */
 						vp->savy = vp->cury = vp->current->y;
 						vp->current = vp->current->next;
 						delete temppoint;
-						(VectorCanvas_Result)VectorCanvas_ScrapPathReset(vp->canvas);
+						vp->beginPanel();
 						while (vp->current)
 						{
-							vp->drawLine(vp->curx, vp->cury, vp->current->x, vp->current->y,
+							vp->addLine(vp->curx, vp->cury, vp->current->x, vp->current->y,
 											kVectorCanvas_PathPurposeGraphics, kVectorCanvas_PathTargetScrap);
 							temppoint = vp->current;
 							vp->curx = vp->current->x;
@@ -1737,8 +2352,8 @@ void VGdraw(My_VectorInterpreterPtr vp, char c)			/* the latest input char */
 							vp->current = vp->current->next;
 							delete temppoint;
 						}
-						VectorCanvas_ScrapPathFill(vp->canvas, (vp->TEKPattern <= 0) ? -vp->TEKPattern : vp->pencolor,
-													(vp->TEKOutline) ? 1.0 : 0.0);
+						vp->addPanelFill((vp->TEKPattern <= 0) ? -vp->TEKPattern : vp->pencolor,
+											(vp->TEKOutline) ? true : false);
 						vp->TEKPanel = (My_PointList) nullptr;
 						vp->curx = vp->savx;
 						vp->cury = vp->savy;
@@ -1862,7 +2477,7 @@ void VGdraw(My_VectorInterpreterPtr vp, char c)			/* the latest input char */
 			break;
 		case COLORINT:				/* set line index; have integer */
 			vp->pencolor = vp->intin;
-			(VectorCanvas_Result)VectorCanvas_SetPenColor(vp->canvas, vp->intin, kVectorCanvas_PathPurposeGraphics);
+			vp->setPenColor(vp->intin, kVectorCanvas_PathPurposeGraphics);
 			vp->state = CANCEL;
 			goagain = true;			/* we ignored current char; now process it */
 			break;
@@ -2028,46 +2643,7 @@ void VGdraw(My_VectorInterpreterPtr vp, char c)			/* the latest input char */
 	
 		if (vp->state == DONE)
 		{
-			if (vp->mode == PANEL)
-			{
-				vp->mode = DONE;
-				vp->state = INTEGER;
-				vp->savstate = PANEL;
-			}
-			else if ((vp->TEKPanel) && ((vp->mode == DRAW) || (vp->mode == TEMPDRAW)
-					|| (vp->mode == MARK) || (vp->mode == TEMPMARK) ||
-						(vp->mode == TEMPMOVE)))
-			{
-				temppoint = new My_Point;
-				vp->current->next = temppoint;
-				vp->current = temppoint;
-				vp->current->x = joinup(vp->nhix,vp->nlox,vp->nex);
-				vp->current->y = joinup(vp->nhiy,vp->nloy,vp->ney);
-				vp->current->next = (My_PointList) nullptr;
-				if ((vp->mode == TEMPDRAW) || (vp->mode == TEMPMOVE) ||
-					(vp->mode == TEMPMARK))
-					vp->mode = vp->modesave;
-				newcoord(vp);
-			}
-			else if (vp->mode == TEMPMOVE)
-			{
-				vp->mode = vp->modesave;
-				newcoord(vp);
-			}
-			else if ((vp->mode == DRAW) || (vp->mode == TEMPDRAW))
-			{
-				vp->drawLine(vp->curx, vp->cury, joinup(vp->nhix, vp->nlox, vp->nex), joinup(vp->nhiy, vp->nloy, vp->ney),
-								kVectorCanvas_PathPurposeGraphics);
-				newcoord(vp);
-				if (vp->mode == TEMPDRAW) vp->mode = vp->modesave;
-			}
-			else if ((vp->mode == MARK) || (vp->mode == TEMPMARK))
-			{
-				newcoord(vp);
-				if (kVectorInterpreter_ModeTEK4105 == vp->commandSet) drawc(vp,127 + vp->TEKMarker);
-				newcoord(vp);
-				if (vp->mode == TEMPMARK) vp->mode = vp->modesave;
-			}
+			completeCoordinates(vp);
 		}
 
 		if (vp->state == CANCEL) vp->state = DONE;
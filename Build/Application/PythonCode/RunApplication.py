@@ -277,11 +277,16 @@ if __name__ == "__main__":
     # if desired, override what string is sent after keep-alive timers expire
     #Session.set_keep_alive_transmission(".")
 
-    try:
-        Terminal.on_seekword_call(pymacterm.term_text.find_word)
-    except Exception as _:
-        warn("Warning, exception while trying to register word finder for",
-             "double clicks:", _)
+    # double-clicks use a fast built-in word finder; to customize
+    # it instead, register a Python routine (this is slower, as it
+    # is called for every double-click), for example:
+    #Terminal.on_seekword_call(pymacterm.term_text.find_word)
+    # ...or, to just treat more characters as word separators:
+    #Terminal.set_word_separator_chars("/=")
+
+    # text other than URLs can be command-clicked if it matches
+    # a pattern that produces a URL, for example:
+    #Session.add_url_pattern("BUG-", "https://bugs.example.com/show?id=%@")
 
     for i in range(0, 256):
         try:
@@ -31,6 +31,14 @@
 
 // standard-C++ includes
 #import <iostream>
+#import <vector>
+
+// UNIX includes
+extern "C"
+{
+#	include <errno.h>
+#	include <unistd.h>
+}
 
 // Mac includes
 #import <AppKit/AppKit.h>
@@ -38,11 +46,38 @@
 #import <CoreFoundation/CoreFoundation.h>
 
 // library includes
+#import <Python.h>
+#import "ScriptHostProtocol.h"
 #import "XPCCallPythonClient.objc++.h"
 
 
 
+#pragma mark Constants
+namespace {
+
+UInt32 const	kMy_EventWindow = 16;	//!< number of unhandled events the host may send at once
+char const*		kMy_PythonModuleName = "script_host_client";	//!< module in the bundle resources that handles frames
+char const*		kMy_PythonHandlerName = "handle_frame";			//!< function in the module that is given each frame
+
+} // anonymous namespace
+
 #pragma mark Internal Method Prototypes
+namespace {
+
+void	handleFrameInPython		(ScriptHostProtocol_Frame const&);
+void	initializePython		();
+void	runScriptHostClient		(int);
+bool	writeAll				(int, std::vector< UInt8 > const&);
+
+} // anonymous namespace
+
+#pragma mark Variables
+namespace {
+
+PyObject*	gPythonFrameHandler = nullptr;	//!< set by initializePython(); nullptr if the module could not be loaded
+
+} // anonymous namespace
+
 
 /*!
 NSApplication subclass.  (It appears the delegate methods are
@@ -109,6 +144,259 @@ main	(int			argc,
 
 
 #pragma mark Internal Methods
+namespace {
+
+/*!
+Gives the given frame to the Python function that handles
+script host frames (see initializePython()).  Any exception
+raised by Python is printed and otherwise ignored, so that a
+faulty script cannot end the connection.
+
+This can be called from any thread.
+
+(2017.10)
+*/
+void
+handleFrameInPython		(ScriptHostProtocol_Frame const&	inFrame)
+{
+	if (nullptr != gPythonFrameHandler)
+	{
+		PyGILState_STATE	lockState = PyGILState_Ensure();
+		PyObject*			payloadObject = PyBytes_FromStringAndSize(REINTERPRET_CAST(inFrame.payload.data(), char const*),
+																		STATIC_CAST(inFrame.payload.size(), Py_ssize_t));
+		PyObject*			pythonResult = nullptr;
+		
+		
+		if (nullptr != payloadObject)
+		{
+			// "N" gives the payload reference to the argument list
+			pythonResult = PyObject_CallFunction(gPythonFrameHandler, CONST_CAST("IIN", char*),
+													STATIC_CAST(inFrame.type, unsigned int),
+													STATIC_CAST(inFrame.requestID, unsigned int), payloadObject);
+		}
+		if (nullptr == pythonResult)
+		{
+			PyErr_Print();
+		}
+		Py_XDECREF(pythonResult); pythonResult = nullptr;
+		PyGILState_Release(lockState);
+	}
+}// handleFrameInPython
+
+
+/*!
+Starts the Python interpreter (only the first time this is
+called) and finds the function that script host frames are
+given to.  The module is found in the resources of this
+service’s bundle, because a sandboxed service cannot read
+scripts from arbitrary places.
+
+The interpreter lock is released before this returns, so
+any thread can then use handleFrameInPython().
+
+(2017.10)
+*/
+void
+initializePython ()
+{
+	static dispatch_once_t	onceToken;
+	
+	
+	dispatch_once(&onceToken,
+	^{
+		PyObject*	pathList = nullptr;
+		PyObject*	resourcePath = nullptr;
+		PyObject*	module = nullptr;
+		
+		
+		Py_InitializeEx(0/* do not install signal handlers */);
+		PyEval_InitThreads(); // also acquires the interpreter lock
+		
+		pathList = PySys_GetObject(CONST_CAST("path", char*)); // not retained
+		resourcePath = PyUnicode_FromString([[[NSBundle mainBundle] resourcePath] UTF8String]);
+		if ((nullptr != pathList) && (nullptr != resourcePath))
+		{
+			UNUSED_RETURN(int)PyList_Insert(pathList, 0, resourcePath);
+		}
+		Py_XDECREF(resourcePath); resourcePath = nullptr;
+		
+		module = PyImport_ImportModule(kMy_PythonModuleName);
+		if (nullptr != module)
+		{
+			gPythonFrameHandler = PyObject_GetAttrString(module, kMy_PythonHandlerName);
+			Py_DECREF(module); module = nullptr;
+		}
+		if (nullptr == gPythonFrameHandler)
+		{
+			PyErr_Print();
+		}
+		
+		UNUSED_RETURN(PyThreadState*)PyEval_SaveThread();
+	});
+}// initializePython
+
+
+/*!
+Talks to the MacTerm script host on the given socket until
+the connection ends, then closes the socket.  This runs on a
+background queue and uses blocking I/O; requests are sent
+without waiting for earlier replies, and credit is returned
+for each event once it has been handled, so the host never
+has more than "kMy_EventWindow" events outstanding.
+
+Every event and error (and any reply that is not handled
+here) is given to Python; see handleFrameInPython().  Line
+changes are requested for every session that is open when
+the connection starts.
+
+(2017.10)
+*/
+void
+runScriptHostClient		(int	inSocket)
+{
+	ScriptHostProtocol_FrameParser	parser;
+	ScriptHostProtocol_Frame		frame;
+	std::vector< UInt8 >			output;
+	UInt32							nextRequestID = 1;
+	UInt32							listRequestID = 0;
+	UInt8							buffer[16384];
+	bool							isOK = true;
+	
+	
+	{
+		ScriptHostProtocol_Writer	writer(output, kScriptHostProtocol_MessageHello, nextRequestID++);
+		
+		
+		writer.appendUInt16(kScriptHostProtocol_Version);
+		writer.appendUInt32(kMy_EventWindow);
+		writer.finish();
+	}
+	{
+		ScriptHostProtocol_Writer	writer(output, kScriptHostProtocol_MessageListSessions, nextRequestID);
+		
+		
+		listRequestID = nextRequestID++;
+		writer.finish();
+	}
+	isOK = writeAll(inSocket, output);
+	
+	initializePython();
+	
+	while (isOK)
+	{
+		ssize_t const	kBytesRead = read(inSocket, buffer, sizeof(buffer));
+		
+		
+		if (kBytesRead <= 0)
+		{
+			isOK = ((kBytesRead < 0) && (EINTR == errno));
+			continue;
+		}
+		
+		parser.appendBytes(buffer, STATIC_CAST(kBytesRead, size_t));
+		output.clear();
+		while (parser.nextFrame(frame))
+		{
+			ScriptHostProtocol_Reader	reader(frame.payload);
+			UInt32						sessionID = 0;
+			UInt32						count = 0;
+			
+			
+			switch (frame.type)
+			{
+			case kScriptHostProtocol_MessageReply:
+				if ((listRequestID == frame.requestID) && reader.readUInt32(count))
+				{
+					// watch every session (without waiting for each reply)
+					for (UInt32 i = 0; ((i < count) && reader.readUInt32(sessionID)); ++i)
+					{
+						ScriptHostProtocol_Writer	writer(output, kScriptHostProtocol_MessageWatchLines, nextRequestID++);
+						
+						
+						writer.appendUInt32(sessionID);
+						writer.appendUInt8(1);
+						writer.finish();
+					}
+				}
+				else
+				{
+					handleFrameInPython(frame);
+				}
+				break;
+			
+			case kScriptHostProtocol_MessageError:
+				handleFrameInPython(frame);
+				break;
+			
+			case kScriptHostProtocol_MessageEventSessionOpened:
+			case kScriptHostProtocol_MessageEventSessionClosed:
+			case kScriptHostProtocol_MessageEventLinesChanged:
+			case kScriptHostProtocol_MessageEventScreenUpdate:
+				handleFrameInPython(frame);
+				
+				// the event has been handled; allow the host to send another
+				{
+					ScriptHostProtocol_Writer	writer(output, kScriptHostProtocol_MessageGrantCredit, nextRequestID++);
+					
+					
+					writer.appendUInt32(1);
+					writer.finish();
+				}
+				break;
+			
+			default:
+				// ???
+				break;
+			}
+		}
+		
+		if (parser.isCorrupt())
+		{
+			isOK = false;
+		}
+		else if (false == output.empty())
+		{
+			isOK = writeAll(inSocket, output);
+		}
+	}
+	
+	UNUSED_RETURN(int)close(inSocket);
+}// runScriptHostClient
+
+
+/*!
+Writes every byte of the given buffer to a blocking socket,
+returning false if the connection fails first.
+
+(2017.10)
+*/
+bool
+writeAll	(int							inSocket,
+			 std::vector< UInt8 > const&	inBytes)
+{
+	size_t	offset = 0;
+	bool	result = true;
+	
+	
+	while (result && (offset < inBytes.size()))
+	{
+		ssize_t const	kBytesWritten = write(inSocket, inBytes.data() + offset, inBytes.size() - offset);
+		
+		
+		if (kBytesWritten > 0)
+		{
+			offset += STATIC_CAST(kBytesWritten, size_t);
+		}
+		else
+		{
+			result = ((kBytesWritten < 0) && (EINTR == errno));
+		}
+	}
+	return result;
+}// writeAll
+
+} // anonymous namespace
+
 
 @implementation CallPythonClientApp //{
 
@@ -221,6 +509,31 @@ withReply:(XPCCallPythonClient_ReplyBlock)	aReplyBlock
 }
 
 
+- (void)
+xpcServiceAttachScriptHost:(NSFileHandle*)		aFileHandle
+withReply:(XPCCallPythonClient_ReplyBlock)		aReplyBlock
+{
+	// the handle may close its descriptor when the message is
+	// finished so a duplicate is used for the connection
+	int		clientSocket = dup([aFileHandle fileDescriptor]);
+	
+	
+	if (clientSocket < 0)
+	{
+		aReplyBlock(@"unable to use script host connection");
+	}
+	else
+	{
+		// scripts must not block the service’s main thread
+		dispatch_async(dispatch_get_global_queue(DISPATCH_QUEUE_PRIORITY_DEFAULT, 0),
+		^{
+			runScriptHostClient(clientSocket);
+		});
+		aReplyBlock(@"attached to script host");
+	}
+}
+
+
 @end //}
 
 // BELOW IS REQUIRED NEWLINE TO END FILE
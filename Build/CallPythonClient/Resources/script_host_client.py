@@ -0,0 +1,96 @@
+#!/usr/bin/python
+# vim: set fileencoding=UTF-8 :
+
+"""Routines that respond to a MacTerm script host connection.
+
+The call-Python service runs a client for the script host (see the
+"ScriptHostProtocol.h" file of MacTerm) and gives every event, error
+and unrequested reply to handle_frame() in this module.  Replace the
+on_...() routines to respond to sessions; by default they do nothing.
+
+handle_frame -- decode a frame from the host and call an on_...() routine
+on_error -- respond to a request that the host could not complete
+on_lines_changed -- respond to a change in the text of a session
+on_screen_update -- respond to a change in the screen of a session
+on_session_closed -- respond to the end of a session
+on_session_opened -- respond to the start of a session
+
+"""
+from __future__ import absolute_import
+from __future__ import division
+from __future__ import print_function
+
+__author__ = 'Kevin Grant <kmg@mac.com>'
+__date__ = '18 October 2017'
+__version__ = '4.1.0'
+
+import struct
+
+# these must match "ScriptHostProtocol_MessageType"
+MESSAGE_REPLY = 0x8001
+MESSAGE_ERROR = 0x8002
+EVENT_SESSION_OPENED = 0x8101
+EVENT_SESSION_CLOSED = 0x8102
+EVENT_LINES_CHANGED = 0x8103
+EVENT_SCREEN_UPDATE = 0x8104
+
+def on_error(request_id, code, description):
+    """on_error(request_id, code, description) -> None
+
+    Called when the host sends an error for the request with the
+    given ID.  The code is a "ScriptHostProtocol_ErrorCode" and the
+    description is a string.
+    """
+    pass
+
+def on_lines_changed(session_id, lines):
+    """on_lines_changed(session_id, lines) -> None
+
+    Called when text changes in the terminal of the given session.
+    The lines are integers in ascending order (negative numbers are
+    scrollback lines).
+    """
+    pass
+
+def on_screen_update(session_id, payload):
+    """on_screen_update(session_id, payload) -> None
+
+    Called when the screen of a viewed session changes.  The payload
+    is the complete event, as bytes (see "ScriptHostProtocol.h").
+    """
+    pass
+
+def on_session_closed(session_id):
+    """on_session_closed(session_id) -> None
+
+    Called when the session with the given ID is about to close.
+    """
+    pass
+
+def on_session_opened(session_id):
+    """on_session_opened(session_id) -> None
+
+    Called when a new session is opened.
+    """
+    pass
+
+def handle_frame(frame_type, request_id, payload):
+    """handle_frame(frame_type, request_id, payload) -> None
+
+    Decode the given frame from the script host and call the
+    matching on_...() routine.  Frames of other types are ignored.
+    All numbers in a payload are little-endian.
+    """
+    if frame_type == MESSAGE_ERROR and len(payload) >= 4:
+        (code,) = struct.unpack_from('<I', payload, 0)
+        on_error(request_id, code, payload[4:].decode('utf-8', 'replace'))
+    elif frame_type == EVENT_SESSION_OPENED and len(payload) >= 4:
+        on_session_opened(struct.unpack_from('<I', payload, 0)[0])
+    elif frame_type == EVENT_SESSION_CLOSED and len(payload) >= 4:
+        on_session_closed(struct.unpack_from('<I', payload, 0)[0])
+    elif frame_type == EVENT_LINES_CHANGED and len(payload) >= 8:
+        (session_id, count) = struct.unpack_from('<II', payload, 0)
+        count = min(count, (len(payload) - 8) // 4)
+        on_lines_changed(session_id, list(struct.unpack_from('<%di' % count, payload, 8)))
+    elif frame_type == EVENT_SCREEN_UPDATE and len(payload) >= 4:
+        on_screen_update(struct.unpack_from('<I', payload, 0)[0], payload)
@@ -90,7 +90,7 @@ public:
 	clear					();
 	
 	//! determines if there are any locks on the specified reference’s memory block
-	inline bool
+	virtual bool
 	isLocked				(structure_reference_type			inReference) const;
 	
 	//! writes a stack trace and notes the current lock count; this helps with
@@ -106,7 +106,7 @@ public:
 							 structure_type**					inoutPtrPtr) = 0;
 	
 	//! the number of locks acquired without being released (should be 0 if a reference is free)
-	UInt16
+	virtual UInt16
 	returnLockCount			(structure_reference_type			inReference) const;
 
 protected:
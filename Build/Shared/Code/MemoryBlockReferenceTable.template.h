@@ -0,0 +1,565 @@
+/*!	\file MemoryBlockReferenceTable.template.h
+	\brief A refinement of MemoryBlockLocker that hands out
+	opaque references as generation-checked handles, so that
+	references can be validated and locked without hashing.
+*/
+/*###############################################################
+
+	Data Access Library
+	© 1998-2017 by Kevin Grant
+	
+	This library is free software; you can redistribute it or
+	modify it under the terms of the GNU Lesser Public License
+	as published by the Free Software Foundation; either version
+	2.1 of the License, or (at your option) any later version.
+	
+	This program is distributed in the hope that it will be
+	useful, but WITHOUT ANY WARRANTY; without even the implied
+	warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR
+	PURPOSE.  See the GNU Lesser Public License for details.
+	
+	You should have received a copy of the GNU Lesser Public
+	License along with this library; if not, write to:
+	
+		Free Software Foundation, Inc.
+		59 Temple Place, Suite 330
+		Boston, MA  02111-1307
+		USA
+
+###############################################################*/
+
+#include <UniversalDefines.h>
+
+#pragma once
+
+// standard-C includes
+#include <cstdint>
+
+// standard-C++ includes
+#include <mutex>
+#include <vector>
+
+// Mac includes
+#include <CoreServices/CoreServices.h>
+
+// library includes
+#include <Console.h>
+#include <MemoryBlockLocker.template.h>
+
+
+
+#pragma mark Types
+
+/*!
+Stores pointers to data structures in an array of slots and
+gives out references that encode a slot index and a
+“generation” number.  A reference therefore resolves to a
+pointer in constant time, without hashing, and lock counts
+are kept in the slot itself instead of a separate map.
+
+When a structure is removed, its slot generation changes;
+any reference still held to the old structure is then
+“stale” and resolves to nullptr.  In debug builds, using a
+stale reference also logs a warning (which can be set up to
+produce a crash trace, like any other console warning).
+
+Unlike simple pointer lockers, the reference values are NOT
+addresses; always use the table to find the structure and
+use the result of insert() (typically stored as a “self
+reference”) wherever the reference is needed.
+
+A table is usually paired with a MemoryBlockReferenceTableRegistrar
+as the first member of the structure, which automatically
+inserts and removes the structure.
+
+Every operation holds an internal mutex, since the slots may
+be resolved from other threads (such as the threads that
+search terminals) while the main thread inserts structures
+and grows the slot storage.  Of course, this only protects
+the table; the structure that a reference resolves to is not
+protected by the table from concurrent changes.
+*/
+template < typename structure_reference_type, typename structure_type, bool debugged = false >
+class MemoryBlockReferenceTable:
+public MemoryBlockLocker< structure_reference_type, structure_type, debugged >
+{
+public:
+	//! increments the lock count and returns the referenced structure (or nullptr, if the reference is invalid)
+	structure_type*
+	acquireLock		(structure_reference_type	inReference) override;
+	
+	//! removes the specified reference; the slot is reused later with a new generation
+	void
+	erase			(structure_reference_type	inReference);
+	
+	//! adds the specified structure and returns a new reference that resolves to it
+	structure_reference_type
+	insert			(structure_type*			inStructurePtr);
+	
+	//! determines if there are any locks on the specified reference
+	bool
+	isLocked		(structure_reference_type	inReference) const override;
+	
+	//! returns true only if the reference was returned by insert() and has not been erased
+	inline bool
+	isValid			(structure_reference_type	inReference) const;
+	
+	//! decrements the lock count by one
+	void
+	releaseLock		(structure_reference_type	inReference);
+	
+	//! decrements the lock count by one and sets the given pointer to nullptr
+	void
+	releaseLock		(structure_reference_type	inReference,
+					 structure_type**			inoutPtrPtr) override;
+	
+	//! the number of locks acquired without being released (should be 0 if a reference is free)
+	UInt16
+	returnLockCount	(structure_reference_type	inReference) const override;
+	
+	//! returns the referenced structure without locking it (or nullptr, if the reference is invalid)
+	inline structure_type*
+	returnPointer	(structure_reference_type	inReference) const;
+	
+	//! test routine
+	static Boolean
+	unitTest ();
+
+protected:
+
+private:
+	struct Slot
+	{
+		structure_type*		structurePtr;	//!< nullptr if the slot is free
+		uintptr_t			generation;		//!< changes each time the slot is reused
+		UInt16				lockCount;		//!< the number of locks acquired on the current reference
+	};
+	
+	enum
+	{
+		kIndexBitCount = (4 * sizeof(uintptr_t))	//!< lower half of a reference is the slot index, upper half is the generation
+	};
+	
+	static uintptr_t const		kIndexMask = ((STATIC_CAST(1, uintptr_t) << kIndexBitCount) - 1);
+	
+	inline bool
+	isValidUnlocked	(structure_reference_type	inReference) const;
+	
+	inline Slot*
+	returnSlot	(structure_reference_type	inReference) const;
+	
+	mutable std::mutex			_slotsLock;		//!< held by every public method; guards all members below
+	std::vector< Slot >			_slots;			//!< storage for every structure ever inserted
+	std::vector< uintptr_t >	_freeIndices;	//!< slots available for reuse
+};
+
+
+/*!
+Automatically inserts a structure into a table when
+constructed, and erases it when destructed.  Make one of
+these the first data member of the structure, and initialize
+the structure’s “self reference” from returnReference().
+*/
+template < typename structure_reference_type, typename structure_type, bool debugged = false >
+class MemoryBlockReferenceTableRegistrar
+{
+	typedef MemoryBlockReferenceTable< structure_reference_type, structure_type, debugged >		TableType;
+
+public:
+	MemoryBlockReferenceTableRegistrar	(structure_type*, TableType&);
+	~MemoryBlockReferenceTableRegistrar	();
+	
+	//! the reference assigned to the structure at construction time
+	inline structure_reference_type
+	returnReference () const;
+
+private:
+	// copying is not allowed
+	MemoryBlockReferenceTableRegistrar	(MemoryBlockReferenceTableRegistrar< structure_reference_type, structure_type, debugged > const&);
+	
+	// reassignment is not allowed
+	MemoryBlockReferenceTableRegistrar< structure_reference_type, structure_type, debugged >&
+	operator =	(MemoryBlockReferenceTableRegistrar< structure_reference_type, structure_type, debugged > const&);
+	
+	TableType&					_table;
+	structure_reference_type	_ref;
+};
+
+struct MemoryBlockReferenceTable_TestClass
+{
+	int		x;
+};
+typedef struct MemoryBlockReferenceTable_TestOpaqueStructure*		MemoryBlockReferenceTable_TestClassRef;
+
+
+
+#pragma mark Public Methods
+
+/*!
+A unit test for this module.  This should always
+be run before a release, after any substantial
+changes are made, or if you suspect bugs!  It
+should also be EXPANDED as new functionality is
+proposed (ideally, a test is written before the
+functionality is added).
+
+(2017.10)
+*/
+inline void
+MemoryBlockReferenceTable_RunTests ()
+{
+	UInt16		totalTests = 0;
+	UInt16		failedTests = 0;
+	
+	
+	++totalTests;
+	if (false == MemoryBlockReferenceTable<MemoryBlockReferenceTable_TestClassRef, MemoryBlockReferenceTable_TestClass>::unitTest())
+	{
+		++failedTests;
+	}
+	
+	Console_WriteUnitTestReport("Memory Block Reference Table", failedTests, totalTests);
+}// RunTests
+
+
+template < typename structure_reference_type, typename structure_type, bool debugged >
+structure_type*
+MemoryBlockReferenceTable< structure_reference_type, structure_type, debugged >::
+acquireLock	(structure_reference_type	inReference)
+{
+	std::lock_guard< std::mutex >	slotsLock(_slotsLock);
+	structure_type*					result = nullptr;
+	Slot*							slotPtr = returnSlot(inReference);
+	
+	
+	if (nullptr != slotPtr)
+	{
+		++(slotPtr->lockCount);
+		assert(slotPtr->lockCount > 0);
+		if (debugged)
+		{
+			// log that a lock was acquired, and show where the lock came from
+			this->logLockState("acquired lock", inReference, slotPtr->lockCount);
+		}
+		result = slotPtr->structurePtr;
+	}
+	return result;
+}// acquireLock
+
+
+template < typename structure_reference_type, typename structure_type, bool debugged >
+void
+MemoryBlockReferenceTable< structure_reference_type, structure_type, debugged >::
+erase	(structure_reference_type	inReference)
+{
+	std::lock_guard< std::mutex >	slotsLock(_slotsLock);
+	Slot*							slotPtr = returnSlot(inReference);
+	
+	
+	if (nullptr != slotPtr)
+	{
+		if (debugged && (slotPtr->lockCount > 0))
+		{
+			this->logLockState("erased reference that still has locks", inReference, slotPtr->lockCount);
+		}
+		slotPtr->structurePtr = nullptr;
+		slotPtr->lockCount = 0;
+		++(slotPtr->generation);
+		_freeIndices.push_back(STATIC_CAST(slotPtr - _slots.data(), uintptr_t));
+	}
+}// erase
+
+
+template < typename structure_reference_type, typename structure_type, bool debugged >
+structure_reference_type
+MemoryBlockReferenceTable< structure_reference_type, structure_type, debugged >::
+insert	(structure_type*	inStructurePtr)
+{
+	std::lock_guard< std::mutex >	slotsLock(_slotsLock);
+	uintptr_t						index = 0;
+	Slot*							slotPtr = nullptr;
+	
+	
+	if (_freeIndices.empty())
+	{
+		Slot	newSlot = { nullptr, 0, 0 };
+		
+		
+		index = _slots.size();
+		assert(index < kIndexMask);
+		_slots.push_back(newSlot);
+	}
+	else
+	{
+		index = _freeIndices.back();
+		_freeIndices.pop_back();
+	}
+	slotPtr = &_slots[index];
+	slotPtr->structurePtr = inStructurePtr;
+	slotPtr->lockCount = 0;
+	
+	// the index is offset by one so that no reference is ever nullptr
+	return REINTERPRET_CAST(((slotPtr->generation << kIndexBitCount) | (index + 1)), structure_reference_type);
+}// insert
+
+
+template < typename structure_reference_type, typename structure_type, bool debugged >
+bool
+MemoryBlockReferenceTable< structure_reference_type, structure_type, debugged >::
+isLocked	(structure_reference_type	inReference)
+const
+{
+	return (returnLockCount(inReference) > 0);
+}// isLocked
+
+
+template < typename structure_reference_type, typename structure_type, bool debugged >
+bool
+MemoryBlockReferenceTable< structure_reference_type, structure_type, debugged >::
+isValid		(structure_reference_type	inReference)
+const
+{
+	std::lock_guard< std::mutex >	slotsLock(_slotsLock);
+	
+	
+	return isValidUnlocked(inReference);
+}// isValid
+
+
+template < typename structure_reference_type, typename structure_type, bool debugged >
+void
+MemoryBlockReferenceTable< structure_reference_type, structure_type, debugged >::
+releaseLock	(structure_reference_type	inReference)
+{
+	structure_type*		dummyPtr = nullptr;
+	
+	
+	// use the pointer version as a “worker function”
+	releaseLock(inReference, &dummyPtr);
+}// releaseLock
+
+
+template < typename structure_reference_type, typename structure_type, bool debugged >
+void
+MemoryBlockReferenceTable< structure_reference_type, structure_type, debugged >::
+releaseLock	(structure_reference_type	inReference,
+			 structure_type**			inoutPtrPtr)
+{
+	std::lock_guard< std::mutex >	slotsLock(_slotsLock);
+	Slot*							slotPtr = returnSlot(inReference);
+	
+	
+	if (nullptr != slotPtr)
+	{
+		assert(slotPtr->lockCount > 0);
+		if (slotPtr->lockCount > 0)
+		{
+			--(slotPtr->lockCount);
+		}
+		if (debugged)
+		{
+			// log that a lock was released, and show where the release came from
+			this->logLockState("released lock", inReference, slotPtr->lockCount);
+		}
+	}
+	if (nullptr != inoutPtrPtr) *inoutPtrPtr = nullptr;
+}// releaseLock
+
+
+template < typename structure_reference_type, typename structure_type, bool debugged >
+UInt16
+MemoryBlockReferenceTable< structure_reference_type, structure_type, debugged >::
+returnLockCount		(structure_reference_type	inReference)
+const
+{
+	std::lock_guard< std::mutex >	slotsLock(_slotsLock);
+	UInt16							result = 0;
+	Slot*							slotPtr = returnSlot(inReference);
+	
+	
+	if (nullptr != slotPtr)
+	{
+		result = slotPtr->lockCount;
+	}
+	return result;
+}// returnLockCount
+
+
+template < typename structure_reference_type, typename structure_type, bool debugged >
+structure_type*
+MemoryBlockReferenceTable< structure_reference_type, structure_type, debugged >::
+returnPointer	(structure_reference_type	inReference)
+const
+{
+	std::lock_guard< std::mutex >	slotsLock(_slotsLock);
+	structure_type*					result = nullptr;
+	Slot*							slotPtr = returnSlot(inReference);
+	
+	
+	if (nullptr != slotPtr)
+	{
+		result = slotPtr->structurePtr;
+	}
+	return result;
+}// returnPointer
+
+
+/*!
+Tests an instance of this template class.  Returns true only
+if successful.  Information on failures is printed to the
+console.
+
+(2017.10)
+*/
+template < typename structure_reference_type, typename structure_type, bool debugged >
+Boolean
+MemoryBlockReferenceTable< structure_reference_type, structure_type, debugged >::
+unitTest ()
+{
+	typedef LockAcquireRelease< structure_reference_type, structure_type, debugged >			TestAutoLockerClass;
+	typedef MemoryBlockReferenceTable< structure_reference_type, structure_type, debugged >		TestTableClass;
+	Boolean		result = true;
+	
+	
+	// references, locking and reuse of slots
+	{
+		TestTableClass				table;
+		structure_type				data1;
+		structure_type				data2;
+		structure_reference_type	ref1 = table.insert(&data1);
+		structure_reference_type	ref2 = table.insert(&data2);
+		structure_reference_type	ref3 = nullptr;
+		
+		
+		result &= Console_Assert("ref1 is not nullptr", nullptr != ref1);
+		result &= Console_Assert("ref2 is not nullptr", nullptr != ref2);
+		result &= Console_Assert("references are different", ref1 != ref2);
+		result &= Console_Assert("ref1 is valid", table.isValid(ref1));
+		result &= Console_Assert("nullptr is not valid", false == table.isValid(nullptr));
+		result &= Console_Assert("ref1 resolves to data1", &data1 == table.returnPointer(ref1));
+		result &= Console_Assert("ref2 resolves to data2", &data2 == table.returnPointer(ref2));
+		result &= Console_Assert("initial lock count of zero for ref1", !table.isLocked(ref1));
+		{
+			TestAutoLockerClass		ptr1(table, ref1);
+			
+			
+			result &= Console_Assert("auto-lock resolves to data1", &data1 == &*ptr1);
+			result &= Console_Assert("lock count is up to one for ref1", 1 == table.returnLockCount(ref1));
+			{
+				TestAutoLockerClass		alsoPtr1(table, ref1);
+				
+				
+				result &= Console_Assert("lock count is up to two for ref1", 2 == table.returnLockCount(ref1));
+			}
+			result &= Console_Assert("lock count is down to one for ref1", 1 == table.returnLockCount(ref1));
+			result &= Console_Assert("lock count is zero for ref2", 0 == table.returnLockCount(ref2));
+		}
+		result &= Console_Assert("lock count is down to zero for ref1", 0 == table.returnLockCount(ref1));
+		
+		table.erase(ref1);
+		result &= Console_Assert("erased ref1 is not valid", false == table.isValid(ref1));
+		result &= Console_Assert("ref2 is still valid", table.isValid(ref2));
+		ref3 = table.insert(&data1);
+		result &= Console_Assert("slot reuse does not revive the old reference", ref1 != ref3);
+		result &= Console_Assert("stale ref1 is still not valid", false == table.isValid(ref1));
+		result &= Console_Assert("ref3 resolves to data1", &data1 == table.returnPointer(ref3));
+		table.erase(ref2);
+		table.erase(ref3);
+		result &= Console_Assert("erased ref3 is not valid", false == table.isValid(ref3));
+	}
+	
+	return result;
+}// unitTest
+
+
+template < typename structure_reference_type, typename structure_type, bool debugged >
+MemoryBlockReferenceTableRegistrar< structure_reference_type, structure_type, debugged >::
+MemoryBlockReferenceTableRegistrar	(structure_type*	inStructurePtr,
+									 TableType&			inoutTable)
+:
+_table(inoutTable),
+_ref(inoutTable.insert(inStructurePtr))
+{
+}// MemoryBlockReferenceTableRegistrar 2-argument constructor
+
+
+template < typename structure_reference_type, typename structure_type, bool debugged >
+MemoryBlockReferenceTableRegistrar< structure_reference_type, structure_type, debugged >::
+~MemoryBlockReferenceTableRegistrar ()
+{
+	_table.erase(_ref);
+}// MemoryBlockReferenceTableRegistrar destructor
+
+
+template < typename structure_reference_type, typename structure_type, bool debugged >
+structure_reference_type
+MemoryBlockReferenceTableRegistrar< structure_reference_type, structure_type, debugged >::
+returnReference ()
+const
+{
+	return _ref;
+}// returnReference
+
+
+#pragma mark Internal Methods
+
+/*!
+Implements isValid(), for methods that already hold the
+lock on the slots.
+
+(2017.10)
+*/
+template < typename structure_reference_type, typename structure_type, bool debugged >
+bool
+MemoryBlockReferenceTable< structure_reference_type, structure_type, debugged >::
+isValidUnlocked		(structure_reference_type	inReference)
+const
+{
+	uintptr_t const		kValue = REINTERPRET_CAST(inReference, uintptr_t);
+	uintptr_t const		kIndexPlusOne = (kValue & kIndexMask);
+	bool				result = false;
+	
+	
+	if ((kIndexPlusOne > 0) && (kIndexPlusOne <= _slots.size()))
+	{
+		Slot const&		kSlot = _slots[kIndexPlusOne - 1];
+		
+		
+		result = ((nullptr != kSlot.structurePtr) &&
+					(((kSlot.generation << kIndexBitCount) | kIndexPlusOne) == kValue));
+	}
+	return result;
+}// isValidUnlocked
+
+
+/*!
+Returns the slot for the given reference, or nullptr if
+the reference is not valid.  In debug builds, any invalid
+reference other than nullptr (typically a reference to a
+structure that has since been destroyed) logs a warning.
+
+(2017.10)
+*/
+template < typename structure_reference_type, typename structure_type, bool debugged >
+typename MemoryBlockReferenceTable< structure_reference_type, structure_type, debugged >::Slot*
+MemoryBlockReferenceTable< structure_reference_type, structure_type, debugged >::
+returnSlot	(structure_reference_type	inReference)
+const
+{
+	Slot*		result = nullptr;
+	
+	
+	if (isValidUnlocked(inReference))
+	{
+		result = CONST_CAST(&_slots[(REINTERPRET_CAST(inReference, uintptr_t) & kIndexMask) - 1], Slot*);
+	}
+#ifndef NDEBUG
+	else if (nullptr != inReference)
+	{
+		Console_Warning(Console_WriteValueAddress, "stale or invalid reference", inReference);
+	}
+#endif
+	return result;
+}// returnSlot
+
+// BELOW IS REQUIRED NEWLINE TO END FILE
@@ -0,0 +1,460 @@
+/*!	\file ScriptHostProtocol.cp
+	\brief The binary protocol spoken between MacTerm and an
+	out-of-process scripting host, over a local socket.
+*/
+/*###############################################################
+
+	MacTerm
+		© 1998-2017 by Kevin Grant.
+		© 2001-2003 by Ian Anderson.
+		© 1986-1994 University of Illinois Board of Trustees
+		(see About box for full list of U of I contributors).
+	
+	This program is free software; you can redistribute it or
+	modify it under the terms of the GNU General Public License
+	as published by the Free Software Foundation; either version
+	2 of the License, or (at your option) any later version.
+	
+	This program is distributed in the hope that it will be
+	useful, but WITHOUT ANY WARRANTY; without even the implied
+	warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR
+	PURPOSE.  See the GNU General Public License for more
+	details.
+	
+	You should have received a copy of the GNU General Public
+	License along with this program; if not, write to:
+	
+		Free Software Foundation, Inc.
+		59 Temple Place, Suite 330
+		Boston, MA  02111-1307
+		USA
+
+###############################################################*/
+
+#include "ScriptHostProtocol.h"
+#include <UniversalDefines.h>
+
+// standard-C includes
+#include <cstring>
+
+// standard-C++ includes
+#include <algorithm>
+#include <vector>
+
+// Mac includes
+#include <CoreServices/CoreServices.h>
+
+
+
+#pragma mark Internal Method Prototypes
+namespace {
+
+UInt32		decodeUInt32	(UInt8 const*);
+void		encodeUInt32	(UInt8*, UInt32);
+
+} // anonymous namespace
+
+
+
+#pragma mark Public Methods
+
+/*!
+Constructor.  Appends the header of a frame with the given
+type and request ID to the buffer; the payload length is
+set by finish().
+
+(2017.10)
+*/
+ScriptHostProtocol_Writer::
+ScriptHostProtocol_Writer	(std::vector< UInt8 >&	inoutBuffer,
+							 UInt16					inType,
+							 UInt32					inRequestID)
+:
+_buffer(inoutBuffer),
+_frameOffset(inoutBuffer.size())
+{
+	appendUInt32(0); // length is set by finish()
+	appendUInt16(inType);
+	appendUInt16(0); // reserved
+	appendUInt32(inRequestID);
+}// ScriptHostProtocol_Writer 3-argument constructor
+
+
+/*!
+Appends raw bytes to the payload.
+
+(2017.10)
+*/
+void
+ScriptHostProtocol_Writer::
+appendBytes		(void const*	inBytes,
+				 size_t			inByteCount)
+{
+	UInt8 const*	bytePtr = REINTERPRET_CAST(inBytes, UInt8 const*);
+	
+	
+	_buffer.insert(_buffer.end(), bytePtr, bytePtr + inByteCount);
+}// appendBytes
+
+
+/*!
+Appends a “counted” field: the byte count as an unsigned
+32-bit integer, followed by the bytes.
+
+(2017.10)
+*/
+void
+ScriptHostProtocol_Writer::
+appendCountedBytes	(void const*	inBytes,
+					 UInt32			inByteCount)
+{
+	appendUInt32(inByteCount);
+	appendBytes(inBytes, inByteCount);
+}// appendCountedBytes
+
+
+/*!
+Appends a signed 32-bit integer to the payload.
+
+(2017.10)
+*/
+void
+ScriptHostProtocol_Writer::
+appendSInt32	(SInt32		inValue)
+{
+	appendUInt32(STATIC_CAST(inValue, UInt32));
+}// appendSInt32
+
+
+/*!
+Appends an unsigned 16-bit integer to the payload.
+
+(2017.10)
+*/
+void
+ScriptHostProtocol_Writer::
+appendUInt16	(UInt16		inValue)
+{
+	_buffer.push_back(STATIC_CAST(inValue & 0xFF, UInt8));
+	_buffer.push_back(STATIC_CAST(inValue >> 8, UInt8));
+}// appendUInt16
+
+
+/*!
+Appends an unsigned 32-bit integer to the payload.
+
+(2017.10)
+*/
+void
+ScriptHostProtocol_Writer::
+appendUInt32	(UInt32		inValue)
+{
+	UInt8	bytes[4];
+	
+	
+	encodeUInt32(bytes, inValue);
+	_buffer.insert(_buffer.end(), bytes, bytes + sizeof(bytes));
+}// appendUInt32
+
+
+/*!
+Appends one byte to the payload.
+
+(2017.10)
+*/
+void
+ScriptHostProtocol_Writer::
+appendUInt8		(UInt8		inValue)
+{
+	_buffer.push_back(inValue);
+}// appendUInt8
+
+
+/*!
+Stores the length of everything appended since construction
+in the header of the frame.
+
+(2017.10)
+*/
+void
+ScriptHostProtocol_Writer::
+finish ()
+{
+	size_t const	kPayloadSize = _buffer.size() - _frameOffset - kScriptHostProtocol_HeaderSize;
+	
+	
+	encodeUInt32(_buffer.data() + _frameOffset, STATIC_CAST(kPayloadSize, UInt32));
+}// finish
+
+
+/*!
+Constructor.  The payload must remain valid (and unchanged)
+for the lifetime of the reader.
+
+(2017.10)
+*/
+ScriptHostProtocol_Reader::
+ScriptHostProtocol_Reader	(std::vector< UInt8 > const&	inPayload)
+:
+_payload(inPayload),
+_offset(0)
+{
+}// ScriptHostProtocol_Reader 1-argument constructor
+
+
+/*!
+Reads a “counted” field, returning the location of its bytes
+(which remain owned by the payload) and their count.  Nothing
+is consumed unless the entire field is present.
+
+(2017.10)
+*/
+Boolean
+ScriptHostProtocol_Reader::
+readCountedBytes	(UInt8 const*&	outBytes,
+					 UInt32&		outByteCount)
+{
+	Boolean		result = ((_payload.size() - _offset) >= 4);
+	
+	
+	if (result)
+	{
+		UInt32 const	kByteCount = decodeUInt32(_payload.data() + _offset);
+		
+		
+		result = ((_payload.size() - _offset - 4) >= kByteCount);
+		if (result)
+		{
+			outBytes = _payload.data() + _offset + 4;
+			outByteCount = kByteCount;
+			_offset += (4 + kByteCount);
+		}
+	}
+	return result;
+}// readCountedBytes
+
+
+/*!
+Reads a signed 32-bit integer.
+
+(2017.10)
+*/
+Boolean
+ScriptHostProtocol_Reader::
+readSInt32	(SInt32&	outValue)
+{
+	UInt32		asUnsigned = 0;
+	Boolean		result = readUInt32(asUnsigned);
+	
+	
+	if (result)
+	{
+		outValue = STATIC_CAST(asUnsigned, SInt32);
+	}
+	return result;
+}// readSInt32
+
+
+/*!
+Reads an unsigned 16-bit integer.
+
+(2017.10)
+*/
+Boolean
+ScriptHostProtocol_Reader::
+readUInt16	(UInt16&	outValue)
+{
+	Boolean		result = ((_payload.size() - _offset) >= 2);
+	
+	
+	if (result)
+	{
+		outValue = STATIC_CAST(_payload[_offset] | (_payload[_offset + 1] << 8), UInt16);
+		_offset += 2;
+	}
+	return result;
+}// readUInt16
+
+
+/*!
+Reads an unsigned 32-bit integer.
+
+(2017.10)
+*/
+Boolean
+ScriptHostProtocol_Reader::
+readUInt32	(UInt32&	outValue)
+{
+	Boolean		result = ((_payload.size() - _offset) >= 4);
+	
+	
+	if (result)
+	{
+		outValue = decodeUInt32(_payload.data() + _offset);
+		_offset += 4;
+	}
+	return result;
+}// readUInt32
+
+
+/*!
+Reads one byte.
+
+(2017.10)
+*/
+Boolean
+ScriptHostProtocol_Reader::
+readUInt8	(UInt8&		outValue)
+{
+	Boolean		result = (_payload.size() > _offset);
+	
+	
+	if (result)
+	{
+		outValue = _payload[_offset];
+		++_offset;
+	}
+	return result;
+}// readUInt8
+
+
+/*!
+Returns the location of the first unread byte, and sets the
+count to the number of unread bytes.  All of those bytes are
+then considered to be read.
+
+(2017.10)
+*/
+UInt8 const*
+ScriptHostProtocol_Reader::
+returnRemainingBytes	(size_t&	outByteCount)
+{
+	UInt8 const*	result = _payload.data() + _offset;
+	
+	
+	outByteCount = _payload.size() - _offset;
+	_offset = _payload.size();
+	return result;
+}// returnRemainingBytes
+
+
+/*!
+Constructor.
+
+(2017.10)
+*/
+ScriptHostProtocol_FrameParser::
+ScriptHostProtocol_FrameParser ()
+:
+_buffer(),
+_offset(0),
+_isCorrupt(false)
+{
+}// ScriptHostProtocol_FrameParser default constructor
+
+
+/*!
+Adds bytes to the stream.  Space used by frames that were
+already returned is reclaimed first, so the buffer does not
+grow without bound on a long-lived connection.
+
+(2017.10)
+*/
+void
+ScriptHostProtocol_FrameParser::
+appendBytes		(UInt8 const*	inBytes,
+				 size_t			inByteCount)
+{
+	if (_offset > 0)
+	{
+		_buffer.erase(_buffer.begin(), _buffer.begin() + _offset);
+		_offset = 0;
+	}
+	_buffer.insert(_buffer.end(), inBytes, inBytes + inByteCount);
+}// appendBytes
+
+
+/*!
+If the stream contains at least one complete frame, removes
+the first one (copying it into the given structure) and
+returns true.  Otherwise, returns false and leaves the frame
+unchanged.
+
+Once the parser is corrupt (see isCorrupt()), this always
+returns false.
+
+(2017.10)
+*/
+Boolean
+ScriptHostProtocol_FrameParser::
+nextFrame	(ScriptHostProtocol_Frame&		outFrame)
+{
+	Boolean		result = false;
+	
+	
+	if ((false == _isCorrupt) && ((_buffer.size() - _offset) >= kScriptHostProtocol_HeaderSize))
+	{
+		UInt8 const*	headerPtr = _buffer.data() + _offset;
+		UInt32 const	kPayloadSize = decodeUInt32(headerPtr);
+		
+		
+		if (kPayloadSize > kScriptHostProtocol_MaximumPayloadSize)
+		{
+			_isCorrupt = true;
+		}
+		else if ((_buffer.size() - _offset - kScriptHostProtocol_HeaderSize) >= kPayloadSize)
+		{
+			UInt8 const*	payloadPtr = headerPtr + kScriptHostProtocol_HeaderSize;
+			
+			
+			outFrame.type = STATIC_CAST(headerPtr[4] | (headerPtr[5] << 8), UInt16);
+			outFrame.requestID = decodeUInt32(headerPtr + 8);
+			outFrame.payload.assign(payloadPtr, payloadPtr + kPayloadSize);
+			_offset += (kScriptHostProtocol_HeaderSize + kPayloadSize);
+			result = true;
+		}
+	}
+	return result;
+}// nextFrame
+
+
+#pragma mark Internal Methods
+namespace {
+
+/*!
+Returns the little-endian 32-bit integer at the given location.
+
+(2017.10)
+*/
+UInt32
+decodeUInt32	(UInt8 const*	inBytes)
+{
+	UInt32		result = (STATIC_CAST(inBytes[0], UInt32) |
+							(STATIC_CAST(inBytes[1], UInt32) << 8) |
+							(STATIC_CAST(inBytes[2], UInt32) << 16) |
+							(STATIC_CAST(inBytes[3], UInt32) << 24));
+	
+	
+	return result;
+}// decodeUInt32
+
+
+/*!
+Writes a 32-bit integer in little-endian order to the 4 bytes
+at the given location.
+
+(2017.10)
+*/
+void
+encodeUInt32	(UInt8*		outBytes,
+				 UInt32		inValue)
+{
+	outBytes[0] = STATIC_CAST(inValue & 0xFF, UInt8);
+	outBytes[1] = STATIC_CAST((inValue >> 8) & 0xFF, UInt8);
+	outBytes[2] = STATIC_CAST((inValue >> 16) & 0xFF, UInt8);
+	outBytes[3] = STATIC_CAST((inValue >> 24) & 0xFF, UInt8);
+}// encodeUInt32
+
+} // anonymous namespace
+
+// BELOW IS REQUIRED NEWLINE TO END FILE
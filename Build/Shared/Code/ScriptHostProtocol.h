@@ -0,0 +1,274 @@
+/*!	\file ScriptHostProtocol.h
+	\brief The binary protocol spoken between MacTerm and an
+	out-of-process scripting host, over a local socket.
+	
+	Every message is a frame: a fixed-size header followed by
+	a payload whose layout depends on the message type.  The
+	header holds the payload length (UInt32), the message type
+	(UInt16), a reserved field (UInt16) and a request ID
+	(UInt32); all integers are little-endian.  A client may
+	send any number of requests without waiting, and each
+	reply or error carries the ID of the request it answers.
+	Events are unsolicited and always have request ID 0; the
+	host only sends an event when the client has granted it
+	credit (see "kScriptHostProtocol_MessageGrantCredit"), so
+	a slow client is never flooded.
+*/
+/*###############################################################
+
+	MacTerm
+		© 1998-2017 by Kevin Grant.
+		© 2001-2003 by Ian Anderson.
+		© 1986-1994 University of Illinois Board of Trustees
+		(see About box for full list of U of I contributors).
+	
+	This program is free software; you can redistribute it or
+	modify it under the terms of the GNU General Public License
+	as published by the Free Software Foundation; either version
+	2 of the License, or (at your option) any later version.
+	
+	This program is distributed in the hope that it will be
+	useful, but WITHOUT ANY WARRANTY; without even the implied
+	warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR
+	PURPOSE.  See the GNU General Public License for more
+	details.
+	
+	You should have received a copy of the GNU General Public
+	License along with this program; if not, write to:
+	
+		Free Software Foundation, Inc.
+		59 Temple Place, Suite 330
+		Boston, MA  02111-1307
+		USA
+
+###############################################################*/
+
+#pragma once
+
+// standard-C++ includes
+#include <vector>
+
+// Mac includes
+#include <CoreServices/CoreServices.h>
+
+
+
+#pragma mark Constants
+
+UInt16 const	kScriptHostProtocol_Version = 1;				//!< sent in "kScriptHostProtocol_MessageHello"; must match
+size_t const	kScriptHostProtocol_HeaderSize = 12;			//!< bytes before the payload of every frame
+UInt32 const	kScriptHostProtocol_MaximumPayloadSize = (16 * 1024 * 1024);	//!< larger frames are considered corrupt
+
+/*!
+The type of a frame, which determines its payload.  Types with
+the high bit set are only sent by the host.  A “counted” field
+is a UInt32 byte count followed by that many bytes of UTF-8.
+*/
+enum ScriptHostProtocol_MessageType : UInt16
+{
+	// client to host
+	kScriptHostProtocol_MessageHello				= 0x0001,	//!< must be first; payload: UInt16 version, UInt32 initial event credit;
+																//!  reply: UInt16 version
+	kScriptHostProtocol_MessageGrantCredit			= 0x0002,	//!< payload: UInt32 number of additional events the client will
+																//!  accept; there is no reply
+	kScriptHostProtocol_MessageListSessions			= 0x0003,	//!< payload: none; reply: UInt32 count, then each UInt32 session ID
+	kScriptHostProtocol_MessageWatchLines			= 0x0004,	//!< payload: UInt32 session ID, UInt8 nonzero to start or 0 to stop
+																//!  “lines changed” events; reply: empty
+	kScriptHostProtocol_MessageReadLines			= 0x0005,	//!< payload: UInt32 session ID, SInt32 first line (negative for
+																//!  scrollback), UInt32 line count; reply: UTF-8 text with a
+																//!  new-line after each line (range is clipped to the lines
+																//!  that exist, and to whole lines that fit in one frame)
+	kScriptHostProtocol_MessageInjectInput			= 0x0006,	//!< payload: UInt32 session ID, then UTF-8 text to handle as if
+																//!  typed by the user; reply: empty
+	kScriptHostProtocol_MessageSpawnHeadless		= 0x0007,	//!< payload: UInt16 columns, UInt16 rows (0 for defaults), UInt32
+																//!  scrollback rows, counted working directory (empty for
+																//!  default), UInt32 argument count, then each counted argument;
+																//!  reply: UInt32 ID of a new session that has no window (a
+																//!  screen over 256 columns or 512 rows is a malformed payload;
+																//!  scrollback is reduced to at most 65535 rows)
+	kScriptHostProtocol_MessageCloseSession			= 0x0008,	//!< payload: UInt32 session ID (must be headless); reply: empty
+	kScriptHostProtocol_MessageWatchScreen			= 0x0009,	//!< payload: UInt32 session ID, UInt8 0 to stop, 1 to start or 2
+																//!  to start over (resynchronize) “screen update” events; the
+																//!  first update after starting is a snapshot; reply: empty
+	// host to client
+	kScriptHostProtocol_MessageReply				= 0x8001,	//!< payload: depends on the request that has the same ID
+	kScriptHostProtocol_MessageError				= 0x8002,	//!< payload: UInt32 error code, then a UTF-8 description
+	kScriptHostProtocol_MessageEventSessionOpened	= 0x8101,	//!< payload: UInt32 session ID
+	kScriptHostProtocol_MessageEventSessionClosed	= 0x8102,	//!< payload: UInt32 session ID
+	kScriptHostProtocol_MessageEventLinesChanged	= 0x8103,	//!< payload: UInt32 session ID, UInt32 count, then each SInt32
+																//!  line number (ascending, no duplicates; see "ReadLines")
+	kScriptHostProtocol_MessageEventScreenUpdate	= 0x8104,	//!< payload: see "kScriptHostProtocol_ScreenUpdateFlagSnapshot"
+};
+
+/*!
+Bits in the flags of "kScriptHostProtocol_MessageEventScreenUpdate".
+
+The payload of a screen update is: UInt32 session ID, UInt8
+flags, UInt16 columns, UInt16 rows, SInt32 scroll delta,
+UInt16 cursor column, UInt16 cursor row, UInt16 attribute
+count, then each attribute as UInt32 upper and UInt32 lower
+bits; then UInt16 row count, and for each row a UInt16 row
+number and UInt16 run count followed by each run: UInt16
+first column, UInt16 column count, UInt16 index into the
+attributes, and counted text (empty if the cells are blank).
+
+A viewer applies the scroll first (content moves up by the
+delta if it is negative, or down if it is positive, and
+vacated rows are blank), and then replaces each given row
+entirely with its runs.  Rows that are not given are not
+changed.
+*/
+enum ScriptHostProtocol_ScreenUpdateFlags : UInt8
+{
+	kScriptHostProtocol_ScreenUpdateFlagSnapshot		= (1 << 0),	//!< the viewer must discard its copy, resize it and
+																	//!  apply every row (the scroll delta is 0)
+	kScriptHostProtocol_ScreenUpdateFlagCursorVisible	= (1 << 1),	//!< the cursor is shown at its location
+};
+
+/*!
+Codes in the payload of "kScriptHostProtocol_MessageError".
+*/
+enum ScriptHostProtocol_ErrorCode : UInt32
+{
+	kScriptHostProtocol_ErrorUnknownMessage			= 1,	//!< the message type is not a request that the host understands
+	kScriptHostProtocol_ErrorMalformedPayload		= 2,	//!< the payload is too short or too long for its message type
+	kScriptHostProtocol_ErrorNotGreeted				= 3,	//!< no successful "kScriptHostProtocol_MessageHello" was received yet
+	kScriptHostProtocol_ErrorVersionMismatch		= 4,	//!< the client speaks an unsupported protocol version
+	kScriptHostProtocol_ErrorNoSuchSession			= 5,	//!< the session ID does not refer to an open session
+	kScriptHostProtocol_ErrorOperationFailed		= 6,	//!< the request was valid but could not be completed
+	kScriptHostProtocol_ErrorNotHeadless			= 7,	//!< the session has a window, so only the user can close it
+};
+
+#pragma mark Types
+
+/*!
+A complete frame, as returned by a parser.
+*/
+struct ScriptHostProtocol_Frame
+{
+	UInt16					type;			//!< usually a ScriptHostProtocol_MessageType
+	UInt32					requestID;		//!< matches replies to requests; 0 for events
+	std::vector< UInt8 >	payload;		//!< type-specific data (might be empty)
+};
+
+/*!
+Appends one frame to a buffer: the header is written when the
+writer is constructed, the payload is added with the append
+methods, and finish() fills in the payload length.  Since the
+buffer is exposed, bulk data (such as exported text) can be
+written into the payload without an intermediate copy.
+*/
+class ScriptHostProtocol_Writer
+{
+public:
+	ScriptHostProtocol_Writer	(std::vector< UInt8 >&, UInt16, UInt32);
+	
+	void
+	appendBytes		(void const*, size_t);
+	
+	//! Appends a UInt32 byte count and then the bytes.
+	void
+	appendCountedBytes	(void const*, UInt32);
+	
+	void
+	appendSInt32	(SInt32);
+	
+	void
+	appendUInt16	(UInt16);
+	
+	void
+	appendUInt32	(UInt32);
+	
+	void
+	appendUInt8		(UInt8);
+	
+	//! Sets the payload length in the header; call once, after the last append.
+	void
+	finish ();
+	
+	//! Returns the buffer, for direct appends to the payload.
+	std::vector< UInt8 >&
+	returnBuffer ()
+	{
+		return _buffer;
+	}
+
+private:
+	std::vector< UInt8 >&	_buffer;		//!< where the frame is written
+	size_t					_frameOffset;	//!< index in the buffer of the first header byte
+};
+
+/*!
+Reads fields from a payload in order.  Each read returns false
+(and consumes nothing) if not enough bytes remain.
+*/
+class ScriptHostProtocol_Reader
+{
+public:
+	ScriptHostProtocol_Reader	(std::vector< UInt8 > const&);
+	
+	//! Returns true only if every byte has been read.
+	Boolean
+	isAtEnd () const
+	{
+		return (_offset == _payload.size());
+	}
+	
+	//! Reads a UInt32 byte count and returns the location of that many bytes.
+	Boolean
+	readCountedBytes	(UInt8 const*&, UInt32&);
+	
+	Boolean
+	readSInt32	(SInt32&);
+	
+	Boolean
+	readUInt16	(UInt16&);
+	
+	Boolean
+	readUInt32	(UInt32&);
+	
+	Boolean
+	readUInt8	(UInt8&);
+	
+	//! Consumes all remaining bytes, returning their location and count.
+	UInt8 const*
+	returnRemainingBytes	(size_t&);
+
+private:
+	std::vector< UInt8 > const&		_payload;	//!< data being read
+	size_t							_offset;	//!< index of the next unread byte
+};
+
+/*!
+Divides a stream of bytes into frames.  Bytes can be given
+in pieces of any size (for instance, exactly as they arrive
+from a socket) and any number of frames can be buffered, so
+that pipelined requests are handled in order.
+*/
+class ScriptHostProtocol_FrameParser
+{
+public:
+	ScriptHostProtocol_FrameParser ();
+	
+	//! Adds bytes to the end of the stream.
+	void
+	appendBytes		(UInt8 const*, size_t);
+	
+	//! Returns true only if a frame declared an impossible length; the stream cannot be recovered.
+	Boolean
+	isCorrupt () const
+	{
+		return _isCorrupt;
+	}
+	
+	//! Removes the next complete frame; returns false if there is none yet.
+	Boolean
+	nextFrame	(ScriptHostProtocol_Frame&);
+
+private:
+	std::vector< UInt8 >	_buffer;		//!< bytes received but not yet returned in a frame
+	size_t					_offset;		//!< index in the buffer of the next frame header
+	Boolean					_isCorrupt;		//!< see isCorrupt()
+};
+
+// BELOW IS REQUIRED NEWLINE TO END FILE
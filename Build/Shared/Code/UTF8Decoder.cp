@@ -29,6 +29,17 @@
 #include "UTF8Decoder.h"
 #include <UniversalDefines.h>
 
+// standard-C includes
+#include <cstdlib>
+#include <cstring>
+#if defined(__SSE2__)
+#	include <emmintrin.h>
+#endif
+
+// standard-C++ includes
+#include <algorithm>
+#include <vector>
+
 // Mac includes
 #include <ApplicationServices/ApplicationServices.h>
 #include <CoreServices/CoreServices.h>
@@ -38,8 +49,45 @@
 
 
 
+#pragma mark Internal Method Prototypes
+namespace {
+
+size_t		countLeadingSingleByteGlyphs		(UInt8 const*, size_t);
+UInt32		decodeByteByByte					(UTF8Decoder_StateMachine&, UInt8 const*, size_t,
+												 UTF8Decoder_CodePointList&);
+Boolean		unitTest_AppendCodePoints_000		();
+Boolean		unitTest_AppendCodePoints_001		();
+
+} // anonymous namespace
+
+
+
 #pragma mark Public Methods
 
+/*!
+A unit test for this module.  This should always
+be run before a release, after any substantial
+changes are made, or if you suspect bugs!  It
+should also be EXPANDED as new functionality is
+proposed (ideally, a test is written before the
+functionality is added).
+
+(2017.10)
+*/
+void
+UTF8Decoder_RunTests ()
+{
+	UInt16		totalTests = 0;
+	UInt16		failedTests = 0;
+	
+	
+	++totalTests; if (false == unitTest_AppendCodePoints_000()) ++failedTests;
+	++totalTests; if (false == unitTest_AppendCodePoints_001()) ++failedTests;
+	
+	Console_WriteUnitTestReport("UTF-8 Decoder", failedTests, totalTests);
+}// RunTests
+
+
 /*!
 Constructor.
 
@@ -55,6 +103,121 @@ currentState(kStateInitial)
 }// UTF8Decoder_StateMachine default constructor
 
 
+/*!
+Decodes an entire buffer of bytes at once, appending every
+complete code point to the given list and returning the
+number of errors found.  Each error also appends the value
+"kUTF8Decoder_ErrorCodePoint" at the point where it occurred,
+so the result is exactly what a caller would see by passing
+each byte to nextState(), inserting one error character per
+counted error and calling reset() after each valid sequence.
+
+A sequence that is still incomplete at the end of the buffer
+is held in "multiByteAccumulator", and the next call (or a
+subsequent call to nextState()) continues it; a stream can
+therefore be split anywhere without changing the result.  If
+the machine has a completed sequence that was never reset,
+that sequence is discarded first.
+
+Runs of single-byte glyphs are scanned a block at a time and
+well-formed sequences of 2-4 bytes are decoded in place, so
+most bytes are never examined by the state machine; anything
+else (notably, every possible error) is given to nextState()
+so that the two paths cannot disagree.
+
+(2017.10)
+*/
+UInt32
+UTF8Decoder_StateMachine::
+appendCodePoints	(UInt8 const*					inBytes,
+					 size_t							inByteCount,
+					 UTF8Decoder_CodePointList&		inoutCodePoints)
+{
+	UInt8 const*		ptr = inBytes;
+	UInt8 const* const	kPastEnd = inBytes + inByteCount;
+	UInt32				result = 0;
+	
+	
+	if (kStateUTF8ValidSequence == this->currentState)
+	{
+		this->reset();
+	}
+	
+	inoutCodePoints.reserve(inoutCodePoints.size() + inByteCount);
+	while (ptr != kPastEnd)
+	{
+		size_t		sequenceLength = 0;
+		
+		
+		if (this->multiByteAccumulator.empty())
+		{
+			// between sequences, the most common case is plain ASCII
+			sequenceLength = countLeadingSingleByteGlyphs(ptr, kPastEnd - ptr);
+			if (sequenceLength > 0)
+			{
+				inoutCodePoints.insert(inoutCodePoints.end(), ptr, ptr + sequenceLength);
+			}
+			else
+			{
+				// if an entire sequence is available and decodes to a
+				// valid code point, it can be appended without updating
+				// the state machine (see nextState() for the rules)
+				size_t const		kAvailableBytes = kPastEnd - ptr;
+				UnicodeScalarValue	codePoint = kUTF8Decoder_InvalidUnicodeCodePoint;
+				
+				
+				if (isFirstOfTwo(ptr[0]) && (kAvailableBytes >= 2) && isContinuationByte(ptr[1]))
+				{
+					if ((0xC0 != ptr[0]) && (0xC1 != ptr[0]))
+					{
+						codePoint = byteSequenceTotalValue(ptr, 0, 2);
+						sequenceLength = 2;
+					}
+				}
+				else if (isFirstOfThree(ptr[0]) && (kAvailableBytes >= 3) && isContinuationByte(ptr[1]) &&
+							isContinuationByte(ptr[2]))
+				{
+					codePoint = byteSequenceTotalValue(ptr, 0, 3);
+					unless (((0xE0 == ptr[0]) && (codePoint <= 0x07FF)) ||
+							((codePoint >= 0xD800) && (codePoint <= 0xDFFF)))
+					{
+						sequenceLength = 3;
+					}
+				}
+				else if (isFirstOfFour(ptr[0]) && (kAvailableBytes >= 4) && isContinuationByte(ptr[1]) &&
+							isContinuationByte(ptr[2]) && isContinuationByte(ptr[3]))
+				{
+					codePoint = byteSequenceTotalValue(ptr, 0, 4);
+					unless (((0xF0 == ptr[0]) && (codePoint <= 0xFFFF)) ||
+							(codePoint >= 0x10FFFF))
+					{
+						sequenceLength = 4;
+					}
+				}
+				
+				if (sequenceLength > 0)
+				{
+					inoutCodePoints.push_back(codePoint);
+				}
+			}
+		}
+		
+		if (sequenceLength > 0)
+		{
+			ptr += sequenceLength;
+			this->currentState = kStateInitial;
+		}
+		else
+		{
+			// incomplete, unusual or illegal sequence; decode one byte
+			result += decodeByteByByte(*this, ptr, 1, inoutCodePoints);
+			++ptr;
+		}
+	}
+	return result;
+}// UTF8Decoder_StateMachine::appendCodePoints
+
+
 /*!
 Returns true only if the current sequence of bytes is
 incomplete.
@@ -353,4 +516,270 @@ nextState	(UInt8		inNextByte,
 	//Console_WriteValue("                      UTF-8 next state", this->currentState);
 }// UTF8Decoder_StateMachine::nextState
 
+
+#pragma mark Internal Methods
+namespace {
+
+/*!
+Returns the number of bytes at the start of the given buffer
+that are complete code points by themselves (ASCII).  Where
+the processor allows it, 16 bytes are examined at once.
+
+(2017.10)
+*/
+size_t
+countLeadingSingleByteGlyphs	(UInt8 const*	inBytes,
+								 size_t			inByteCount)
+{
+	size_t		result = 0;
+	
+	
+#if defined(__SSE2__)
+	// the high bit of each byte is gathered into a mask that
+	// is zero only if all of the bytes are single-byte glyphs
+	while ((inByteCount - result) >= sizeof(__m128i))
+	{
+		__m128i const	kBlock = _mm_loadu_si128(REINTERPRET_CAST(inBytes + result, __m128i const*));
+		
+		
+		if (0 != _mm_movemask_epi8(kBlock))
+		{
+			break;
+		}
+		result += sizeof(__m128i);
+	}
+#else
+	// otherwise the same test is done on a machine word at a time
+	while ((inByteCount - result) >= sizeof(UInt64))
+	{
+		UInt64		block = 0;
+		
+		
+		std::memcpy(&block, inBytes + result, sizeof(block));
+		if (0 != (block & 0x8080808080808080ULL))
+		{
+			break;
+		}
+		result += sizeof(block);
+	}
+#endif
+	
+	// finish (or find the end of the run) one byte at a time
+	while ((result < inByteCount) && UTF8Decoder_StateMachine::isSingleByteGlyph(inBytes[result]))
+	{
+		++result;
+	}
+	return result;
+}// countLeadingSingleByteGlyphs
+
+
+/*!
+Decodes bytes by calling nextState() for every one, appending
+code points in the same way that appendCodePoints() does (so
+this is also the reference implementation for testing).
+Returns the number of errors.
+
+(2017.10)
+*/
+UInt32
+decodeByteByByte	(UTF8Decoder_StateMachine&		inoutDecoder,
+					 UInt8 const*					inBytes,
+					 size_t							inByteCount,
+					 UTF8Decoder_CodePointList&		inoutCodePoints)
+{
+	UInt32		result = 0;
+	
+	
+	for (size_t i = 0; i < inByteCount; ++i)
+	{
+		UInt32		errorCount = 0;
+		
+		
+		inoutDecoder.nextState(inBytes[i], errorCount);
+		result += errorCount;
+		inoutCodePoints.insert(inoutCodePoints.end(), errorCount, kUTF8Decoder_ErrorCodePoint);
+		if (UTF8Decoder_StateMachine::kStateUTF8ValidSequence == inoutDecoder.returnState())
+		{
+			inoutCodePoints.push_back(UTF8Decoder_StateMachine::byteSequenceTotalValue
+										(inoutDecoder.multiByteAccumulator, 0/* start index */,
+											inoutDecoder.multiByteAccumulator.size()));
+			inoutDecoder.reset();
+		}
+	}
+	return result;
+}// decodeByteByByte
+
+
+/*!
+Tests UTF8Decoder_StateMachine::appendCodePoints() with
+specific valid, invalid and divided sequences.
+
+Returns "true" if ALL assertions pass; "false" is
+returned if any fail, however messages should be
+printed for ALL assertion failures regardless.
+
+(2017.10)
+*/
+Boolean
+unitTest_AppendCodePoints_000 ()
+{
+	UnicodeScalarValue const	kE = kUTF8Decoder_ErrorCodePoint;
+	Boolean						result = true;
+	
+	
+	// each case is a byte sequence and the code points it should
+	// produce, given a new decoder
+	struct
+	{
+		char const*							name;
+		UTF8Decoder_ByteString				bytes;
+		UTF8Decoder_CodePointList			expected;
+	} const		kCases[] =
+	{
+		{ "empty", {}, {} },
+		{ "ASCII", { 'H', 'e', 'l', 'l', 'o', ',', ' ', 'w', 'o', 'r', 'l', 'd', '!', '\r', '\n', 0x1B, '[', 'm', 0x00 },
+			{ 'H', 'e', 'l', 'l', 'o', ',', ' ', 'w', 'o', 'r', 'l', 'd', '!', '\r', '\n', 0x1B, '[', 'm', 0x00 } },
+		{ "two-byte", { 0xC3, 0xA9 }, { 0x00E9 } },
+		{ "three-byte", { 0xE2, 0x98, 0x82 }, { 0x2602 } },
+		{ "four-byte", { 0xF0, 0x9F, 0x98, 0x90 }, { 0x1F610 } },
+		{ "highest valid", { 0xF4, 0x8F, 0xBF, 0xBE }, { 0x10FFFE } },
+		{ "U+10FFFF", { 0xF4, 0x8F, 0xBF, 0xBF }, { kE } },
+		{ "over-long two-byte", { 0xC0, 0x80, 'A' }, { kE, 'A' } },
+		{ "over-long C1 with trailer", { 0xC1, 0xBF, 0xBF }, { kE, kE } },
+		{ "over-long three-byte", { 0xE0, 0x80, 0xAF }, { kE } },
+		{ "over-long four-byte", { 0xF0, 0x80, 0x80, 0xAF }, { kE } },
+		{ "surrogate", { 0xED, 0xA0, 0x80 }, { kE } },
+		{ "five-byte", { 0xF8, 0x88, 0x80, 0x80, 0x80 }, { kE } },
+		{ "six-byte", { 0xFC, 0x84, 0x80, 0x80, 0x80, 0x80 }, { kE } },
+		{ "illegal byte", { 'a', 0xFE, 'b', 0xFF }, { 'a', kE, 'b', kE } },
+		{ "truncated then illegal", { 0xE2, 0x98, 0xFF }, { kE, kE } },
+		{ "truncated then ASCII", { 0xE2, 0x98, 'x' }, { kE, 'x' } },
+		{ "truncated then lead", { 0xC3, 0xE2, 0x98, 0x82 }, { kE, 0x2602 } },
+		{ "stray continuation", { 0x80, 'z', 0xBF }, { kE, 'z', kE } },
+		{ "too many continuations", { 0xC3, 0xA9, 0xA9 }, { 0x00E9, kE } },
+	};
+	
+	
+	for (auto const& kCase : kCases)
+	{
+		UTF8Decoder_StateMachine	decoder;
+		UTF8Decoder_CodePointList	codePoints;
+		UInt32 const				kExpectedErrors = STATIC_CAST(std::count(kCase.expected.begin(), kCase.expected.end(), kE), UInt32);
+		UInt32						errorCount = 0;
+		
+		
+		errorCount = decoder.appendCodePoints(kCase.bytes.data(), kCase.bytes.size(), codePoints);
+		result &= Console_Assert(kCase.name, kCase.expected == codePoints);
+		result &= Console_Assert(kCase.name, kExpectedErrors == errorCount);
+	}
+	
+	// a sequence divided across calls is carried over
+	{
+		UInt8 const					kBytes[] = { 'a', 0xF0, 0x9F, 0x98, 0x90, 'b' };
+		UTF8Decoder_StateMachine	decoder;
+		UTF8Decoder_CodePointList	codePoints;
+		UInt32						errorCount = 0;
+		
+		
+		errorCount += decoder.appendCodePoints(kBytes, 3, codePoints);
+		result &= Console_Assert("divided, incomplete", decoder.incompleteSequence());
+		result &= Console_Assert("divided, first part", UTF8Decoder_CodePointList{ 'a' } == codePoints);
+		errorCount += decoder.appendCodePoints(kBytes + 3, 1, codePoints);
+		errorCount += decoder.appendCodePoints(kBytes + 4, 2, codePoints);
+		result &= Console_Assert("divided, complete", false == decoder.incompleteSequence());
+		result &= Console_Assert("divided, code points", (UTF8Decoder_CodePointList{ 'a', 0x1F610, 'b' } == codePoints));
+		result &= Console_Assert("divided, errors", 0 == errorCount);
+	}
+	
+	return result;
+}// unitTest_AppendCodePoints_000
+
+
+/*!
+Compares UTF8Decoder_StateMachine::appendCodePoints() with a
+byte-by-byte decode using nextState(), for many buffers of
+random bytes that are divided at random points.  The byte
+values are chosen to make valid and invalid multi-byte
+sequences (and their boundary cases) reasonably common.
+
+Returns "true" if ALL assertions pass; "false" is
+returned if any fail, however messages should be
+printed for ALL assertion failures regardless.
+
+(2017.10)
+*/
+Boolean
+unitTest_AppendCodePoints_001 ()
+{
+	UInt8 const		kInterestingBytes[] =
+					{
+						0x00, 0x1B, 'A', 0x7F, 0x80, 0x8F, 0x90, 0x9F, 0xA0, 0xBF,
+						0xC0, 0xC1, 0xC2, 0xDF, 0xE0, 0xED, 0xEF, 0xF0, 0xF4, 0xF5,
+						0xF7, 0xF8, 0xFB, 0xFC, 0xFD, 0xFE, 0xFF
+					};
+	size_t const	kInterestingByteCount = sizeof(kInterestingBytes) / sizeof(UInt8);
+	UInt16 const	kIterations = 20000;
+	Boolean			result = true;
+	
+	
+	for (UInt16 i = 0; ((result) && (i < kIterations)); ++i)
+	{
+		std::vector< UInt8 >		bytes(arc4random_uniform(96));
+		UTF8Decoder_StateMachine	bulkDecoder;
+		UTF8Decoder_StateMachine	referenceDecoder;
+		UTF8Decoder_CodePointList	bulkCodePoints;
+		UTF8Decoder_CodePointList	referenceCodePoints;
+		UInt32						bulkErrors = 0;
+		UInt32						referenceErrors = 0;
+		
+		
+		for (auto& byteRef : bytes)
+		{
+			switch (arc4random_uniform(4))
+			{
+			case 0:
+				// long runs of ASCII exercise the block scan
+				byteRef = STATIC_CAST(0x20 + arc4random_uniform(0x5F), UInt8);
+				break;
+			
+			case 1:
+				byteRef = STATIC_CAST(arc4random_uniform(256), UInt8);
+				break;
+			
+			default:
+				byteRef = kInterestingBytes[arc4random_uniform(kInterestingByteCount)];
+				break;
+			}
+		}
+		
+		referenceErrors = decodeByteByByte(referenceDecoder, bytes.data(), bytes.size(), referenceCodePoints);
+		
+		// decode the same bytes in up to 3 pieces
+		{
+			size_t const	kSplit1 = (bytes.empty()) ? 0 : arc4random_uniform(STATIC_CAST(bytes.size(), UInt32));
+			size_t const	kSplit2 = (bytes.empty()) ? 0 : (kSplit1 + arc4random_uniform(STATIC_CAST(bytes.size() - kSplit1, UInt32)));
+			
+			
+			bulkErrors += bulkDecoder.appendCodePoints(bytes.data(), kSplit1, bulkCodePoints);
+			bulkErrors += bulkDecoder.appendCodePoints(bytes.data() + kSplit1, kSplit2 - kSplit1, bulkCodePoints);
+			bulkErrors += bulkDecoder.appendCodePoints(bytes.data() + kSplit2, bytes.size() - kSplit2, bulkCodePoints);
+		}
+		
+		result &= Console_Assert("bulk decode matches state machine, code points", referenceCodePoints == bulkCodePoints);
+		result &= Console_Assert("bulk decode matches state machine, errors", referenceErrors == bulkErrors);
+		result &= Console_Assert("bulk decode matches state machine, carried sequence",
+									referenceDecoder.multiByteAccumulator == bulkDecoder.multiByteAccumulator);
+		result &= Console_Assert("bulk decode matches state machine, incomplete",
+									referenceDecoder.incompleteSequence() == bulkDecoder.incompleteSequence());
+		if (false == result)
+		{
+			Console_WriteValue("failed on random buffer of size", STATIC_CAST(bytes.size(), SInt32));
+		}
+	}
+	
+	return result;
+}// unitTest_AppendCodePoints_001
+
+} // anonymous namespace
+
 // BELOW IS REQUIRED NEWLINE TO END FILE
@@ -32,6 +32,7 @@
 
 // standard-C++ includes
 #include <string>
+#include <vector>
 
 // Mac includes
 #include <CoreServices/CoreServices.h>
@@ -46,9 +47,18 @@ valid Unicode value was not found.
 */
 UnicodeScalarValue const	kUTF8Decoder_InvalidUnicodeCodePoint = 0xFFFF;
 
+/*!
+The code point that represents each error found by a bulk
+decode; see UTF8Decoder_StateMachine::appendCodePoints().
+This must match the character that is inserted by
+UTF8Decoder_StateMachine::appendErrorCharacter().
+*/
+UnicodeScalarValue const	kUTF8Decoder_ErrorCodePoint = 0xFFFD;
+
 #pragma mark Types
 
 typedef std::basic_string<UInt8>	UTF8Decoder_ByteString;
+typedef std::vector< UnicodeScalarValue >	UTF8Decoder_CodePointList;
 
 /*!
 Represents the state of a UTF-8 code point that is in the
@@ -73,6 +83,10 @@ struct UTF8Decoder_StateMachine
 	
 	UTF8Decoder_StateMachine ();
 	
+	//! Decodes an entire buffer, with the same result as calling nextState() (and reset()) for each byte.
+	UInt32
+	appendCodePoints	(UInt8 const*, size_t, UTF8Decoder_CodePointList&);
+	
 	//! Returns true if the current sequence is incomplete.
 	Boolean
 	incompleteSequence ();
@@ -124,6 +138,18 @@ private:
 };
 
 
+
+#pragma mark Public Methods
+
+//!\name Module Tests
+//@{
+
+void
+	UTF8Decoder_RunTests					();
+
+//@}
+
+
 /*!
 Appends a valid sequence of bytes to the specified string, that
 represent the “invalid character” code point.
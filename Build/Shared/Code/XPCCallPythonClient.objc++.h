@@ -56,6 +56,11 @@ INCOMPLETE
 	xpcServiceSendMessage:(NSString*)_
 	withReply:(XPCCallPythonClient_ReplyBlock)_;
 
+	// the file handle is a socket that speaks "ScriptHostProtocol.h"
+	- (void)
+	xpcServiceAttachScriptHost:(NSFileHandle*)_
+	withReply:(XPCCallPythonClient_ReplyBlock)_;
+
 @end //}
 
 // BELOW IS REQUIRED NEWLINE TO END FILE